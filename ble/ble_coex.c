@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file   ble_coex.c
+ *  @brief  UWB/BLE coexistence for the TDMA tag.
+ *
+ *          The Zephyr 1.14 controller does not expose the timing of its
+ *          connection events, so the module cannot place the UWB slots
+ *          directly. Instead it locks the two schedules together and
+ *          searches for the phase:
+ *
+ *          - on connection, the interval is updated to the longest one
+ *            dividing the TDMA cycle, so that every cycle sees the
+ *            connection events at the same offset (up to the slow drift
+ *            between the 32 kHz sleep clock and the DW1000 crystal);
+ *          - a cycle with too many failed slots means the slots overlap
+ *            a connection event, the schedule is delayed by one step
+ *            from the next cycle on, until the slots fall in between.
+ *  @author RTLOC
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+
+#include "ble_coex.h"
+
+static ble_coex_cfg_t coex_cfg;
+static ble_coex_state_t coex_state;
+
+/* Longest interval, in 1.25 ms units, dividing the TDMA cycle, 0 if none */
+static uint16_t coex_interval(void)
+{
+	uint32_t period;
+	uint32_t n;
+
+	/* The cycle must be a whole number of 1.25 ms units */
+	if ((coex_cfg.period_ms * 4) % 5) {
+		return 0;
+	}
+	period = coex_cfg.period_ms * 4 / 5;
+
+	for (n = 1; period / n >= BLE_COEX_INTERVAL_MIN; n++) {
+		if ((period % n == 0) && (period / n <= coex_cfg.interval_max)) {
+			return period / n;
+		}
+	}
+
+	return 0;
+}
+
+/* Lock on an interval in use, whether it came from our update or not */
+static void coex_lock(uint16_t interval)
+{
+	coex_state.interval = interval;
+
+	/* A slave latency lets connection events move by whole intervals, which keeps the lock */
+	coex_state.locked = interval && ((coex_cfg.period_ms * 4) % 5 == 0) &&
+			    ((coex_cfg.period_ms * 4 / 5) % interval == 0);
+
+	printk("[COEX] interval %u x 1.25 ms, %s\n", interval, coex_state.locked ? "locked" : "not locked");
+}
+
+static void coex_connected(struct bt_conn *conn, u8_t err)
+{
+	uint16_t interval;
+	struct bt_le_conn_param param;
+	struct bt_conn_info info;
+
+	if (err) {
+		return;
+	}
+
+	/* No le_param_updated comes if the central keeps its interval: lock on it now */
+	coex_state.locked = 0;
+	if ((bt_conn_get_info(conn, &info) == 0) && (info.type == BT_CONN_TYPE_LE)) {
+		coex_lock(info.le.interval);
+	}
+
+	interval = coex_interval();
+	if (!interval) {
+		printk("[COEX] no connection interval divides the %u ms cycle\n", coex_cfg.period_ms);
+		return;
+	}
+	if (interval == coex_state.interval) {
+		return;
+	}
+
+	param.interval_min = interval;
+	param.interval_max = interval;
+	param.latency = 0;
+	param.timeout = 400;
+
+	err = bt_conn_le_param_update(conn, &param);
+	if (err) {
+		printk("[COEX] connection update failed (err %d)\n", err);
+	}
+}
+
+static void coex_param_updated(struct bt_conn *conn, u16_t interval, u16_t latency, u16_t timeout)
+{
+	coex_lock(interval);
+}
+
+static void coex_disconnected(struct bt_conn *conn, u8_t reason)
+{
+	coex_state.interval = 0;
+	coex_state.locked = 0;
+}
+
+static struct bt_conn_cb coex_callbacks = {
+	.connected = coex_connected,
+	.disconnected = coex_disconnected,
+	.le_param_updated = coex_param_updated,
+};
+
+int ble_coex_init(const ble_coex_cfg_t *cfg)
+{
+	if (!cfg || !cfg->period_ms || (cfg->interval_max < BLE_COEX_INTERVAL_MIN) || !cfg->fail_thresh) {
+		return -1;
+	}
+
+	coex_cfg = *cfg;
+	memset(&coex_state, 0, sizeof(coex_state));
+
+	bt_conn_cb_register(&coex_callbacks);
+
+	return 0;
+}
+
+/* From the TDMA cycle callback, in the DW1000 IRQ thread */
+void ble_coex_cycle(const rng_result_t *results, uint8_t count)
+{
+	uint8_t failed = 0;
+	uint8_t i;
+
+	for (i = 0; i < count; i++) {
+		if ((results[i].status == RNG_ERR_TX_LATE) || (results[i].status == RNG_ERR_RX_TIMEOUT) ||
+		    (results[i].status == RNG_ERR_RX)) {
+			failed++;
+		}
+	}
+
+	coex_state.failed += failed;
+
+	/* Without a connection, or with a drifting phase, shifting does not help */
+	if (coex_state.locked && (failed >= coex_cfg.fail_thresh)) {
+		rng_tdma_shift(coex_cfg.step_uus);
+		coex_state.shifts++;
+	}
+}
+
+void ble_coex_get_state(ble_coex_state_t *state)
+{
+	*state = coex_state;
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file   ble_coex.h
+ *  @brief  UWB/BLE coexistence for the TDMA tag.
+ *
+ *          The BLE connection interval is negotiated to divide the TDMA
+ *          cycle, so BLE connection events keep the same phase within
+ *          the cycle. When ranging slots fail, the TDMA schedule is
+ *          shifted step by step until the slots fall between connection
+ *          events.
+ *  @author RTLOC
+ */
+
+#ifndef __BLE_COEX_H__
+#define __BLE_COEX_H__
+
+#include <stdint.h>
+
+#include "rng_tdma.h"
+
+#define BLE_COEX_INTERVAL_MIN	6	/* 7.5 ms, in 1.25 ms units */
+
+typedef struct {
+	uint16_t period_ms;	/* TDMA cycle, 1000 / rateHz */
+	uint16_t interval_max;	/* longest connection interval, in 1.25 ms units */
+	uint16_t step_uus;	/* schedule shift on a failed cycle */
+	uint8_t fail_thresh;	/* failed slots in a cycle triggering a shift */
+} ble_coex_cfg_t;
+
+typedef struct {
+	uint16_t interval;	/* connection interval in use, 1.25 ms units */
+	uint8_t locked;		/* the interval divides the TDMA cycle */
+	uint32_t shifts;	/* schedule shifts so far */
+	uint32_t failed;	/* failed slots so far */
+} ble_coex_state_t;
+
+int ble_coex_init(const ble_coex_cfg_t *cfg);
+void ble_coex_cycle(const rng_result_t *results, uint8_t count);
+void ble_coex_get_state(ble_coex_state_t *state);
+
+#endif /* __BLE_COEX_H__ */
@@ -25,13 +25,21 @@
  *  @author RTLOC
  */
 
+#include <zephyr.h>
+#include <string.h>
+
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/conn.h>
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
+#include <bluetooth/hci.h>
 
 #include <gatt/dps.h>
 
+#include "deca_frame.h"
+
+#include "ble_dwm1001.h"
+
 
 struct bt_conn *default_conn;
 
@@ -42,10 +50,164 @@ static const struct bt_data ad[] = {
 
 static uint8_t ble_connected = 0;
 
+/* Connection parameters of the profiles, ble_conn_profile_t order */
+static ble_conn_param_t conn_params[] = {
+	{ 0, 0, 0, 0 },
+	{ 6, 12, 0, 400 },
+	{ 80, 160, 4, 600 },
+	{ 0, 0, 0, 0 },
+};
+
+static ble_conn_profile_t conn_profile = BLE_CONN_CENTRAL;
+static struct k_work conn_work;
+
+/* Command service, see ble_dwm1001_cmd_cb() */
+static struct bt_uuid_128 cmd_svc_uuid = BT_UUID_INIT_128(
+	0x4e, 0x8c, 0x1b, 0x7a, 0x0d, 0x5e, 0x2b, 0x9d,
+	0x6e, 0x4c, 0x55, 0x2a, 0x00, 0x00, 0x1c, 0x3f);
+static struct bt_uuid_128 cmd_chrc_uuid = BT_UUID_INIT_128(
+	0x4e, 0x8c, 0x1b, 0x7a, 0x0d, 0x5e, 0x2b, 0x9d,
+	0x6e, 0x4c, 0x55, 0x2a, 0x01, 0x00, 0x1c, 0x3f);
+
+static ble_cmd_cb_t cmd_cb;
+static char cmd_line[BLE_CMD_LEN + 1];
+static atomic_t cmd_busy;
+static struct k_work cmd_work;
+
+#if defined(CONFIG_BT_GATT_CLIENT)
+static void mtu_exchanged(struct bt_conn *conn, u8_t err, struct bt_gatt_exchange_params *params)
+{
+	printk("[BLE] MTU %u%s\n", bt_gatt_get_mtu(conn), err ? " (exchange failed)" : "");
+}
+
+static struct bt_gatt_exchange_params mtu_params = {
+	.func = mtu_exchanged,
+};
+#endif
+
+/* Ask the controller for the longest packets and the 2M PHY, the central has the last word */
+static void conn_hci_update(struct bt_conn *conn)
+{
+	struct bt_hci_cp_le_set_data_len *dl;
+	struct bt_hci_cp_le_set_phy *phy;
+	struct net_buf *buf;
+	u16_t handle;
+	int err;
+
+	if (bt_hci_get_conn_handle(conn, &handle)) {
+		return;
+	}
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_LE_SET_DATA_LEN, sizeof(*dl));
+	if (buf) {
+		dl = net_buf_add(buf, sizeof(*dl));
+		dl->handle = sys_cpu_to_le16(handle);
+		dl->tx_octets = sys_cpu_to_le16(251);
+		dl->tx_time = sys_cpu_to_le16(2120);	/* 251 octets at 1M */
+		err = bt_hci_cmd_send_sync(BT_HCI_OP_LE_SET_DATA_LEN, buf, NULL);
+		if (err) {
+			printk("[BLE] data length update failed (err %d)\n", err);
+		}
+	}
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_LE_SET_PHY, sizeof(*phy));
+	if (buf) {
+		phy = net_buf_add(buf, sizeof(*phy));
+		phy->handle = sys_cpu_to_le16(handle);
+		phy->all_phys = 0;
+		phy->tx_phys = BT_HCI_LE_PHY_PREFER_2M;
+		phy->rx_phys = BT_HCI_LE_PHY_PREFER_2M;
+		phy->phy_opts = 0;
+		err = bt_hci_cmd_send_sync(BT_HCI_OP_LE_SET_PHY, buf, NULL);
+		if (err) {
+			printk("[BLE] PHY update failed (err %d)\n", err);
+		}
+	}
+}
+
+/* default_conn with a reference held by the caller, disconnected() may drop it meanwhile */
+static struct bt_conn *conn_get(void)
+{
+	unsigned int key = irq_lock();
+	struct bt_conn *conn = default_conn ? bt_conn_ref(default_conn) : NULL;
+
+	irq_unlock(key);
+
+	return conn;
+}
+
+/* Negotiation on connect, from the system work queue: the HCI commands wait for their completion */
+static void conn_work_handler(struct k_work *work)
+{
+	struct bt_conn *conn = conn_get();
+	const ble_conn_param_t *p = &conn_params[conn_profile];
+	struct bt_le_conn_param param;
+	int err;
+
+	if (!conn) {
+		return;
+	}
+
+	conn_hci_update(conn);
+
+#if defined(CONFIG_BT_GATT_CLIENT)
+	err = bt_gatt_exchange_mtu(conn, &mtu_params);
+	if (err) {
+		printk("[BLE] MTU exchange failed (err %d)\n", err);
+	}
+#endif
+
+	if ((conn_profile != BLE_CONN_CENTRAL) && p->interval_min) {
+		param.interval_min = p->interval_min;
+		param.interval_max = p->interval_max;
+		param.latency = p->latency;
+		param.timeout = p->timeout;
+		err = bt_conn_le_param_update(conn, &param);
+		if (err) {
+			printk("[BLE] connection update failed (err %d)\n", err);
+		}
+	}
+
+	bt_conn_unref(conn);
+}
+
 static void dps_data_handler(ble_dps_data_evt_t * p_evt)
 {
 }
 
+/* One line at a time: the BLE RX thread copies, the system work queue runs it */
+static ssize_t cmd_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			 const void *buf, u16_t len, u16_t offset, u8_t flags)
+{
+	if (offset || (len > BLE_CMD_LEN)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+	if (!atomic_cas(&cmd_busy, 0, 1)) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	memcpy(cmd_line, buf, len);
+	cmd_line[len] = '\0';
+	k_work_submit(&cmd_work);
+
+	return len;
+}
+
+static void cmd_work_handler(struct k_work *work)
+{
+	cmd_cb(cmd_line);
+	atomic_clear(&cmd_busy);
+}
+
+static struct bt_gatt_attr cmd_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(&cmd_svc_uuid),
+	BT_GATT_CHARACTERISTIC(&cmd_chrc_uuid.uuid,
+			       BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+			       BT_GATT_PERM_WRITE, NULL, cmd_write, NULL),
+};
+
+static struct bt_gatt_service cmd_svc = BT_GATT_SERVICE(cmd_attrs);
+
 static void connected(struct bt_conn *conn, u8_t err)
 {
 	if (err) {
@@ -54,24 +216,37 @@ static void connected(struct bt_conn *conn, u8_t err)
 		default_conn = bt_conn_ref(conn);
 		printk("Connected\n");
 		ble_connected = 1;
+		k_work_submit(&conn_work);
 	}
 }
 
 static void disconnected(struct bt_conn *conn, u8_t reason)
 {
+	unsigned int key;
+
 	printk("Disconnected (reason %u)\n", reason);
 
 	ble_connected = 0;
 
-	if (default_conn) {
-		bt_conn_unref(default_conn);
-		default_conn = NULL;
+	key = irq_lock();
+	conn = default_conn;
+	default_conn = NULL;
+	irq_unlock(key);
+
+	if (conn) {
+		bt_conn_unref(conn);
 	}
 }
 
+static void param_updated(struct bt_conn *conn, u16_t interval, u16_t latency, u16_t timeout)
+{
+	printk("[BLE] interval %u x 1.25 ms, latency %u, timeout %u x 10 ms\n", interval, latency, timeout);
+}
+
 static struct bt_conn_cb conn_callbacks = {
 	.connected = connected,
 	.disconnected = disconnected,
+	.le_param_updated = param_updated,
 };
 
 static void bt_ready(int err)
@@ -93,6 +268,13 @@ static void bt_ready(int err)
 		return;
 	}
 
+	if (cmd_cb) {
+		err = bt_gatt_service_register(&cmd_svc);
+		if (err) {
+			printk("err - command service failed to register (err %d)\n", err);
+		}
+	}
+
 	err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), NULL, 0);
 	if (err) {
 		printk("Advertising failed to start (err %d)\n", err);
@@ -120,6 +302,10 @@ ble_device_info_t devinfo;
 int ble_dwm1001_enable(void)
 {
     int err;
+
+	k_work_init(&conn_work, conn_work_handler);
+	k_work_init(&cmd_work, cmd_work_handler);
+
 	err = bt_enable(bt_ready);
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
@@ -134,9 +320,333 @@ int ble_dwm1001_enable(void)
     return 0;
 }
 
+/* Notification path
+ *
+ * The ranging code only copies into rings and the BLE thread packs and
+ * notifies, so a slow BLE stack never stalls the caller: when a ring is full
+ * the new entry is dropped and counted. Nothing is queued while no central is
+ * connected.
+ *
+ * The report ring has a single producer, the ranging loop: its head index is
+ * only written by it and the tail index only by the BLE thread. Frames come
+ * from several contexts, the DW1000 IRQ work queue (CIR, TDMA, event
+ * counters) and the system work queue (command replies): a producer claims
+ * its slot with a compare and swap on the head, then stores the frame. The
+ * BLE thread takes a slot back only once it holds a frame, a producer still
+ * storing wakes it again when done. Neither side locks.
+ */
+#define BLE_TX_MTU		(247 - 3)	/* largest notification payload with the max LE data length */
+#define BLE_TX_FRAMES		4		/* ble_dwm1001_dps() frames queued, power of two */
+#define BLE_TX_STACK_SIZE	1024
+#define BLE_TX_PRIO		8		/* below the application, only runs while ranging waits */
+
+struct ble_batch_rep {
+	uint16_t node_id;
+	int32_t dist_mm;
+	uint8_t tqf;
+};
+
+static ble_batch_cfg_t batch_cfg = { .count = 0, .deadline = 100, .delta = 0 };
+
+/* Free running indexes, the ring lengths are powers of two */
+static struct ble_batch_rep rep_ring[BLE_BATCH_LEN];
+static atomic_t rep_head;
+static atomic_t rep_tail;
+static atomic_t frame_ring[BLE_TX_FRAMES];	/* frame pool buffers, 0 while not stored */
+static atomic_t frame_head;
+static atomic_t frame_tail;
+
+static atomic_t tx_mtu = ATOMIC_INIT(23 - 3);	/* refreshed by the BLE thread */
+static atomic_t tx_flush;
+static atomic_t tx_dropped;
+static K_SEM_DEFINE(tx_sem, 0, 1);
+static uint8_t tx_buf[BLE_TX_MTU];
+
+static uint8_t batch_fits(uint16_t mtu)
+{
+	uint8_t size = batch_cfg.delta ? sizeof(ble_rep_delta_t) : sizeof(ble_rep_t);
+
+	return (mtu - 1 - sizeof(ble_rep_t)) / size + 1;
+}
+
+static int batch_full(uint32_t cnt)
+{
+	return (batch_cfg.count && (cnt >= batch_cfg.count)) ||
+	       (cnt >= batch_fits(atomic_get(&tx_mtu))) || (cnt >= BLE_BATCH_LEN);
+}
+
+/* Pack the oldest reports in one notification of at most len bytes */
+static uint16_t batch_pack(uint8_t *buf, uint16_t len)
+{
+	uint32_t tail = atomic_get(&rep_tail);
+	uint32_t head = atomic_get(&rep_head);
+	uint16_t pos = 1;
+	uint8_t n = 0;
+	int32_t prev = 0;
+
+	while ((tail != head) && (n < BLE_CMD_MARK)) {
+		const struct ble_batch_rep *rep = &rep_ring[tail % BLE_BATCH_LEN];
+
+		if (batch_cfg.delta && n) {
+			ble_rep_delta_t d;
+			int32_t diff = rep->dist_mm - prev;
+
+			/* Out of int16 range: start the next notification with it */
+			if ((pos + sizeof(d) > len) || (diff < INT16_MIN) || (diff > INT16_MAX)) {
+				break;
+			}
+			d.node_id = rep->node_id;
+			d.ddist = (int16_t)diff;
+			d.tqf = rep->tqf;
+			memcpy(&buf[pos], &d, sizeof(d));
+			pos += sizeof(d);
+		} else {
+			ble_rep_t r;
+
+			if (pos + sizeof(r) > len) {
+				break;
+			}
+			r.node_id = rep->node_id;
+			if (batch_cfg.delta) {
+				memcpy(&r.dist, &rep->dist_mm, sizeof(r.dist));
+			} else {
+				r.dist = rep->dist_mm * 0.001f;
+			}
+			r.tqf = rep->tqf;
+			memcpy(&buf[pos], &r, sizeof(r));
+			pos += sizeof(r);
+		}
+		prev = rep->dist_mm;
+		tail++;
+		n++;
+	}
+
+	/* Hand the slots back to the producer */
+	atomic_set(&rep_tail, tail);
+
+	buf[0] = n | (batch_cfg.delta ? BLE_REPS_DELTA : 0);
+
+	return n ? pos : 0;
+}
+
+/* Oldest frame queued, or NULL if none or its producer is still storing it */
+static deca_frame_t *frame_take(void)
+{
+	uint32_t tail = atomic_get(&frame_tail);
+	deca_frame_t *frame;
+
+	if (tail == atomic_get(&frame_head)) {
+		return NULL;
+	}
+
+	frame = (deca_frame_t *)(uintptr_t)atomic_clear(&frame_ring[tail % BLE_TX_FRAMES]);
+	if (frame) {
+		atomic_set(&frame_tail, tail + 1);
+	}
+
+	return frame;
+}
+
+static void ble_tx_thread(void *p1, void *p2, void *p3)
+{
+	s32_t timeout = K_FOREVER;
+	u32_t deadline = 0;
+	struct bt_conn *conn;
+	deca_frame_t *frame;
+	uint32_t cnt;
+	uint16_t len, mtu;
+	int expired, flush;
+
+	while (1) {
+		expired = (k_sem_take(&tx_sem, timeout) != 0);
+		/* Taken on every wakeup: a request left over would flush the next report alone */
+		flush = atomic_clear(&tx_flush);
+
+		/* Held for the sends, a disconnection meanwhile only fails them */
+		conn = conn_get();
+		if (!ble_connected || !conn) {
+			while ((frame = frame_take()) != NULL) {
+				deca_frame_unref(frame);
+			}
+			atomic_set(&rep_tail, atomic_get(&rep_head));
+			timeout = K_FOREVER;
+			if (conn) {
+				bt_conn_unref(conn);
+			}
+			continue;
+		}
+
+		/* ATT notification header: opcode and handle */
+		mtu = bt_gatt_get_mtu(conn) - 3;
+		if (mtu > BLE_TX_MTU) {
+			mtu = BLE_TX_MTU;
+		}
+		atomic_set(&tx_mtu, mtu);
+
+		while ((frame = frame_take()) != NULL) {
+			dps_notify_loc_data(conn, frame->data, MIN(frame->len, mtu));
+			deca_frame_unref(frame);
+		}
+
+		cnt = atomic_get(&rep_head) - atomic_get(&rep_tail);
+		if (!cnt) {
+			timeout = K_FOREVER;
+		} else if (expired || flush || batch_full(cnt)) {
+			while ((len = batch_pack(tx_buf, mtu)) != 0) {
+				dps_notify_loc_data(conn, tx_buf, len);
+			}
+			timeout = K_FOREVER;
+		} else if (batch_cfg.deadline) {
+			/* The first report queued arms the deadline */
+			if (timeout == K_FOREVER) {
+				deadline = k_uptime_get_32() + batch_cfg.deadline;
+			}
+			timeout = (s32_t)(deadline - k_uptime_get_32());
+			if (timeout < 0) {
+				timeout = K_NO_WAIT;
+			}
+		}
+
+		bt_conn_unref(conn);
+	}
+}
+
+K_THREAD_DEFINE(ble_tx_tid, BLE_TX_STACK_SIZE, ble_tx_thread,
+		NULL, NULL, NULL, K_PRIO_PREEMPT(BLE_TX_PRIO), 0, K_NO_WAIT);
+
+void ble_dwm1001_dps_frame(deca_frame_t *frame)
+{
+	uint32_t head;
+
+	if (!ble_connected) {
+		return;
+	}
+
+	do {
+		head = atomic_get(&frame_head);
+		if (head - atomic_get(&frame_tail) >= BLE_TX_FRAMES) {
+			atomic_inc(&tx_dropped);
+			return;
+		}
+	} while (!atomic_cas(&frame_head, head, head + 1));
+
+	atomic_set(&frame_ring[head % BLE_TX_FRAMES], (atomic_val_t)(uintptr_t)deca_frame_ref(frame));
+
+	k_sem_give(&tx_sem);
+}
+
 void ble_dwm1001_dps(uint8_t *tx, uint16_t len)
 {
-    dps_notify_loc_data(default_conn, tx, len);
+	deca_frame_t *frame;
+
+	if (!ble_connected) {
+		return;
+	}
+
+	frame = deca_frame_alloc(len, K_NO_WAIT);
+	if (!frame) {
+		atomic_inc(&tx_dropped);
+		return;
+	}
+
+	memcpy(frame->data, tx, len);
+	ble_dwm1001_dps_frame(frame);
+	deca_frame_unref(frame);
+}
+
+void ble_dwm1001_batch_cfg(const ble_batch_cfg_t *cfg)
+{
+	batch_cfg = *cfg;
+}
+
+void ble_dwm1001_report(uint16_t node_id, int32_t dist_mm, uint8_t tqf)
+{
+	uint32_t head = atomic_get(&rep_head);
+	uint32_t cnt = head - atomic_get(&rep_tail);
+	struct ble_batch_rep *rep = &rep_ring[head % BLE_BATCH_LEN];
+
+	if (!ble_connected) {
+		return;
+	}
+
+	if (cnt >= BLE_BATCH_LEN) {
+		atomic_inc(&tx_dropped);
+		return;
+	}
+
+	rep->node_id = node_id;
+	rep->dist_mm = dist_mm;
+	rep->tqf = tqf;
+	atomic_set(&rep_head, head + 1);
+	cnt++;
+
+	/* Wake the BLE thread to arm the deadline or to send */
+	if ((cnt == 1) || batch_full(cnt)) {
+		k_sem_give(&tx_sem);
+	}
+}
+
+void ble_dwm1001_flush(void)
+{
+	atomic_set(&tx_flush, 1);
+	k_sem_give(&tx_sem);
+}
+
+void ble_dwm1001_position(int32_t x_mm, int32_t y_mm, int32_t z_mm, uint8_t qf)
+{
+	uint8_t buf[1 + sizeof(ble_pos_t)];
+	ble_pos_t pos;
+
+	pos.x = x_mm;
+	pos.y = y_mm;
+	pos.z = z_mm;
+	pos.qf = qf;
+
+	buf[0] = BLE_POS_MARK;
+	memcpy(&buf[1], &pos, sizeof(pos));
+	ble_dwm1001_dps(buf, sizeof(buf));
+}
+
+void ble_dwm1001_evc(const ble_evc_t *evc)
+{
+	uint8_t buf[1 + sizeof(ble_evc_t)];
+
+	buf[0] = BLE_EVC_MARK;
+	memcpy(&buf[1], evc, sizeof(*evc));
+	ble_dwm1001_dps(buf, sizeof(buf));
+}
+
+void ble_dwm1001_cmd_reply(const char *text)
+{
+	uint8_t buf[1 + BLE_CMD_LEN];
+	uint16_t len = MIN(strlen(text), BLE_CMD_LEN);
+
+	buf[0] = BLE_CMD_MARK;
+	memcpy(&buf[1], text, len);
+	ble_dwm1001_dps(buf, 1 + len);
+}
+
+void ble_dwm1001_cmd_cb(ble_cmd_cb_t cb)
+{
+	cmd_cb = cb;
+}
+
+uint32_t ble_dwm1001_dropped(void)
+{
+	return atomic_get(&tx_dropped);
+}
+
+void ble_dwm1001_conn_profile(ble_conn_profile_t profile)
+{
+	if (profile <= BLE_CONN_CUSTOM) {
+		conn_profile = profile;
+	}
+}
+
+void ble_dwm1001_conn_param(const ble_conn_param_t *param)
+{
+	conn_params[BLE_CONN_CUSTOM] = *param;
+	conn_profile = BLE_CONN_CUSTOM;
 }
 
 void ble_dwm1001_set_devinfo(ble_device_info_t *devinfo_new)
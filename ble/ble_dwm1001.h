@@ -28,6 +28,7 @@
 #define __BLE_DWM1001_H__
 
 #include "dps.h"
+#include "deca_frame.h"
 
 /* BLE Report */
 struct ble_rep {
@@ -44,8 +45,113 @@ struct ble_reps {
 typedef struct ble_reps ble_reps_t;
 
 
+/* Notifications
+ *
+ * ble_dwm1001_dps() and ble_dwm1001_report() never block: they queue and a
+ * BLE thread sends, see ble_dwm1001.c. ble_dwm1001_dps() copies into a
+ * frame pool buffer, ble_dwm1001_dps_frame() takes a reference on a pool
+ * frame instead, e.g. one received from the RX pipeline. Entries are dropped, and counted by
+ * ble_dwm1001_dropped(), when the queue is full and silently while no
+ * central is connected. Frames may be queued from any thread or work
+ * queue, reports from one thread only.
+ *
+ * Reports are sent packed in as few notifications as the ATT MTU
+ * allows. A notification is either the ble_reps_t layout above (cnt, then
+ * cnt ble_rep_t) or, with delta encoding, BLE_REPS_DELTA | cnt followed by
+ * one ble_rep_t with the distance as int32 mm and cnt - 1 ble_rep_delta_t
+ * whose distance is the int16 mm difference with the previous report.
+ *
+ * ble_dwm1001_position() sends a position computed on the device instead,
+ * as BLE_POS_MARK followed by one ble_pos_t, and ble_dwm1001_evc() the
+ * event counter rates as BLE_EVC_MARK followed by one ble_evc_t, and
+ * ble_dwm1001_cmd_reply() a command answer as BLE_CMD_MARK followed by its
+ * text. A report notification never starts with a mark, it holds fewer
+ * than 0x7C reports.
+ */
+#define BLE_REPS_DELTA		0x80
+#define BLE_POS_MARK		0x7F
+#define BLE_EVC_MARK		0x7D
+#define BLE_CMD_MARK		0x7C
+#define BLE_EVC_COUNT		12	/* rates, in the deca_evc_id_t order */
+#define BLE_BATCH_LEN		32	/* reports queued, power of two */
+
+struct ble_rep_delta {
+	uint16_t node_id;
+	int16_t ddist;
+	uint8_t tqf;
+}__attribute__((__packed__));
+typedef struct ble_rep_delta ble_rep_delta_t;
+
+struct ble_pos {
+	int32_t x;		/* mm */
+	int32_t y;
+	int32_t z;
+	uint8_t qf;		/* quality factor, 0 to 100 */
+}__attribute__((__packed__));
+typedef struct ble_pos ble_pos_t;
+
+struct ble_evc {
+	uint8_t flags;		/* DECA_EVC_xxx diagnosis */
+	uint16_t rate[BLE_EVC_COUNT];	/* events per second, 0.1 units */
+}__attribute__((__packed__));
+typedef struct ble_evc ble_evc_t;
+
+typedef struct {
+	uint8_t count;		/* flush when this many reports are queued, 0: when the MTU is full */
+	uint16_t deadline;	/* ms, flush when the oldest report waited this long, 0: no deadline */
+	uint8_t delta;		/* delta encode the distances */
+} ble_batch_cfg_t;
+
+/* Connection
+ *
+ * On every connection the peripheral exchanges the largest ATT MTU,
+ * requests the longest data length and the 2M PHY (as far as the prj.conf
+ * buffers and the central allow) then, unless the profile is
+ * BLE_CONN_CENTRAL, asks for the parameters of the profile.
+ */
+typedef enum {
+	BLE_CONN_CENTRAL,	/* keep the parameters picked by the central */
+	BLE_CONN_LOW_LATENCY,	/* 7.5 - 15 ms interval, live tracking */
+	BLE_CONN_LOW_POWER,	/* 100 - 200 ms interval with slave latency */
+	BLE_CONN_CUSTOM,	/* set by ble_dwm1001_conn_param() */
+} ble_conn_profile_t;
+
+typedef struct {
+	uint16_t interval_min;	/* 1.25 ms units */
+	uint16_t interval_max;
+	uint16_t latency;	/* connection events the peripheral may skip */
+	uint16_t timeout;	/* supervision timeout, 10 ms units */
+} ble_conn_param_t;
+
+/* Commands
+ *
+ * With a command callback set before ble_dwm1001_enable(), a command
+ * service is added, 3f1c0000-2a55-4c6e-9d2b-5e0d7a1b8c4e, with one write
+ * characteristic (3f1c0001-...) taking text lines of up to BLE_CMD_LEN
+ * bytes, e.g. the rng_ctl.h commands. The callback runs on the system work
+ * queue, one line at a time: a line written while the previous one runs
+ * is refused. It answers with ble_dwm1001_cmd_reply().
+ */
+#define BLE_CMD_LEN		64
+
+typedef void (*ble_cmd_cb_t)(char *line);
+
 int ble_dwm1001_enable(void);
 void ble_dwm1001_dps(uint8_t *tx, uint16_t len);
+void ble_dwm1001_dps_frame(deca_frame_t *frame);
 void ble_dwm1001_set_devinfo(ble_device_info_t *devinfo_new);
 
+void ble_dwm1001_batch_cfg(const ble_batch_cfg_t *cfg);
+void ble_dwm1001_report(uint16_t node_id, int32_t dist_mm, uint8_t tqf);
+void ble_dwm1001_flush(void);
+void ble_dwm1001_position(int32_t x_mm, int32_t y_mm, int32_t z_mm, uint8_t qf);
+void ble_dwm1001_evc(const ble_evc_t *evc);
+uint32_t ble_dwm1001_dropped(void);
+
+void ble_dwm1001_conn_profile(ble_conn_profile_t profile);
+void ble_dwm1001_conn_param(const ble_conn_param_t *param);
+
+void ble_dwm1001_cmd_cb(ble_cmd_cb_t cb);
+void ble_dwm1001_cmd_reply(const char *text);
+
 #endif /* __BLE_DWM1001_H__ */ 
@@ -12,6 +12,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "deca_types.h"
 #include "deca_param_types.h"
@@ -54,6 +55,12 @@ uint32 _dwt_otpread(uint16 address);
 uint32 _dwt_otpprogword32(uint32 data, uint16 address);
 // Upload the device configuration into always on memory
 void _dwt_aonarrayupload(void);
+// Queue the register writes of a profile in a transaction
+static void _dwt_queueprofile(dwt_txn_t *txn, const dwt_profile_t *profile, const dwt_profile_t *prev);
+// ISR helpers shared by dwt_isr() and dwt_fastisr()
+static void _dwt_isrframeinfo(uint16 finfo16);
+static void _dwt_isrrxgood(uint32 status);
+static void _dwt_isrevents(uint32 status);
 // -------------------------------------------------------------------------------------------------------------------
 
 /*!
@@ -77,14 +84,42 @@ typedef struct
     uint16      sleep_mode;         // Used for automatic reloading of LDO tune and microcode at wake-up
     uint16      otp_mask ;          // Local copy of the OTP mask used in dwt_initialise call
     dwt_cb_data_t cbData;           // Callback data structure
+    uint16      rxPrefixLen ;       // Number of frame bytes read by dwt_fastisr()
+    uint8       rxPrefix[DWT_RX_PREFIX_MAX] ; // Frame bytes read by dwt_fastisr()
     dwt_cb_t    cbTxDone;           // Callback for TX confirmation event
     dwt_cb_t    cbRxOk;             // Callback for RX good frame event
     dwt_cb_t    cbRxTo;             // Callback for RX timeout events
     dwt_cb_t    cbRxErr;            // Callback for RX error events
+    uint8       cacheValid ;        // Which of the cached settings below are valid, see DWT_CACHE_xxx
+    dwt_profile_t  profile ;        // Register image of the last configuration passed to dwt_configure or dwt_applyprofile
+    dwt_txconfig_t txCfgCache ;     // Last configuration passed to dwt_configuretxrf
+    uint16      txAntDlyCache ;     // Last value passed to dwt_settxantennadelay
+    uint16      rxAntDlyCache ;     // Last value passed to dwt_setrxantennadelay
+    uint8       otpCacheValid ;     // Which of the otpCache[] words below have been read, one bit per OTP_CACHE_xxx slot
+    uint32      otpCache[6] ;       // OTP words used by dwt_initialise, read once and reused by later initialisations
+    uint8       shadowValid ;       // Which of the shadowReg[] registers below are valid, one bit per DWT_SHADOW_xxx slot
+    uint32      shadowReg[4] ;      // Write-through copies of configuration registers only the driver changes
 } dwt_local_data_t ;
 
+// Bits of dwt_local_data_t.cacheValid
+#define DWT_CACHE_CONFIG    0x1
+#define DWT_CACHE_TXRF      0x2
+#define DWT_CACHE_TXANTD    0x4
+#define DWT_CACHE_RXANTD    0x8
+
+// Slots of dwt_local_data_t.shadowReg[]
+#define DWT_SHADOW_SYS_MASK     0   // SYS_MASK_ID, interrupt mask
+#define DWT_SHADOW_ACK_RESP_T   1   // ACK_RESP_T_ID, wait for response time and ACK time
+#define DWT_SHADOW_GPIO_MODE    2   // GPIO_CTRL_ID:GPIO_MODE_OFFSET, GPIO/LED/LNA/PA pin modes
+#define DWT_SHADOW_PMSC_CTRL1   3   // PMSC_ID:PMSC_CTRL1_OFFSET, LDE run and auto sleep bits
+
 static dwt_local_data_t dw1000local[DWT_NUM_DW_DEV] ; // Static local device data, can be an array to support multiple DW1000 testing applications/platforms
+#if DWT_NUM_DW_DEV > 1
+// Local data of the device the calling thread is bound to, see dwt_setlocaldataptr()
+#define pdw1000local (&dw1000local[deca_getdevice()])
+#else
 static dwt_local_data_t *pdw1000local = dw1000local ; // Static local data structure pointer
+#endif
 
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -107,6 +142,8 @@ int32 dwt_apiversion(void)
  * @fn dwt_setlocaldataptr()
  *
  * @brief This function sets the local data structure pointer to point to the element in the local array as given by the index.
+ * When DWT_NUM_DW_DEV > 1 the selection is made through deca_setdevice() and is per thread: it also selects the SPI and
+ * IRQ bindings of the platform for that device, so each device can be driven from its own thread without locking.
  *
  * input parameters
  * @param index    - selects the array element to point to. Must be within the array bounds, i.e. < DWT_NUM_DW_DEV
@@ -123,7 +160,11 @@ int dwt_setlocaldataptr(unsigned int index)
         return DWT_ERROR ;
     }
 
+#if DWT_NUM_DW_DEV > 1
+    deca_setdevice(index);
+#else
     pdw1000local = &dw1000local[index];
+#endif
 
     return DWT_SUCCESS ;
 }
@@ -146,7 +187,11 @@ int dwt_setlocaldataptr(unsigned int index)
  * 1. When DW1000 is powered on this function needs to be run before dwt_configuresleep,
  *    also the SPI frequency has to be < 3MHz
  * 2. It reads and applies LDO tune and crystal trim values from OTP memory
+ *    The OTP values are only read on the first call, later calls reuse the copy kept in dw1000local[]
+ *    (see dwt_clearotpcache())
  * 3. If accurate RX timestamping is needed microcode/LDE must be loaded
+ * 4. The configuration registers shadowed in dw1000local[] (interrupt mask, GPIO mode, ACK_RESP_T, PMSC_CTRL1) are read
+ *    again after each call, as after dwt_softreset() and dwt_entersleep()
  *
  * input parameters
  * @param config    -   specifies what configuration to load
@@ -170,6 +215,107 @@ int dwt_setlocaldataptr(unsigned int index)
 #define VTEMP_ADDRESS  (0x09)
 #define XTRIM_ADDRESS  (0x1E)
 
+// OTP words kept in dwt_local_data_t.otpCache[], indexed by slot
+static const uint16 otp_cache_address[] = {LDOTUNE_ADDRESS, PARTID_ADDRESS, LOTID_ADDRESS, VBAT_ADDRESS, VTEMP_ADDRESS, XTRIM_ADDRESS};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_otpreadcached()
+ *
+ * @brief This function returns an OTP word used during initialisation. The OTP is only read the first time (each read
+ *        is a multi-step sequence), later initialisations of the same device reuse the local copy.
+ *
+ * input parameters
+ * @param address - one of the OTP addresses above
+ *
+ * output parameters
+ *
+ * returns the 32bit OTP value
+ */
+static uint32 _dwt_otpreadcached(uint16 address)
+{
+    uint8 slot;
+
+    for(slot = 0; slot < (sizeof(otp_cache_address) / sizeof(otp_cache_address[0])); slot++)
+    {
+        if(otp_cache_address[slot] == address)
+        {
+            if(!(pdw1000local->otpCacheValid & (1 << slot)))
+            {
+                pdw1000local->otpCache[slot] = _dwt_otpread(address);
+                pdw1000local->otpCacheValid |= (1 << slot);
+            }
+            return pdw1000local->otpCache[slot];
+        }
+    }
+
+    return _dwt_otpread(address);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_clearotpcache()
+ *
+ * @brief This function discards the OTP values cached by dwt_initialise(), so that the next initialisation reads them
+ *        from the OTP again (e.g. when the local data is reused for another DW1000).
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_clearotpcache(void)
+{
+    pdw1000local->otpCacheValid = 0;
+}
+
+// Register file and sub-address of each DWT_SHADOW_xxx slot
+static const uint16 shadow_reg_id[] = {SYS_MASK_ID, ACK_RESP_T_ID, GPIO_CTRL_ID, PMSC_ID};
+static const uint16 shadow_reg_offset[] = {0, 0, GPIO_MODE_OFFSET, PMSC_CTRL1_OFFSET};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_shadowread()
+ *
+ * @brief This function returns the value of a shadowed configuration register. The register is only read the first
+ *        time after an initialisation, reset or sleep, later calls return the local copy kept by _dwt_shadowwrite().
+ *
+ * input parameters
+ * @param slot - one of the DWT_SHADOW_xxx slots
+ *
+ * output parameters
+ *
+ * returns the 32bit register value
+ */
+static uint32 _dwt_shadowread(uint8 slot)
+{
+    if(!(pdw1000local->shadowValid & (1 << slot)))
+    {
+        pdw1000local->shadowReg[slot] = dwt_read32bitoffsetreg(shadow_reg_id[slot], shadow_reg_offset[slot]);
+        pdw1000local->shadowValid |= (1 << slot);
+    }
+    return pdw1000local->shadowReg[slot];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_shadowwrite()
+ *
+ * @brief This function writes a shadowed configuration register and keeps the local copy, so that a read-modify-write
+ *        of the register is a single SPI write once the copy is valid.
+ *
+ * input parameters
+ * @param slot  - one of the DWT_SHADOW_xxx slots
+ * @param value - 32bit register value
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_shadowwrite(uint8 slot, uint32 value)
+{
+    dwt_write32bitoffsetreg(shadow_reg_id[slot], shadow_reg_offset[slot], value);
+    pdw1000local->shadowReg[slot] = value;
+    pdw1000local->shadowValid |= (1 << slot);
+}
+
 int dwt_initialise(int config)
 {
     uint16 otp_xtaltrim_and_rev = 0;
@@ -178,12 +324,19 @@ int dwt_initialise(int config)
     pdw1000local->dblbuffon = 0; // - set to 0 - meaning double buffer mode is off by default
     pdw1000local->wait4resp = 0; // - set to 0 - meaning wait for response not active
     pdw1000local->sleep_mode = 0; // - set to 0 - meaning sleep mode has not been configured
+    pdw1000local->rxPrefixLen = FCTRL_LEN_MAX; // - dwt_fastisr() reads the frame control only by default
+    pdw1000local->shadowValid = 0; // - register shadows are reloaded, the device may have been reset or woken up
 
     pdw1000local->cbTxDone = NULL;
     pdw1000local->cbRxOk = NULL;
     pdw1000local->cbRxTo = NULL;
     pdw1000local->cbRxErr = NULL;
 
+    if(!(DWT_DW_WAKE_UP & config)) // Keep the configuration cache for dwt_restoreconfig() across a wake up
+    {
+        pdw1000local->cacheValid = 0;
+    }
+
 #if DWT_API_ERROR_CHECK
     pdw1000local->otp_mask = config ; // Save the READ_OTP config mask
 #endif
@@ -213,7 +366,7 @@ int dwt_initialise(int config)
     if(!(DWT_DW_WAKE_UP & config))
     {
         // Load LDO tune from OTP and kick it if there is a value actually programmed.
-        ldo_tune = _dwt_otpread(LDOTUNE_ADDRESS);
+        ldo_tune = _dwt_otpreadcached(LDOTUNE_ADDRESS);
         if((ldo_tune & 0xFF) != 0)
         {
             // Kick LDO tune
@@ -230,7 +383,7 @@ int dwt_initialise(int config)
     if((!(DWT_DW_WAKE_UP & config)) || ((DWT_DW_WAKE_UP & config) && (DWT_DW_WUP_RD_OTPREV & config)))
     {
         // Read OTP revision number
-        otp_xtaltrim_and_rev = _dwt_otpread(XTRIM_ADDRESS) & 0xffff;        // Read 32 bit value, XTAL trim val is in low octet-0 (5 bits)
+        otp_xtaltrim_and_rev = _dwt_otpreadcached(XTRIM_ADDRESS) & 0xffff;        // Read 32 bit value, XTAL trim val is in low octet-0 (5 bits)
         pdw1000local->otprev = (otp_xtaltrim_and_rev >> 8) & 0xff;          // OTP revision is the next byte
     }
     else
@@ -251,7 +404,7 @@ int dwt_initialise(int config)
     if(DWT_READ_OTP_PID & config)
     {
         // Load Part from OTP
-        pdw1000local->partID = _dwt_otpread(PARTID_ADDRESS);
+        pdw1000local->partID = _dwt_otpreadcached(PARTID_ADDRESS);
     }
     else
     {
@@ -261,7 +414,7 @@ int dwt_initialise(int config)
     if(DWT_READ_OTP_LID & config)
     {
         // Load Lot ID from OTP
-        pdw1000local->lotID = _dwt_otpread(LOTID_ADDRESS);
+        pdw1000local->lotID = _dwt_otpreadcached(LOTID_ADDRESS);
     }
     else
     {
@@ -271,7 +424,7 @@ int dwt_initialise(int config)
     if(DWT_READ_OTP_BAT & config)
     {
         // Load VBAT from OTP
-        pdw1000local->vBatP = _dwt_otpread(VBAT_ADDRESS) & 0xff;
+        pdw1000local->vBatP = _dwt_otpreadcached(VBAT_ADDRESS) & 0xff;
     }
     else
     {
@@ -281,7 +434,7 @@ int dwt_initialise(int config)
     if(DWT_READ_OTP_TMP & config)
     {
         // Load TEMP from OTP
-        pdw1000local->tempP = _dwt_otpread(VTEMP_ADDRESS) & 0xff;
+        pdw1000local->tempP = _dwt_otpreadcached(VTEMP_ADDRESS) & 0xff;
     }
     else
     {
@@ -298,9 +451,7 @@ int dwt_initialise(int config)
         }
         else // Should disable the LDERUN bit enable if LDE has not been loaded
         {
-            uint16 rega = dwt_read16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET+1) ;
-            rega &= 0xFDFF ; // Clear LDERUN bit
-            dwt_write16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET+1, rega) ;
+            _dwt_shadowwrite(DWT_SHADOW_PMSC_CTRL1, _dwt_shadowread(DWT_SHADOW_PMSC_CTRL1) & ~PMSC_CTRL1_LDERUNE) ; // Clear LDERUN bit
         }
     }
     else //if DWT_DW_WUP_NO_UCODE is set then assume that the UCODE was loaded from ROM (i.e. DWT_LOADUCODE was set on power up),
@@ -386,7 +537,7 @@ void dwt_setfinegraintxseq(int enable)
  */
 void dwt_setlnapamode(int lna_pa)
 {
-    uint32 gpio_mode = dwt_read32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET);
+    uint32 gpio_mode = _dwt_shadowread(DWT_SHADOW_GPIO_MODE);
     gpio_mode &= ~(GPIO_MSGP4_MASK | GPIO_MSGP5_MASK | GPIO_MSGP6_MASK);
     if (lna_pa & DWT_LNA_ENABLE)
     {
@@ -396,7 +547,7 @@ void dwt_setlnapamode(int lna_pa)
     {
         gpio_mode |= (GPIO_PIN5_EXTTXE | GPIO_PIN4_EXTPA);
     }
-    dwt_write32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET, gpio_mode);
+    _dwt_shadowwrite(DWT_SHADOW_GPIO_MODE, gpio_mode);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -603,6 +754,8 @@ uint32 dwt_readdevid(void)
  */
 void dwt_configuretxrf(dwt_txconfig_t *config)
 {
+    pdw1000local->txCfgCache = *config;
+    pdw1000local->cacheValid |= DWT_CACHE_TXRF;
 
     // Configure RF TX PG_DELAY
     dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGDELAY_OFFSET, config->PGdly);
@@ -658,16 +811,64 @@ void dwt_configurefor64plen(int prf)
  * no return value
  */
 void dwt_configure(dwt_config_t *config)
+{
+    dwt_txn_t txn;
+
+    // Don't allow 0 - SFD timeout will always be enabled
+    if(config->sfdTO == 0)
+    {
+        config->sfdTO = DWT_SFDTOC_DEF;
+    }
+
+    dwt_compileprofile(config, NULL, &pdw1000local->profile);
+    pdw1000local->cacheValid |= DWT_CACHE_CONFIG;
+
+    dwt_txnbegin(&txn);
+    _dwt_queueprofile(&txn, &pdw1000local->profile, NULL);
+    dwt_txncommit(&txn);
+
+    // The SFD transmit pattern is initialised by the DW1000 upon a user TX request, but (due to an IC issue) it is not done for an auto-ACK TX. The
+    // SYS_CTRL write below works around this issue, by simultaneously initiating and aborting a transmission, which correctly initialises the SFD
+    // after its configuration or reconfiguration.
+    // This issue is not documented at the time of writing this code. It should be in next release of DW1000 User Manual (v2.09, from July 2016).
+    dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF); // Request TX start and TRX off at the same time
+} // end dwt_configure()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_compileprofile()
+ *
+ * @brief This function computes the register values of a configuration into a profile, without accessing the device.
+ * Profiles are meant to be compiled once at start-up, one per radio configuration used (e.g. one per hopping channel,
+ * or a long range and a high rate mode), and then switched to with dwt_applyprofile().
+ *
+ * input parameters
+ * @param config  - pointer to the configuration structure, as passed to dwt_configure()
+ * @param txrf    - pointer to the TX spectrum configuration, as passed to dwt_configuretxrf(), or NULL to leave the TX
+ *                  power and PG delay unchanged when the profile is applied
+ *
+ * output parameters
+ * @param profile - the register image
+ *
+ * no return value
+ */
+void dwt_compileprofile(const dwt_config_t *config, const dwt_txconfig_t *txrf, dwt_profile_t *profile)
 {
     uint8 nsSfd_result  = 0;
     uint8 useDWnsSFD = 0;
+#ifdef DWT_FIXED_CHAN
+    const uint8 chan = DWT_FIXED_CHAN ; // Fixed radio configuration build, the values below are folded
+    const uint8 prf = DWT_FIXED_PRF ;
+    const uint8 dataRate = DWT_FIXED_BR ;
+#else
     uint8 chan = config->chan ;
-    uint32 regval ;
-    uint16 reg16 = lde_replicaCoeff[config->rxCode];
-    uint8 prfIndex = config->prf - DWT_PRF_16M;
-    uint8 bw = ((chan == 4) || (chan == 7)) ? 1 : 0 ; // Select wide or narrow band
+    uint8 prf = config->prf ;
+    uint8 dataRate = config->dataRate ;
+#endif
 
 #ifdef DWT_API_ERROR_CHECK
+#ifdef DWT_FIXED_CHAN
+    assert((config->chan == DWT_FIXED_CHAN) && (config->prf == DWT_FIXED_PRF) && (config->dataRate == DWT_FIXED_BR));
+#endif
     assert(config->dataRate <= DWT_BR_6M8);
     assert(config->rxPAC <= DWT_PAC64);
     assert((chan >= 1) && (chan <= 7) && (chan != 6));
@@ -681,107 +882,350 @@ void dwt_configure(dwt_config_t *config)
     assert((config->phrMode == DWT_PHRMODE_STD) || (config->phrMode == DWT_PHRMODE_EXT));
 #endif
 
-    // For 110 kbps we need a special setup
-    if(DWT_BR_110K == config->dataRate)
+    memset(profile, 0, sizeof(dwt_profile_t));
+    profile->config = *config;
+    profile->config.chan = chan;
+    profile->config.prf = prf;
+    profile->config.dataRate = dataRate;
+
+    // Don't allow 0 - SFD timeout will always be enabled
+    if(profile->config.sfdTO == 0)
     {
-        pdw1000local->sysCFGreg |= SYS_CFG_RXM110K ;
-        reg16 >>= 3; // lde_replicaCoeff must be divided by 8
+        profile->config.sfdTO = DWT_SFDTOC_DEF;
     }
-    else
+
+    if(txrf != NULL)
     {
-        pdw1000local->sysCFGreg &= (~SYS_CFG_RXM110K) ;
+        profile->txrf = *txrf;
+        profile->txrfValid = 1;
     }
 
-    pdw1000local->longFrames = config->phrMode ;
-
-    pdw1000local->sysCFGreg &= ~SYS_CFG_PHR_MODE_11;
-    pdw1000local->sysCFGreg |= (SYS_CFG_PHR_MODE_11 & ((uint32)config->phrMode << SYS_CFG_PHR_MODE_SHFT));
-
-    dwt_write32bitreg(SYS_CFG_ID,pdw1000local->sysCFGreg) ;
-    // Set the lde_replicaCoeff
-    dwt_write16bitoffsetreg(LDE_IF_ID, LDE_REPC_OFFSET, reg16) ;
+    profile->ldeRepc = lde_replicaCoeff[config->rxCode];
 
-    _dwt_configlde(prfIndex);
+    // For 110 kbps we need a special setup
+    if(DWT_BR_110K == dataRate)
+    {
+        profile->sysCfg |= SYS_CFG_RXM110K ;
+        profile->ldeRepc >>= 3; // lde_replicaCoeff must be divided by 8
+    }
 
-    // Configure PLL2/RF PLL block CFG/TUNE (for a given channel)
-    dwt_write32bitoffsetreg(FS_CTRL_ID, FS_PLLCFG_OFFSET, fs_pll_cfg[chan_idx[chan]]);
-    dwt_write8bitoffsetreg(FS_CTRL_ID, FS_PLLTUNE_OFFSET, fs_pll_tune[chan_idx[chan]]);
+    profile->sysCfg |= (SYS_CFG_PHR_MODE_11 & ((uint32)config->phrMode << SYS_CFG_PHR_MODE_SHFT));
 
-    // Configure RF RX blocks (for specified channel/bandwidth)
-    dwt_write8bitoffsetreg(RF_CONF_ID, RF_RXCTRLH_OFFSET, rx_config[bw]);
+    // PLL2/RF PLL block CFG/TUNE (for a given channel)
+    profile->fsPllCfg = PARAM_FS_PLLCFG(chan);
+    profile->fsPllTune = PARAM_FS_PLLTUNE(chan);
 
-    // Configure RF TX blocks (for specified channel and PRF)
-    // Configure RF TX control
-    dwt_write32bitoffsetreg(RF_CONF_ID, RF_TXCTRL_OFFSET, tx_config[chan_idx[chan]]);
+    // RF RX blocks (for specified channel/bandwidth)
+    profile->rfRxCtrlH = PARAM_RF_RXCTRLH(chan);
 
-    // Configure the baseband parameters (for specified PRF, bit rate, PAC, and SFD settings)
-    // DTUNE0
-    dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE0b_OFFSET, sftsh[config->dataRate][config->nsSFD]);
+    // RF TX control (for specified channel and PRF)
+    profile->rfTxCtrl = PARAM_RF_TXCTRL(chan);
 
-    // DTUNE1
-    dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1a_OFFSET, dtune1[prfIndex]);
+    // Baseband parameters (for specified PRF, bit rate, PAC, and SFD settings)
+    profile->drxTune0b = PARAM_DRX_TUNE0b(dataRate, config->nsSFD);
+    profile->drxTune1a = PARAM_DRX_TUNE1a(prf);
 
-    if(config->dataRate == DWT_BR_110K)
+    if(dataRate == DWT_BR_110K)
     {
-        dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_110K);
+        profile->drxTune1b = DRX_TUNE1b_110K;
     }
     else
     {
         if(config->txPreambLength == DWT_PLEN_64)
         {
-            dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_6M8_PRE64);
-            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE64);
+            profile->drxTune1b = DRX_TUNE1b_6M8_PRE64;
+            profile->drxTune4h = DRX_TUNE4H_PRE64;
         }
         else
         {
-            dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_TUNE1b_OFFSET, DRX_TUNE1b_850K_6M8);
-            dwt_write8bitoffsetreg(DRX_CONF_ID, DRX_TUNE4H_OFFSET, DRX_TUNE4H_PRE128PLUS);
+            profile->drxTune1b = DRX_TUNE1b_850K_6M8;
+            profile->drxTune4h = DRX_TUNE4H_PRE128PLUS;
         }
     }
 
-    // DTUNE2
-    dwt_write32bitoffsetreg(DRX_CONF_ID, DRX_TUNE2_OFFSET, digital_bb_config[prfIndex][config->rxPAC]);
-
-    // DTUNE3 (SFD timeout)
-    // Don't allow 0 - SFD timeout will always be enabled
-    if(config->sfdTO == 0)
-    {
-        config->sfdTO = DWT_SFDTOC_DEF;
-    }
-    dwt_write16bitoffsetreg(DRX_CONF_ID, DRX_SFDTOC_OFFSET, config->sfdTO);
+    profile->drxTune2 = PARAM_DRX_TUNE2(prf, config->rxPAC);
 
-    // Configure AGC parameters
-    dwt_write32bitoffsetreg( AGC_CFG_STS_ID, 0xC, agc_config.lo32);
-    dwt_write16bitoffsetreg( AGC_CFG_STS_ID, 0x4, agc_config.target[prfIndex]);
+    // AGC parameters
+    profile->agcTune1 = PARAM_AGC_TUNE1(prf);
 
-    // Set (non-standard) user SFD for improved performance,
+    // (Non-standard) user SFD for improved performance
     if(config->nsSFD)
     {
-        // Write non standard (DW) SFD length
-        dwt_write8bitoffsetreg(USR_SFD_ID, 0x00, dwnsSFDlen[config->dataRate]);
+        profile->usrSfdLen = PARAM_DW_NS_SFD_LEN(dataRate);
         nsSfd_result = 3 ;
         useDWnsSFD = 1 ;
     }
-    regval =  (CHAN_CTRL_TX_CHAN_MASK & (chan << CHAN_CTRL_TX_CHAN_SHIFT)) | // Transmit Channel
+    profile->chanCtrl = (CHAN_CTRL_TX_CHAN_MASK & (chan << CHAN_CTRL_TX_CHAN_SHIFT)) | // Transmit Channel
               (CHAN_CTRL_RX_CHAN_MASK & (chan << CHAN_CTRL_RX_CHAN_SHIFT)) | // Receive Channel
-              (CHAN_CTRL_RXFPRF_MASK & ((uint32)config->prf << CHAN_CTRL_RXFPRF_SHIFT)) | // RX PRF
+              (CHAN_CTRL_RXFPRF_MASK & ((uint32)prf << CHAN_CTRL_RXFPRF_SHIFT)) | // RX PRF
               ((CHAN_CTRL_TNSSFD|CHAN_CTRL_RNSSFD) & ((uint32)nsSfd_result << CHAN_CTRL_TNSSFD_SHIFT)) | // nsSFD enable RX&TX
               (CHAN_CTRL_DWSFD & ((uint32)useDWnsSFD << CHAN_CTRL_DWSFD_SHIFT)) | // Use DW nsSFD
               (CHAN_CTRL_TX_PCOD_MASK & ((uint32)config->txCode << CHAN_CTRL_TX_PCOD_SHIFT)) | // TX Preamble Code
               (CHAN_CTRL_RX_PCOD_MASK & ((uint32)config->rxCode << CHAN_CTRL_RX_PCOD_SHIFT)) ; // RX Preamble Code
 
-    dwt_write32bitreg(CHAN_CTRL_ID,regval) ;
+    // TX Preamble Size, PRF and Data Rate
+    profile->txFctrl = ((uint32)(config->txPreambLength | prf) << TX_FCTRL_TXPRF_SHFT) | ((uint32)dataRate << TX_FCTRL_TXBR_SHFT);
+} // end dwt_compileprofile()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_queueprofile()
+ *
+ * @brief This function queues the register writes of a profile in a register transaction (the LDE configuration is
+ * written straight away), skipping the values already written by the previous profile, and updates the local copies of
+ * SYS_CFG and TX_FCTRL. The TX spectrum configuration of the profile is left to the caller.
+ *
+ * input parameters
+ * @param txn     - the register transaction to queue the writes in
+ * @param profile - the register image to write
+ * @param prev    - the register image active in the device, or NULL to write all the registers
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_queueprofile(dwt_txn_t *txn, const dwt_profile_t *profile, const dwt_profile_t *prev)
+{
+    uint32 sysconfig = (pdw1000local->sysCFGreg & ~(SYS_CFG_RXM110K | SYS_CFG_PHR_MODE_11)) | profile->sysCfg ;
+
+// Field of the profile to be written
+#define PROFILE_WRITE(field)    ((prev == NULL) || (profile->field != prev->field))
+
+    pdw1000local->longFrames = profile->config.phrMode ;
+    pdw1000local->txFCTRL = profile->txFctrl ;
+
+    // Queue the configuration in the register transaction, consecutive sub-registers are written in a single burst
+    if((prev == NULL) || (sysconfig != pdw1000local->sysCFGreg))
+    {
+        pdw1000local->sysCFGreg = sysconfig ;
+        dwt_txnwrite32bitoffsetreg(txn, SYS_CFG_ID, 0, sysconfig) ;
+    }
+    // Set the lde_replicaCoeff
+    if(PROFILE_WRITE(ldeRepc))
+    {
+        dwt_txnwrite16bitoffsetreg(txn, LDE_IF_ID, LDE_REPC_OFFSET, profile->ldeRepc) ;
+    }
+
+    if(PROFILE_WRITE(config.prf))
+    {
+        _dwt_configlde(profile->config.prf - DWT_PRF_16M);
+    }
+
+    // Consecutive sub-registers are written together when one of them changes: skipping the others would split the
+    // burst, which costs more than the bytes saved
+
+    // Configure PLL2/RF PLL block CFG/TUNE (for a given channel)
+    if(PROFILE_WRITE(fsPllCfg) || PROFILE_WRITE(fsPllTune))
+    {
+        dwt_txnwrite32bitoffsetreg(txn, FS_CTRL_ID, FS_PLLCFG_OFFSET, profile->fsPllCfg);
+        dwt_txnwrite8bitoffsetreg(txn, FS_CTRL_ID, FS_PLLTUNE_OFFSET, profile->fsPllTune);
+    }
+
+    // Configure RF RX blocks (for specified channel/bandwidth) and RF TX blocks (for specified channel and PRF)
+    if(PROFILE_WRITE(rfRxCtrlH) || PROFILE_WRITE(rfTxCtrl))
+    {
+        dwt_txnwrite8bitoffsetreg(txn, RF_CONF_ID, RF_RXCTRLH_OFFSET, profile->rfRxCtrlH);
+        dwt_txnwrite32bitoffsetreg(txn, RF_CONF_ID, RF_TXCTRL_OFFSET, profile->rfTxCtrl);
+    }
+
+    // Configure the baseband parameters (for specified PRF, bit rate, PAC, and SFD settings), DTUNE0b to DTUNE2
+    if(PROFILE_WRITE(drxTune0b) || PROFILE_WRITE(drxTune1a) || PROFILE_WRITE(drxTune1b) || PROFILE_WRITE(drxTune2))
+    {
+        dwt_txnwrite16bitoffsetreg(txn, DRX_CONF_ID, DRX_TUNE0b_OFFSET, profile->drxTune0b);
+        dwt_txnwrite16bitoffsetreg(txn, DRX_CONF_ID, DRX_TUNE1a_OFFSET, profile->drxTune1a);
+        dwt_txnwrite16bitoffsetreg(txn, DRX_CONF_ID, DRX_TUNE1b_OFFSET, profile->drxTune1b);
+        dwt_txnwrite32bitoffsetreg(txn, DRX_CONF_ID, DRX_TUNE2_OFFSET, profile->drxTune2);
+    }
+    if((profile->config.dataRate != DWT_BR_110K) && PROFILE_WRITE(drxTune4h))
+    {
+        dwt_txnwrite8bitoffsetreg(txn, DRX_CONF_ID, DRX_TUNE4H_OFFSET, profile->drxTune4h);
+    }
+
+    // DTUNE3 (SFD timeout)
+    if(PROFILE_WRITE(config.sfdTO))
+    {
+        dwt_txnwrite16bitoffsetreg(txn, DRX_CONF_ID, DRX_SFDTOC_OFFSET, profile->config.sfdTO);
+    }
+
+    // Configure AGC parameters
+    if(prev == NULL)
+    {
+        dwt_txnwrite32bitoffsetreg(txn, AGC_CFG_STS_ID, 0xC, agc_config.lo32);
+    }
+    if(PROFILE_WRITE(agcTune1))
+    {
+        dwt_txnwrite16bitoffsetreg(txn, AGC_CFG_STS_ID, 0x4, profile->agcTune1);
+    }
+
+    // Set (non-standard) user SFD for improved performance
+    if(profile->config.nsSFD && PROFILE_WRITE(usrSfdLen))
+    {
+        // Write non standard (DW) SFD length
+        dwt_txnwrite8bitoffsetreg(txn, USR_SFD_ID, 0x00, profile->usrSfdLen);
+    }
+
+    if(PROFILE_WRITE(chanCtrl))
+    {
+        dwt_txnwrite32bitoffsetreg(txn, CHAN_CTRL_ID, 0, profile->chanCtrl) ;
+    }
 
     // Set up TX Preamble Size, PRF and Data Rate
-    pdw1000local->txFCTRL = ((uint32)(config->txPreambLength | config->prf) << TX_FCTRL_TXPRF_SHFT) | ((uint32)config->dataRate << TX_FCTRL_TXBR_SHFT);
-    dwt_write32bitreg(TX_FCTRL_ID, pdw1000local->txFCTRL);
+    if(PROFILE_WRITE(txFctrl))
+    {
+        dwt_txnwrite32bitoffsetreg(txn, TX_FCTRL_ID, 0, profile->txFctrl);
+    }
 
-    // The SFD transmit pattern is initialised by the DW1000 upon a user TX request, but (due to an IC issue) it is not done for an auto-ACK TX. The
-    // SYS_CTRL write below works around this issue, by simultaneously initiating and aborting a transmission, which correctly initialises the SFD
-    // after its configuration or reconfiguration.
-    // This issue is not documented at the time of writing this code. It should be in next release of DW1000 User Manual (v2.09, from July 2016).
-    dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF); // Request TX start and TRX off at the same time
-} // end dwt_configure()
+#undef PROFILE_WRITE
+} // end _dwt_queueprofile()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_applyprofile()
+ *
+ * @brief This function applies a profile compiled by dwt_compileprofile(). Only the registers which differ from the
+ * active configuration (the last profile applied or dwt_configure() call) are written, in a single register transaction.
+ * The result is the same as dwt_configure() (and dwt_configuretxrf()) with the configuration of the profile.
+ *
+ * NOTE: the transceiver should be off (e.g. dwt_forcetrxoff()). After a wake up from DEEPSLEEP without DWT_CONFIG
+ * preservation the active configuration has to be written back with dwt_restoreconfig() first, as the comparison is
+ * made with the local copy.
+ *
+ * input parameters
+ * @param profile - the register image
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_applyprofile(const dwt_profile_t *profile)
+{
+    dwt_txn_t txn;
+
+    dwt_txnbegin(&txn);
+    _dwt_queueprofile(&txn, profile, (pdw1000local->cacheValid & DWT_CACHE_CONFIG) ? &pdw1000local->profile : NULL);
+
+    if(profile->txrfValid && (!(pdw1000local->cacheValid & DWT_CACHE_TXRF)
+                              || (profile->txrf.PGdly != pdw1000local->txCfgCache.PGdly)
+                              || (profile->txrf.power != pdw1000local->txCfgCache.power)))
+    {
+        dwt_txnwrite8bitoffsetreg(&txn, TX_CAL_ID, TC_PGDELAY_OFFSET, profile->txrf.PGdly);
+        dwt_txnwrite32bitoffsetreg(&txn, TX_POWER_ID, 0, profile->txrf.power);
+        pdw1000local->txCfgCache = profile->txrf;
+        pdw1000local->cacheValid |= DWT_CACHE_TXRF;
+    }
+
+    if(profile != &pdw1000local->profile)
+    {
+        pdw1000local->profile = *profile;
+    }
+    pdw1000local->cacheValid |= DWT_CACHE_CONFIG;
+
+    if(txn.count == 0) // Profile already active
+    {
+        return DWT_SUCCESS;
+    }
+
+    if(dwt_txncommit(&txn) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    // SFD initialisation work-around, see dwt_configure()
+    dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF);
+
+    return DWT_SUCCESS;
+} // end dwt_applyprofile()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getpreamblesyms() / dwt_getsymbolns() / dwt_getpreambleus()
+ *
+ * @brief These functions give the preamble length in symbols of a DWT_PLEN_xxx setting, the preamble symbol duration at
+ * a PRF and the preamble duration of a configuration, without accessing the device.
+ *
+ * input parameters
+ * @param txPreambLength - DWT_PLEN_64 to DWT_PLEN_4096
+ * @param prf            - DWT_PRF_16M or DWT_PRF_64M
+ * @param config         - pointer to the configuration structure, as passed to dwt_configure()
+ *
+ * output parameters
+ *
+ * returns the symbols, 0 for an unknown setting / the symbol duration in ns / the preamble duration in us
+ */
+uint16 dwt_getpreamblesyms(uint8 txPreambLength)
+{
+    switch (txPreambLength)
+    {
+    case DWT_PLEN_64:   return 64;
+    case DWT_PLEN_128:  return 128;
+    case DWT_PLEN_256:  return 256;
+    case DWT_PLEN_512:  return 512;
+    case DWT_PLEN_1024: return 1024;
+    case DWT_PLEN_1536: return 1536;
+    case DWT_PLEN_2048: return 2048;
+    case DWT_PLEN_4096: return 4096;
+    default:            return 0;
+    }
+} // end dwt_getpreamblesyms()
+
+uint16 dwt_getsymbolns(uint8 prf)
+{
+    // Symbol: 993.59 ns at 16 MHz PRF, 1017.63 ns at 64 MHz
+    return (prf == DWT_PRF_16M) ? 994 : 1018;
+} // end dwt_getsymbolns()
+
+uint32 dwt_getpreambleus(const dwt_config_t *config)
+{
+    return (uint32)dwt_getpreamblesyms(config->txPreambLength) * dwt_getsymbolns(config->prf) / 1000;
+} // end dwt_getpreambleus()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_restoreconfig()
+ *
+ * @brief This function writes back the configuration last applied with dwt_configure(), dwt_configuretxrf(),
+ * dwt_settxantennadelay() and dwt_setrxantennadelay() in a single register transaction. It is meant for a wake up from
+ * DEEPSLEEP without configuration preservation (or after a reset): the settings are replayed from the local copy
+ * instead of being recomputed by the application.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if dwt_configure() has not been called yet
+ */
+int dwt_restoreconfig(void)
+{
+    dwt_txn_t txn;
+
+    if(!(pdw1000local->cacheValid & DWT_CACHE_CONFIG))
+    {
+        return DWT_ERROR;
+    }
+
+    dwt_txnbegin(&txn);
+    _dwt_queueprofile(&txn, &pdw1000local->profile, NULL);
+
+    if(pdw1000local->cacheValid & DWT_CACHE_TXRF)
+    {
+        dwt_txnwrite8bitoffsetreg(&txn, TX_CAL_ID, TC_PGDELAY_OFFSET, pdw1000local->txCfgCache.PGdly);
+        dwt_txnwrite32bitoffsetreg(&txn, TX_POWER_ID, 0, pdw1000local->txCfgCache.power);
+    }
+    if(pdw1000local->cacheValid & DWT_CACHE_TXANTD)
+    {
+        dwt_txnwrite16bitoffsetreg(&txn, TX_ANTD_ID, TX_ANTD_OFFSET, pdw1000local->txAntDlyCache);
+    }
+    if(pdw1000local->cacheValid & DWT_CACHE_RXANTD)
+    {
+        dwt_txnwrite16bitoffsetreg(&txn, LDE_IF_ID, LDE_RXANTD_OFFSET, pdw1000local->rxAntDlyCache);
+    }
+
+    if(dwt_txncommit(&txn) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    // SFD initialisation work-around, see dwt_configure()
+    dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_OFFSET, SYS_CTRL_TXSTRT | SYS_CTRL_TRXOFF);
+
+    return DWT_SUCCESS;
+} // end dwt_restoreconfig()
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_setrxantennadelay()
@@ -798,6 +1242,9 @@ void dwt_configure(dwt_config_t *config)
  */
 void dwt_setrxantennadelay(uint16 rxDelay)
 {
+    pdw1000local->rxAntDlyCache = rxDelay;
+    pdw1000local->cacheValid |= DWT_CACHE_RXANTD;
+
     // Set the RX antenna delay for auto TX timestamp adjustment
     dwt_write16bitoffsetreg(LDE_IF_ID, LDE_RXANTD_OFFSET, rxDelay);
 }
@@ -817,6 +1264,9 @@ void dwt_setrxantennadelay(uint16 rxDelay)
  */
 void dwt_settxantennadelay(uint16 txDelay)
 {
+    pdw1000local->txAntDlyCache = txDelay;
+    pdw1000local->cacheValid |= DWT_CACHE_TXANTD;
+
     // Set the TX antenna delay for auto TX timestamp adjustment
     dwt_write16bitoffsetreg(TX_ANTD_ID, TX_ANTD_OFFSET, txDelay);
 }
@@ -893,14 +1343,117 @@ void dwt_writetxfctrl(uint16 txFrameLength, uint16 txBufferOffset, int ranging)
     dwt_write32bitreg(TX_FCTRL_ID, reg32);
 } // end dwt_writetxfctrl()
 
-
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_readrxdata()
+ * @fn dwt_loadtxtemplate()
  *
- * @brief This is used to read the data from the RX buffer, from an offset location give by offset parameter
+ * @brief This API function writes a whole frame to the TX buffer, to be sent several times with only some of its
+ * fields changed by dwt_patchtxtemplate().
  *
  * input parameters
- * @param buffer - the buffer into which the data will be read
+ * @param tpl            - the template, filled in
+ * @param txFrameLength  - the total frame length, including the two byte CRC
+ * @param txFrameBytes   - the initial frame content
+ * @param txBufferOffset - offset of the frame in the TX buffer
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the frame does not fit in the TX buffer
+ */
+int dwt_loadtxtemplate(dwt_txtemplate_t *tpl, uint16 txFrameLength, uint8 *txFrameBytes, uint16 txBufferOffset)
+{
+    if ((txFrameLength < 2) || (dwt_writetxdata(txFrameLength, txFrameBytes, txBufferOffset) != DWT_SUCCESS))
+    {
+        return DWT_ERROR;
+    }
+
+    tpl->offset = txBufferOffset;
+    tpl->length = txFrameLength;
+
+    return DWT_SUCCESS;
+} // end dwt_loadtxtemplate()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_patchtxtemplate()
+ *
+ * @brief This API function rewrites a field of a frame loaded with dwt_loadtxtemplate()
+ *
+ * input parameters
+ * @param tpl         - the template
+ * @param fieldOffset - offset of the field in the frame
+ * @param length      - field length
+ * @param fieldBytes  - new field content
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the field is outside the frame
+ */
+int dwt_patchtxtemplate(const dwt_txtemplate_t *tpl, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes)
+{
+    // The CRC is generated by the IC, it is not part of the template
+    if ((fieldOffset + length) > (tpl->length - 2))
+    {
+        return DWT_ERROR;
+    }
+
+    dwt_writetodevice(TX_BUFFER_ID, tpl->offset + fieldOffset, length, fieldBytes);
+
+    return DWT_SUCCESS;
+} // end dwt_patchtxtemplate()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnpatchtxtemplate()
+ *
+ * @brief This API function queues the rewrite of a field of a frame loaded with dwt_loadtxtemplate() in a register
+ * transaction
+ *
+ * input parameters
+ * @param txn         - the transaction
+ * @param tpl         - the template
+ * @param fieldOffset - offset of the field in the frame
+ * @param length      - field length
+ * @param fieldBytes  - new field content
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the field is outside the frame or the transaction is full
+ */
+int dwt_txnpatchtxtemplate(dwt_txn_t *txn, const dwt_txtemplate_t *tpl, uint16 fieldOffset, uint16 length,
+                           const uint8 *fieldBytes)
+{
+    if ((fieldOffset + length) > (tpl->length - 2))
+    {
+        return DWT_ERROR;
+    }
+
+    return dwt_txnwrite(txn, TX_BUFFER_ID, tpl->offset + fieldOffset, length, fieldBytes);
+} // end dwt_txnpatchtxtemplate()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_selecttxtemplate()
+ *
+ * @brief This API function sets the TX frame control register for the next transmission to send the template
+ *
+ * input parameters
+ * @param tpl     - the template
+ * @param ranging - 1 if this is a ranging frame, else 0
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_selecttxtemplate(const dwt_txtemplate_t *tpl, int ranging)
+{
+    dwt_writetxfctrl(tpl->length, tpl->offset, ranging);
+} // end dwt_selecttxtemplate()
+
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_readrxdata()
+ *
+ * @brief This is used to read the data from the RX buffer, from an offset location give by offset parameter
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read
  * @param length - the length of data to read (in bytes)
  * @param rxBufferOffset - the offset in the rx buffer from which to read the data
  *
@@ -1139,53 +1692,97 @@ void dwt_readsystime(uint8 * timestamp)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_writetodevice()
+ * @fn dwt_configextsync()
  *
- * @brief  this function is used to write to the DW1000 device registers
+ * @brief This is used to let the SYNC input act on the DW1000, e.g. to align the system time of anchors wired to one
+ *        SYNC line. The SYNC edge is sampled on the 38.4 MHz reference clock, so devices that must act on the same
+ *        edge should share that clock too. The mode holds until the next call, a reset or DEEPSLEEP: call it again
+ *        to act on another edge.
+ *
+ * input parameters
+ * @param mode - DWT_EXTSYNC_OFF, DWT_EXTSYNC_TXSYNC, DWT_EXTSYNC_RXCAPT or DWT_EXTSYNC_TBRESET
+ * @param wait - 38.4 MHz clock cycles from the SYNC edge to the TX or the timebase reset
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configextsync(uint16 mode, uint8 wait)
+{
+    uint32 reg = (mode & (EC_CTRL_OSTSM | EC_CTRL_OSRSM | EC_CTRL_OSTRM)) | (((uint32)wait << 3) & EC_CTRL_WAIT_MASK);
+
+    // Keep the PLL lock detect set by dwt_initialise()
+    dwt_write16bitoffsetreg(EXT_SYNC_ID, EC_CTRL_OFFSET, (uint16)(reg | EC_CTRL_PLLLCK));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_readextsynccapture()
+ *
+ * @brief This is used to read the RMARKER of the last frame received against the SYNC edge, in DWT_EXTSYNC_RXCAPT
+ *        mode: whole 38.4 MHz clock cycles from the SYNC edge, and the time from the RMARKER to the next edge of that
+ *        clock. Both are read in one SPI transaction.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param golp - 1 GHz counts from the RMARKER to the next 38.4 MHz clock edge, 0 to 63, can be NULL
+ *
+ * returns the 38.4 MHz cycles from the SYNC edge to the RMARKER
+ */
+uint32 dwt_readextsynccapture(uint8 *golp)
+{
+    uint8 buf[EC_RXTC_LEN + 1];
+
+    // EC_RXTC and the low byte of EC_GOLP follow each other
+    dwt_readfromdevice(EXT_SYNC_ID, EC_RXTC_OFFSET, sizeof(buf), buf);
+    if (golp != NULL)
+    {
+        *golp = buf[EC_RXTC_LEN] & EC_GOLP_MASK;
+    }
+
+    return ((uint32)buf[3] << 24) | ((uint32)buf[2] << 16) | ((uint32)buf[1] << 8) | buf[0];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_composeheader()
+ *
+ * @brief  this function is used to compose the SPI transaction header for a register access
  * Notes:
- *        1. Firstly we create a header (the first byte is a header byte)
  *        a. check if sub index is used, if subindexing is used - set bit-6 to 1 to signify that the sub-index address follows the register index byte
  *        b. set bit-7 (or with 0x80) for write operation
  *        c. if extended sub address index is used (i.e. if index > 127) set bit-7 of the first sub-index byte following the first header byte
  *
- *        2. Write the header followed by the data bytes to the DW1000 device
- *
- *
  * input parameters:
+ * @param header        - buffer of at least 3 bytes in which the header is composed
+ * @param rw            - 0x80 for a WRITE operation, 0x00 for a READ operation
  * @param recordNumber  - ID of register file or buffer being accessed
  * @param index         - byte index into register file or buffer being accessed
- * @param length        - number of bytes being written
- * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ * @param length        - number of bytes being accessed
  *
  * output parameters
  *
- * no return value
+ * returns the length of the header (one to three bytes)
  */
-void dwt_writetodevice
-(
-    uint16  recordNumber,
-    uint16  index,
-    uint32        length,
-    const uint8   *buffer
-)
+static int _dwt_composeheader(uint8 *header, uint8 rw, uint16 recordNumber, uint16 index, uint32 length)
 {
-    uint8 header[3] ; // Buffer to compose header in
     int   cnt = 0; // Counter for length of header
 #ifdef DWT_API_ERROR_CHECK
     assert(recordNumber <= 0x3F); // Record number is limited to 6-bits.
+#else
+    (void)length;
 #endif
 
-    // Write message header selecting WRITE operation and addresses as appropriate (this is one to three bytes long)
+    // Message header selecting operation and addresses as appropriate (this is one to three bytes long)
     if (index == 0) // For index of 0, no sub-index is required
     {
-        header[cnt++] = 0x80 | recordNumber ; // Bit-7 is WRITE operation, bit-6 zero=NO sub-addressing, bits 5-0 is reg file id
+        header[cnt++] = rw | (uint8)recordNumber ; // Bit-7 is operation, bit-6 zero=NO sub-addressing, bits 5-0 is reg file id
     }
     else
     {
 #ifdef DWT_API_ERROR_CHECK
         assert((index <= 0x7FFF) && ((index + length) <= 0x7FFF)); // Index and sub-addressable area are limited to 15-bits.
 #endif
-        header[cnt++] = 0xC0 | recordNumber ; // Bit-7 is WRITE operation, bit-6 one=sub-address follows, bits 5-0 is reg file id
+        header[cnt++] = rw | 0x40 | (uint8)recordNumber ; // Bit-7 is operation, bit-6 one=sub-address follows, bits 5-0 is reg file id
 
         if (index <= 127) // For non-zero index < 127, just a single sub-index byte is required
         {
@@ -1198,6 +1795,45 @@ void dwt_writetodevice
         }
     }
 
+    return cnt;
+} // end _dwt_composeheader()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writetodevice()
+ *
+ * @brief  this function is used to write to the DW1000 device registers
+ * Notes:
+ *        1. Firstly we create a header (the first byte is a header byte)
+ *        a. check if sub index is used, if subindexing is used - set bit-6 to 1 to signify that the sub-index address follows the register index byte
+ *        b. set bit-7 (or with 0x80) for write operation
+ *        c. if extended sub address index is used (i.e. if index > 127) set bit-7 of the first sub-index byte following the first header byte
+ *
+ *        2. Write the header followed by the data bytes to the DW1000 device
+ *
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being written
+ * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_writetodevice
+(
+    uint16  recordNumber,
+    uint16  index,
+    uint32        length,
+    const uint8   *buffer
+)
+{
+    uint8 header[3] ; // Buffer to compose header in
+    int   cnt; // Counter for length of header
+
+    cnt = _dwt_composeheader(header, 0x80, recordNumber, index, length);
+
     // Write it to the SPI
     writetospi(cnt,header,length,buffer);
 } // end dwt_writetodevice()
@@ -1234,186 +1870,464 @@ void dwt_readfromdevice
 )
 {
     uint8 header[3] ; // Buffer to compose header in
-    int   cnt = 0; // Counter for length of header
-#ifdef DWT_API_ERROR_CHECK
-    assert(recordNumber <= 0x3F); // Record number is limited to 6-bits.
-#endif
+    int   cnt; // Counter for length of header
 
-    // Write message header selecting READ operation and addresses as appropriate (this is one to three bytes long)
-    if (index == 0) // For index of 0, no sub-index is required
+    cnt = _dwt_composeheader(header, 0x00, recordNumber, index, length);
+
+    // Do the read from the SPI
+    readfromspi(cnt, header, length, buffer);  // result is stored in the buffer
+} // end dwt_readfromdevice()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writetodevice_async()
+ *
+ * @brief  this function is used to write to the DW1000 device registers without waiting for the SPI transfer to end.
+ *         The header is composed on the stack, the SPI layer copies it once it has claimed the transfer.
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being written
+ * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR if it could not be
+ */
+int dwt_writetodevice_async(uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer, dwt_spi_cb_t cb, void *arg)
+{
+    uint8 header[3] ; // Buffer to compose header in
+    int   cnt; // Counter for length of header
+
+    cnt = _dwt_composeheader(header, 0x80, recordNumber, index, length);
+
+    return writetospi_async(cnt, header, length, buffer, cb, arg);
+} // end dwt_writetodevice_async()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_readfromdevice_async()
+ *
+ * @brief  this function is used to read from the DW1000 device registers without waiting for the SPI transfer to end.
+ *         The header is composed on the stack, the SPI layer copies it once it has claimed the transfer.
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being read
+ * @param buffer        - pointer to buffer in which to return the read data.
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR if it could not be
+ */
+int dwt_readfromdevice_async(uint16 recordNumber, uint16 index, uint32 length, uint8 *buffer, dwt_spi_cb_t cb, void *arg)
+{
+    uint8 header[3] ; // Buffer to compose header in
+    int   cnt; // Counter for length of header
+
+    cnt = _dwt_composeheader(header, 0x00, recordNumber, index, length);
+
+    return readfromspi_async(cnt, header, length, buffer, cb, arg);
+} // end dwt_readfromdevice_async()
+
+
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_read32bitoffsetreg()
+ *
+ * @brief  this function is used to read 32-bit value from the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 32 bit register value
+ */
+uint32 dwt_read32bitoffsetreg(int regFileID, int regOffset)
+{
+    uint32  regval = 0 ;
+    int     j ;
+    uint8   buffer[4] ;
+
+    dwt_readfromdevice(regFileID,regOffset,4,buffer); // Read 4 bytes (32-bits) register into buffer
+
+    for (j = 3 ; j >= 0 ; j --)
     {
-        header[cnt++] = (uint8) recordNumber ; // Bit-7 zero is READ operation, bit-6 zero=NO sub-addressing, bits 5-0 is reg file id
+        regval = (regval << 8) + buffer[j] ;
     }
-    else
+    return regval ;
+
+} // end dwt_read32bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_read16bitoffsetreg()
+ *
+ * @brief  this function is used to read 16-bit value from the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 16 bit register value
+ */
+uint16 dwt_read16bitoffsetreg(int regFileID, int regOffset)
+{
+    uint16  regval = 0 ;
+    uint8   buffer[2] ;
+
+    dwt_readfromdevice(regFileID,regOffset,2,buffer); // Read 2 bytes (16-bits) register into buffer
+
+    regval = ((uint16)buffer[1] << 8) + buffer[0] ;
+    return regval ;
+
+} // end dwt_read16bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_read8bitoffsetreg()
+ *
+ * @brief  this function is used to read an 8-bit value from the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ *
+ * output parameters
+ *
+ * returns 8-bit register value
+ */
+uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset)
+{
+    uint8 regval;
+
+    dwt_readfromdevice(regFileID, regOffset, 1, &regval);
+
+    return regval ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_write8bitoffsetreg()
+ *
+ * @brief  this function is used to write an 8-bit value to the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval)
+{
+    dwt_writetodevice(regFileID, regOffset, 1, &regval);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_write16bitoffsetreg()
+ *
+ * @brief  this function is used to write 16-bit value to the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16 regval)
+{
+    uint8   buffer[2] ;
+
+    buffer[0] = regval & 0xFF;
+    buffer[1] = regval >> 8 ;
+
+    dwt_writetodevice(regFileID,regOffset,2,buffer);
+} // end dwt_write16bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_write32bitoffsetreg()
+ *
+ * @brief  this function is used to write 32-bit value to the DW1000 device registers
+ *
+ * input parameters:
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32 regval)
+{
+    int     j ;
+    uint8   buffer[4] ;
+
+    for ( j = 0 ; j < 4 ; j++ )
     {
-#ifdef DWT_API_ERROR_CHECK
-        assert((index <= 0x7FFF) && ((index + length) <= 0x7FFF)); // Index and sub-addressable area are limited to 15-bits.
-#endif
-        header[cnt++] = (uint8)(0x40 | recordNumber) ; // Bit-7 zero is READ operation, bit-6 one=sub-address follows, bits 5-0 is reg file id
+        buffer[j] = regval & 0xff ;
+        regval >>= 8 ;
+    }
 
-        if (index <= 127) // For non-zero index < 127, just a single sub-index byte is required
-        {
-            header[cnt++] = (uint8) index ; // Bit-7 zero means no extension, bits 6-0 is index.
-        }
-        else
+    dwt_writetodevice(regFileID,regOffset,4,buffer);
+} // end dwt_write32bitoffsetreg()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnbegin()
+ *
+ * @brief  this function is used to start a new register transaction
+ *
+ * input parameters:
+ * @param txn - the transaction to initialise
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_txnbegin(dwt_txn_t *txn)
+{
+    txn->count = 0;
+    txn->error = 0;
+    txn->dataLen = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_txnqueue()
+ *
+ * @brief  this function is used to append an access to a register transaction, merging it with the previous one when
+ *         it is of the same kind, on the same register file and continues it both on the device and in memory
+ *
+ * input parameters:
+ * @param txn       - the transaction
+ * @param write     - 1 for a write, 0 for a read
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param index     - byte index into register file or buffer being accessed
+ * @param length    - number of bytes accessed
+ * @param buffer    - data to write (already in txn->data) or buffer to read into
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
+ */
+static int _dwt_txnqueue(dwt_txn_t *txn, uint8 write, uint16 regFileID, uint16 index, uint16 length, uint8 *buffer)
+{
+    if(txn->count > 0)
+    {
+        int last = txn->count - 1;
+
+        if((txn->ops[last].write == write)
+           && (txn->ops[last].regFileID == regFileID)
+           && ((txn->ops[last].index + txn->ops[last].length) == index)
+           && ((txn->ops[last].buffer + txn->ops[last].length) == buffer))
         {
-            header[cnt++] = 0x80 | (uint8)(index) ; // Bit-7 one means extended index, bits 6-0 is low seven bits of index.
-            header[cnt++] =  (uint8) (index >> 7) ; // 8-bit value = high eight bits of index.
+            txn->ops[last].length += length;
+            return DWT_SUCCESS;
         }
     }
 
-    // Do the read from the SPI
-    readfromspi(cnt, header, length, buffer);  // result is stored in the buffer
-} // end dwt_readfromdevice()
+    if(txn->count >= DWT_TXN_MAX_OPS)
+    {
+        txn->error = 1;
+        return DWT_ERROR;
+    }
 
+    txn->ops[txn->count].write = write;
+    txn->ops[txn->count].regFileID = regFileID;
+    txn->ops[txn->count].index = index;
+    txn->ops[txn->count].length = length;
+    txn->ops[txn->count].buffer = buffer;
+    txn->count++;
 
+    return DWT_SUCCESS;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_read32bitoffsetreg()
+ * @fn dwt_txnwrite()
  *
- * @brief  this function is used to read 32-bit value from the DW1000 device registers
+ * @brief  this function is used to queue a write in a register transaction, the data is copied in the transaction
  *
  * input parameters:
+ * @param txn       - the transaction
  * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
+ * @param index     - byte index into register file or buffer being accessed
+ * @param length    - number of bytes being written
+ * @param buffer    - pointer to buffer containing the 'length' bytes to be written
  *
  * output parameters
  *
- * returns 32 bit register value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
  */
-uint32 dwt_read32bitoffsetreg(int regFileID, int regOffset)
+int dwt_txnwrite(dwt_txn_t *txn, uint16 regFileID, uint16 index, uint16 length, const uint8 *buffer)
 {
-    uint32  regval = 0 ;
-    int     j ;
-    uint8   buffer[4] ;
+    uint8 *data = &txn->data[txn->dataLen];
 
-    dwt_readfromdevice(regFileID,regOffset,4,buffer); // Read 4 bytes (32-bits) register into buffer
+    if((txn->dataLen + length) > DWT_TXN_DATA_LEN)
+    {
+        txn->error = 1;
+        return DWT_ERROR;
+    }
 
-    for (j = 3 ; j >= 0 ; j --)
+    memcpy(data, buffer, length);
+
+    if(_dwt_txnqueue(txn, 1, regFileID, index, length, data) == DWT_ERROR)
     {
-        regval = (regval << 8) + buffer[j] ;
+        return DWT_ERROR;
     }
-    return regval ;
+    txn->dataLen += length;
 
-} // end dwt_read32bitoffsetreg()
+    return DWT_SUCCESS;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_read16bitoffsetreg()
+ * @fn dwt_txnwrite8bitoffsetreg()
  *
- * @brief  this function is used to read 16-bit value from the DW1000 device registers
+ * @brief  this function is used to queue the write of an 8-bit value in a register transaction
  *
  * input parameters:
+ * @param txn       - the transaction
  * @param regFileID - ID of register file or buffer being accessed
  * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
  *
  * output parameters
  *
- * returns 16 bit register value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
  */
-uint16 dwt_read16bitoffsetreg(int regFileID, int regOffset)
+int dwt_txnwrite8bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint8 regval)
 {
-    uint16  regval = 0 ;
-    uint8   buffer[2] ;
-
-    dwt_readfromdevice(regFileID,regOffset,2,buffer); // Read 2 bytes (16-bits) register into buffer
-
-    regval = ((uint16)buffer[1] << 8) + buffer[0] ;
-    return regval ;
-
-} // end dwt_read16bitoffsetreg()
+    return dwt_txnwrite(txn, regFileID, regOffset, 1, &regval);
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_read8bitoffsetreg()
+ * @fn dwt_txnwrite16bitoffsetreg()
  *
- * @brief  this function is used to read an 8-bit value from the DW1000 device registers
+ * @brief  this function is used to queue the write of a 16-bit value in a register transaction
  *
  * input parameters:
+ * @param txn       - the transaction
  * @param regFileID - ID of register file or buffer being accessed
  * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
  *
  * output parameters
  *
- * returns 8-bit register value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
  */
-uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset)
+int dwt_txnwrite16bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint16 regval)
 {
-    uint8 regval;
+    uint8   buffer[2] ;
 
-    dwt_readfromdevice(regFileID, regOffset, 1, &regval);
+    buffer[0] = regval & 0xFF;
+    buffer[1] = regval >> 8 ;
 
-    return regval ;
+    return dwt_txnwrite(txn, regFileID, regOffset, 2, buffer);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_write8bitoffsetreg()
+ * @fn dwt_txnwrite32bitoffsetreg()
  *
- * @brief  this function is used to write an 8-bit value to the DW1000 device registers
+ * @brief  this function is used to queue the write of a 32-bit value in a register transaction
  *
  * input parameters:
+ * @param txn       - the transaction
  * @param regFileID - ID of register file or buffer being accessed
  * @param regOffset - the index into register file or buffer being accessed
  * @param regval    - the value to write
  *
  * output parameters
  *
- * no return value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
  */
-void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval)
+int dwt_txnwrite32bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint32 regval)
 {
-    dwt_writetodevice(regFileID, regOffset, 1, &regval);
+    int     j ;
+    uint8   buffer[4] ;
+
+    for ( j = 0 ; j < 4 ; j++ )
+    {
+        buffer[j] = regval & 0xff ;
+        regval >>= 8 ;
+    }
+
+    return dwt_txnwrite(txn, regFileID, regOffset, 4, buffer);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_write16bitoffsetreg()
+ * @fn dwt_txnread()
  *
- * @brief  this function is used to write 16-bit value to the DW1000 device registers
+ * @brief  this function is used to queue a read in a register transaction, the buffer is filled by dwt_txncommit()
  *
  * input parameters:
+ * @param txn       - the transaction
  * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
- * @param regval    - the value to write
+ * @param index     - byte index into register file or buffer being accessed
+ * @param length    - number of bytes being read
+ * @param buffer    - pointer to buffer in which to return the read data
  *
  * output parameters
  *
- * no return value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
  */
-void dwt_write16bitoffsetreg(int regFileID, int regOffset, uint16 regval)
+int dwt_txnread(dwt_txn_t *txn, uint16 regFileID, uint16 index, uint16 length, uint8 *buffer)
 {
-    uint8   buffer[2] ;
-
-    buffer[0] = regval & 0xFF;
-    buffer[1] = regval >> 8 ;
-
-    dwt_writetodevice(regFileID,regOffset,2,buffer);
-} // end dwt_write16bitoffsetreg()
+    return _dwt_txnqueue(txn, 0, regFileID, index, length, buffer);
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @fn dwt_write32bitoffsetreg()
+ * @fn dwt_txncommit()
  *
- * @brief  this function is used to write 32-bit value to the DW1000 device registers
+ * @brief  this function is used to perform the queued accesses of a register transaction.
+ *         Each DW1000 SPI transaction is framed by its own chip select, so the merged accesses are issued back to back
+ *         with the DW1000 interrupt masked once for the whole batch.
  *
  * input parameters:
- * @param regFileID - ID of register file or buffer being accessed
- * @param regOffset - the index into register file or buffer being accessed
- * @param regval    - the value to write
+ * @param txn - the transaction
  *
  * output parameters
  *
- * no return value
+ * returns DWT_SUCCESS for success, or DWT_ERROR if one of the queued accesses did not fit
  */
-void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32 regval)
+int dwt_txncommit(dwt_txn_t *txn)
 {
-    int     j ;
-    uint8   buffer[4] ;
+    decaIrqStatus_t stat ;
+    int i;
 
-    for ( j = 0 ; j < 4 ; j++ )
+    if(txn->error)
     {
-        buffer[j] = regval & 0xff ;
-        regval >>= 8 ;
+        return DWT_ERROR;
     }
 
-    dwt_writetodevice(regFileID,regOffset,4,buffer);
-} // end dwt_write32bitoffsetreg()
+    stat = decamutexon() ;
+
+    for(i = 0; i < txn->count; i++)
+    {
+        if(txn->ops[i].write)
+        {
+            dwt_writetodevice(txn->ops[i].regFileID, txn->ops[i].index, txn->ops[i].length, txn->ops[i].buffer);
+        }
+        else
+        {
+            dwt_readfromdevice(txn->ops[i].regFileID, txn->ops[i].index, txn->ops[i].length, txn->ops[i].buffer);
+        }
+    }
+
+    decamutexoff(stat) ;
+
+    dwt_txnbegin(txn);
+
+    return DWT_SUCCESS;
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_enableframefilter()
@@ -1437,7 +2351,7 @@ void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32 regval)
  */
 void dwt_enableframefilter(uint16 enable)
 {
-    uint32 sysconfig = SYS_CFG_MASK & dwt_read32bitreg(SYS_CFG_ID) ; // Read sysconfig register
+    uint32 sysconfig = SYS_CFG_MASK & pdw1000local->sysCFGreg ; // Local copy of sysconfig register
 
     if(enable)
     {
@@ -1802,6 +2716,9 @@ int dwt_otpwriteandverify(uint32 value, uint16 address)
 {
     int prog_ok = DWT_SUCCESS;
     int retry = 0;
+
+    dwt_clearotpcache(); // The cached OTP values may be overwritten
+
     // Firstly set the system clock to crystal
     _dwt_enableclocks(FORCE_SYS_XTI); //set system clock to XTI
 
@@ -1891,6 +2808,8 @@ void _dwt_aonarrayupload(void)
  */
 void dwt_entersleep(void)
 {
+    pdw1000local->shadowValid = 0; // Registers not kept in AON are lost in sleep
+
     // Copy config to AON - upload the new configuration
     _dwt_aonarrayupload();
 }
@@ -2061,7 +2980,7 @@ void dwt_configuresleep(uint16 mode, uint8 wake)
  */
 void dwt_entersleepaftertx(int enable)
 {
-    uint32 reg = dwt_read32bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET);
+    uint32 reg = _dwt_shadowread(DWT_SHADOW_PMSC_CTRL1);
     // Set the auto TX -> sleep bit
     if(enable)
     {
@@ -2071,7 +2990,7 @@ void dwt_entersleepaftertx(int enable)
     {
         reg &= ~(PMSC_CTRL1_ATXSLP);
     }
-    dwt_write32bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET, reg);
+    _dwt_shadowwrite(DWT_SHADOW_PMSC_CTRL1, reg);
 }
 
 
@@ -2108,6 +3027,8 @@ int dwt_spicswakeup(uint8 *buff, uint16 length)
         // Need 5ms for XTAL to start and stabilise (could wait for PLL lock IRQ status bit !!!)
         // NOTE: Polling of the STATUS register is not possible unless frequency is < 3MHz
         deca_sleep(5);
+
+        pdw1000local->shadowValid = 0; // Registers not kept in AON were lost in sleep
     }
     else
     {
@@ -2138,14 +3059,7 @@ void _dwt_configlde(int prfIndex)
 {
     dwt_write8bitoffsetreg(LDE_IF_ID, LDE_CFG1_OFFSET, LDE_PARAM1); // 8-bit configuration register
 
-    if(prfIndex)
-    {
-        dwt_write16bitoffsetreg( LDE_IF_ID, LDE_CFG2_OFFSET, (uint16) LDE_PARAM3_64); // 16-bit LDE configuration tuning register
-    }
-    else
-    {
-        dwt_write16bitoffsetreg( LDE_IF_ID, LDE_CFG2_OFFSET, (uint16) LDE_PARAM3_16);
-    }
+    dwt_write16bitoffsetreg( LDE_IF_ID, LDE_CFG2_OFFSET, (uint16) PARAM_LDE_CFG2(prfIndex + DWT_PRF_16M)); // 16-bit LDE configuration tuning register
 }
 
 
@@ -2217,9 +3131,6 @@ void dwt_loadopsettabfromotp(uint8 ops_sel)
  */
 void dwt_setsmarttxpower(int enable)
 {
-    // Config system register
-    pdw1000local->sysCFGreg = dwt_read32bitreg(SYS_CFG_ID) ; // Read sysconfig register
-
     // Disable smart power configuration
     if(enable)
     {
@@ -2250,8 +3161,12 @@ void dwt_setsmarttxpower(int enable)
  */
 void dwt_enableautoack(uint8 responseDelayTime)
 {
+    uint32 val = _dwt_shadowread(DWT_SHADOW_ACK_RESP_T) ; // Local copy of ACK_RESP_T_ID register
+
     // Set auto ACK reply delay
-    dwt_write8bitoffsetreg(ACK_RESP_T_ID, ACK_RESP_T_ACK_TIM_OFFSET, responseDelayTime); // In symbols
+    val &= ~ACK_RESP_T_ACK_TIM_MASK ;
+    val |= ((uint32)responseDelayTime << (ACK_RESP_T_ACK_TIM_OFFSET * 8)) & ACK_RESP_T_ACK_TIM_MASK ; // In symbols
+    _dwt_shadowwrite(DWT_SHADOW_ACK_RESP_T, val) ;
     // Enable auto ACK
     pdw1000local->sysCFGreg |= SYS_CFG_AUTOACK;
     dwt_write32bitreg(SYS_CFG_ID,pdw1000local->sysCFGreg) ;
@@ -2301,13 +3216,13 @@ void dwt_setdblrxbuffmode(int enable)
  */
 void dwt_setrxaftertxdelay(uint32 rxDelayTime)
 {
-    uint32 val = dwt_read32bitreg(ACK_RESP_T_ID) ; // Read ACK_RESP_T_ID register
+    uint32 val = _dwt_shadowread(DWT_SHADOW_ACK_RESP_T) ; // Local copy of ACK_RESP_T_ID register
 
     val &= ~(ACK_RESP_T_W4R_TIM_MASK) ; // Clear the timer (19:0)
 
     val |= (rxDelayTime & ACK_RESP_T_W4R_TIM_MASK) ; // In UWB microseconds (e.g. turn the receiver on 20uus after TX)
 
-    dwt_write32bitreg(ACK_RESP_T_ID, val) ;
+    _dwt_shadowwrite(DWT_SHADOW_ACK_RESP_T, val) ;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -2384,7 +3299,6 @@ void dwt_isr(void)
     if(status & SYS_STATUS_RXFCG)
     {
         uint16 finfo16;
-        uint16 len;
 
         dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_GOOD); // Clear all receive status bits
 
@@ -2393,47 +3307,173 @@ void dwt_isr(void)
         // Read frame info - Only the first two bytes of the register are used here.
         finfo16 = dwt_read16bitoffsetreg(RX_FINFO_ID, RX_FINFO_OFFSET);
 
-        // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
-        len = finfo16 & RX_FINFO_RXFL_MASK_1023;
-        if(pdw1000local->longFrames == 0)
-        {
-            len &= RX_FINFO_RXFLEN_MASK;
-        }
-        pdw1000local->cbData.datalength = len;
-
-        // Report ranging bit
-        if(finfo16 & RX_FINFO_RNG)
-        {
-            pdw1000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
-        }
+        _dwt_isrframeinfo(finfo16);
 
         // Report frame control - First bytes of the received frame.
         dwt_readfromdevice(RX_BUFFER_ID, 0, FCTRL_LEN_MAX, pdw1000local->cbData.fctrl);
 
-        // Because of a previous frame not being received properly, AAT bit can be set upon the proper reception of a frame not requesting for
-        // acknowledgement (ACK frame is not actually sent though). If the AAT bit is set, check ACK request bit in frame control to confirm (this
-        // implementation works only for IEEE802.15.4-2011 compliant frames).
-        // This issue is not documented at the time of writing this code. It should be in next release of DW1000 User Manual (v2.09, from July 2016).
-        if((status & SYS_STATUS_AAT) && ((pdw1000local->cbData.fctrl[0] & FCTRL_ACK_REQ_MASK) == 0))
-        {
-            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_AAT); // Clear AAT status bit in register
-            pdw1000local->cbData.status &= ~SYS_STATUS_AAT; // Clear AAT status bit in callback data register copy
-            pdw1000local->wait4resp = 0;
-        }
+        _dwt_isrrxgood(status);
+    }
 
-        // Call the corresponding callback if present
-        if(pdw1000local->cbRxOk != NULL)
-        {
-            pdw1000local->cbRxOk(&pdw1000local->cbData);
-        }
+    _dwt_isrevents(status);
+}
 
-        if (pdw1000local->dblbuffon)
-        {
-            // Toggle the Host side Receive Buffer Pointer
-            dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_HRBT_OFFSET, 1);
-        }
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_fastisr()
+ *
+ * @brief This is a variant of dwt_isr() where, in the RXFCG case, the status clear and the frame information, RX timestamp
+ *        and frame prefix reads are queued in a single register transaction. The timestamp and prefix are handed to the
+ *        cbRxOk callback (DWT_CB_DATA_RX_FLAG_FAST is set in rx_flags).
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_fastisr(void)
+{
+    uint32 status = pdw1000local->cbData.status = dwt_read32bitreg(SYS_STATUS_ID); // Read status register low 32bits
+
+    // Handle RX good frame event
+    if(status & SYS_STATUS_RXFCG)
+    {
+        dwt_txn_t txn;
+        uint8 finfo[2];
+
+        dwt_txnbegin(&txn);
+        dwt_txnwrite32bitoffsetreg(&txn, SYS_STATUS_ID, 0, SYS_STATUS_ALL_RX_GOOD); // Clear all receive status bits
+        dwt_txnread(&txn, RX_FINFO_ID, RX_FINFO_OFFSET, 2, finfo);
+        dwt_txnread(&txn, RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, RX_TIME_RX_STAMP_LEN, pdw1000local->cbData.rx_stamp);
+        dwt_txnread(&txn, RX_BUFFER_ID, 0, pdw1000local->rxPrefixLen, pdw1000local->rxPrefix);
+        dwt_txncommit(&txn);
+
+        pdw1000local->cbData.rx_flags = DWT_CB_DATA_RX_FLAG_FAST;
+
+        _dwt_isrframeinfo(((uint16)finfo[1] << 8) | finfo[0]);
+
+        // Report frame control and frame prefix - First bytes of the received frame.
+        pdw1000local->cbData.fctrl[0] = pdw1000local->rxPrefix[0];
+        pdw1000local->cbData.fctrl[1] = pdw1000local->rxPrefix[1];
+        pdw1000local->cbData.prefix = pdw1000local->rxPrefix;
+        pdw1000local->cbData.prefixlength = (pdw1000local->cbData.datalength < pdw1000local->rxPrefixLen) ?
+                                            pdw1000local->cbData.datalength : pdw1000local->rxPrefixLen;
+
+        _dwt_isrrxgood(status);
+    }
+
+    _dwt_isrevents(status);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setfastisrprefix()
+ *
+ * @brief This function sets the number of bytes at the start of a good frame that dwt_fastisr() reads for the RX callback.
+ *
+ * input parameters
+ * @param len - number of bytes to read, clamped to [FCTRL_LEN_MAX, DWT_RX_PREFIX_MAX]
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setfastisrprefix(uint16 len)
+{
+    if(len < FCTRL_LEN_MAX)
+    {
+        len = FCTRL_LEN_MAX;
+    }
+    else if(len > DWT_RX_PREFIX_MAX)
+    {
+        len = DWT_RX_PREFIX_MAX;
+    }
+    pdw1000local->rxPrefixLen = len;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_isrframeinfo()
+ *
+ * @brief This function fills the frame length and ranging flag of the callback data from the RX_FINFO register value
+ *
+ * input parameters
+ * @param finfo16 - the first two bytes of the RX_FINFO register
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_isrframeinfo(uint16 finfo16)
+{
+    uint16 len;
+
+    // Report frame length - Standard frame length up to 127, extended frame length up to 1023 bytes
+    len = finfo16 & RX_FINFO_RXFL_MASK_1023;
+    if(pdw1000local->longFrames == 0)
+    {
+        len &= RX_FINFO_RXFLEN_MASK;
+    }
+    pdw1000local->cbData.datalength = len;
+
+    // Report ranging bit
+    if(finfo16 & RX_FINFO_RNG)
+    {
+        pdw1000local->cbData.rx_flags |= DWT_CB_DATA_RX_FLAG_RNG;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_isrrxgood()
+ *
+ * @brief This function completes the RXFCG event processing once the frame information has been read: AAT workaround,
+ *        cbRxOk callback and RX buffer toggle in double buffering mode
+ *
+ * input parameters
+ * @param status - SYS_STATUS register value read on ISR entry
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_isrrxgood(uint32 status)
+{
+    // Because of a previous frame not being received properly, AAT bit can be set upon the proper reception of a frame not requesting for
+    // acknowledgement (ACK frame is not actually sent though). If the AAT bit is set, check ACK request bit in frame control to confirm (this
+    // implementation works only for IEEE802.15.4-2011 compliant frames).
+    // This issue is not documented at the time of writing this code. It should be in next release of DW1000 User Manual (v2.09, from July 2016).
+    if((status & SYS_STATUS_AAT) && ((pdw1000local->cbData.fctrl[0] & FCTRL_ACK_REQ_MASK) == 0))
+    {
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_AAT); // Clear AAT status bit in register
+        pdw1000local->cbData.status &= ~SYS_STATUS_AAT; // Clear AAT status bit in callback data register copy
+        pdw1000local->wait4resp = 0;
+    }
+
+    // Call the corresponding callback if present
+    if(pdw1000local->cbRxOk != NULL)
+    {
+        pdw1000local->cbRxOk(&pdw1000local->cbData);
     }
 
+    if (pdw1000local->dblbuffon)
+    {
+        // Toggle the Host side Receive Buffer Pointer
+        dwt_write8bitoffsetreg(SYS_CTRL_ID, SYS_CTRL_HRBT_OFFSET, 1);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn _dwt_isrevents()
+ *
+ * @brief This function processes the TXFRS, RX timeout and RX error events of the ISR
+ *
+ * input parameters
+ * @param status - SYS_STATUS register value read on ISR entry
+ *
+ * output parameters
+ *
+ * no return value
+ */
+static void _dwt_isrevents(uint32 status)
+{
     // Handle TX confirmation event
     if(status & SYS_STATUS_TXFRS)
     {
@@ -2590,10 +3630,10 @@ void dwt_setleds(uint8 mode)
     if (mode & DWT_LEDS_ENABLE)
     {
         // Set up MFIO for LED output.
-        reg = dwt_read32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET);
+        reg = _dwt_shadowread(DWT_SHADOW_GPIO_MODE);
         reg &= ~(GPIO_MSGP2_MASK | GPIO_MSGP3_MASK);
         reg |= (GPIO_PIN2_RXLED | GPIO_PIN3_TXLED);
-        dwt_write32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET, reg);
+        _dwt_shadowwrite(DWT_SHADOW_GPIO_MODE, reg);
 
         // Enable LP Oscillator to run from counter and turn on de-bounce clock.
         reg = dwt_read32bitoffsetreg(PMSC_ID, PMSC_CTRL0_OFFSET);
@@ -2618,9 +3658,9 @@ void dwt_setleds(uint8 mode)
     else
     {
         // Clear the GPIO bits that are used for LED control.
-        reg = dwt_read32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET);
+        reg = _dwt_shadowread(DWT_SHADOW_GPIO_MODE);
         reg &= ~(GPIO_MSGP2_MASK | GPIO_MSGP3_MASK);
-        dwt_write32bitoffsetreg(GPIO_CTRL_ID, GPIO_MODE_OFFSET, reg);
+        _dwt_shadowwrite(DWT_SHADOW_GPIO_MODE, reg);
     }
 }
 
@@ -2721,6 +3761,7 @@ void _dwt_disablesequencing(void) // Disable sequencing and go to state "INIT"
     _dwt_enableclocks(FORCE_SYS_XTI); // Set system clock to XTI
 
     dwt_write16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET, PMSC_CTRL1_PKTSEQ_DISABLE); // Disable PMSC ctrl of RF and RX clk blocks
+    pdw1000local->shadowValid &= ~(1 << DWT_SHADOW_PMSC_CTRL1); // Read PMSC_CTRL1 again on next use
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -2814,7 +3855,7 @@ void dwt_forcetrxoff(void)
     decaIrqStatus_t stat ;
     uint32 mask;
 
-    mask = dwt_read32bitreg(SYS_MASK_ID) ; // Read set interrupt mask
+    mask = _dwt_shadowread(DWT_SHADOW_SYS_MASK) ; // Local copy of set interrupt mask
 
     // Need to beware of interrupts occurring in the middle of following read modify write cycle
     // We can disable the radio, but before the status is cleared an interrupt can be set (e.g. the
@@ -2937,7 +3978,7 @@ void dwt_setsniffmode(int enable, uint8 timeOn, uint8 timeOff)
  */
 void dwt_setlowpowerlistening(int enable)
 {
-    uint32 pmsc_reg = dwt_read32bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET);
+    uint32 pmsc_reg = _dwt_shadowread(DWT_SHADOW_PMSC_CTRL1);
     if (enable)
     {
         /* Configure RX to sleep and snooze features. */
@@ -2948,7 +3989,7 @@ void dwt_setlowpowerlistening(int enable)
         /* Reset RX to sleep and snooze features. */
         pmsc_reg &= ~(PMSC_CTRL1_ARXSLP | PMSC_CTRL1_SNOZE);
     }
-    dwt_write32bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET, pmsc_reg);
+    _dwt_shadowwrite(DWT_SHADOW_PMSC_CTRL1, pmsc_reg);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -3042,29 +4083,21 @@ int dwt_rxenable(int mode)
  */
 void dwt_setrxtimeout(uint16 time)
 {
-    uint8 temp ;
-
-    temp = dwt_read8bitoffsetreg(SYS_CFG_ID, 3); // Read at offset 3 to get the upper byte only
-
     if(time > 0)
     {
         dwt_write16bitoffsetreg(RX_FWTO_ID, RX_FWTO_OFFSET, time) ;
 
-        temp |= (uint8)(SYS_CFG_RXWTOE>>24); // Shift RXWTOE mask as we read the upper byte only
         // OR in 32bit value (1 bit set), I know this is in high byte.
         pdw1000local->sysCFGreg |= SYS_CFG_RXWTOE;
-
-        dwt_write8bitoffsetreg(SYS_CFG_ID, 3, temp); // Write at offset 3 to write the upper byte only
     }
     else
     {
-        temp &= ~((uint8)(SYS_CFG_RXWTOE>>24)); // Shift RXWTOE mask as we read the upper byte only
         // AND in inverted 32bit value (1 bit clear), I know this is in high byte.
         pdw1000local->sysCFGreg &= ~(SYS_CFG_RXWTOE);
-
-        dwt_write8bitoffsetreg(SYS_CFG_ID, 3, temp); // Write at offset 3 to write the upper byte only
     }
 
+    dwt_write8bitoffsetreg(SYS_CFG_ID, 3, (uint8)(pdw1000local->sysCFGreg >> 24)); // Write at offset 3 to write the upper byte only
+
 } // end dwt_setrxtimeout()
 
 
@@ -3122,11 +4155,11 @@ void dwt_setinterrupt(uint32 bitmask, uint8 operation)
 
     if(operation == 2)
     {
-        dwt_write32bitreg(SYS_MASK_ID, bitmask) ; // New value
+        _dwt_shadowwrite(DWT_SHADOW_SYS_MASK, bitmask) ; // New value
     }
     else
     {
-        mask = dwt_read32bitreg(SYS_MASK_ID) ; // Read register
+        mask = _dwt_shadowread(DWT_SHADOW_SYS_MASK) ; // Local copy of register
         if(operation == 1)
         {
             mask |= bitmask ;
@@ -3135,7 +4168,7 @@ void dwt_setinterrupt(uint32 bitmask, uint8 operation)
         {
             mask &= ~bitmask ; // Clear the bit
         }
-        dwt_write32bitreg(SYS_MASK_ID, mask) ; // New value
+        _dwt_shadowwrite(DWT_SHADOW_SYS_MASK, mask) ; // New value
     }
 
     decamutexoff(stat) ;
@@ -3258,6 +4291,7 @@ void dwt_softreset(void)
     dwt_write8bitoffsetreg(PMSC_ID, PMSC_CTRL0_SOFTRESET_OFFSET, PMSC_CTRL0_RESET_CLEAR);
 
     pdw1000local->wait4resp = 0;
+    pdw1000local->shadowValid = 0; // Registers are back to their reset values
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -3312,6 +4346,9 @@ void dwt_configcwmode(uint8 chan)
 {
 #ifdef DWT_API_ERROR_CHECK
     assert((chan >= 1) && (chan <= 7) && (chan != 6));
+#ifdef DWT_FIXED_CHAN
+    assert(chan == DWT_FIXED_CHAN);
+#endif
 #endif
 
     //
@@ -3321,12 +4358,12 @@ void dwt_configcwmode(uint8 chan)
 
     // Config RF pll (for a given channel)
     // Configure PLL2/RF PLL block CFG/TUNE
-    dwt_write32bitoffsetreg(FS_CTRL_ID, FS_PLLCFG_OFFSET, fs_pll_cfg[chan_idx[chan]]);
-    dwt_write8bitoffsetreg(FS_CTRL_ID, FS_PLLTUNE_OFFSET, fs_pll_tune[chan_idx[chan]]);
+    dwt_write32bitoffsetreg(FS_CTRL_ID, FS_PLLCFG_OFFSET, PARAM_FS_PLLCFG(chan));
+    dwt_write8bitoffsetreg(FS_CTRL_ID, FS_PLLTUNE_OFFSET, PARAM_FS_PLLTUNE(chan));
     // PLL wont be enabled until a TX/RX enable is issued later on
     // Configure RF TX blocks (for specified channel and prf)
     // Config RF TX control
-    dwt_write32bitoffsetreg(RF_CONF_ID, RF_TXCTRL_OFFSET, tx_config[chan_idx[chan]]);
+    dwt_write32bitoffsetreg(RF_CONF_ID, RF_TXCTRL_OFFSET, PARAM_RF_TXCTRL(chan));
 
     //
     // Enable RF PLL
@@ -64,6 +64,18 @@ typedef signed long int32;
 #define DWT_NUM_DW_DEV (1)
 #endif
 
+// Fixed radio configuration build: with DWT_FIXED_CHAN, DWT_FIXED_PRF and DWT_FIXED_BR defined (CONFIG_DW1000_FIXED_PHY)
+// the configuration functions and the range bias correction only support this channel, PRF and data rate, their
+// register values are constants and the tables of the other settings are left out
+#if defined(CONFIG_DW1000_FIXED_PHY) && !defined(DWT_FIXED_CHAN)
+#define DWT_FIXED_CHAN  CONFIG_DW1000_FIXED_CHANNEL
+#define DWT_FIXED_PRF   CONFIG_DW1000_FIXED_PRF
+#define DWT_FIXED_BR    CONFIG_DW1000_FIXED_DATARATE
+#endif
+#if defined(DWT_FIXED_CHAN) && ((DWT_FIXED_CHAN < 1) || (DWT_FIXED_CHAN == 6) || (DWT_FIXED_CHAN > 7))
+#error "DWT_FIXED_CHAN: the DW1000 supports channels 1, 2, 3, 4, 5 and 7"
+#endif
+
 #define DWT_SUCCESS (0)
 #define DWT_ERROR   (-1)
 
@@ -122,6 +134,12 @@ typedef signed long int32;
 #define DWT_LEDS_ENABLE      0x01
 #define DWT_LEDS_INIT_BLINK  0x02
 
+// Defined constants for "mode" parameter passed to dwt_configextsync() function, EC_CTRL bits
+#define DWT_EXTSYNC_OFF      0x000  // SYNC input ignored
+#define DWT_EXTSYNC_TXSYNC   0x001  // transmit synchronisation: TX starts on the SYNC edge (OSTSM)
+#define DWT_EXTSYNC_RXCAPT   0x002  // receive synchronisation: RMARKER captured against the SYNC edge (OSRSM)
+#define DWT_EXTSYNC_TBRESET  0x800  // timebase reset: the system time restarts from 0 on the SYNC edge (OSTRM)
+
 // Defined constants for "lna_pa" bit field parameter passed to dwt_setlnapamode() function
 #define DWT_LNA_PA_DISABLE     0x00
 #define DWT_LNA_ENABLE         0x01
@@ -208,6 +226,9 @@ typedef signed long int32;
 
 // Call-back data RX frames flags
 #define DWT_CB_DATA_RX_FLAG_RNG 0x1 // Ranging bit
+#define DWT_CB_DATA_RX_FLAG_FAST 0x2 // rx_stamp/prefix filled in by dwt_fastisr()
+
+#define DWT_RX_PREFIX_MAX 32 // Max number of frame bytes dwt_fastisr() can hand to the RX callback
 
 // TX/RX call-back data
 typedef struct
@@ -216,11 +237,17 @@ typedef struct
     uint16 datalength;  //length of frame
     uint8  fctrl[2];    //frame control bytes
     uint8  rx_flags;    //RX frame flags, see above
+    uint8  rx_stamp[5]; //RX timestamp (40 bits, DW1000 time units), only valid with DWT_CB_DATA_RX_FLAG_FAST
+    uint16 prefixlength;//number of valid bytes in prefix, only valid with DWT_CB_DATA_RX_FLAG_FAST
+    const uint8 *prefix;//first bytes of the received frame, only valid with DWT_CB_DATA_RX_FLAG_FAST
 } dwt_cb_data_t;
 
 // Call-back type for all events
 typedef void (*dwt_cb_t)(const dwt_cb_data_t *);
 
+// Call-back type for asynchronous SPI transfer completion, status is DWT_SUCCESS or DWT_ERROR
+typedef void (*dwt_spi_cb_t)(int status, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Structure typedef: dwt_config_t
  *
@@ -241,6 +268,45 @@ typedef struct
     uint16 sfdTO ;         //!< SFD timeout value (in symbols)
 } dwt_config_t ;
 
+#define DWT_TXN_MAX_OPS     (24)    // Max number of (merged) accesses in a register transaction
+#define DWT_TXN_DATA_LEN    (128)   // Storage for the write values queued in a register transaction
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Structure typedef: dwt_txn_t
+ *
+ * Structure for batching register accesses via dwt_txnbegin()/dwt_txnwrite()/dwt_txnread()/dwt_txncommit().
+ * Accesses to consecutive bytes of the same register file are merged into a single SPI transaction.
+ *
+ */
+typedef struct
+{
+    struct
+    {
+        uint16 regFileID ;  //!< register file or buffer being accessed
+        uint16 index ;      //!< byte index into register file
+        uint16 length ;     //!< number of bytes accessed
+        uint8  write ;      //!< 1 for a write, 0 for a read
+        uint8  *buffer ;    //!< data to write (in data[] below) or buffer to read into
+    } ops[DWT_TXN_MAX_OPS] ;
+    uint8  count ;          //!< number of queued accesses
+    uint8  error ;          //!< set when an access did not fit, the commit is then refused
+    uint16 dataLen ;        //!< bytes of data[] in use
+    uint8  data[DWT_TXN_DATA_LEN] ; //!< copy of the queued write values
+} dwt_txn_t ;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Structure typedef: dwt_txtemplate_t
+ *
+ * Frame staged once in the TX buffer by dwt_loadtxtemplate(), only its changing fields are then rewritten with
+ * dwt_patchtxtemplate() before each transmission.
+ *
+ */
+typedef struct
+{
+    uint16 offset ;         //!< offset of the frame in the TX buffer
+    uint16 length ;         //!< frame length, including the 2 byte CRC
+} dwt_txtemplate_t ;
+
 
 typedef struct
 {
@@ -254,6 +320,35 @@ typedef struct
 }
 dwt_txconfig_t ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Structure typedef: dwt_profile_t
+ *
+ * Register image of a dwt_config_t (and optionally a dwt_txconfig_t) compiled by dwt_compileprofile(), written by
+ * dwt_applyprofile(). The fields are the values dwt_configure() would write.
+ *
+ */
+typedef struct
+{
+    dwt_config_t   config ;     //!< configuration the image was compiled from (sfdTO 0 replaced by DWT_SFDTOC_DEF)
+    dwt_txconfig_t txrf ;       //!< TX spectrum configuration, if txrfValid
+    uint8  txrfValid ;          //!< 1 if the profile also sets the TX power and PG delay
+    uint8  fsPllTune ;          //!< FS_CTRL:FS_PLLTUNE
+    uint8  rfRxCtrlH ;          //!< RF_CONF:RF_RXCTRLH
+    uint8  drxTune4h ;          //!< DRX_CONF:DRX_TUNE4H, not written at 110 kbps
+    uint8  usrSfdLen ;          //!< USR_SFD length, only written with the non-standard SFD
+    uint16 ldeRepc ;            //!< LDE_IF:LDE_REPC
+    uint16 drxTune0b ;          //!< DRX_CONF:DRX_TUNE0b
+    uint16 drxTune1a ;          //!< DRX_CONF:DRX_TUNE1a
+    uint16 drxTune1b ;          //!< DRX_CONF:DRX_TUNE1b
+    uint16 agcTune1 ;           //!< AGC_CFG_STS:AGC_TUNE1
+    uint32 sysCfg ;             //!< SYS_CFG bits set by the configuration (RXM110K and PHR_MODE)
+    uint32 fsPllCfg ;           //!< FS_CTRL:FS_PLLCFG
+    uint32 rfTxCtrl ;           //!< RF_CONF:RF_TXCTRL
+    uint32 drxTune2 ;           //!< DRX_CONF:DRX_TUNE2
+    uint32 chanCtrl ;           //!< CHAN_CTRL
+    uint32 txFctrl ;            //!< TX_FCTRL without the frame length
+} dwt_profile_t ;
+
 
 typedef struct
 {
@@ -563,6 +658,21 @@ int dwt_getgpiovalue(uint32 gpioNum);
  */
 int dwt_initialise(int config) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_clearotpcache()
+ *
+ * @brief This function discards the OTP values (LDO tune, XTAL trim, part/lot ID, ref voltage and temperature) that
+ *        dwt_initialise() reads on its first call and reuses afterwards, so that the next initialisation reads them again
+ *        (e.g. when the local data is reused for another DW1000).
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_clearotpcache(void);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_configurefor64plen()
  *  - Use default OPS table should be used with following register modifications:
@@ -612,6 +722,82 @@ void dwt_configure(dwt_config_t *config) ;
  */
 void dwt_configuretxrf(dwt_txconfig_t *config) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_restoreconfig()
+ *
+ * @brief This function writes back the configuration last applied with dwt_configure(), dwt_configuretxrf(),
+ * dwt_settxantennadelay() and dwt_setrxantennadelay() in a single register transaction, e.g. after a wake up from
+ * DEEPSLEEP without DWT_CONFIG preservation. Only the settings that have been applied since the last dwt_initialise()
+ * without DWT_DW_WAKE_UP are written back.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if dwt_configure() has not been called yet
+ */
+int dwt_restoreconfig(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_compileprofile()
+ *
+ * @brief This function computes the register values of a configuration into a profile, without accessing the device.
+ * Profiles are meant to be compiled once at start-up, one per radio configuration used (e.g. one per hopping channel,
+ * or a long range and a high rate mode), and then switched to with dwt_applyprofile().
+ *
+ * input parameters
+ * @param config  - pointer to the configuration structure, as passed to dwt_configure()
+ * @param txrf    - pointer to the TX spectrum configuration, as passed to dwt_configuretxrf(), or NULL to leave the TX
+ *                  power and PG delay unchanged when the profile is applied
+ *
+ * output parameters
+ * @param profile - the register image
+ *
+ * no return value
+ */
+void dwt_compileprofile(const dwt_config_t *config, const dwt_txconfig_t *txrf, dwt_profile_t *profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_applyprofile()
+ *
+ * @brief This function applies a profile compiled by dwt_compileprofile(). Only the registers which differ from the
+ * active configuration (the last profile applied or dwt_configure() call) are written, in a single register transaction.
+ * The result is the same as dwt_configure() (and dwt_configuretxrf()) with the configuration of the profile.
+ *
+ * NOTE: the transceiver should be off (e.g. dwt_forcetrxoff()). After a wake up from DEEPSLEEP without DWT_CONFIG
+ * preservation the active configuration has to be written back with dwt_restoreconfig() first, as the comparison is
+ * made with the local copy. In a fixed radio configuration build (DWT_FIXED_CHAN) profiles can only differ in the
+ * preamble, PAC, SFD, PHR mode and TX spectrum settings.
+ *
+ * input parameters
+ * @param profile - the register image
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+int dwt_applyprofile(const dwt_profile_t *profile);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getpreamblesyms() / dwt_getsymbolns() / dwt_getpreambleus()
+ *
+ * @brief These functions give the preamble length in symbols of a DWT_PLEN_xxx setting, the preamble symbol duration at
+ * a PRF (993.59 ns at 16 MHz, 1017.63 ns at 64 MHz, rounded to the ns) and the preamble duration of a configuration,
+ * without accessing the device.
+ *
+ * input parameters
+ * @param txPreambLength - DWT_PLEN_64 to DWT_PLEN_4096
+ * @param prf            - DWT_PRF_16M or DWT_PRF_64M
+ * @param config         - pointer to the configuration structure, as passed to dwt_configure()
+ *
+ * output parameters
+ *
+ * returns the symbols, 0 for an unknown setting / the symbol duration in ns / the preamble duration in us
+ */
+uint16 dwt_getpreamblesyms(uint8 txPreambLength);
+uint16 dwt_getsymbolns(uint8 prf);
+uint32 dwt_getpreambleus(const dwt_config_t *config);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_setrxantennadelay()
  *
@@ -697,6 +883,62 @@ int dwt_writetxdata(uint16 txFrameLength, uint8 *txFrameBytes, uint16 txBufferOf
  */
 void dwt_writetxfctrl(uint16 txFrameLength, uint16 txBufferOffset, int ranging);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_loadtxtemplate()
+ *
+ * @brief This API function writes a whole frame to the TX buffer, to be sent several times with only some of its
+ * fields changed by dwt_patchtxtemplate(). The TX buffer keeps its content across transmissions and receptions, but
+ * not across DEEPSLEEP, other frames sent in between must use another part of the buffer.
+ *
+ * input parameters
+ * @param tpl            - the template, filled in
+ * @param txFrameLength  - the total frame length, including the two byte CRC, see dwt_writetxdata()
+ * @param txFrameBytes   - the initial frame content
+ * @param txBufferOffset - offset of the frame in the TX buffer
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the frame does not fit in the TX buffer
+ */
+int dwt_loadtxtemplate(dwt_txtemplate_t *tpl, uint16 txFrameLength, uint8 *txFrameBytes, uint16 txBufferOffset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_patchtxtemplate()/dwt_txnpatchtxtemplate()
+ *
+ * @brief These API functions rewrite a field of a frame loaded with dwt_loadtxtemplate(), straight away or queued in
+ * a register transaction. Consecutive fields patched in the same transaction are merged into one SPI access.
+ *
+ * input parameters
+ * @param txn         - the transaction (dwt_txnpatchtxtemplate() only)
+ * @param tpl         - the template
+ * @param fieldOffset - offset of the field in the frame
+ * @param length      - field length
+ * @param fieldBytes  - new field content
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the field is outside the frame (or the transaction is full)
+ */
+int dwt_patchtxtemplate(const dwt_txtemplate_t *tpl, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes);
+int dwt_txnpatchtxtemplate(dwt_txn_t *txn, const dwt_txtemplate_t *tpl, uint16 fieldOffset, uint16 length,
+                           const uint8 *fieldBytes);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_selecttxtemplate()
+ *
+ * @brief This API function sets the TX frame control register for the next transmission to send the template, like
+ * dwt_writetxfctrl() does for a frame written with dwt_writetxdata()
+ *
+ * input parameters
+ * @param tpl     - the template
+ * @param ranging - 1 if this is a ranging frame, else 0
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_selecttxtemplate(const dwt_txtemplate_t *tpl, int ranging);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_starttx()
  *
@@ -837,6 +1079,40 @@ uint32 dwt_readsystimestamphi32(void);
  */
 void dwt_readsystime(uint8 * timestamp);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_configextsync()
+ *
+ * @brief This is used to let the SYNC input act on the DW1000, e.g. to align the system time of anchors wired to one
+ *        SYNC line. The SYNC edge is sampled on the 38.4 MHz reference clock, so devices that must act on the same
+ *        edge should share that clock too. The mode holds until the next call, a reset or DEEPSLEEP: call it again
+ *        to act on another edge.
+ *
+ * input parameters
+ * @param mode - DWT_EXTSYNC_OFF, DWT_EXTSYNC_TXSYNC, DWT_EXTSYNC_RXCAPT or DWT_EXTSYNC_TBRESET
+ * @param wait - 38.4 MHz clock cycles from the SYNC edge to the TX or the timebase reset
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_configextsync(uint16 mode, uint8 wait);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_readextsynccapture()
+ *
+ * @brief This is used to read the RMARKER of the last frame received against the SYNC edge, in DWT_EXTSYNC_RXCAPT
+ *        mode: whole 38.4 MHz clock cycles from the SYNC edge, and the time from the RMARKER to the next edge of that
+ *        clock. Both are read in one SPI transaction.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param golp - 1 GHz counts from the RMARKER to the next 38.4 MHz clock edge, 0 to 63, can be NULL
+ *
+ * returns the 38.4 MHz cycles from the SYNC edge to the RMARKER
+ */
+uint32 dwt_readextsynccapture(uint8 *golp);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_forcetrxoff()
  *
@@ -1183,6 +1459,38 @@ uint8 dwt_checkirq(void);
  */
 void dwt_isr(void);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_fastisr()
+ *
+ * @brief This is a variant of dwt_isr() for latency critical receivers (e.g. ranging responders). It processes the same
+ *        events the same way, but in the RXFCG case, the status clear and the frame information, RX timestamp and frame
+ *        prefix reads are issued back to back in a single critical section. The timestamp and the first bytes of the frame
+ *        (see dwt_setfastisrprefix()) are handed to the cbRxOk callback in the rx_stamp and prefix fields of the callback data,
+ *        so that it does not need to read them again before preparing its response.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_fastisr(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_setfastisrprefix()
+ *
+ * @brief This function sets the number of bytes at the start of a good frame that dwt_fastisr() reads for the RX callback.
+ *        It is clamped to [FCTRL length, DWT_RX_PREFIX_MAX], and to the length of the received frame by the ISR.
+ *
+ * input parameters
+ * @param len - number of bytes to read
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setfastisrprefix(uint16 len);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_isr_lplisten()
  *
@@ -1813,6 +2121,54 @@ void dwt_readfromdevice
     uint8   *buffer             // input parameter - pointer to buffer in which to return the read data.
 ) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_writetodevice_async()
+ *
+ * @brief  this function is used to write to the DW1000 device registers without waiting for the SPI transfer to end.
+ *         The header is composed as in dwt_writetodevice(), the transfer is then started and the function returns
+ *         while it runs. The callback is called from thread context once the last byte has been sent.
+ *
+ * NOTE: Only one asynchronous transfer can be in flight at a time, and the buffer must remain valid (and unchanged)
+ *       until the callback has been called.
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being written
+ * @param buffer        - pointer to buffer containing the 'length' bytes to be written
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR if it could not be (e.g. one is already in flight)
+ */
+int dwt_writetodevice_async(uint16 recordNumber, uint16 index, uint32 length, const uint8 *buffer, dwt_spi_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_readfromdevice_async()
+ *
+ * @brief  this function is used to read from the DW1000 device registers without waiting for the SPI transfer to end.
+ *         The header is composed as in dwt_readfromdevice(), the transfer is then started and the function returns
+ *         while it runs. The callback is called from thread context once the data is in the buffer.
+ *
+ * NOTE: Only one asynchronous transfer can be in flight at a time, and the buffer must not be accessed until the
+ *       callback has been called.
+ *
+ * input parameters:
+ * @param recordNumber  - ID of register file or buffer being accessed
+ * @param index         - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being read
+ * @param buffer        - pointer to buffer in which to return the read data.
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR if it could not be (e.g. one is already in flight)
+ */
+int dwt_readfromdevice_async(uint16 recordNumber, uint16 index, uint32 length, uint8 *buffer, dwt_spi_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn dwt_read32bitoffsetreg()
  *
@@ -1909,6 +2265,95 @@ uint8 dwt_read8bitoffsetreg(int regFileID, int regOffset);
  */
 void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8 regval);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnbegin()
+ *
+ * @brief  this function is used to start a new register transaction, accesses queued with dwt_txnwrite*() and
+ *         dwt_txnread() are only performed by dwt_txncommit()
+ *
+ * input parameters:
+ * @param txn - the transaction to initialise
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_txnbegin(dwt_txn_t *txn);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnwrite()
+ *
+ * @brief  this function is used to queue a write in a register transaction. The data is copied so the buffer may be
+ *         reused straight away. A write to the bytes immediately following the previous queued write of the same
+ *         register file is merged with it.
+ *
+ * input parameters:
+ * @param txn       - the transaction
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param index     - byte index into register file or buffer being accessed
+ * @param length    - number of bytes being written
+ * @param buffer    - pointer to buffer containing the 'length' bytes to be written
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
+ */
+int dwt_txnwrite(dwt_txn_t *txn, uint16 regFileID, uint16 index, uint16 length, const uint8 *buffer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnwrite8bitoffsetreg()/dwt_txnwrite16bitoffsetreg()/dwt_txnwrite32bitoffsetreg()
+ *
+ * @brief  these functions are used to queue the write of an 8, 16 or 32-bit value in a register transaction
+ *
+ * input parameters:
+ * @param txn       - the transaction
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param regOffset - the index into register file or buffer being accessed
+ * @param regval    - the value to write
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
+ */
+int dwt_txnwrite8bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint8 regval);
+int dwt_txnwrite16bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint16 regval);
+int dwt_txnwrite32bitoffsetreg(dwt_txn_t *txn, int regFileID, int regOffset, uint32 regval);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txnread()
+ *
+ * @brief  this function is used to queue a read in a register transaction, the buffer is filled by dwt_txncommit().
+ *         A read of the bytes immediately following the previous queued read of the same register file, into the
+ *         bytes immediately following its buffer, is merged with it.
+ *
+ * input parameters:
+ * @param txn       - the transaction
+ * @param regFileID - ID of register file or buffer being accessed
+ * @param index     - byte index into register file or buffer being accessed
+ * @param length    - number of bytes being read
+ * @param buffer    - pointer to buffer in which to return the read data, must stay valid until the commit
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the transaction is full
+ */
+int dwt_txnread(dwt_txn_t *txn, uint16 regFileID, uint16 index, uint16 length, uint8 *buffer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_txncommit()
+ *
+ * @brief  this function is used to perform the queued accesses of a register transaction, in the order they were
+ *         queued, back to back inside a single critical section
+ *
+ * input parameters:
+ * @param txn - the transaction
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if one of the queued accesses did not fit (nothing is then performed)
+ */
+int dwt_txncommit(dwt_txn_t *txn);
+
 
 /****************************************************************************************************************************************************
  *
@@ -1965,6 +2410,58 @@ int writetospi(uint16 headerLength, const uint8 *headerBuffer, uint32 bodylength
  */
 int readfromspi(uint16 headerLength, const uint8 *headerBuffer, uint32 readlength, uint8 *readBuffer);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn writetospi_async()
+ *
+ * @brief
+ * Low level abstract function to start a write to the SPI and return before it has completed.
+ * Takes two separate byte buffers for write header and write data. The header is copied before the function returns,
+ * the data must remain valid until the callback.
+ * The callback is called from thread context when the transfer is over.
+ * Platforms without a non-blocking SPI may complete the transfer before returning, and call the callback from there.
+ *
+ * Note: The body of this function is defined in deca_spi.c and is platform specific
+ *
+ * input parameters:
+ * @param headerLength  - number of bytes header being written
+ * @param headerBuffer  - pointer to buffer containing the 'headerLength' bytes of header to be written
+ * @param bodylength    - number of bytes data being written
+ * @param bodyBuffer    - pointer to buffer containing the 'bodylength' bytes od data to be written
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int writetospi_async(uint16 headerLength, const uint8 *headerBuffer, uint32 bodylength, const uint8 *bodyBuffer, dwt_spi_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn readfromspi_async()
+ *
+ * @brief
+ * Low level abstract function to start a read from the SPI and return before it has completed.
+ * Takes two separate byte buffers for write header and read data. The header is copied before the function returns,
+ * the read buffer must remain valid until the callback.
+ * The callback is called from thread context when the data is in readBuffer.
+ * Platforms without a non-blocking SPI may complete the transfer before returning, and call the callback from there.
+ *
+ * Note: The body of this function is defined in deca_spi.c and is platform specific
+ *
+ * input parameters:
+ * @param headerLength  - number of bytes header to write
+ * @param headerBuffer  - pointer to buffer containing the 'headerLength' bytes of header to write
+ * @param readlength    - number of bytes data being read
+ * @param readBuffer    - pointer to buffer in which to return the data
+ * @param cb            - function called on completion, may be NULL
+ * @param arg           - argument handed back to the callback
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the transfer was started, or DWT_ERROR for error
+ */
+int readfromspi_async(uint16 headerLength, const uint8 *headerBuffer, uint32 readlength, uint8 *readBuffer, dwt_spi_cb_t cb, void *arg);
+
 // ---------------------------------------------------------------------------
 //
 // NB: The purpose of the deca_mutex.c file is to provide for microprocessor interrupt enable/disable, this is used for
@@ -2030,6 +2527,36 @@ void decamutexoff(decaIrqStatus_t s) ;
  */
 void deca_sleep(unsigned int time_ms);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_setdevice()
+ *
+ * @brief Bind the calling thread to a DW1000 device. Only used when DWT_NUM_DW_DEV > 1: the driver local data, the SPI
+ * and the IRQ bindings selected by the platform all follow this index, so each device can be driven from its own thread.
+ * NB: The body of this function is defined in port.c and is platform specific
+ *
+ * input parameters:
+ * @param index - device index, < DWT_NUM_DW_DEV
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_setdevice(unsigned int index);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_getdevice()
+ *
+ * @brief Return the DW1000 device the calling thread is bound to, 0 if deca_setdevice() was never called from it.
+ * NB: The body of this function is defined in port.c and is platform specific
+ *
+ * input parameters:
+ *
+ * output parameters
+ *
+ * returns the device index
+ */
+unsigned int deca_getdevice(void);
+
 #ifdef __cplusplus
 }
 #endif
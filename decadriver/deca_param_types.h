@@ -16,6 +16,7 @@
 extern "C" {
 #endif
 #include "deca_types.h"
+#include "deca_device_api.h"
 
 #define NUM_BR 3
 #define NUM_PRF 2
@@ -34,13 +35,15 @@ typedef struct {
 
 extern const agc_cfg_struct agc_config ;
 
+#define XMLPARAMS_VERSION   (1.17f)
+
+#ifndef DWT_FIXED_CHAN
+
 //SFD threshold settings for 110k, 850k, 6.8Mb standard and non-standard
 extern const uint16 sftsh[NUM_BR][NUM_SFD];
 
 extern const uint16 dtune1[NUM_PRF];
 
-#define XMLPARAMS_VERSION   (1.17f)
-
 extern const uint32 fs_pll_cfg[NUM_CH];
 extern const uint8 fs_pll_tune[NUM_CH];
 extern const uint8 rx_config[NUM_BW];
@@ -49,6 +52,45 @@ extern const uint8 dwnsSFDlen[NUM_BR]; //length of SFD for each of the bitrates
 extern const uint32 digital_bb_config[NUM_PRF][NUM_PACS];
 extern const uint8 chan_idx[NUM_CH_SUPPORTED];
 
+// Configuration register values, looked up in the tables above (chan: channel number, prf: DWT_PRF_16M/DWT_PRF_64M,
+// br: DWT_BR_110K..DWT_BR_6M8, nssfd: 0/1, pac: DWT_PAC8..DWT_PAC64)
+#define PARAM_FS_PLLCFG(chan)           (fs_pll_cfg[chan_idx[chan]])
+#define PARAM_FS_PLLTUNE(chan)          (fs_pll_tune[chan_idx[chan]])
+#define PARAM_RF_TXCTRL(chan)           (tx_config[chan_idx[chan]])
+#define PARAM_RF_RXCTRLH(chan)          (rx_config[((chan) == 4) || ((chan) == 7)])
+#define PARAM_DRX_TUNE0b(br, nssfd)     (sftsh[br][nssfd])
+#define PARAM_DRX_TUNE1a(prf)           (dtune1[(prf) - DWT_PRF_16M])
+#define PARAM_DRX_TUNE2(prf, pac)       (digital_bb_config[(prf) - DWT_PRF_16M][pac])
+#define PARAM_AGC_TUNE1(prf)            (agc_config.target[(prf) - DWT_PRF_16M])
+#define PARAM_DW_NS_SFD_LEN(br)         (dwnsSFDlen[br])
+#define PARAM_LDE_CFG2(prf)             (((prf) == DWT_PRF_64M) ? LDE_PARAM3_64 : LDE_PARAM3_16)
+
+#else
+
+// Fixed radio configuration build (DWT_FIXED_CHAN, see deca_device_api.h): the same values as constants, the chan, prf
+// and br arguments are ignored
+#define PARAM_PASTE(a, b)               PARAM_PASTE_(a, b)
+#define PARAM_PASTE_(a, b)              a##b
+#define PARAM_FS_PLLCFG(chan)           PARAM_PASTE(FS_PLLCFG_CH, DWT_FIXED_CHAN)
+#define PARAM_FS_PLLTUNE(chan)          PARAM_PASTE(FS_PLLTUNE_CH, DWT_FIXED_CHAN)
+#define PARAM_RF_TXCTRL(chan)           PARAM_PASTE(RF_TXCTRL_CH, DWT_FIXED_CHAN)
+#define PARAM_RF_RXCTRLH(chan)          (((DWT_FIXED_CHAN == 4) || (DWT_FIXED_CHAN == 7)) ? RF_RXCTRLH_WBW : RF_RXCTRLH_NBW)
+#define PARAM_DRX_TUNE0b(br, nssfd)     ((DWT_FIXED_BR == DWT_BR_110K) ? ((nssfd) ? DRX_TUNE0b_110K_NSTD : DRX_TUNE0b_110K_STD) : \
+                                         (DWT_FIXED_BR == DWT_BR_850K) ? ((nssfd) ? DRX_TUNE0b_850K_NSTD : DRX_TUNE0b_850K_STD) : \
+                                         ((nssfd) ? DRX_TUNE0b_6M8_NSTD : DRX_TUNE0b_6M8_STD))
+#define PARAM_DRX_TUNE1a(prf)           ((DWT_FIXED_PRF == DWT_PRF_64M) ? DRX_TUNE1a_PRF64 : DRX_TUNE1a_PRF16)
+#define PARAM_DRX_TUNE2(prf, pac)       ((DWT_FIXED_PRF == DWT_PRF_64M) ? \
+                                         (((pac) == DWT_PAC8) ? DRX_TUNE2_PRF64_PAC8 : ((pac) == DWT_PAC16) ? DRX_TUNE2_PRF64_PAC16 : \
+                                          ((pac) == DWT_PAC32) ? DRX_TUNE2_PRF64_PAC32 : DRX_TUNE2_PRF64_PAC64) : \
+                                         (((pac) == DWT_PAC8) ? DRX_TUNE2_PRF16_PAC8 : ((pac) == DWT_PAC16) ? DRX_TUNE2_PRF16_PAC16 : \
+                                          ((pac) == DWT_PAC32) ? DRX_TUNE2_PRF16_PAC32 : DRX_TUNE2_PRF16_PAC64))
+#define PARAM_AGC_TUNE1(prf)            ((DWT_FIXED_PRF == DWT_PRF_64M) ? AGC_TUNE1_64M : AGC_TUNE1_16M)
+#define PARAM_DW_NS_SFD_LEN(br)         ((DWT_FIXED_BR == DWT_BR_110K) ? DW_NS_SFD_LEN_110K : \
+                                         (DWT_FIXED_BR == DWT_BR_850K) ? DW_NS_SFD_LEN_850K : DW_NS_SFD_LEN_6M8)
+#define PARAM_LDE_CFG2(prf)             ((DWT_FIXED_PRF == DWT_PRF_64M) ? LDE_PARAM3_64 : LDE_PARAM3_16)
+
+#endif
+
 #define TEMP_COMP_FACTOR_CH2 (327) //(INT) (0.0798 * 4096)
 #define TEMP_COMP_FACTOR_CH5 (607) //(INT) (0.1482 * 4096)
 #define SAR_TEMP_TO_CELCIUS_CONV (1.14)
@@ -19,6 +19,8 @@
 #include "deca_param_types.h"
 
 
+#ifndef DWT_FIXED_CHAN // The fixed radio configuration build uses the PARAM_xxx constants of deca_param_types.h instead
+
 //-----------------------------------------
 // map the channel number to the index in the configuration arrays below
 // 0th element is chan 1, 1st is chan 2, 2nd is chan 3, 3rd is chan 4, 4th is chan 5, 5th is chan 7
@@ -64,6 +66,7 @@ const uint8 rx_config[NUM_BW] =
     RF_RXCTRLH_WBW
 };
 
+#endif // DWT_FIXED_CHAN
 
 const agc_cfg_struct agc_config =
 {
@@ -71,6 +74,8 @@ const agc_cfg_struct agc_config =
     { AGC_TUNE1_16M , AGC_TUNE1_64M }  //adc target
 };
 
+#ifndef DWT_FIXED_CHAN
+
 //DW non-standard SFD length for 110k, 850k and 6.81M
 const uint8 dwnsSFDlen[NUM_BR] =
 {
@@ -118,6 +123,8 @@ const uint32 digital_bb_config[NUM_PRF][NUM_PACS] =
     }
 };
 
+#endif // DWT_FIXED_CHAN
+
 const uint16 lde_replicaCoeff[PCODES] =
 {
     0, // No preamble code 0
@@ -16,6 +16,7 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "TX AUTO SLP v1.3"
@@ -58,9 +59,6 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Issue a wake-up in case DW1000 is asleep.
      * Since DW1000 is not woken by the reset line, we could get here with it asleep. Note that this may be true in other examples but we pay special
      * attention here because this example is precisely about sleeping. */
@@ -69,15 +67,14 @@ int dw_main(void)
     /* Reset and initialise DW1000. See NOTE 3 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 4 below. */
     dwt_configure(&config);
@@ -16,6 +16,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
+#include "deca_pm.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "TX TIME SLP v1.1"
@@ -57,6 +59,9 @@ static uint8 tx_msg[] = {0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E', 0, 0};
 #define DUMMY_BUFFER_LEN 600
 static uint8 dummy_buffer[DUMMY_BUFFER_LEN];
 
+/* Set to let the power manager time the sleep instead, see NOTE 9 below. */
+#define USE_PM 0
+
 /**
  * Application entry point.
  */
@@ -64,9 +69,6 @@ int dw_main(void)
 {
     uint16 lp_osc_freq, sleep_cnt;
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Issue a wake-up in case DW1000 is asleep.
      * Since DW1000 is not woken by the reset line, we could get here with it asleep. Note that this may be true in other examples but we pay special
      * attention here because this example is precisely about sleeping. */
@@ -75,15 +77,47 @@ int dw_main(void)
     /* Reset and initialise DW1000. See NOTE 4 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
+#if USE_PM
+    /* Configure DW1000 and the power manager, which calibrates the sleep counter itself. */
+    dwt_configure(&config);
+    {
+        deca_pm_config_t pm_cfg = DECA_PM_CONFIG_DEFAULT(TX_DELAY_MS);
+
+        deca_pm_init(&pm_cfg);
+    }
+    dwt_setleds(1);
+
+    while (1)
+    {
+        dwt_writetxdata(sizeof(tx_msg), tx_msg, 0); /* Zero offset in TX buffer. */
+        dwt_writetxfctrl(sizeof(tx_msg), 0, 0); /* Zero offset in TX buffer, no ranging. */
+        dwt_starttx(DWT_START_TX_IMMEDIATE);
+
+        /* The DW1000 stays awake after the transmission, poll for its end. */
+        while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS))
+        { };
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS);
+
+        /* DEEPSLEEP until the next frame, back with the DW1000 configured. */
+        if (deca_pm_sleep() != DWT_SUCCESS)
+        {
+            printk("WAKE-UP FAILED");
+        }
+
+        tx_msg[BLINK_FRAME_SN_IDX]++;
+    }
+#endif
+
     /* Calibrate and configure sleep count. This has to be done with DW1000 clocks set to crystal speed. */
+    port_set_dw1000_slowrate();
     lp_osc_freq = (XTAL_FREQ_HZ / 2) / dwt_calibratesleepcnt();
     sleep_cnt = ((SLEEP_TIME_MS * lp_osc_freq) / 1000) >> 12;
     dwt_configuresleepcnt(sleep_cnt);
@@ -153,4 +187,7 @@ int dw_main(void)
       an interrupt generated by the DW1000 waking.
  * 8. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
+ * 9. With USE_PM set, deca_pm.h sends a frame every TX_DELAY_MS: the nRF52 sleeps on its RTC and wakes the DW1000 up with its chip select just
+ *    before the frame is due, the sleep counter only wakes it up should that fail. Frames keep their period whatever the sleep counter
+ *    granularity (NOTE 2), and deca_pm_getstats() gives the time spent in each state.
  ****************************************************************************************************************************************************/
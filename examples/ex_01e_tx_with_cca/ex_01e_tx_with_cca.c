@@ -34,6 +34,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
+#include "mac_csma.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "TX + CCA  v1.1"
@@ -71,6 +73,9 @@ static uint8 tx_msg[] = {0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E', 0, 0};
                                     * and is doing a TX back-off.
                                     */
 
+/* Set to send through the CSMA module instead: random exponential backoff timed by the DW1000, interrupt driven. See NOTE 10 below. */
+#define USE_CSMA 0
+
 int tx_sleep_period; /* Sleep period until the next TX attempt */
 int next_backoff_interval = INITIAL_BACKOFF_PERIOD; /* Next backoff in the event of busy channel detection by this pseudo CCA algorithm */
 
@@ -80,6 +85,21 @@ char console_str[17] = {0};
 /* holds copy of status register */
 uint32 status_reg = 0;
 
+#if USE_CSMA
+/* Outcome of the last transmission, set from the DW1000 IRQ thread: 1 sent, -1 channel still busy after the backoffs. */
+static volatile int csma_done;
+
+static void csma_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    csma_done = 1;
+}
+
+static void csma_busy_cb(void)
+{
+    csma_done = -1;
+}
+#endif
+
 /**
  * Application entry point.
  */
@@ -89,21 +109,17 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Reset and initialise DW1000. See NOTE 3 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 4 below. */
     dwt_configure(&config);
@@ -112,8 +128,19 @@ int dw_main(void)
     dwt_setleds(DWT_LEDS_ENABLE);
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+#if USE_CSMA
+    {
+        mac_csma_config_t csma_cfg = MAC_CSMA_CONFIG_DEFAULT;
+
+        mac_csma_init(&csma_cfg);
+        dwt_setcallbacks(&csma_txdone_cb, NULL, NULL, NULL);
+        dwt_setinterrupt(DWT_INT_TFRS, 1);
+        port_set_deca_isr(mac_csma_isr);
+    }
+#else
     /* Configure preamble timeout to 3 PACs; if no preamble detected in this time we assume channel is clear. See Note 5*/
     dwt_setpreambledetecttimeout(3);
+#endif
 
     /* Loop forever sending frames periodically. */
     while(1)
@@ -126,6 +153,22 @@ int dw_main(void)
         dwt_writetxdata(sizeof(tx_msg), tx_msg, 0); /* Zero offset in TX buffer. */
         dwt_writetxfctrl(sizeof(tx_msg), 0, 0); /* Zero offset in TX buffer, no ranging. */
 
+#if USE_CSMA
+        /* Backoffs and CCA run from the DW1000 interrupts, wait for the outcome. */
+        csma_done = 0;
+        mac_csma_starttx(DWT_START_TX_IMMEDIATE, &csma_busy_cb);
+        while (csma_done == 0)
+        {
+            port_wait_deca_irq(PORT_WAIT_FOREVER);
+        }
+
+        channel_clear = (csma_done > 0);
+        if (channel_clear)
+        {
+            tx_msg[BLINK_FRAME_SN_IDX]++;
+        }
+        tx_sleep_period = TX_DELAY_MS;
+#else
         /* Activate RX to perform CCA. */
         dwt_rxenable(DWT_START_RX_IMMEDIATE);
         /* Start transmission. Will be delayed (the above RX command has to finish first)
@@ -159,6 +202,7 @@ int dw_main(void)
                                * See https://en.wikipedia.org/wiki/Exponential_backoff */
             channel_clear = 0;
         }
+#endif
 
         /* Note in order to see cca_result of 0 on the console, the backoff period is artificially set to 400 ms */
         sprintf(console_str, "CCA=%d   %d  \n", channel_clear, tx_sleep_period);
@@ -205,4 +249,7 @@ int dw_main(void)
  *    Please refer to DW1000 User Manual for more details on "interrupts".
  * 9. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
+ * 10. With USE_CSMA set, mac_csma.h does the same CCA with the 802.15.4 unslotted CSMA-CA backoff: 0 to 2^BE - 1 units of 300 us before each
+ *    CCA, BE going from 3 to 5 with each busy one, the frame dropped after 4 of them (CCA=0 on the console). The backoff is a delayed RX of the
+ *    DW1000, the CCA outcome an interrupt: there is no polling, and no Sleep() between the attempts. mac_csma_getstats() gives the counts.
  ****************************************************************************************************************************************************/
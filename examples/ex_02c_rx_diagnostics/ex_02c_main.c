@@ -23,6 +23,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
+#include "deca_rxqual.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "RX DIAG v1.1"
@@ -61,6 +63,9 @@ static dwt_rxdiag_t rx_diag;
 #define ACCUM_DATA_LEN (2 * 2 * (3 + 3) + 1)
 static uint8 accum_data[ACCUM_DATA_LEN];
 
+/* Hold copy of the fast quality registers and power estimates so that they can be examined at a debug breakpoint. See NOTE 8. */
+static deca_rxqual_t rx_qual;
+
 /**
  * Application entry point.
  */
@@ -69,21 +74,17 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Reset and initialise DW1000. See NOTE 3 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADUCODE) (CONFIG_DW1000_LOAD_UCODE in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. */
     dwt_configure(&config);
@@ -150,6 +151,9 @@ int dw_main(void)
             /* Read accumulator. See NOTES 2 and 6. */
             uint16 fp_int = rx_diag.firstPath / 64;
             dwt_readaccdata(accum_data, ACCUM_DATA_LEN, (fp_int - 2) * 4);
+
+            /* Same first path amplitudes in three short reads, with the first path and RX power estimates. See NOTE 8. */
+            deca_rxqual_read(&rx_qual, config.prf);
         }
         else
         {
@@ -185,6 +189,11 @@ int dw_main(void)
  *    it. This value can be used to access the accumulator samples around the calculated first path index as it is done here.
  * 7. Event counters are never reset in this example but this can be done by re-enabling them (i.e. calling again dwt_configeventcounters with
  *    "enable" parameter set).
- * 8. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
+ * 8. dwt_readdiagnostics() and the accumulator read above take six SPI transactions and tens of bytes, more to see the whole CIR. The line of
+ *    sight and RX level estimates of the DW1000 User Manual only need FP_AMPL1-3, CIR_PWR and RXPACC: deca_rxqual_read() reads them in three
+ *    bursts (RX_TIME, which also gives the RX timestamp, RX_FQUAL and RX_FINFO) and computes the first path and RX powers in dBm (Q8, divide by
+ *    256) in fixed point. A difference of the two under 6 dB indicates line of sight, over 10 dB an obstructed first path. It is cheap enough
+ *    for every ranging exchange, see rxQual in ranging/rng_twr.h.
+ * 9. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
  ****************************************************************************************************************************************************/
@@ -16,6 +16,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
+#include "deca_sniff.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "RX SNIFF v1.2"
@@ -42,6 +44,9 @@ static dwt_config_t config = {
 #define SNIFF_ON_TIME 1
 #define SNIFF_OFF_TIME 16
 
+/* Set to let the OFF time follow the channel load instead, see NOTE 6 below. */
+#define USE_ADAPT_SNIFF 0
+
 /* Buffer to store received frame. See NOTE 1 below. */
 #define FRAME_LEN_MAX 127
 static uint8 rx_buffer[FRAME_LEN_MAX];
@@ -60,21 +65,17 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Reset and initialise DW1000. See NOTE 2 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* This is put here for testing, so that we can see the receiver ON/OFF pattern using an oscilloscope. */
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
@@ -83,7 +84,16 @@ int dw_main(void)
     dwt_configure(&config);
 
     /* Configure SNIFF mode. */
+#if USE_ADAPT_SNIFF
+    {
+        deca_sniff_config_t sniff_cfg = DECA_SNIFF_CONFIG_DEFAULT;
+
+        sniff_cfg.onTime = SNIFF_ON_TIME;
+        deca_sniff_start(&sniff_cfg, &config);
+    }
+#else
     dwt_setsniffmode(1, SNIFF_ON_TIME, SNIFF_OFF_TIME);
+#endif
 
     /* Configure DW1000 LEDs */
     dwt_setleds(1);
@@ -145,4 +155,7 @@ int dw_main(void)
  *    interrupts. Please refer to DW1000 User Manual for more details on "interrupts".
  * 5. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
+ * 6. With USE_ADAPT_SNIFF set, deca_sniff.h reads the event counters every second: the OFF time grows while the channel is idle, up to what
+ *    the 128 symbol preamble allows (about 95 here), is halved when frames are caught too late to be decoded, and SNIFF mode is turned off
+ *    while more than 20 frames a second come in. deca_sniff_getstats() gives the setting in use.
  ****************************************************************************************************************************************************/
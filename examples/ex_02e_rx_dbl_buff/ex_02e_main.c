@@ -20,6 +20,10 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
+#include "deca_rxq.h"
+
+#include <zephyr.h>
 
 /* Example application name and version to display on console. */
 #define APP_NAME "RX DBL BUFF v1.1"
@@ -38,13 +42,7 @@ static dwt_config_t config = {
     (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */           
 };
 
-/* Buffer to store received frame. See NOTE 1 below. */
-#define FRAME_LEN_MAX 127
-static uint8 rx_buffer[FRAME_LEN_MAX];
-
-/* Declaration of static functions. */
-static void rx_ok_cb(const dwt_cb_data_t *cb_data);
-static void rx_err_cb(const dwt_cb_data_t *cb_data);
+/* Frames come from the 127 byte buffers of the frame pool. See NOTE 1 below. */
 
 /**
  * Application entry point.
@@ -54,24 +52,20 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Install DW1000 IRQ handler. */
     port_set_deca_isr(dwt_isr);
 
     /* Reset and initialise DW1000. See NOTE 2 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. */
     dwt_configure(&config);
@@ -82,8 +76,8 @@ int dw_main(void)
     /* Activate double buffering. */
     dwt_setdblrxbuffmode(1);
 
-    /* Register RX call-back. */
-    dwt_setcallbacks(NULL, &rx_ok_cb, NULL, &rx_err_cb);
+    /* Hand the good frames to the RX pipeline, which re-enables RX before reading each frame. See NOTE 5 below. */
+    deca_rxq_start(NULL, DECA_RXQ_REARM);
 
     /* Enable wanted interrupts (RX good frames and RX errors). */
     dwt_setinterrupt(DWT_INT_RFCG | DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT, 1);
@@ -91,72 +85,38 @@ int dw_main(void)
     /* Activate reception immediately. See NOTE 3 below. */
     dwt_rxenable(DWT_START_RX_IMMEDIATE);
 
-    /* Loop forever receiving frames. See NOTE 4 below. */
+    /* Loop forever processing the received frames. See NOTE 4 below. */
     while (1)
-    { };
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn rx_ok_cb()
- *
- * @brief Callback to process RX good frame events
- *
- * @param  cb_data  callback data
- *
- * @return  none
- */
-static void rx_ok_cb(const dwt_cb_data_t *cb_data)
-{
-    /* Perform manual RX re-enabling. See NOTE 5 below. */
-    dwt_rxenable(DWT_START_RX_IMMEDIATE | DWT_NO_SYNC_PTRS);
+    {
+        deca_frame_t *frame = deca_rxq_get(K_FOREVER);
 
-    /* TESTING BREAKPOINT LOCATION #1 */
+        /* TESTING BREAKPOINT LOCATION #1: frame->data holds frame->len bytes. See NOTE 6 below. */
 
-    /* A frame has been received, copy it to our local buffer. See NOTE 6 below. */
-    if (cb_data->datalength <= FRAME_LEN_MAX)
-    {
-        dwt_readrxdata(rx_buffer, cb_data->datalength, 0);
+        deca_rxq_free(frame);
     }
-
-    /* TESTING BREAKPOINT LOCATION #2 */
 }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn rx_err_cb()
- *
- * @brief Callback to process RX error events
- *
- * @param  cb_data  callback data
- *
- * @return  none
- */
-static void rx_err_cb(const dwt_cb_data_t *cb_data)
-{
-    /* Re-activate reception immediately. */
-    dwt_rxenable(DWT_START_RX_IMMEDIATE);
-
-    /* TESTING BREAKPOINT LOCATION #3 */
-}
 #endif
 /*****************************************************************************************************************************************************
  * NOTES:
  *
  * 1. In this example, maximum frame length is set to 127 bytes which is 802.15.4 UWB standard maximum frame length. DW1000 supports an extended
- *    frame length (up to 1023 bytes long) mode which is not used in this example.
+ *    frame length (up to 1023 bytes long) mode which is not used in this example. Longer frames are dropped by the RX pipeline.
  * 2. In this example, LDE microcode is not loaded upon calling dwt_initialise(). This will prevent the IC from generating an RX timestamp. If
  *    time-stamping is required, DWT_LOADUCODE parameter should be used. See two-way ranging examples (e.g. examples 5a/5b).
  * 3. Manual reception activation is performed here but DW1000 offers several features that can be used to handle more complex scenarios or to
  *    optimise system's overall performance (e.g. timeout after a given time, automatic re-enabling of reception in case of errors, etc.).
- * 4. There is nothing to do in the loop here as frame reception and RX re-enabling is handled by the callbacks. In a less trivial real-world
- *    application the RX data callback would generally signal the reception event to some background protocol layer to further process each RX frame.
+ * 4. Frame reception and RX re-enabling are handled by the RX pipeline (platform/deca_rxq.c) from the DW1000 callbacks. Each good frame is read
+ *    once, straight into a frame buffer of the pool (platform/deca_frame.c), and only the frame pointer is queued to this loop, which hands it
+ *    back when done.
  * 5. When using double buffering, RX can be re-enabled before reading all the frame data as this is precisely the purpose of having two buffers. All
  *    the registers needed to process the received frame are also double buffered with the exception of the Accumulator CIR memory and the LDE
  *    threshold (accessed when calling dwt_readdiagnostics). In an actual application where these values might be needed for any processing or
  *    diagnostics purpose, they would have to be read before RX re-enabling is performed so that they are not corrupted by a frame being received
- *    while they are being read. Typically, in this example, any such diagnostic data access would be done at the very beginning of the rx_ok_cb
- *    function.
- * 6. A real application might get an operating system (OS) buffer for this data reading and then pass the buffer onto a queue into the next layer
-      of processing task via an appropriate OS call.
+ *    while they are being read. Typically, in this example, any such diagnostic data access would be done at the very beginning of the RX
+ *    callback of the pipeline, before it re-enables RX.
+ * 6. Frames not yet handed back are not available for new frames: with the pool or the queue full, frames are dropped and counted (see
+ *    deca_rxq_getstats). CONFIG_DW1000_RXQ_COUNT sets how many frames this loop may lag behind.
  * 7. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
  ****************************************************************************************************************************************************/
@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ *
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_02f_main.c
+ *  @brief   RX with channel impulse response streaming over BLE
+ *
+ *           Receives frames as example 2c, e.g. from example 1a, and streams the accumulator of some of them through the DPS
+ *           Gatt Profile: one frame in CIR_EVERY_N, and every frame whose first path looks obstructed. Each capture is a
+ *           window around the first path, sent in chunks of a few notifications.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "deca_rxqual.h"
+#include "deca_cir.h"
+
+#include "ble_dwm1001.h"
+
+#include <zephyr.h>
+#include <string.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 2f - RX CIR STREAM\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_VERSION_NUM 0x010000
+#define APP_LINE "=================\n"
+
+#define APP_UID 0xDECA00000000002F
+#define APP_HW  1
+
+/* Default communication configuration, as example 2c. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Sampling policy, see NOTE 1 below: one frame in CIR_EVERY_N, and the frames with a line of sight indicator below CIR_LOS_BELOW. */
+#define CIR_EVERY_N     20
+#define CIR_LOS_BELOW   50
+
+/* Window around the first path and compression, see NOTE 2 below. */
+#define CIR_PRE         16
+#define CIR_POST        48
+#define CIR_FMT         DECA_CIR_FMT_16
+
+/* Hold copy of status register state here for reference, so reader can examine it at a breakpoint. */
+static uint32 status_reg = 0;
+
+/* Hold copy of the quality of the last frame so that it can be examined at a debug breakpoint. */
+static deca_rxqual_t rx_qual;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    deca_cir_config_t cir_cfg = DECA_CIR_CONFIG_DEFAULT;
+    ble_device_info_t devinfo;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot, with the LDE microcode that the CIR and first path
+     * values need (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("INIT FAILED");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setleds(1);
+
+    memset(&devinfo, 0, sizeof(ble_device_info_t));
+    devinfo.uid = APP_UID;
+    devinfo.hw_ver = APP_HW;
+    devinfo.fw1_ver = APP_VERSION_NUM;
+
+    ble_dwm1001_set_devinfo(&devinfo);
+    ble_dwm1001_conn_profile(BLE_CONN_LOW_LATENCY);
+    ble_dwm1001_enable();
+
+    /* Chunks go to the BLE thread by reference. See NOTE 3 below. */
+    cir_cfg.prf = config.prf;
+    cir_cfg.everyN = CIR_EVERY_N;
+    cir_cfg.losBelow = CIR_LOS_BELOW;
+    cir_cfg.pre = CIR_PRE;
+    cir_cfg.post = CIR_POST;
+    cir_cfg.fmt = CIR_FMT;
+    deca_cir_init(&cir_cfg, ble_dwm1001_dps_frame);
+
+    /* Loop forever receiving frames. */
+    while (1)
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_ERR)))
+        { };
+
+        if (status_reg & SYS_STATUS_RXFCG)
+        {
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG);
+
+            /* Quality and capture before the receiver is enabled again, which overwrites the accumulator. */
+            deca_rxqual_read(&rx_qual, config.prf);
+            deca_cir_rx(&rx_qual);
+        }
+        else
+        {
+            /* Clear RX error events in the DW1000 status register. */
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
+
+            /* Reset RX to properly reinitialise LDE operation. */
+            dwt_rxreset();
+        }
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The line of sight indicator of deca_rxqual.h drops as the first path power falls below the RX power: those frames are the interesting
+ *    ones for NLOS research and are all captured, the others are sampled once in CIR_EVERY_N as a reference. deca_cir_trigger() captures the
+ *    next frame on demand.
+ * 2. The whole accumulator is 1016 samples at 64 MHz PRF, 4 KB read in about 4 ms at the fast SPI rate and 17 notifications: the host would
+ *    get a few per second at most. The window of CIR_PRE + CIR_POST samples around the first path keeps the part that tells LOS from NLOS, in
+ *    3 notifications of at most 124 bytes; DECA_CIR_FMT_8 halves them again, each chunk then carries the shift restoring its samples. Setting
+ *    both CIR_PRE and CIR_POST to 0 captures the whole accumulator.
+ * 3. Each chunk is read by the SPI DMA straight into a frame pool buffer, behind its deca_cir_hdr_t, and queued to the BLE thread by
+ *    reference: the samples are never copied. The BLE thread sends the queued chunks of a capture while the next frames come in; chunks that
+ *    find the pool or the BLE queue full are dropped (deca_cir_getstats(), ble_dwm1001_dropped()). A sink writing the chunks to a UART would
+ *    be given to deca_cir_init() the same way.
+ ****************************************************************************************************************************************************/
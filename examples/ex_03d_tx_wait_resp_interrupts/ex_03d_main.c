@@ -19,6 +19,7 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "TX W4R IRQ v1.1"
@@ -77,12 +78,6 @@ static void rx_to_cb(const dwt_cb_data_t *cb_data);
 static void rx_err_cb(const dwt_cb_data_t *cb_data);
 static void tx_conf_cb(const dwt_cb_data_t *cb_data);
 
-static volatile uint8_t process_isr = 0;
-void dwt_isr_helper(void)
-{
-    process_isr = 1;
-}
-
 /**
  * Application entry point.
  */
@@ -91,25 +86,20 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Install DW1000 IRQ handler. */
-    /* Note: dwt_isr cannot be called in actual ISR because zephyr doesn't like APIs like spi being used during the ISR */
-    port_set_deca_isr(dwt_isr_helper);
-
-    /* Configure DW1000 SPI */
-    openspi();
+    /* Install DW1000 IRQ handler. See NOTE 9 below. */
+    port_set_deca_isr(dwt_isr);
 
     /* Reset and initialise DW1000. See NOTE 5 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 6 below. */
     dwt_configure(&config);
@@ -139,33 +129,11 @@ int dw_main(void)
         /* Start transmission, indicating that a response is expected so that reception is enabled immediately after the frame is sent. */
         dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
 
-        while(process_isr != 1)
-        {
-            //wait for interrupt because of TX event to happen
-        }
-
-        /* Run dwt_isr */
-        /* Note: this is out of the real ISR on purpose because zephyr doesn't like APIs like spi being used during the ISR */
-        dwt_isr();
-        
-        /* reset variable to 0 */
-        process_isr = 0;
-
-        while(process_isr != 1)
-        {
-            //wait for interrupt because of RX event to happen
-        }
-
-        /* Run dwt_isr */
-        /* Note: this is out of the real ISR on purpose because zephyr doesn't like APIs like spi being used during the ISR */
-        dwt_isr();
-        
-        /* reset variable to 0 */
-        process_isr = 0;
-
-        /* Wait for any RX event. */
+        /* Wait for any RX event, the TX confirmation is processed on the way. */
         while (tx_delay_ms == -1)
-        { };
+        {
+            port_wait_deca_irq(PORT_WAIT_FOREVER);
+        };
 
         printk("Test succeeded \n");
         /* Execute the defined delay before next transmission. */
@@ -293,4 +261,6 @@ static void tx_conf_cb(const dwt_cb_data_t *cb_data)
  *    work anymore then as we would still have to indicate the full length of the frame to dwt_writetxdata()).
  * 8. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *    DW1000 API Guide for more details on the DW1000 driver functions.
+ * 9. dwt_isr() accesses the DW1000 over SPI so it cannot run in the GPIO interrupt itself. port_set_deca_isr() defers it to a dedicated work queue
+ *    thread, and the main loop sleeps in port_wait_deca_irq() until an event has been processed instead of busy-polling.
  ****************************************************************************************************************************************************/
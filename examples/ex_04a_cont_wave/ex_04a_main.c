@@ -18,6 +18,7 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "CONT WAVE v1.3"
@@ -53,22 +54,20 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
     
-    /* Configure DW1000 SPI */
-    openspi();
-
-    /* During initialisation and continuous wave mode activation, DW1000 clocks must be set to crystal speed so SPI rate have to be lowered and will
-     * not be increased again in this example. */
-    port_set_dw1000_slowrate();
-
     /* Reset and initialise DW1000. See NOTE 1 below. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
 
+    /* During initialisation and continuous wave mode activation, DW1000 clocks must be set to crystal speed so SPI rate have to be lowered and will
+     * not be increased again in this example. */
+    port_set_dw1000_slowrate();
+
     /* Configure DW1000. */
     dwt_configure(&config);
     dwt_configuretxrf(&txconfig);
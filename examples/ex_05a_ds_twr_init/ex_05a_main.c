@@ -42,6 +42,9 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "deca_ts.h"
+#include "deca_txslot.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_HEADER "\nDWM1001 & Zephyr\n"
@@ -83,6 +86,9 @@ static uint8 tx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0x
 #define FINAL_MSG_RESP_RX_TS_IDX 14
 #define FINAL_MSG_FINAL_TX_TS_IDX 18
 #define FINAL_MSG_TS_LEN 4
+/* TX buffer slots of the frames, both stay resident in the DW1000. See NOTE 8 below. */
+static int poll_slot;
+static int final_slot;
 /* Frame sequence number, incremented after each transmission. */
 static uint8 frame_seq_nb = 0;
 
@@ -102,8 +108,8 @@ static uint32 status_reg = 0;
 /* This is the delay from the end of the frame transmission to the enable of the receiver, as programmed for the DW1000's wait for response feature. */
 #define POLL_TX_TO_RESP_RX_DLY_UUS 300
 /* This is the delay from Frame RX timestamp to TX reply timestamp used for calculating/setting the DW1000's delayed TX function. This includes the
- * frame length of approximately 2.66 ms with above configuration. */
-#define RESP_RX_TO_FINAL_TX_DLY_UUS 4000
+ * preamble of the final (around 150 us with above configuration) and the SPI accesses in between, see NOTE 8 below. */
+#define RESP_RX_TO_FINAL_TX_DLY_UUS 1500
 /* Receive response timeout. See NOTE 5 below. */
 #define RESP_RX_TIMEOUT_UUS 6000
 /* Preamble timeout, in multiple of PAC size. See NOTE 6 below. */
@@ -116,11 +122,6 @@ static uint64 poll_tx_ts;
 static uint64 resp_rx_ts;
 static uint64 final_tx_ts;
 
-/* Declaration of static functions. */
-static uint64 get_tx_timestamp_u64(void);
-static uint64 get_rx_timestamp_u64(void);
-static void final_msg_set_ts(uint8 *ts_field, uint64 ts);
-
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn main()
  *
@@ -138,21 +139,17 @@ int dw_main(void)
     printk(APP_VERSION);
     printk(APP_LINE);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Reset and initialise DW1000.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADUCODE) (CONFIG_DW1000_LOAD_UCODE in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("err - init failed");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 7 below. */
     dwt_configure(&config);
@@ -171,14 +168,17 @@ int dw_main(void)
 
     /* Configure DW1000 LEDs */
     dwt_setleds(1);
+
+    /* Write both frames to the TX buffer once, only their changing fields are written afterwards. See NOTE 8 below. */
+    poll_slot = deca_txslot_add(tx_poll_msg, sizeof(tx_poll_msg));
+    final_slot = deca_txslot_add(tx_final_msg, sizeof(tx_final_msg));
     
     /* Loop forever initiating ranging exchanges. */
     while (1)
     {
-        /* Write frame data to DW1000 and prepare transmission. See NOTE 8 below. */
-        tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-        dwt_writetxdata(sizeof(tx_poll_msg), tx_poll_msg, 0); /* Zero offset in TX buffer. */
-        dwt_writetxfctrl(sizeof(tx_poll_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+        /* Update the sequence number of the poll and prepare transmission. See NOTE 8 below. */
+        deca_txslot_patch(poll_slot, ALL_MSG_SN_IDX, 1, &frame_seq_nb);
+        deca_txslot_select(poll_slot, 1); /* Ranging. */
 
         /* Start transmission, indicating that a response is expected so that reception is enabled automatically after the frame is sent and the delay
          * set by dwt_setrxaftertxdelay() has elapsed. */
@@ -211,28 +211,32 @@ int dw_main(void)
             if (memcmp(rx_buffer, rx_resp_msg, ALL_MSG_COMMON_LEN) == 0)
             {
                 uint32 final_tx_time;
+                dwt_txn_t txn;
                 int ret;
 
                 /* Retrieve poll transmission and response reception timestamp. */
-                poll_tx_ts = get_tx_timestamp_u64();
-                resp_rx_ts = get_rx_timestamp_u64();
+                poll_tx_ts = deca_ts_readtx();
+                resp_rx_ts = deca_ts_readrx();
 
                 /* Compute final message transmission time. See NOTE 10 below. */
-                final_tx_time = (resp_rx_ts + (RESP_RX_TO_FINAL_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                final_tx_time = deca_ts_dlytime(resp_rx_ts, RESP_RX_TO_FINAL_TX_DLY_UUS);
                 dwt_setdelayedtrxtime(final_tx_time);
 
                 /* Final TX timestamp is the transmission time we programmed plus the TX antenna delay. */
-                final_tx_ts = (((uint64)(final_tx_time & 0xFFFFFFFEUL)) << 8) + TX_ANT_DLY;
+                final_tx_ts = deca_ts_dlytxts(final_tx_time, TX_ANT_DLY);
 
                 /* Write all timestamps in the final message. See NOTE 11 below. */
-                final_msg_set_ts(&tx_final_msg[FINAL_MSG_POLL_TX_TS_IDX], poll_tx_ts);
-                final_msg_set_ts(&tx_final_msg[FINAL_MSG_RESP_RX_TS_IDX], resp_rx_ts);
-                final_msg_set_ts(&tx_final_msg[FINAL_MSG_FINAL_TX_TS_IDX], final_tx_ts);
-
-                /* Write and send final message. See NOTE 8 below. */
-                tx_final_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-                dwt_writetxdata(sizeof(tx_final_msg), tx_final_msg, 0); /* Zero offset in TX buffer. */
-                dwt_writetxfctrl(sizeof(tx_final_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+                deca_ts_pack(&tx_final_msg[FINAL_MSG_POLL_TX_TS_IDX], poll_tx_ts, FINAL_MSG_TS_LEN);
+                deca_ts_pack(&tx_final_msg[FINAL_MSG_RESP_RX_TS_IDX], resp_rx_ts, FINAL_MSG_TS_LEN);
+                deca_ts_pack(&tx_final_msg[FINAL_MSG_FINAL_TX_TS_IDX], final_tx_ts, FINAL_MSG_TS_LEN);
+
+                /* Write the sequence number and the timestamps in the final message, then send it. See NOTE 8 below. */
+                dwt_txnbegin(&txn);
+                deca_txslot_txnpatch(&txn, final_slot, ALL_MSG_SN_IDX, 1, &frame_seq_nb);
+                deca_txslot_txnpatch(&txn, final_slot, FINAL_MSG_POLL_TX_TS_IDX, 3 * FINAL_MSG_TS_LEN,
+                                     &tx_final_msg[FINAL_MSG_POLL_TX_TS_IDX]);
+                dwt_txncommit(&txn);
+                deca_txslot_select(final_slot, 1); /* Ranging. */
                 ret = dwt_starttx(DWT_START_TX_DELAYED);
 
                 /* If dwt_starttx() returns an error, abandon this ranging exchange and proceed to the next one. See NOTE 12 below. */
@@ -271,74 +275,6 @@ int dw_main(void)
     }
 }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_tx_timestamp_u64()
- *
- * @brief Get the TX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_tx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readtxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_rx_timestamp_u64()
- *
- * @brief Get the RX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_rx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readrxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn final_msg_set_ts()
- *
- * @brief Fill a given timestamp field in the final message with the given value. In the timestamp fields of the final
- *        message, the least significant byte is at the lower address.
- *
- * @param  ts_field  pointer on the first byte of the timestamp field to fill
- *         ts  timestamp value
- *
- * @return none
- */
-static void final_msg_set_ts(uint8 *ts_field, uint64 ts)
-{
-    int i;
-    for (i = 0; i < FINAL_MSG_TS_LEN; i++)
-    {
-        ts_field[i] = (uint8) ts;
-        ts >>= 8;
-    }
-}
 /*****************************************************************************************************************************************************
  * NOTES:
  *
@@ -384,9 +320,12 @@ static void final_msg_set_ts(uint8 *ts_field, uint64 ts)
  *    length) for more challenging longer range, NLOS or noisy environments.
  * 7. In a real application, for optimum performance within regulatory limits, it may be necessary to set TX pulse bandwidth and TX power, (using
  *    the dwt_configuretxrf API call) to per device calibrated values saved in the target system or the DW1000 OTP memory.
- * 8. dwt_writetxdata() takes the full size of the message as a parameter but only copies (size - 2) bytes as the check-sum at the end of the frame is
- *    automatically appended by the DW1000. This means that our variable could be two bytes shorter without losing any data (but the sizeof would not
- *    work anymore then as we would still have to indicate the full length of the frame to dwt_writetxdata()).
+ * 8. deca_txslot_add() takes the full size of the message as a parameter but only copies (size - 2) bytes as the check-sum at the end of the frame
+ *    is automatically appended by the DW1000. This means that our variable could be two bytes shorter without losing any data (but the sizeof would
+ *    not work anymore then as we would still have to indicate the full length of the frame to deca_txslot_add()). The two frames stay in the TX
+ *    buffer, each in its own slot (see platform/deca_txslot.h), for the whole run: switching between them is a single TX_FCTRL write and per
+ *    exchange only the sequence numbers and the 12 timestamp bytes are written, instead of the whole frames. This keeps the SPI traffic between the
+ *    response reception and the final transmission short enough for the 1.5 ms RESP_RX_TO_FINAL_TX_DLY_UUS (4 ms before).
  * 9. We use polled mode of operation here to keep the example as simple as possible but all status events can be used to generate interrupts. Please
  *    refer to DW1000 User Manual for more details on "interrupts". It is also to be noted that STATUS register is 5 bytes long but, as the event we
  *    use are all in the first bytes of the register, we can use the simple dwt_read32bitreg() API call to access it instead of reading the whole 5
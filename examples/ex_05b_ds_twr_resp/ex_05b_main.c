@@ -26,6 +26,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "deca_ts.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_HEADER "\nDWM1001 & Zephyr\n"
@@ -107,11 +109,6 @@ static double distance;
 /* String used to display measured distance on console. */
 char dist_str[16] = {0};
 
-/* Declaration of static functions. */
-static uint64 get_tx_timestamp_u64(void);
-static uint64 get_rx_timestamp_u64(void);
-static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts);
-
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn main()
  *
@@ -129,21 +126,17 @@ int dw_main(void)
     printk(APP_VERSION);
     printk(APP_LINE);
 
-    /* Configure DW1000 SPI */
-    openspi();
-    
     /* Reset and initialise DW1000.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADUCODE) (CONFIG_DW1000_LOAD_UCODE in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 7 below. */
     dwt_configure(&config);
@@ -195,13 +188,13 @@ int dw_main(void)
                 int ret;
 
                 /* Retrieve poll reception timestamp. */
-                poll_rx_ts = get_rx_timestamp_u64();
+                poll_rx_ts = deca_ts_readrx();
 
                 /* Retreive frame sequence number */
                 memcpy(&frame_seq_nb_rx, &rx_buffer[2], 1);
 
                 /* Set send time for response. See NOTE 9 below. */
-                resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                resp_tx_time = deca_ts_dlytime(poll_rx_ts, POLL_RX_TO_RESP_TX_DLY_UUS);
                 dwt_setdelayedtrxtime(resp_tx_time);
 
                 /* Set expected delay and timeout for final message reception. See NOTE 4 and 5 below. */
@@ -251,13 +244,13 @@ int dw_main(void)
                         int64 tof_dtu;
 
                         /* Retrieve response transmission and final reception timestamps. */
-                        resp_tx_ts = get_tx_timestamp_u64();
-                        final_rx_ts = get_rx_timestamp_u64();
+                        resp_tx_ts = deca_ts_readtx();
+                        final_rx_ts = deca_ts_readrx();
 
                         /* Get timestamps embedded in the final message. */
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], &poll_tx_ts);
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], &resp_rx_ts);
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], &final_tx_ts);
+                        poll_tx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], FINAL_MSG_TS_LEN);
+                        resp_rx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], FINAL_MSG_TS_LEN);
+                        final_tx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], FINAL_MSG_TS_LEN);
 
                         /* Compute time of flight. 32-bit subtractions give correct answers even if clock has wrapped. See NOTE 12 below. */
                         poll_rx_ts_32 = (uint32)poll_rx_ts;
@@ -300,74 +293,6 @@ int dw_main(void)
     }
 }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_tx_timestamp_u64()
- *
- * @brief Get the TX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_tx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readtxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_rx_timestamp_u64()
- *
- * @brief Get the RX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_rx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readrxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn final_msg_get_ts()
- *
- * @brief Read a given timestamp value from the final message. In the timestamp fields of the final message, the least
- *        significant byte is at the lower address.
- *
- * @param  ts_field  pointer on the first byte of the timestamp field to read
- *         ts  timestamp value
- *
- * @return none
- */
-static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts)
-{
-    int i;
-    *ts = 0;
-    for (i = 0; i < FINAL_MSG_TS_LEN; i++)
-    {
-        *ts += ts_field[i] << (i * 8);
-    }
-}
 /*****************************************************************************************************************************************************
  * NOTES:
  *
@@ -42,8 +42,11 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "deca_ts.h"
+#include "dw1000_drv.h"
 
 #include "ble_dwm1001.h"
+#include "rng_filter.h"
 
 /* Example application name and version to display on console. */
 #define APP_HEADER "\nDWM1001 & Zephyr\n"
@@ -126,14 +129,15 @@ static uint64 final_rx_ts;
 static double tof;
 static double distance;
 
+/* Address the initiator is reported under. */
+#define PEER_ADDR 0xAA
+
+/* Range filter: Kalman smoothing, outliers rejected, one report every REPORT_EVERY ranges. See NOTE 14 below. */
+#define REPORT_EVERY 2
+
 /* String used to display measured distance on console. */
 char dist_str[16] = {0};
 
-/* Declaration of static functions. */
-static uint64 get_tx_timestamp_u64(void);
-static uint64 get_rx_timestamp_u64(void);
-static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts);
-
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn main()
@@ -152,21 +156,17 @@ int dw_main(void)
     printk(APP_VERSION);
     printk(APP_LINE);
 
-    /* Configure DW1000 SPI */
-    openspi();
-    
     /* Reset and initialise DW1000.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADUCODE) (CONFIG_DW1000_LOAD_UCODE in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 7 below. */
     dwt_configure(&config);
@@ -185,10 +185,6 @@ int dw_main(void)
 
 
     /* BLE Configuration */
-    ble_reps_t *ble_reps; 
-    uint8_t ble_buf[120] = {0};
-    ble_reps = (ble_reps_t *)(&ble_buf[0]);
-
     ble_device_info_t devinfo;
     memset(&devinfo, 0, sizeof(ble_device_info_t));
     devinfo.uid = APP_UID;
@@ -196,8 +192,14 @@ int dw_main(void)
     devinfo.fw1_ver = APP_VERSION_NUM;
 
     ble_dwm1001_set_devinfo(&devinfo);
+    ble_dwm1001_conn_profile(BLE_CONN_LOW_LATENCY);
     ble_dwm1001_enable();
 
+    /* Range filter configuration. See NOTE 14 below. */
+    rng_filter_config_t filter_cfg = RNG_FILTER_CONFIG_DEFAULT;
+    filter_cfg.reportEvery = REPORT_EVERY;
+    rng_filter_init(&filter_cfg);
+
 
     /* Loop forever responding to ranging requests. */
     while (1)
@@ -235,13 +237,13 @@ int dw_main(void)
                 int ret;
 
                 /* Retrieve poll reception timestamp. */
-                poll_rx_ts = get_rx_timestamp_u64();
+                poll_rx_ts = deca_ts_readrx();
 
                 /* Retreive frame sequence number */
                 memcpy(&frame_seq_nb_rx, &rx_buffer[2], 1);
 
                 /* Set send time for response. See NOTE 9 below. */
-                resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+                resp_tx_time = deca_ts_dlytime(poll_rx_ts, POLL_RX_TO_RESP_TX_DLY_UUS);
                 dwt_setdelayedtrxtime(resp_tx_time);
 
                 /* Set expected delay and timeout for final message reception. See NOTE 4 and 5 below. */
@@ -289,15 +291,20 @@ int dw_main(void)
                         uint32 poll_rx_ts_32, resp_tx_ts_32, final_rx_ts_32;
                         double Ra, Rb, Da, Db;
                         int64 tof_dtu;
+                        rng_filter_out_t filtered;
+                        uint8 quality;
 
                         /* Retrieve response transmission and final reception timestamps. */
-                        resp_tx_ts = get_tx_timestamp_u64();
-                        final_rx_ts = get_rx_timestamp_u64();
+                        resp_tx_ts = deca_ts_readtx();
+                        final_rx_ts = deca_ts_readrx();
+
+                        /* Quality of the final, before the receiver is enabled again. See NOTE 14 below. */
+                        quality = rng_filter_readquality();
 
                         /* Get timestamps embedded in the final message. */
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], &poll_tx_ts);
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], &resp_rx_ts);
-                        final_msg_get_ts(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], &final_tx_ts);
+                        poll_tx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], FINAL_MSG_TS_LEN);
+                        resp_rx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], FINAL_MSG_TS_LEN);
+                        final_tx_ts = (uint32)deca_ts_unpack(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], FINAL_MSG_TS_LEN);
 
                         /* Compute time of flight. 32-bit subtractions give correct answers even if clock has wrapped. See NOTE 12 below. */
                         poll_rx_ts_32 = (uint32)poll_rx_ts;
@@ -316,12 +323,11 @@ int dw_main(void)
                         sprintf(dist_str, "dist (%u): %3.2f m\n", frame_seq_nb_rx, (float)(distance));
                         printk("%s", dist_str);
 
-                        ble_reps->cnt = 1;
-                        ble_reps->ble_rep[0].node_id = 0xAA;
-                        ble_reps->ble_rep[0].dist = (float)(distance);
-                        ble_reps->ble_rep[0].tqf = 0;
-
-                        ble_dwm1001_dps(ble_buf, 1 + sizeof(ble_rep_t)*ble_reps->cnt);
+                        /* Filtered, then batched with the default configuration: the distances of the last 100 ms go out together. */
+                        if (rng_filter_update(PEER_ADDR, (int32_t)(distance * 1000), quality, &filtered) == RNG_FILTER_REPORT)
+                        {
+                            ble_dwm1001_report(PEER_ADDR, filtered.distMm, filtered.tqf);
+                        }
                     }
                 }
                 else
@@ -347,74 +353,6 @@ int dw_main(void)
     }
 }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_tx_timestamp_u64()
- *
- * @brief Get the TX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_tx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readtxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn get_rx_timestamp_u64()
- *
- * @brief Get the RX time-stamp in a 64-bit variable.
- *        /!\ This function assumes that length of time-stamps is 40 bits, for both TX and RX!
- *
- * @param  none
- *
- * @return  64-bit value of the read time-stamp.
- */
-static uint64 get_rx_timestamp_u64(void)
-{
-    uint8 ts_tab[5];
-    uint64 ts = 0;
-    int i;
-    dwt_readrxtimestamp(ts_tab);
-    for (i = 4; i >= 0; i--)
-    {
-        ts <<= 8;
-        ts |= ts_tab[i];
-    }
-    return ts;
-}
-
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn final_msg_get_ts()
- *
- * @brief Read a given timestamp value from the final message. In the timestamp fields of the final message, the least
- *        significant byte is at the lower address.
- *
- * @param  ts_field  pointer on the first byte of the timestamp field to read
- *         ts  timestamp value
- *
- * @return none
- */
-static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts)
-{
-    int i;
-    *ts = 0;
-    for (i = 0; i < FINAL_MSG_TS_LEN; i++)
-    {
-        *ts += ts_field[i] << (i * 8);
-    }
-}
 /*****************************************************************************************************************************************************
  * NOTES:
  *
@@ -481,4 +419,10 @@ static void final_msg_get_ts(const uint8 *ts_field, uint32 *ts)
  *     subtraction.
  * 13. The user is referred to DecaRanging ARM application (distributed with EVK1000 product) for additional practical example of usage, and to the
  *     DW1000 API Guide for more details on the DW1000 driver functions.
+ * 14. Each distance goes through the range filter of ranging/rng_filter.h before it is reported: a distance more than 50 cm away from the median
+ *     of the last 5 is dropped (3 in a row restart the filter, the initiator actually moved), the others are smoothed by a Kalman filter that
+ *     trusts them less as their quality drops. The quality compares the first path amplitude to the peak amplitude of the final message CIR, it
+ *     is 100 in clear line of sight and drops when the direct path is obstructed; it is reported as the TQF of the DPS location data. It needs the
+ *     diagnostics of the LDE microcode, loaded by the driver with CONFIG_DW1000_LOAD_UCODE. With REPORT_EVERY at 2, half the distances go to the
+ *     host, each one the estimate over all the ranges so far.
  ****************************************************************************************************************************************************/
@@ -25,6 +25,8 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "deca_ts.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "SS TWR INIT v1.4\n"
@@ -90,9 +92,6 @@ static double distance;
 /* String used to display measured distance on console (16 characters maximum). */
 char dist_str[16] = {0};
 
-/* Declaration of static functions. */
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts);
-
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn main()
  *
@@ -107,21 +106,17 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Reset and initialise DW1000.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADUCODE) (CONFIG_DW1000_LOAD_UCODE in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* Configure DW1000. See NOTE 6 below. */
     dwt_configure(&config);
@@ -185,12 +180,13 @@ int dw_main(void)
                 poll_tx_ts = dwt_readtxtimestamplo32();
                 resp_rx_ts = dwt_readrxtimestamplo32();
 
-                /* Read carrier integrator value and calculate clock offset ratio. See NOTE 11 below. */
-                clockOffsetRatio = dwt_readcarrierintegrator() * (FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_2 / 1.0e6) ;
+                /* Read carrier integrator value and calculate clock offset ratio, the multiplier is the one of the channel configured above
+                 * (channel 5). See NOTE 11 below. */
+                clockOffsetRatio = dwt_readcarrierintegrator() * (FREQ_OFFSET_MULTIPLIER * HERTZ_TO_PPM_MULTIPLIER_CHAN_5 / 1.0e6) ;
 
                 /* Get timestamps embedded in response message. */
-                resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
-                resp_msg_get_ts(&rx_buffer[RESP_MSG_RESP_TX_TS_IDX], &resp_tx_ts);
+                poll_rx_ts = (uint32)deca_ts_unpack(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], RESP_MSG_TS_LEN);
+                resp_tx_ts = (uint32)deca_ts_unpack(&rx_buffer[RESP_MSG_RESP_TX_TS_IDX], RESP_MSG_TS_LEN);
 
                 /* Compute time of flight and distance, using clock offset ratio to correct for differing local and remote clock rates */
                 rtd_init = resp_rx_ts - poll_tx_ts;
@@ -221,26 +217,6 @@ int dw_main(void)
     }
 }
 
-/*! ------------------------------------------------------------------------------------------------------------------
- * @fn resp_msg_get_ts()
- *
- * @brief Read a given timestamp value from the response message. In the timestamp fields of the response message, the
- *        least significant byte is at the lower address.
- *
- * @param  ts_field  pointer on the first byte of the timestamp field to get
- *         ts  timestamp value
- *
- * @return none
- */
-static void resp_msg_get_ts(uint8 *ts_field, uint32 *ts)
-{
-    int i;
-    *ts = 0;
-    for (i = 0; i < RESP_MSG_TS_LEN; i++)
-    {
-        *ts += ts_field[i] << (i * 8);
-    }
-}
 #endif
 /*****************************************************************************************************************************************************
  * NOTES:
@@ -40,6 +40,7 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "LPLISTEN RX v1.1"
@@ -129,9 +130,6 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-
     /* Install the low-power listening ISR handler.
      * This is an interrupt service routine part of the driver that is specific to correctly handling the low-power listening wake-up. */
     port_set_deca_isr(dwt_lowpowerlistenisr);
@@ -139,15 +137,14 @@ int dw_main(void)
     /* Reset and initialise DW1000. See NOTE 8 and 9 below.
      * For initialisation, DW1000 clocks must be temporarily set to crystal speed. After initialisation SPI rate can be increased for optimum
      * performance. */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    port_set_dw1000_slowrate();
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* This is put here for testing, so that we can see the receiver ON/OFF pattern using an oscilloscope. */
     dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
@@ -22,6 +22,7 @@
 #include "deca_device_api.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "dw1000_drv.h"
 
 /* Example application name and version to display on console. */
 #define APP_NAME "GPIO        v1.1"
@@ -35,27 +36,19 @@ int dw_main(void)
     /* Display application name on console. */
     printk(APP_NAME);
 
-    /* Configure DW1000 SPI */
-    openspi();
-    
-    /* During initialisation and continuous frame mode activation, DW1000 clocks must be set to crystal speed so SPI rate have to be lowered and will
-     * not be increased again in this example. */
-
-    port_set_dw1000_slowrate();
-
     /* NOTE!!! The switch S3-3 and S3-4 on EVB1000 HW should be OFF at this point
      * to make sure the DW1000 SPI mode is set to 0 on IC start up
      */
 
     /* Reset and initialise DW1000 */
-    reset_DW1000(); /* Target specific drive of RSTn line into DW1000 low for a period. */
-    if (dwt_initialise(DWT_LOADNONE) == DWT_ERROR)
+    /* The DW1000 driver does this during boot: dwt_initialise(DWT_LOADNONE) (CONFIG_DW1000_LOAD_UCODE unset in prj.conf),
+     * then the SPI rate is raised. Wait until it is done. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
     {
         printk("INIT FAILED");
         while (1)
         { };
     }
-    port_set_dw1000_fastrate();
 
     /* see NOTE 1: 1st enable GPIO clocks */
     dwt_enablegpioclocks();
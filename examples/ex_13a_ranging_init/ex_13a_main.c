@@ -0,0 +1,328 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_13a_main.c
+ *  @brief   DS TWR initiator built on the ranging engine
+ *
+ *           Same exchange as example 5a, and interoperable with example 5b, but the exchange runs from the DW1000 interrupts: the
+ *           application thread only starts it and sleeps until the next one.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_twr.h"
+#ifdef CONFIG_DW1000_CAL_STORE
+#include "deca_cal.h"
+#endif
+#ifdef CONFIG_DW1000_RANGING_CAL
+#include "rng_cal.h"
+#endif
+#ifdef CONFIG_DW1000_LINK_ADAPT
+#include "rng_link.h"
+#endif
+#ifdef CONFIG_DW1000_RANGING_CTL
+#include "rng_ctl.h"
+#endif
+
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 13a - RANGING INIT\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Inter-ranging delay period, in milliseconds. */
+#define RNG_DELAY_MS 1000
+
+/* Default communication configuration, as example 5a. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_EXT, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+/* Addresses of example 5a/5b. */
+#define OWN_ADDR    RNG_ADDR('V', 'E')
+#define PEER_ADDR   RNG_ADDR('W', 'A')
+
+/* Set to range with the responders below in broadcast mode (one poll, one final), each running example 13b with its own
+ * address. */
+#define USE_BCAST   0
+static const uint16 bcast_peers[] = { RNG_ADDR('A', '0'), RNG_ADDR('A', '1'), RNG_ADDR('A', '2'), RNG_ADDR('A', '3') };
+
+/* Set to range with PEER_ADDR in SS-TWR (example 6b, or 13b) instead of DS-TWR. */
+#define USE_SS      0
+
+/* Set to shrink the DS-TWR response and final delays to what the two sides need, the responder may set it too. */
+#define USE_ADAPT   0
+
+/* Set to close the response window as soon as no preamble comes, from the airtime of the PHY (autoTimeouts of
+ * rng_twr.h), the responder may set it too. */
+#define USE_AUTO_TO 0
+
+/* Distance to PEER_ADDR in mm to calibrate the antenna delays and crystal trim against, 0 not to. See NOTE 1 below. */
+#define CAL_DIST_MM 0
+
+/* Set to adapt the link to PEER_ADDR between the points below (CONFIG_DW1000_LINK_ADAPT in prj.conf), the responder must
+ * set it too with the same table, see NOTE 2 below. */
+#define USE_LINK    0
+#if USE_LINK
+static const rng_link_point_t link_points[] = {
+    /* 6.8 Mbps, 128 symbols, smart TX power: the configuration above */
+    {
+        .phy = { 5, DWT_PRF_64M, DWT_PLEN_128, DWT_PAC8, 9, 9, 1, DWT_BR_6M8, DWT_PHRMODE_EXT, (129) },
+        .txrf = { 0xC0, 0x0E082848 },
+        .lnaPa = 0,
+        .smartTx = 1,
+        .minRxPowerQ8 = -90 * 256,
+    },
+    /* 6.8 Mbps, 1024 symbols, TX power of the whole frame */
+    {
+        .phy = { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_6M8, DWT_PHRMODE_EXT, (1001) },
+        .txrf = { 0xC0, 0x25456585 },
+        .lnaPa = 0,
+        .smartTx = 0,
+        .minRxPowerQ8 = -128 * 256,
+    },
+};
+#endif
+
+/* Set to change the settings live from the shell, e.g. "rng set plen 1024 rate 850", "rng peers c:WA c:W1" (CONFIG_SHELL and
+ * CONFIG_DW1000_RANGING_SHELL in prj.conf), see NOTE 3 below. */
+#define USE_CTL     0
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_result_cb()
+ *
+ * @brief Called by the ranging engine at the end of each exchange, from the DW1000 IRQ thread.
+ */
+static void rng_result_cb(const rng_result_t *result)
+{
+    if ((result->status == RNG_OK) && (result->tof != 0))
+    {
+        /* SS-TWR: the initiator computes the distance */
+        printk("dist %04x (%u): %d mm\n", result->peer, result->seq, result->distMm);
+    }
+    else if (result->status == RNG_OK)
+    {
+        printk("success %04x (%u)\n", result->peer, result->seq);
+    }
+    else
+    {
+        printk("err %d %04x (%u)\n", result->status, result->peer, result->seq);
+    }
+}
+
+#if defined(CONFIG_DW1000_RANGING_CAL) && (CAL_DIST_MM > 0)
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn calibrate()
+ *
+ * @brief Calibrate against PEER_ADDR and keep the result in flash when built in, the antenna delays are updated.
+ */
+static void calibrate(const rng_config_t *rng_cfg, uint16 *tx_ant_dly, uint16 *rx_ant_dly)
+{
+    rng_cal_config_t cal_cfg = RNG_CAL_CONFIG_DEFAULT(PEER_ADDR, CAL_DIST_MM);
+    rng_cal_result_t res;
+
+    cal_cfg.txAntDly = *tx_ant_dly;
+    cal_cfg.rxAntDly = *rx_ant_dly;
+    if (rng_cal_run(rng_cfg, &config, &cal_cfg, &res) != DWT_SUCCESS)
+    {
+        printk("cal failed: %u ok %u failed, %d mm %d ppb\n", res.ok, res.failed, res.errMm, res.offsetPpb);
+        return;
+    }
+    printk("cal: tx %u rx %u trim %u after %u passes\n", res.txAntDly, res.rxAntDly, res.xtalTrim, res.passes);
+    *tx_ant_dly = res.txAntDly;
+    *rx_ant_dly = res.rxAntDly;
+#ifdef CONFIG_DW1000_CAL_STORE
+    {
+        deca_cal_t rec = {
+            .chan = config.chan,
+            .prf = config.prf,
+            .xtalTrim = res.xtalTrim,
+            .txAntDly = res.txAntDly,
+            .rxAntDly = res.rxAntDly,
+        };
+
+        if (deca_cal_save(&rec) != DWT_SUCCESS)
+        {
+            printk("cal: not saved\n");
+        }
+    }
+#endif
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    rng_config_t rng_cfg = RNG_CONFIG_DEFAULT(OWN_ADDR);
+    uint16 tx_ant_dly = TX_ANT_DLY;
+    uint16 rx_ant_dly = RX_ANT_DLY;
+    int cal_stored = 0;
+#if USE_CTL
+    rng_ctl_config_t ctl_cfg = RNG_CTL_CONFIG_DEFAULT(rng_result_cb);
+    rng_ctl_settings_t cur;
+#endif
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("err - init failed");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+#ifdef CONFIG_DW1000_CAL_STORE
+    /* Crystal trim applied at boot, antenna delays for this channel and PRF */
+    cal_stored = (deca_cal_antdly(&config, &tx_ant_dly, &rx_ant_dly) == DWT_SUCCESS);
+#endif
+    dwt_setrxantennadelay(rx_ant_dly);
+    dwt_settxantennadelay(tx_ant_dly);
+    dwt_setleds(1);
+
+    rng_cfg.adapt = USE_ADAPT;
+    rng_cfg.autoTimeouts = USE_AUTO_TO;
+#if defined(CONFIG_DW1000_RANGING_CAL) && (CAL_DIST_MM > 0)
+    if (!cal_stored)
+    {
+        calibrate(&rng_cfg, &tx_ant_dly, &rx_ant_dly);
+    }
+#endif
+    (void)cal_stored;
+    rng_cfg.txAntDly = tx_ant_dly;
+    rng_cfg.rxQual = USE_LINK;
+    rng_init(&rng_cfg, rng_result_cb);
+    rng_setphy(&config);
+#if USE_LINK
+    {
+        rng_link_config_t link_cfg = RNG_LINK_CONFIG_DEFAULT;
+
+        /* New peers start from the fast point, polls of the broadcast mode go at the last one */
+        link_cfg.startPoint = 0;
+        rng_link_init(&link_cfg, link_points, sizeof(link_points) / sizeof(link_points[0]));
+    }
+#endif
+#if USE_SS
+    rng_setlinkmode(PEER_ADDR, RNG_MODE_SS);
+#endif
+#if USE_CTL
+    cur.rng = rng_cfg;
+    cur.phy = config;
+    cur.intervalMs = RNG_DELAY_MS;
+#if USE_BCAST
+    cur.peerCnt = sizeof(bcast_peers) / sizeof(bcast_peers[0]);
+    memcpy(cur.peers, bcast_peers, sizeof(bcast_peers));
+#else
+    cur.peerCnt = 1;
+    cur.peers[0] = PEER_ADDR;
+#endif
+    rng_ctl_init(&ctl_cfg, &cur);
+#endif
+
+    /* Start an exchange periodically, the CPU is free while it runs. */
+    while (1)
+    {
+#if USE_CTL
+        /* The previous exchange is over: take the shell changes over, rng_init() forgets the link modes */
+        if (rng_ctl_apply(&cur) & RNG_CTL_CHG_ENGINE)
+        {
+#if USE_SS
+            rng_setlinkmode(PEER_ADDR, RNG_MODE_SS);
+#endif
+        }
+#if USE_BCAST
+        if (rng_initiate_bcast(cur.peers, cur.peerCnt) != DWT_SUCCESS)
+#else
+        if ((cur.peerCnt != 0) && (rng_initiate(cur.peers[0]) != DWT_SUCCESS))
+#endif
+#elif USE_BCAST
+        if (rng_initiate_bcast(bcast_peers, sizeof(bcast_peers) / sizeof(bcast_peers[0])) != DWT_SUCCESS)
+#else
+        if (rng_initiate(PEER_ADDR) != DWT_SUCCESS)
+#endif
+        {
+            printk("err - busy\n");
+        }
+#if USE_ADAPT
+        {
+            rng_delays_t dly;
+
+            rng_getdelays(&dly);
+            printk("final dly %u uus, %u late\n", dly.respRxToFinalTxDlyUus, dly.finalLate);
+        }
+#endif
+#if USE_CTL
+        Sleep(cur.intervalMs);
+#else
+        Sleep(RNG_DELAY_MS);
+#endif
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The calibration needs CONFIG_DW1000_RANGING_CAL in prj.conf, and PEER_ADDR running example 13b with USE_REPORT set, its own antenna delays and
+ *    crystal calibrated, CAL_DIST_MM away antenna to antenna. It runs at boot until a result is kept: with CONFIG_DW1000_CAL_STORE the antenna
+ *    delays and trim go to flash, the next boots take them from there and skip it (deca_cal_erase() to calibrate again).
+ * 2. USE_LINK: the poll goes out at the point of the peer. It moves from the fast point to the 1024 symbol preamble after two failed exchanges in a
+ *    row or an RX power below -90 dBm, and back after 16 exchanges at 95 % success and 6 dB above it (RNG_LINK_CONFIG_DEFAULT). The responder listens at
+ *    the last point and answers at the one of the poll. The DWM1001 has no external LNA/PA, a board with one sets lnaPa per point.
+ * 3. USE_CTL: "rng show" lists the settings, "rng set" queues changes of rng_config_t, of the radio configuration above and of the interval, "rng peers"
+ *    the responders, the first one only outside of the broadcast mode. They are taken over before the next exchange: a radio change rewrites the
+ *    DW1000 configuration, so change the responders first (example 13b with USE_CTL), they then wait for this side to follow. With USE_LINK the
+ *    points keep deciding the PHY of each poll.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_13b_main.c
+ *  @brief   DS TWR responder built on the ranging engine
+ *
+ *           Same exchange as example 5b, and interoperable with example 5a. The engine answers the polls from the DW1000 interrupts
+ *           and reports each computed distance, the application thread has nothing left to do.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_tdma.h"
+#include "deca_trace.h"
+#include "deca_spi.h"
+#ifdef CONFIG_DW1000_LINK_ADAPT
+#include "rng_link.h"
+#endif
+#ifdef CONFIG_DW1000_RANGING_CTL
+#include "rng_ctl.h"
+#endif
+
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 13b - RANGING RESP\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Default communication configuration, as example 5b. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_EXT, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+/* Address of example 5b. As an anchor of the TDMA tag of example 13c, set TDMA_ANCHOR and give each anchor its own address
+ * (RNG_ADDR('A', '0'), RNG_ADDR('A', '1'), ...): the anchor then uses the short timings of the tag and sends the distance
+ * back to it. */
+#define OWN_ADDR    RNG_ADDR('W', 'A')
+#define TDMA_ANCHOR 0
+
+/* Set to shrink the DS-TWR response delay to what the two sides need, see USE_ADAPT of example 13a. */
+#define USE_ADAPT   0
+
+/* Set to close the final window as soon as no preamble comes, see USE_AUTO_TO of example 13a. */
+#define USE_AUTO_TO 0
+
+/* Set to send the distance back to the initiator, as the calibration of example 13a needs. */
+#define USE_REPORT  0
+
+/* Set to follow the link adaptation of example 13a (CONFIG_DW1000_LINK_ADAPT in prj.conf), with the same points, see
+ * NOTE 3 below. */
+#define USE_LINK    0
+#if USE_LINK
+static const rng_link_point_t link_points[] = {
+    {
+        .phy = { 5, DWT_PRF_64M, DWT_PLEN_128, DWT_PAC8, 9, 9, 1, DWT_BR_6M8, DWT_PHRMODE_EXT, (129) },
+        .txrf = { 0xC0, 0x0E082848 },
+        .lnaPa = 0,
+        .smartTx = 1,
+        .minRxPowerQ8 = -90 * 256,
+    },
+    {
+        .phy = { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_6M8, DWT_PHRMODE_EXT, (1001) },
+        .txrf = { 0xC0, 0x25456585 },
+        .lnaPa = 0,
+        .smartTx = 0,
+        .minRxPowerQ8 = -128 * 256,
+    },
+};
+#endif
+
+/* Set to change the settings live from the shell (CONFIG_SHELL and CONFIG_DW1000_RANGING_SHELL in prj.conf), taken over
+ * every CTL_APPLY_MS while no exchange runs, see NOTE 4 below. */
+#define USE_CTL      0
+#define CTL_APPLY_MS 100
+
+/* Time between two prints of the latency summaries (CONFIG_DW1000_TRACE in prj.conf) and of the SPI profile
+ * (CONFIG_DW1000_SPI_PROF). See NOTE 1 and NOTE 2 below. */
+#define TRACE_PRINT_MS 10000
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_result_cb()
+ *
+ * @brief Called by the ranging engine at the end of each exchange, from the DW1000 IRQ thread.
+ */
+static void rng_result_cb(const rng_result_t *result)
+{
+    if (result->status == RNG_OK)
+    {
+        printk("dist (%u): %d mm\n", result->seq, result->distMm);
+    }
+    else
+    {
+        printk("err %d (%u)\n", result->status, result->seq);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+#if TDMA_ANCHOR
+    rng_config_t rng_cfg = RNG_CONFIG_FAST(OWN_ADDR);
+#else
+    rng_config_t rng_cfg = RNG_CONFIG_DEFAULT(OWN_ADDR);
+#endif
+#if USE_CTL
+    rng_ctl_config_t ctl_cfg = RNG_CTL_CONFIG_DEFAULT(rng_result_cb);
+    rng_ctl_settings_t cur = { .peerCnt = 0 };
+    uint32 ticks = 0;
+#endif
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("INIT FAILED");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+    dwt_setleds(1);
+
+    rng_cfg.txAntDly = TX_ANT_DLY;
+    rng_cfg.adapt = USE_ADAPT;
+    rng_cfg.autoTimeouts = USE_AUTO_TO;
+    rng_cfg.report = USE_REPORT;
+    rng_init(&rng_cfg, rng_result_cb);
+    rng_setphy(&config);
+#if USE_LINK
+    {
+        rng_link_config_t link_cfg = RNG_LINK_CONFIG_DEFAULT;
+
+        rng_link_init(&link_cfg, link_points, sizeof(link_points) / sizeof(link_points[0]));
+    }
+#endif
+    rng_respond();
+#if USE_CTL
+    cur.rng = rng_cfg;
+    cur.phy = config;
+    ctl_cfg.respond = 1;
+    rng_ctl_init(&ctl_cfg, &cur);
+#endif
+
+#if USE_CTL || defined(CONFIG_DW1000_TRACE) || defined(CONFIG_DW1000_SPI_PROF)
+    while (1)
+    {
+#if USE_CTL
+        Sleep(CTL_APPLY_MS);
+        rng_ctl_apply(NULL);
+        if (++ticks < TRACE_PRINT_MS / CTL_APPLY_MS)
+        {
+            continue;
+        }
+        ticks = 0;
+#else
+        Sleep(TRACE_PRINT_MS);
+#endif
+#ifdef CONFIG_DW1000_TRACE
+        deca_trace_print();
+#endif
+#ifdef CONFIG_DW1000_SPI_PROF
+        deca_spi_prof_report(8);
+#endif
+    }
+#endif
+
+    return 0;
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The summaries give, per span, the count, the min/avg/max and a histogram of 2^k us bins. The response budget of the responder is
+ *    pollRxToRespTxDlyUus: the irq span (DW_IRQ edge to the handler) plus the rx-tx span (poll RX callback to the response TX armed) must
+ *    stay below it, its max rather than its average, or the response goes out late. The spi spans tell which share of the isr span goes to
+ *    the SPI. The printk output goes to the UART, or to RTT with CONFIG_USE_SEGGER_RTT and CONFIG_RTT_CONSOLE in prj.conf, which keeps the
+ *    printing out of the way of the timings.
+ * 2. The SPI profile ranks the register files by bus time since boot: expect a DS-TWR exchange to be led by the SYS_STATUS reads and clears of
+ *    dwt_isr(), then the RX_TIME and TX_TIME timestamp reads and the TX_BUFFER writes, which is where batching and caching pay. The boot
+ *    itself shows up once, in the OTP_IF, LDE_IF, AGC_CTRL, DRX_CONF and FS_CTRL writes of dwt_initialise() and dwt_configure().
+ * 3. USE_LINK: the responder listens for polls at the last point, the 1024 symbol preamble with its PAC of 32 covers the shorter one too, and
+ *    answers each poll at the point it came with. The initiator decides which, from its RX power and success rate.
+ * 4. USE_CTL: "rng set" queues changes of rng_config_t and of the radio configuration above, e.g. "rng set plen 1024 rate 850". They are taken
+ *    over while the responder waits for a poll, which it stops for the time of the change: a poll arriving then is lost, the initiator retries.
+ *    After a radio change only an initiator with the same configuration is heard, set it there next (example 13a with USE_CTL).
+ ****************************************************************************************************************************************************/
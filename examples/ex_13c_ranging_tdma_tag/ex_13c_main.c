@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_13c_main.c
+ *  @brief   TDMA tag ranging against several anchors, the distances are outputted via the DPS Gatt Profile.
+ *
+ *           The tag ranges with each anchor in its own slot of the cycle, the slots being laid on the DW1000 clock by the
+ *           scheduler of ranging/rng_tdma.c. The anchors run example 13b with TDMA_ANCHOR set and their own address, so
+ *           the distance they compute is sent back to the tag. At the end of each cycle all the distances go out in one
+ *           BLE notification or, with USE_POSITIONING, the tag solves its position from them and sends that instead.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include <zephyr.h>
+
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_tdma.h"
+#include "rng_pos.h"
+#include "deca_evc.h"
+
+#include "ble_dwm1001.h"
+#include "ble_coex.h"
+#ifdef CONFIG_DW1000_RANGING_CTL
+#include "rng_ctl.h"
+#endif
+
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 13c - RANGING TDMA TAG\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_VERSION_NUM 0x010000
+#define APP_LINE "=================\n"
+
+#define APP_UID 0xDECA00000000013C
+#define APP_HW  1
+
+/* Default communication configuration, as example 5a. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_EXT, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+#define OWN_ADDR    RNG_ADDR('V', 'E')
+
+/* Anchors, one slot each, ranged 10 times per second. */
+static const rng_tdma_config_t tdma_cfg = {
+    .anchors = { RNG_ADDR('A', '0'), RNG_ADDR('A', '1'), RNG_ADDR('A', '2'), RNG_ADDR('A', '3') },
+    .anchorCnt = 4,
+    .rateHz = 10,
+    .guardUus = 300,
+    .slotUus = 0,
+};
+
+/* Solve the position on the tag (CONFIG_DW1000_POSITIONING in prj.conf), 0 to send the distances. See NOTE 1 below. */
+#define USE_POSITIONING 1
+
+/* Send the event counter rates once per second (CONFIG_DW1000_EVC in prj.conf). See NOTE 2 below. */
+#define USE_TELEMETRY 1
+
+/* Anchor coordinates in mm, surveyed: here the corners of a 10 x 8 m room, the anchors 2.5 m high. */
+static const rng_pos_config_t pos_cfg = {
+    .anchors = {
+        { RNG_ADDR('A', '0'),     0,    0, 2500 },
+        { RNG_ADDR('A', '1'), 10000,    0, 2500 },
+        { RNG_ADDR('A', '2'), 10000, 8000, 2500 },
+        { RNG_ADDR('A', '3'),     0, 8000, 2500 },
+    },
+    .anchorCnt = 4,
+    .dims = 2,
+    .zMm = 1000,
+    .maxIter = 5,
+    .maxResidualMm = 300,
+};
+
+/* Keep BLE connection events clear of the ranging slots: a 50 ms interval at most, locked to the 100 ms cycle. */
+static const ble_coex_cfg_t coex_cfg = {
+    .period_ms = 100,
+    .interval_max = 40,
+    .step_uus = 2000,
+    .fail_thresh = 2,
+};
+
+/* One notification per cycle: no deadline, delta encoded distances. */
+static const ble_batch_cfg_t ble_batch = {
+    .count = 0,
+    .deadline = 0,
+    .delta = 1,
+};
+
+/* Set to change the notification cadence live from the BLE command characteristic of ble_dwm1001.h
+ * (CONFIG_DW1000_RANGING_CTL in prj.conf), e.g. "set ble.count 4 ble.deadline 500". See NOTE 3 below. */
+#define USE_CTL 0
+#if USE_CTL
+static const rng_ctl_var_t ctl_vars[] = {
+    { "ble.count", 0, 255 },
+    { "ble.deadline", 0, 0xFFFF },
+    { "ble.delta", 0, 1 },
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_reply() / ctl_cmd()
+ *
+ * @brief A command written over BLE, from the system work queue, answered with notifications.
+ */
+static void ctl_reply(void *ctx, const char *line)
+{
+    ble_dwm1001_cmd_reply(line);
+}
+
+static void ctl_cmd(char *line)
+{
+    rng_ctl_execline(line, ctl_reply, NULL);
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_cycle_cb()
+ *
+ * @brief Called by the scheduler at the end of each cycle, from the DW1000 IRQ thread. Queues the distances of the
+ *        cycle and flushes them, a failed slot is reported with a zero quality factor, or sends the position solved
+ *        from them.
+ */
+static void tdma_cycle_cb(const rng_result_t *results, uint8 count)
+{
+#if USE_CTL
+    rng_ctl_settings_t cur;
+#endif
+#if USE_POSITIONING
+    rng_pos_t pos;
+
+    /* One position per cycle, none when the distances do not give one */
+    if (rng_pos_solve(results, count, &pos) == DWT_SUCCESS)
+    {
+        ble_dwm1001_position(pos.xMm, pos.yMm, pos.zMm, pos.qf);
+    }
+#else
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        ble_dwm1001_report(results[i].peer, (results[i].status == RNG_OK) ? results[i].distMm : 0,
+                           (results[i].status == RNG_OK) ? 100 : 0);
+    }
+
+    ble_dwm1001_flush();
+#endif
+
+    ble_coex_cycle(results, count);
+
+#if USE_CTL
+    /* Between two cycles: the reports of the next one go with the new cadence */
+    if (rng_ctl_apply(&cur) & RNG_CTL_CHG_VARS)
+    {
+        ble_batch_cfg_t batch = {
+            .count = (uint8)cur.vars[0],
+            .deadline = (uint16)cur.vars[1],
+            .delta = (uint8)cur.vars[2],
+        };
+
+        ble_dwm1001_batch_cfg(&batch);
+    }
+#endif
+}
+
+#if USE_TELEMETRY
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn evc_cb()
+ *
+ * @brief Called by the telemetry once per second, from the DW1000 IRQ work queue. Sends the rates and prints the
+ *        diagnosis when something goes wrong.
+ */
+static void evc_cb(const deca_evc_t *evc)
+{
+    ble_evc_t rates;
+
+    rates.flags = evc->flags;
+    memcpy(rates.rate, evc->rate, sizeof(rates.rate));
+    ble_dwm1001_evc(&rates);
+
+    if (evc->flags)
+    {
+        printk("EVC:%s%s%s\n", (evc->flags & DECA_EVC_RF_ERRORS) ? " RF errors" : "",
+               (evc->flags & DECA_EVC_RX_OVERRUN) ? " RX overrun" : "", (evc->flags & DECA_EVC_LATE_TX) ? " late TX" : "");
+    }
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    rng_config_t rng_cfg = RNG_CONFIG_FAST(OWN_ADDR);
+    ble_device_info_t devinfo;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("INIT FAILED");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+    dwt_setleds(1);
+
+    memset(&devinfo, 0, sizeof(ble_device_info_t));
+    devinfo.uid = APP_UID;
+    devinfo.hw_ver = APP_HW;
+    devinfo.fw1_ver = APP_VERSION_NUM;
+
+    ble_dwm1001_set_devinfo(&devinfo);
+    ble_dwm1001_batch_cfg(&ble_batch);
+#if USE_CTL
+    {
+        rng_ctl_config_t ctl_cfg = RNG_CTL_CONFIG_DEFAULT(NULL);
+        rng_ctl_settings_t cur = {
+            .rng = rng_cfg,
+            .phy = config,
+            .intervalMs = 1000 / tdma_cfg.rateHz,
+            .peerCnt = tdma_cfg.anchorCnt,
+            .vars = { ble_batch.count, ble_batch.deadline, ble_batch.delta },
+        };
+
+        /* The scheduler runs the engine: only the application values can change */
+        ctl_cfg.vars = ctl_vars;
+        ctl_cfg.varCnt = sizeof(ctl_vars) / sizeof(ctl_vars[0]);
+        memcpy(cur.peers, tdma_cfg.anchors, tdma_cfg.anchorCnt * sizeof(uint16));
+        rng_ctl_init(&ctl_cfg, &cur);
+        ble_dwm1001_cmd_cb(ctl_cmd);
+    }
+#endif
+    ble_dwm1001_enable();
+    ble_coex_init(&coex_cfg);
+
+#if USE_POSITIONING
+    rng_pos_init(&pos_cfg);
+#endif
+
+#if USE_TELEMETRY
+    {
+        deca_evc_config_t evc_cfg = DECA_EVC_CONFIG_DEFAULT;
+
+        deca_evc_start(&evc_cfg, evc_cb);
+    }
+#endif
+
+    rng_cfg.txAntDly = TX_ANT_DLY;
+    if (rng_tdma_start(&rng_cfg, &tdma_cfg, tdma_cycle_cb) != DWT_SUCCESS)
+    {
+        printk("TDMA: slots do not fit in the cycle\n");
+    }
+
+    return 0;
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The position is solved in 2D, the tag height being fixed at 1 m: with all the anchors at the same height, their distances hardly tell the
+ *    height of the tag, a 3D solve (dims at 3) needs anchors spread vertically too. A position notification is 14 bytes (BLE_POS_MARK and
+ *    ble_pos_t) against 1 + 7 per anchor for the distances, and the host has nothing left to compute. Its quality factor drops with the RMS
+ *    residual of the distances; a cycle whose residual exceeds maxResidualMm (e.g. a distance through a wall) gives no position.
+ * 2. A telemetry notification is BLE_EVC_MARK and ble_evc_t, 26 bytes. The tag transmits 4 polls and 4 finals per cycle (TXF at 80 /s) and
+ *    receives 4 responses and 4 reports (CRCG at 80 /s); errors growing against CRCG as tags are added point at collisions between cells, RX
+ *    overruns or late TX at the host running out of time, e.g. BLE connection events landing in the slots.
+ * 3. USE_CTL: "show" over BLE lists the settings, "set" changes the values of ble_batch_cfg_t, taken over at the end of the next cycle. The
+ *    answers come as notifications, BLE_CMD_MARK and the text of each line. The scheduler runs the engine here: set refuses the engine and
+ *    radio settings, and the interval and peers shown are those of tdma_cfg, not used.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_14a_main.c
+ *  @brief   Bulk data transfer benchmark, sender
+ *
+ *           Streams STREAM_BYTES of payload to example 14b at 6.8 Mbps with long frames, over and over, and prints the rate
+ *           at which the payload went out. Example 14b prints the goodput, what actually got through.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "mac_bulk.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 14a - BULK TX\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Stream PHY, see NOTE 1 below. */
+static dwt_config_t config = MAC_BULK_PHY_CONFIG;
+
+/* Addresses of examples 14a/14b. */
+#define OWN_ADDR    0x4154      /* "TA" */
+#define PEER_ADDR   0x4152      /* "RA" */
+
+/* Payload of each stream, and per frame. Up to MAC_BULK_PAYLOAD_PIPE the next frame is written while the previous one
+ * is sent, see NOTE 2 below. */
+#define STREAM_BYTES    (256 * 1024)
+#define FRAME_PAYLOAD   MAC_BULK_PAYLOAD_PIPE
+
+/* Pause between two streams, in milliseconds. */
+#define STREAM_GAP_MS   1000
+
+static uint32 stream_left;
+K_SEM_DEFINE(stream_sem, 0, 1);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn stream_fill()
+ *
+ * @brief Payload of the next frame: a counting pattern the receiver could check.
+ */
+static uint16 stream_fill(uint8 *data, uint16 max)
+{
+    uint16 len = (stream_left < max) ? (uint16)stream_left : max;
+    uint16 i;
+
+    for (i = 0; i < len; i++)
+    {
+        data[i] = (uint8)(stream_left - i);
+    }
+    stream_left -= len;
+
+    return len;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn stream_done()
+ *
+ * @brief End of a stream, from the DW1000 IRQ thread.
+ */
+static void stream_done(const mac_bulk_stats_t *stats)
+{
+    k_sem_give(&stream_sem);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    mac_bulk_config_t bulk_cfg = MAC_BULK_CONFIG_DEFAULT(OWN_ADDR, PEER_ADDR);
+    mac_bulk_stats_t stats;
+    uint32 ms;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot, then the SPI rate is raised. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("err - init failed");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setleds(1);
+
+    bulk_cfg.payloadLen = FRAME_PAYLOAD;
+
+    while (1)
+    {
+        stream_left = STREAM_BYTES;
+        if (mac_bulk_tx_start(&bulk_cfg, stream_fill, stream_done) != DWT_SUCCESS)
+        {
+            printk("err - start\n");
+            Sleep(STREAM_GAP_MS);
+            continue;
+        }
+        k_sem_take(&stream_sem, K_FOREVER);
+
+        mac_bulk_getstats(&stats);
+        ms = stats.lastMs - stats.startMs;
+        printk("tx %u frames, %u bytes in %u ms: %u kbit/s\n", stats.frames, stats.bytes, ms,
+               ms ? (stats.bytes * 8 / ms) : 0);
+
+        Sleep(STREAM_GAP_MS);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. 64 symbols of preamble at 6.8 Mbps keep the overhead of each frame to around 80 us, at the cost of range. Both sides must use the same PHY,
+ *    in long frame mode (DWT_PHRMODE_EXT) for frames above 127 bytes.
+ * 2. The TX buffer of the DW1000 is 1024 bytes long. Frames of up to 512 bytes alternate between its two halves: while one is on air, the next one
+ *    is written over SPI into the other, and sent as soon as the TX done interrupt comes. Longer frames take the whole buffer, the SPI write then
+ *    sits between two frames, which usually costs more than the shorter header overhead saves.
+ ****************************************************************************************************************************************************/
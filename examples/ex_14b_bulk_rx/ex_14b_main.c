@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_14b_main.c
+ *  @brief   Bulk data transfer benchmark, receiver
+ *
+ *           Receives the stream of example 14a with the double RX buffer and prints every second the payload goodput, the
+ *           frames lost and the RX errors.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "mac_bulk.h"
+#include "deca_rxq.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 14b - BULK RX\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Stream PHY, as example 14a. */
+static dwt_config_t config = MAC_BULK_PHY_CONFIG;
+
+/* Addresses of examples 14a/14b. */
+#define OWN_ADDR    0x4152      /* "RA" */
+#define PEER_ADDR   0x4154      /* "TA" */
+
+/* Report period, in milliseconds. */
+#define REPORT_MS   1000
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    mac_bulk_config_t bulk_cfg = MAC_BULK_CONFIG_DEFAULT(OWN_ADDR, PEER_ADDR);
+    mac_bulk_stats_t stats, last = { 0 };
+    mac_bulk_rx_t rx;
+    uint32 report_ms;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot, then the SPI rate is raised. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("err - init failed");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setleds(1);
+
+    mac_bulk_rx_start(&bulk_cfg);
+
+    report_ms = k_uptime_get_32() + REPORT_MS;
+    while (1)
+    {
+        /* The payload is only counted here, see NOTE 1 below. */
+        if (mac_bulk_rx_get(&rx, REPORT_MS) == DWT_SUCCESS)
+        {
+            deca_rxq_free(rx.frame);
+        }
+
+        if ((int32)(k_uptime_get_32() - report_ms) >= 0)
+        {
+            mac_bulk_getstats(&stats);
+            printk("rx %u kbit/s, %u frames, %u lost, %u errors\n", (stats.bytes - last.bytes) * 8 / REPORT_MS,
+                   stats.frames - last.frames, stats.lost - last.lost, stats.errors - last.errors);
+            last = stats;
+            report_ms += REPORT_MS;
+        }
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The frames are read from the RX callback into long frame buffers (CONFIG_DW1000_FRAME_EXT_COUNT in prj.conf) while the DW1000 already
+ *    receives the next one in its other RX buffer. A consumer slower than the stream runs out of buffers: the frames are then dropped, counted as
+ *    errors, and show up as lost in the block numbers.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_15a_main.c
+ *  @brief   TDoA tag
+ *
+ *           Sends a blink every 100 ms +/- 10 ms and sleeps in between, the DW1000 in DEEPSLEEP. Anchors running example
+ *           15b timestamp the blinks, the position is computed from the differences of their arrival times.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_tdoa.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 15a - TDOA TAG\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Short blinks, see NOTE 1 below. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Blinks printed between two status lines. */
+#define STATUS_BLINKS 100
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    rng_tdoa_tag_config_t tag_cfg = RNG_TDOA_TAG_CONFIG_DEFAULT(0);
+    rng_tdoa_tag_stats_t stats;
+    uint64_t id;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot, then the SPI rate is raised. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("err - init failed");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+
+    /* Tag ID from the lot ID and part number, see NOTE 2 below. */
+    id = ((uint64_t)dwt_getlotid() << 32) | dwt_getpartid();
+    tag_cfg.id = id;
+    rng_tdoa_tag_init(&tag_cfg);
+    printk("tag %08x%08x\n", (uint32)(id >> 32), (uint32)id);
+
+    while (1)
+    {
+        k_sleep(rng_tdoa_blink());
+
+        rng_tdoa_tag_getstats(&stats);
+        if ((stats.blinks % STATUS_BLINKS) == 0)
+        {
+            printk("%u blinks, %u wake-up failures\n", stats.blinks, stats.wakeFails);
+        }
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The anchors must use the same PHY. 128 symbols of preamble at 6.8 Mbps keep a blink to about 170 us on air; the standard PHY header is
+ *    enough for a 12-byte frame.
+ * 2. As NOTE 1 of example 1c says, the lot ID and part number are not guaranteed unique across vendors; a product would use an EUI-64 of its
+ *    own block.
+ ****************************************************************************************************************************************************/
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ * 
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_15b_main.c
+ *  @brief   TDoA anchor
+ *
+ *           Listens for the blinks of example 15a tags and prints them in batches with their RX timestamps, as an anchor
+ *           would forward them to the positioning engine. The anchor whose ID is REF_ANCHOR_ID sends sync frames, or
+ *           pulses the SYNC line of wired anchors, the others report their timestamps in its timebase.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_tdoa.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 15b - TDOA ANCHOR\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* PHY of example 15a. */
+static dwt_config_t config = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* Longest time a blink waits before being forwarded, see NOTE 1 below. */
+#define BATCH_MS 200
+
+/* Default antenna delay values for 64 MHz PRF, as the ranging examples. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+/* Clock synchronisation, see NOTE 3 below: ID of the reference anchor (its lot ID and part number, printed at start-up),
+ * its sync period and the surveyed distance from this anchor to it. */
+#define REF_ANCHOR_ID   0x0000000000000000ULL
+#define SYNC_MS         100
+#define REF_DIST_MM     5000
+
+/* 1 for anchors sharing the reference clock and a SYNC line instead of the sync frames, see NOTE 4 below. */
+#define WIRED_SYNC      0
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn batch_cb()
+ *
+ * @brief Batch of blinks, from the DW1000 IRQ thread: print it, see NOTE 2 below.
+ */
+static void batch_cb(const rng_tdoa_rx_t *rx, uint8 count)
+{
+    uint8 i;
+
+    for (i = 0; i < count; i++)
+    {
+        printk("%08x%08x %3u %02x%08x%s\n", (uint32)(rx[i].tagId >> 32), (uint32)rx[i].tagId, rx[i].seq,
+               (uint32)(rx[i].rxTs >> 32), (uint32)rx[i].rxTs, rx[i].synced ? "" : " (own clock)");
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+#if WIRED_SYNC
+    rng_tdoa_wired_config_t wired_cfg;
+#else
+    rng_tdoa_sync_config_t sync_cfg;
+#endif
+    uint64_t id;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot, with the LDE microcode (CONFIG_DW1000_LOAD_UCODE), then
+     * the SPI rate is raised. */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("err - init failed");
+        while (1)
+        { };
+    }
+
+    dwt_configure(&config);
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+    dwt_setleds(1);
+
+    id = ((uint64_t)dwt_getlotid() << 32) | dwt_getpartid();
+    printk("anchor %08x%08x\n", (uint32)(id >> 32), (uint32)id);
+
+    rng_tdoa_anchor_start(BATCH_MS, batch_cb);
+
+#if WIRED_SYNC
+    wired_cfg = (rng_tdoa_wired_config_t)RNG_TDOA_WIRED_CONFIG_DEFAULT(id == REF_ANCHOR_ID);
+    if (rng_tdoa_anchor_wiredsync(&wired_cfg) != DWT_SUCCESS)
+    {
+        printk("err - no SYNC line\n");
+    }
+#else
+    sync_cfg.ownId = id;
+    sync_cfg.refId = REF_ANCHOR_ID;
+    sync_cfg.syncMs = SYNC_MS;
+    sync_cfg.refDistMm = (id == REF_ANCHOR_ID) ? 0 : REF_DIST_MM;
+    sync_cfg.txAntDly = TX_ANT_DLY;
+    sync_cfg.phy = &config;
+    rng_tdoa_anchor_sync(&sync_cfg);
+#endif
+
+    while (1)
+    {
+        k_sleep(K_FOREVER);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. A batch is handed over once RNG_TDOA_BATCH_MAX blinks are in (CONFIG_DW1000_TDOA_BATCH) or BATCH_MS after its first one, whichever
+ *    comes first: the backhaul sees one message per batch rather than one per blink.
+ * 2. The callback runs in the DW1000 IRQ thread, with the receiver already on again for the next blink. Printing is slow: a real anchor
+ *    would copy the batch to its backhaul queue and return.
+ * 3. All anchors must hear the reference. Each one models the reference clock from its sync frames: offset from the TX timestamp they carry
+ *    plus the time of flight over REF_DIST_MM, skew from the interval between two of them (the carrier integrator for the first one). Blinks
+ *    are then reported in the reference timebase and can be compared across anchors as they are; until the first sync, and after
+ *    RNG_TDOA_SYNC_LOST periods without one, they are in the anchor's own clock. rng_tdoa_anchor_getstats() gives the skew and the error of
+ *    the model at the last sync.
+ * 4. Wired anchors share the 38.4 MHz reference clock and a SYNC line driven by the reference (sync-gpios in the devicetree): each SYNC
+ *    pulse restarts all their system times on the same clock edge, no sync frame takes airtime and there is no skew to model. Each anchor
+ *    adds the delay of its lines against the reference (lineDlyDtu, surveyed once, 0 here).
+ ****************************************************************************************************************************************************/
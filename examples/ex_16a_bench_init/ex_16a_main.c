@@ -0,0 +1,398 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ *
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_16a_main.c
+ *  @brief   Ranging benchmark, initiator side
+ *
+ *           Runs a fixed scenario matrix against a responder running example 16b: SS-TWR and DS-TWR, over the PHY profiles
+ *           below, at two SPI rates, with the ranging engine run from the DW1000 interrupt or polled by the application
+ *           thread. Each scenario ranges back to back for BENCH_RUN_MS and prints one machine readable line: exchanges per
+ *           second, success ratio, mean exchange time and CPU idle share. See NOTE 1 below.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_twr.h"
+
+#include <zephyr.h>
+#include <string.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 16a - BENCH INIT\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_VERSION_NUM 0x010000
+#define APP_LINE "=================\n"
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+/* Addresses of example 5a/5b. */
+#define OWN_ADDR    RNG_ADDR('V', 'E')
+#define PEER_ADDR   RNG_ADDR('W', 'A')
+
+/* Scenario timing: the responder switches to the scenario PHY within BENCH_SETTLE_MS of its acknowledgement, listens
+ * BENCH_RUN_MS and BENCH_GUARD_MS more, then goes back to the control PHY. Must match example 16b. */
+#define BENCH_SETTLE_MS     50
+#define BENCH_RUN_MS        5000
+#define BENCH_GUARD_MS      200
+
+/* Control frames, on the control PHY: start (scenario, PHY profile index, run time) and its acknowledgement. */
+#define BENCH_FC_START      0xB0
+#define BENCH_FC_ACK        0xB1
+#define BENCH_MSG_SCEN_IDX  10
+#define BENCH_MSG_PHY_IDX   11
+#define BENCH_MSG_RUN_IDX   12
+#define BENCH_MSG_LEN       16
+#define BENCH_CTRL_TRIES    100
+#define BENCH_CTRL_RX_UUS   5000
+
+/* Calibration of the idle counter, radio idle. */
+#define BENCH_CAL_MS        500
+
+/* Control PHY, as example 5a with the standard PHY header. */
+static dwt_config_t ctrl_phy = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* PHY profiles and the ranging delays that fit them, see NOTE 2 below. Must match example 16b. */
+typedef struct
+{
+    const char *name;
+    dwt_config_t phy;
+    uint16 dlyUus;                      // DS-TWR reply delays
+    uint16 ssDlyUus;                    // SS-TWR reply delay
+    uint16 airUus;                      // preamble, SFD and the longest frame
+} bench_phy_t;
+
+static bench_phy_t bench_phys[] = {
+    { "6M8/128",   { 5, DWT_PRF_64M, DWT_PLEN_128,  DWT_PAC8,  9, 9, 1, DWT_BR_6M8,  DWT_PHRMODE_STD, 129  }, 1500,  700,  200 },
+    { "6M8/1024",  { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_6M8,  DWT_PHRMODE_STD, 1001 }, 2500, 2300, 1200 },
+    { "850k/256",  { 5, DWT_PRF_64M, DWT_PLEN_256,  DWT_PAC16, 9, 9, 1, DWT_BR_850K, DWT_PHRMODE_STD, 257  }, 2500, 2000,  600 },
+    { "110k/1024", { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_110K, DWT_PHRMODE_STD, 1057 }, 6000, 5500, 3500 },
+};
+#define BENCH_PHY_NUM       (sizeof(bench_phys) / sizeof(bench_phys[0]))
+
+/* Outcome of the exchanges of a scenario, updated from the result callback. */
+typedef struct
+{
+    uint32 attempts;
+    uint32 ok;
+    uint64_t cycSum;                    // exchange times of the successful ones, k_cycle_get_32() cycles
+} bench_res_t;
+
+static bench_res_t res;
+static uint32 start_cyc;
+static volatile uint8 done;
+static K_SEM_DEFINE(done_sem, 0, 1);
+
+static uint8 tx_msg[BENCH_MSG_LEN] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', BENCH_FC_START, 0, 0, 0, 0, 0, 0};
+static uint8 rx_buffer[BENCH_MSG_LEN];
+
+/* Counted by the lowest priority thread: the CPU time nothing else wants. See NOTE 3 below. */
+static volatile uint32 idle_cnt;
+
+static void bench_idle_thread(void *p1, void *p2, void *p3)
+{
+    while (1)
+    {
+        idle_cnt++;
+    }
+}
+
+K_THREAD_DEFINE(bench_idle_tid, 256, bench_idle_thread, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0,
+                K_NO_WAIT);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bench_timings()
+ *
+ * @brief Ranging delays of a PHY profile: the RX of each side turns on between the end of the frame it sent and the
+ *        preamble of the reply, the timeouts cover the reply.
+ */
+static void bench_timings(rng_config_t *cfg, const bench_phy_t *p)
+{
+    cfg->pollRxToRespTxDlyUus = p->dlyUus;
+    cfg->respRxToFinalTxDlyUus = p->dlyUus;
+    cfg->pollTxToRespRxDlyUus = p->dlyUus - p->airUus - 300;
+    cfg->respTxToFinalRxDlyUus = p->dlyUus - p->airUus - 300;
+    cfg->respRxTimeoutUus = 2 * p->airUus + 500;
+    cfg->finalRxTimeoutUus = 2 * p->airUus + 500;
+    cfg->reportRxTimeoutUus = 2 * p->airUus + 1500;
+    cfg->ssPollRxToRespTxDlyUus = p->ssDlyUus;
+    cfg->ssPollTxToRespRxDlyUus = p->ssDlyUus - p->airUus - 300;
+    cfg->ssRespRxTimeoutUus = 2 * p->airUus + 500;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bench_ctrl()
+ *
+ * @brief Start a scenario on the responder, polled on the control PHY: send the start frame until it is acknowledged.
+ *
+ * returns 0 once acknowledged, -1 if the responder did not answer
+ */
+static int bench_ctrl(uint8 scen, uint8 phy_idx)
+{
+    uint32 status_reg;
+    int i;
+
+    tx_msg[BENCH_MSG_SCEN_IDX] = scen;
+    tx_msg[BENCH_MSG_PHY_IDX] = phy_idx;
+    tx_msg[BENCH_MSG_RUN_IDX] = (uint8)(BENCH_RUN_MS & 0xFF);
+    tx_msg[BENCH_MSG_RUN_IDX + 1] = (uint8)(BENCH_RUN_MS >> 8);
+
+    dwt_setrxaftertxdelay(0);
+    dwt_setrxtimeout(BENCH_CTRL_RX_UUS);
+
+    for (i = 0; i < BENCH_CTRL_TRIES; i++)
+    {
+        tx_msg[RNG_MSG_SN_IDX]++;
+        dwt_writetxdata(sizeof(tx_msg), tx_msg, 0);
+        dwt_writetxfctrl(sizeof(tx_msg), 0, 0);
+        dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+
+        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR)))
+        { };
+
+        if (status_reg & SYS_STATUS_RXFCG)
+        {
+            uint32 frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFL_MASK_1023;
+
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG | SYS_STATUS_ALL_TX);
+            if (frame_len == BENCH_MSG_LEN)
+            {
+                dwt_readrxdata(rx_buffer, frame_len, 0);
+                if ((rx_buffer[RNG_MSG_FC_IDX] == BENCH_FC_ACK) && (rx_buffer[BENCH_MSG_SCEN_IDX] == scen))
+                {
+                    return 0;
+                }
+            }
+        }
+        else
+        {
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_TX);
+            dwt_rxreset();
+        }
+
+        /* The responder may still be listening on the previous scenario PHY */
+        Sleep(BENCH_GUARD_MS / 4);
+    }
+
+    return -1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_result_cb()
+ *
+ * @brief Called by the ranging engine at the end of each exchange, from the DW1000 IRQ thread or, polled, from the
+ *        application thread.
+ */
+static void rng_result_cb(const rng_result_t *result)
+{
+    if (result->status == RNG_OK)
+    {
+        res.ok++;
+        res.cycSum += k_cycle_get_32() - start_cyc;
+    }
+    done = 1;
+    k_sem_give(&done_sem);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bench_run()
+ *
+ * @brief Range back to back for BENCH_RUN_MS, the engine run from the DW1000 interrupt or polled.
+ */
+static void bench_run(uint8 polled)
+{
+    uint32 end = k_uptime_get_32() + BENCH_RUN_MS;
+
+    memset(&res, 0, sizeof(res));
+
+    while ((int32)(k_uptime_get_32() - end) < 0)
+    {
+        done = 0;
+        k_sem_reset(&done_sem);
+        start_cyc = k_cycle_get_32();
+        if (rng_initiate(PEER_ADDR) != DWT_SUCCESS)
+        {
+            rng_stop();
+            continue;
+        }
+        res.attempts++;
+
+        if (polled)
+        {
+            while (!done)
+            {
+                if (port_CheckEXT_IRQ())
+                {
+                    process_deca_irq();
+                }
+            }
+        }
+        else if (k_sem_take(&done_sem, K_MSEC(100)) != 0)
+        {
+            /* No end reported: count it as failed and start over */
+            rng_stop();
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    uint32 idle_base, idle_start;
+    uint8 scen = 0;
+    int mode, p, spi, polled;
+
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("INIT FAILED");
+        while (1)
+        { };
+    }
+
+    /* Idle counts per second with nothing to do */
+    idle_start = idle_cnt;
+    Sleep(BENCH_CAL_MS);
+    idle_base = MAX((idle_cnt - idle_start) / BENCH_CAL_MS, 1);
+
+    printk("BENCH,version,%06x,%08x,%u\n", APP_VERSION_NUM, dwt_apiversion(), BENCH_RUN_MS);
+    printk("BENCH,scenario,mode,phy,spi,ctx,attempts,ok,exch_per_s,success_pct,exch_us,idle_pct\n");
+
+    while (1)
+    {
+        for (mode = RNG_MODE_DS; mode <= RNG_MODE_SS; mode++)
+        for (p = 0; p < BENCH_PHY_NUM; p++)
+        for (spi = 0; spi < 2; spi++)
+        for (polled = 0; polled < 2; polled++)
+        {
+            rng_config_t rng_cfg = RNG_CONFIG_DEFAULT(OWN_ADDR);
+            uint32 rate, succ, exch_us, idle_pct;
+
+            scen++;
+
+            /* Control exchange polled, fast SPI */
+            port_DisableEXT_IRQ();
+            port_set_dw1000_fastrate();
+            dwt_configure(&ctrl_phy);
+            dwt_setrxantennadelay(RX_ANT_DLY);
+            dwt_settxantennadelay(TX_ANT_DLY);
+            if (bench_ctrl(scen, p) != 0)
+            {
+                printk("BENCH,%u,no responder\n", scen);
+                continue;
+            }
+
+            dwt_configure(&bench_phys[p].phy);
+            rng_cfg.txAntDly = TX_ANT_DLY;
+            rng_cfg.report = 1;
+            bench_timings(&rng_cfg, &bench_phys[p]);
+            rng_init(&rng_cfg, rng_result_cb);
+            rng_setphy(&bench_phys[p].phy);
+            rng_setlinkmode(PEER_ADDR, (rng_mode_t)mode);
+
+            if (spi)
+            {
+                port_set_dw1000_slowrate();
+            }
+            if (polled)
+            {
+                port_DisableEXT_IRQ();
+            }
+            else
+            {
+                port_EnableEXT_IRQ();
+            }
+
+            Sleep(BENCH_SETTLE_MS);
+            idle_start = idle_cnt;
+            bench_run(polled);
+            idle_pct = MIN((idle_cnt - idle_start) / BENCH_RUN_MS * 100 / idle_base, 100);
+            rng_stop();
+
+            rate = res.ok * 100000 / BENCH_RUN_MS;
+            succ = res.attempts ? (res.ok * 100 / res.attempts) : 0;
+            exch_us = res.ok ? (uint32)(res.cycSum * 1000000 / sys_clock_hw_cycles_per_sec() / res.ok) : 0;
+
+            printk("BENCH,%u,%s,%s,%s,%s,%u,%u,%u.%02u,%u,%u,%u\n", scen, (mode == RNG_MODE_SS) ? "SS" : "DS",
+                   bench_phys[p].name, spi ? "2M" : "8M", polled ? "poll" : "irq", res.attempts, res.ok, rate / 100,
+                   rate % 100, succ, exch_us, idle_pct);
+
+            /* Let the responder leave the scenario PHY */
+            Sleep(BENCH_GUARD_MS);
+        }
+
+        printk("BENCH,end\n");
+        scen = 0;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The output lines all start with BENCH, comma separated: a version line (application, driver API, run time in ms), a header line, then
+ *    one line per scenario, and an end line once the matrix is done, after which it starts over. A host collects them from the console and
+ *    compares two firmware builds line by line. The exchanges are counted on the initiator: DS-TWR uses the report (4 messages), so that
+ *    success means the distance came back to the initiator as in SS-TWR. The exchange time runs from rng_initiate() to the result, in
+ *    32768 Hz cycles averaged over the run. The SPI rate only applies to the initiator, the responder stays at the fast rate: a scenario
+ *    measures the initiator.
+ * 2. The reply delays leave the side that receives a frame room to read it and arm the reply: one frame, the ISR and the SPI accesses, then
+ *    the preamble of the reply sent before its timestamp. Their figures cover the 2 MHz SPI rate and the polled mode; with the adaptive delays
+ *    of the ranging engine (rng_config_t.adapt) they would shrink to what each scenario needs, which is the better figure for exchange rate
+ *    comparisons but would blur the SPI and ISR comparisons.
+ * 3. The idle counter is a busy loop at the lowest application priority: against the counts per ms of the BENCH_CAL_MS calibration, its count
+ *    during a run gives the CPU share left over by the DW1000 IRQ work queue, the SPI and the application. In polled mode the application
+ *    thread spins on the IRQ line and leaves nothing, which is the point of the comparison. The loop also keeps the CPU out of sleep, the
+ *    benchmark does not measure power.
+ ****************************************************************************************************************************************************/
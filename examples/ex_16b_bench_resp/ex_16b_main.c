@@ -0,0 +1,256 @@
+/**
+ * Copyright (c) 2019 - Frederic Mes, RTLOC
+ *
+ * This file is part of Zephyr-DWM1001.
+ *
+ *   Zephyr-DWM1001 is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Zephyr-DWM1001 is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Zephyr-DWM1001.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*! ----------------------------------------------------------------------------
+ *  @file    ex_16b_main.c
+ *  @brief   Ranging benchmark, responder side
+ *
+ *           Waits on the control PHY for the start frames of example 16a. Each one names a scenario and a PHY profile:
+ *           the responder acknowledges it, answers the polls on that PHY with the ranging engine for the run time, then
+ *           goes back to the control PHY. It always runs from the DW1000 interrupt at the fast SPI rate, see NOTE 1 below.
+ *
+ * All rights reserved.
+ *
+ * @author RTLOC
+ */
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "port.h"
+#include "dw1000_drv.h"
+#include "rng_twr.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+/* Example application name and version to display on console. */
+#define APP_HEADER "\nDWM1001 & Zephyr\n"
+#define APP_NAME "Example 16b - BENCH RESP\n"
+#define APP_VERSION "Version - 1.0\n"
+#define APP_LINE "=================\n"
+
+/* Default antenna delay values for 64 MHz PRF. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+/* Address of example 5b. */
+#define OWN_ADDR    RNG_ADDR('W', 'A')
+
+/* Scenario timing, must match example 16a. */
+#define BENCH_SETTLE_MS     50
+#define BENCH_GUARD_MS      200
+
+/* Control frames, must match example 16a. */
+#define BENCH_FC_START      0xB0
+#define BENCH_FC_ACK        0xB1
+#define BENCH_MSG_SCEN_IDX  10
+#define BENCH_MSG_PHY_IDX   11
+#define BENCH_MSG_RUN_IDX   12
+#define BENCH_MSG_LEN       16
+
+/* Control PHY, as example 5b with the standard PHY header. */
+static dwt_config_t ctrl_phy = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+
+/* PHY profiles and the ranging delays that fit them, see NOTE 2 of example 16a. Must match example 16a. */
+typedef struct
+{
+    const char *name;
+    dwt_config_t phy;
+    uint16 dlyUus;                      // DS-TWR reply delays
+    uint16 ssDlyUus;                    // SS-TWR reply delay
+    uint16 airUus;                      // preamble, SFD and the longest frame
+} bench_phy_t;
+
+static bench_phy_t bench_phys[] = {
+    { "6M8/128",   { 5, DWT_PRF_64M, DWT_PLEN_128,  DWT_PAC8,  9, 9, 1, DWT_BR_6M8,  DWT_PHRMODE_STD, 129  }, 1500,  700,  200 },
+    { "6M8/1024",  { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_6M8,  DWT_PHRMODE_STD, 1001 }, 2500, 2300, 1200 },
+    { "850k/256",  { 5, DWT_PRF_64M, DWT_PLEN_256,  DWT_PAC16, 9, 9, 1, DWT_BR_850K, DWT_PHRMODE_STD, 257  }, 2500, 2000,  600 },
+    { "110k/1024", { 5, DWT_PRF_64M, DWT_PLEN_1024, DWT_PAC32, 9, 9, 1, DWT_BR_110K, DWT_PHRMODE_STD, 1057 }, 6000, 5500, 3500 },
+};
+#define BENCH_PHY_NUM       (sizeof(bench_phys) / sizeof(bench_phys[0]))
+
+static uint8 rx_buffer[BENCH_MSG_LEN];
+static volatile uint32 ok_cnt;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bench_timings()
+ *
+ * @brief Ranging delays of a PHY profile, as example 16a.
+ */
+static void bench_timings(rng_config_t *cfg, const bench_phy_t *p)
+{
+    cfg->pollRxToRespTxDlyUus = p->dlyUus;
+    cfg->respRxToFinalTxDlyUus = p->dlyUus;
+    cfg->pollTxToRespRxDlyUus = p->dlyUus - p->airUus - 300;
+    cfg->respTxToFinalRxDlyUus = p->dlyUus - p->airUus - 300;
+    cfg->respRxTimeoutUus = 2 * p->airUus + 500;
+    cfg->finalRxTimeoutUus = 2 * p->airUus + 500;
+    cfg->reportRxTimeoutUus = 2 * p->airUus + 1500;
+    cfg->ssPollRxToRespTxDlyUus = p->ssDlyUus;
+    cfg->ssPollTxToRespRxDlyUus = p->ssDlyUus - p->airUus - 300;
+    cfg->ssRespRxTimeoutUus = 2 * p->airUus + 500;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bench_wait_start()
+ *
+ * @brief Listen on the control PHY, polled, until a start frame comes, and acknowledge it.
+ *
+ * returns the run time of the scenario in ms; scen and phy_idx are set from the frame
+ */
+static uint16 bench_wait_start(uint8 *scen, uint8 *phy_idx)
+{
+    uint32 status_reg;
+
+    while (1)
+    {
+        dwt_setrxtimeout(0);
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_ERR)))
+        { };
+
+        if (status_reg & SYS_STATUS_RXFCG)
+        {
+            uint32 frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFL_MASK_1023;
+
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG);
+            if (frame_len != BENCH_MSG_LEN)
+            {
+                continue;
+            }
+            dwt_readrxdata(rx_buffer, frame_len, 0);
+            if ((rx_buffer[RNG_MSG_FC_IDX] != BENCH_FC_START) || (rx_buffer[BENCH_MSG_PHY_IDX] >= BENCH_PHY_NUM))
+            {
+                continue;
+            }
+
+            /* Acknowledge with the same frame, addresses swapped */
+            rx_buffer[RNG_MSG_FC_IDX] = BENCH_FC_ACK;
+            rx_buffer[5] = 'V';
+            rx_buffer[6] = 'E';
+            rx_buffer[7] = 'W';
+            rx_buffer[8] = 'A';
+            dwt_writetxdata(sizeof(rx_buffer), rx_buffer, 0);
+            dwt_writetxfctrl(sizeof(rx_buffer), 0, 0);
+            dwt_starttx(DWT_START_TX_IMMEDIATE);
+            while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS))
+            { };
+            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS);
+
+            *scen = rx_buffer[BENCH_MSG_SCEN_IDX];
+            *phy_idx = rx_buffer[BENCH_MSG_PHY_IDX];
+            return (uint16)(rx_buffer[BENCH_MSG_RUN_IDX] | (rx_buffer[BENCH_MSG_RUN_IDX + 1] << 8));
+        }
+
+        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
+        dwt_rxreset();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_result_cb()
+ *
+ * @brief Called by the ranging engine at the end of each exchange, from the DW1000 IRQ thread.
+ */
+static void rng_result_cb(const rng_result_t *result)
+{
+    if (result->status == RNG_OK)
+    {
+        ok_cnt++;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_main()
+ *
+ * @brief Application entry point.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+int dw_main(void)
+{
+    /* Display application name on console. */
+    printk(APP_HEADER);
+    printk(APP_NAME);
+    printk(APP_VERSION);
+    printk(APP_LINE);
+
+    /* The DW1000 driver initialises the DW1000 during boot (CONFIG_DW1000_LOAD_UCODE in prj.conf). */
+    if (dw1000_wait_ready(DW1000_WAIT_FOREVER) != 0)
+    {
+        printk("INIT FAILED");
+        while (1)
+        { };
+    }
+
+    port_set_dw1000_fastrate();
+
+    while (1)
+    {
+        rng_config_t rng_cfg = RNG_CONFIG_DEFAULT(OWN_ADDR);
+        uint8 scen, p;
+        uint16 run_ms;
+
+        port_DisableEXT_IRQ();
+        dwt_configure(&ctrl_phy);
+        dwt_setrxantennadelay(RX_ANT_DLY);
+        dwt_settxantennadelay(TX_ANT_DLY);
+        run_ms = bench_wait_start(&scen, &p);
+
+        dwt_configure(&bench_phys[p].phy);
+        rng_cfg.txAntDly = TX_ANT_DLY;
+        rng_cfg.report = 1;
+        bench_timings(&rng_cfg, &bench_phys[p]);
+        rng_init(&rng_cfg, rng_result_cb);
+        rng_setphy(&bench_phys[p].phy);
+        ok_cnt = 0;
+        port_EnableEXT_IRQ();
+        rng_respond();
+
+        Sleep(BENCH_SETTLE_MS + run_ms + BENCH_GUARD_MS);
+        rng_stop();
+
+        printk("BENCH,%u,%s,resp,%u\n", scen, bench_phys[p].name, ok_cnt);
+    }
+}
+
+/*****************************************************************************************************************************************************
+ * NOTES:
+ *
+ * 1. The responder is the fixed half of each scenario: whatever the initiator tests (SPI rate, polled or interrupt driven engine), the
+ *    responder answers the same way, so that the differences between the lines of example 16a come from the initiator. Its own line per
+ *    DS-TWR scenario gives the exchanges it completed, which tells a lost poll, response or final (not counted here) from a lost report
+ *    (counted here). The SS-TWR polls are answered whatever the mode selected, the responder needs no setting for them, but it computes
+ *    nothing and reports nothing: its count stays 0 for those scenarios.
+ ****************************************************************************************************************************************************/
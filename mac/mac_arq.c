@@ -0,0 +1,508 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_arq.c
+ * @brief   Reliable datagrams over the DW1000 auto-acknowledgement
+ *
+ *          window:  | head: sent, waiting for its ACK | queued | queued | free |
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "mac_arq.h"
+#include "deca_regs.h"
+#include "port.h"
+
+// Events the link runs on
+#define MAC_ARQ_INT_MASK    (DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO | DWT_INT_RPHE | DWT_INT_RFCE | \
+                             DWT_INT_RFSL | DWT_INT_SFDT | DWT_INT_ARFE)
+
+// Frame control: data frame with ACK request, 16-bit addressing, PAN ID compression (example 7a) / ACK frame
+#define MAC_ARQ_FC_DATA_0   0x61
+#define MAC_ARQ_FC_1        0x88
+#define MAC_ARQ_FC_ACK_0    0x02
+#define MAC_ARQ_FC_ACK_1    0x00
+#define MAC_ARQ_FC_TYPE     0x07
+#define MAC_ARQ_FC_ACK_REQ  0x20
+
+#define MAC_ARQ_ADDR_BCAST  0xFFFF
+
+typedef enum
+{
+    MAC_ARQ_IDLE,
+    MAC_ARQ_LISTEN,                     // receiver on, nothing to send
+    MAC_ARQ_WAIT_ACK,                   // head of the window sent, receiver on for its ACK
+    MAC_ARQ_ACK_TX                      // DW1000 acknowledging a frame received
+} mac_arq_state_t;
+
+typedef struct
+{
+    uint16 addr;
+    uint8 seq;                          // last one delivered
+    uint8 valid;
+} mac_arq_peer_t;
+
+typedef struct
+{
+    mac_arq_config_t cfg;
+    mac_arq_tx_cb_t txCb;
+    mac_arq_rx_cb_t rxCb;
+    volatile mac_arq_state_t state;
+    uint8 listen;                       // mac_arq_listen() called
+    uint8 ackLost;                      // a frame came in instead of the ACK of the head, send the head again
+    uint8 seq;                          // sequence number of the next frame queued
+    // window
+    deca_frame_t *win[MAC_ARQ_WINDOW];
+    uint8 tries[MAC_ARQ_WINDOW];
+    uint8 head;
+    uint8 cnt;
+    // receiver
+    mac_arq_peer_t peers[MAC_ARQ_PEERS];
+    uint8 nextPeer;                     // entry replaced by the next new sender
+    mac_arq_stats_t stats;
+} mac_arq_local_t;
+
+static mac_arq_local_t arq;
+
+K_SEM_DEFINE(arq_win_sem, MAC_ARQ_WINDOW, MAC_ARQ_WINDOW);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_rxon()
+ *
+ * @brief Receiver on for frames, without timeout.
+ */
+static void arq_rxon(void)
+{
+    arq.state = MAC_ARQ_LISTEN;
+    dwt_setrxtimeout(0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_txhead()
+ *
+ * @brief Send the frame at the head of the window, the receiver turns on for its ACK at the end of the TX.
+ */
+static void arq_txhead(void)
+{
+    deca_frame_t *frame = arq.win[arq.head];
+
+    dwt_writetxdata(frame->len, frame->data, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(frame->len, 0, 0); /* Zero offset in TX buffer, no ranging. */
+    dwt_setrxaftertxdelay(0);
+    dwt_setrxtimeout(arq.cfg.ackTimeoutUus);
+
+    arq.state = MAC_ARQ_WAIT_ACK;
+    arq.tries[arq.head]++;
+    arq.stats.txFrames++;
+    dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_next()
+ *
+ * @brief Go on with the next frame of the window, or listen, or go idle.
+ */
+static void arq_next(void)
+{
+    if (arq.cnt > 0)
+    {
+        arq_txhead();
+    }
+    else if (arq.listen)
+    {
+        arq_rxon();
+    }
+    else
+    {
+        arq.state = MAC_ARQ_IDLE;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_done()
+ *
+ * @brief Take the head out of the window and report it, the window has room for one more frame.
+ */
+static void arq_done(mac_arq_status_t status)
+{
+    deca_frame_t *frame = arq.win[arq.head];
+    mac_arq_tx_t tx;
+
+    tx.dst = frame->data[MAC_ARQ_DST_IDX] | (frame->data[MAC_ARQ_DST_IDX + 1] << 8);
+    tx.seq = frame->data[MAC_ARQ_SN_IDX];
+    tx.tries = arq.tries[arq.head];
+    tx.status = status;
+
+    deca_frame_unref(frame);
+    arq.win[arq.head] = NULL;
+    arq.head = (arq.head + 1) % MAC_ARQ_WINDOW;
+    arq.cnt--;
+    k_sem_give(&arq_win_sem);
+
+    if (arq.txCb != NULL)
+    {
+        arq.txCb(&tx);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_noack()
+ *
+ * @brief The head was not acknowledged: send it again, or fail it after the last retry and go on.
+ */
+static void arq_noack(void)
+{
+    if (arq.tries[arq.head] > arq.cfg.retries)
+    {
+        arq.stats.txFailed++;
+        arq_done(MAC_ARQ_ERR_NOACK);
+        arq_next();
+    }
+    else
+    {
+        arq.stats.txRetries++;
+        arq_txhead();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_isdup()
+ *
+ * @brief Check a frame against the last sequence number of its sender, and record it.
+ *
+ * returns 1 if the frame was already delivered
+ */
+static int arq_isdup(uint16 src, uint8 seq)
+{
+    mac_arq_peer_t *peer;
+    int i;
+
+    for (i = 0; i < MAC_ARQ_PEERS; i++)
+    {
+        peer = &arq.peers[i];
+        if (peer->valid && (peer->addr == src))
+        {
+            if (peer->seq == seq)
+            {
+                return 1;
+            }
+            peer->seq = seq;
+            return 0;
+        }
+    }
+
+    peer = &arq.peers[arq.nextPeer];
+    arq.nextPeer = (arq.nextPeer + 1) % MAC_ARQ_PEERS;
+    peer->addr = src;
+    peer->seq = seq;
+    peer->valid = 1;
+    return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_rxdata()
+ *
+ * @brief Read a data frame, the filter has already checked its PAN ID and destination, and deliver it unless it is
+ *        a duplicate.
+ */
+static void arq_rxdata(const dwt_cb_data_t *cb_data)
+{
+    deca_frame_t *frame;
+    mac_arq_rx_t rx;
+
+    frame = deca_frame_alloc(cb_data->datalength, K_NO_WAIT);
+    if (frame == NULL)
+    {
+        /* Acknowledged by the DW1000 all the same, the sender will not send it again */
+        arq.stats.rxDropped++;
+        return;
+    }
+    dwt_readrxdata(frame->data, cb_data->datalength, 0);
+    frame->status = cb_data->status;
+
+    rx.src = frame->data[MAC_ARQ_SRC_IDX] | (frame->data[MAC_ARQ_SRC_IDX + 1] << 8);
+    rx.seq = frame->data[MAC_ARQ_SN_IDX];
+    if (arq_isdup(rx.src, rx.seq))
+    {
+        arq.stats.rxDups++;
+    }
+    else
+    {
+        arq.stats.rxFrames++;
+        if (arq.rxCb != NULL)
+        {
+            rx.data = &frame->data[MAC_ARQ_HDR_LEN];
+            rx.len = cb_data->datalength - MAC_ARQ_HDR_LEN - MAC_ARQ_CRC_LEN;
+            rx.frame = frame;
+            arq.rxCb(&rx);
+        }
+    }
+    deca_frame_unref(frame);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_rxok_cb()
+ *
+ * @brief Good frame: the ACK of the head, or a data frame for us.
+ */
+static void arq_rxok_cb(const dwt_cb_data_t *cb_data)
+{
+    mac_arq_state_t state = arq.state;
+    uint8 ack[MAC_ARQ_SN_IDX + 1];
+
+    if ((cb_data->fctrl[0] == MAC_ARQ_FC_ACK_0) && (cb_data->fctrl[1] == MAC_ARQ_FC_ACK_1) &&
+        (cb_data->datalength == MAC_ARQ_ACK_LEN))
+    {
+        if (state != MAC_ARQ_WAIT_ACK)
+        {
+            arq_next();
+            return;
+        }
+
+        dwt_readrxdata(ack, sizeof(ack), 0);
+        if (ack[MAC_ARQ_SN_IDX] == arq.win[arq.head]->data[MAC_ARQ_SN_IDX])
+        {
+            arq.stats.txAcked++;
+            arq_done(MAC_ARQ_OK);
+            arq_next();
+        }
+        else
+        {
+            arq_noack();
+        }
+        return;
+    }
+
+    if (((cb_data->fctrl[0] & MAC_ARQ_FC_TYPE) == (MAC_ARQ_FC_DATA_0 & MAC_ARQ_FC_TYPE)) &&
+        (cb_data->datalength >= MAC_ARQ_HDR_LEN + MAC_ARQ_CRC_LEN))
+    {
+        arq_rxdata(cb_data);
+
+        /* Wait for the end of the ACK TX before using the transceiver again, see NOTE 8 of example 7b */
+        if (cb_data->fctrl[0] & MAC_ARQ_FC_ACK_REQ)
+        {
+            arq.ackLost = (state == MAC_ARQ_WAIT_ACK);
+            arq.state = MAC_ARQ_ACK_TX;
+            return;
+        }
+    }
+
+    if (state == MAC_ARQ_WAIT_ACK)
+    {
+        arq_noack();
+    }
+    else
+    {
+        arq_next();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_txdone_cb()
+ *
+ * @brief TX confirmation, only the end of an ACK matters: the one of a data frame is followed by its ACK RX.
+ */
+static void arq_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    if (arq.state == MAC_ARQ_ACK_TX)
+    {
+        if (arq.ackLost)
+        {
+            arq.ackLost = 0;
+            arq_noack();
+        }
+        else
+        {
+            arq_next();
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_rxto_cb() / arq_rxerr_cb()
+ *
+ * @brief RX timeout / error, dwt_isr has already reset the receiver.
+ */
+static void arq_rxto_cb(const dwt_cb_data_t *cb_data)
+{
+    if (arq.state == MAC_ARQ_WAIT_ACK)
+    {
+        arq_noack();
+    }
+    else if (arq.state != MAC_ARQ_IDLE)
+    {
+        arq_next();
+    }
+}
+
+static void arq_rxerr_cb(const dwt_cb_data_t *cb_data)
+{
+    /* A frame for someone else is no reason to give up waiting for the ACK */
+    if ((arq.state == MAC_ARQ_WAIT_ACK) && ((cb_data->status & SYS_STATUS_ALL_RX_ERR) == SYS_STATUS_AFFREJ))
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        return;
+    }
+    arq_rxto_cb(cb_data);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_init()
+ *
+ * @brief see mac_arq.h
+ */
+int mac_arq_init(const mac_arq_config_t *config, mac_arq_tx_cb_t txCb, mac_arq_rx_cb_t rxCb)
+{
+    if (config == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    mac_arq_stop();
+
+    arq.cfg = *config;
+    arq.txCb = txCb;
+    arq.rxCb = rxCb;
+    memset(arq.peers, 0, sizeof(arq.peers));
+    memset(&arq.stats, 0, sizeof(arq.stats));
+
+    /* Frame filtering must be enabled for auto-ACK to work, ACK frames are let through for the sender side */
+    dwt_setpanid(arq.cfg.panId);
+    dwt_setaddress16(arq.cfg.addr);
+    dwt_enableframefilter(DWT_FF_DATA_EN | DWT_FF_ACK_EN);
+    dwt_enableautoack(arq.cfg.ackTurnaround);
+
+    dwt_setcallbacks(arq_txdone_cb, arq_rxok_cb, arq_rxto_cb, arq_rxerr_cb);
+    dwt_setinterrupt(MAC_ARQ_INT_MASK, 1);
+    port_set_deca_isr(dwt_isr);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_send()
+ *
+ * @brief see mac_arq.h
+ */
+int mac_arq_send(uint16 dst, const uint8 *data, uint16 len, int32 timeout)
+{
+    decaIrqStatus_t stat;
+    deca_frame_t *frame;
+    uint8 *msg;
+    int seq;
+
+    if ((dst == MAC_ARQ_ADDR_BCAST) || (len > DECA_FRAME_EXT_LEN - MAC_ARQ_HDR_LEN - MAC_ARQ_CRC_LEN))
+    {
+        return DWT_ERROR;
+    }
+    if (k_sem_take(&arq_win_sem, timeout) != 0)
+    {
+        return DWT_ERROR;
+    }
+    frame = deca_frame_alloc(MAC_ARQ_HDR_LEN + len + MAC_ARQ_CRC_LEN, K_NO_WAIT);
+    if (frame == NULL)
+    {
+        k_sem_give(&arq_win_sem);
+        return DWT_ERROR;
+    }
+
+    msg = frame->data;
+    msg[0] = MAC_ARQ_FC_DATA_0;
+    msg[1] = MAC_ARQ_FC_1;
+    msg[MAC_ARQ_PAN_IDX] = (uint8)arq.cfg.panId;
+    msg[MAC_ARQ_PAN_IDX + 1] = (uint8)(arq.cfg.panId >> 8);
+    msg[MAC_ARQ_DST_IDX] = (uint8)dst;
+    msg[MAC_ARQ_DST_IDX + 1] = (uint8)(dst >> 8);
+    msg[MAC_ARQ_SRC_IDX] = (uint8)arq.cfg.addr;
+    msg[MAC_ARQ_SRC_IDX + 1] = (uint8)(arq.cfg.addr >> 8);
+    memcpy(&msg[MAC_ARQ_HDR_LEN], data, len);
+
+    stat = decamutexon();
+    seq = arq.seq++;
+    msg[MAC_ARQ_SN_IDX] = (uint8)seq;
+    arq.win[(arq.head + arq.cnt) % MAC_ARQ_WINDOW] = frame;
+    arq.tries[(arq.head + arq.cnt) % MAC_ARQ_WINDOW] = 0;
+    arq.cnt++;
+
+    /* Otherwise the end of the exchange in progress sends it */
+    if (arq.state == MAC_ARQ_LISTEN)
+    {
+        dwt_forcetrxoff();
+    }
+    if ((arq.state == MAC_ARQ_IDLE) || (arq.state == MAC_ARQ_LISTEN))
+    {
+        arq_txhead();
+    }
+    decamutexoff(stat);
+
+    return seq;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_listen()
+ *
+ * @brief see mac_arq.h
+ */
+void mac_arq_listen(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    arq.listen = 1;
+    if (arq.state == MAC_ARQ_IDLE)
+    {
+        arq_rxon();
+    }
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_stop()
+ *
+ * @brief see mac_arq.h
+ */
+void mac_arq_stop(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    arq.listen = 0;
+    arq.ackLost = 0;
+    arq.state = MAC_ARQ_IDLE;
+    dwt_forcetrxoff();
+    while (arq.cnt > 0)
+    {
+        arq_done(MAC_ARQ_ERR_ABORT);
+    }
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_pending()
+ *
+ * @brief see mac_arq.h
+ */
+int mac_arq_pending(void)
+{
+    return arq.cnt;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_getstats()
+ *
+ * @brief see mac_arq.h
+ */
+void mac_arq_getstats(mac_arq_stats_t *stats)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    *stats = arq.stats;
+    decamutexoff(stat);
+}
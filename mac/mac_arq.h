@@ -0,0 +1,211 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_arq.h
+ * @brief   Reliable datagrams over the DW1000 auto-acknowledgement
+ *
+ *          Each data frame requests an ACK, which the receiving DW1000
+ *          sends by itself (dwt_enableautoack), so the sender knows within
+ *          a few hundred microseconds whether it got through. A frame is
+ *          sent again up to config.retries times, then reported as failed.
+ *
+ *          Up to MAC_ARQ_WINDOW frames can be outstanding: the application
+ *          queues them and goes on, they are sent back to back from the
+ *          DW1000 event callbacks, the next one as soon as the ACK of the
+ *          previous one is in. The receiver tracks the last sequence number
+ *          of each sender, a frame sent again because its ACK was lost is
+ *          acknowledged but not delivered twice.
+ *
+ *          Frames are those of examples 7a/7b: IEEE 802.15.4 data frames,
+ *          16-bit addressing, PAN ID compression, ACK request.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_ARQ_H_
+#define _MAC_ARQ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "deca_frame.h"
+
+// Frame layout
+#define MAC_ARQ_SN_IDX              2
+#define MAC_ARQ_PAN_IDX             3
+#define MAC_ARQ_DST_IDX             5
+#define MAC_ARQ_SRC_IDX             7
+#define MAC_ARQ_HDR_LEN             9
+#define MAC_ARQ_CRC_LEN             2
+#define MAC_ARQ_ACK_LEN             5       // frame control, sequence number, CRC
+
+// Largest payload of a standard frame, long frames (DWT_PHRMODE_EXT and DW1000_FRAME_EXT_COUNT) take up to
+// DECA_FRAME_EXT_LEN - MAC_ARQ_HDR_LEN - MAC_ARQ_CRC_LEN
+#define MAC_ARQ_PAYLOAD_STD         (DECA_FRAME_STD_LEN - MAC_ARQ_HDR_LEN - MAC_ARQ_CRC_LEN)
+
+#ifdef CONFIG_DW1000_ARQ_WINDOW
+#define MAC_ARQ_WINDOW              CONFIG_DW1000_ARQ_WINDOW
+#else
+#define MAC_ARQ_WINDOW              (4)
+#endif
+
+// Senders tracked by the receiver for duplicates, the oldest one makes room for a new one
+#define MAC_ARQ_PEERS               8
+
+typedef struct
+{
+    uint16 panId;                       // PAN ID of all frames
+    uint16 addr;                        // own short address
+    uint8 retries;                      // transmissions after the first one before a frame fails
+    uint16 ackTimeoutUus;               // from the end of the data frame TX, covers the ACK turnaround and frame
+    uint8 ackTurnaround;                // receiver: ACK turnaround, preamble symbols, see dwt_enableautoack()
+} mac_arq_config_t;
+
+#define MAC_ARQ_CONFIG_DEFAULT(own_addr) { \
+    .panId = 0xDECA,                    \
+    .addr = (own_addr),                 \
+    .retries = 3,                       \
+    .ackTimeoutUus = 400,               \
+    .ackTurnaround = 0,                 \
+}
+
+typedef enum
+{
+    MAC_ARQ_OK,
+    MAC_ARQ_ERR_NOACK,                  // no ACK after all the retries
+    MAC_ARQ_ERR_ABORT                   // mac_arq_stop() while queued
+} mac_arq_status_t;
+
+/* Outcome of one frame sent */
+typedef struct
+{
+    uint16 dst;
+    uint8 seq;
+    uint8 tries;                        // transmissions, retries included
+    mac_arq_status_t status;
+} mac_arq_tx_t;
+
+/* One frame received, data is valid for the duration of the callback unless a reference is taken on frame */
+typedef struct
+{
+    uint16 src;
+    uint8 seq;
+    const uint8 *data;                  // payload
+    uint16 len;
+    deca_frame_t *frame;                // buffer holding the whole frame
+} mac_arq_rx_t;
+
+typedef struct
+{
+    uint32 txFrames;                    // transmissions, retries included
+    uint32 txAcked;
+    uint32 txRetries;
+    uint32 txFailed;
+    uint32 rxFrames;                    // delivered
+    uint32 rxDups;                      // acknowledged again, not delivered
+    uint32 rxDropped;                   // no frame buffer free
+} mac_arq_stats_t;
+
+/* Callbacks, from the DW1000 IRQ thread */
+typedef void (*mac_arq_tx_cb_t)(const mac_arq_tx_t *tx);
+typedef void (*mac_arq_rx_cb_t)(const mac_arq_rx_t *rx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_init()
+ *
+ * @brief Set the configuration, load the PAN ID and address in the DW1000, enable frame filtering and auto-ACK, and
+ *        take over the DW1000 event callbacks and interrupts. The DW1000 must have been initialised and configured.
+ *
+ * input parameters
+ * @param config - addresses and timings, copied
+ * @param txCb   - called when a frame is acknowledged or fails, may be NULL
+ * @param rxCb   - called for each new frame received, may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL
+ */
+int mac_arq_init(const mac_arq_config_t *config, mac_arq_tx_cb_t txCb, mac_arq_rx_cb_t rxCb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_send()
+ *
+ * @brief Queue a frame, sent as soon as the frames queued before it are done.
+ *
+ * input parameters
+ * @param dst     - short address of the receiver, not the broadcast address
+ * @param data    - payload, copied
+ * @param len     - payload length
+ * @param timeout - in ms, to wait for room in the window: K_FOREVER, or K_NO_WAIT from the callbacks
+ *
+ * output parameters
+ *
+ * returns the sequence number of the frame, or DWT_ERROR if the window stayed full, no frame buffer was free, or the
+ *         frame is too long or for the broadcast address
+ */
+int mac_arq_send(uint16 dst, const uint8 *data, uint16 len, int32 timeout);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_listen()
+ *
+ * @brief Keep the receiver on whenever no frame is being sent, until mac_arq_stop().
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_arq_listen(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_stop()
+ *
+ * @brief Turn the transceiver off, fail the queued frames with MAC_ARQ_ERR_ABORT and stop listening.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_arq_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_pending()
+ *
+ * @brief Return the frames queued or being sent.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns 0 to MAC_ARQ_WINDOW
+ */
+int mac_arq_pending(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_arq_getstats()
+ *
+ * @brief Read the link counters, counted since mac_arq_init().
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters
+ *
+ * no return value
+ */
+void mac_arq_getstats(mac_arq_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_ARQ_H_ */
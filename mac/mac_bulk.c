@@ -0,0 +1,324 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_bulk.c
+ * @brief   Bulk data streaming at 6.8 Mbps with long frames
+ *
+ *          TX buffer:  | half 0: frame N, on air | half 1: frame N+1, being written |
+ *                      | half 0: frame N+2, being written | half 1: frame N+1, on air |
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "mac_bulk.h"
+#include "deca_rxq.h"
+#include "deca_txslot.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+// Frame control: data frame, 16-bit addressing, PAN ID compression
+#define MAC_BULK_FC_0       0x41
+#define MAC_BULK_FC_1       0x88
+
+#define MAC_BULK_RX_INT_MASK    (DWT_INT_RFCG | DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT)
+
+typedef enum
+{
+    MAC_BULK_OFF,
+    MAC_BULK_TX,
+    MAC_BULK_RX
+} mac_bulk_mode_t;
+
+typedef struct
+{
+    mac_bulk_config_t cfg;
+    mac_bulk_fill_cb_t fill;
+    mac_bulk_done_cb_t done;
+    volatile mac_bulk_mode_t mode;
+    // sender
+    uint8 pipe;                         // frames alternate between the two halves of the TX buffer
+    uint8 cur;                          // half on air
+    uint16 staged[2];                   // length of the frame written in each half, 0 if none
+    uint8 seq;
+    uint16 block;                       // sender: next block, receiver: next block expected
+    uint8 synced;                       // receiver: block set from a first frame
+    uint8 rx;                           // last start was the receiver one
+    mac_bulk_stats_t stats;
+    uint8 buf[MAC_BULK_FRAME_MAX];      // frame being written
+} mac_bulk_local_t;
+
+static mac_bulk_local_t bulk;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bulk_stage()
+ *
+ * @brief Get the next payload from the application and write its frame to a half of the TX buffer, the whole buffer
+ *        when not pipelining.
+ *
+ * returns the frame length, 0 at the end of the stream
+ */
+static uint16 bulk_stage(uint8 half)
+{
+    uint8 *msg = bulk.buf;
+    uint16 len;
+
+    len = bulk.fill(&msg[MAC_BULK_HDR_LEN], bulk.cfg.payloadLen);
+    if ((len == 0) || (len > bulk.cfg.payloadLen))
+    {
+        bulk.staged[half] = 0;
+        return 0;
+    }
+
+    msg[0] = MAC_BULK_FC_0;
+    msg[1] = MAC_BULK_FC_1;
+    msg[MAC_BULK_SN_IDX] = bulk.seq++;
+    msg[MAC_BULK_PAN_IDX] = (uint8)bulk.cfg.panId;
+    msg[MAC_BULK_PAN_IDX + 1] = (uint8)(bulk.cfg.panId >> 8);
+    msg[MAC_BULK_DST_IDX] = (uint8)bulk.cfg.peer;
+    msg[MAC_BULK_DST_IDX + 1] = (uint8)(bulk.cfg.peer >> 8);
+    msg[MAC_BULK_SRC_IDX] = (uint8)bulk.cfg.addr;
+    msg[MAC_BULK_SRC_IDX + 1] = (uint8)(bulk.cfg.addr >> 8);
+    msg[MAC_BULK_BLK_IDX] = (uint8)bulk.block;
+    msg[MAC_BULK_BLK_IDX + 1] = (uint8)(bulk.block >> 8);
+    bulk.block++;
+
+    len += MAC_BULK_HDR_LEN + MAC_BULK_CRC_LEN;
+    dwt_writetxdata(len, msg, half * MAC_BULK_HALF_LEN);
+    bulk.staged[half] = len;
+
+    return len;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bulk_send()
+ *
+ * @brief Send the frame written in a half of the TX buffer.
+ */
+static void bulk_send(uint8 half)
+{
+    dwt_writetxfctrl(bulk.staged[half], half * MAC_BULK_HALF_LEN, 0);
+    dwt_starttx(DWT_START_TX_IMMEDIATE);
+    bulk.cur = half;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn bulk_txdone_cb()
+ *
+ * @brief TX confirmation: start the frame already written, then write the following one in the half just sent.
+ */
+static void bulk_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    uint8 sent = bulk.cur;
+
+    if (bulk.mode != MAC_BULK_TX)
+    {
+        return;
+    }
+
+    bulk.stats.frames++;
+    bulk.stats.bytes += bulk.staged[sent] - MAC_BULK_HDR_LEN - MAC_BULK_CRC_LEN;
+    bulk.stats.lastMs = k_uptime_get_32();
+    bulk.staged[sent] = 0;
+
+    if (bulk.pipe && bulk.staged[sent ^ 1])
+    {
+        bulk_send(sent ^ 1);
+        bulk_stage(sent);
+        return;
+    }
+    if (!bulk.pipe && bulk_stage(0))
+    {
+        bulk_send(0);
+        return;
+    }
+
+    bulk.mode = MAC_BULK_OFF;
+    if (bulk.done != NULL)
+    {
+        bulk.done(&bulk.stats);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_tx_start()
+ *
+ * @brief see mac_bulk.h
+ */
+int mac_bulk_tx_start(const mac_bulk_config_t *config, mac_bulk_fill_cb_t fill, mac_bulk_done_cb_t done)
+{
+    decaIrqStatus_t stat;
+
+    if ((config == NULL) || (fill == NULL) || (config->payloadLen == 0) || (config->payloadLen > MAC_BULK_PAYLOAD_MAX))
+    {
+        return DWT_ERROR;
+    }
+
+    mac_bulk_stop();
+
+    bulk.cfg = *config;
+    bulk.fill = fill;
+    bulk.done = done;
+    bulk.pipe = (bulk.cfg.payloadLen <= MAC_BULK_PAYLOAD_PIPE);
+    bulk.rx = 0;
+    bulk.block = 0;
+    bulk.staged[0] = 0;
+    bulk.staged[1] = 0;
+    memset(&bulk.stats, 0, sizeof(bulk.stats));
+
+    /* The frames overwrite the whole TX buffer */
+    deca_txslot_reset();
+
+    dwt_setcallbacks(bulk_txdone_cb, NULL, NULL, NULL);
+    dwt_setinterrupt(DWT_INT_TFRS, 1);
+    port_set_deca_isr(dwt_isr);
+
+    /* The first TX done waits until the second frame is written */
+    stat = decamutexon();
+    if (bulk_stage(0) == 0)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+    bulk.mode = MAC_BULK_TX;
+    bulk.stats.startMs = k_uptime_get_32();
+    bulk_send(0);
+    if (bulk.pipe)
+    {
+        bulk_stage(1);
+    }
+    decamutexoff(stat);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_rx_start()
+ *
+ * @brief see mac_bulk.h
+ */
+int mac_bulk_rx_start(const mac_bulk_config_t *config)
+{
+    if (config == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    mac_bulk_stop();
+
+    bulk.cfg = *config;
+    bulk.synced = 0;
+    bulk.rx = 1;
+    memset(&bulk.stats, 0, sizeof(bulk.stats));
+
+    dwt_setpanid(bulk.cfg.panId);
+    dwt_setaddress16(bulk.cfg.addr);
+    dwt_enableframefilter(DWT_FF_DATA_EN);
+    dwt_setdblrxbuffmode(1);
+
+    deca_rxq_start(NULL, DECA_RXQ_REARM);
+    dwt_setinterrupt(MAC_BULK_RX_INT_MASK, 1);
+    port_set_deca_isr(dwt_isr);
+
+    bulk.mode = MAC_BULK_RX;
+    dwt_setrxtimeout(0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_rx_get()
+ *
+ * @brief see mac_bulk.h
+ */
+int mac_bulk_rx_get(mac_bulk_rx_t *rx, int32 timeout)
+{
+    deca_frame_t *frame;
+    const uint8 *msg;
+    uint16 block;
+
+    while ((frame = deca_rxq_get(timeout)) != NULL)
+    {
+        msg = frame->data;
+        if ((frame->len < MAC_BULK_HDR_LEN + MAC_BULK_CRC_LEN) ||
+            (msg[MAC_BULK_SRC_IDX] != (uint8)bulk.cfg.peer) || (msg[MAC_BULK_SRC_IDX + 1] != (uint8)(bulk.cfg.peer >> 8)))
+        {
+            deca_rxq_free(frame);
+            continue;
+        }
+
+        block = msg[MAC_BULK_BLK_IDX] | (msg[MAC_BULK_BLK_IDX + 1] << 8);
+        if (bulk.synced)
+        {
+            bulk.stats.lost += (uint16)(block - bulk.block);
+        }
+        else
+        {
+            bulk.synced = 1;
+            bulk.stats.startMs = k_uptime_get_32();
+        }
+        bulk.block = block + 1;
+
+        rx->block = block;
+        rx->data = &msg[MAC_BULK_HDR_LEN];
+        rx->len = frame->len - MAC_BULK_HDR_LEN - MAC_BULK_CRC_LEN;
+        rx->frame = frame;
+
+        bulk.stats.frames++;
+        bulk.stats.bytes += rx->len;
+        bulk.stats.lastMs = k_uptime_get_32();
+
+        return DWT_SUCCESS;
+    }
+
+    return DWT_ERROR;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_stop()
+ *
+ * @brief see mac_bulk.h
+ */
+void mac_bulk_stop(void)
+{
+    decaIrqStatus_t stat;
+    mac_bulk_mode_t mode;
+
+    stat = decamutexon();
+    mode = bulk.mode;
+    bulk.mode = MAC_BULK_OFF;
+    dwt_forcetrxoff();
+    if (mode == MAC_BULK_RX)
+    {
+        dwt_setdblrxbuffmode(0);
+    }
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_getstats()
+ *
+ * @brief see mac_bulk.h
+ */
+void mac_bulk_getstats(mac_bulk_stats_t *stats)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    *stats = bulk.stats;
+    decamutexoff(stat);
+
+    if (bulk.rx)
+    {
+        deca_rxq_stats_t rxq;
+
+        deca_rxq_getstats(&rxq);
+        stats->errors = rxq.noFrame + rxq.queueFull + rxq.rxErrors;
+    }
+}
@@ -0,0 +1,190 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_bulk.h
+ * @brief   Bulk data streaming at 6.8 Mbps with long frames
+ *
+ *          The sender pulls the payload from the application frame after
+ *          frame and sends the frames back to back, without ACK. Frames of
+ *          up to MAC_BULK_HALF_LEN bytes alternate between the two halves
+ *          of the 1024 byte TX buffer: frame N+1 is written over SPI into
+ *          one half while frame N is on air from the other, so the next
+ *          TX starts as soon as the previous one ends. Longer frames, up to
+ *          1023 bytes, take the whole buffer and are written between two
+ *          TX.
+ *
+ *          The receiver runs the DW1000 double RX buffer through the RX
+ *          pipeline (deca_rxq.h): RX is re-enabled on the other buffer
+ *          before the frame is read. A block number in each frame lets it
+ *          count the frames lost.
+ *
+ *          The TX buffer is all the sender's while it runs, the resident
+ *          frames of deca_txslot.h are dropped.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_BULK_H_
+#define _MAC_BULK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "deca_frame.h"
+
+// Frame layout: IEEE 802.15.4 data frame, 16-bit addressing, PAN ID compression, no ACK request
+#define MAC_BULK_SN_IDX             2
+#define MAC_BULK_PAN_IDX            3
+#define MAC_BULK_DST_IDX            5
+#define MAC_BULK_SRC_IDX            7
+#define MAC_BULK_BLK_IDX            9       // block number, 16 bits
+#define MAC_BULK_HDR_LEN            11
+#define MAC_BULK_CRC_LEN            2
+
+#define MAC_BULK_TXBUF_LEN          1024
+#define MAC_BULK_HALF_LEN           (MAC_BULK_TXBUF_LEN / 2)
+#define MAC_BULK_FRAME_MAX          1023
+
+// Largest payload sent pipelined / at all
+#define MAC_BULK_PAYLOAD_PIPE       (MAC_BULK_HALF_LEN - MAC_BULK_HDR_LEN - MAC_BULK_CRC_LEN)
+#define MAC_BULK_PAYLOAD_MAX        (MAC_BULK_FRAME_MAX - MAC_BULK_HDR_LEN - MAC_BULK_CRC_LEN)
+
+/* PHY of the stream, both sides: 6.8 Mbps, 64 symbols of preamble, long frames */
+#define MAC_BULK_PHY_CONFIG {                                                               \
+    5,               /* Channel number. */                                                  \
+    DWT_PRF_64M,     /* Pulse repetition frequency. */                                      \
+    DWT_PLEN_64,     /* Preamble length. Used in TX only. */                                \
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */                \
+    9,               /* TX preamble code. Used in TX only. */                               \
+    9,               /* RX preamble code. Used in RX only. */                               \
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */                \
+    DWT_BR_6M8,      /* Data rate. */                                                       \
+    DWT_PHRMODE_EXT, /* PHY header mode. */                                                 \
+    (64 + 1 + 8 - 8) /* SFD timeout (preamble length + 1 + SFD length - PAC size). */       \
+}
+
+typedef struct
+{
+    uint16 panId;                       // PAN ID of all frames
+    uint16 addr;                        // own short address
+    uint16 peer;                        // sender: receiver of the stream, receiver: sender it accepts
+    uint16 payloadLen;                  // sender: payload bytes per frame, up to MAC_BULK_PAYLOAD_PIPE to pipeline
+} mac_bulk_config_t;
+
+#define MAC_BULK_CONFIG_DEFAULT(own_addr, peer_addr) { \
+    .panId = 0xDECA,                    \
+    .addr = (own_addr),                 \
+    .peer = (peer_addr),                \
+    .payloadLen = MAC_BULK_PAYLOAD_PIPE, \
+}
+
+typedef struct
+{
+    uint32 frames;                      // sent / received
+    uint32 bytes;                       // payload bytes sent / received
+    uint32 lost;                        // receiver: gaps in the block numbers
+    uint32 errors;                      // receiver: RX errors, frames dropped for lack of buffers
+    uint32 startMs;                     // uptime of the first frame
+    uint32 lastMs;                      // uptime of the last frame
+} mac_bulk_stats_t;
+
+/* One frame received, its buffer goes back with deca_rxq_free(frame) */
+typedef struct
+{
+    uint16 block;
+    const uint8 *data;                  // payload
+    uint16 len;
+    deca_frame_t *frame;
+} mac_bulk_rx_t;
+
+/* Sender callbacks, from the DW1000 IRQ thread: fill writes the next payload and returns its length, 0 ends the
+ * stream; done is called once the last frame is sent */
+typedef uint16 (*mac_bulk_fill_cb_t)(uint8 *data, uint16 max);
+typedef void (*mac_bulk_done_cb_t)(const mac_bulk_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_tx_start()
+ *
+ * @brief Take over the DW1000 event callbacks and interrupts and start streaming. The DW1000 must have been
+ *        configured with MAC_BULK_PHY_CONFIG, or at least DWT_PHRMODE_EXT for frames above 127 bytes.
+ *
+ * input parameters
+ * @param config - addresses and payload size, copied
+ * @param fill   - gives the payload of each frame
+ * @param done   - called at the end of the stream, may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if payloadLen is 0 or above MAC_BULK_PAYLOAD_MAX, or the stream is
+ *         empty
+ */
+int mac_bulk_tx_start(const mac_bulk_config_t *config, mac_bulk_fill_cb_t fill, mac_bulk_done_cb_t done);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_rx_start()
+ *
+ * @brief Enable frame filtering and double buffering, start the RX pipeline and the receiver. Frames longer than 127
+ *        bytes need long frame buffers (CONFIG_DW1000_FRAME_EXT_COUNT).
+ *
+ * input parameters
+ * @param config - addresses, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL
+ */
+int mac_bulk_rx_start(const mac_bulk_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_rx_get()
+ *
+ * @brief Take the next frame of the stream, other frames are dropped.
+ *
+ * input parameters
+ * @param timeout - in ms, K_FOREVER or K_NO_WAIT, for each frame taken from the RX pipeline
+ *
+ * output parameters
+ * @param rx - block number and payload
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR on timeout
+ */
+int mac_bulk_rx_get(mac_bulk_rx_t *rx, int32 timeout);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_stop()
+ *
+ * @brief Stop streaming or receiving and turn the transceiver off, the done callback is not called.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_bulk_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_bulk_getstats()
+ *
+ * @brief Read the stream counters, since the last start.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters
+ *
+ * no return value
+ */
+void mac_bulk_getstats(mac_bulk_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_BULK_H_ */
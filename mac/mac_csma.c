@@ -0,0 +1,237 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_csma.c
+ * @brief   Listen-before-talk channel access: preamble CCA with randomised
+ *          exponential backoff
+ *
+ *          | backoff (DW1000 delayed RX) | CCA: RX, ccaPac PACs | RXPTO: TX
+ *                                                              | RXPRD: off, next backoff, BE + 1
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "mac_csma.h"
+#include "deca_regs.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* Anything the receiver reports from a preamble on: the channel is busy */
+#define MAC_CSMA_BUSY_STATUS    (SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_RXRFTO)
+
+/* UWB microseconds to DW1000 time (hi32): 1 uus = 65536 device time units */
+#define MAC_CSMA_UUS_TO_HI32(t) ((uint32)(t) << 8)
+
+typedef enum
+{
+    MAC_CSMA_IDLE,
+    MAC_CSMA_CCA                        // backoff, then CCA
+} mac_csma_state_t;
+
+typedef struct
+{
+    mac_csma_config_t cfg;
+    volatile mac_csma_state_t state;
+    uint8 mode;                         // dwt_starttx() mode once the channel is clear
+    uint8 be;                           // backoff exponent
+    uint8 nb;                           // busy CCAs of the transmission waiting
+    uint32 rand;                        // backoff generator state, never 0
+    mac_csma_busy_cb_t cb;
+    mac_csma_stats_t stats;
+} mac_csma_local_t;
+
+static mac_csma_local_t csma;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn csma_rand()
+ *
+ * @brief Backoff generator, xorshift32.
+ */
+static uint32 csma_rand(void)
+{
+    uint32 x = csma.rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    csma.rand = x;
+
+    return x;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn csma_backoff()
+ *
+ * @brief Draw a backoff for the current exponent and start the CCA receiver at its end. A delayed RX found late by
+ *        dwt_rxenable() is turned on at once.
+ */
+static void csma_backoff(void)
+{
+    uint32 uus = (csma_rand() & ((1UL << csma.be) - 1)) * csma.cfg.unitUus;
+
+    csma.stats.backoffUus += uus;
+    if (uus < MAC_CSMA_MIN_DELAY_UUS)
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        return;
+    }
+
+    dwt_setdelayedtrxtime(dwt_readsystimestamphi32() + MAC_CSMA_UUS_TO_HI32(uus));
+    dwt_rxenable(DWT_START_RX_DELAYED);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn csma_end()
+ *
+ * @brief Back to the settings of the frame owner: no preamble detection timeout, no preamble detected interrupt.
+ */
+static void csma_end(void)
+{
+    csma.state = MAC_CSMA_IDLE;
+    dwt_setpreambledetecttimeout(0);
+    dwt_setinterrupt(SYS_MASK_MRXPRD, 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_init()
+ *
+ * @brief see mac_csma.h
+ */
+int mac_csma_init(const mac_csma_config_t *config)
+{
+    if ((config == NULL) || (config->maxBe > 15) || (config->minBe > config->maxBe))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&csma, 0, sizeof(csma));
+    csma.cfg = *config;
+    csma.rand = dwt_getpartid() ^ dwt_readsystimestamphi32() ^ k_cycle_get_32();
+    if (csma.rand == 0)
+    {
+        csma.rand = 1;
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_isr()
+ *
+ * @brief see mac_csma.h
+ */
+void mac_csma_isr(void)
+{
+    uint32 status;
+
+    if (csma.state != MAC_CSMA_CCA)
+    {
+        dwt_isr();
+        return;
+    }
+
+    status = dwt_read32bitreg(SYS_STATUS_ID);
+    if (!(status & (MAC_CSMA_BUSY_STATUS | SYS_STATUS_RXPTO)))
+    {
+        dwt_isr();
+        return;
+    }
+
+    /* Receiver off and reset as dwt_isr() does after an RX event, this also clears the RX status bits */
+    dwt_forcetrxoff();
+    dwt_rxreset();
+
+    /* A preamble seen along with the timeout still makes the channel busy */
+    if (!(status & MAC_CSMA_BUSY_STATUS))
+    {
+        csma.stats.sent++;
+        csma_end();
+        dwt_starttx(csma.mode);
+        return;
+    }
+
+    csma.stats.busy++;
+    if (++csma.nb > csma.cfg.maxBackoffs)
+    {
+        csma.stats.failures++;
+        csma_end();
+        if (csma.cb != NULL)
+        {
+            csma.cb();
+        }
+        return;
+    }
+    csma.be = MIN(csma.be + 1, csma.cfg.maxBe);
+    csma_backoff();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_starttx()
+ *
+ * @brief see mac_csma.h
+ */
+int mac_csma_starttx(uint8 mode, mac_csma_busy_cb_t cb)
+{
+    decaIrqStatus_t stat;
+
+    if (mode & DWT_START_TX_DELAYED)
+    {
+        return DWT_ERROR;
+    }
+
+    stat = decamutexon();
+    if (csma.state != MAC_CSMA_IDLE)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+
+    csma.mode = mode;
+    csma.cb = cb;
+    csma.nb = 0;
+    csma.be = csma.cfg.minBe;
+    csma.stats.requests++;
+
+    dwt_setpreambledetecttimeout(csma.cfg.ccaPac);
+    dwt_setinterrupt(SYS_MASK_MRXPRD | DWT_INT_RXPTO, 1);
+    csma.state = MAC_CSMA_CCA;
+    csma_backoff();
+    decamutexoff(stat);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_cancel()
+ *
+ * @brief see mac_csma.h
+ */
+void mac_csma_cancel(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    if (csma.state != MAC_CSMA_IDLE)
+    {
+        dwt_forcetrxoff();
+        dwt_rxreset();
+        csma_end();
+    }
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_getstats()
+ *
+ * @brief see mac_csma.h
+ */
+void mac_csma_getstats(mac_csma_stats_t *stats)
+{
+    *stats = csma.stats;
+}
@@ -0,0 +1,150 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_csma.h
+ * @brief   Listen-before-talk channel access: preamble CCA with randomised
+ *          exponential backoff
+ *
+ *          The CCA of example 1e: the receiver is turned on with a short
+ *          preamble detection timeout, the channel is clear if it expires
+ *          (RXPTO), busy if a preamble is detected (RXPRD). On top of it,
+ *          the unslotted CSMA-CA of IEEE 802.15.4: before each CCA a
+ *          random backoff of 0 to 2^BE - 1 units, BE growing from minBe to
+ *          maxBe with each busy CCA, until maxBackoffs of them.
+ *
+ *          The backoff is timed by the DW1000 itself: the CCA receiver is
+ *          started with a delayed RX at the end of it (the delayed TX/RX
+ *          time register), the CPU is free in between. Both CCA outcomes
+ *          come through mac_csma_isr(), installed in place of dwt_isr():
+ *          on a clear channel it starts the TX with the mode it was given,
+ *          a response can be expected; on a busy one it turns the receiver
+ *          off and schedules the next backoff. Everything else goes to
+ *          dwt_isr() and the callbacks of the frame owner, its TX done
+ *          callback gets the frame sent.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_CSMA_H_
+#define _MAC_CSMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Backoffs shorter than that start the CCA at once, a delayed RX needs the time to be programmed, uus
+#define MAC_CSMA_MIN_DELAY_UUS      100
+
+typedef struct
+{
+    uint16 ccaPac;                      // CCA length: preamble detection timeout in PACs, see NOTE 5 of example 1e
+    uint8 minBe;                        // backoff exponent of the first CCA, 0 for a first CCA at once
+    uint8 maxBe;                        // backoff exponent limit, 0 to 15
+    uint8 maxBackoffs;                  // busy CCAs before giving up
+    uint16 unitUus;                     // backoff unit: about one short frame on air and the turnaround
+} mac_csma_config_t;
+
+#define MAC_CSMA_CONFIG_DEFAULT {       \
+    .ccaPac = 3,                        \
+    .minBe = 3,                         \
+    .maxBe = 5,                         \
+    .maxBackoffs = 4,                   \
+    .unitUus = 300,                     \
+}
+
+typedef struct
+{
+    uint32 requests;                    // mac_csma_starttx() calls
+    uint32 sent;                        // clear CCAs, TX started
+    uint32 busy;                        // busy CCAs
+    uint32 failures;                    // requests given up after maxBackoffs busy CCAs
+    uint32 backoffUus;                  // total backoff time
+} mac_csma_stats_t;
+
+/* The channel stayed busy, from the DW1000 IRQ thread: the transmission is dropped, the DW1000 is idle */
+typedef void (*mac_csma_busy_cb_t)(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_init()
+ *
+ * @brief Set the configuration and seed the backoff generator from the DW1000 part ID and clock, so that devices
+ *        started together draw different backoffs.
+ *
+ * input parameters
+ * @param config - CCA and backoff parameters, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or its exponents are out of range
+ */
+int mac_csma_init(const mac_csma_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_isr()
+ *
+ * @brief DW1000 interrupt handler to install with port_set_deca_isr() in place of dwt_isr(): handles the CCA outcome
+ *        while a transmission waits for the channel, calls dwt_isr() otherwise.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_csma_isr(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_starttx()
+ *
+ * @brief Send the frame already written with dwt_writetxdata()/dwt_writetxfctrl() once the channel is clear, as
+ *        dwt_starttx(mode) would. The RX after TX delay and RX timeout set for a response apply to the CCA receiver
+ *        too, the preamble detection timeout is left off once the frame is sent or dropped.
+ *
+ * input parameters
+ * @param mode - DWT_START_TX_IMMEDIATE, with DWT_RESPONSE_EXPECTED if wanted
+ * @param cb   - called if the channel stays busy, may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if a transmission already waits or mode asks for a delayed TX
+ */
+int mac_csma_starttx(uint8 mode, mac_csma_busy_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_cancel()
+ *
+ * @brief Drop the transmission waiting for the channel, if any, and turn the DW1000 off.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_csma_cancel(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_csma_getstats()
+ *
+ * @brief Read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since mac_csma_init()
+ *
+ * no return value
+ */
+void mac_csma_getstats(mac_csma_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_CSMA_H_ */
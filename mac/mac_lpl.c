@@ -0,0 +1,548 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_lpl.c
+ * @brief   Low-power listening MAC with a self-tuning listen interval
+ *
+ *          listener: | sleep counter: interval | sniff | snooze | sniff | sleep counter ...
+ *          sender:   | WUS frame n | WUS frame n-1 | ... | WUS frame 0 | RX: answer |
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "mac_lpl.h"
+#include "deca_regs.h"
+#include "deca_slpcal.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+// Frame control: data frame, 16-bit addressing, PAN ID compression
+#define MAC_LPL_FC_0            0x41
+#define MAC_LPL_FC_1            0x88
+
+#define MAC_LPL_INT_MASK        (DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO | DWT_INT_RPHE | DWT_INT_RFCE | \
+                                 DWT_INT_RFSL | DWT_INT_SFDT | DWT_INT_ARFE)
+
+/* RX ON time of each sniff, in PACs on top of the one the IC adds, see NOTE 2 of example 8a. */
+#define MAC_LPL_SNIFF_PAC       2
+
+/* WUS frame period before one is measured or reported: example 8b. */
+#define MAC_LPL_WUS_PERIOD_US   1130
+
+/* Dummy read holding the SPI chip select low long enough to wake the DW1000 up, see NOTE 7 of example 8a. */
+#define MAC_LPL_WAKE_BUF_LEN    600
+
+/* Extra sleep after the end of the WUS, the sender only listens once its last frame is out. */
+#define MAC_LPL_WUS_END_GUARD_MS 1
+
+/* DW1000 time (hi32) to microseconds: 1 unit = 256 / (128 * 499.2 MHz). */
+#define MAC_LPL_HI32_TO_US(t)   (((t) * 10) / 2496)
+
+typedef enum
+{
+    MAC_LPL_IDLE,
+    MAC_LPL_LISTEN,                     // low-power listening
+    MAC_LPL_WAIT_END,                   // asleep until the end of a WUS for us
+    MAC_LPL_WAIT_OTHER,                 // asleep until the end of the interaction that follows a WUS for another node
+    MAC_LPL_AWAKE,                      // application interacting with the sender
+    MAC_LPL_SEND_WUS,
+    MAC_LPL_WAIT_ANS
+} mac_lpl_state_t;
+
+typedef struct
+{
+    uint16 addr;
+    uint16 intervalMs;
+} mac_lpl_peer_t;
+
+typedef struct
+{
+    mac_lpl_config_t cfg;
+    volatile mac_lpl_state_t state;
+    uint8 seq;
+    mac_lpl_stats_t stats;
+    // listener
+    mac_lpl_wake_cb_t wakeCb;
+    uint16 src;                         // sender of the WUS being answered
+    uint32 lastWakeMs;                  // uptime of the last WUS for us, 0 before the first
+    uint32 gapMs;                       // average time between two WUS for us, 0 while unknown
+    struct k_delayed_work work;         // end of the WUS, or of the interaction of another node
+    // sender
+    mac_lpl_done_cb_t doneCb;
+    uint16 dst;
+    uint16 left;                        // WUS frames still to send
+    uint32 lastTxTime;                  // DW1000 time (hi32) of the previous WUS TX done
+    mac_lpl_peer_t peers[MAC_LPL_PEERS];
+    uint8 nextPeer;
+} mac_lpl_local_t;
+
+static mac_lpl_local_t lpl;
+
+static uint8 lpl_wake_buf[MAC_LPL_WAKE_BUF_LEN];
+
+static void lpl_rxwus_cb(const dwt_cb_data_t *cb_data);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_isqrt()
+ *
+ * @brief Integer square root, rounded down.
+ */
+static uint32 lpl_isqrt(uint32 x)
+{
+    uint32 r = 0, bit = 1UL << 30;
+
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (x >= r + bit)
+        {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+        {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_stepupdate()
+ *
+ * @brief Sleep counter step, followed against temperature by deca_slpcal.h: the DW1000 is awake here.
+ */
+static void lpl_stepupdate(void)
+{
+    deca_slpcal_stats_t cal;
+
+    deca_slpcal_check();
+    deca_slpcal_getstats(&cal);
+    lpl.stats.stepMs = (uint16)MAX(cal.stepNs / 1000000, 1);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_tune()
+ *
+ * @brief Pick the listen interval and snooze for the traffic seen.
+ *
+ *        Sampling costs listenCostUs once per interval T, each wake-up costs a WUS of about T: over a time between
+ *        wake-ups G, E(T) = listenCostUs * G / T + T, lowest for T = sqrt(listenCostUs * G). The snooze covers the
+ *        part of the WUS frame period after the preamble, so that one of the two sniffs hits a preamble.
+ */
+static void lpl_tune(void)
+{
+    uint32 max_ms = (uint32)lpl.cfg.latencyMs * 100 / (100 + MAC_LPL_MARGIN_PCT);
+    uint32 t_ms = max_ms, k, pre_us, units;
+
+    lpl_stepupdate();
+    if (lpl.gapMs != 0)
+    {
+        /* 64 bits: a long gap or a large listen cost overflows 32 bits */
+        uint64_t prod = (uint64_t)lpl.cfg.listenCostUs * lpl.gapMs / 1000;
+
+        t_ms = lpl_isqrt((uint32)MIN(prod, UINT32_MAX));
+        t_ms = MIN(t_ms, max_ms);
+    }
+    /* Whole steps within the latency target, one step at least */
+    k = t_ms / lpl.stats.stepMs;
+    k = MAX(MIN(k, 0xFFFF), 1);
+    lpl.stats.intervalMs = (uint16)(k * lpl.stats.stepMs);
+
+    /* The sleep counter is set with the system clock on the crystal, see dwt_configuresleepcnt() */
+    port_set_dw1000_slowrate();
+    dwt_configuresleepcnt((uint16)k);
+    port_set_dw1000_fastrate();
+
+    /* Snooze in 512/19.2 us units, the IC adds one */
+    pre_us = dwt_getpreambleus(lpl.cfg.phy);
+    units = (lpl.stats.wusPeriodUs > pre_us) ? ((lpl.stats.wusPeriodUs - pre_us) * 3 + 79) / 80 : 1;
+    lpl.stats.snooze = (uint16)MIN(MAX(units, 1) - 1, 0xFF);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_enter()
+ *
+ * @brief Listener: retune and go to low-power listening.
+ */
+static void lpl_enter(void)
+{
+    lpl_tune();
+
+    port_set_deca_isr(dwt_lowpowerlistenisr);
+    dwt_setcallbacks(NULL, lpl_rxwus_cb, NULL, NULL);
+    dwt_setinterrupt(MAC_LPL_INT_MASK, 0);
+    dwt_setinterrupt(DWT_INT_RFCG, 1);
+
+    dwt_configuresleep(DWT_PRESRV_SLEEP | DWT_CONFIG | DWT_RX_EN, DWT_WAKE_SLPCNT | DWT_SLP_EN);
+    dwt_setsnoozetime((uint8)lpl.stats.snooze);
+    dwt_setpreambledetecttimeout(MAC_LPL_SNIFF_PAC);
+
+    lpl.state = MAC_LPL_LISTEN;
+    dwt_setlowpowerlistening(1);
+    dwt_entersleep();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_buildmsg()
+ *
+ * @brief Write the common part of a frame.
+ */
+static void lpl_buildmsg(uint8 *msg, uint16 dst, uint8 fcode)
+{
+    msg[0] = MAC_LPL_FC_0;
+    msg[1] = MAC_LPL_FC_1;
+    msg[MAC_LPL_SN_IDX] = lpl.seq++;
+    msg[MAC_LPL_PAN_IDX] = (uint8)lpl.cfg.panId;
+    msg[MAC_LPL_PAN_IDX + 1] = (uint8)(lpl.cfg.panId >> 8);
+    msg[MAC_LPL_DST_IDX] = (uint8)dst;
+    msg[MAC_LPL_DST_IDX + 1] = (uint8)(dst >> 8);
+    msg[MAC_LPL_SRC_IDX] = (uint8)lpl.cfg.addr;
+    msg[MAC_LPL_SRC_IDX + 1] = (uint8)(lpl.cfg.addr >> 8);
+    msg[MAC_LPL_FCODE_IDX] = fcode;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_rxwus_cb()
+ *
+ * @brief Listener: frame received in low-power listening, from dwt_lowpowerlistenisr(). A WUS frame puts the DW1000
+ *        to DEEPSLEEP until the end of the sequence, anything else back to low-power listening.
+ */
+static void lpl_rxwus_cb(const dwt_cb_data_t *cb_data)
+{
+    uint8 msg[MAC_LPL_WUS_LEN];
+    uint16 dst, cnt, period;
+    uint32 now, end_ms;
+
+    if (cb_data->datalength == MAC_LPL_WUS_LEN)
+    {
+        dwt_readrxdata(msg, MAC_LPL_WUS_LEN, 0);
+    }
+    if ((cb_data->datalength != MAC_LPL_WUS_LEN) || (msg[MAC_LPL_FCODE_IDX] != MAC_LPL_FCODE_WUS) ||
+        (msg[MAC_LPL_PAN_IDX] != (uint8)lpl.cfg.panId) || (msg[MAC_LPL_PAN_IDX + 1] != (uint8)(lpl.cfg.panId >> 8)))
+    {
+        lpl.stats.falseWakes++;
+        dwt_setlowpowerlistening(1); /* No need to reconfigure sleep mode, it has not been modified since wake-up. */
+        dwt_entersleep();
+        return;
+    }
+
+    dst = msg[MAC_LPL_DST_IDX] | (msg[MAC_LPL_DST_IDX + 1] << 8);
+    cnt = msg[MAC_LPL_WUS_CNTDWN_IDX] | (msg[MAC_LPL_WUS_CNTDWN_IDX + 1] << 8);
+    period = msg[MAC_LPL_WUS_PERIOD_IDX] | (msg[MAC_LPL_WUS_PERIOD_IDX + 1] << 8);
+    if (period != 0)
+    {
+        lpl.stats.wusPeriodUs = (uint16)(((uint32)lpl.stats.wusPeriodUs * 3 + period) / 4);
+    }
+    end_ms = ((uint32)cnt * (period ? period : lpl.stats.wusPeriodUs)) / 1000 + MAC_LPL_WUS_END_GUARD_MS;
+
+    /* DEEPSLEEP with SPI chip select wake-up until the end of the WUS */
+    dwt_configuresleep(DWT_PRESRV_SLEEP | DWT_CONFIG, DWT_WAKE_CS | DWT_SLP_EN);
+    dwt_entersleep();
+
+    if (dst == lpl.cfg.addr)
+    {
+        now = k_uptime_get_32();
+        if (lpl.lastWakeMs != 0)
+        {
+            lpl.gapMs = lpl.gapMs ? ((lpl.gapMs * 3 + (now - lpl.lastWakeMs)) / 4) : (now - lpl.lastWakeMs);
+        }
+        lpl.lastWakeMs = now;
+        lpl.stats.wakeups++;
+        lpl.src = msg[MAC_LPL_SRC_IDX] | (msg[MAC_LPL_SRC_IDX + 1] << 8);
+        lpl.state = MAC_LPL_WAIT_END;
+        port_submit_deca_work(&lpl.work, end_ms);
+    }
+    else
+    {
+        lpl.stats.overheard++;
+        lpl.state = MAC_LPL_WAIT_OTHER;
+        port_submit_deca_work(&lpl.work, end_ms + lpl.cfg.interactionMs);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_work_handler()
+ *
+ * @brief Listener: end of the sleep after a WUS, on the DW1000 IRQ work queue. For us: answer with the listen
+ *        interval and hand the DW1000 over to the application. For another node: back to low-power listening.
+ */
+static void lpl_work_handler(struct k_work *item)
+{
+    uint8 msg[MAC_LPL_ANS_LEN];
+
+    dwt_spicswakeup(lpl_wake_buf, MAC_LPL_WAKE_BUF_LEN);
+
+    if (lpl.state != MAC_LPL_WAIT_END)
+    {
+        lpl_enter();
+        return;
+    }
+
+    port_set_deca_isr(dwt_isr);
+
+    lpl_buildmsg(msg, lpl.src, MAC_LPL_FCODE_ANS);
+    msg[MAC_LPL_ANS_INTERVAL_IDX] = (uint8)lpl.stats.intervalMs;
+    msg[MAC_LPL_ANS_INTERVAL_IDX + 1] = (uint8)(lpl.stats.intervalMs >> 8);
+    dwt_writetxdata(MAC_LPL_ANS_LEN, msg, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(MAC_LPL_ANS_LEN, 0, 0); /* Zero offset in TX buffer, no ranging. */
+    dwt_starttx(DWT_START_TX_IMMEDIATE);
+
+    /* The TX done interrupt is masked in low-power listening, the frame is short: poll, as example 8a */
+    while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS))
+    { };
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS);
+
+    lpl.state = MAC_LPL_AWAKE;
+    if (lpl.wakeCb != NULL)
+    {
+        lpl.wakeCb(lpl.src);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_sendwus()
+ *
+ * @brief Sender: send the next WUS frame, with the frames left after it and the measured frame period.
+ */
+static void lpl_sendwus(void)
+{
+    uint8 msg[MAC_LPL_WUS_LEN];
+
+    lpl.left--;
+    lpl_buildmsg(msg, lpl.dst, MAC_LPL_FCODE_WUS);
+    msg[MAC_LPL_WUS_CNTDWN_IDX] = (uint8)lpl.left;
+    msg[MAC_LPL_WUS_CNTDWN_IDX + 1] = (uint8)(lpl.left >> 8);
+    msg[MAC_LPL_WUS_PERIOD_IDX] = (uint8)lpl.stats.wusPeriodUs;
+    msg[MAC_LPL_WUS_PERIOD_IDX + 1] = (uint8)(lpl.stats.wusPeriodUs >> 8);
+
+    dwt_writetxdata(MAC_LPL_WUS_LEN, msg, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(MAC_LPL_WUS_LEN, 0, 0); /* Zero offset in TX buffer, no ranging. */
+    dwt_starttx(DWT_START_TX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_txdone_cb()
+ *
+ * @brief Sender: WUS frame sent, measure the frame period and send the next one, or listen for the answer.
+ */
+static void lpl_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    uint32 now, us;
+
+    if (lpl.state != MAC_LPL_SEND_WUS)
+    {
+        return;
+    }
+
+    now = dwt_readsystimestamphi32();
+    us = MAC_LPL_HI32_TO_US(now - lpl.lastTxTime);
+    lpl.lastTxTime = now;
+    if (us < 0xFFFF)
+    {
+        lpl.stats.wusPeriodUs = (uint16)(((uint32)lpl.stats.wusPeriodUs * 7 + us) / 8);
+    }
+
+    if (lpl.left > 0)
+    {
+        lpl_sendwus();
+        return;
+    }
+
+    /* The answer comes within the interaction period, in uus (1 uus = 512/499.2 us) */
+    lpl.state = MAC_LPL_WAIT_ANS;
+    dwt_setrxtimeout((uint16)MIN((uint32)lpl.cfg.interactionMs * 975, 0xFFFF));
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_end()
+ *
+ * @brief Sender: end of a wake-up.
+ */
+static void lpl_end(int status)
+{
+    lpl.state = MAC_LPL_IDLE;
+    dwt_setrxtimeout(0);
+    if (status == DWT_SUCCESS)
+    {
+        lpl.stats.wakeups++;
+    }
+    else
+    {
+        lpl.stats.overheard++;
+    }
+    if (lpl.doneCb != NULL)
+    {
+        lpl.doneCb(lpl.dst, status);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn lpl_rxans_cb() / lpl_rxto_cb()
+ *
+ * @brief Sender: answer of the listener, it gives its listen interval for the next WUS / timeout or error.
+ */
+static void lpl_rxans_cb(const dwt_cb_data_t *cb_data)
+{
+    uint8 msg[MAC_LPL_ANS_LEN];
+    uint16 src, dst;
+    int i;
+
+    if (lpl.state != MAC_LPL_WAIT_ANS)
+    {
+        return;
+    }
+
+    if (cb_data->datalength == MAC_LPL_ANS_LEN)
+    {
+        dwt_readrxdata(msg, MAC_LPL_ANS_LEN, 0);
+        src = msg[MAC_LPL_SRC_IDX] | (msg[MAC_LPL_SRC_IDX + 1] << 8);
+        dst = msg[MAC_LPL_DST_IDX] | (msg[MAC_LPL_DST_IDX + 1] << 8);
+        if ((msg[MAC_LPL_FCODE_IDX] == MAC_LPL_FCODE_ANS) && (src == lpl.dst) && (dst == lpl.cfg.addr))
+        {
+            for (i = 0; i < MAC_LPL_PEERS; i++)
+            {
+                if (lpl.peers[i].addr == src)
+                {
+                    break;
+                }
+            }
+            if (i == MAC_LPL_PEERS)
+            {
+                i = lpl.nextPeer;
+                lpl.nextPeer = (lpl.nextPeer + 1) % MAC_LPL_PEERS;
+                lpl.peers[i].addr = src;
+            }
+            lpl.peers[i].intervalMs = msg[MAC_LPL_ANS_INTERVAL_IDX] | (msg[MAC_LPL_ANS_INTERVAL_IDX + 1] << 8);
+
+            lpl_end(DWT_SUCCESS);
+            return;
+        }
+    }
+
+    /* Someone else's frame, keep waiting */
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+static void lpl_rxto_cb(const dwt_cb_data_t *cb_data)
+{
+    if (lpl.state == MAC_LPL_WAIT_ANS)
+    {
+        lpl_end(DWT_ERROR);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_init()
+ *
+ * @brief see mac_lpl.h
+ */
+int mac_lpl_init(const mac_lpl_config_t *config)
+{
+    if ((config == NULL) || (config->phy == NULL))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&lpl, 0, sizeof(lpl));
+    lpl.cfg = *config;
+    lpl.stats.wusPeriodUs = MAC_LPL_WUS_PERIOD_US;
+    k_delayed_work_init(&lpl.work, lpl_work_handler);
+
+    lpl_stepupdate();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_listen()
+ *
+ * @brief see mac_lpl.h
+ */
+void mac_lpl_listen(mac_lpl_wake_cb_t cb)
+{
+    lpl.wakeCb = cb;
+    lpl_enter();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_resume()
+ *
+ * @brief see mac_lpl.h
+ */
+void mac_lpl_resume(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    dwt_forcetrxoff();
+    lpl_enter();
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_wake()
+ *
+ * @brief see mac_lpl.h
+ */
+int mac_lpl_wake(uint16 dst, mac_lpl_done_cb_t cb)
+{
+    decaIrqStatus_t stat;
+    uint32 interval_ms = (uint32)lpl.cfg.latencyMs * 100 / (100 + MAC_LPL_MARGIN_PCT);
+    uint32 wus_us;
+    int i;
+
+    stat = decamutexon();
+    if ((lpl.state == MAC_LPL_SEND_WUS) || (lpl.state == MAC_LPL_WAIT_ANS))
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+
+    for (i = 0; i < MAC_LPL_PEERS; i++)
+    {
+        if ((lpl.peers[i].addr == dst) && (lpl.peers[i].intervalMs != 0))
+        {
+            interval_ms = lpl.peers[i].intervalMs;
+            break;
+        }
+    }
+
+    /* Long enough to cover a whole listen interval of dst, oscillator error included */
+    wus_us = interval_ms * (100 + MAC_LPL_MARGIN_PCT) * 10;
+    lpl.left = (uint16)MIN(wus_us / lpl.stats.wusPeriodUs + 1, 0xFFFF);
+    lpl.dst = dst;
+    lpl.doneCb = cb;
+
+    dwt_setcallbacks(lpl_txdone_cb, lpl_rxans_cb, lpl_rxto_cb, lpl_rxto_cb);
+    dwt_setinterrupt(MAC_LPL_INT_MASK, 1);
+    port_set_deca_isr(dwt_isr);
+
+    lpl.state = MAC_LPL_SEND_WUS;
+    lpl.lastTxTime = dwt_readsystimestamphi32();
+    lpl_sendwus();
+    decamutexoff(stat);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_getstats()
+ *
+ * @brief see mac_lpl.h
+ */
+void mac_lpl_getstats(mac_lpl_stats_t *stats)
+{
+    *stats = lpl.stats;
+}
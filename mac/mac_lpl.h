@@ -0,0 +1,179 @@
+/*! ----------------------------------------------------------------------------
+ * @file    mac_lpl.h
+ * @brief   Low-power listening MAC with a self-tuning listen interval
+ *
+ *          A listener sleeps and samples the channel once per listen
+ *          interval (DW1000 low-power listening: sleep counter, then two
+ *          sniffs separated by a snooze). A sender wakes it up with a wake-up
+ *          sequence (WUS) of back-to-back frames longer than that interval,
+ *          each carrying a countdown to its end: the listener catches one,
+ *          sleeps until the end of the sequence, answers and hands over to
+ *          the application. Frames are those of examples 8a/8b, the WUS
+ *          frame also carries its period and the answer the listen interval.
+ *
+ *          Tuning, from the traffic seen:
+ *          - the listener picks the interval minimising the energy spent
+ *            sampling (once per interval) plus the energy of the WUS it
+ *            gets woken with (its length is the interval), for the measured
+ *            wake-up rate, within the latency target;
+ *          - the snooze follows the WUS frame period the senders report;
+ *          - the sender measures its own WUS frame period, and sizes each
+ *            WUS from the interval the listener gave in its last answer.
+ *
+ *          Everything runs on the DW1000 IRQ work queue (port.h): the
+ *          listener wakes within the latency target even with the
+ *          application thread busy.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _MAC_LPL_H_
+#define _MAC_LPL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Frame layout, see examples 8a/8b
+#define MAC_LPL_SN_IDX              2
+#define MAC_LPL_PAN_IDX             3
+#define MAC_LPL_DST_IDX             5
+#define MAC_LPL_SRC_IDX             7
+#define MAC_LPL_FCODE_IDX           9
+#define MAC_LPL_WUS_CNTDWN_IDX      10      // WUS: frames left after this one
+#define MAC_LPL_WUS_PERIOD_IDX      12      // WUS: frame period, us
+#define MAC_LPL_WUS_LEN             16
+#define MAC_LPL_ANS_INTERVAL_IDX    10      // answer: listen interval, ms
+#define MAC_LPL_ANS_LEN             14
+#define MAC_LPL_FCODE_WUS           0xE0
+#define MAC_LPL_FCODE_ANS           0xE1
+
+// Extra WUS length over the listen interval, covers the error of the sleep counter oscillator, percent
+#define MAC_LPL_MARGIN_PCT          20
+
+// Senders whose listeners' interval is remembered
+#define MAC_LPL_PEERS               8
+
+typedef struct
+{
+    uint16 panId;                       // PAN ID of all frames
+    uint16 addr;                        // own short address
+    uint16 latencyMs;                   // target: longest time from the start of a WUS to the listener answering it
+    uint16 listenCostUs;                // energy of one listen cycle (wake-up, two sniffs), as WUS TX time
+    uint16 interactionMs;               // sender: answer timeout after the WUS, listener: sleep after a WUS for another
+    const dwt_config_t *phy;            // PHY both sides use, for the preamble length, kept
+} mac_lpl_config_t;
+
+#define MAC_LPL_CONFIG_DEFAULT(own_addr, phy_config) { \
+    .panId = 0xDECA,                    \
+    .addr = (own_addr),                 \
+    .latencyMs = 2000,                  \
+    .listenCostUs = 300,                \
+    .interactionMs = 50,                \
+    .phy = (phy_config),                \
+}
+
+typedef struct
+{
+    uint16 intervalMs;                  // listen interval in use, a multiple of the sleep counter step
+    uint16 stepMs;                      // sleep counter step, from its calibration
+    uint16 snooze;                      // dwt_setsnoozetime() value
+    uint16 wusPeriodUs;                 // WUS frame period, measured (sender) or reported (listener)
+    uint32 wakeups;                     // listener: WUS for us / sender: WUS answered
+    uint32 overheard;                   // listener: WUS for others / sender: WUS not answered
+    uint32 falseWakes;                  // listener: frames other than a WUS
+} mac_lpl_stats_t;
+
+/* Listener: woken up by src, from the DW1000 IRQ thread, the answer is already sent. The application has the
+ * DW1000 (dwt_isr installed, callbacks free) until it calls mac_lpl_resume(). */
+typedef void (*mac_lpl_wake_cb_t)(uint16 src);
+
+/* Sender: end of mac_lpl_wake(), status DWT_SUCCESS if dst answered, from the DW1000 IRQ thread */
+typedef void (*mac_lpl_done_cb_t)(uint16 dst, int status);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_init()
+ *
+ * @brief Set the configuration and calibrate the sleep counter, with the SPI at its slow rate for the duration. The
+ *        DW1000 must have been initialised and configured with config->phy.
+ *
+ * input parameters
+ * @param config - addresses, latency target and PHY, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config or its PHY is NULL
+ */
+int mac_lpl_init(const mac_lpl_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_listen()
+ *
+ * @brief Install the low-power listening ISR and put the DW1000 to low-power listening.
+ *
+ * input parameters
+ * @param cb - called on each wake-up for us
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_lpl_listen(mac_lpl_wake_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_resume()
+ *
+ * @brief Listener: end of the interaction that followed a wake-up, go back to low-power listening with the interval
+ *        tuned to the traffic seen so far.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void mac_lpl_resume(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_wake()
+ *
+ * @brief Sender: send a WUS to dst, as long as the last interval dst answered with (latencyMs before the first
+ *        answer), then wait for its answer. Takes over the DW1000 callbacks and interrupts.
+ *
+ * input parameters
+ * @param dst - listener
+ * @param cb  - called with the outcome, may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if a WUS is already being sent
+ */
+int mac_lpl_wake(uint16 dst, mac_lpl_done_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn mac_lpl_getstats()
+ *
+ * @brief Read the tuning state and counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - tuning state and counters since mac_lpl_init()
+ *
+ * no return value
+ */
+void mac_lpl_getstats(mac_lpl_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MAC_LPL_H_ */
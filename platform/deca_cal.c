@@ -0,0 +1,157 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_cal.c
+ * @brief   Persistent calibration of the DW1000: antenna delays and crystal
+ *          trim kept in the nRF52 flash (CONFIG_DW1000_CAL_STORE)
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_cal.h"
+
+#include <zephyr.h>
+#include <device.h>
+#include <flash.h>
+#include <nvs/nvs.h>
+
+typedef struct
+{
+    uint8 mounted;
+    uint8 valid;                        // rec holds a record
+    deca_cal_t rec;
+    struct nvs_fs fs;
+} deca_cal_local_t;
+
+static deca_cal_local_t cal;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cal_mount()
+ *
+ * @brief Mount the NVS file system on the first sectors of the storage partition, once.
+ */
+static int cal_mount(void)
+{
+    struct flash_pages_info info;
+    struct device *flash;
+
+    if (cal.mounted)
+    {
+        return DWT_SUCCESS;
+    }
+
+    flash = device_get_binding(DT_FLASH_DEV_NAME);
+    if ((flash == NULL) || (flash_get_page_info_by_offs(flash, DT_FLASH_AREA_STORAGE_OFFSET, &info) != 0))
+    {
+        return DWT_ERROR;
+    }
+    cal.fs.offset = DT_FLASH_AREA_STORAGE_OFFSET;
+    cal.fs.sector_size = info.size;
+    cal.fs.sector_count = DECA_CAL_NVS_SECTORS;
+    if (nvs_init(&cal.fs, DT_FLASH_DEV_NAME) != 0)
+    {
+        return DWT_ERROR;
+    }
+    cal.mounted = 1;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_load()
+ *
+ * @brief see deca_cal.h
+ */
+int deca_cal_load(void)
+{
+    deca_cal_t rec;
+
+    cal.valid = 0;
+    if (cal_mount() != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+    if ((nvs_read(&cal.fs, DECA_CAL_NVS_ID, &rec, sizeof(rec)) != sizeof(rec)) || (rec.version != DECA_CAL_VERSION))
+    {
+        return DWT_ERROR;
+    }
+    cal.rec = rec;
+    cal.valid = 1;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_get()
+ *
+ * @brief see deca_cal.h
+ */
+int deca_cal_get(deca_cal_t *rec)
+{
+    if (!cal.valid)
+    {
+        return DWT_ERROR;
+    }
+    *rec = cal.rec;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_save()
+ *
+ * @brief see deca_cal.h
+ */
+int deca_cal_save(const deca_cal_t *rec)
+{
+    deca_cal_t r = *rec;
+
+    r.version = DECA_CAL_VERSION;
+    /* NVS returns 0 without writing when the data stored is the same */
+    if ((cal_mount() != DWT_SUCCESS) || (nvs_write(&cal.fs, DECA_CAL_NVS_ID, &r, sizeof(r)) < 0))
+    {
+        return DWT_ERROR;
+    }
+    cal.rec = r;
+    cal.valid = 1;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_erase()
+ *
+ * @brief see deca_cal.h
+ */
+int deca_cal_erase(void)
+{
+    if ((cal_mount() != DWT_SUCCESS) || (nvs_delete(&cal.fs, DECA_CAL_NVS_ID) != 0))
+    {
+        return DWT_ERROR;
+    }
+    cal.valid = 0;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_antdly()
+ *
+ * @brief see deca_cal.h
+ */
+int deca_cal_antdly(const dwt_config_t *phy, uint16 *tx, uint16 *rx)
+{
+    if (!cal.valid || (cal.rec.chan != phy->chan) || (cal.rec.prf != phy->prf) || (cal.rec.txAntDly == 0))
+    {
+        return DWT_ERROR;
+    }
+    *tx = cal.rec.txAntDly;
+    *rx = cal.rec.rxAntDly;
+
+    return DWT_SUCCESS;
+}
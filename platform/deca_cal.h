@@ -0,0 +1,128 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_cal.h
+ * @brief   Persistent calibration of the DW1000: antenna delays and crystal
+ *          trim kept in the nRF52 flash (CONFIG_DW1000_CAL_STORE)
+ *
+ *          The record lives in an NVS file system on the storage partition
+ *          of the flash. The bring-up of dw1000_drv.c loads it after
+ *          dwt_initialise() and applies its crystal trim instead of the OTP
+ *          one. The antenna delays depend on the channel and PRF they were
+ *          measured on: the application takes them with deca_cal_antdly()
+ *          after dwt_configure(), which leaves its defaults when the record
+ *          is for another configuration or missing.
+ *
+ *          rng_cal.h measures the values, deca_cal_save() keeps them for
+ *          the next boots.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_CAL_H_
+#define _DECA_CAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// NVS entry of the record, and layout version: a record of another version is ignored
+#define DECA_CAL_NVS_ID             0xDC01
+#define DECA_CAL_VERSION            1
+
+// Flash sectors of the NVS file system, from the start of the storage partition
+#define DECA_CAL_NVS_SECTORS        2
+
+typedef struct
+{
+    uint8 version;                      // DECA_CAL_VERSION
+    uint8 chan;                         // configuration the antenna delays were measured on
+    uint8 prf;
+    uint8 xtalTrim;                     // FS_XTALT value, 0 to keep the OTP one
+    uint16 txAntDly;                    // device time units
+    uint16 rxAntDly;
+} deca_cal_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_load()
+ *
+ * @brief Mount the NVS file system if not done yet and read the record into the copy returned by deca_cal_get().
+ *        Called by the bring-up, again only to drop changes made elsewhere.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if a record was read, or DWT_ERROR if there is none or the flash cannot be mounted
+ */
+int deca_cal_load(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_get()
+ *
+ * @brief Copy of the record loaded or saved last.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param rec - record
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if there is no record
+ */
+int deca_cal_get(deca_cal_t *rec);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_save()
+ *
+ * @brief Write a record to the flash, nothing is written when the one stored is the same. The version is set here.
+ *
+ * input parameters
+ * @param rec - record
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the flash write failed
+ */
+int deca_cal_save(const deca_cal_t *rec);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_erase()
+ *
+ * @brief Delete the record, the next boots keep the OTP crystal trim and the default antenna delays.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the flash cannot be mounted or written
+ */
+int deca_cal_erase(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cal_antdly()
+ *
+ * @brief Antenna delays of the record for a configuration; the values given are left when there is no record or
+ *        it was measured on another channel or PRF.
+ *
+ * input parameters
+ * @param phy - DW1000 configuration given to dwt_configure()
+ * @param tx  - default TX antenna delay, replaced
+ * @param rx  - default RX antenna delay, replaced
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the record applied, or DWT_ERROR if the defaults were left
+ */
+int deca_cal_antdly(const dwt_config_t *phy, uint16 *tx, uint16 *rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_CAL_H_ */
@@ -0,0 +1,192 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_cir.c
+ * @brief   Channel impulse response capture and streaming
+ *
+ *          chunk (frame pool buffer):  | deca_cir_hdr_t | count samples |
+ *          accumulator read:                          ^ dummy octet, then the samples
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_cir.h"
+
+#include <zephyr.h>
+
+// Accumulator bytes per sample: int16 re, int16 im
+#define CIR_SAMPLE_LEN              4
+
+typedef struct
+{
+    deca_cir_config_t cfg;
+    deca_cir_sink_t sink;
+    uint16 frames;                      // good frames since the last everyN capture
+    uint8 capture;
+    atomic_t trigger;
+    deca_cir_stats_t stats;
+} deca_cir_local_t;
+
+static deca_cir_local_t cir;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cir_pack8()
+ *
+ * @brief Compress count int16 re/im samples to int8 in place, with the smallest shift that fits them.
+ */
+static uint8 cir_pack8(uint8 *p, uint16 count)
+{
+    int32 max = 0;
+    uint8 shift = 0;
+    int i;
+
+    for (i = 0; i < 2 * count; i++)
+    {
+        int32 v = (int16)(p[2 * i] | (p[2 * i + 1] << 8));
+
+        max = MAX(max, (v < 0) ? (-v - 1) : v);
+    }
+    while ((max >> shift) > 127)
+    {
+        shift++;
+    }
+
+    /* Byte i is written after bytes 2i and 2i + 1 are read */
+    for (i = 0; i < 2 * count; i++)
+    {
+        p[i] = (uint8)(int8)((int16)(p[2 * i] | (p[2 * i + 1] << 8)) >> shift);
+    }
+
+    return shift;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_init()
+ *
+ * @brief see deca_cir.h
+ */
+int deca_cir_init(const deca_cir_config_t *config, deca_cir_sink_t sink)
+{
+    uint16 max_len = DECA_FRAME_EXT_COUNT ? DECA_FRAME_EXT_LEN : DECA_FRAME_STD_LEN;
+
+    if ((config == NULL) || (sink == NULL) || (config->chunkSamples == 0) ||
+        (sizeof(deca_cir_hdr_t) + (uint32)config->chunkSamples * CIR_SAMPLE_LEN > max_len))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&cir, 0, sizeof(cir));
+    cir.cfg = *config;
+    cir.sink = sink;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_rx()
+ *
+ * @brief see deca_cir.h
+ */
+int deca_cir_rx(const deca_rxqual_t *qual)
+{
+    uint16 acc_len = (cir.cfg.prf == DWT_PRF_16M) ? DECA_CIR_LEN_16M : DECA_CIR_LEN_64M;
+    uint16 fp = qual->fpIndex >> 6;
+    uint16 first, total, off, cnt;
+    int sel;
+
+    cir.stats.frames++;
+
+    sel = atomic_clear(&cir.trigger);
+    if (cir.cfg.everyN && (++cir.frames >= cir.cfg.everyN))
+    {
+        cir.frames = 0;
+        sel = 1;
+    }
+    if (qual->los < cir.cfg.losBelow)
+    {
+        sel = 1;
+    }
+    if (!sel)
+    {
+        return 0;
+    }
+
+    if ((cir.cfg.pre == 0) && (cir.cfg.post == 0))
+    {
+        first = 0;
+        total = acc_len;
+    }
+    else
+    {
+        first = (fp > cir.cfg.pre) ? (fp - cir.cfg.pre) : 0;
+        total = MIN(fp + cir.cfg.post, acc_len) - MIN(first, acc_len);
+    }
+
+    cir.capture++;
+    cir.stats.captures++;
+
+    for (off = 0; off < total; off += cnt)
+    {
+        deca_frame_t *frame;
+        deca_cir_hdr_t *hdr;
+
+        cnt = MIN(cir.cfg.chunkSamples, total - off);
+        frame = deca_frame_alloc(sizeof(deca_cir_hdr_t) + cnt * CIR_SAMPLE_LEN, K_NO_WAIT);
+        if (frame == NULL)
+        {
+            cir.stats.dropped++;
+            break;
+        }
+
+        /* The dummy octet goes on the last header byte, the samples right after the header */
+        dwt_readaccdata(&frame->data[sizeof(deca_cir_hdr_t) - 1], cnt * CIR_SAMPLE_LEN + 1,
+                        (first + off) * CIR_SAMPLE_LEN);
+
+        hdr = (deca_cir_hdr_t *)frame->data;
+        hdr->mark = DECA_CIR_MARK;
+        hdr->capture = cir.capture;
+        hdr->fmt = cir.cfg.fmt;
+        hdr->shift = 0;
+        hdr->first = first + off;
+        hdr->count = cnt;
+        hdr->fpIndex = qual->fpIndex;
+        hdr->total = total;
+
+        if (cir.cfg.fmt == DECA_CIR_FMT_8)
+        {
+            hdr->shift = cir_pack8(&frame->data[sizeof(deca_cir_hdr_t)], cnt);
+            frame->len = sizeof(deca_cir_hdr_t) + cnt * 2;
+        }
+
+        cir.sink(frame);
+        deca_frame_unref(frame);
+        cir.stats.chunks++;
+    }
+
+    return 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_trigger()
+ *
+ * @brief see deca_cir.h
+ */
+void deca_cir_trigger(void)
+{
+    atomic_set(&cir.trigger, 1);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_getstats()
+ *
+ * @brief see deca_cir.h
+ */
+void deca_cir_getstats(deca_cir_stats_t *stats)
+{
+    *stats = cir.stats;
+}
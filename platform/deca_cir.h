@@ -0,0 +1,166 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_cir.h
+ * @brief   Channel impulse response capture and streaming
+ *
+ *          The accumulator of a selected frame is read with
+ *          dwt_readaccdata() straight into frame pool buffers (deca_frame.h)
+ *          that are handed to a sink, ble_dwm1001_dps_frame() or a UART
+ *          writer, by reference: the samples are not copied on the way.
+ *          Each chunk is one read, the header of the buffer in front of the
+ *          samples; the dummy octet the accumulator gives first lands on the
+ *          last header byte, which is written after the read.
+ *
+ *          Frames are selected by a sampling policy: every Nth good frame,
+ *          frames whose line of sight indicator (deca_rxqual.h) dropped
+ *          below a threshold, or the next frame after deca_cir_trigger().
+ *          The capture can be windowed around the first path (pre and post
+ *          samples) instead of the whole accumulator (992 samples at 16 MHz
+ *          PRF, 1016 at 64 MHz, 4 KB), and the int16 re/im samples
+ *          compressed to int8 with a shift per chunk (block floating point).
+ *
+ *          The accumulator holds the last frame until the receiver is
+ *          enabled again, the capture is done before, the frames arriving
+ *          meanwhile are lost: at the fast SPI rate about 4 ms for a whole
+ *          accumulator, 0.3 ms for a 64 sample window.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_CIR_H_
+#define _DECA_CIR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "deca_frame.h"
+#include "deca_rxqual.h"
+
+// First byte of a chunk, distinct from the BLE report counts (fewer than 0x7D reports fit an ATT MTU) and the BLE marks
+#define DECA_CIR_MARK               0x7E
+
+// Accumulator length, samples
+#define DECA_CIR_LEN_16M            992
+#define DECA_CIR_LEN_64M            1016
+
+typedef enum
+{
+    DECA_CIR_FMT_16,                    // int16 re, int16 im
+    DECA_CIR_FMT_8                      // int8 re, int8 im, to be shifted left by the chunk shift
+} deca_cir_fmt_t;
+
+/* Chunk header, followed by count samples */
+typedef struct
+{
+    uint8 mark;                         // DECA_CIR_MARK
+    uint8 capture;                      // capture number, the same for all the chunks of a capture
+    uint8 fmt;                          // deca_cir_fmt_t
+    uint8 shift;                        // DECA_CIR_FMT_8: left shift restoring the samples
+    uint16 first;                       // accumulator index of the first sample of the chunk
+    uint16 count;                       // samples in the chunk
+    uint16 fpIndex;                     // first path index of the frame, 10.6 fixed point
+    uint16 total;                       // samples in the capture
+} __attribute__((__packed__)) deca_cir_hdr_t;
+
+typedef struct
+{
+    uint8 prf;                          // DWT_PRF_16M or DWT_PRF_64M, as configured: accumulator length
+    uint16 everyN;                      // capture one good frame in everyN, 0: none
+    uint8 losBelow;                     // capture frames with a line of sight indicator below, 0: none
+    uint16 pre;                         // window: samples before the first path, 0 and post 0 for the whole accumulator
+    uint16 post;                        // window: samples from the first path on
+    uint8 chunkSamples;                 // samples per chunk, header included it must fit a frame buffer and the link
+    deca_cir_fmt_t fmt;
+} deca_cir_config_t;
+
+#define DECA_CIR_CONFIG_DEFAULT {       \
+    .prf = DWT_PRF_64M,                 \
+    .everyN = 10,                       \
+    .losBelow = 50,                     \
+    .pre = 16,                          \
+    .post = 48,                         \
+    .chunkSamples = 28,                 \
+    .fmt = DECA_CIR_FMT_16,             \
+}
+
+typedef struct
+{
+    uint32 frames;                      // deca_cir_rx() calls
+    uint32 captures;
+    uint32 chunks;
+    uint32 dropped;                     // captures cut short, no frame buffer free
+} deca_cir_stats_t;
+
+/* Takes a chunk, the frame is only valid during the call: the sink takes its own reference to keep it */
+typedef void (*deca_cir_sink_t)(deca_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_init()
+ *
+ * @brief Set the sampling policy, window and format, and the sink of the chunks.
+ *
+ * input parameters
+ * @param config - policy and format, copied
+ * @param sink   - called with each chunk
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config or sink is NULL, or a chunk does not fit a frame buffer
+ */
+int deca_cir_init(const deca_cir_config_t *config, deca_cir_sink_t sink);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_rx()
+ *
+ * @brief Apply the sampling policy to a good frame and capture it if selected. Call before the receiver is enabled
+ *        again.
+ *
+ * input parameters
+ * @param qual - quality of the frame, from deca_rxqual_read(): line of sight indicator and first path index
+ *
+ * output parameters
+ *
+ * returns 1 if the frame was captured, 0 otherwise
+ */
+int deca_cir_rx(const deca_rxqual_t *qual);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_trigger()
+ *
+ * @brief Capture the next frame given to deca_cir_rx() whatever the policy, e.g. on a host request. Callable from any
+ *        thread.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_cir_trigger(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_cir_getstats()
+ *
+ * @brief Read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since deca_cir_init()
+ *
+ * no return value
+ */
+void deca_cir_getstats(deca_cir_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_CIR_H_ */
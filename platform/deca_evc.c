@@ -0,0 +1,189 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_evc.c
+ * @brief   Event counter telemetry: totals and rates of the DW1000 event
+ *          counters, with a diagnosis of what the losses come from
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_evc.h"
+#include "deca_regs.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* Event counters are 12 bits */
+#define EVC_DELTA(now, prev)        ((uint16)((now) - (prev)) & 0x0FFF)
+
+typedef struct
+{
+    deca_evc_config_t cfg;
+    deca_evc_cb_t cb;
+    volatile uint8 running;
+    uint16 last[DECA_EVC_COUNT];        // counters at the start of the period
+    uint32 lastMs;
+    deca_evc_t evc;
+} deca_evc_local_t;
+
+static deca_evc_local_t evl;
+
+/* Out of evl, which deca_evc_start() clears: the handler may still be running after k_delayed_work_cancel(), it holds
+ * evc_lock for the whole period end and start/stop wait for it */
+static struct k_delayed_work evc_work;
+static uint8 evc_work_init;
+static K_MUTEX_DEFINE(evc_lock);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn evc_read()
+ *
+ * @brief Read the counters in the deca_evc_id_t order.
+ */
+static void evc_read(uint16 *cnt)
+{
+    dwt_deviceentcnts_t evc;
+
+    dwt_readeventcounters(&evc);
+
+    cnt[DECA_EVC_PHE] = evc.PHE;
+    cnt[DECA_EVC_RSL] = evc.RSL;
+    cnt[DECA_EVC_CRCG] = evc.CRCG;
+    cnt[DECA_EVC_CRCB] = evc.CRCB;
+    cnt[DECA_EVC_ARFE] = evc.ARFE;
+    cnt[DECA_EVC_OVER] = evc.OVER;
+    cnt[DECA_EVC_SFDTO] = evc.SFDTO;
+    cnt[DECA_EVC_PTO] = evc.PTO;
+    cnt[DECA_EVC_RTO] = evc.RTO;
+    cnt[DECA_EVC_TXF] = evc.TXF;
+    cnt[DECA_EVC_HPW] = evc.HPW;
+    cnt[DECA_EVC_TXW] = evc.TXW;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn evc_work_handler()
+ *
+ * @brief End of a period, on the DW1000 IRQ work queue: read the counters, update the totals and rates.
+ */
+static void evc_work_handler(struct k_work *item)
+{
+    uint16 cnt[DECA_EVC_COUNT];
+    uint32 delta[DECA_EVC_COUNT];
+    uint32 now, ms, rf;
+    int i;
+
+    k_mutex_lock(&evc_lock, K_FOREVER);
+    if (!evl.running)
+    {
+        k_mutex_unlock(&evc_lock);
+        return;
+    }
+
+    evc_read(cnt);
+    now = k_uptime_get_32();
+    ms = MAX(now - evl.lastMs, 1);
+    evl.lastMs = now;
+
+    for (i = 0; i < DECA_EVC_COUNT; i++)
+    {
+        delta[i] = EVC_DELTA(cnt[i], evl.last[i]);
+        evl.last[i] = cnt[i];
+        evl.evc.total[i] += delta[i];
+        evl.evc.rate[i] = (uint16)MIN(delta[i] * 10000 / ms, 0xFFFF);
+    }
+
+    rf = delta[DECA_EVC_PHE] + delta[DECA_EVC_RSL] + delta[DECA_EVC_CRCB] + delta[DECA_EVC_SFDTO];
+    evl.evc.flags = 0;
+    if (rf * 100 > (uint32)evl.cfg.rfErrPct * (rf + delta[DECA_EVC_CRCG]))
+    {
+        evl.evc.flags |= DECA_EVC_RF_ERRORS;
+    }
+    if (delta[DECA_EVC_OVER])
+    {
+        evl.evc.flags |= DECA_EVC_RX_OVERRUN;
+    }
+    if (delta[DECA_EVC_HPW] + delta[DECA_EVC_TXW])
+    {
+        evl.evc.flags |= DECA_EVC_LATE_TX;
+    }
+    evl.evc.periods++;
+
+    if (evl.cb)
+    {
+        evl.cb(&evl.evc);
+    }
+
+    port_submit_deca_work(&evc_work, evl.cfg.periodMs);
+    k_mutex_unlock(&evc_lock);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_start()
+ *
+ * @brief see deca_evc.h
+ */
+int deca_evc_start(const deca_evc_config_t *config, deca_evc_cb_t cb)
+{
+    decaIrqStatus_t stat;
+
+    if ((config == NULL) || (config->periodMs == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    k_mutex_lock(&evc_lock, K_FOREVER);
+    deca_evc_stop();
+
+    memset(&evl, 0, sizeof(evl));
+    evl.cfg = *config;
+    evl.cb = cb;
+
+    /* Enable only: dwt_configeventcounters() would reset them under deca_sniff */
+    stat = decamutexon();
+    dwt_write8bitoffsetreg(DIG_DIAG_ID, EVC_CTRL_OFFSET, (uint8)EVC_EN);
+    evc_read(evl.last);
+    decamutexoff(stat);
+    evl.lastMs = k_uptime_get_32();
+
+    if (!evc_work_init)
+    {
+        k_delayed_work_init(&evc_work, evc_work_handler);
+        evc_work_init = 1;
+    }
+    evl.running = 1;
+    port_submit_deca_work(&evc_work, evl.cfg.periodMs);
+    k_mutex_unlock(&evc_lock);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_stop()
+ *
+ * @brief see deca_evc.h
+ */
+void deca_evc_stop(void)
+{
+    k_mutex_lock(&evc_lock, K_FOREVER);
+    if (evl.running)
+    {
+        evl.running = 0;
+        k_delayed_work_cancel(&evc_work);
+    }
+    k_mutex_unlock(&evc_lock);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_get()
+ *
+ * @brief see deca_evc.h
+ */
+void deca_evc_get(deca_evc_t *evc)
+{
+    *evc = evl.evc;
+}
@@ -0,0 +1,131 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_evc.h
+ * @brief   Event counter telemetry: totals and rates of the DW1000 event
+ *          counters, with a diagnosis of what the losses come from
+ *
+ *          Once per period the telemetry reads the twelve event counters,
+ *          on the DW1000 IRQ work queue, extends them to 32 bits and
+ *          computes their rates over the period. As the load grows the
+ *          rates tell the losses apart:
+ *          - RF: PHY header errors, sync losses, CRC errors and SFD
+ *            timeouts grow against the good frames (collisions, range);
+ *          - RX overrun: frames lost while the host was late reading the
+ *            previous one (OVER, double buffered receiver);
+ *          - late TX: delayed transmissions programmed too late (HPW,
+ *            TXW), the host side of the schedule is too slow.
+ *
+ *          The counters are 12 bits: the period must keep each of them
+ *          under 4096 events, e.g. 1 s up to 4000 frames per second. They
+ *          are enabled without being reset, the telemetry runs alongside
+ *          deca_sniff which reads them too.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_EVC_H_
+#define _DECA_EVC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+/* Counters, in the dwt_deviceentcnts_t order */
+typedef enum
+{
+    DECA_EVC_PHE,                       // PHY header errors
+    DECA_EVC_RSL,                       // RX frame sync losses
+    DECA_EVC_CRCG,                      // good frames
+    DECA_EVC_CRCB,                      // CRC errors
+    DECA_EVC_ARFE,                      // address filter rejections
+    DECA_EVC_OVER,                      // RX overruns
+    DECA_EVC_SFDTO,                     // SFD timeouts
+    DECA_EVC_PTO,                       // preamble detection timeouts
+    DECA_EVC_RTO,                       // RX frame wait timeouts
+    DECA_EVC_TXF,                       // frames sent
+    DECA_EVC_HPW,                       // half period warnings: delayed TX or RX programmed late
+    DECA_EVC_TXW,                       // TX power up warnings
+    DECA_EVC_COUNT
+} deca_evc_id_t;
+
+/* Diagnosis of a period */
+#define DECA_EVC_RF_ERRORS          0x01    // RF errors above rfErrPct of the frames received
+#define DECA_EVC_RX_OVERRUN         0x02    // frames lost to RX overruns
+#define DECA_EVC_LATE_TX            0x04    // delayed transmissions programmed too late
+
+typedef struct
+{
+    uint32 total[DECA_EVC_COUNT];       // events since deca_evc_start()
+    uint16 rate[DECA_EVC_COUNT];        // events per second over the last period, 0.1 units, saturated
+    uint8 flags;                        // DECA_EVC_xxx diagnosis of the last period
+    uint32 periods;
+} deca_evc_t;
+
+/* Called at the end of each period, from the DW1000 IRQ work queue */
+typedef void (*deca_evc_cb_t)(const deca_evc_t *evc);
+
+typedef struct
+{
+    uint16 periodMs;                    // time between two readings
+    uint8 rfErrPct;                     // RF errors above which DECA_EVC_RF_ERRORS is set, percent of the frames
+} deca_evc_config_t;
+
+#define DECA_EVC_CONFIG_DEFAULT {       \
+    .periodMs = 1000,                   \
+    .rfErrPct = 20,                     \
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_start()
+ *
+ * @brief Enable the event counters, keeping their values, and start reading them periodically.
+ *
+ * input parameters
+ * @param config - period and threshold, copied
+ * @param cb     - called at the end of each period, NULL for none
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or its period 0
+ */
+int deca_evc_start(const deca_evc_config_t *config, deca_evc_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_stop()
+ *
+ * @brief Stop reading the counters, they stay enabled.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_evc_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_evc_get()
+ *
+ * @brief Read the totals and the rates of the last period.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param evc - totals, rates and diagnosis
+ *
+ * no return value
+ */
+void deca_evc_get(deca_evc_t *evc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_EVC_H_ */
@@ -0,0 +1,116 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_frame.c
+ * @brief   Reference counted UWB frame buffers, from two fixed-size pools
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "deca_frame.h"
+
+#define DECA_FRAME_BLOCK(len)   ROUND_UP(sizeof(deca_frame_t) + (len), 4)
+
+K_MEM_SLAB_DEFINE(deca_frame_std_slab, DECA_FRAME_BLOCK(DECA_FRAME_STD_LEN), DECA_FRAME_STD_COUNT, 4);
+#if DECA_FRAME_EXT_COUNT > 0
+K_MEM_SLAB_DEFINE(deca_frame_ext_slab, DECA_FRAME_BLOCK(DECA_FRAME_EXT_LEN), DECA_FRAME_EXT_COUNT, 4);
+#endif
+
+static atomic_t frame_alloc_failed;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_alloc()
+ *
+ * @brief see deca_frame.h
+ */
+deca_frame_t *deca_frame_alloc(uint16 len, int32 timeout)
+{
+    struct k_mem_slab *slab;
+    deca_frame_t *frame;
+    uint16 size;
+
+    if (len <= DECA_FRAME_STD_LEN)
+    {
+        slab = &deca_frame_std_slab;
+        size = DECA_FRAME_STD_LEN;
+    }
+#if DECA_FRAME_EXT_COUNT > 0
+    else if (len <= DECA_FRAME_EXT_LEN)
+    {
+        slab = &deca_frame_ext_slab;
+        size = DECA_FRAME_EXT_LEN;
+    }
+#endif
+    else
+    {
+        atomic_inc(&frame_alloc_failed);
+        return NULL;
+    }
+
+    if (k_mem_slab_alloc(slab, (void **)&frame, timeout) != 0)
+    {
+        atomic_inc(&frame_alloc_failed);
+        return NULL;
+    }
+
+    atomic_set(&frame->ref, 1);
+    frame->size = size;
+    frame->len = len;
+    frame->status = 0;
+
+    return frame;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_ref()
+ *
+ * @brief see deca_frame.h
+ */
+deca_frame_t *deca_frame_ref(deca_frame_t *frame)
+{
+    atomic_inc(&frame->ref);
+
+    return frame;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_unref()
+ *
+ * @brief see deca_frame.h
+ */
+void deca_frame_unref(deca_frame_t *frame)
+{
+    /* atomic_dec returns the previous value */
+    if (atomic_dec(&frame->ref) != 1)
+    {
+        return;
+    }
+
+#if DECA_FRAME_EXT_COUNT > 0
+    if (frame->size == DECA_FRAME_EXT_LEN)
+    {
+        k_mem_slab_free(&deca_frame_ext_slab, (void **)&frame);
+        return;
+    }
+#endif
+    k_mem_slab_free(&deca_frame_std_slab, (void **)&frame);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_getstats()
+ *
+ * @brief see deca_frame.h
+ */
+void deca_frame_getstats(deca_frame_stats_t *stats)
+{
+    stats->stdFree = k_mem_slab_num_free_get(&deca_frame_std_slab);
+#if DECA_FRAME_EXT_COUNT > 0
+    stats->extFree = k_mem_slab_num_free_get(&deca_frame_ext_slab);
+#else
+    stats->extFree = 0;
+#endif
+    stats->allocFailed = atomic_get(&frame_alloc_failed);
+}
@@ -0,0 +1,120 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_frame.h
+ * @brief   Reference counted UWB frame buffers, from two fixed-size pools
+ *
+ *          Standard frames (127 bytes) and long frames (1023 bytes) come
+ *          from their own k_mem_slab, so the memory is bounded at build
+ *          time and never fragments. A frame is freed when its last
+ *          reference is dropped, which lets RX hand the same buffer to
+ *          several consumers, e.g. a protocol layer and the BLE bridge.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_FRAME_H_
+#define _DECA_FRAME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+
+#include <zephyr.h>
+
+#define DECA_FRAME_STD_LEN      (127)
+#define DECA_FRAME_EXT_LEN      (1023)
+
+#ifdef CONFIG_DW1000_FRAME_STD_COUNT
+#define DECA_FRAME_STD_COUNT    CONFIG_DW1000_FRAME_STD_COUNT
+#define DECA_FRAME_EXT_COUNT    CONFIG_DW1000_FRAME_EXT_COUNT
+#else
+#define DECA_FRAME_STD_COUNT    (12)
+#define DECA_FRAME_EXT_COUNT    (0)
+#endif
+
+typedef struct
+{
+    atomic_t ref;
+    uint16 size;                                // capacity, DECA_FRAME_STD_LEN or DECA_FRAME_EXT_LEN
+    uint16 len;                                 // bytes used
+    uint32 status;                              // RX: SYS_STATUS on ISR entry
+    uint8 rxStamp[5];                           // RX: timestamp, DW1000 time units
+    uint8 data[];
+} deca_frame_t;
+
+typedef struct
+{
+    uint8 stdFree;
+    uint8 extFree;
+    uint32 allocFailed;                         // allocations that found no free frame
+} deca_frame_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_alloc()
+ *
+ * @brief Take a frame of the smallest pool that fits, with one reference. Callable from the DW1000 callbacks with
+ *        K_NO_WAIT.
+ *
+ * input parameters
+ * @param len     - bytes needed, the frame len is set to this
+ * @param timeout - in ms, K_FOREVER or K_NO_WAIT
+ *
+ * output parameters
+ *
+ * returns the frame, or NULL if len is above DECA_FRAME_EXT_LEN or no frame was free in time
+ */
+deca_frame_t *deca_frame_alloc(uint16 len, int32 timeout);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_ref()
+ *
+ * @brief Take one more reference on a frame.
+ *
+ * input parameters
+ * @param frame - frame
+ *
+ * output parameters
+ *
+ * returns the frame
+ */
+deca_frame_t *deca_frame_ref(deca_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_unref()
+ *
+ * @brief Drop a reference on a frame, the last one returns it to its pool.
+ *
+ * input parameters
+ * @param frame - frame
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_frame_unref(deca_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_frame_getstats()
+ *
+ * @brief Read the pool usage.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - free frames and failed allocations
+ *
+ * no return value
+ */
+void deca_frame_getstats(deca_frame_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_FRAME_H_ */
@@ -0,0 +1,243 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_pm.c
+ * @brief   Tag power manager: DW1000 DEEPSLEEP and nRF52 idle between
+ *          ranging epochs, with per-state residency
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_pm.h"
+#include "deca_slpcal.h"
+#include "deca_regs.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* Clock PLL lock after the wake-up, polled at the slow SPI rate */
+#define DECA_PM_PLL_TIMEOUT_US  1000
+#define DECA_PM_PLL_POLL_US     10
+
+typedef struct
+{
+    deca_pm_config_t cfg;
+    uint32 nextMs;                      // uptime of the next epoch
+    deca_pm_state_t state;
+    uint32 lastCyc;                     // hardware cycles at the last state change
+    uint64_t cyc[DECA_PM_STATES];
+    deca_pm_stats_t stats;
+} deca_pm_local_t;
+
+static deca_pm_local_t pm;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pm_enter()
+ *
+ * @brief Account the time spent in the current state and switch to another.
+ */
+static void pm_enter(deca_pm_state_t state)
+{
+    uint32 now = k_cycle_get_32();
+
+    pm.cyc[pm.state] += (uint32)(now - pm.lastCyc);
+    pm.lastCyc = now;
+    pm.state = state;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pm_setsleepcnt()
+ *
+ * @brief Program the sleep counter for us, see deca_slpcal_sleepcnt(). The system clock goes to the crystal for that,
+ *        see dwt_configuresleepcnt().
+ */
+static void pm_setsleepcnt(uint32 us, int round_up)
+{
+    uint16 cnt = deca_slpcal_sleepcnt(us, round_up);
+
+    port_set_dw1000_slowrate();
+    dwt_configuresleepcnt(cnt);
+    port_set_dw1000_fastrate();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pm_calcheck()
+ *
+ * @brief Follow the sleep counter drift, with the DW1000 awake, see deca_slpcal_check().
+ */
+static void pm_calcheck(void)
+{
+    deca_slpcal_stats_t cal;
+
+    deca_slpcal_check();
+    deca_slpcal_getstats(&cal);
+    pm.stats.stepUs = cal.stepNs / 1000;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_wakeup()
+ *
+ * @brief see deca_pm.h
+ */
+int deca_pm_wakeup(void)
+{
+    uint32 waited = 0;
+    int ret = DWT_ERROR;
+
+    port_set_dw1000_slowrate();
+    if (port_wakeup_dw1000_fast() == 0)
+    {
+        while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_CPLOCK) && (waited < DECA_PM_PLL_TIMEOUT_US))
+        {
+            k_busy_wait(DECA_PM_PLL_POLL_US);
+            waited += DECA_PM_PLL_POLL_US;
+        }
+        ret = (waited < DECA_PM_PLL_TIMEOUT_US) ? DWT_SUCCESS : DWT_ERROR;
+    }
+    port_set_dw1000_fastrate();
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_init()
+ *
+ * @brief see deca_pm.h
+ */
+int deca_pm_init(const deca_pm_config_t *config)
+{
+    if ((config == NULL) || (config->periodMs == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&pm, 0, sizeof(pm));
+    pm.cfg = *config;
+
+    pm_calcheck();
+
+    dwt_configuresleep(pm.cfg.sleepMode, DWT_WAKE_SLPCNT | DWT_WAKE_CS | DWT_SLP_EN);
+
+    pm.state = DECA_PM_RUN;
+    pm.lastCyc = k_cycle_get_32();
+    pm.nextMs = k_uptime_get_32() + pm.cfg.periodMs;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_sleep()
+ *
+ * @brief see deca_pm.h
+ */
+int deca_pm_sleep(void)
+{
+    uint32 now = k_uptime_get_32();
+    uint32 epoch = pm.nextMs;
+    int32 remain = (int32)(epoch - now);
+    int ret = DWT_SUCCESS;
+
+    pm.stats.epochs++;
+
+    /* Overran: start now, then back on the schedule */
+    if (remain <= 0)
+    {
+        pm.stats.late++;
+        while ((int32)(pm.nextMs - now) <= 0)
+        {
+            pm.nextMs += pm.cfg.periodMs;
+        }
+        return DWT_SUCCESS;
+    }
+    pm.nextMs += pm.cfg.periodMs;
+
+    if (remain <= pm.cfg.wakeMs)
+    {
+        pm_enter(DECA_PM_IDLE);
+        k_sleep(remain);
+        pm_enter(DECA_PM_RUN);
+        return DWT_SUCCESS;
+    }
+
+    /* Sleep counter backstop: wake-up one step after the epoch at the latest */
+    remain -= pm.cfg.wakeMs;
+    pm_setsleepcnt((uint32)remain * 1000 + deca_slpcal_guardus((uint32)remain * 1000), 1);
+
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_CPLOCK | SYS_STATUS_SLP2INIT);
+    pm_enter(DECA_PM_SLEEP);
+    dwt_entersleep();
+    k_sleep(remain);
+
+    pm_enter(DECA_PM_WAKE);
+    if (deca_pm_wakeup() != DWT_SUCCESS)
+    {
+        pm.stats.wakeFails++;
+        ret = DWT_ERROR;
+    }
+    pm_enter(DECA_PM_RUN);
+    if (ret == DWT_SUCCESS)
+    {
+        pm_calcheck();
+    }
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_off()
+ *
+ * @brief see deca_pm.h
+ */
+void deca_pm_off(uint32 ms)
+{
+    pm_setsleepcnt(ms * 1000, 0);
+
+    /* Sleep counter only, the end of the sleep raises the IRQ line */
+    dwt_configuresleep(pm.cfg.sleepMode, DWT_WAKE_SLPCNT | DWT_SLP_EN);
+    dwt_setinterrupt(SYS_MASK_MSLP2INIT, 1);
+    dwt_entersleep();
+
+    port_system_off();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_getstats()
+ *
+ * @brief see deca_pm.h
+ */
+void deca_pm_getstats(deca_pm_stats_t *stats)
+{
+    int i;
+
+    pm_enter(pm.state);
+    *stats = pm.stats;
+    for (i = 0; i < DECA_PM_STATES; i++)
+    {
+        stats->us[i] = pm.cyc[i] * 1000000 / sys_clock_hw_cycles_per_sec();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_avgcurrent()
+ *
+ * @brief see deca_pm.h
+ */
+uint32 deca_pm_avgcurrent(const uint32 ua[DECA_PM_STATES])
+{
+    uint64_t charge = 0, total = 0;
+    int i;
+
+    pm_enter(pm.state);
+    for (i = 0; i < DECA_PM_STATES; i++)
+    {
+        charge += pm.cyc[i] * ua[i];
+        total += pm.cyc[i];
+    }
+
+    return total ? (uint32)(charge / total) : 0;
+}
@@ -0,0 +1,172 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_pm.h
+ * @brief   Tag power manager: DW1000 DEEPSLEEP and nRF52 idle between
+ *          ranging epochs, with per-state residency
+ *
+ *          | RUN: epoch | SLEEP: DW1000 DEEPSLEEP, nRF52 idle | WAKE | RUN: epoch | ...
+ *
+ *          Epochs follow a fixed period. Once its epoch is done, the
+ *          application calls deca_pm_sleep(), which returns at the start of
+ *          the next epoch with the DW1000 awake and configured again:
+ *          - the DW1000 goes to DEEPSLEEP, keeping its configuration;
+ *          - the nRF52 sleeps on its RTC, with the idle thread in its
+ *            lowest System ON state, and wakes the DW1000 up with its SPI
+ *            chip select just in time for the epoch;
+ *          - the DW1000 sleep counter, calibrated and followed against
+ *            temperature by deca_slpcal.h at each wake-up, is set to wake
+ *            it up on its own one step after the epoch at the latest: the
+ *            sleep counter runs on a 7 to 13 kHz RC oscillator with a 300
+ *            to 600 ms step, too coarse to time an epoch, it is the
+ *            backstop.
+ *
+ *          For long pauses deca_pm_off() times the wake-up with the sleep
+ *          counter alone and puts the nRF52 into System OFF: the DW1000
+ *          IRQ line wakes it up through a reset.
+ *
+ *          Residency goes to four states, weighted by the currents of a
+ *          battery model in deca_pm_avgcurrent().
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_PM_H_
+#define _DECA_PM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+typedef enum
+{
+    DECA_PM_RUN,                        // epoch: nRF52 running, DW1000 awake
+    DECA_PM_IDLE,                       // nRF52 idle, DW1000 awake: too little time left to sleep
+    DECA_PM_SLEEP,                      // nRF52 idle, DW1000 DEEPSLEEP
+    DECA_PM_WAKE,                       // DW1000 waking up: crystal and PLL start up
+    DECA_PM_STATES
+} deca_pm_state_t;
+
+typedef struct
+{
+    uint32 periodMs;                    // epoch period
+    uint16 sleepMode;                   // dwt_configuresleep() mode, DWT_PRESRV_SLEEP | DWT_CONFIG and DWT_LOADUCODE
+                                        // when the LDE is used (ranging)
+    uint16 wakeMs;                      // time the DW1000 needs from chip select to IDLE, taken off each sleep
+} deca_pm_config_t;
+
+#define DECA_PM_CONFIG_DEFAULT(period_ms) { \
+    .periodMs = (period_ms),            \
+    .sleepMode = DWT_PRESRV_SLEEP | DWT_CONFIG, \
+    .wakeMs = 3,                        \
+}
+
+typedef struct
+{
+    uint64_t us[DECA_PM_STATES];        // time spent in each state
+    uint32 epochs;                      // deca_pm_sleep() calls
+    uint32 late;                        // epochs started late: the previous one overran, epochs skipped if needed
+    uint32 wakeFails;                   // the DW1000 did not come out of DEEPSLEEP
+    uint32 stepUs;                      // sleep counter step, from deca_slpcal.h
+} deca_pm_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_init()
+ *
+ * @brief Calibrate the sleep counter (deca_slpcal_check()), set the wake-up sources and start the first epoch now.
+ *        The DW1000 must have been initialised and configured.
+ *
+ * input parameters
+ * @param config - epoch period and sleep mode, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or its period 0
+ */
+int deca_pm_init(const deca_pm_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_sleep()
+ *
+ * @brief End of the current epoch: sleep until the next one. The DW1000 must be idle (no TX or RX pending), its
+ *        interrupts are left as they are.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS at the start of the next epoch, or DWT_ERROR if the DW1000 did not wake up (it is then reset
+ *         by the caller, see dw1000_drv.h)
+ */
+int deca_pm_sleep(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_off()
+ *
+ * @brief Put the DW1000 into DEEPSLEEP for about ms, timed by its sleep counter, and the nRF52 into System OFF. The
+ *        DW1000 IRQ line wakes the nRF52 up through a reset: RAM content, deca_pm statistics included, is lost.
+ *
+ * input parameters
+ * @param ms - sleep time, rounded down to the sleep counter step, one step at least
+ *
+ * output parameters
+ *
+ * does not return
+ */
+void deca_pm_off(uint32 ms);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_wakeup()
+ *
+ * @brief Wake the DW1000 up from DEEPSLEEP with its chip select, or see it already up, and wait for its clock PLL,
+ *        polled at the slow SPI rate. The SPI is left at the fast rate. For callers putting the DW1000 to sleep on
+ *        their own, as the TDoA tag does (rng_tdoa.h).
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if it does not come out of DEEPSLEEP
+ */
+int deca_pm_wakeup(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_getstats()
+ *
+ * @brief Read the residency and counters, the current state included up to now.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - residency and counters since deca_pm_init()
+ *
+ * no return value
+ */
+void deca_pm_getstats(deca_pm_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_pm_avgcurrent()
+ *
+ * @brief Battery model: average current over the residency so far.
+ *
+ * input parameters
+ * @param ua - system current in each state, in uA
+ *
+ * output parameters
+ *
+ * returns the average current in uA, 0 before any residency
+ */
+uint32 deca_pm_avgcurrent(const uint32 ua[DECA_PM_STATES]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_PM_H_ */
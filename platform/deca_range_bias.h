@@ -0,0 +1,290 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    deca_range_bias.h
+ *  @brief   DW1000 range bias correction, direct index tables
+ *
+ *           Generated by gen_range_bias.py from deca_range_tables.c, do not edit.
+ *           range_bias_cm[table][range in 25 cm units] = correction in centimetres
+ *
+ * @attention
+ *
+ * Copyright 2015 (c) DecaWave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_RANGE_BIAS_H_
+#define _DECA_RANGE_BIAS_H_
+
+#include "deca_types.h"
+
+// Table order: 16 MHz PRF narrow band ch 1, 2, 3, 5, wide band ch 4, 7, then the same at 64 MHz PRF
+#define RANGE_BIAS_TBL_64M       6
+#define RANGE_BIAS_TBL_WB        4
+
+// RANGE_BIAS_ONLY, when defined before including this file, keeps that table only, as range_bias_cm[0]
+#ifdef RANGE_BIAS_ONLY
+#define RANGE_BIAS_TBL_NUM       1
+#define RANGE_BIAS_TBL(tbl)      ((tbl) == RANGE_BIAS_ONLY)
+#else
+#define RANGE_BIAS_TBL_NUM       12
+#define RANGE_BIAS_TBL(tbl)      1
+#endif
+
+static const int8 range_bias_cm[RANGE_BIAS_TBL_NUM][256] =
+{
+#if RANGE_BIAS_TBL(0)
+    // ch 1 - range25cm16PRFnb
+    {
+        -23, -23, -22, -22, -21, -20, -19, -19, -18, -18, -17, -17, -16, -15, -14, -14,
+        -13, -13, -13, -12, -12, -11, -11, -11, -10, -10,  -9,  -9,  -9,  -8,  -8,  -7,
+         -7,  -7,  -6,  -6,  -6,  -5,  -5,  -5,  -5,  -4,  -4,  -4,  -3,  -3,  -3,  -3,
+         -2,  -2,  -2,  -1,  -1,  -1,  -1,   0,   0,   0,   0,   1,   1,   1,   1,   1,
+          2,   2,   2,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   5,   5,   5,
+          5,   5,   5,   6,   6,   6,   6,   6,   6,   6,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   9,   9,
+          9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,
+         10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,
+         10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12
+    },
+#endif
+#if RANGE_BIAS_TBL(1)
+    // ch 2 - range25cm16PRFnb
+    {
+        -23, -23, -22, -21, -21, -20, -19, -18, -18, -17, -16, -15, -15, -14, -13, -13,
+        -12, -12, -12, -11, -11, -10, -10,  -9,  -9,  -8,  -8,  -8,  -7,  -7,  -6,  -6,
+         -6,  -5,  -5,  -5,  -4,  -4,  -4,  -3,  -3,  -3,  -2,  -2,  -2,  -1,  -1,  -1,
+          0,   0,   0,   0,   1,   1,   1,   1,   2,   2,   2,   3,   3,   3,   3,   4,
+          4,   4,   4,   5,   5,   5,   5,   5,   6,   6,   6,   6,   6,   6,   6,   7,
+          7,   7,   7,   7,   7,   7,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,
+         10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,
+         10,  10,  10,  10,  10,  10,  10,  10,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13
+    },
+#endif
+#if RANGE_BIAS_TBL(2)
+    // ch 3 - range25cm16PRFnb
+    {
+        -23, -23, -22, -21, -20, -19, -18, -18, -17, -16, -15, -14, -14, -13, -13, -12,
+        -12, -11, -11, -10, -10,  -9,  -9,  -8,  -8,  -7,  -7,  -6,  -6,  -5,  -5,  -5,
+         -4,  -4,  -3,  -3,  -3,  -2,  -2,  -2,  -1,  -1,  -1,   0,   0,   0,   1,   1,
+          1,   1,   2,   2,   2,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,
+          6,   6,   6,   6,   6,   6,   7,   7,   7,   7,   7,   7,   7,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   9,   9,   9,   9,   9,   9,   9,   9,   9,   9,
+          9,   9,   9,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,
+         10,  10,  10,  10,  10,  10,  10,  10,  10,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13
+    },
+#endif
+#if RANGE_BIAS_TBL(3)
+    // ch 5 - range25cm16PRFnb
+    {
+        -23, -23, -21, -20, -19, -18, -17, -15, -14, -13, -12, -12, -11, -10, -10,  -9,
+         -8,  -7,  -7,  -6,  -6,  -5,  -4,  -4,  -3,  -3,  -2,  -2,  -1,  -1,   0,   0,
+          1,   1,   1,   2,   2,   3,   3,   4,   4,   4,   5,   5,   5,   6,   6,   6,
+          6,   7,   7,   7,   7,   7,   8,   8,   8,   8,   8,   8,   9,   9,   9,   9,
+          9,   9,   9,   9,   9,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,  10,
+         10,  10,  10,  10,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,  11,
+         11,  11,  11,  11,  11,  11,  11,  11,  11,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,
+         12,  12,  12,  12,  12,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,
+         13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13,  13
+    },
+#endif
+#if RANGE_BIAS_TBL(4)
+    // ch 4 - range25cm16PRFwb
+    {
+        -28, -28, -28, -28, -28, -28, -28, -28, -26, -25, -23, -22, -20, -19, -18, -17,
+        -16, -15, -14, -13, -12, -11, -10,  -9,  -8,  -7,  -7,  -6,  -5,  -4,  -4,  -3,
+         -2,  -1,  -1,   0,   0,   1,   1,   2,   2,   3,   3,   4,   4,   5,   5,   6,
+          6,   7,   7,   8,   8,   9,   9,   9,  10,  10,  11,  11,  12,  12,  13,  13,
+         14,  14,  14,  15,  15,  16,  16,  16,  17,  17,  17,  18,  18,  18,  18,  19,
+         19,  19,  20,  20,  20,  20,  21,  21,  21,  21,  22,  22,  22,  22,  22,  23,
+         23,  23,  23,  23,  24,  24,  24,  24,  24,  25,  25,  25,  25,  25,  25,  26,
+         26,  26,  26,  26,  26,  27,  27,  27,  27,  27,  27,  27,  28,  28,  28,  28,
+         28,  28,  28,  29,  29,  29,  29,  29,  29,  29,  29,  29,  30,  30,  30,  30,
+         30,  30,  30,  30,  30,  30,  30,  31,  31,  31,  31,  31,  31,  31,  31,  31,
+         31,  31,  31,  31,  31,  32,  32,  32,  32,  32,  32,  32,  32,  32,  32,  32,
+         32,  32,  32,  32,  32,  32,  32,  33,  33,  33,  33,  33,  33,  33,  33,  33,
+         33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,
+         34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,
+         34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  35,
+         35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35
+    },
+#endif
+#if RANGE_BIAS_TBL(5)
+    // ch 7 - range25cm16PRFwb
+    {
+        -28, -28, -28, -28, -28, -27, -24, -22, -19, -18, -16, -14, -12, -11,  -9,  -8,
+         -7,  -6,  -4,  -3,  -2,  -1,   0,   1,   2,   2,   3,   4,   5,   5,   6,   7,
+          8,   9,   9,  10,  11,  12,  12,  13,  14,  15,  15,  16,  16,  17,  17,  18,
+         18,  19,  19,  20,  20,  21,  21,  21,  22,  22,  22,  23,  23,  23,  24,  24,
+         24,  25,  25,  25,  25,  26,  26,  26,  26,  27,  27,  27,  28,  28,  28,  28,
+         28,  29,  29,  29,  29,  29,  30,  30,  30,  30,  30,  30,  30,  31,  31,  31,
+         31,  31,  31,  31,  31,  31,  32,  32,  32,  32,  32,  32,  32,  32,  32,  32,
+         32,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,  33,
+         34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,  34,
+         34,  34,  34,  34,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,  35,
+         35,  35,  35,  35,  35,  35,  35,  35,  35,  36,  36,  36,  36,  36,  36,  36,
+         36,  36,  36,  36,  36,  36,  36,  37,  37,  37,  37,  37,  37,  37,  37,  37,
+         37,  37,  37,  38,  38,  38,  38,  38,  38,  38,  38,  38,  38,  38,  39,  39,
+         39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,
+         39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,
+         39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39,  39
+    },
+#endif
+#if RANGE_BIAS_TBL(6)
+    // ch 1 - range25cm64PRFnb
+    {
+        -17, -17, -16, -14, -13, -12, -11, -11, -10, -10, -10,  -9,  -9,  -9,  -8,  -8,
+         -8,  -7,  -7,  -7,  -6,  -6,  -6,  -5,  -5,  -4,  -4,  -4,  -3,  -3,  -3,  -2,
+         -2,  -1,  -1,  -1,   0,   0,   0,   1,   1,   1,   1,   1,   2,   2,   2,   2,
+          2,   3,   3,   3,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   4,   4,
+          4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   5,
+          5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,
+          5,   5,   5,   5,   5,   5,   6,   6,   6,   6,   6,   6,   6,   6,   6,   6,
+          6,   6,   6,   6,   6,   6,   6,   6,   6,   7,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8
+    },
+#endif
+#if RANGE_BIAS_TBL(7)
+    // ch 2 - range25cm64PRFnb
+    {
+        -17, -17, -16, -14, -13, -11, -11, -10, -10, -10,  -9,  -9,  -9,  -8,  -8,  -7,
+         -7,  -7,  -6,  -6,  -5,  -5,  -4,  -4,  -4,  -3,  -3,  -2,  -2,  -1,  -1,  -1,
+          0,   0,   1,   1,   1,   1,   2,   2,   2,   2,   2,   3,   3,   3,   3,   3,
+          3,   3,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,
+          4,   4,   4,   4,   4,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,
+          5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   6,   6,   6,   6,   6,   6,
+          6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8
+    },
+#endif
+#if RANGE_BIAS_TBL(8)
+    // ch 3 - range25cm64PRFnb
+    {
+        -17, -17, -15, -14, -12, -11, -10, -10, -10,  -9,  -9,  -8,  -8,  -8,  -7,  -7,
+         -6,  -6,  -5,  -5,  -4,  -4,  -3,  -3,  -2,  -2,  -1,  -1,   0,   0,   0,   1,
+          1,   1,   2,   2,   2,   2,   3,   3,   3,   3,   3,   3,   3,   4,   4,   4,
+          4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   5,   5,   5,
+          5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,
+          6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   6,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8
+    },
+#endif
+#if RANGE_BIAS_TBL(9)
+    // ch 5 - range25cm64PRFnb
+    {
+        -17, -17, -14, -12, -11, -10, -10,  -9,  -8,  -8,  -7,  -6,  -6,  -5,  -4,  -4,
+         -3,  -2,  -1,  -1,   0,   0,   1,   1,   2,   2,   2,   3,   3,   3,   3,   4,
+          4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   5,   5,   5,   5,   5,
+          5,   5,   5,   5,   5,   5,   5,   5,   6,   6,   6,   6,   6,   6,   6,   6,
+          6,   6,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,   7,
+          7,   7,   7,   7,   7,   7,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,
+          8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8,   8
+    },
+#endif
+#if RANGE_BIAS_TBL(10)
+    // ch 4 - range25cm64PRFwb
+    {
+        -30, -30, -30, -30, -30, -30, -30, -30, -29, -27, -25, -24, -23, -22, -20, -19,
+        -18, -16, -15, -14, -12, -11, -10,  -9,  -9,  -8,  -7,  -7,  -6,  -5,  -4,  -3,
+         -3,  -2,  -1,   0,   1,   1,   2,   2,   3,   3,   4,   4,   5,   5,   6,   6,
+          6,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  10,  10,  11,  11,  11,
+         11,  12,  12,  12,  12,  13,  13,  13,  13,  13,  13,  14,  14,  14,  14,  14,
+         14,  14,  15,  15,  15,  15,  15,  15,  15,  15,  16,  16,  16,  16,  16,  16,
+         16,  16,  16,  17,  17,  17,  17,  17,  17,  17,  17,  17,  17,  17,  18,  18,
+         18,  18,  18,  18,  18,  18,  18,  18,  18,  18,  18,  19,  19,  19,  19,  19,
+         19,  19,  19,  19,  19,  19,  19,  19,  19,  20,  20,  20,  20,  20,  20,  20,
+         20,  20,  20,  21,  21,  21,  21,  21,  21,  21,  21,  22,  22,  22,  22,  22,
+         22,  22,  22,  23,  23,  23,  23,  23,  23,  23,  23,  23,  23,  23,  23,  23,
+         23,  23,  23,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,
+         24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,
+         24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  25,  25,  25,
+         25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  25,
+         25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  26,  26,  26,  26,  26,  26
+    },
+#endif
+#if RANGE_BIAS_TBL(11)
+    // ch 7 - range25cm64PRFwb
+    {
+        -30, -30, -30, -30, -30, -29, -26, -24, -22, -20, -18, -15, -13, -12, -10,  -9,
+         -8,  -6,  -5,  -4,  -2,  -1,   0,   1,   2,   3,   4,   5,   5,   6,   7,   7,
+          8,   8,   9,   9,  10,  10,  11,  11,  12,  12,  12,  13,  13,  13,  13,  14,
+         14,  14,  14,  15,  15,  15,  15,  16,  16,  16,  16,  16,  16,  17,  17,  17,
+         17,  17,  17,  17,  18,  18,  18,  18,  18,  18,  18,  18,  19,  19,  19,  19,
+         19,  19,  19,  19,  20,  20,  20,  20,  20,  20,  20,  21,  21,  21,  21,  21,
+         22,  22,  22,  22,  22,  23,  23,  23,  23,  23,  23,  23,  23,  23,  23,  24,
+         24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,
+         24,  24,  24,  24,  24,  24,  24,  24,  25,  25,  25,  25,  25,  25,  25,  25,
+         25,  25,  25,  25,  25,  25,  25,  25,  25,  25,  26,  26,  26,  26,  26,  26,
+         26,  26,  26,  26,  26,  26,  26,  26,  26,  26,  26,  26,  26,  27,  27,  27,
+         27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,  27,
+         27,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,
+         28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,
+         28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,
+         28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28,  28
+    },
+#endif
+};
+
+#endif /* _DECA_RANGE_BIAS_H_ */
@@ -14,17 +14,28 @@
 
 #include "deca_device_api.h"
 #include "deca_param_types.h"
+#include "deca_range_tables.h"
+
+#ifdef DWT_FIXED_CHAN
+// Fixed radio configuration build: keep the direct index table of the fixed channel and PRF only (see deca_range_bias.h)
+#define RANGE_BIAS_ONLY (((DWT_FIXED_PRF == DWT_PRF_64M) ? 6 : 0) + \
+                         ((DWT_FIXED_CHAN == 4) ? 4 : (DWT_FIXED_CHAN == 7) ? 5 : (DWT_FIXED_CHAN == 5) ? 3 : (DWT_FIXED_CHAN - 1)))
+#endif
+#include "deca_range_bias.h"
 
 #define NUM_16M_OFFSET  (37)
 #define NUM_16M_OFFSETWB  (68)
 #define NUM_64M_OFFSET  (26)
 #define NUM_64M_OFFSETWB  (59)
 
+#ifndef DWT_FIXED_CHAN
 const uint8 chan_idxnb[NUM_CH_SUPPORTED] = {0, 0, 1, 2, 0, 3, 0, 0}; //only channels 1,2,3 and 5 are in the narrow band tables
 const uint8 chan_idxwb[NUM_CH_SUPPORTED] = {0, 0, 0, 0, 0, 0, 0, 1}; //only channels 4 and 7 are in in the wide band tables
+#endif
 
 //---------------------------------------------------------------------------------------------------------------------------
 // Range Bias Correction TABLES of range values in integer units of 25 CM, for 8-bit unsigned storage, MUST END IN 255 !!!!!!
+// They are the source of the direct index tables of deca_range_bias.h: run gen_range_bias.py after changing them.
 //---------------------------------------------------------------------------------------------------------------------------
 
 // offsets to nearest centimeter for index 0, all rest are +1 cm per value
@@ -619,6 +630,31 @@ const uint8 range25cm64PRFwb[2][NUM_64M_OFFSETWB] =
 }; // end range25cm64PRFwb
 
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: range_bias_tbl()
+ *
+ * Description: Return the direct index table (deca_range_bias.h) of a channel and PRF.
+ */
+static const int8 *range_bias_tbl(uint8 chan, uint8 prf)
+{
+#ifdef DWT_FIXED_CHAN
+    return range_bias_cm[0];
+#else
+    int tbl = (prf == DWT_PRF_16M) ? 0 : RANGE_BIAS_TBL_64M;
+
+    if ((chan == 4) || (chan == 7))
+    {
+        tbl += RANGE_BIAS_TBL_WB + chan_idxwb[chan];
+    }
+    else
+    {
+        tbl += chan_idxnb[chan & (NUM_CH_SUPPORTED - 1)];
+    }
+
+    return range_bias_cm[tbl];
+#endif
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Function: dwt_getrangebias()
  *
@@ -635,64 +671,36 @@ const uint8 range25cm64PRFwb[2][NUM_64M_OFFSETWB] =
  */
 double dwt_getrangebias(uint8 chan, float range, uint8 prf)
 {
-    //first get the lookup index that corresponds to given range for a particular channel at 16M PRF
-    int i = 0 ;
-    int chanIdx ;
-    int cmoffseti ;                                 // integer number of CM offset
-
-    double mOffset ;                                // final offset result in metres
-
     // NB: note we may get some small negitive values e.g. up to -50 cm.
 
     int rangeint25cm = (int) (range * 4.00) ;       // convert range to integer number of 25cm values.
 
     if (rangeint25cm > 255) rangeint25cm = 255 ;    // make sure it matches largest value in table (all tables end in 255 !!!!)
+    if (rangeint25cm < 0) rangeint25cm = 0 ;        // below the first entry of every table
 
-    if (prf == DWT_PRF_16M)
-    {
-        switch(chan)
-        {
-            case 4:
-            case 7:
-            {
-                chanIdx = chan_idxwb[chan];
-                while (rangeint25cm > range25cm16PRFwb[chanIdx][i]) i++ ;       // find index in table corresponding to range
-                cmoffseti = i + CM_OFFSET_16M_WB ;                              // nearest centimeter correction
-            }
-            break;
-            default:
-            {
-                chanIdx = chan_idxnb[chan];
-                while (rangeint25cm > range25cm16PRFnb[chanIdx][i]) i++ ;       // find index in table corresponding to range
-                cmoffseti = i + CM_OFFSET_16M_NB ;                              // nearest centimeter correction
-            }
-        }//end of switch
-    }
-    else // 64M PRF
-    {
-        switch(chan)
-        {
-            case 4:
-            case 7:
-            {
-                chanIdx = chan_idxwb[chan];
-                while (rangeint25cm > range25cm64PRFwb[chanIdx][i]) i++ ;       // find index in table corresponding to range
-                cmoffseti = i + CM_OFFSET_64M_WB ;                              // nearest centimeter correction
-            }
-            break;
-            default:
-            {
-                chanIdx = chan_idxnb[chan];
-                while (rangeint25cm > range25cm64PRFnb[chanIdx][i]) i++ ;       // find index in table corresponding to range
-                cmoffseti = i + CM_OFFSET_64M_NB ;                              // nearest centimeter correction
-            }
-        }//end of switch
-    } // end else
-
-
-    mOffset = (float) cmoffseti ;                                       // offset result in centimmetres
-
-    mOffset *= 0.01 ;                                                   // convert to metres
-
-    return (mOffset) ;
+    return range_bias_tbl(chan, prf)[rangeint25cm] * 0.01 ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: dwt_getrangebias_cm()
+ *
+ * Description: As dwt_getrangebias(), in integer: one table load per range, no floating point.
+ *
+ * input parameters:
+ * @param chan     - specifies the operating channel (e.g. 1, 2, 3, 4, 5, 6 or 7)
+ * @param range_mm - the calculated distance before correction, in millimetres
+ * @param prf      - this is the PRF e.g. DWT_PRF_16M or DWT_PRF_64M
+ *
+ * output parameters
+ *
+ * returns correction needed in centimetres
+ */
+int8 dwt_getrangebias_cm(uint8 chan, int32 range_mm, uint8 prf)
+{
+    int32 rangeint25cm = range_mm / 250 ;
+
+    if (rangeint25cm > 255) rangeint25cm = 255 ;
+    if (rangeint25cm < 0) rangeint25cm = 0 ;
+
+    return range_bias_tbl(chan, prf)[rangeint25cm] ;
 }
@@ -0,0 +1,63 @@
+/*! ----------------------------------------------------------------------------
+ *  @file    deca_range_tables.h
+ *  @brief   DW1000 range correction tables
+ *
+ * @attention
+ *
+ * Copyright 2015 (c) DecaWave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_RANGE_TABLES_H_
+#define _DECA_RANGE_TABLES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getrangebias()
+ *
+ * @brief This function is used to return the range bias correction need for TWR with DW1000 units.
+ *
+ * input parameters
+ * @param chan  - specifies the operating channel (e.g. 1, 2, 3, 4, 5, 6 or 7)
+ * @param range - the calculated distance before correction, in metres
+ * @param prf   - this is the PRF e.g. DWT_PRF_16M or DWT_PRF_64M
+ *
+ * In a fixed radio configuration build (DWT_FIXED_CHAN) chan and prf are ignored, the table of the fixed ones is used.
+ *
+ * output parameters
+ *
+ * returns correction needed in meters
+ */
+double dwt_getrangebias(uint8 chan, float range, uint8 prf);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dwt_getrangebias_cm()
+ *
+ * @brief As dwt_getrangebias(), in integer: one table load per range, no floating point. The correction is to be
+ *        subtracted from the measured range.
+ *
+ * input parameters
+ * @param chan     - specifies the operating channel (e.g. 1, 2, 3, 4, 5, 6 or 7)
+ * @param range_mm - the calculated distance before correction, in millimetres
+ * @param prf      - this is the PRF e.g. DWT_PRF_16M or DWT_PRF_64M
+ *
+ * As dwt_getrangebias(), chan and prf are ignored in a fixed radio configuration build.
+ *
+ * output parameters
+ *
+ * returns correction needed in centimetres
+ */
+int8 dwt_getrangebias_cm(uint8 chan, int32 range_mm, uint8 prf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_RANGE_TABLES_H_ */
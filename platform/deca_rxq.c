@@ -0,0 +1,136 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_rxq.c
+ * @brief   RX pipeline: good frames are read straight into pool frames
+ *          (deca_frame.h) from the RX callback and handed to a consumer thread
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_rxq.h"
+
+//zephyr includes
+#include <zephyr.h>
+
+K_MSGQ_DEFINE(deca_rxq_msgq, sizeof(deca_frame_t *), DECA_RXQ_COUNT, 4);
+
+static uint8 rxq_flags;
+static deca_rxq_stats_t rxq_stats;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rxq_rxok_cb()
+ *
+ * @brief RX good frame callback, from dwt_isr()/dwt_fastisr(). The host side buffer still holds the frame: it is
+ *        only toggled once the callback returns. The bytes dwt_fastisr() already read are not read again.
+ */
+static void rxq_rxok_cb(const dwt_cb_data_t *cb_data)
+{
+    deca_frame_t *frame;
+    uint16 done = 0;
+
+    if (rxq_flags & DECA_RXQ_REARM)
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE | DWT_NO_SYNC_PTRS);
+    }
+
+    frame = deca_frame_alloc(cb_data->datalength, K_NO_WAIT);
+    if (frame == NULL)
+    {
+        rxq_stats.noFrame++;
+        return;
+    }
+
+    frame->status = cb_data->status;
+
+    if (cb_data->rx_flags & DWT_CB_DATA_RX_FLAG_FAST)
+    {
+        done = cb_data->prefixlength;
+        memcpy(frame->data, cb_data->prefix, done);
+        memcpy(frame->rxStamp, cb_data->rx_stamp, sizeof(frame->rxStamp));
+    }
+    else
+    {
+        dwt_readrxtimestamp(frame->rxStamp);
+    }
+
+    if (frame->len > done)
+    {
+        dwt_readrxdata(&frame->data[done], frame->len - done, done);
+    }
+
+    if (k_msgq_put(&deca_rxq_msgq, &frame, K_NO_WAIT) != 0)
+    {
+        deca_frame_unref(frame);
+        rxq_stats.queueFull++;
+        return;
+    }
+    rxq_stats.rxFrames++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rxq_rxerr_cb()
+ *
+ * @brief RX timeout and RX error callback, RX is re-enabled right away.
+ */
+static void rxq_rxerr_cb(const dwt_cb_data_t *cb_data)
+{
+    rxq_stats.rxErrors++;
+
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_start()
+ *
+ * @brief see deca_rxq.h
+ */
+void deca_rxq_start(dwt_cb_t cbTxDone, uint8 flags)
+{
+    rxq_flags = flags;
+    memset(&rxq_stats, 0, sizeof(rxq_stats));
+
+    dwt_setcallbacks(cbTxDone, &rxq_rxok_cb, &rxq_rxerr_cb, &rxq_rxerr_cb);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_get()
+ *
+ * @brief see deca_rxq.h
+ */
+deca_frame_t *deca_rxq_get(int32 timeout)
+{
+    deca_frame_t *frame;
+
+    if (k_msgq_get(&deca_rxq_msgq, &frame, timeout) != 0)
+    {
+        return NULL;
+    }
+
+    return frame;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_free()
+ *
+ * @brief see deca_rxq.h
+ */
+void deca_rxq_free(deca_frame_t *frame)
+{
+    deca_frame_unref(frame);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_getstats()
+ *
+ * @brief see deca_rxq.h
+ */
+void deca_rxq_getstats(deca_rxq_stats_t *stats)
+{
+    *stats = rxq_stats;
+}
@@ -0,0 +1,110 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_rxq.h
+ * @brief   RX pipeline: good frames are read straight into pool frames
+ *          (deca_frame.h) from the RX callback and handed to a consumer thread
+ *
+ *          The frame is read once, from the host side buffer, before
+ *          dwt_isr() toggles it in double buffering mode; only the
+ *          frame pointer goes through the queue. The consumer drops its
+ *          reference with deca_rxq_free() once done, or passes it on.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_RXQ_H_
+#define _DECA_RXQ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_device_api.h"
+#include "deca_frame.h"
+
+#ifdef CONFIG_DW1000_RXQ_COUNT
+#define DECA_RXQ_COUNT          CONFIG_DW1000_RXQ_COUNT
+#else
+#define DECA_RXQ_COUNT          (8)
+#endif
+
+// deca_rxq_start() flags
+#define DECA_RXQ_REARM          0x1             // re-enable RX from the callback, before the frame is read (double buffering)
+
+typedef struct
+{
+    uint32 rxFrames;                            // queued
+    uint32 noFrame;                             // dropped, no pool frame free or long enough
+    uint32 queueFull;                           // dropped, DECA_RXQ_COUNT frames already queued
+    uint32 rxErrors;                            // RX error and timeout events
+} deca_rxq_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_start()
+ *
+ * @brief Install the pipeline callbacks (RX good frame, RX timeout and RX error, the TX done callback is kept as
+ *        given) and reset the statistics. RX itself is enabled by the caller.
+ *
+ * input parameters
+ * @param cbTxDone - TX done callback or NULL
+ * @param flags    - DECA_RXQ_xxx
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_rxq_start(dwt_cb_t cbTxDone, uint8 flags);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_get()
+ *
+ * @brief Take the oldest received frame.
+ *
+ * input parameters
+ * @param timeout - in ms, K_FOREVER or K_NO_WAIT
+ *
+ * output parameters
+ *
+ * returns the frame (len includes the FCS, status and rxStamp are set), to be handed back with deca_rxq_free(), or
+ *         NULL on timeout
+ */
+deca_frame_t *deca_rxq_get(int32 timeout);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_free()
+ *
+ * @brief Drop the reference taken with deca_rxq_get(), the frame goes back to its pool unless deca_frame_ref() was
+ *        used to keep it.
+ *
+ * input parameters
+ * @param frame - frame
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_rxq_free(deca_frame_t *frame);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxq_getstats()
+ *
+ * @brief Read the pipeline counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since deca_rxq_start()
+ *
+ * no return value
+ */
+void deca_rxq_getstats(deca_rxq_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_RXQ_H_ */
@@ -0,0 +1,132 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_rxqual.c
+ * @brief   First path and RX power estimates from a minimal register read
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "deca_rxqual.h"
+#include "deca_regs.h"
+#include "deca_ts.h"
+
+// Constant A of the power estimates, dB Q8: 113.77 at 16 MHz PRF, 121.74 at 64 MHz
+#define RXQUAL_A_16M_Q8             29125
+#define RXQUAL_A_64M_Q8             31165
+
+// 10 log10(2), Q16
+#define RXQUAL_10LOG10_2_Q16        197283
+
+// Bytes of RX_TIME up to FP_AMPL1: timestamp, first path index, first path amplitude 1
+#define RXQUAL_RX_TIME_LEN          (RX_TIME_FP_AMPL1_OFFSET + 2)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_10log10_q8()
+ *
+ * @brief see deca_rxqual.h
+ */
+int32 deca_10log10_q8(uint64_t x)
+{
+    uint64_t m;
+    uint32 log2q16;
+    int msb, i;
+
+    if (x == 0)
+    {
+        return 0;
+    }
+
+    msb = 63 - __builtin_clzll(x);
+
+    /* Mantissa in [1, 2), Q31, then the fraction bit by bit: squaring doubles the logarithm */
+    m = (msb > 31) ? (x >> (msb - 31)) : (x << (31 - msb));
+    log2q16 = (uint32)msb << 16;
+    for (i = 15; i >= 0; i--)
+    {
+        m = (m * m) >> 31;
+        if (m >= (1ULL << 32))
+        {
+            m >>= 1;
+            log2q16 |= 1UL << i;
+        }
+    }
+
+    return (int32)(((uint64_t)log2q16 * RXQUAL_10LOG10_2_Q16) >> 24);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxqual_compute()
+ *
+ * @brief see deca_rxqual.h
+ */
+void deca_rxqual_compute(deca_rxqual_t *qual, uint8 prf)
+{
+    int32 a, n, fp, rx, diff;
+    uint64_t f;
+
+    if ((qual->cirPwr == 0) || (qual->rxPacc == 0))
+    {
+        qual->fpPowerQ8 = DECA_RXQUAL_NONE;
+        qual->rxPowerQ8 = DECA_RXQUAL_NONE;
+        qual->los = 0;
+        return;
+    }
+
+    a = (prf == DWT_PRF_16M) ? RXQUAL_A_16M_Q8 : RXQUAL_A_64M_Q8;
+    n = 2 * deca_10log10_q8(qual->rxPacc);
+
+    f = (uint64_t)qual->fpAmp1 * qual->fpAmp1 + (uint64_t)qual->fpAmp2 * qual->fpAmp2 +
+        (uint64_t)qual->fpAmp3 * qual->fpAmp3;
+    fp = (f != 0) ? (deca_10log10_q8(f) - n - a) : DECA_RXQUAL_NONE;
+    rx = deca_10log10_q8((uint64_t)qual->cirPwr << 17) - n - a;
+
+    qual->fpPowerQ8 = (int16)fp;
+    qual->rxPowerQ8 = (int16)rx;
+
+    diff = rx - fp;
+    if (diff <= DECA_RXQUAL_LOS_Q8)
+    {
+        qual->los = 100;
+    }
+    else if (diff >= DECA_RXQUAL_NLOS_Q8)
+    {
+        qual->los = 0;
+    }
+    else
+    {
+        qual->los = (uint8)((DECA_RXQUAL_NLOS_Q8 - diff) * 100 / (DECA_RXQUAL_NLOS_Q8 - DECA_RXQUAL_LOS_Q8));
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxqual_read()
+ *
+ * @brief see deca_rxqual.h
+ */
+void deca_rxqual_read(deca_rxqual_t *qual, uint8 prf)
+{
+    uint8 rx_time[RXQUAL_RX_TIME_LEN];
+    uint8 fqual[RX_FQUAL_LEN];
+    uint32 finfo;
+
+    dwt_readfromdevice(RX_TIME_ID, 0, sizeof(rx_time), rx_time);
+    dwt_readfromdevice(RX_FQUAL_ID, 0, sizeof(fqual), fqual);
+    finfo = dwt_read32bitreg(RX_FINFO_ID);
+
+    qual->rxTs = deca_ts_unpack(&rx_time[RX_TIME_RX_STAMP_OFFSET], RX_TIME_RX_STAMP_LEN);
+    qual->fpIndex = rx_time[RX_TIME_FP_INDEX_OFFSET] | (rx_time[RX_TIME_FP_INDEX_OFFSET + 1] << 8);
+    qual->fpAmp1 = rx_time[RX_TIME_FP_AMPL1_OFFSET] | (rx_time[RX_TIME_FP_AMPL1_OFFSET + 1] << 8);
+
+    /* RX_FQUAL: STD_NOISE, FP_AMPL2, FP_AMPL3, CIR_PWR */
+    qual->stdNoise = fqual[0] | (fqual[1] << 8);
+    qual->fpAmp2 = fqual[2] | (fqual[3] << 8);
+    qual->fpAmp3 = fqual[4] | (fqual[5] << 8);
+    qual->cirPwr = fqual[6] | (fqual[7] << 8);
+    qual->rxPacc = (uint16)((finfo & RX_FINFO_RXPACC_MASK) >> RX_FINFO_RXPACC_SHIFT);
+
+    deca_rxqual_compute(qual, prf);
+}
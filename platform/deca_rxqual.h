@@ -0,0 +1,115 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_rxqual.h
+ * @brief   First path and RX power estimates from a minimal register read
+ *
+ *          dwt_readdiagnostics() takes five SPI transactions, and the CIR
+ *          samples around the first path of example 2c hundreds of bytes.
+ *          The power estimates of the DW1000 User Manual (4.7.1, 4.7.2)
+ *          only need FP_AMPL1-3, CIR_PWR and RXPACC, read here in three
+ *          bursts, one per register file: RX_TIME (the RX timestamp comes
+ *          with FP_AMPL1, a deca_ts_readrx() saved), RX_FQUAL and RX_FINFO.
+ *          The estimates are computed in fixed point, dBm in Q8:
+ *          - first path power: 10 log10((F1^2 + F2^2 + F3^2) / N^2) - A
+ *          - RX power:         10 log10(C * 2^17 / N^2) - A
+ *          with A 113.77 at 16 MHz PRF and 121.74 at 64 MHz. The
+ *          RX power estimate reads low above about -85 dBm.
+ *
+ *          Their difference tells line of sight: under 6 dB the first path
+ *          carries most of the energy, over 10 dB it is attenuated and the
+ *          range is likely too long (non line of sight).
+ *
+ *          The registers hold the last frame received until the next one,
+ *          read before the receiver is enabled again. They need the LDE
+ *          microcode.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_RXQUAL_H_
+#define _DECA_RXQUAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Power of a frame whose registers are empty (no LDE microcode), dBm Q8
+#define DECA_RXQUAL_NONE            INT16_MIN
+
+// First path to RX power differences bounding line of sight and non line of sight, dB Q8
+#define DECA_RXQUAL_LOS_Q8          (6 * 256)
+#define DECA_RXQUAL_NLOS_Q8         (10 * 256)
+
+typedef struct
+{
+    uint64_t rxTs;                      // RX timestamp, as deca_ts_readrx()
+    uint16 fpIndex;                     // first path index, 10.6 fixed point
+    uint16 fpAmp1;                      // F1 to F3: first path amplitudes
+    uint16 fpAmp2;
+    uint16 fpAmp3;
+    uint16 stdNoise;                    // noise standard deviation
+    uint16 cirPwr;                      // C: channel impulse response power
+    uint16 rxPacc;                      // N: preamble symbols accumulated
+    int16 fpPowerQ8;                    // first path power, dBm Q8
+    int16 rxPowerQ8;                    // RX power, dBm Q8
+    uint8 los;                          // 100 up to DECA_RXQUAL_LOS_Q8 of difference, 0 from DECA_RXQUAL_NLOS_Q8 on
+} deca_rxqual_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxqual_read()
+ *
+ * @brief Read the quality registers of the last frame received and compute the power estimates.
+ *
+ * input parameters
+ * @param prf  - DWT_PRF_16M or DWT_PRF_64M, as configured
+ *
+ * output parameters
+ * @param qual - raw values and estimates, the powers DECA_RXQUAL_NONE and los 0 if CIR_PWR or RXPACC is 0
+ *
+ * no return value
+ */
+void deca_rxqual_read(deca_rxqual_t *qual, uint8 prf);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_rxqual_compute()
+ *
+ * @brief Compute the power estimates from the raw values, e.g. taken from a dwt_rxdiag_t.
+ *
+ * input parameters
+ * @param prf  - DWT_PRF_16M or DWT_PRF_64M
+ *
+ * output parameters
+ * @param qual - fpAmp1-3, cirPwr and rxPacc in, fpPowerQ8, rxPowerQ8 and los out
+ *
+ * no return value
+ */
+void deca_rxqual_compute(deca_rxqual_t *qual, uint8 prf);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_10log10_q8()
+ *
+ * @brief 10 log10(x) in fixed point, within 0.01 dB.
+ *
+ * input parameters
+ * @param x - value, above 0
+ *
+ * output parameters
+ *
+ * returns 10 log10(x) in dB Q8, 0 for x = 0
+ */
+int32 deca_10log10_q8(uint64_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_RXQUAL_H_ */
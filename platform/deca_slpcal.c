@@ -0,0 +1,218 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_slpcal.c
+ * @brief   Sleep counter calibration service with a temperature drift model
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "deca_slpcal.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* Step in ns from the calibration in 1/16 XTAL/2 cycles: 4096 * cal / 19.2 MHz */
+#define SLPCAL_Q4_TO_STEP_NS(q4)    ((uint32)(((uint64_t)(q4) * 40000) / 3))
+
+typedef struct
+{
+    uint8 temp;                         // raw
+    uint32 calQ4;                       // XTAL/2 cycles per oscillator period, 1/16 units
+} slpcal_point_t;
+
+typedef struct
+{
+    deca_slpcal_config_t cfg;
+    uint8 valid;                        // points[last] holds a calibration
+    uint8 count;
+    uint8 last;
+    uint32 calMs;                       // uptime of the last calibration
+    int32 slopeQ8;                      // calQ4 per raw LSB, 1/256 units
+    uint32 calQ4;                       // in use
+    slpcal_point_t points[DECA_SLPCAL_POINTS];
+    deca_slpcal_stats_t stats;
+} deca_slpcal_local_t;
+
+static deca_slpcal_local_t slpcal = {
+    .cfg = DECA_SLPCAL_CONFIG_DEFAULT,
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn slpcal_fit()
+ *
+ * @brief Least squares slope of the calibrations against temperature.
+ */
+static void slpcal_fit(void)
+{
+    int64_t st = 0, sc = 0, stt = 0, stc = 0, sxx, sxy;
+    int n = slpcal.count, i;
+
+    for (i = 0; i < n; i++)
+    {
+        st += slpcal.points[i].temp;
+        sc += slpcal.points[i].calQ4;
+        stt += (int64_t)slpcal.points[i].temp * slpcal.points[i].temp;
+        stc += (int64_t)slpcal.points[i].temp * slpcal.points[i].calQ4;
+    }
+    sxx = n * stt - st * st;
+    sxy = n * stc - st * sc;
+
+    slpcal.slopeQ8 = (sxx != 0) ? (int32)((sxy * 256) / sxx) : 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn slpcal_update()
+ *
+ * @brief Step and error estimate from the calibration in use.
+ */
+static void slpcal_update(void)
+{
+    int32 drift_ppm = (int32)(((int64_t)slpcal.slopeQ8 * 1000000) / (256 * (int64_t)slpcal.calQ4));
+
+    slpcal.stats.stepNs = SLPCAL_Q4_TO_STEP_NS(slpcal.calQ4);
+    slpcal.stats.driftPpm = drift_ppm;
+
+    /* One cycle over all runs, plus the model over one LSB of temperature */
+    slpcal.stats.errPpm = (uint16)MIN((16 * 1000000UL) / (slpcal.calQ4 * slpcal.cfg.runs) +
+                                      (uint32)((drift_ppm < 0) ? -drift_ppm : drift_ppm), 0xFFFF);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn slpcal_calibrate()
+ *
+ * @brief Average cfg.runs calibrations, with the DW1000 clocks on the crystal, and add them to the model. A previous
+ *        calibration at the same temperature is replaced, so the points keep their spread.
+ */
+static void slpcal_calibrate(uint8 temp)
+{
+    uint32 sum = 0;
+    uint16 cal;
+    int i;
+
+    port_set_dw1000_slowrate();
+    for (i = 0; i < slpcal.cfg.runs; i++)
+    {
+        cal = dwt_calibratesleepcnt();
+        sum += cal ? cal : 1;
+    }
+    port_set_dw1000_fastrate();
+
+    for (i = 0; i < slpcal.count; i++)
+    {
+        if (slpcal.points[i].temp == temp)
+        {
+            break;
+        }
+    }
+    if (i == slpcal.count)
+    {
+        if (slpcal.count < DECA_SLPCAL_POINTS)
+        {
+            slpcal.count++;
+        }
+        else
+        {
+            i = (slpcal.last + 1) % DECA_SLPCAL_POINTS;
+        }
+    }
+    slpcal.last = i;
+    slpcal.points[i].temp = temp;
+    slpcal.points[i].calQ4 = (sum * 16) / slpcal.cfg.runs;
+    slpcal.valid = 1;
+    slpcal_fit();
+
+    slpcal.calQ4 = slpcal.points[i].calQ4;
+    slpcal.calMs = k_uptime_get_32();
+    slpcal.stats.calTemp = temp;
+    slpcal.stats.calibrations++;
+    slpcal_update();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_configure()
+ *
+ * @brief see deca_slpcal.h
+ */
+int deca_slpcal_configure(const deca_slpcal_config_t *config)
+{
+    if ((config == NULL) || (config->runs == 0) || (config->runs > 16))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&slpcal, 0, sizeof(slpcal));
+    slpcal.cfg = *config;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_check()
+ *
+ * @brief see deca_slpcal.h
+ */
+int deca_slpcal_check(void)
+{
+    uint8 temp = (uint8)(dwt_readtempvbat(1) >> 8);
+    const slpcal_point_t *ref;
+    int dt;
+
+    slpcal.stats.checks++;
+    slpcal.stats.temp = temp;
+
+    dt = (int)temp - slpcal.stats.calTemp;
+    if (!slpcal.valid || (dt >= slpcal.cfg.tempDelta) || (-dt >= slpcal.cfg.tempDelta) ||
+        (slpcal.cfg.maxAgeS && ((k_uptime_get_32() - slpcal.calMs) >= slpcal.cfg.maxAgeS * 1000UL)))
+    {
+        slpcal_calibrate(temp);
+        return 1;
+    }
+
+    /* Drift model, from the last calibration */
+    ref = &slpcal.points[slpcal.last];
+    slpcal.calQ4 = (uint32)((int32)ref->calQ4 + (slpcal.slopeQ8 * ((int)temp - ref->temp)) / 256);
+    slpcal_update();
+
+    return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_sleepcnt()
+ *
+ * @brief see deca_slpcal.h
+ */
+uint16 deca_slpcal_sleepcnt(uint32 us, int round_up)
+{
+    uint64_t ns = (uint64_t)us * 1000;
+    uint32 step = slpcal.stats.stepNs ? slpcal.stats.stepNs : 1;
+    uint64_t cnt = round_up ? ((ns + step - 1) / step) : (ns / step);
+
+    return (uint16)MAX(MIN(cnt, 0xFFFF), 1);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_guardus()
+ *
+ * @brief see deca_slpcal.h
+ */
+uint32 deca_slpcal_guardus(uint32 us)
+{
+    return (uint32)(((uint64_t)us * slpcal.stats.errPpm) / 1000000) + 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_getstats()
+ *
+ * @brief see deca_slpcal.h
+ */
+void deca_slpcal_getstats(deca_slpcal_stats_t *stats)
+{
+    *stats = slpcal.stats;
+}
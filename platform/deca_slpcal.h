@@ -0,0 +1,145 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_slpcal.h
+ * @brief   Sleep counter calibration service with a temperature drift model
+ *
+ *          The sleep counter runs on the DW1000 low-power RC oscillator,
+ *          7 to 13 kHz depending on temperature and voltage.
+ *          dwt_calibratesleepcnt() measures one of its periods in XTAL/2
+ *          cycles, about 2000 of them: each calibration here averages
+ *          several to get below the one cycle resolution.
+ *
+ *          deca_slpcal_check() is called whenever the DW1000 is awake and
+ *          idle (deca_pm.h after each wake-up, mac_lpl.h before each
+ *          listen period). It reads the DW1000 temperature sensor and:
+ *          - calibrates again once the temperature moved by tempDelta
+ *            since the last calibration, or after maxAgeS;
+ *          - in between, corrects the step with the drift model: a least
+ *            squares line through the last calibrations, oscillator period
+ *            against temperature.
+ *
+ *          deca_slpcal_guardus() turns the residual error into a guard
+ *          time for a timed wake-up.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_SLPCAL_H_
+#define _DECA_SLPCAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Calibrations the drift model is fitted on
+#define DECA_SLPCAL_POINTS          8
+
+typedef struct
+{
+    uint8 tempDelta;                    // temperature change triggering a calibration, raw sensor LSB (about 1.14 C)
+    uint16 maxAgeS;                     // calibrate again after that anyway, 0 never
+    uint8 runs;                         // dwt_calibratesleepcnt() runs averaged per calibration, 1 to 16
+} deca_slpcal_config_t;
+
+#define DECA_SLPCAL_CONFIG_DEFAULT {    \
+    .tempDelta = 2,                     \
+    .maxAgeS = 600,                     \
+    .runs = 8,                          \
+}
+
+typedef struct
+{
+    uint32 stepNs;                      // sleep counter step in use (4096 oscillator periods)
+    uint8 temp;                         // last temperature read, raw
+    uint8 calTemp;                      // temperature of the last calibration, raw
+    int32 driftPpm;                     // model: period change per raw LSB, ppm, 0 until two temperatures are known
+    uint16 errPpm;                      // expected error of stepNs
+    uint32 calibrations;
+    uint32 checks;
+} deca_slpcal_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_configure()
+ *
+ * @brief Set the configuration and drop the calibrations and model, the next check calibrates. The defaults are
+ *        DECA_SLPCAL_CONFIG_DEFAULT.
+ *
+ * input parameters
+ * @param config - thresholds, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or runs out of range
+ */
+int deca_slpcal_configure(const deca_slpcal_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_check()
+ *
+ * @brief Read the temperature, calibrate if needed (always the first time) or update the step from the model. The
+ *        DW1000 must be awake and idle, the SPI at its fast rate; it goes at its slow rate during a calibration.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns 1 if a calibration was run, 0 otherwise
+ */
+int deca_slpcal_check(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_sleepcnt()
+ *
+ * @brief Sleep counter value for a sleep time, at the current step.
+ *
+ * input parameters
+ * @param us       - sleep time
+ * @param round_up - 0 for the longest sleep up to us, 1 for the shortest from us on
+ *
+ * output parameters
+ *
+ * returns the dwt_configuresleepcnt() value, 1 to 0xFFFF
+ */
+uint16 deca_slpcal_sleepcnt(uint32 us, int round_up);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_guardus()
+ *
+ * @brief Guard time for a wake-up timed by the sleep counter: error of the step over the sleep time, the
+ *        temperature staying within tempDelta.
+ *
+ * input parameters
+ * @param us - sleep time
+ *
+ * output parameters
+ *
+ * returns the guard time in us
+ */
+uint32 deca_slpcal_guardus(uint32 us);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_slpcal_getstats()
+ *
+ * @brief Read the step, model and counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - state and counters
+ *
+ * no return value
+ */
+void deca_slpcal_getstats(deca_slpcal_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_SLPCAL_H_ */
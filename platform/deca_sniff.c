@@ -0,0 +1,252 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_sniff.c
+ * @brief   Receiver power profile: SNIFF mode with an on/off ratio following
+ *          the channel load
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_sniff.h"
+#include "deca_regs.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* SYS_STATE fields, see DW1000 User Manual register 0x19 */
+#define SYS_STATE_RX_STATE_SHIFT    8
+#define SYS_STATE_RX_STATE_MASK     0x1F
+#define SYS_STATE_RX_PRMBL_FOUND    0x05    // RX states from here on: a frame is being received
+#define SYS_STATE_PMSC_STATE_SHIFT  16
+#define SYS_STATE_PMSC_STATE_MASK   0x0F
+#define SYS_STATE_PMSC_IDLE         0x01
+#define SYS_STATE_PMSC_RX           0x05
+
+/* Event counters are 12 bits */
+#define EVC_DELTA(now, prev)        ((uint16)((now) - (prev)) & 0x0FFF)
+
+typedef struct
+{
+    deca_sniff_config_t cfg;
+    volatile uint8 running;
+    uint8 pending;                      // setting decided, not applied yet
+    dwt_deviceentcnts_t evc;            // event counters at the start of the window
+    atomic_t missed;                    // reported in the current window
+    deca_sniff_stats_t stats;
+    struct k_delayed_work work;
+} deca_sniff_local_t;
+
+static deca_sniff_local_t snf;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_offmax()
+ *
+ * @brief Longest OFF time for which an ON phase still falls within the preamble: preamble >= ON + OFF + ON.
+ */
+static uint8 sniff_offmax(const dwt_config_t *phy, uint8 on_time)
+{
+    uint32 pac, on_us, pre_us, off_us;
+
+    pac = 8 << phy->rxPAC;
+    pre_us = dwt_getpreambleus(phy);
+    on_us = (on_time + 1) * pac * dwt_getsymbolns(phy->prf) / 1000;
+
+    off_us = (pre_us > 2 * on_us) ? (pre_us - 2 * on_us) : 0;
+
+    /* In 128/125 us units */
+    return (uint8)MIN(off_us * 125 / 128, 0xFF);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_apply()
+ *
+ * @brief Apply the current setting: straight away with the transceiver off, restarting the receiver when it is
+ *        hunting for a preamble, later otherwise (TX, or a frame being received).
+ *
+ * returns 1 if applied
+ */
+static int sniff_apply(void)
+{
+    uint32 state = dwt_read32bitreg(SYS_STATE_ID);
+    uint8 pmsc = (state >> SYS_STATE_PMSC_STATE_SHIFT) & SYS_STATE_PMSC_STATE_MASK;
+    uint8 rx = (state >> SYS_STATE_RX_STATE_SHIFT) & SYS_STATE_RX_STATE_MASK;
+    int restart;
+
+    if (pmsc == SYS_STATE_PMSC_IDLE)
+    {
+        restart = 0;
+    }
+    else if ((pmsc == SYS_STATE_PMSC_RX) && (rx < SYS_STATE_RX_PRMBL_FOUND) &&
+             !(dwt_read32bitreg(SYS_STATUS_ID) & (SYS_STATUS_RXDFR | SYS_STATUS_ALL_RX_ERR)))
+    {
+        restart = 1;
+        dwt_forcetrxoff();
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (snf.stats.full)
+    {
+        dwt_setsniffmode(0, 0, 0);
+    }
+    else
+    {
+        dwt_setsniffmode(1, snf.cfg.onTime, snf.stats.offTime);
+    }
+    if (restart)
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    }
+    snf.stats.changes++;
+
+    return 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sniff_work_handler()
+ *
+ * @brief End of a window, on the DW1000 IRQ work queue: read the event counters and adapt the OFF time.
+ */
+static void sniff_work_handler(struct k_work *item)
+{
+    dwt_deviceentcnts_t evc;
+    uint32 frames, late, missed, off;
+    uint8 full = snf.stats.full;
+
+    if (!snf.running)
+    {
+        return;
+    }
+
+    dwt_readeventcounters(&evc);
+    late = EVC_DELTA(evc.RSL, snf.evc.RSL) + EVC_DELTA(evc.SFDTO, snf.evc.SFDTO);
+    frames = EVC_DELTA(evc.CRCG, snf.evc.CRCG) + EVC_DELTA(evc.CRCB, snf.evc.CRCB) +
+             EVC_DELTA(evc.PHE, snf.evc.PHE) + EVC_DELTA(evc.ARFE, snf.evc.ARFE) + late;
+    missed = (uint32)atomic_set(&snf.missed, 0);
+    snf.evc = evc;
+
+    snf.stats.windows++;
+    snf.stats.frames += frames;
+    snf.stats.late += late;
+    snf.stats.missed += missed;
+
+    off = snf.stats.offTime;
+    if (full)
+    {
+        if (frames < snf.cfg.busyFrames / 2)
+        {
+            full = 0;
+        }
+    }
+    else if (frames >= snf.cfg.busyFrames)
+    {
+        full = 1;
+    }
+    else if ((late + missed) * 100 > (uint32)snf.cfg.lossPct * (frames + missed))
+    {
+        off = MAX(off / 2, snf.cfg.offMin);
+    }
+    else if (frames == 0)
+    {
+        off = MIN(off + off / 2 + 1, snf.stats.offMax);
+    }
+
+    if ((full != snf.stats.full) || (off != snf.stats.offTime))
+    {
+        snf.stats.full = full;
+        snf.stats.offTime = (uint8)off;
+        snf.pending = 1;
+    }
+    if (snf.pending && sniff_apply())
+    {
+        snf.pending = 0;
+    }
+
+    port_submit_deca_work(&snf.work, snf.cfg.windowMs);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_start()
+ *
+ * @brief see deca_sniff.h
+ */
+int deca_sniff_start(const deca_sniff_config_t *config, const dwt_config_t *phy)
+{
+    if ((config == NULL) || (phy == NULL) || (config->onTime == 0) || (config->onTime > 15) ||
+        (config->windowMs == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    deca_sniff_stop();
+
+    memset(&snf, 0, sizeof(snf));
+    snf.cfg = *config;
+    snf.stats.offMax = snf.cfg.offMax ? snf.cfg.offMax : sniff_offmax(phy, snf.cfg.onTime);
+    if (snf.cfg.offMin > snf.stats.offMax)
+    {
+        return DWT_ERROR;
+    }
+    snf.stats.offTime = snf.cfg.offMin;
+
+    /* Enable only: dwt_configeventcounters() would reset them under deca_evc, the windows take deltas anyway */
+    dwt_write8bitoffsetreg(DIG_DIAG_ID, EVC_CTRL_OFFSET, (uint8)EVC_EN);
+    dwt_readeventcounters(&snf.evc);
+    dwt_setsniffmode(1, snf.cfg.onTime, snf.stats.offTime);
+
+    k_delayed_work_init(&snf.work, sniff_work_handler);
+    snf.running = 1;
+    port_submit_deca_work(&snf.work, snf.cfg.windowMs);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_missed()
+ *
+ * @brief see deca_sniff.h
+ */
+void deca_sniff_missed(uint16 count)
+{
+    atomic_add(&snf.missed, count);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_stop()
+ *
+ * @brief see deca_sniff.h
+ */
+void deca_sniff_stop(void)
+{
+    decaIrqStatus_t stat;
+
+    if (!snf.running)
+    {
+        return;
+    }
+
+    snf.running = 0;
+    k_delayed_work_cancel(&snf.work);
+
+    stat = decamutexon();
+    dwt_setsniffmode(0, 0, 0);
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_getstats()
+ *
+ * @brief see deca_sniff.h
+ */
+void deca_sniff_getstats(deca_sniff_stats_t *stats)
+{
+    *stats = snf.stats;
+}
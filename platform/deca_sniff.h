@@ -0,0 +1,134 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_sniff.h
+ * @brief   Receiver power profile: SNIFF mode with an on/off ratio following
+ *          the channel load
+ *
+ *          Once per window the profile reads the DW1000 event counters.
+ *          Every frame start the receiver caught shows up in them: good
+ *          frames, CRC, PHY header and address filter errors. Frames
+ *          caught too late to be decoded show up too: sync losses and SFD
+ *          timeouts.
+ *          - idle channel: the OFF time grows, up to what still overlaps
+ *            the preamble with an ON phase;
+ *          - frames caught late, or missed as the application reports with
+ *            deca_sniff_missed(): the OFF time is halved;
+ *          - busy channel: SNIFF mode is turned off (full listen) until
+ *            the load drops under half the threshold.
+ *
+ *          The profile is for receivers left in RX between frames (dwt_isr
+ *          re-enabling it, or the polled loop of example 2d). The receiver
+ *          is restarted to apply a new setting, never while a frame is
+ *          being received or waits in the status register.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_SNIFF_H_
+#define _DECA_SNIFF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+typedef struct
+{
+    uint8 onTime;                       // dwt_setsniffmode() ON time, in PACs (the IC adds one), 1 to 15
+    uint8 offMin;                       // OFF time range, in 128/125 us units
+    uint8 offMax;                       // 0: longest OFF time still overlapping the preamble with an ON phase
+    uint16 windowMs;                    // time between two evaluations
+    uint16 busyFrames;                  // frame starts per window above which the receiver listens all the time
+    uint8 lossPct;                      // late or missed frames above which the OFF time is halved, percent
+} deca_sniff_config_t;
+
+#define DECA_SNIFF_CONFIG_DEFAULT {     \
+    .onTime = 1,                        \
+    .offMin = 4,                        \
+    .offMax = 0,                        \
+    .windowMs = 1000,                   \
+    .busyFrames = 20,                   \
+    .lossPct = 10,                      \
+}
+
+typedef struct
+{
+    uint8 full;                         // SNIFF mode off, the receiver listens all the time
+    uint8 offTime;                      // OFF time in use, or to resume with
+    uint8 offMax;                       // OFF time upper bound in use
+    uint32 windows;                     // evaluations
+    uint32 frames;                      // frame starts caught
+    uint32 late;                        // frames caught too late: sync losses, SFD timeouts
+    uint32 missed;                      // frames reported missed by the application
+    uint32 changes;                     // settings applied
+} deca_sniff_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_start()
+ *
+ * @brief Enable the event counters without resetting them (deca_evc may read them too), enable SNIFF mode at the
+ *        shortest OFF time and start evaluating the load. Call before enabling RX.
+ *
+ * input parameters
+ * @param config - ON/OFF times and thresholds, copied
+ * @param phy    - PHY the DW1000 was configured with, for the preamble length and PAC size
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if a parameter is NULL or the ON time or OFF range is invalid
+ */
+int deca_sniff_start(const deca_sniff_config_t *config, const dwt_config_t *phy);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_missed()
+ *
+ * @brief Report frames the application knows it missed, from sequence number gaps for instance. Counted in the
+ *        current window.
+ *
+ * input parameters
+ * @param count - frames missed
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sniff_missed(uint16 count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_stop()
+ *
+ * @brief Stop evaluating and turn SNIFF mode off, the receiver state is left as it is.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sniff_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sniff_getstats()
+ *
+ * @brief Read the profile state and counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - state and counters since deca_sniff_start()
+ *
+ * no return value
+ */
+void deca_sniff_getstats(deca_sniff_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_SNIFF_H_ */
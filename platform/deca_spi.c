@@ -15,25 +15,146 @@
 #include "deca_spi.h"
 #include "deca_device_api.h"
 #include "port.h"
+#include "deca_trace.h"
 
 //zephyr includes
 #include <errno.h>
+#include <string.h>
 #include <zephyr.h>
 #include <misc/printk.h>
 #include <device.h>
 #include <spi.h>
 
-struct device *spi;
-struct spi_config *spi_cfg;
-struct spi_config spi_cfgs[4]={0};
+#ifdef CONFIG_DW1000_SPI_PROF
+#include <soc.h>
+#include "deca_regs.h"
+#endif
 
-uint8_t tx_buf[255];
-uint8_t rx_buf[255];
+/* SPI bus of the DW1000, from the devicetree when the driver is bound to it */
+#ifdef DT_DECAWAVE_DW1000_0_BUS_NAME
+#define DECA_SPI_BUS_NAME   DT_DECAWAVE_DW1000_0_BUS_NAME
+#else
+#define DECA_SPI_BUS_NAME   DT_SPI_1_NAME
+#endif
 
-struct spi_buf bufs[2];
+/* The devicetree spi-max-frequency, if any, bounds the MAX profile */
+#ifdef DT_DECAWAVE_DW1000_0_SPI_MAX_FREQUENCY
+#define DECA_SPI_TOP_FREQ   MIN(DECA_SPI_MAX_FREQ, DT_DECAWAVE_DW1000_0_SPI_MAX_FREQUENCY)
+#else
+#define DECA_SPI_TOP_FREQ   DECA_SPI_MAX_FREQ
+#endif
 
-struct spi_buf_set tx; 
-struct spi_buf_set rx;
+#if DWT_NUM_DW_DEV > 2
+#error "deca_spi.c describes at most two DW1000 devices"
+#endif
+
+#if DWT_NUM_DW_DEV > 1
+#ifndef DW1000_1_CSn
+#error "DW1000_1_CSn (CS pin of the second DW1000) must be defined for DWT_NUM_DW_DEV > 1"
+#endif
+/* The on-module DW1000 uses the SPIM hardware CS, further devices sharing
+ * the bus are selected through a GPIO by the SPI driver */
+static struct spi_cs_control spi_cs[DWT_NUM_DW_DEV] = {
+	[1] = { .gpio_pin = DW1000_1_CSn, .delay = 0 },
+};
+#define DECA_SPI_CS(dev)    ((dev) ? &spi_cs[dev] : NULL)
+#else
+#define DECA_SPI_CS(dev)    NULL
+#endif
+
+/* SPI speed profiles, switching is a pointer swap: the driver notices the new
+ * config on the next transfer and only then reprograms the SPIM frequency */
+#define DECA_SPI_PROFILES(dev) {                    \
+	[DECA_SPI_SPEED_SLOW] = {                       \
+		.frequency = DECA_SPI_SLOW_FREQ,            \
+		.operation = SPI_WORD_SET(8),               \
+		.slave = (dev),                             \
+		.cs = DECA_SPI_CS(dev),                     \
+	},                                              \
+	[DECA_SPI_SPEED_FAST] = {                       \
+		.frequency = DECA_SPI_FAST_FREQ,            \
+		.operation = SPI_WORD_SET(8),               \
+		.slave = (dev),                             \
+		.cs = DECA_SPI_CS(dev),                     \
+	},                                              \
+	[DECA_SPI_SPEED_MAX] = {                        \
+		.frequency = DECA_SPI_TOP_FREQ,             \
+		.operation = SPI_WORD_SET(8),               \
+		.slave = (dev),                             \
+		.cs = DECA_SPI_CS(dev),                     \
+	},                                              \
+}
+
+static const struct spi_config spi_cfgs[DWT_NUM_DW_DEV][DECA_SPI_SPEED_NUM] = {
+	DECA_SPI_PROFILES(0),
+#if DWT_NUM_DW_DEV > 1
+	DECA_SPI_PROFILES(1),
+#endif
+};
+
+/* Per device SPI context.
+ * Scatter-gather descriptors: the header and the caller's buffers are handed
+ * to the SPI driver as they are, so no payload is ever copied.
+ * Entry 0 carries the header (the rx side discards the bytes clocked back
+ * during it), the following entries carry the body split into pieces the
+ * SPIM EasyDMA can move in one go. The whole list goes out in a single
+ * spi_transceive so CS stays asserted for the complete DW1000 transaction.
+ * Each device has its own lists so that two radios can be accessed from
+ * different threads, the SPI driver serialises the transfers on the bus. */
+typedef struct
+{
+    struct device *spi;
+    const struct spi_config *spi_cfg;   // active speed profile
+    struct spi_buf tx_bufs[1 + DECA_SPI_MAX_CHUNKS];
+    struct spi_buf rx_bufs[1 + DECA_SPI_MAX_CHUNKS];
+    struct spi_buf_set tx;
+    struct spi_buf_set rx;
+} deca_spi_ctx_t;
+
+static deca_spi_ctx_t spi_ctx[DWT_NUM_DW_DEV];
+
+/* Context of the device the calling thread is bound to */
+#if DWT_NUM_DW_DEV > 1
+#define DECA_SPI_DEV()      deca_getdevice()
+#else
+#define DECA_SPI_DEV()      0
+#endif
+#define DECA_SPI_CTX()      (&spi_ctx[DECA_SPI_DEV()])
+
+#ifdef CONFIG_DW1000_SPI_BACKEND
+/* Installed by deca_spi_set_backend(), NULL for the SPI bus */
+static const deca_spi_backend_t *spi_backend;
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_chunk_bufs()
+ *
+ * Splits a body buffer into DECA_SPI_CHUNK_LEN sized descriptors, starting at bufs[0]
+ * returns the number of descriptors used, or -1 if the body does not fit
+ */
+static int spi_chunk_bufs(struct spi_buf *bufs, uint8 *data, uint32 length)
+{
+    int cnt = 0;
+
+    if (length > DECA_SPI_MAX_CHUNKS * DECA_SPI_CHUNK_LEN)
+    {
+        return -1;
+    }
+
+    while (length > 0)
+    {
+        uint32 len = (length > DECA_SPI_CHUNK_LEN) ? DECA_SPI_CHUNK_LEN : length;
+
+        bufs[cnt].buf = data;
+        bufs[cnt].len = len;
+        cnt++;
+
+        data += len;
+        length -= len;
+    }
+
+    return cnt;
+}
 
 /****************************************************************************//**
  *
@@ -48,45 +169,64 @@ struct spi_buf_set rx;
  */
 int openspi()
 {
-    spi_cfg = &spi_cfgs[0];
+    unsigned int dev = DECA_SPI_DEV();
+    deca_spi_ctx_t *ctx = &spi_ctx[dev];
+
+    ctx->spi_cfg = &spi_cfgs[dev][DECA_SPI_SPEED_SLOW];
+    ctx->tx.buffers = ctx->tx_bufs;
+    ctx->rx.buffers = ctx->rx_bufs;
 
-	spi = device_get_binding(DT_SPI_1_NAME);
-	if (!spi) {
+	ctx->spi = device_get_binding(DECA_SPI_BUS_NAME);
+	if (!ctx->spi) {
 		printk("Could not find SPI driver\n");
 		return -1;
 	}
-	spi_cfg->operation = SPI_WORD_SET(8);
-	spi_cfg->frequency = 2000000;
-
-	memset(&tx_buf[0], 0, 255);
-	memset(&rx_buf[0], 0, 255);
-	bufs[0].buf = &tx_buf[0];
-	bufs[1].buf = &rx_buf[0];	
-	tx.buffers = &bufs[0];
-	rx.buffers = &bufs[1];
-	tx.count = 1;
-	rx.count = 1;
+
+#if DWT_NUM_DW_DEV > 1
+	if (dev) {
+		spi_cs[dev].gpio_dev = device_get_binding(DT_GPIO_P0_DEV_NAME);
+		if (!spi_cs[dev].gpio_dev) {
+			printk("Could not find GPIO driver for SPI CS\n");
+			return -1;
+		}
+	}
+#endif
+
+#ifdef CONFIG_DW1000_SPI_PROF
+    deca_spi_prof_reset();
+#endif
+
     return 0;
 } // end openspi()
 
-void set_spi_speed_slow()
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: set_spi_speed()
+ *
+ * Selects the SPI speed profile used by the following transfers
+ */
+void set_spi_speed(deca_spi_speed_t speed)
 {
-	spi_cfg = &spi_cfgs[0];
-	spi_cfg->operation = SPI_WORD_SET(8);
-	spi_cfg->frequency = 2000000;
+    unsigned int dev = DECA_SPI_DEV();
 
-	memset(&tx_buf[0], 0, 255);
-	memset(&rx_buf[0], 0, 255);
+    if (speed < DECA_SPI_SPEED_NUM)
+    {
+        spi_ctx[dev].spi_cfg = &spi_cfgs[dev][speed];
+    }
+}
+
+void set_spi_speed_slow()
+{
+	set_spi_speed(DECA_SPI_SPEED_SLOW);
 }
 
 void set_spi_speed_fast()
 {
-	spi_cfg = &spi_cfgs[1];
-	spi_cfg->operation = SPI_WORD_SET(8);
-	spi_cfg->frequency = 8000000;
+	set_spi_speed(DECA_SPI_SPEED_FAST);
+}
 
-	memset(&tx_buf[0], 0, 255);
-	memset(&rx_buf[0], 0, 255);
+void set_spi_speed_max()
+{
+	set_spi_speed(DECA_SPI_SPEED_MAX);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -101,28 +241,117 @@ int closespi(void)
     return 0;
 } // end closespi()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_set_backend()
+ *
+ * Routes the following transactions to a backend, NULL for the SPI bus
+ */
+#ifdef CONFIG_DW1000_SPI_BACKEND
+void deca_spi_set_backend(const deca_spi_backend_t *backend)
+{
+    spi_backend = backend;
+}
+#endif
+
+#ifdef CONFIG_DW1000_SPI_PROF
+/* Counters per register file. Updated with interrupts locked: the DW1000 mutex
+ * keeps the IRQ handler out, not the other threads */
+static deca_spi_prof_t spi_prof[DECA_SPI_PROF_REGS];
+
+static const char *const spi_prof_names[DECA_SPI_PROF_REGS] = {
+    [DEV_ID_ID] = "DEV_ID",         [EUI_64_ID] = "EUI_64",         [PANADR_ID] = "PANADR",
+    [SYS_CFG_ID] = "SYS_CFG",       [SYS_TIME_ID] = "SYS_TIME",     [TX_FCTRL_ID] = "TX_FCTRL",
+    [TX_BUFFER_ID] = "TX_BUFFER",   [DX_TIME_ID] = "DX_TIME",       [RX_FWTO_ID] = "RX_FWTO",
+    [SYS_CTRL_ID] = "SYS_CTRL",     [SYS_MASK_ID] = "SYS_MASK",     [SYS_STATUS_ID] = "SYS_STATUS",
+    [RX_FINFO_ID] = "RX_FINFO",     [RX_BUFFER_ID] = "RX_BUFFER",   [RX_FQUAL_ID] = "RX_FQUAL",
+    [RX_TTCKI_ID] = "RX_TTCKI",     [RX_TTCKO_ID] = "RX_TTCKO",     [RX_TIME_ID] = "RX_TIME",
+    [TX_TIME_ID] = "TX_TIME",       [TX_ANTD_ID] = "TX_ANTD",       [SYS_STATE_ID] = "SYS_STATE",
+    [ACK_RESP_T_ID] = "ACK_RESP_T", [RX_SNIFF_ID] = "RX_SNIFF",     [TX_POWER_ID] = "TX_POWER",
+    [CHAN_CTRL_ID] = "CHAN_CTRL",   [USR_SFD_ID] = "USR_SFD",       [AGC_CTRL_ID] = "AGC_CTRL",
+    [EXT_SYNC_ID] = "EXT_SYNC",     [ACC_MEM_ID] = "ACC_MEM",       [GPIO_CTRL_ID] = "GPIO_CTRL",
+    [DRX_CONF_ID] = "DRX_CONF",     [RF_CONF_ID] = "RF_CONF",       [TX_CAL_ID] = "TX_CAL",
+    [FS_CTRL_ID] = "FS_CTRL",       [AON_ID] = "AON",               [OTP_IF_ID] = "OTP_IF",
+    [LDE_IF_ID] = "LDE_IF",         [DIG_DIAG_ID] = "DIG_DIAG",     [PMSC_ID] = "PMSC",
+};
+
+static inline uint32 spi_prof_now(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* Header byte: write flag (bit 7), sub-index flag (bit 6), register file ID */
+static void spi_prof_count(const uint8 *header, uint32 len, int write, uint32 start)
+{
+    deca_spi_prof_t *p = &spi_prof[header[0] & (DECA_SPI_PROF_REGS - 1)];
+    uint32 cyc = DWT->CYCCNT - start;
+    unsigned int key = irq_lock();
+
+    if (write)
+    {
+        p->writes++;
+    }
+    else
+    {
+        p->reads++;
+    }
+    p->bytes += len;
+    p->cycles += cyc;
+
+    irq_unlock(key);
+}
+#else
+static inline uint32 spi_prof_now(void)
+{
+    return 0;
+}
+
+static inline void spi_prof_count(const uint8 *header, uint32 len, int write, uint32 start)
+{
+}
+#endif /* CONFIG_DW1000_SPI_PROF */
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Function: writetospi()
  *
  * Low level abstract function to write to the SPI
  * Takes two separate byte buffers for write header and write data
- * returns 0 for success
+ * returns 0 for success, or -1 if the write is longer than the SPI layer can describe
  */
 int writetospi(uint16 headerLength,
                const    uint8 *headerBuffer,
                uint32 bodyLength,
                const    uint8 *bodyBuffer)
 {
+    deca_spi_ctx_t *ctx = DECA_SPI_CTX();
     decaIrqStatus_t  stat ;
-    stat = decamutexon() ;
+    uint32 start;
+    int cnt;
 
-	memcpy(&tx_buf[0], headerBuffer, headerLength);
-	memcpy(&tx_buf[headerLength], bodyBuffer, bodyLength);
+    cnt = spi_chunk_bufs(&ctx->tx_bufs[1], (uint8 *)bodyBuffer, bodyLength);
+    if (cnt < 0)
+    {
+        return -1;
+    }
 
-    bufs[0].len = headerLength+bodyLength;
-    bufs[1].len = headerLength+bodyLength;
+    stat = decamutexon() ;
+    DECA_TRACE_BEGIN(DECA_TRACE_SPI_WR);
 
-    spi_transceive(spi, spi_cfg, &tx, &rx);
+    ctx->tx_bufs[0].buf = (uint8 *)headerBuffer;
+    ctx->tx_bufs[0].len = headerLength;
+    ctx->tx.count = 1 + cnt;
+
+    /* Nothing to receive on a write: let the driver drop MISO */
+    start = spi_prof_now();
+#ifdef CONFIG_DW1000_SPI_BACKEND
+    if (spi_backend)
+    {
+        spi_backend->write(headerLength, headerBuffer, bodyLength, bodyBuffer);
+    }
+    else
+#endif
+    spi_transceive(ctx->spi, ctx->spi_cfg, &ctx->tx, NULL);
+    spi_prof_count(headerBuffer, headerLength + bodyLength, 1, start);
+    DECA_TRACE_END(DECA_TRACE_SPI_WR);
     decamutexoff(stat);
 
     return 0;
@@ -135,30 +364,352 @@ int writetospi(uint16 headerLength,
  * Low level abstract function to read from the SPI
  * Takes two separate byte buffers for write header and read data
  * returns the offset into read buffer where first byte of read data may be found,
- * or returns 0
+ * or returns 0, or -1 if the read is longer than the SPI layer can describe
  */
 int readfromspi(uint16 headerLength,
                 const uint8 *headerBuffer,
                 uint32 readlength,
                 uint8 *readBuffer)
 {
+    deca_spi_ctx_t *ctx = DECA_SPI_CTX();
     decaIrqStatus_t  stat ;
+    uint32 start;
+    int cnt;
+
+    cnt = spi_chunk_bufs(&ctx->rx_bufs[1], readBuffer, readlength);
+    if (cnt < 0)
+    {
+        return -1;
+    }
+
     stat = decamutexon() ;
+    DECA_TRACE_BEGIN(DECA_TRACE_SPI_RD);
 
-	memset(&tx_buf[0], 0, headerLength+readlength);
-	memcpy(&tx_buf[0], headerBuffer, headerLength);
+    /* Only the header is sent: the driver clocks out its over-read character
+     * for the rest of the frame, which the DW1000 ignores during a read */
+    ctx->tx_bufs[0].buf = (uint8 *)headerBuffer;
+    ctx->tx_bufs[0].len = headerLength;
+    ctx->tx.count = 1;
 
-    bufs[0].len = headerLength+readlength;
-    bufs[1].len = headerLength+readlength;
-    spi_transceive(spi, spi_cfg, &tx, &rx);
+    /* A NULL rx buffer makes the driver skip the bytes received while the
+     * header is clocked out, the body lands directly in the caller's buffer */
+    ctx->rx_bufs[0].buf = NULL;
+    ctx->rx_bufs[0].len = headerLength;
+    ctx->rx.count = 1 + cnt;
 
-	memcpy(readBuffer, rx_buf+headerLength, readlength);
+    start = spi_prof_now();
+#ifdef CONFIG_DW1000_SPI_BACKEND
+    if (spi_backend)
+    {
+        spi_backend->read(headerLength, headerBuffer, readlength, readBuffer);
+    }
+    else
+#endif
+    spi_transceive(ctx->spi, ctx->spi_cfg, &ctx->tx, &ctx->rx);
+    spi_prof_count(headerBuffer, headerLength + readlength, 0, start);
+    DECA_TRACE_END(DECA_TRACE_SPI_RD);
 
     decamutexoff(stat);
 
     return 0;
 } // end readfromspi()
 
+#ifdef CONFIG_SPI_ASYNC
+/* Asynchronous transfers get their own descriptors, a blocking access issued
+ * while one is in flight waits for the SPI bus inside the driver and must not
+ * rewrite the lists being consumed by the DMA */
+static struct spi_buf async_tx_bufs[1 + DECA_SPI_MAX_CHUNKS];
+static struct spi_buf async_rx_bufs[1 + DECA_SPI_MAX_CHUNKS];
+
+static struct spi_buf_set async_tx = { .buffers = async_tx_bufs, .count = 0 };
+static struct spi_buf_set async_rx = { .buffers = async_rx_bufs, .count = 0 };
+
+/* Header of the transfer in flight: the caller's one may be on its stack, and
+ * is only copied here once the slot is claimed, a refused call leaves it alone */
+static uint8 async_header[DECA_MAX_SPI_HEADER_LENGTH];
+
+static struct k_poll_signal async_sig = K_POLL_SIGNAL_INITIALIZER(async_sig);
+static dwt_spi_cb_t async_cb;
+static void *async_arg;
+static atomic_t async_busy;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_async_thread()
+ *
+ * Waits for the SPI driver to signal the end of an asynchronous transfer and calls
+ * the completion callback, so that callbacks run in thread context and may issue
+ * further (blocking or asynchronous) accesses
+ */
+static void spi_async_thread(void *p1, void *p2, void *p3)
+{
+    struct k_poll_event evt = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+                                                       K_POLL_MODE_NOTIFY_ONLY,
+                                                       &async_sig);
+    unsigned int signaled;
+    int result;
+    dwt_spi_cb_t cb;
+    void *arg;
+
+    while (1)
+    {
+        k_poll(&evt, 1, K_FOREVER);
+
+        k_poll_signal_check(&async_sig, &signaled, &result);
+        k_poll_signal_reset(&async_sig);
+        evt.state = K_POLL_STATE_NOT_READY;
+
+        cb = async_cb;
+        arg = async_arg;
+        atomic_set(&async_busy, 0);
+
+        if (cb)
+        {
+            cb((result == 0) ? DWT_SUCCESS : DWT_ERROR, arg);
+        }
+    }
+}
+
+K_THREAD_DEFINE(deca_spi_async_tid, DECA_SPI_ASYNC_STACK_SIZE, spi_async_thread,
+                NULL, NULL, NULL, K_PRIO_COOP(DECA_SPI_ASYNC_PRIO), 0, K_NO_WAIT);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_start_async()
+ *
+ * Claims the asynchronous slot and hands the descriptor lists to the SPI driver
+ * returns 0 if the transfer was started, or -1 if one is already in flight or the driver refused it
+ */
+static int spi_start_async(struct spi_buf_set *rx_set, dwt_spi_cb_t cb, void *arg)
+{
+    deca_spi_ctx_t *ctx = DECA_SPI_CTX();
+
+    async_cb = cb;
+    async_arg = arg;
+
+    if (spi_transceive_async(ctx->spi, ctx->spi_cfg, &async_tx, rx_set, &async_sig) != 0)
+    {
+        atomic_set(&async_busy, 0);
+        return -1;
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_DW1000_SPI_BACKEND
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_async_inplace()
+ *
+ * Completes an asynchronous transfer a backend has done in place: the callback is called before returning
+ */
+static int spi_async_inplace(int ret, dwt_spi_cb_t cb, void *arg)
+{
+    if ((ret == 0) && cb)
+    {
+        cb(DWT_SUCCESS, arg);
+    }
+    return ret;
+}
+#endif
+#endif /* CONFIG_SPI_ASYNC */
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: writetospi_async()
+ *
+ * Low level abstract function to start a write to the SPI, the callback is called once it completes
+ * Takes two separate byte buffers for write header and write data, the header is copied and the data must stay
+ * valid until then
+ * Without CONFIG_SPI_ASYNC the write is done in place and the callback is called before returning
+ * returns 0 if the transfer was started, or -1 for error
+ */
+int writetospi_async(uint16 headerLength,
+                     const    uint8 *headerBuffer,
+                     uint32 bodyLength,
+                     const    uint8 *bodyBuffer,
+                     dwt_spi_cb_t cb,
+                     void *arg)
+{
+#ifdef CONFIG_SPI_ASYNC
+    int cnt;
+
+#ifdef CONFIG_DW1000_SPI_BACKEND
+    if (spi_backend)
+    {
+        return spi_async_inplace(writetospi(headerLength, headerBuffer, bodyLength, bodyBuffer), cb, arg);
+    }
+#endif
+    if (!atomic_cas(&async_busy, 0, 1))
+    {
+        return -1;
+    }
+
+    cnt = spi_chunk_bufs(&async_tx_bufs[1], (uint8 *)bodyBuffer, bodyLength);
+    if ((cnt < 0) || (headerLength > DECA_MAX_SPI_HEADER_LENGTH))
+    {
+        atomic_set(&async_busy, 0);
+        return -1;
+    }
+
+    memcpy(async_header, headerBuffer, headerLength);
+    async_tx_bufs[0].buf = async_header;
+    async_tx_bufs[0].len = headerLength;
+    async_tx.count = 1 + cnt;
+
+    spi_prof_count(headerBuffer, headerLength + bodyLength, 1, spi_prof_now());
+    return spi_start_async(NULL, cb, arg);
+#else
+    int ret = writetospi(headerLength, headerBuffer, bodyLength, bodyBuffer);
+
+    if ((ret == 0) && cb)
+    {
+        cb(DWT_SUCCESS, arg);
+    }
+    return ret;
+#endif
+} // end writetospi_async()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: readfromspi_async()
+ *
+ * Low level abstract function to start a read from the SPI, the callback is called once the data is in readBuffer
+ * Takes two separate byte buffers for write header and read data, the header is copied and the read buffer must
+ * stay valid until then
+ * Without CONFIG_SPI_ASYNC the read is done in place and the callback is called before returning
+ * returns 0 if the transfer was started, or -1 for error
+ */
+int readfromspi_async(uint16 headerLength,
+                      const uint8 *headerBuffer,
+                      uint32 readlength,
+                      uint8 *readBuffer,
+                      dwt_spi_cb_t cb,
+                      void *arg)
+{
+#ifdef CONFIG_SPI_ASYNC
+    int cnt;
+
+#ifdef CONFIG_DW1000_SPI_BACKEND
+    if (spi_backend)
+    {
+        return spi_async_inplace(readfromspi(headerLength, headerBuffer, readlength, readBuffer), cb, arg);
+    }
+#endif
+    if (!atomic_cas(&async_busy, 0, 1))
+    {
+        return -1;
+    }
+
+    cnt = spi_chunk_bufs(&async_rx_bufs[1], readBuffer, readlength);
+    if ((cnt < 0) || (headerLength > DECA_MAX_SPI_HEADER_LENGTH))
+    {
+        atomic_set(&async_busy, 0);
+        return -1;
+    }
+
+    memcpy(async_header, headerBuffer, headerLength);
+    async_tx_bufs[0].buf = async_header;
+    async_tx_bufs[0].len = headerLength;
+    async_tx.count = 1;
+
+    async_rx_bufs[0].buf = NULL;
+    async_rx_bufs[0].len = headerLength;
+    async_rx.count = 1 + cnt;
+
+    spi_prof_count(headerBuffer, headerLength + readlength, 0, spi_prof_now());
+    return spi_start_async(&async_rx, cb, arg);
+#else
+    int ret = readfromspi(headerLength, headerBuffer, readlength, readBuffer);
+
+    if ((ret == 0) && cb)
+    {
+        cb(DWT_SUCCESS, arg);
+    }
+    return ret;
+#endif
+} // end readfromspi_async()
+
+#ifdef CONFIG_DW1000_SPI_PROF
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_reset()
+ *
+ * Clears the per register file counters and starts the cycle counter timing the transfers
+ */
+void deca_spi_prof_reset(void)
+{
+    unsigned int key;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    key = irq_lock();
+    memset(spi_prof, 0, sizeof(spi_prof));
+    irq_unlock(key);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_get()
+ *
+ * Reads the counters of a register file, e.g. SYS_STATUS_ID
+ */
+void deca_spi_prof_get(uint8 reg, deca_spi_prof_t *prof)
+{
+    unsigned int key = irq_lock();
+
+    *prof = spi_prof[reg & (DECA_SPI_PROF_REGS - 1)];
+    irq_unlock(key);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_report()
+ *
+ * Prints the topN register files by bus time, with their transactions, bytes and share of the total
+ */
+void deca_spi_prof_report(uint8 topN)
+{
+    deca_spi_prof_t prof[DECA_SPI_PROF_REGS];
+    uint32 cyc_per_us = SystemCoreClock / 1000000;
+    uint64_t total = 0;
+    uint32 trans = 0;
+    unsigned int key;
+    int i, n;
+
+    key = irq_lock();
+    memcpy(prof, spi_prof, sizeof(prof));
+    irq_unlock(key);
+
+    for (i = 0; i < DECA_SPI_PROF_REGS; i++)
+    {
+        total += prof[i].cycles;
+        trans += prof[i].reads + prof[i].writes;
+    }
+    printk("SPI: %u transactions, %u us\n", trans, (uint32)(total / cyc_per_us));
+
+    /* Largest left first: a selection over 64 entries */
+    for (n = 0; n < topN; n++)
+    {
+        int best = -1;
+
+        for (i = 0; i < DECA_SPI_PROF_REGS; i++)
+        {
+            if ((prof[i].reads + prof[i].writes) &&
+                ((best < 0) || (prof[i].cycles > prof[best].cycles)))
+            {
+                best = i;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+
+        printk("0x%02x %s\t%u rd %u wr %u B %u us %u%%\n", best,
+               spi_prof_names[best] ? spi_prof_names[best] : "?", prof[best].reads, prof[best].writes,
+               prof[best].bytes, prof[best].cycles / cyc_per_us,
+               total ? (uint32)((uint64_t)prof[best].cycles * 100 / total) : 0);
+
+        prof[best].reads = 0;
+        prof[best].writes = 0;
+    }
+}
+#endif /* CONFIG_DW1000_SPI_PROF */
+
 /****************************************************************************//**
  *
  *                              END OF DW1000 SPI section
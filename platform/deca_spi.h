@@ -22,6 +22,16 @@ extern "C" {
 
 #define DECA_MAX_SPI_HEADER_LENGTH      (3)                     // max number of bytes in header (for formating & sizing)
 
+// Longest body the nRF52 SPIM EasyDMA moves per descriptor (MAXCNT is 8 bits)
+#define DECA_SPI_CHUNK_LEN              (255)
+// Body descriptors per transfer: covers the largest DW1000 memory, the 4064 byte
+// accumulator plus its dummy octet, in a single CS assertion
+#define DECA_SPI_MAX_CHUNKS             ((4096 + DECA_SPI_CHUNK_LEN - 1) / DECA_SPI_CHUNK_LEN)
+
+// Thread delivering writetospi_async/readfromspi_async completions (CONFIG_SPI_ASYNC)
+#define DECA_SPI_ASYNC_STACK_SIZE       (1024)
+#define DECA_SPI_ASYNC_PRIO             (2)
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Function: openspi()
  *
@@ -38,8 +48,82 @@ int openspi(void) ;
  */
 int closespi(void) ;
 
+// SPI speed profiles
+#define DECA_SPI_SLOW_FREQ              (2000000)               // DW1000 INIT state (clocked from the 19.2 MHz XTI) allows 3 MHz max
+#define DECA_SPI_FAST_FREQ              (8000000)
+// DW1000 limit once the PLL is locked. The SPIM driver rounds down to the fastest rate the SoC
+// supports: 8 MHz on the nRF52832 of the DWM1001, 16 MHz on SoCs with the 32 MHz capable SPIM3
+#define DECA_SPI_MAX_FREQ               (20000000)
+
+typedef enum
+{
+    DECA_SPI_SPEED_SLOW,
+    DECA_SPI_SPEED_FAST,
+    DECA_SPI_SPEED_MAX,
+    DECA_SPI_SPEED_NUM
+} deca_spi_speed_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: set_spi_speed()
+ *
+ * Selects the SPI speed profile used by the following transfers, this is a constant time pointer switch
+ */
+void set_spi_speed(deca_spi_speed_t speed);
+
 void set_spi_speed_slow();
 void set_spi_speed_fast();
+void set_spi_speed_max();
+
+/* SPI transactions of the DW1000 driver, as writetospi()/readfromspi(): a header of 1 to 3 bytes (write flag, sub-index
+ * flag, register file ID and sub-index) then the body. The host port of the simulator (sim/) always routes them to a
+ * backend, the target does with CONFIG_DW1000_SPI_BACKEND. */
+typedef struct
+{
+    int (*write)(uint16 headerLength, const uint8 *headerBuffer, uint32 bodyLength, const uint8 *bodyBuffer);
+    int (*read)(uint16 headerLength, const uint8 *headerBuffer, uint32 readLength, uint8 *readBuffer);
+} deca_spi_backend_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_set_backend()
+ *
+ * Routes the following transactions to a backend, NULL for the default one (the SPI bus on the target). The mutex,
+ * tracepoints and profiler of the SPI layer still wrap the calls, the asynchronous functions complete in place.
+ */
+void deca_spi_set_backend(const deca_spi_backend_t *backend);
+
+#ifdef CONFIG_DW1000_SPI_PROF
+// Register files told apart by the profiler: 6 bit ID of the transaction header
+#define DECA_SPI_PROF_REGS              (64)
+
+typedef struct
+{
+    uint32 reads;                       // transactions
+    uint32 writes;
+    uint32 bytes;                       // header and body
+    uint32 cycles;                      // CPU cycles in the blocking transfers, asynchronous ones are not timed
+} deca_spi_prof_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_reset()
+ *
+ * Clears the per register file counters and starts the cycle counter timing the transfers, done by openspi()
+ */
+void deca_spi_prof_reset(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_get()
+ *
+ * Reads the counters of a register file, e.g. SYS_STATUS_ID
+ */
+void deca_spi_prof_get(uint8 reg, deca_spi_prof_t *prof);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: deca_spi_prof_report()
+ *
+ * Prints the topN register files by bus time, with their transactions, bytes and share of the total
+ */
+void deca_spi_prof_report(uint8 topN);
+#endif /* CONFIG_DW1000_SPI_PROF */
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,207 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_trace.c
+ * @brief   Hot path latency tracepoints on the Cortex-M cycle counter
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_trace.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+#define TRACE_RING_LEN              CONFIG_DW1000_TRACE_RING
+#define TRACE_RING_MASK             (TRACE_RING_LEN - 1)
+
+BUILD_ASSERT_MSG((TRACE_RING_LEN & TRACE_RING_MASK) == 0, "CONFIG_DW1000_TRACE_RING must be a power of two");
+
+/* One duration; seq is written last, the reader takes the entry once it matches its index */
+typedef struct
+{
+    uint32 cyc;
+    uint8 id;
+    volatile uint32 seq;
+} deca_trace_rec_t;
+
+typedef struct
+{
+    deca_trace_rec_t ring[TRACE_RING_LEN];
+    atomic_t head;                      // next index to write, all writers
+    uint32 tail;                        // next index to read, deca_trace_collect() only
+    uint32 lost;
+    deca_trace_stats_t stats[DECA_TRACE_NUM];
+} deca_trace_local_t;
+
+static deca_trace_local_t trc;
+
+volatile uint32 deca_trace_start[DECA_TRACE_NUM];
+
+static const char *const trace_names[DECA_TRACE_NUM] = {
+    "irq", "isr", "spi wr", "spi rd", "rx-tx", "app"
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_record()
+ *
+ * @brief see deca_trace.h
+ */
+void deca_trace_record(deca_trace_id_t id, uint32 cyc)
+{
+    uint32 i = (uint32)atomic_inc(&trc.head);
+    deca_trace_rec_t *rec = &trc.ring[i & TRACE_RING_MASK];
+
+    rec->cyc = cyc;
+    rec->id = (uint8)id;
+    compiler_barrier();
+    rec->seq = i;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_init()
+ *
+ * @brief see deca_trace.h
+ */
+void deca_trace_init(void)
+{
+    int i;
+
+    memset(&trc, 0, sizeof(trc));
+    memset((void *)deca_trace_start, 0, sizeof(deca_trace_start));
+
+    /* No entry has its index yet: the first lap must not be taken for written */
+    for (i = 0; i < TRACE_RING_LEN; i++)
+    {
+        trc.ring[i].seq = ~(uint32)i;
+    }
+    for (i = 0; i < DECA_TRACE_NUM; i++)
+    {
+        trc.stats[i].minCyc = UINT32_MAX;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_collect()
+ *
+ * @brief see deca_trace.h
+ */
+int deca_trace_collect(void)
+{
+    uint32 head = (uint32)atomic_get(&trc.head);
+    uint32 cyc_per_us = SystemCoreClock / 1000000;
+    int n = 0;
+
+    if (head - trc.tail > TRACE_RING_LEN)
+    {
+        trc.lost += head - trc.tail - TRACE_RING_LEN;
+        trc.tail = head - TRACE_RING_LEN;
+    }
+
+    while (trc.tail != head)
+    {
+        deca_trace_rec_t *rec = &trc.ring[trc.tail & TRACE_RING_MASK];
+        deca_trace_stats_t *st;
+        uint32 cyc, us;
+        int bin;
+
+        if (rec->seq != trc.tail)
+        {
+            /* Overwritten by a writer a lap ahead: skip it */
+            if ((int32)(rec->seq - trc.tail) > 0)
+            {
+                trc.lost++;
+                trc.tail++;
+                continue;
+            }
+
+            /* Index taken, duration not written yet: next time */
+            break;
+        }
+        compiler_barrier();
+        cyc = rec->cyc;
+        st = &trc.stats[rec->id];
+
+        st->count++;
+        st->sumCyc += cyc;
+        st->minCyc = MIN(st->minCyc, cyc);
+        st->maxCyc = MAX(st->maxCyc, cyc);
+
+        us = cyc / cyc_per_us;
+        bin = (us < 2) ? 0 : (31 - __builtin_clz(us));
+        st->hist[MIN(bin, DECA_TRACE_BINS - 1)]++;
+
+        trc.tail++;
+        n++;
+    }
+
+    return n;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_get()
+ *
+ * @brief see deca_trace.h
+ */
+void deca_trace_get(deca_trace_id_t id, deca_trace_stats_t *stats)
+{
+    *stats = trc.stats[id];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_lost()
+ *
+ * @brief see deca_trace.h
+ */
+uint32 deca_trace_lost(void)
+{
+    return trc.lost;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_print()
+ *
+ * @brief see deca_trace.h
+ */
+void deca_trace_print(void)
+{
+    uint32 cyc_per_us = SystemCoreClock / 1000000;
+    int i, b;
+
+    deca_trace_collect();
+
+    for (i = 0; i < DECA_TRACE_NUM; i++)
+    {
+        const deca_trace_stats_t *st = &trc.stats[i];
+
+        if (st->count == 0)
+        {
+            continue;
+        }
+
+        /* Tenths of us: the SPI spans are a few us */
+        printk("%s\t%u\tmin %u.%u  avg %u.%u  max %u.%u us |", trace_names[i], st->count,
+               st->minCyc * 10 / cyc_per_us / 10, st->minCyc * 10 / cyc_per_us % 10,
+               (uint32)(st->sumCyc * 10 / st->count / cyc_per_us) / 10,
+               (uint32)(st->sumCyc * 10 / st->count / cyc_per_us) % 10,
+               st->maxCyc * 10 / cyc_per_us / 10, st->maxCyc * 10 / cyc_per_us % 10);
+        for (b = 0; b < DECA_TRACE_BINS; b++)
+        {
+            printk(" %u", st->hist[b]);
+        }
+        printk("\n");
+    }
+    if (trc.lost)
+    {
+        printk("trace: %u lost\n", trc.lost);
+    }
+}
@@ -0,0 +1,179 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_trace.h
+ * @brief   Hot path latency tracepoints on the Cortex-M cycle counter
+ *
+ *          A span starts with DECA_TRACE_BEGIN() and ends with
+ *          DECA_TRACE_END(), both reading DWT_CYCCNT (64 MHz on the
+ *          nRF52832, 15.6 ns). The duration goes to a lock-free ring, any
+ *          context may write it: interrupts, the DW1000 IRQ work queue,
+ *          threads. deca_trace_collect() drains the ring into per span
+ *          min/avg/max and a log2 histogram, deca_trace_print() prints
+ *          them with printk(), to the RTT console when it is configured.
+ *
+ *          The spans of the driver port and ranging engine:
+ *          - DECA_TRACE_IRQ:    DW_IRQ edge to the work queue running the
+ *                               handler (ISR-to-callback latency);
+ *          - DECA_TRACE_ISR:    dwt_isr() and the callbacks it calls;
+ *          - DECA_TRACE_SPI_WR: writetospi(), DECA_TRACE_SPI_RD:
+ *                               readfromspi();
+ *          - DECA_TRACE_RX_TX:  RX good callback to the delayed TX armed,
+ *                               the host share of the response budget.
+ *          DECA_TRACE_APP is left to the application.
+ *
+ *          Without CONFIG_DW1000_TRACE the macros compile to nothing.
+ *          One span of each kind is timed at a time: an END without its
+ *          BEGIN, e.g. a first poll sent without any RX before it, is not
+ *          counted, DECA_TRACE_CANCEL() drops a span begun that will not
+ *          end.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_TRACE_H_
+#define _DECA_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "deca_types.h"
+
+typedef enum
+{
+    DECA_TRACE_IRQ,
+    DECA_TRACE_ISR,
+    DECA_TRACE_SPI_WR,
+    DECA_TRACE_SPI_RD,
+    DECA_TRACE_RX_TX,
+    DECA_TRACE_APP,
+    DECA_TRACE_NUM
+} deca_trace_id_t;
+
+// Histogram bins: bin 0 under 2 us, bin k from 2^k us to 2^(k+1) us, the last one above
+#define DECA_TRACE_BINS             12
+
+typedef struct
+{
+    uint32 count;
+    uint32 minCyc;
+    uint32 maxCyc;
+    uint64_t sumCyc;
+    uint32 hist[DECA_TRACE_BINS];
+} deca_trace_stats_t;
+
+#ifdef CONFIG_DW1000_TRACE
+
+#include <soc.h>
+
+extern volatile uint32 deca_trace_start[DECA_TRACE_NUM];
+
+void deca_trace_record(deca_trace_id_t id, uint32 cyc);
+
+/* The start is kept odd so that 0 tells a span not begun */
+static inline void deca_trace_begin(deca_trace_id_t id)
+{
+    deca_trace_start[id] = DWT->CYCCNT | 1;
+}
+
+static inline void deca_trace_end(deca_trace_id_t id)
+{
+    uint32 start = deca_trace_start[id];
+
+    if (start)
+    {
+        deca_trace_start[id] = 0;
+        deca_trace_record(id, (DWT->CYCCNT | 1) - start);
+    }
+}
+
+#define DECA_TRACE_BEGIN(id)        deca_trace_begin(id)
+#define DECA_TRACE_END(id)          deca_trace_end(id)
+#define DECA_TRACE_CANCEL(id)       (deca_trace_start[id] = 0)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_init()
+ *
+ * @brief Start the cycle counter and clear the ring and the summaries. Called by the DW1000 driver at boot.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_trace_init(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_collect()
+ *
+ * @brief Drain the ring into the summaries. Call from one thread only.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the number of durations drained
+ */
+int deca_trace_collect(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_get()
+ *
+ * @brief Read the summary of a span, as of the last deca_trace_collect().
+ *
+ * input parameters
+ * @param id    - span
+ *
+ * output parameters
+ * @param stats - count, min, max and sum in cycles, histogram
+ *
+ * no return value
+ */
+void deca_trace_get(deca_trace_id_t id, deca_trace_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_lost()
+ *
+ * @brief Durations overwritten in the ring before deca_trace_collect() drained them.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the count since deca_trace_init()
+ */
+uint32 deca_trace_lost(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_trace_print()
+ *
+ * @brief Collect, then print the spans seen: count, min/avg/max in us and the histogram.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_trace_print(void);
+
+#else
+
+#define DECA_TRACE_BEGIN(id)
+#define DECA_TRACE_END(id)
+#define DECA_TRACE_CANCEL(id)
+
+#endif /* CONFIG_DW1000_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_TRACE_H_ */
@@ -0,0 +1,164 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_ts.h
+ * @brief   DW1000 40-bit timestamp helpers
+ *
+ *          Timestamps are read straight into a uint64_t in one SPI burst and
+ *          frame fields are copied as they are, the DW1000 and the Cortex-M4
+ *          are both little endian. Arithmetic is done
+ *          modulo 2^40, so intervals stay right across a clock wrap (~17.2 s).
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_TS_H_
+#define _DECA_TS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "deca_ts.h reads the DW1000 timestamps in place, it needs a little endian CPU"
+#endif
+
+#define DECA_TS_LEN             5                       // bytes of a timestamp register
+#define DECA_TS_MASK            0xFFFFFFFFFFULL         // 40-bit time
+#define DECA_TS_UUS             65536                   // device time units per UWB microsecond (512 / 499.2 us)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_ts_readtx() / deca_ts_readrx() / deca_ts_readsys()
+ *
+ * @brief Read the TX timestamp, RX timestamp or system time, 40 bits in one SPI read.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the time in device time units (15.65 ps)
+ */
+static inline uint64_t deca_ts_readtx(void)
+{
+    uint64_t ts = 0;
+
+    dwt_readtxtimestamp((uint8 *)&ts);
+    return ts;
+}
+
+static inline uint64_t deca_ts_readrx(void)
+{
+    uint64_t ts = 0;
+
+    dwt_readrxtimestamp((uint8 *)&ts);
+    return ts;
+}
+
+static inline uint64_t deca_ts_readsys(void)
+{
+    uint64_t ts = 0;
+
+    dwt_readsystime((uint8 *)&ts);
+    return ts;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_ts_sub() / deca_ts_add()
+ *
+ * @brief Wrap-safe 40-bit difference (b earlier than a) and sum.
+ *
+ * input parameters
+ * @param a, b - timestamps or intervals in device time units
+ *
+ * output parameters
+ *
+ * returns a - b / a + b, modulo 2^40
+ */
+static inline uint64_t deca_ts_sub(uint64_t a, uint64_t b)
+{
+    return (a - b) & DECA_TS_MASK;
+}
+
+static inline uint64_t deca_ts_add(uint64_t a, uint64_t b)
+{
+    return (a + b) & DECA_TS_MASK;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_ts_dlytime()
+ *
+ * @brief Delayed TX/RX time for dwt_setdelayedtrxtime(), some UWB microseconds after a timestamp.
+ *
+ * input parameters
+ * @param ts     - reference timestamp
+ * @param dlyUus - delay in UWB microseconds
+ *
+ * output parameters
+ *
+ * returns the high 32 bits of the 40-bit time
+ */
+static inline uint32 deca_ts_dlytime(uint64_t ts, uint32 dlyUus)
+{
+    return (uint32)((ts + (uint64_t)dlyUus * DECA_TS_UUS) >> 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_ts_dlytxts()
+ *
+ * @brief TX timestamp a delayed transmission will have: the delayed time ignores its low 9 bits, the TX antenna delay
+ *        is then added.
+ *
+ * input parameters
+ * @param dlyTime - time given to dwt_setdelayedtrxtime()
+ * @param antDly  - TX antenna delay
+ *
+ * output parameters
+ *
+ * returns the TX timestamp in device time units
+ */
+static inline uint64_t deca_ts_dlytxts(uint32 dlyTime, uint16 antDly)
+{
+    return ((((uint64_t)(dlyTime & 0xFFFFFFFEUL)) << 8) + antDly) & DECA_TS_MASK;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_ts_pack() / deca_ts_unpack()
+ *
+ * @brief Write / read a timestamp in a frame field, least significant byte first. Fields of 4 bytes carry the 32 low
+ *        bits, enough for intervals below ~67 ms once subtracted in 32 bits.
+ *
+ * input parameters
+ * @param field - first byte of the field
+ * @param ts    - timestamp to write
+ * @param len   - field length, 1 to DECA_TS_LEN
+ *
+ * output parameters
+ *
+ * returns the timestamp read
+ */
+static inline void deca_ts_pack(uint8 *field, uint64_t ts, int len)
+{
+    memcpy(field, &ts, len);
+}
+
+static inline uint64_t deca_ts_unpack(const uint8 *field, int len)
+{
+    uint64_t ts = 0;
+
+    memcpy(&ts, field, len);
+    return ts;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_TS_H_ */
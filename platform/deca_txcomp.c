@@ -0,0 +1,195 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_txcomp.c
+ * @brief   Incremental temperature compensation of the TX power and
+ *          bandwidth
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "deca_txcomp.h"
+#include "deca_regs.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+/* PG calibration time: 1 ms in dwt_calcpgcount(), "can be as low as 10us" */
+#define TXCOMP_PGCAL_US             20
+
+/* PG_DELAY units tried per compensation before settling on the closest count */
+#define TXCOMP_PG_MAX_STEPS         16
+
+typedef struct
+{
+    deca_txcomp_config_t cfg;
+    deca_txcomp_ref_t ref;
+    uint8 valid;                        // a temperature sample was taken
+    uint32 sampleMs;                    // uptime of the last sample
+    uint8 steps;                        // PG_DELAY units tried for the current compensation
+    uint8 bestDelay;                    // closest to the reference count so far
+    uint16 bestDist;
+    deca_txcomp_stats_t stats;
+} deca_txcomp_local_t;
+
+static deca_txcomp_local_t txc;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn txcomp_pgcount()
+ *
+ * @brief One PG count measurement for a PG_DELAY, left set, as one iteration of dwt_calcpgcount(). SPI < 3 MHz.
+ */
+static uint16 txcomp_pgcount(uint8 pgdly)
+{
+    uint8 old_pmsc_ctrl0;
+    uint16 old_pmsc_ctrl1, count;
+    uint32 old_rf_conf;
+
+    old_pmsc_ctrl0 = dwt_read8bitoffsetreg(PMSC_ID, PMSC_CTRL0_OFFSET);
+    old_pmsc_ctrl1 = dwt_read16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET);
+    old_rf_conf = dwt_read32bitreg(RF_CONF_ID);
+
+    /* XTAL, sequencing off, CLK PLL, mixer bias and PG on, then sys and TX clocks on the PLL */
+    dwt_write8bitoffsetreg(PMSC_ID, PMSC_CTRL0_OFFSET, PMSC_CTRL0_SYSCLKS_19M);
+    dwt_write16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET, PMSC_CTRL1_PKTSEQ_DISABLE);
+    dwt_write32bitreg(RF_CONF_ID, RF_CONF_TXPOW_MASK | RF_CONF_PGMIXBIASEN_MASK);
+    dwt_write8bitoffsetreg(PMSC_ID, PMSC_CTRL0_OFFSET, PMSC_CTRL0_SYSCLKS_125M | PMSC_CTRL0_TXCLKS_125M);
+
+    dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGDELAY_OFFSET, pgdly);
+    dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGCCTRL_OFFSET, TC_PGCCTRL_DIR_CONV | TC_PGCCTRL_TMEAS_MASK);
+    dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGCCTRL_OFFSET, TC_PGCCTRL_DIR_CONV | TC_PGCCTRL_TMEAS_MASK | TC_PGCCTRL_CALSTART);
+    k_busy_wait(TXCOMP_PGCAL_US);
+    count = dwt_read16bitoffsetreg(TX_CAL_ID, TC_PGCAL_STATUS_OFFSET) & TC_PGCAL_STATUS_DELAY_MASK;
+
+    dwt_write8bitoffsetreg(PMSC_ID, PMSC_CTRL0_OFFSET, old_pmsc_ctrl0);
+    dwt_write16bitoffsetreg(PMSC_ID, PMSC_CTRL1_OFFSET, old_pmsc_ctrl1);
+    dwt_write32bitreg(RF_CONF_ID, old_rf_conf);
+
+    return count;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn txcomp_pgstep()
+ *
+ * @brief Measure the PG count at the current PG_DELAY and move one unit towards the reference count: a higher count
+ *        needs a longer delay, see dwt_calcbandwidthtempadj().
+ */
+static void txcomp_pgstep(void)
+{
+    uint8 pgdly = txc.stats.pgDelay;
+    uint16 count, dist;
+
+    port_set_dw1000_slowrate();
+    count = txcomp_pgcount(pgdly);
+    port_set_dw1000_fastrate();
+
+    txc.stats.pgCount = count;
+    txc.stats.pgSteps++;
+    txc.steps++;
+
+    dist = (count > txc.ref.pgCount) ? (count - txc.ref.pgCount) : (txc.ref.pgCount - count);
+    if (dist < txc.bestDist)
+    {
+        txc.bestDist = dist;
+        txc.bestDelay = pgdly;
+    }
+
+    if ((dist <= txc.cfg.countTol) || (txc.steps >= TXCOMP_PG_MAX_STEPS) ||
+        ((count > txc.ref.pgCount) && (pgdly == 0xFF)) || ((count < txc.ref.pgCount) && (pgdly == 0)))
+    {
+        pgdly = txc.bestDelay;
+        txc.stats.tracking = 0;
+    }
+    else
+    {
+        pgdly = (count > txc.ref.pgCount) ? (pgdly + 1) : (pgdly - 1);
+    }
+
+    txc.stats.pgDelay = pgdly;
+    dwt_write8bitoffsetreg(TX_CAL_ID, TC_PGDELAY_OFFSET, pgdly);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_init()
+ *
+ * @brief see deca_txcomp.h
+ */
+int deca_txcomp_init(const deca_txcomp_config_t *config, const deca_txcomp_ref_t *ref)
+{
+    if ((config == NULL) || (ref == NULL) || ((config->chan != 2) && (config->chan != 5)))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&txc, 0, sizeof(txc));
+    txc.cfg = *config;
+    txc.ref = *ref;
+    txc.stats.compTemp = ref->temp;
+    txc.stats.pgDelay = ref->pgDelay;
+    txc.stats.power = ref->power;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_step()
+ *
+ * @brief see deca_txcomp.h
+ */
+int deca_txcomp_step(void)
+{
+    uint32 now = k_uptime_get_32();
+    uint8 temp;
+    int dt;
+
+    if (txc.stats.tracking)
+    {
+        txcomp_pgstep();
+        return txc.stats.tracking;
+    }
+
+    if (txc.valid && ((now - txc.sampleMs) < txc.cfg.sampleMs))
+    {
+        return 0;
+    }
+
+    temp = (uint8)(dwt_readtempvbat(1) >> 8);
+    txc.valid = 1;
+    txc.sampleMs = now;
+    txc.stats.temp = temp;
+    txc.stats.samples++;
+
+    dt = (int)temp - txc.stats.compTemp;
+    if ((dt < txc.cfg.tempDelta) && (-dt < txc.cfg.tempDelta) && (txc.stats.compensations != 0))
+    {
+        return 0;
+    }
+
+    /* TX power straight from the reference, the bandwidth converges over the next steps */
+    txc.stats.compTemp = temp;
+    txc.stats.compensations++;
+    txc.stats.power = dwt_calcpowertempadj(txc.cfg.chan, txc.ref.power, (int)temp - txc.ref.temp);
+    dwt_write32bitreg(TX_POWER_ID, txc.stats.power);
+
+    txc.steps = 0;
+    txc.bestDist = 0xFFFF;
+    txc.bestDelay = txc.stats.pgDelay;
+    txc.stats.tracking = 1;
+
+    return 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_getstats()
+ *
+ * @brief see deca_txcomp.h
+ */
+void deca_txcomp_getstats(deca_txcomp_stats_t *stats)
+{
+    *stats = txc.stats;
+}
@@ -0,0 +1,127 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_txcomp.h
+ * @brief   Incremental temperature compensation of the TX power and
+ *          bandwidth
+ *
+ *          Examples 9a/9b take the reference (PG_DELAY, TX_POWER, raw
+ *          temperature, PG count) and compensate once, with
+ *          dwt_calcbandwidthtempadj(): a 7 step PG_DELAY sweep, 1 ms each,
+ *          with the packet sequencing stopped. Here the work is split into
+ *          steps short enough to fit between two ranging slots:
+ *          - a temperature sample, every sampleMs;
+ *          - once it moved by tempDelta from the last compensation: the TX
+ *            power, computed from the reference (dwt_calcpowertempadj()),
+ *            then the bandwidth, one PG count measurement and one PG_DELAY
+ *            unit towards the reference count per step, from the current
+ *            setting rather than a full sweep.
+ *
+ *          deca_txcomp_step() is called with the DW1000 idle: by the
+ *          application, or by the TDMA scheduler (rng_tdma.h) at the end
+ *          of each cycle when there is time left before the next one.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_TXCOMP_H_
+#define _DECA_TXCOMP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Longest deca_txcomp_step(): a temperature sample, see dwt_readtempvbat()
+#define DECA_TXCOMP_STEP_US         1500
+
+/* Reference measurements, see example 9a */
+typedef struct
+{
+    uint8 pgDelay;                      // PG_DELAY giving the best bandwidth at the reference temperature
+    uint32 power;                       // TX_POWER at the reference temperature
+    uint8 temp;                         // reference temperature, raw
+    uint16 pgCount;                     // PG count at the reference temperature with the above
+} deca_txcomp_ref_t;
+
+typedef struct
+{
+    uint8 chan;                         // 2 or 5, see dwt_calcpowertempadj()
+    uint8 tempDelta;                    // temperature change triggering a compensation, raw sensor LSB (about 1.14 C)
+    uint16 sampleMs;                    // time between two temperature samples
+    uint8 countTol;                     // PG count distance to the reference accepted as reached
+} deca_txcomp_config_t;
+
+#define DECA_TXCOMP_CONFIG_DEFAULT(channel) { \
+    .chan = (channel),                  \
+    .tempDelta = 2,                     \
+    .sampleMs = 1000,                   \
+    .countTol = 2,                      \
+}
+
+typedef struct
+{
+    uint8 temp;                         // last temperature sample, raw
+    uint8 compTemp;                     // temperature of the settings in use, raw
+    uint8 pgDelay;                      // PG_DELAY in use
+    uint32 power;                       // TX_POWER in use
+    uint16 pgCount;                     // last PG count measured
+    uint8 tracking;                     // bandwidth still moving towards the reference count
+    uint32 samples;
+    uint32 compensations;               // temperature changes handled
+    uint32 pgSteps;                     // PG count measurements
+} deca_txcomp_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_init()
+ *
+ * @brief Start from the reference settings, the first step samples the temperature.
+ *
+ * input parameters
+ * @param config - channel and thresholds, copied
+ * @param ref    - reference measurements, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if a parameter is NULL or the channel is not 2 or 5
+ */
+int deca_txcomp_init(const deca_txcomp_config_t *config, const deca_txcomp_ref_t *ref);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_step()
+ *
+ * @brief Do the next piece of work, if any is due: at most DECA_TXCOMP_STEP_US. The DW1000 must be idle, the SPI at
+ *        its fast rate; it goes at its slow rate during a PG count measurement.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns 1 if the bandwidth is still being adjusted (call again soon), 0 otherwise
+ */
+int deca_txcomp_step(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txcomp_getstats()
+ *
+ * @brief Read the settings in use and counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - settings and counters since deca_txcomp_init()
+ *
+ * no return value
+ */
+void deca_txcomp_getstats(deca_txcomp_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_TXCOMP_H_ */
@@ -0,0 +1,108 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_txslot.c
+ * @brief   Frames kept resident in the DW1000 TX buffer, one slot each
+ *
+ *          TX buffer: | 0 .. DECA_TXSLOT_BASE: dwt_writetxdata() | slot 0 | slot 1 | ... | free |
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "deca_txslot.h"
+
+typedef struct
+{
+    dwt_txtemplate_t tpl[DECA_TXSLOT_MAX];
+    uint8 *frame[DECA_TXSLOT_MAX];
+    uint8 count;
+    uint16 next;                        // offset of the next slot
+} deca_txslot_local_t;
+
+static deca_txslot_local_t txslot = { .next = DECA_TXSLOT_BASE };
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_add()
+ *
+ * @brief see deca_txslot.h
+ */
+int deca_txslot_add(uint8 *frame, uint16 len)
+{
+    int slot = txslot.count;
+
+    if ((slot == DECA_TXSLOT_MAX) || (txslot.next + len > DECA_TXSLOT_BUF_LEN))
+    {
+        return DWT_ERROR;
+    }
+
+    if (dwt_loadtxtemplate(&txslot.tpl[slot], len, frame, txslot.next) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    txslot.frame[slot] = frame;
+    txslot.count++;
+    /* The CRC is not stored, the next frame can start right after the data */
+    txslot.next += len - 2;
+
+    return slot;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_select()
+ *
+ * @brief see deca_txslot.h
+ */
+void deca_txslot_select(int slot, int ranging)
+{
+    dwt_selecttxtemplate(&txslot.tpl[slot], ranging);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_patch()
+ *
+ * @brief see deca_txslot.h
+ */
+int deca_txslot_patch(int slot, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes)
+{
+    return dwt_patchtxtemplate(&txslot.tpl[slot], fieldOffset, length, fieldBytes);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_txnpatch()
+ *
+ * @brief see deca_txslot.h
+ */
+int deca_txslot_txnpatch(dwt_txn_t *txn, int slot, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes)
+{
+    return dwt_txnpatchtxtemplate(txn, &txslot.tpl[slot], fieldOffset, length, fieldBytes);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_reload()
+ *
+ * @brief see deca_txslot.h
+ */
+void deca_txslot_reload(void)
+{
+    int i;
+
+    for (i = 0; i < txslot.count; i++)
+    {
+        dwt_loadtxtemplate(&txslot.tpl[i], txslot.tpl[i].length, txslot.frame[i], txslot.tpl[i].offset);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_reset()
+ *
+ * @brief see deca_txslot.h
+ */
+void deca_txslot_reset(void)
+{
+    txslot.count = 0;
+    txslot.next = DECA_TXSLOT_BASE;
+}
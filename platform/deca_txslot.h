@@ -0,0 +1,117 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_txslot.h
+ * @brief   Frames kept resident in the DW1000 TX buffer, one slot each
+ *
+ *          Each frame is written once at its own offset of the 1024 byte
+ *          TX buffer (dwt_loadtxtemplate), sending it is then only a
+ *          TX_FCTRL write (dwt_selecttxtemplate) plus the fields that
+ *          change. The first DECA_TXSLOT_BASE bytes are left to frames
+ *          written at offset 0 with dwt_writetxdata(), e.g. by the ranging
+ *          engine.
+ *
+ *          The TX buffer is lost in DEEPSLEEP: deca_txslot_reload()
+ *          rewrites every slot from the frames given to deca_txslot_add(),
+ *          which must therefore stay allocated.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_TXSLOT_H_
+#define _DECA_TXSLOT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_device_api.h"
+
+#define DECA_TXSLOT_MAX         (8)
+#define DECA_TXSLOT_BASE        (128)           // start of the slots in the TX buffer
+#define DECA_TXSLOT_BUF_LEN     (1024)          // DW1000 TX buffer
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_add()
+ *
+ * @brief Give a frame a slot of the TX buffer and write it there.
+ *
+ * input parameters
+ * @param frame - frame content, kept for deca_txslot_reload()
+ * @param len   - frame length, including the two byte CRC
+ *
+ * output parameters
+ *
+ * returns the slot, or DWT_ERROR if all the slots or the TX buffer are used
+ */
+int deca_txslot_add(uint8 *frame, uint16 len);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_select()
+ *
+ * @brief Make the frame of a slot the one sent by the next dwt_starttx(): a single TX_FCTRL write.
+ *
+ * input parameters
+ * @param slot    - slot returned by deca_txslot_add()
+ * @param ranging - 1 if this is a ranging frame, else 0
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_txslot_select(int slot, int ranging);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_patch()/deca_txslot_txnpatch()
+ *
+ * @brief Rewrite a field of the frame of a slot in the TX buffer, straight away or queued in a register transaction.
+ *        The frame given to deca_txslot_add() is not changed.
+ *
+ * input parameters
+ * @param txn         - the transaction (deca_txslot_txnpatch() only)
+ * @param slot        - slot returned by deca_txslot_add()
+ * @param fieldOffset - offset of the field in the frame
+ * @param length      - field length
+ * @param fieldBytes  - new field content
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the field is outside the frame (or the transaction is full)
+ */
+int deca_txslot_patch(int slot, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes);
+int deca_txslot_txnpatch(dwt_txn_t *txn, int slot, uint16 fieldOffset, uint16 length, const uint8 *fieldBytes);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_reload()
+ *
+ * @brief Write the frames of all the slots to the TX buffer again, after DEEPSLEEP or a reset of the DW1000.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_txslot_reload(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_txslot_reset()
+ *
+ * @brief Free all the slots.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_txslot_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_TXSLOT_H_ */
@@ -0,0 +1,130 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw1000_drv.c
+ * @brief   Zephyr device driver binding of the DW1000 (CONFIG_DW1000)
+ *
+ *          The device is instantiated from the "decawave,dw1000" devicetree
+ *          node. Its POST_KERNEL init only starts a thread that brings the
+ *          radio up, so the rest of the boot (Bluetooth, console, ...) is not
+ *          held up by the DW1000 reset and crystal start up. With
+ *          CONFIG_DW1000_CAL_STORE it also applies the crystal trim kept in
+ *          flash, see deca_cal.h.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "dw1000_drv.h"
+#include "deca_device_api.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "deca_trace.h"
+#ifdef CONFIG_DW1000_CAL_STORE
+#include "deca_cal.h"
+#endif
+
+//zephyr includes
+#include <zephyr.h>
+#include <misc/printk.h>
+#include <device.h>
+#include <init.h>
+
+#ifdef CONFIG_DW1000_LOAD_UCODE
+#define DW1000_INIT_UCODE   DWT_LOADUCODE
+#else
+#define DW1000_INIT_UCODE   DWT_LOADNONE
+#endif
+
+#ifdef CONFIG_DW1000_READ_OTP_TMP
+#define DW1000_INIT_OTP     DWT_READ_OTP_TMP
+#else
+#define DW1000_INIT_OTP     0
+#endif
+
+#define DW1000_INIT_MODE    (DW1000_INIT_UCODE | DW1000_INIT_OTP)
+
+static K_THREAD_STACK_DEFINE(dw1000_init_stack, CONFIG_DW1000_INIT_THREAD_STACK_SIZE);
+static struct k_thread dw1000_init_thread;
+
+/* Given once the bring-up is over, then handed on by every waiter */
+static K_SEM_DEFINE(dw1000_ready_sem, 0, 1);
+static int dw1000_status = -1;
+
+/* @fn      dw1000_bringup
+ * @brief   reset and initialise the DW1000 the way the examples used to,
+ *          then release the waiters of dw1000_wait_ready
+ * */
+static void dw1000_bringup(void *p1, void *p2, void *p3)
+{
+    if (openspi() == 0)
+    {
+        /* The reset line does not wake a sleeping DW1000 up, CS does */
+        port_wakeup_dw1000();
+
+        /* For initialisation, DW1000 clocks must be temporarily set to crystal speed */
+        reset_DW1000();
+        port_set_dw1000_slowrate();
+        if (dwt_initialise(DW1000_INIT_MODE) == DWT_SUCCESS)
+        {
+#ifdef CONFIG_DW1000_CAL_STORE
+            deca_cal_t cal;
+
+            /* The stored crystal trim replaces the OTP one, the antenna delays wait for dwt_configure() */
+            if ((deca_cal_load() == DWT_SUCCESS) && (deca_cal_get(&cal) == DWT_SUCCESS) && cal.xtalTrim)
+            {
+                dwt_setxtaltrim(cal.xtalTrim);
+            }
+#endif
+            port_set_dw1000_fastrate();
+            dw1000_status = 0;
+        }
+    }
+
+    if (dw1000_status != 0)
+    {
+        printk("DW1000: init failed\n");
+    }
+
+    k_sem_give(&dw1000_ready_sem);
+}
+
+/* @fn      dw1000_wait_ready
+ * @brief   see dw1000_drv.h
+ * */
+int dw1000_wait_ready(int32_t timeout)
+{
+    if (k_sem_take(&dw1000_ready_sem, timeout) != 0)
+    {
+        return -1;
+    }
+    k_sem_give(&dw1000_ready_sem);
+
+    return dw1000_status;
+}
+
+static const struct dw1000_driver_api dw1000_api = {
+    .wait_ready = dw1000_wait_ready,
+};
+
+/* @fn      dw1000_init
+ * @brief   device init, POST_KERNEL: SPI and GPIO drivers are up
+ * */
+static int dw1000_init(struct device *dev)
+{
+#ifdef CONFIG_DW1000_TRACE
+    deca_trace_init();
+#endif
+
+    k_thread_create(&dw1000_init_thread, dw1000_init_stack,
+                    K_THREAD_STACK_SIZEOF(dw1000_init_stack),
+                    dw1000_bringup, NULL, NULL, NULL,
+                    K_PRIO_PREEMPT(CONFIG_DW1000_INIT_THREAD_PRIO), 0, K_NO_WAIT);
+
+    return 0;
+}
+
+DEVICE_AND_API_INIT(dw1000, DT_DECAWAVE_DW1000_0_LABEL, dw1000_init, NULL, NULL,
+                    POST_KERNEL, CONFIG_DW1000_INIT_PRIORITY, &dw1000_api);
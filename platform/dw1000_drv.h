@@ -0,0 +1,49 @@
+/*! ----------------------------------------------------------------------------
+ * @file    dw1000_drv.h
+ * @brief   Zephyr device driver binding of the DW1000 (CONFIG_DW1000)
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DW1000_DRV_H_
+#define _DW1000_DRV_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DW1000_WAIT_FOREVER     (-1)
+
+/* Device API, the device is bound from the devicetree node label */
+struct dw1000_driver_api
+{
+    int (*wait_ready)(int32_t timeout);
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw1000_wait_ready()
+ *
+ * @brief Block until the boot time bring-up of the DW1000 (reset, dwt_initialise and switch to the fast SPI rate)
+ * has completed. Can be called from any number of threads, also once the bring-up is long done.
+ *
+ * input parameters
+ * @param timeout - in ms, DW1000_WAIT_FOREVER to wait without limit
+ *
+ * output parameters
+ *
+ * returns 0 if the DW1000 is initialised, or -1 if the initialisation failed or the timeout expired
+ */
+int dw1000_wait_ready(int32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DW1000_DRV_H_ */
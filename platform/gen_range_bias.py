@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+#
+# Generate deca_range_bias.h from the range bias correction tables of deca_range_tables.c.
+#
+# The Decawave tables give, for each centimetre of correction, the largest range (in 25 cm units) it applies to, and
+# are searched linearly. The generated tables are inverted: indexed directly by the range in 25 cm units (0..255),
+# they hold the correction in centimetres. Run it again after changing deca_range_tables.c:
+#
+#   python3 platform/gen_range_bias.py
+#
+
+import os
+import re
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, 'deca_range_tables.c')
+DST = os.path.join(HERE, 'deca_range_bias.h')
+
+# (table, correction offset macro, channels in table order)
+TABLES = [
+    ('range25cm16PRFnb', 'CM_OFFSET_16M_NB', (1, 2, 3, 5)),
+    ('range25cm16PRFwb', 'CM_OFFSET_16M_WB', (4, 7)),
+    ('range25cm64PRFnb', 'CM_OFFSET_64M_NB', (1, 2, 3, 5)),
+    ('range25cm64PRFwb', 'CM_OFFSET_64M_WB', (4, 7)),
+]
+
+
+def parse(src):
+    offsets = {m.group(1): int(m.group(2)) for m in re.finditer(r'#define\s+(CM_OFFSET_\w+)\s+\((-?\d+)\)', src)}
+    tables = {}
+    for name, _, chans in TABLES:
+        body = re.search(r'const uint8 ' + name + r'\[\d+\]\[\w+\] =\s*\{(.*?)\}; // end', src, re.S).group(1)
+        rows = [[int(v) for v in re.findall(r'\d+', re.sub(r'//.*', '', row))]
+                for row in re.findall(r'\{([^{}]*)\}', body)]
+        assert len(rows) == len(chans), name
+        for row in rows:
+            assert row[-1] == 255, name + ' must end in 255'
+        tables[name] = rows
+    return offsets, tables
+
+
+def invert(row, offset):
+    out = []
+    for r in range(256):
+        i = 0
+        while r > row[i]:
+            i += 1
+        out.append(i + offset)
+    return out
+
+
+def main():
+    with open(SRC) as f:
+        offsets, tables = parse(f.read())
+
+    lines = []
+    lines.append('/*! ----------------------------------------------------------------------------')
+    lines.append(' *  @file    deca_range_bias.h')
+    lines.append(' *  @brief   DW1000 range bias correction, direct index tables')
+    lines.append(' *')
+    lines.append(' *           Generated by gen_range_bias.py from deca_range_tables.c, do not edit.')
+    lines.append(' *           range_bias_cm[table][range in 25 cm units] = correction in centimetres')
+    lines.append(' *')
+    lines.append(' * @attention')
+    lines.append(' *')
+    lines.append(' * Copyright 2015 (c) DecaWave Ltd, Dublin, Ireland.')
+    lines.append(' *')
+    lines.append(' * All rights reserved.')
+    lines.append(' *')
+    lines.append(' */')
+    lines.append('')
+    lines.append('#ifndef _DECA_RANGE_BIAS_H_')
+    lines.append('#define _DECA_RANGE_BIAS_H_')
+    lines.append('')
+    lines.append('#include "deca_types.h"')
+    lines.append('')
+    lines.append('// Table order: 16 MHz PRF narrow band ch 1, 2, 3, 5, wide band ch 4, 7, then the same at 64 MHz PRF')
+    lines.append('#define RANGE_BIAS_TBL_64M       6')
+    lines.append('#define RANGE_BIAS_TBL_WB        4')
+    lines.append('')
+    lines.append('// RANGE_BIAS_ONLY, when defined before including this file, keeps that table only, as range_bias_cm[0]')
+    lines.append('#ifdef RANGE_BIAS_ONLY')
+    lines.append('#define RANGE_BIAS_TBL_NUM       1')
+    lines.append('#define RANGE_BIAS_TBL(tbl)      ((tbl) == RANGE_BIAS_ONLY)')
+    lines.append('#else')
+    lines.append('#define RANGE_BIAS_TBL_NUM       %d' % sum(len(chans) for _, _, chans in TABLES))
+    lines.append('#define RANGE_BIAS_TBL(tbl)      1')
+    lines.append('#endif')
+    lines.append('')
+    lines.append('static const int8 range_bias_cm[RANGE_BIAS_TBL_NUM][256] =')
+    lines.append('{')
+    tbl = 0
+    for name, off, chans in TABLES:
+        for chan, row in zip(chans, tables[name]):
+            vals = invert(row, offsets[off])
+            assert all(-128 <= v <= 127 for v in vals)
+            lines.append('#if RANGE_BIAS_TBL(%d)' % tbl)
+            lines.append('    // ch %d - %s' % (chan, name))
+            lines.append('    {')
+            for k in range(0, 256, 16):
+                lines.append('        ' + ', '.join('%3d' % v for v in vals[k:k + 16]) + ',')
+            lines[-1] = lines[-1].rstrip(',')
+            lines.append('    },')
+            lines.append('#endif')
+            tbl += 1
+    lines.append('};')
+    lines.append('')
+    lines.append('#endif /* _DECA_RANGE_BIAS_H_ */')
+
+    with open(DST, 'w', newline='\n') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -16,6 +16,7 @@
 #include "port.h"
 #include "deca_device_api.h"
 #include "deca_spi.h"
+#include "deca_trace.h"
 
 //zephyr includes
 #include <errno.h>
@@ -24,15 +25,38 @@
 #include <device.h>
 #include <soc.h>
 #include <hal/nrf_gpiote.h>
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_power.h>
 #include <gpio.h>
 #include <kernel_internal.h>
 #include <arch/arm/cortex_m/cmsis.h>
 #include <cortex_m/stack.h>
 
 struct device *gpio_dev;
-static struct gpio_callback gpio_cb;
 
+#ifdef DT_DECAWAVE_DW1000_0_IRQ_GPIOS_PIN
+#define PIN     DT_DECAWAVE_DW1000_0_IRQ_GPIOS_PIN /* devicetree irq-gpios */
+#else
 #define PIN     19 /* DW Irq pin */
+#endif
+
+#if DWT_NUM_DW_DEV > 2
+#error "port.c describes at most two DW1000 devices"
+#endif
+
+#if DWT_NUM_DW_DEV > 1
+#if !defined(DW1000_1_IRQ) || !defined(DW1000_1_RSTn) || !defined(DW1000_1_CSn)
+#error "DW1000_1_IRQ, DW1000_1_RSTn and DW1000_1_CSn must be defined for DWT_NUM_DW_DEV > 1"
+#endif
+#endif
+
+/* DW1000 IRQ deferred processing: the GPIO callback only queues work, the
+ * installed handler (which talks SPI) runs on this queue in thread context */
+#define DECA_IRQ_STACK_SIZE     1024
+#define DECA_IRQ_PRIO           K_PRIO_COOP(1)
+
+K_THREAD_STACK_DEFINE(deca_irq_stack, DECA_IRQ_STACK_SIZE);
+static struct k_work_q deca_irq_wq;
 
 /****************************************************************************//**
  *
@@ -47,6 +71,38 @@ static struct gpio_callback gpio_cb;
  *******************************************************************************/
 static volatile uint32_t signalResetDone;
 
+/* Pins and IRQ bindings of one DW1000 */
+typedef struct
+{
+    uint32_t irq_pin;
+    uint32_t rstn_pin;
+    uint32_t csn_pin;
+    port_deca_isr_t isr;            // DW1000 IRQ handler
+    struct gpio_callback gpio_cb;
+    struct k_work work;
+    struct k_sem sem;               // given once the handler has run
+    uint32_t gpiote_mask;           // GPIOTE IN channel interrupt mask the GPIO driver assigned to the IRQ pin
+    bool ready;
+} port_dw_dev_t;
+
+static port_dw_dev_t port_dw_dev[DWT_NUM_DW_DEV] = {
+    [0] = { .irq_pin = PIN, .rstn_pin = DW1000_RSTn, .csn_pin = DW1000_CSn },
+#if DWT_NUM_DW_DEV > 1
+    [1] = { .irq_pin = DW1000_1_IRQ, .rstn_pin = DW1000_1_RSTn, .csn_pin = DW1000_1_CSn },
+#endif
+};
+
+/* Device the calling thread is bound to */
+#if DWT_NUM_DW_DEV > 1
+#define PORT_DEV()      (&port_dw_dev[deca_getdevice()])
+#else
+#define PORT_DEV()      (&port_dw_dev[0])
+#endif
+
+#ifndef CONFIG_THREAD_CUSTOM_DATA
+static unsigned int deca_device;
+#endif
+
 /****************************************************************************//**
  *
  *                              Time section
@@ -57,32 +113,23 @@ static volatile uint32_t signalResetDone;
  * @brief wrapper for to read a SysTickTimer, which is incremented with
  *        CLOCKS_PER_SEC frequency.
  *        The resolution of time32_incr is usually 1/1000 sec.
+ *        Backed by the kernel uptime, in ms.
  * */
 unsigned long
 portGetTickCnt(void)
 {
-    //TODO
-    return 0;
+    return k_uptime_get_32();
 }
 
 
 /* @fn    usleep
  * @brief precise usleep() delay
+ *        busy waits on the kernel cycle counter, so the delay does not
+ *        depend on the optimisation level or the CPU clock
  * */
-#pragma GCC optimize ("O0")
 int usleep(unsigned long usec)
 {
-    int i,j;
-#pragma GCC ivdep
-    for(i=0;i<usec;i++)
-    {
-#pragma GCC ivdep
-        for(j=0;j<2;j++)
-        {
-            // __NOP();
-            // __NOP();
-        }
-    }
+    k_busy_wait(usec);
     return 0;
 }
 
@@ -135,6 +182,33 @@ void spi_peripheral_init()
  *
  *******************************************************************************/
 
+/* @fn      deca_setdevice
+ * @brief   bind the calling thread to a DW1000, the driver, SPI and IRQ
+ *          functions it calls then act on that device.
+ *          With CONFIG_THREAD_CUSTOM_DATA the binding is per thread, else
+ *          a single selection is shared by all threads.
+ * */
+void deca_setdevice(unsigned int index)
+{
+#ifdef CONFIG_THREAD_CUSTOM_DATA
+    k_thread_custom_data_set((void *)(uintptr_t)index);
+#else
+    deca_device = index;
+#endif
+}
+
+/* @fn      deca_getdevice
+ * @brief   returns the DW1000 the calling thread is bound to, 0 by default
+ * */
+unsigned int deca_getdevice(void)
+{
+#ifdef CONFIG_THREAD_CUSTOM_DATA
+    return (unsigned int)(uintptr_t)k_thread_custom_data_get();
+#else
+    return deca_device;
+#endif
+}
+
 /* @fn      reset_DW1000
  * @brief   DW_RESET pin on DW1000 has 2 functions
  *          In general it is output, but it also can be used to reset the digital
@@ -143,8 +217,12 @@ void spi_peripheral_init()
  * */
 void reset_DW1000(void)
 {
-    //TODO:drive the RSTn pin low
- 
+    uint32_t rstn = PORT_DEV()->rstn_pin;
+
+    //drive the RSTn pin low
+    nrf_gpio_pin_clear(rstn);
+    nrf_gpio_cfg_output(rstn);
+
     usleep(1);
 
     //put the pin back to output open-drain (not active)
@@ -160,7 +238,9 @@ void reset_DW1000(void)
  * */
 void setup_DW1000RSTnIRQ(int enable)
 {
-    //TODO
+    // The RSTn edge IRQ is not used on this port: the fast wake up polls the
+    // pin instead, so both modes leave it as a floating input (not driven)
+    nrf_gpio_cfg_input(PORT_DEV()->rstn_pin, NRF_GPIO_PIN_NOPULL);
 }
 
 
@@ -203,20 +283,91 @@ void led_on (led_t led)
 
 /* @fn      port_wakeup_dw1000
  * @brief   "slow" waking up of DW1000 using DW_CS only
+ *          CS is held low long enough to wake the DW1000 up, then a fixed
+ *          time is left for its crystal to start
  * */
 void port_wakeup_dw1000(void)
 {
-    //TODO
+    uint32_t csn = PORT_DEV()->csn_pin;
+
+    nrf_gpio_pin_clear(csn);
+    k_busy_wait(DW1000_WAKEUP_CS_US);
+    nrf_gpio_pin_set(csn);
+
+    Sleep(DW1000_WAKEUP_XTAL_MS);
+}
+
+/* @fn      port_pulse_dw1000_sync
+ * @brief   drives one pulse on the SYNC line of the DW1000, devicetree
+ *          sync-gpios. On a wired installation the line runs to the SYNC
+ *          input of every anchor, see dwt_configextsync().
+ *          returns 0, or -1 when the board has no SYNC line
+ * */
+int port_pulse_dw1000_sync(void)
+{
+#ifdef DW1000_SYNC
+    nrf_gpio_pin_clear(DW1000_SYNC);
+    nrf_gpio_cfg_output(DW1000_SYNC);
+
+    nrf_gpio_pin_set(DW1000_SYNC);
+    k_busy_wait(DW1000_SYNC_PULSE_US);
+    nrf_gpio_pin_clear(DW1000_SYNC);
+
+    return 0;
+#else
+    return -1;
+#endif
 }
 
 /* @fn      port_wakeup_dw1000_fast
  * @brief   waking up of DW1000 using DW_CS and DW_RESET pins.
  *          The DW_RESET signalling that the DW1000 is in the INIT state.
  *          the total fast wakeup takes ~2.2ms and depends on crystal startup time
+ *          CS is released as soon as RSTn goes high instead of after a fixed
+ *          delay. The SPI must be at the slow rate until the PLL has locked.
+ *          returns 0 when the DW1000 is in the INIT state, -1 on timeout
  * */
-void port_wakeup_dw1000_fast(void)
+int port_wakeup_dw1000_fast(void)
 {
-    //TODO
+    uint32_t csn = PORT_DEV()->csn_pin;
+    uint32_t rstn = PORT_DEV()->rstn_pin;
+    uint32_t waited = 0;
+
+    setup_DW1000RSTnIRQ(1);
+
+    nrf_gpio_pin_clear(csn);
+
+    // RSTn is held low by the DW1000 while asleep and released once its XTAL is up
+    while (!nrf_gpio_pin_read(rstn))
+    {
+        if (waited >= DW1000_WAKEUP_TIMEOUT_US)
+        {
+            nrf_gpio_pin_set(csn);
+            return -1;
+        }
+        k_busy_wait(10);
+        waited += 10;
+    }
+
+    // CS must have stayed low at least this long for the wake up to be latched
+    if (waited < DW1000_WAKEUP_CS_US)
+    {
+        k_busy_wait(DW1000_WAKEUP_CS_US - waited);
+    }
+
+    nrf_gpio_pin_set(csn);
+
+    return 0;
+}
+
+/* @fn      port_system_off
+ * @brief   put the nRF52 into System OFF, its lowest power state, until the
+ *          DW1000 IRQ line goes high: the wake up goes through a reset
+ * */
+void port_system_off(void)
+{
+    nrf_gpio_cfg_sense_input(PORT_DEV()->irq_pin, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_SENSE_HIGH);
+    nrf_power_system_off();
 }
 
 
@@ -234,10 +385,18 @@ void port_set_dw1000_slowrate(void)
  * */
 void port_set_dw1000_fastrate(void)
 {
-    //TODO
     set_spi_speed_fast();
 }
 
+/* @fn      port_set_dw1000_maxrate
+ * @brief   set the DW1000 maximum of 20MHz (limited to what the SPIM supports)
+ *          only valid once the DW1000 runs from its PLL
+ * */
+void port_set_dw1000_maxrate(void)
+{
+    set_spi_speed_max();
+}
+
 
 /****************************************************************************//**
  *
@@ -258,39 +417,82 @@ void port_set_dw1000_fastrate(void)
  * @brief   main call-back for processing of DW1000 IRQ
  *          it re-enters the IRQ routing and processes all events.
  *          After processing of all events, DW1000 will clear the IRQ line.
+ *          Acts on the device the calling thread is bound to.
  * */
 void process_deca_irq(void)
 {
-    //TODO
+    port_dw_dev_t *dev = PORT_DEV();
+
+    if (dev->isr == NULL) {
+        return;
+    }
+
+    DECA_TRACE_BEGIN(DECA_TRACE_ISR);
+    do {
+        dev->isr();
+    } while (port_CheckEXT_IRQ() != 0); // while IRQ line active
+    DECA_TRACE_END(DECA_TRACE_ISR);
+
+    k_sem_give(&dev->sem);
 }
 
 
+/* @fn      port_find_gpiote_mask
+ * @brief   look up the GPIOTE IN channel the GPIO driver allocated for
+ *          the DW_IRQ pin when its callback was enabled
+ *          returns the channel interrupt mask, or 0 if none is armed
+ * */
+static uint32_t port_find_gpiote_mask(uint32_t pin)
+{
+    uint32_t ch;
+
+    for (ch = 0; ch < GPIOTE_CH_NUM; ch++)
+    {
+        uint32_t mask = NRF_GPIOTE_INT_IN0_MASK << ch;
+
+        if ((nrf_gpiote_event_pin_get(ch) == pin) && nrf_gpiote_int_is_enabled(mask))
+        {
+            return mask;
+        }
+    }
+    return 0;
+}
+
 /* @fn      port_DisableEXT_IRQ
  * @brief   wrapper to disable DW_IRQ pin IRQ
- *          in current implementation it disables all IRQ from lines 5:9
+ *          in current implementation it masks the GPIOTE channel of the
+ *          DW_IRQ pin only, other GPIO and radio interrupts are not affected.
+ *          An edge seen while masked stays latched and fires on re-enable.
  * */
 void port_DisableEXT_IRQ(void)
 {
-    //TODO
+    nrf_gpiote_int_disable(PORT_DEV()->gpiote_mask);
 }
 
 /* @fn      port_EnableEXT_IRQ
  * @brief   wrapper to enable DW_IRQ pin IRQ
- *          in current implementation it enables all IRQ from lines 5:9
+ *          in current implementation it unmasks the GPIOTE channel of the
+ *          DW_IRQ pin only
  * */
 void port_EnableEXT_IRQ(void)
 {
-    //TODO
+    nrf_gpiote_int_enable(PORT_DEV()->gpiote_mask);
 }
 
 
 /* @fn      port_GetEXT_IRQStatus
  * @brief   wrapper to read a DW_IRQ pin IRQ status
+ *          returns non-zero if the DW_IRQ interrupt is enabled
  * */
 uint32_t port_GetEXT_IRQStatus(void)
 {
-    //TODO
-    return 0;
+    uint32_t mask = PORT_DEV()->gpiote_mask;
+
+    if (mask == 0)
+    {
+        return 0;
+    }
+    return nrf_gpiote_int_is_enabled(mask);
 }
 
 
@@ -299,8 +501,33 @@ uint32_t port_GetEXT_IRQStatus(void)
  * */
 uint32_t port_CheckEXT_IRQ(void)
 {
-    //TODO
-    return 0;
+    u32_t val = 0;
+
+    gpio_pin_read(gpio_dev, PORT_DEV()->irq_pin, &val);
+    return val;
+}
+
+/* @fn      port_wait_deca_irq
+ * @brief   block the calling thread until the DW1000 IRQ has been processed
+ *          by the handler installed with port_set_deca_isr
+ *          timeout in ms, PORT_WAIT_FOREVER to wait without limit
+ *          returns 0 if an IRQ was processed, or -1 on timeout
+ * */
+int port_wait_deca_irq(int32_t timeout)
+{
+    return (k_sem_take(&PORT_DEV()->sem, timeout) == 0) ? 0 : -1;
+}
+
+
+/* @fn      port_submit_deca_work
+ * @brief   run delayed work on the DW1000 IRQ work queue, after delay ms: in
+ *          the same thread as the IRQ handler, so the two never interleave
+ *          their SPI accesses. port_set_deca_isr() must have been called.
+ *          returns 0, or a negative error code from the kernel
+ * */
+int port_submit_deca_work(struct k_delayed_work *work, int32_t delay)
+{
+    return k_delayed_work_submit_to_queue(&deca_irq_wq, work, delay);
 }
 
 
@@ -310,15 +537,42 @@ uint32_t port_CheckEXT_IRQ(void)
  *
  *******************************************************************************/
 
-/* DW1000 IRQ handler definition. */
-// static port_deca_isr_t port_deca_isr = NULL;
+/* @fn      deca_irq_work_handler
+ * @brief   runs the installed DW1000 IRQ handler in thread context,
+ *          bound to the device that raised the IRQ
+ * */
+static void deca_irq_work_handler(struct k_work *item)
+{
+    DECA_TRACE_END(DECA_TRACE_IRQ);
+#if DWT_NUM_DW_DEV > 1
+    port_dw_dev_t *dev = CONTAINER_OF(item, port_dw_dev_t, work);
+
+    deca_setdevice(dev - port_dw_dev);
+#endif
+    process_deca_irq();
+}
+
+/* @fn      deca_irq_gpio_cb
+ * @brief   GPIO callback for the DW IRQ pin, ISR context: defer to the work queue
+ * */
+static void deca_irq_gpio_cb(struct device *port, struct gpio_callback *cb, u32_t pins)
+{
+    port_dw_dev_t *dev = CONTAINER_OF(cb, port_dw_dev_t, gpio_cb);
+
+    DECA_TRACE_BEGIN(DECA_TRACE_IRQ);
+    k_work_submit_to_queue(&deca_irq_wq, &dev->work);
+}
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn port_set_deca_isr()
  *
  * @brief This function is used to install the handling function for DW1000 IRQ.
  *
- * NOTE:
+ * NOTE: the handler is not called from the GPIO interrupt itself but from a
+ *       dedicated high priority work queue, so it may use the SPI (e.g. dwt_isr).
+ *       Use port_wait_deca_irq() to block until it has run.
+ *       The handler is installed for the device the calling thread is bound
+ *       to (see deca_setdevice) and runs bound to that device.
  *
  * @param deca_isr function pointer to DW1000 interrupt handler to install
  *
@@ -326,18 +580,39 @@ uint32_t port_CheckEXT_IRQ(void)
  */
 void port_set_deca_isr(port_deca_isr_t deca_isr)
 {
+	static bool wq_started;
+	port_dw_dev_t *dev = PORT_DEV();
+
 	gpio_dev = device_get_binding(DT_GPIO_P0_DEV_NAME);
 	if (!gpio_dev) {
 		printk("error\n");
 		return;
 	}
 
+	if (!wq_started) {
+		k_work_q_start(&deca_irq_wq, deca_irq_stack,
+			       K_THREAD_STACK_SIZEOF(deca_irq_stack), DECA_IRQ_PRIO);
+		wq_started = true;
+	}
+	if (!dev->ready) {
+		k_work_init(&dev->work, deca_irq_work_handler);
+		k_sem_init(&dev->sem, 0, 1);
+		dev->ready = true;
+	}
+	dev->isr = deca_isr;
+
 	/* Decawave interrupt */
-	gpio_pin_configure(gpio_dev, PIN,
+	gpio_pin_configure(gpio_dev, dev->irq_pin,
 			   GPIO_DIR_IN | GPIO_INT |  GPIO_PUD_PULL_UP | GPIO_INT_EDGE | GPIO_INT_ACTIVE_HIGH );
-	gpio_init_callback(&gpio_cb, (gpio_callback_handler_t)(deca_isr), BIT(PIN));
-	gpio_add_callback(gpio_dev, &gpio_cb);
-	gpio_pin_enable_callback(gpio_dev, PIN);
+	gpio_init_callback(&dev->gpio_cb, deca_irq_gpio_cb, BIT(dev->irq_pin));
+	gpio_add_callback(gpio_dev, &dev->gpio_cb);
+	gpio_pin_enable_callback(gpio_dev, dev->irq_pin);
+
+	/* The channel is only known once the driver has armed the pin */
+	dev->gpiote_mask = port_find_gpiote_mask(dev->irq_pin);
+	if (!dev->gpiote_mask) {
+		printk("DW IRQ: no GPIOTE channel, decamutex is inactive\n");
+	}
 }
 
 
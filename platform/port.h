@@ -23,6 +23,10 @@ extern "C" {
 #include <string.h>
 #include "compiler.h"
 
+#ifdef CONFIG_DW1000
+#include <generated_dts_board.h>
+#endif
+
 /* DW1000 IRQ handler declaration. */
 // static port_deca_isr_t port_deca_isr;
 
@@ -43,6 +47,34 @@ typedef void (*port_deca_isr_t)(void);
  */
 void port_set_deca_isr(port_deca_isr_t deca_isr);
 
+#define PORT_WAIT_FOREVER   (-1)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_wait_deca_irq()
+ *
+ * @brief This function blocks the calling thread until the DW1000 IRQ handler installed with port_set_deca_isr() has run.
+ *
+ * @param timeout time to wait in ms, or PORT_WAIT_FOREVER
+ *
+ * @return 0 if an IRQ has been processed, -1 on timeout
+ */
+int port_wait_deca_irq(int32_t timeout);
+
+struct k_delayed_work;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn port_submit_deca_work()
+ *
+ * @brief This function runs delayed work on the queue of the DW1000 IRQ handler, so that it never runs concurrently
+ *        with it. port_set_deca_isr() must have been called once before.
+ *
+ * @param work  delayed work item, initialised with k_delayed_work_init()
+ * @param delay delay in ms, 0 to run it as soon as possible
+ *
+ * @return 0 for success, or a negative error code
+ */
+int port_submit_deca_work(struct k_delayed_work *work, int32_t delay);
+
 
 
 /*****************************************************************************************************************//*
@@ -82,9 +114,28 @@ typedef enum
  *
  *******************************************************************************/
 
-//TODO
-#define DW1000_RSTn                 
+#ifdef DT_DECAWAVE_DW1000_0_RESET_GPIOS_PIN
+#define DW1000_RSTn                 DT_DECAWAVE_DW1000_0_RESET_GPIOS_PIN  /* devicetree reset-gpios */
+#else
+#define DW1000_RSTn                 24  /* P0.24 DW_RST */
+#endif
 #define DW1000_RSTn_GPIO            
+#ifdef DT_DECAWAVE_DW1000_0_SYNC_GPIOS_PIN
+#define DW1000_SYNC                 DT_DECAWAVE_DW1000_0_SYNC_GPIOS_PIN   /* devicetree sync-gpios, optional */
+#endif
+#define DW1000_CSn                  17  /* P0.17 SPI1 CS */
+
+/* Second DW1000 on SPI1, only used when DWT_NUM_DW_DEV > 1. Its pins depend
+ * on the carrier board so the build must give them, e.g.
+ * -DDW1000_1_IRQ=<pin> -DDW1000_1_RSTn=<pin> -DDW1000_1_CSn=<pin> */
+
+// Wake up timings (see DW1000 datasheet)
+#define DW1000_WAKEUP_CS_US         500 /* CS low time needed to wake the DW1000 up */
+#define DW1000_WAKEUP_XTAL_MS       5   /* XTAL start up time, used when RSTn can't be monitored */
+#define DW1000_WAKEUP_TIMEOUT_US    5000 /* Give up waiting for RSTn after that */
+
+// SYNC pulse, sampled on the 38.4 MHz reference clock: a few cycles are enough
+#define DW1000_SYNC_PULSE_US        1
 
 
 #define DECAIRQ                     
@@ -132,6 +183,7 @@ typedef enum
 
 void Sleep(uint32_t Delay);
 unsigned long portGetTickCnt(void);
+int usleep(unsigned long usec);
 
 #define S1_SWITCH_ON  (1)
 #define S1_SWITCH_OFF (0)
@@ -140,10 +192,13 @@ int port_is_switch_on(uint16_t GPIOpin);
 int port_is_boot1_low(void);
 
 void port_wakeup_dw1000(void);
-void port_wakeup_dw1000_fast(void);
+int  port_wakeup_dw1000_fast(void);
+int  port_pulse_dw1000_sync(void);
+void port_system_off(void);
 
 void port_set_dw1000_slowrate(void);
 void port_set_dw1000_fastrate(void);
+void port_set_dw1000_maxrate(void);
 
 void process_dwRSTn_irq(void);
 void process_deca_irq(void);
@@ -0,0 +1,151 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_cal.c
+ * @brief   Auto-calibration of the antenna delays and crystal trim against a
+ *          reference responder (CONFIG_DW1000_RANGING_CAL)
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_cal.h"
+#include "rng_tof.h"
+#include "deca_regs.h"
+#include "deca_range_tables.h"
+
+#include <zephyr.h>
+
+typedef struct
+{
+    struct k_sem done;
+    rng_status_t status;
+    int32 distMm;
+    float ppm;
+} rng_cal_local_t;
+
+static rng_cal_local_t cal;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn cal_result_cb()
+ *
+ * @brief Result of one exchange, the report just received gives the clock offset of the reference.
+ */
+static void cal_result_cb(const rng_result_t *result)
+{
+    cal.status = result->status;
+    if (result->status == RNG_OK)
+    {
+        cal.distMm = result->distMm;
+        cal.ppm = rng_peerppm();
+    }
+    k_sem_give(&cal.done);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_cal_run()
+ *
+ * @brief see rng_cal.h
+ */
+int rng_cal_run(const rng_config_t *rngCfg, const dwt_config_t *phy, const rng_cal_config_t *cfg,
+                rng_cal_result_t *res)
+{
+    rng_config_t rc = *rngCfg;
+    int64_t dist_sum, ppb_sum;
+    int32 err_dtu, steps, trim;
+    uint8 trim0 = dwt_getxtaltrim();
+    uint16 ok;
+    int i;
+
+    memset(res, 0, sizeof(*res));
+    res->txAntDly = cfg->txAntDly;
+    res->rxAntDly = cfg->rxAntDly;
+    res->xtalTrim = trim0;
+    k_sem_init(&cal.done, 0, 1);
+    rc.report = 1;
+
+    while (res->passes < cfg->passes)
+    {
+        res->passes++;
+
+        dwt_settxantennadelay(res->txAntDly);
+        dwt_setrxantennadelay(res->rxAntDly);
+        rc.txAntDly = res->txAntDly;
+        if ((rng_init(&rc, cal_result_cb) != DWT_SUCCESS) || (rng_setphy(phy) != DWT_SUCCESS))
+        {
+            break;
+        }
+
+        dist_sum = 0;
+        ppb_sum = 0;
+        ok = 0;
+        for (i = 0; i < cfg->exchanges; i++)
+        {
+            k_sem_reset(&cal.done);
+            if (rng_initiate(cfg->refAddr) != DWT_SUCCESS)
+            {
+                res->failed++;
+                continue;
+            }
+            if (k_sem_take(&cal.done, K_MSEC(cfg->timeoutMs)) != 0)
+            {
+                rng_stop();
+                res->failed++;
+                continue;
+            }
+            if (cal.status != RNG_OK)
+            {
+                res->failed++;
+                continue;
+            }
+            dist_sum += cal.distMm;
+            ppb_sum += (int64_t)(cal.ppm * 1000.0f);
+            ok++;
+        }
+        rng_stop();
+        res->ok += ok;
+        if ((ok == 0) || (ok < cfg->minOk))
+        {
+            break;
+        }
+
+        /* Error of the mean without the range bias of the distance, half the round trip error of this device */
+        res->errMm = (int32)(dist_sum / ok) - (int32)cfg->refDistMm;
+        res->errMm -= 10 * dwt_getrangebias_cm(phy->chan, (int32)(dist_sum / ok), phy->prf);
+        res->offsetPpb = (int32)(ppb_sum / ok);
+        err_dtu = (int32)(((int64_t)res->errMm << 16) / RNG_DTU_TO_MM_Q16);
+        steps = cfg->trimXtal ? (res->offsetPpb + ((res->offsetPpb < 0) ? -RNG_CAL_XTAL_PPB_PER_STEP / 2 :
+                                                   RNG_CAL_XTAL_PPB_PER_STEP / 2)) / RNG_CAL_XTAL_PPB_PER_STEP : 0;
+        /* A positive offset means a slow local crystal, a lower trim raises its frequency */
+        trim = MIN(MAX((int32)res->xtalTrim - steps, 1), FS_XTALT_MASK);
+        /* The mean of a pass is about as noisy as a DTU: only correct a distance error beyond the tolerance */
+        if ((res->errMm <= (int32)cfg->tolMm) && (res->errMm >= -(int32)cfg->tolMm))
+        {
+            err_dtu = 0;
+        }
+        if ((err_dtu == 0) && (trim == res->xtalTrim))
+        {
+            return DWT_SUCCESS;
+        }
+
+        /* A longer distance means larger delays than the ones configured */
+        res->txAntDly = (uint16)(res->txAntDly + err_dtu);
+        res->rxAntDly = (uint16)(res->rxAntDly + err_dtu);
+        if (trim != res->xtalTrim)
+        {
+            res->xtalTrim = (uint8)trim;
+            dwt_setxtaltrim(res->xtalTrim);
+        }
+    }
+
+    /* Too few exchanges, or no convergence: back to the starting values */
+    dwt_settxantennadelay(cfg->txAntDly);
+    dwt_setrxantennadelay(cfg->rxAntDly);
+    dwt_setxtaltrim(trim0);
+
+    return DWT_ERROR;
+}
@@ -0,0 +1,111 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_cal.h
+ * @brief   Auto-calibration of the antenna delays and crystal trim against a
+ *          reference responder (CONFIG_DW1000_RANGING_CAL)
+ *
+ *          The device ranges with a calibrated reference set at a known
+ *          distance, the reference running the responder of rng_twr.h with
+ *          the report on. Each pass averages a number of DS-TWR exchanges:
+ *          - the distance error puts the antenna delays right: half the
+ *            round trip error of this device, split evenly between TX and
+ *            RX;
+ *          - the carrier integrator of the reports gives the offset of the
+ *            local crystal against the reference, rng_peerppm(), corrected
+ *            with the FS_XTALT trim in steps of about 1.5 ppm.
+ *
+ *          The range bias of the reference distance (dwt_getrangebias_cm())
+ *          is taken out of the mean first, so that the antenna delays do not
+ *          absorb it and the per-link correction stays the table lookup.
+ *          The passes stop once the distance error is within tolMm and the
+ *          crystal offset within a trim step, a distance error within tolMm
+ *          is left alone: the mean of a pass is about that noisy. The
+ *          result goes to deca_cal_save() to be applied at the next boots.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_CAL_H_
+#define _RNG_CAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "rng_twr.h"
+
+// Crystal frequency change per FS_XTALT step, a higher trim lowers the frequency
+#define RNG_CAL_XTAL_PPB_PER_STEP   1500
+
+typedef struct
+{
+    uint16 refAddr;                     // short address of the reference responder
+    uint32 refDistMm;                   // true distance to it, antenna to antenna
+    uint16 txAntDly;                    // antenna delays to start from
+    uint16 rxAntDly;
+    uint8 trimXtal;                     // trim the crystal on the reference, the reference must be trimmed itself
+    uint8 exchanges;                    // exchanges per pass
+    uint8 minOk;                        // exchanges needed per pass
+    uint8 passes;                       // largest number of passes
+    uint16 tolMm;                       // distance error of the mean accepted without correction
+    uint16 timeoutMs;                   // per exchange
+} rng_cal_config_t;
+
+#define RNG_CAL_CONFIG_DEFAULT(ref_addr, dist_mm) { \
+    .refAddr = (ref_addr),              \
+    .refDistMm = (dist_mm),             \
+    .txAntDly = 16436,                  \
+    .rxAntDly = 16436,                  \
+    .trimXtal = 1,                      \
+    .exchanges = 50,                    \
+    .minOk = 25,                        \
+    .passes = 4,                        \
+    .tolMm = 10,                        \
+    .timeoutMs = 100,                   \
+}
+
+typedef struct
+{
+    uint16 txAntDly;                    // antenna delays found, device time units
+    uint16 rxAntDly;
+    uint8 xtalTrim;                     // FS_XTALT value in use
+    int32 errMm;                        // mean distance error of the last pass
+    int32 offsetPpb;                    // mean crystal offset against the reference in the last pass
+    uint8 passes;                       // passes run
+    uint16 ok;                          // exchanges completed, all passes
+    uint16 failed;
+} rng_cal_result_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_cal_run()
+ *
+ * @brief Run the calibration, blocking. The engine is taken over with the ranging configuration given (the report is
+ *        forced on, the antenna delays come from the calibration) and stopped at the end: call rng_init() again to
+ *        range. On success the DW1000 keeps the antenna delays and crystal trim found and the result can be stored,
+ *        deca_cal_t with the channel and PRF of phy; on failure it gets the starting values back.
+ *
+ * input parameters
+ * @param rngCfg - ranging configuration of this device as initiator
+ * @param phy    - DW1000 configuration given to dwt_configure()
+ * @param cfg    - reference and passes
+ *
+ * output parameters
+ * @param res    - values found and residuals
+ *
+ * returns DWT_SUCCESS if the distance error is within tolMm and the crystal offset within a step, or DWT_ERROR if a
+ * pass had too few exchanges or the passes ran out
+ */
+int rng_cal_run(const rng_config_t *rngCfg, const dwt_config_t *phy, const rng_cal_config_t *cfg,
+                rng_cal_result_t *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_CAL_H_ */
@@ -0,0 +1,863 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_ctl.c
+ * @brief   Runtime settings of the ranging engine, the radio configuration and
+ *          the application, changed live from the shell or BLE
+ *          (CONFIG_DW1000_RANGING_CTL)
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rng_ctl.h"
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+#ifdef CONFIG_DW1000_RANGING_SHELL
+#include <errno.h>
+#include <shell/shell.h>
+#endif
+
+// Longest interval accepted, ms
+#define CTL_INTERVAL_MAX    3600000
+
+// Prefix of a short address given as two characters, other addresses are hexadecimal
+#define CTL_ADDR_CHARS      "c:"
+
+/* A rng_config_t field */
+typedef struct
+{
+    const char *name;
+    uint8 off;
+    uint8 size;                         // 1 or 2 bytes
+    uint16 max;
+} ctl_param_t;
+
+#define CTL_RNG(field, hi)  { #field, offsetof(rng_config_t, field), sizeof(((rng_config_t *)0)->field), (hi) }
+
+static const ctl_param_t ctl_rng_params[] = {
+    CTL_RNG(panId, 0xFFFF),
+    CTL_RNG(addr, 0xFFFF),
+    CTL_RNG(filter, 1),
+    CTL_RNG(txAntDly, 0xFFFF),
+    CTL_RNG(pollTxToRespRxDlyUus, 0xFFFF),
+    CTL_RNG(respRxToFinalTxDlyUus, 0xFFFF),
+    CTL_RNG(respRxTimeoutUus, 0xFFFF),
+    CTL_RNG(pollRxToRespTxDlyUus, 0xFFFF),
+    CTL_RNG(respTxToFinalRxDlyUus, 0xFFFF),
+    CTL_RNG(finalRxTimeoutUus, 0xFFFF),
+    CTL_RNG(report, 1),
+    CTL_RNG(reportRxTimeoutUus, 0xFFFF),
+    CTL_RNG(bcastSlotUus, 0xFFFF),
+    CTL_RNG(ssPollTxToRespRxDlyUus, 0xFFFF),
+    CTL_RNG(ssRespRxTimeoutUus, 0xFFFF),
+    CTL_RNG(ssPollRxToRespTxDlyUus, 0xFFFF),
+    CTL_RNG(adapt, 1),
+    CTL_RNG(adaptMarginUus, 0xFFFF),
+    CTL_RNG(adaptAirUus, 0xFFFF),
+    CTL_RNG(rxQual, 1),
+    CTL_RNG(autoTimeouts, 1),
+    CTL_RNG(autoGuardUus, 0xFFFF),
+};
+#define CTL_RNG_PARAMS      (sizeof(ctl_rng_params) / sizeof(ctl_rng_params[0]))
+
+/* dwt_config_t fields, in the units of the commands */
+typedef enum
+{
+    CTL_PHY_CHAN,
+    CTL_PHY_PRF,
+    CTL_PHY_PLEN,
+    CTL_PHY_PAC,
+    CTL_PHY_TXCODE,
+    CTL_PHY_RXCODE,
+    CTL_PHY_NSSFD,
+    CTL_PHY_RATE,
+    CTL_PHY_PHR,
+    CTL_PHY_SFDTO,
+    CTL_PHY_CODE,                       // txCode and rxCode, not shown
+    CTL_PHY_PARAMS
+} ctl_phy_id_t;
+
+static const char * const ctl_phy_names[CTL_PHY_PARAMS] = {
+    "chan", "prf", "plen", "pac", "txCode", "rxCode", "nsSFD", "rate", "phr", "sfdTO", "code"
+};
+
+/* Command value to register code */
+typedef struct
+{
+    uint16 value;
+    uint8 code;
+} ctl_map_t;
+
+static const ctl_map_t ctl_prf_map[] = {
+    { 16, DWT_PRF_16M }, { 64, DWT_PRF_64M },
+};
+/* Preamble lengths, in symbols from dwt_getpreamblesyms() */
+static const uint8 ctl_plen_codes[] = {
+    DWT_PLEN_64, DWT_PLEN_128, DWT_PLEN_256, DWT_PLEN_512, DWT_PLEN_1024, DWT_PLEN_1536, DWT_PLEN_2048, DWT_PLEN_4096,
+};
+static const ctl_map_t ctl_pac_map[] = {
+    { 8, DWT_PAC8 }, { 16, DWT_PAC16 }, { 32, DWT_PAC32 }, { 64, DWT_PAC64 },
+};
+static const ctl_map_t ctl_rate_map[] = {
+    { 110, DWT_BR_110K }, { 850, DWT_BR_850K }, { 6800, DWT_BR_6M8 },
+};
+static const ctl_map_t ctl_phr_map[] = {
+    { 0, DWT_PHRMODE_STD }, { 1, DWT_PHRMODE_EXT },
+};
+#define CTL_MAP(m)          (m), (sizeof(m) / sizeof((m)[0]))
+
+typedef struct
+{
+    rng_ctl_config_t cfg;
+    uint8 dirty;                        // pending differs from cur, or may
+    rng_ctl_settings_t cur;
+    rng_ctl_settings_t pending;
+} rng_ctl_local_t;
+
+static rng_ctl_local_t ctl;
+
+/* Commands of the shell and of BLE, one at a time */
+static K_MUTEX_DEFINE(ctl_lock);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_print()
+ *
+ * @brief Format an answer line.
+ */
+static void ctl_print(rng_ctl_out_t out, void *ctx, const char *fmt, ...)
+{
+    char line[RNG_CTL_LINE_LEN];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintk(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    out(ctx, line);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_map() / ctl_unmap()
+ *
+ * @brief Register code of a command value, and back.
+ */
+static int ctl_map(const ctl_map_t *map, int cnt, uint32 value, uint8 *code)
+{
+    int i;
+
+    for (i = 0; i < cnt; i++)
+    {
+        if (map[i].value == value)
+        {
+            *code = map[i].code;
+            return DWT_SUCCESS;
+        }
+    }
+    return DWT_ERROR;
+}
+
+static uint32 ctl_unmap(const ctl_map_t *map, int cnt, uint8 code)
+{
+    int i;
+
+    for (i = 0; i < cnt; i++)
+    {
+        if (map[i].code == code)
+        {
+            return map[i].value;
+        }
+    }
+    return code;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_getphy() / ctl_setphy()
+ *
+ * @brief Radio setting in the units of the commands.
+ */
+static uint32 ctl_getphy(const dwt_config_t *phy, int id)
+{
+    switch (id)
+    {
+    case CTL_PHY_CHAN:   return phy->chan;
+    case CTL_PHY_PRF:    return ctl_unmap(CTL_MAP(ctl_prf_map), phy->prf);
+    case CTL_PHY_PLEN:   return dwt_getpreamblesyms(phy->txPreambLength);
+    case CTL_PHY_PAC:    return ctl_unmap(CTL_MAP(ctl_pac_map), phy->rxPAC);
+    case CTL_PHY_TXCODE: return phy->txCode;
+    case CTL_PHY_RXCODE: return phy->rxCode;
+    case CTL_PHY_NSSFD:  return phy->nsSFD;
+    case CTL_PHY_RATE:   return ctl_unmap(CTL_MAP(ctl_rate_map), phy->dataRate);
+    case CTL_PHY_PHR:    return ctl_unmap(CTL_MAP(ctl_phr_map), phy->phrMode);
+    default:             return phy->sfdTO;
+    }
+}
+
+static int ctl_setphy(dwt_config_t *phy, int id, uint32 v)
+{
+    int i;
+
+    switch (id)
+    {
+    case CTL_PHY_CHAN:
+        if ((v < 1) || (v > 7) || (v == 6))
+        {
+            return DWT_ERROR;
+        }
+        phy->chan = (uint8)v;
+        return DWT_SUCCESS;
+    case CTL_PHY_PRF:
+        return ctl_map(CTL_MAP(ctl_prf_map), v, &phy->prf);
+    case CTL_PHY_PLEN:
+        for (i = 0; i < (int)sizeof(ctl_plen_codes); i++)
+        {
+            if (dwt_getpreamblesyms(ctl_plen_codes[i]) == v)
+            {
+                phy->txPreambLength = ctl_plen_codes[i];
+                return DWT_SUCCESS;
+            }
+        }
+        return DWT_ERROR;
+    case CTL_PHY_PAC:
+        return ctl_map(CTL_MAP(ctl_pac_map), v, &phy->rxPAC);
+    case CTL_PHY_TXCODE:
+    case CTL_PHY_RXCODE:
+    case CTL_PHY_CODE:
+        if ((v < 1) || (v > 24))
+        {
+            return DWT_ERROR;
+        }
+        if (id != CTL_PHY_RXCODE)
+        {
+            phy->txCode = (uint8)v;
+        }
+        if (id != CTL_PHY_TXCODE)
+        {
+            phy->rxCode = (uint8)v;
+        }
+        return DWT_SUCCESS;
+    case CTL_PHY_NSSFD:
+        if (v > 1)
+        {
+            return DWT_ERROR;
+        }
+        phy->nsSFD = (uint8)v;
+        return DWT_SUCCESS;
+    case CTL_PHY_RATE:
+        return ctl_map(CTL_MAP(ctl_rate_map), v, &phy->dataRate);
+    case CTL_PHY_PHR:
+        return ctl_map(CTL_MAP(ctl_phr_map), v, &phy->phrMode);
+    default:
+        if ((v < 1) || (v > 4096 + 64 + 1))
+        {
+            return DWT_ERROR;
+        }
+        phy->sfdTO = (uint16)v;
+        return DWT_SUCCESS;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_sfdto()
+ *
+ * @brief SFD timeout of a configuration: preamble length + 1 + SFD length - PAC size.
+ */
+static uint16 ctl_sfdto(const dwt_config_t *phy)
+{
+    uint32 sfd_len;
+
+    if (phy->dataRate == DWT_BR_110K)
+    {
+        sfd_len = 64;
+    }
+    else
+    {
+        sfd_len = (phy->nsSFD && (phy->dataRate == DWT_BR_850K)) ? 16 : 8;
+    }
+
+    return (uint16)(ctl_getphy(phy, CTL_PHY_PLEN) + 1 + sfd_len - ctl_getphy(phy, CTL_PHY_PAC));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_findrng() / ctl_findphy() / ctl_findvar()
+ *
+ * @brief Index of a setting by name, -1 if there is none.
+ */
+static int ctl_findrng(const char *name)
+{
+    int i;
+
+    for (i = 0; i < CTL_RNG_PARAMS; i++)
+    {
+        if (!strcmp(ctl_rng_params[i].name, name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int ctl_findphy(const char *name)
+{
+    int i;
+
+    for (i = 0; i < CTL_PHY_PARAMS; i++)
+    {
+        if (!strcmp(ctl_phy_names[i], name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int ctl_findvar(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ctl.cfg.varCnt; i++)
+    {
+        if (!strcmp(ctl.cfg.vars[i].name, name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_getrng() / ctl_setrng()
+ *
+ * @brief Access a rng_config_t field of the table.
+ */
+static uint32 ctl_getrng(const rng_config_t *rng, const ctl_param_t *p)
+{
+    const uint8 *f = (const uint8 *)rng + p->off;
+    uint16 v16;
+
+    if (p->size == 1)
+    {
+        return *f;
+    }
+    memcpy(&v16, f, sizeof(v16));
+    return v16;
+}
+
+static void ctl_setrng(rng_config_t *rng, const ctl_param_t *p, uint32 v)
+{
+    uint8 *f = (uint8 *)rng + p->off;
+    uint16 v16 = (uint16)v;
+
+    if (p->size == 1)
+    {
+        *f = (uint8)v;
+    }
+    else
+    {
+        memcpy(f, &v16, sizeof(v16));
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_number()
+ *
+ * @brief Parse a whole decimal or 0x hexadecimal number.
+ */
+static int ctl_number(const char *s, uint32 *v)
+{
+    char *end;
+
+    *v = strtoul(s, &end, 0);
+    return ((*s != '\0') && (*end == '\0')) ? DWT_SUCCESS : DWT_ERROR;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_addr()
+ *
+ * @brief Parse a short address: hexadecimal, or c: and two characters as RNG_ADDR(), "c:WA" for 0x4157.
+ */
+static int ctl_addr(const char *s, uint16 *addr)
+{
+    char *end;
+    uint32 v;
+
+    if (!strncmp(s, CTL_ADDR_CHARS, sizeof(CTL_ADDR_CHARS) - 1))
+    {
+        s += sizeof(CTL_ADDR_CHARS) - 1;
+        if (strlen(s) != 2)
+        {
+            return DWT_ERROR;
+        }
+        *addr = RNG_ADDR(s[0], s[1]);
+        return DWT_SUCCESS;
+    }
+    v = strtoul(s, &end, 16);
+    if ((*s == '\0') || (*end != '\0') || (v > 0xFFFF))
+    {
+        return DWT_ERROR;
+    }
+    *addr = (uint16)v;
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_checkphy()
+ *
+ * @brief Reason a radio configuration cannot be used, NULL if it can.
+ */
+static const char *ctl_checkphy(const dwt_config_t *phy)
+{
+#ifdef DWT_FIXED_CHAN
+    if ((phy->chan != DWT_FIXED_CHAN) || (phy->prf != DWT_FIXED_PRF) || (phy->dataRate != DWT_FIXED_BR))
+    {
+        return "fixed chan, prf and rate build";
+    }
+#endif
+    if (ctl_getphy(phy, CTL_PHY_PAC) >= ctl_getphy(phy, CTL_PHY_PLEN))
+    {
+        return "pac not below plen";
+    }
+    return NULL;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_peek() / ctl_put()
+ *
+ * @brief Copy the pending settings out and back, against rng_ctl_apply().
+ */
+static void ctl_peek(rng_ctl_settings_t *s, uint8 *dirty)
+{
+    unsigned int key = irq_lock();
+
+    *s = ctl.pending;
+    if (dirty != NULL)
+    {
+        *dirty = ctl.dirty;
+    }
+    irq_unlock(key);
+}
+
+static void ctl_put(const rng_ctl_settings_t *s)
+{
+    unsigned int key = irq_lock();
+
+    ctl.pending = *s;
+    ctl.dirty = 1;
+    irq_unlock(key);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_show()
+ *
+ * @brief show command.
+ */
+static int ctl_show(rng_ctl_out_t out, void *ctx)
+{
+    rng_ctl_settings_t s;
+    uint8 dirty;
+    int i;
+
+    ctl_peek(&s, &dirty);
+
+    ctl_print(out, ctx, "interval %u", s.intervalMs);
+    for (i = 0; i < s.peerCnt; i++)
+    {
+        ctl_print(out, ctx, "peer %04x", s.peers[i]);
+    }
+    if (ctl.cfg.cb != NULL)
+    {
+        for (i = 0; i < CTL_RNG_PARAMS; i++)
+        {
+            ctl_print(out, ctx, "%s %u", ctl_rng_params[i].name, ctl_getrng(&s.rng, &ctl_rng_params[i]));
+        }
+        for (i = 0; i < CTL_PHY_CODE; i++)
+        {
+            ctl_print(out, ctx, "%s %u", ctl_phy_names[i], ctl_getphy(&s.phy, i));
+        }
+    }
+    for (i = 0; i < ctl.cfg.varCnt; i++)
+    {
+        ctl_print(out, ctx, "%s %u", ctl.cfg.vars[i].name, s.vars[i]);
+    }
+    if (dirty)
+    {
+        ctl_print(out, ctx, "pending");
+    }
+    ctl_print(out, ctx, "ok");
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_set()
+ *
+ * @brief set command: every change checked on a copy of the pending settings, which then replaces them.
+ */
+static int ctl_set(int argc, char **argv, rng_ctl_out_t out, void *ctx)
+{
+    rng_ctl_settings_t s;
+    uint8 sfd_dirty = 0, sfd_set = 0;
+    const char *why;
+    uint32 v;
+    int i, k;
+
+    if ((argc < 3) || !(argc & 1))
+    {
+        ctl_print(out, ctx, "err usage: set <name> <value>...");
+        return DWT_ERROR;
+    }
+
+    ctl_peek(&s, NULL);
+    for (i = 1; i < argc; i += 2)
+    {
+        const char *name = argv[i];
+
+        if (ctl_number(argv[i + 1], &v) != DWT_SUCCESS)
+        {
+            ctl_print(out, ctx, "err bad value %s", argv[i + 1]);
+            return DWT_ERROR;
+        }
+
+        if (!strcmp(name, "interval"))
+        {
+            if (v > CTL_INTERVAL_MAX)
+            {
+                ctl_print(out, ctx, "err interval above %u", CTL_INTERVAL_MAX);
+                return DWT_ERROR;
+            }
+            s.intervalMs = v;
+        }
+        else if ((k = ctl_findvar(name)) >= 0)
+        {
+            if ((v < ctl.cfg.vars[k].min) || (v > ctl.cfg.vars[k].max))
+            {
+                ctl_print(out, ctx, "err %s out of %u..%u", name, ctl.cfg.vars[k].min, ctl.cfg.vars[k].max);
+                return DWT_ERROR;
+            }
+            s.vars[k] = v;
+        }
+        else if ((k = ctl_findrng(name)) >= 0)
+        {
+            if (ctl.cfg.cb == NULL)
+            {
+                ctl_print(out, ctx, "err engine not controlled");
+                return DWT_ERROR;
+            }
+            if (v > ctl_rng_params[k].max)
+            {
+                ctl_print(out, ctx, "err %s above %u", name, ctl_rng_params[k].max);
+                return DWT_ERROR;
+            }
+            ctl_setrng(&s.rng, &ctl_rng_params[k], v);
+        }
+        else if ((k = ctl_findphy(name)) >= 0)
+        {
+            if (ctl.cfg.cb == NULL)
+            {
+                ctl_print(out, ctx, "err engine not controlled");
+                return DWT_ERROR;
+            }
+            if (ctl_setphy(&s.phy, k, v) != DWT_SUCCESS)
+            {
+                ctl_print(out, ctx, "err bad %s %u", name, v);
+                return DWT_ERROR;
+            }
+            sfd_set |= (k == CTL_PHY_SFDTO);
+            sfd_dirty |= ((k == CTL_PHY_PLEN) || (k == CTL_PHY_PAC) || (k == CTL_PHY_RATE) || (k == CTL_PHY_NSSFD));
+        }
+        else
+        {
+            ctl_print(out, ctx, "err unknown %s", name);
+            return DWT_ERROR;
+        }
+    }
+
+    if (sfd_dirty && !sfd_set)
+    {
+        s.phy.sfdTO = ctl_sfdto(&s.phy);
+    }
+    why = ctl_checkphy(&s.phy);
+    if (why != NULL)
+    {
+        ctl_print(out, ctx, "err %s", why);
+        return DWT_ERROR;
+    }
+
+    ctl_put(&s);
+    ctl_print(out, ctx, "ok");
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_peers()
+ *
+ * @brief peers command.
+ */
+static int ctl_peers(int argc, char **argv, rng_ctl_out_t out, void *ctx)
+{
+    rng_ctl_settings_t s;
+    int i;
+
+    ctl_peek(&s, NULL);
+    if (argc == 1)
+    {
+        for (i = 0; i < s.peerCnt; i++)
+        {
+            ctl_print(out, ctx, "peer %04x", s.peers[i]);
+        }
+        ctl_print(out, ctx, "ok");
+        return DWT_SUCCESS;
+    }
+
+    if (argc - 1 > RNG_CTL_MAX_PEERS)
+    {
+        ctl_print(out, ctx, "err more than %u peers", RNG_CTL_MAX_PEERS);
+        return DWT_ERROR;
+    }
+    for (i = 1; i < argc; i++)
+    {
+        if (ctl_addr(argv[i], &s.peers[i - 1]) != DWT_SUCCESS)
+        {
+            ctl_print(out, ctx, "err bad address %s", argv[i]);
+            return DWT_ERROR;
+        }
+    }
+    s.peerCnt = (uint8)(argc - 1);
+
+    ctl_put(&s);
+    ctl_print(out, ctx, "ok");
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_init()
+ *
+ * @brief see rng_ctl.h
+ */
+int rng_ctl_init(const rng_ctl_config_t *config, const rng_ctl_settings_t *settings)
+{
+    unsigned int key;
+
+    if ((config->varCnt > RNG_CTL_MAX_VARS) || (settings->peerCnt > RNG_CTL_MAX_PEERS))
+    {
+        return DWT_ERROR;
+    }
+
+    key = irq_lock();
+    ctl.cfg = *config;
+    ctl.cur = *settings;
+    ctl.pending = *settings;
+    ctl.dirty = 0;
+    irq_unlock(key);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_exec()
+ *
+ * @brief see rng_ctl.h
+ */
+int rng_ctl_exec(int argc, char **argv, rng_ctl_out_t out, void *ctx)
+{
+    int ret = DWT_ERROR;
+
+    if (argc < 1)
+    {
+        ctl_print(out, ctx, "err no command");
+        return DWT_ERROR;
+    }
+
+    k_mutex_lock(&ctl_lock, K_FOREVER);
+    if (!strcmp(argv[0], "show"))
+    {
+        ret = ctl_show(out, ctx);
+    }
+    else if (!strcmp(argv[0], "set"))
+    {
+        ret = ctl_set(argc, argv, out, ctx);
+    }
+    else if (!strcmp(argv[0], "peers"))
+    {
+        ret = ctl_peers(argc, argv, out, ctx);
+    }
+    else if (!strcmp(argv[0], "discard"))
+    {
+        unsigned int key = irq_lock();
+
+        ctl.pending = ctl.cur;
+        ctl.dirty = 0;
+        irq_unlock(key);
+        ctl_print(out, ctx, "ok");
+        ret = DWT_SUCCESS;
+    }
+    else
+    {
+        ctl_print(out, ctx, "err unknown command %s", argv[0]);
+    }
+    k_mutex_unlock(&ctl_lock);
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_execline()
+ *
+ * @brief see rng_ctl.h
+ */
+int rng_ctl_execline(char *line, rng_ctl_out_t out, void *ctx)
+{
+    char *argv[RNG_CTL_MAX_ARGS];
+    int argc = 0;
+    char *p = line;
+
+    while (*p != '\0')
+    {
+        while ((*p == ' ') || (*p == '\r') || (*p == '\n'))
+        {
+            *p++ = '\0';
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        if (argc == RNG_CTL_MAX_ARGS)
+        {
+            ctl_print(out, ctx, "err more than %u arguments", RNG_CTL_MAX_ARGS);
+            return DWT_ERROR;
+        }
+        argv[argc++] = p;
+        while ((*p != '\0') && (*p != ' ') && (*p != '\r') && (*p != '\n'))
+        {
+            p++;
+        }
+    }
+
+    if ((argc > 0) && !strcmp(argv[0], "rng"))
+    {
+        return rng_ctl_exec(argc - 1, &argv[1], out, ctx);
+    }
+    return rng_ctl_exec(argc, argv, out, ctx);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_apply()
+ *
+ * @brief see rng_ctl.h
+ */
+uint8 rng_ctl_apply(rng_ctl_settings_t *cur)
+{
+    rng_ctl_settings_t next;
+    unsigned int key;
+    uint8 mask = 0;
+
+    key = irq_lock();
+    if (!ctl.dirty)
+    {
+        irq_unlock(key);
+        if (cur != NULL)
+        {
+            *cur = ctl.cur;
+        }
+        return 0;
+    }
+    next = ctl.pending;
+    ctl.dirty = 0;
+    irq_unlock(key);
+
+    if (memcmp(&next.rng, &ctl.cur.rng, sizeof(next.rng)))
+    {
+        mask |= RNG_CTL_CHG_ENGINE;
+    }
+    if (memcmp(&next.phy, &ctl.cur.phy, sizeof(next.phy)))
+    {
+        mask |= RNG_CTL_CHG_PHY;
+    }
+    if ((next.peerCnt != ctl.cur.peerCnt) || memcmp(next.peers, ctl.cur.peers, next.peerCnt * sizeof(uint16)))
+    {
+        mask |= RNG_CTL_CHG_PEERS;
+    }
+    if (next.intervalMs != ctl.cur.intervalMs)
+    {
+        mask |= RNG_CTL_CHG_INTERVAL;
+    }
+    if (memcmp(next.vars, ctl.cur.vars, sizeof(next.vars)))
+    {
+        mask |= RNG_CTL_CHG_VARS;
+    }
+
+    if ((mask & (RNG_CTL_CHG_ENGINE | RNG_CTL_CHG_PHY)) && (ctl.cfg.cb != NULL))
+    {
+        rng_state_t state = rng_getstate();
+
+        if ((state != RNG_IDLE) && (state != RNG_RESP_WAIT_POLL))
+        {
+            /* Again after the exchange, pending holds these changes or newer ones */
+            key = irq_lock();
+            ctl.dirty = 1;
+            irq_unlock(key);
+            return 0;
+        }
+
+        rng_stop();
+        if (mask & RNG_CTL_CHG_PHY)
+        {
+            dwt_configure(&next.phy);
+        }
+        if (next.rng.txAntDly != ctl.cur.rng.txAntDly)
+        {
+            dwt_settxantennadelay(next.rng.txAntDly);
+        }
+        rng_init(&next.rng, ctl.cfg.cb);
+        rng_setphy(&next.phy);
+        if (ctl.cfg.respond)
+        {
+            rng_respond();
+        }
+    }
+
+    ctl.cur = next;
+    if (cur != NULL)
+    {
+        *cur = next;
+    }
+
+    return mask;
+}
+
+#ifdef CONFIG_DW1000_RANGING_SHELL
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ctl_shell_out() / ctl_shell_cmd()
+ *
+ * @brief rng shell commands, run by rng_ctl_exec().
+ */
+static void ctl_shell_out(void *ctx, const char *line)
+{
+    shell_print((const struct shell *)ctx, "%s", line);
+}
+
+static int ctl_shell_cmd(const struct shell *shell, size_t argc, char **argv)
+{
+    return (rng_ctl_exec((int)argc, argv, ctl_shell_out, (void *)shell) == DWT_SUCCESS) ? 0 : -EINVAL;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ctl_shell_cmds,
+    SHELL_CMD(show, NULL, "Settings, the pending ones if not applied yet", ctl_shell_cmd),
+    SHELL_CMD(set, NULL, "set <name> <value>...: queue changes, applied between exchanges", ctl_shell_cmd),
+    SHELL_CMD(peers, NULL, "peers [<addr>...]: list or replace the peers", ctl_shell_cmd),
+    SHELL_CMD(discard, NULL, "Drop the changes not applied yet", ctl_shell_cmd),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(rng, &ctl_shell_cmds, "Ranging settings, see rng_ctl.h", NULL);
+#endif
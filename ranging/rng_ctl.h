@@ -0,0 +1,183 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_ctl.h
+ * @brief   Runtime settings of the ranging engine, the radio configuration and
+ *          the application, changed live from the shell or BLE
+ *          (CONFIG_DW1000_RANGING_CTL)
+ *
+ *          The module holds two copies of the settings: the ones in use and
+ *          the pending ones the commands change. The application calls
+ *          rng_ctl_apply() between exchanges, which takes the pending
+ *          settings over in one go: with an engine result callback given it
+ *          also stops the engine, writes a new radio configuration
+ *          (dwt_configure()), gives the engine its new configuration and
+ *          PHY (rng_init(), rng_setphy()) and restarts the responder. The
+ *          interval, the peers and the application values are only handed
+ *          back, the application uses them for its next exchanges, e.g. for
+ *          the BLE report cadence.
+ *
+ *          Commands, from the shell (rng <command>, CONFIG_DW1000_RANGING_SHELL)
+ *          or as a text line given to rng_ctl_execline(), e.g. written to the
+ *          BLE command characteristic of ble_dwm1001.h:
+ *          - show: the settings, pending ones when not applied yet;
+ *          - set <name> <value> [<name> <value>...]: queue changes, all of
+ *            them or none if one is invalid. The names are those of
+ *            rng_config_t, interval (ms), the radio ones chan, prf (16, 64),
+ *            plen (symbols), pac (symbols), txCode, rxCode, code (both),
+ *            nsSFD, rate (110, 850, 6800 kbps), phr (0 standard, 1
+ *            extended), sfdTO, and the application values. A preamble
+ *            length, PAC, rate or SFD change without sfdTO recomputes it
+ *            (preamble length + 1 + SFD length - PAC size);
+ *          - peers [<addr>...]: list or replace the peers, hexadecimal
+ *            addresses, or c: and two characters as RNG_ADDR() ("c:WA" is
+ *            0x4157, "a0" is 0x00a0);
+ *          - discard: drop the changes not applied yet.
+ *          Each command answers with lines, the last one "ok" or
+ *          "err <reason>".
+ *
+ *          Both sides of a link must agree on the radio configuration and on
+ *          the timings noted in rng_config_t: change them on the responders
+ *          first, their new PHY no longer hears the initiator until it
+ *          follows.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_CTL_H_
+#define _RNG_CTL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "rng_twr.h"
+
+// Peers of the settings, and application values
+#define RNG_CTL_MAX_PEERS           8
+#define RNG_CTL_MAX_VARS            8
+
+// Arguments of a command line, and length of an answer line
+#define RNG_CTL_MAX_ARGS            17
+#define RNG_CTL_LINE_LEN            64
+
+// rng_ctl_apply() change mask
+#define RNG_CTL_CHG_ENGINE          0x01    // rng_config_t
+#define RNG_CTL_CHG_PHY             0x02    // dwt_config_t
+#define RNG_CTL_CHG_PEERS           0x04
+#define RNG_CTL_CHG_INTERVAL        0x08
+#define RNG_CTL_CHG_VARS            0x10
+
+typedef struct
+{
+    rng_config_t rng;                   // ranging engine configuration
+    dwt_config_t phy;                   // radio configuration
+    uint32 intervalMs;                  // time between exchanges
+    uint8 peerCnt;
+    uint16 peers[RNG_CTL_MAX_PEERS];
+    uint32 vars[RNG_CTL_MAX_VARS];      // application values, in the order of rng_ctl_config_t vars
+} rng_ctl_settings_t;
+
+/* Application value */
+typedef struct
+{
+    const char *name;                   // set/show name, e.g. "ble.deadline"
+    uint32 min;
+    uint32 max;
+} rng_ctl_var_t;
+
+typedef struct
+{
+    rng_result_cb_t cb;                 // engine result callback, NULL if the application restarts the engine itself:
+                                        // the engine and radio settings are then refused
+    uint8 respond;                      // restart the responder after an engine or radio change
+    const rng_ctl_var_t *vars;          // application values, up to RNG_CTL_MAX_VARS
+    uint8 varCnt;
+} rng_ctl_config_t;
+
+#define RNG_CTL_CONFIG_DEFAULT(result_cb) { \
+    .cb = (result_cb),                  \
+    .respond = 0,                       \
+    .vars = NULL,                       \
+    .varCnt = 0,                        \
+}
+
+/* Answer line of a command, without the line end */
+typedef void (*rng_ctl_out_t)(void *ctx, const char *line);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_init()
+ *
+ * @brief Take the settings in use, e.g. those the application gave to dwt_configure() and rng_init(). Nothing is
+ *        written to the DW1000.
+ *
+ * input parameters
+ * @param config   - engine control and application values, the value table is kept, not copied
+ * @param settings - settings in use, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if there are too many values or peers
+ */
+int rng_ctl_init(const rng_ctl_config_t *config, const rng_ctl_settings_t *settings);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_exec()
+ *
+ * @brief Run a command, from any thread. The changes are only queued.
+ *
+ * input parameters
+ * @param argc - arguments, the command first
+ * @param argv - they may be modified
+ * @param out  - answer lines
+ * @param ctx  - given to out
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the command failed, the last answer line says why
+ */
+int rng_ctl_exec(int argc, char **argv, rng_ctl_out_t out, void *ctx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_execline()
+ *
+ * @brief Split a text line on spaces and run it as rng_ctl_exec() does. A line end and an "rng " prefix are dropped.
+ *
+ * input parameters
+ * @param line - command line, ended by a 0, modified
+ * @param out  - answer lines
+ * @param ctx  - given to out
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the command failed
+ */
+int rng_ctl_execline(char *line, rng_ctl_out_t out, void *ctx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_ctl_apply()
+ *
+ * @brief Take the pending settings over, between two exchanges: an initiator calls it before starting one, a
+ *        responder from time to time. With an engine result callback, engine and radio changes wait while an exchange
+ *        is in progress, the responder counts as idle while it waits for a poll; a poll arriving at that moment is
+ *        lost. Without one, it only copies and can be called from an interrupt.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param cur - settings in use after the call, may be NULL
+ *
+ * returns RNG_CTL_CHG_xxx mask of the settings changed, 0 if nothing was pending or it has to wait
+ */
+uint8 rng_ctl_apply(rng_ctl_settings_t *cur);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_CTL_H_ */
@@ -0,0 +1,301 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_filter.c
+ * @brief   Per-peer range filtering and outlier rejection
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_filter.h"
+#include "deca_regs.h"
+
+#include <zephyr.h>
+
+// Fractional bits of the Kalman distance, mm
+#define FILTER_X_Q                  4
+
+// Kalman: quality under which the measurement noise stops growing, 10 times the variance at the best quality
+#define FILTER_QUALITY_FLOOR        10
+
+// Kalman: estimate variance limit, mm^2, keeps the gain computation in range after a long silence
+#define FILTER_P_MAX                100000000UL
+
+typedef struct
+{
+    uint16 addr;
+    uint8 used;
+    uint8 count;                        // ranges in the window
+    uint8 head;                         // next slot of the window
+    uint8 rejects;                      // outliers in a row
+    uint8 pending;                      // ranges accepted since the last report
+    uint16 qualitySum;                  // of the pending ranges
+    uint32 lastMs;                      // uptime of the last update
+    int32 xQ;                           // Kalman distance, mm, Q FILTER_X_Q
+    uint32 p;                           // Kalman variance, mm^2
+    int32 win[RNG_FILTER_WIN];
+} rng_filter_peer_t;
+
+typedef struct
+{
+    rng_filter_config_t cfg;
+    rng_filter_peer_t peers[RNG_FILTER_PEERS];
+    rng_filter_stats_t stats;
+} rng_filter_local_t;
+
+static rng_filter_local_t flt;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn filter_peer()
+ *
+ * @brief Slot of a peer: its own, else a free one, else the least recently updated one, cleared.
+ */
+static rng_filter_peer_t *filter_peer(uint16 addr, uint32 now)
+{
+    rng_filter_peer_t *slot = NULL;
+    int i;
+
+    for (i = 0; i < RNG_FILTER_PEERS; i++)
+    {
+        rng_filter_peer_t *p = &flt.peers[i];
+
+        if (p->used && (p->addr == addr))
+        {
+            return p;
+        }
+        if ((slot == NULL) || (slot->used && (!p->used || ((now - p->lastMs) > (now - slot->lastMs)))))
+        {
+            slot = p;
+        }
+    }
+
+    if (slot->used)
+    {
+        flt.stats.evictions++;
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->addr = addr;
+    slot->used = 1;
+
+    return slot;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn filter_median()
+ *
+ * @brief Median of the window, the lower one for an even count.
+ */
+static int32 filter_median(const rng_filter_peer_t *p)
+{
+    int32 v[RNG_FILTER_WIN];
+    int i, j;
+
+    for (i = 0; i < p->count; i++)
+    {
+        int32 x = p->win[i];
+
+        for (j = i; (j > 0) && (v[j - 1] > x); j--)
+        {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+
+    return v[(p->count - 1) / 2];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn filter_kalman()
+ *
+ * @brief Kalman predict and update with a range, the measurement variance scaled by the inverse of its quality.
+ */
+static void filter_kalman(rng_filter_peer_t *p, int32 distMm, uint8 quality, uint32 dtMs)
+{
+    uint32 r, k;
+    uint64_t pp;
+    int32 e;
+
+    r = (uint32)flt.cfg.measMm * flt.cfg.measMm * RNG_FILTER_QUALITY_MAX / MAX(quality, FILTER_QUALITY_FLOOR);
+    if (r == 0)
+    {
+        r = 1;
+    }
+
+    if (p->count == 0)
+    {
+        p->xQ = distMm * (1 << FILTER_X_Q);
+        p->p = r;
+        return;
+    }
+
+    pp = p->p + (uint64_t)flt.cfg.processMm2 * dtMs / 1000;
+    if (pp > FILTER_P_MAX)
+    {
+        pp = FILTER_P_MAX;
+    }
+
+    /* Gain in Q16, then x += K (z - x), P = (1 - K) P */
+    k = (uint32)((pp << 16) / (pp + r));
+    e = distMm * (1 << FILTER_X_Q) - p->xQ;
+    p->xQ += (int32)(((int64_t)e * k) >> 16);
+    p->p = (uint32)((pp * (65536 - k)) >> 16);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_init()
+ *
+ * @brief see rng_filter.h
+ */
+int rng_filter_init(const rng_filter_config_t *config)
+{
+    if ((config == NULL) || (config->window == 0) || (config->window > RNG_FILTER_WIN) || (config->reportEvery == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&flt, 0, sizeof(flt));
+    flt.cfg = *config;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_update()
+ *
+ * @brief see rng_filter.h
+ */
+rng_filter_result_t rng_filter_update(uint16 peer, int32 distMm, uint8 quality, rng_filter_out_t *out)
+{
+    uint32 now = k_uptime_get_32();
+    rng_filter_peer_t *p = filter_peer(peer, now);
+    uint32 dtMs = now - p->lastMs;
+    int32 d;
+
+    flt.stats.ranges++;
+    p->lastMs = now;
+
+    if (quality < flt.cfg.minQuality)
+    {
+        flt.stats.lowQuality++;
+        return RNG_FILTER_REJECTED;
+    }
+
+    if ((p->count != 0) && (flt.cfg.gateMm != 0))
+    {
+        d = distMm - filter_median(p);
+        if ((d > flt.cfg.gateMm) || (-d > flt.cfg.gateMm))
+        {
+            flt.stats.outliers++;
+            if (++p->rejects <= flt.cfg.maxRejects)
+            {
+                return RNG_FILTER_REJECTED;
+            }
+
+            /* Not outliers any more, the peer moved: start again from this range */
+            flt.stats.restarts++;
+            p->count = 0;
+            p->head = 0;
+            p->pending = 0;
+            p->qualitySum = 0;
+        }
+    }
+    p->rejects = 0;
+
+    if (flt.cfg.mode == RNG_FILTER_KALMAN)
+    {
+        filter_kalman(p, distMm, quality, dtMs);
+    }
+
+    p->win[p->head] = distMm;
+    p->head = (p->head + 1) % flt.cfg.window;
+    if (p->count < flt.cfg.window)
+    {
+        p->count++;
+    }
+
+    p->qualitySum += quality;
+    if (++p->pending < flt.cfg.reportEvery)
+    {
+        return RNG_FILTER_HOLD;
+    }
+
+    if (flt.cfg.mode == RNG_FILTER_KALMAN)
+    {
+        /* Rounded to the nearest mm */
+        out->distMm = (p->xQ + (1 << (FILTER_X_Q - 1))) >> FILTER_X_Q;
+    }
+    else
+    {
+        out->distMm = filter_median(p);
+    }
+    out->tqf = (uint8)(p->qualitySum / p->pending);
+    p->pending = 0;
+    p->qualitySum = 0;
+    flt.stats.reports++;
+
+    return RNG_FILTER_REPORT;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_reset()
+ *
+ * @brief see rng_filter.h
+ */
+void rng_filter_reset(uint16 peer)
+{
+    int i;
+
+    for (i = 0; i < RNG_FILTER_PEERS; i++)
+    {
+        if (flt.peers[i].used && (flt.peers[i].addr == peer))
+        {
+            memset(&flt.peers[i], 0, sizeof(flt.peers[i]));
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_quality()
+ *
+ * @brief see rng_filter.h
+ */
+uint8 rng_filter_quality(const dwt_rxdiag_t *diag, uint16 peakAmp)
+{
+    uint32 fp = MAX(diag->firstPathAmp1, MAX(diag->firstPathAmp2, diag->firstPathAmp3));
+
+    if (peakAmp == 0)
+    {
+        return 0;
+    }
+
+    return (uint8)MIN(fp * RNG_FILTER_QUALITY_MAX / peakAmp, RNG_FILTER_QUALITY_MAX);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_readquality()
+ *
+ * @brief see rng_filter.h
+ */
+uint8 rng_filter_readquality(void)
+{
+    dwt_rxdiag_t diag;
+
+    dwt_readdiagnostics(&diag);
+
+    return rng_filter_quality(&diag, dwt_read16bitoffsetreg(LDE_IF_ID, LDE_PPAMPL_OFFSET));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_getstats()
+ *
+ * @brief see rng_filter.h
+ */
+void rng_filter_getstats(rng_filter_stats_t *stats)
+{
+    *stats = flt.stats;
+}
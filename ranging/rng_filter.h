@@ -0,0 +1,205 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_filter.h
+ * @brief   Per-peer range filtering and outlier rejection
+ *
+ *          Each peer has a window of its last accepted ranges. A new range
+ *          farther than gateMm from the median of the window is an outlier
+ *          and dropped; maxRejects of them in a row mean the peer really
+ *          moved, the filter restarts from the new range. Accepted ranges
+ *          are smoothed either by the median of the window, or by a scalar
+ *          Kalman filter in fixed point (distance only, random walk), whose
+ *          measurement noise grows as the range quality drops.
+ *
+ *          The quality (0 to 100) compares the first path amplitude to the
+ *          peak amplitude of the channel impulse response: in line of sight
+ *          the first path is the strongest, behind an obstacle it is
+ *          attenuated and the peak is a reflection, the range is long.
+ *          It needs the LDE microcode, without it the quality reads 0.
+ *
+ *          One report is given every reportEvery accepted ranges, with the
+ *          average quality of those ranges, so that the host gets fewer and
+ *          cleaner samples. Not locked: call from a single thread.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_FILTER_H_
+#define _RNG_FILTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Peers filtered at the same time, the least recently updated one is replaced by a new peer
+#ifdef CONFIG_DW1000_RANGE_FILTER_PEERS
+#define RNG_FILTER_PEERS            CONFIG_DW1000_RANGE_FILTER_PEERS
+#else
+#define RNG_FILTER_PEERS            8
+#endif
+
+// Largest window, ranges
+#ifdef CONFIG_DW1000_RANGE_FILTER_WIN
+#define RNG_FILTER_WIN              CONFIG_DW1000_RANGE_FILTER_WIN
+#else
+#define RNG_FILTER_WIN              7
+#endif
+
+// Quality of a range whose first path is the peak of the channel impulse response
+#define RNG_FILTER_QUALITY_MAX      100
+
+typedef enum
+{
+    RNG_FILTER_MEDIAN,                  // report the median of the window
+    RNG_FILTER_KALMAN                   // report the Kalman estimate
+} rng_filter_mode_t;
+
+typedef enum
+{
+    RNG_FILTER_HOLD,                    // range accepted, no report due
+    RNG_FILTER_REPORT,                  // range accepted, report written
+    RNG_FILTER_REJECTED                 // range dropped: outlier or quality below minQuality
+} rng_filter_result_t;
+
+typedef struct
+{
+    rng_filter_mode_t mode;
+    uint8 window;                       // ranges in the window, 1 to RNG_FILTER_WIN
+    uint16 gateMm;                      // outlier distance from the median of the window, 0: no rejection
+    uint8 maxRejects;                   // outliers in a row before the filter restarts
+    uint8 minQuality;                   // ranges of lower quality are dropped
+    uint8 reportEvery;                  // accepted ranges per report, 1 for each
+    uint32 processMm2;                  // Kalman: distance variance growth per second, (mm/s)^2 * s
+    uint16 measMm;                      // Kalman: range standard deviation at RNG_FILTER_QUALITY_MAX
+} rng_filter_config_t;
+
+#define RNG_FILTER_CONFIG_DEFAULT {     \
+    .mode = RNG_FILTER_KALMAN,          \
+    .window = 5,                        \
+    .gateMm = 500,                      \
+    .maxRejects = 3,                    \
+    .minQuality = 0,                    \
+    .reportEvery = 1,                   \
+    .processMm2 = 250000,               \
+    .measMm = 50,                       \
+}
+
+typedef struct
+{
+    int32 distMm;                       // filtered distance
+    uint8 tqf;                          // average quality of the ranges since the last report, for ble_rep_t.tqf
+} rng_filter_out_t;
+
+typedef struct
+{
+    uint32 ranges;                      // rng_filter_update() calls
+    uint32 lowQuality;                  // dropped below minQuality
+    uint32 outliers;                    // dropped by the gate
+    uint32 restarts;                    // filters restarted after maxRejects outliers in a row
+    uint32 reports;
+    uint32 evictions;                   // peers replaced by a new one
+} rng_filter_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_init()
+ *
+ * @brief Set the configuration and forget all peers.
+ *
+ * input parameters
+ * @param config - filter parameters, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL, its window out of range or reportEvery is 0
+ */
+int rng_filter_init(const rng_filter_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_update()
+ *
+ * @brief Add a range of a peer, filter it and tell whether a report is due.
+ *
+ * input parameters
+ * @param peer    - peer address, a new one takes the place of the least recently updated peer if the table is full
+ * @param distMm  - range
+ * @param quality - range quality, see rng_filter_readquality()
+ *
+ * output parameters
+ * @param out     - filtered distance and quality, written on RNG_FILTER_REPORT only
+ *
+ * returns RNG_FILTER_REPORT if out was written, RNG_FILTER_HOLD or RNG_FILTER_REJECTED otherwise
+ */
+rng_filter_result_t rng_filter_update(uint16 peer, int32 distMm, uint8 quality, rng_filter_out_t *out);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_reset()
+ *
+ * @brief Forget a peer, its next range starts a new filter.
+ *
+ * input parameters
+ * @param peer - peer address
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_filter_reset(uint16 peer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_quality()
+ *
+ * @brief Range quality from the RX diagnostics: the largest of the three first path amplitudes against the peak
+ *        amplitude, in percent.
+ *
+ * input parameters
+ * @param diag    - diagnostics of the frame, from dwt_readdiagnostics()
+ * @param peakAmp - peak amplitude of the frame, LDE_PPAMPL
+ *
+ * output parameters
+ *
+ * returns the quality, 0 to RNG_FILTER_QUALITY_MAX, 0 if the peak amplitude is 0 (LDE microcode not loaded)
+ */
+uint8 rng_filter_quality(const dwt_rxdiag_t *diag, uint16 peakAmp);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_readquality()
+ *
+ * @brief Read the RX diagnostics and the peak amplitude of the last frame received and return its quality, see
+ *        rng_filter_quality(). Call before the receiver is enabled again.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the quality, 0 to RNG_FILTER_QUALITY_MAX
+ */
+uint8 rng_filter_readquality(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_filter_getstats()
+ *
+ * @brief Read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since rng_filter_init()
+ *
+ * no return value
+ */
+void rng_filter_getstats(rng_filter_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_FILTER_H_ */
@@ -0,0 +1,349 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_link.c
+ * @brief   Per-peer link adaptation of the ranging engine
+ *          (CONFIG_DW1000_LINK_ADAPT)
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_link.h"
+#include "deca_regs.h"
+#include "deca_rxqual.h"
+
+// No point applied yet
+#define LINK_POINT_NONE     0xFF
+
+// RX power average: 1/2^LINK_AVG_SHIFT of each new value
+#define LINK_AVG_SHIFT      2
+
+typedef struct
+{
+    uint16 addr;
+    uint8 used;
+    uint8 fails;                        // failed exchanges in a row
+    uint8 cnt;                          // exchanges in the window
+    uint8 ok;                           // of which successful
+    uint32 lastUse;                     // use counter value of the last exchange
+    rng_link_peer_t st;
+} link_peer_t;
+
+typedef struct
+{
+    rng_link_config_t cfg;
+    uint8 count;                        // points, 0 before rng_link_init()
+    uint8 cur;                          // point applied, LINK_POINT_NONE before the first one
+    uint8 lnaPa;                        // LNA/PA and smart TX power modes set
+    uint8 smartTx;
+    uint32 uses;
+    rng_link_point_t points[RNG_LINK_MAX_POINTS];
+    dwt_profile_t profiles[RNG_LINK_MAX_POINTS];
+    uint32 finfo[RNG_LINK_MAX_POINTS];  // RX_FINFO data rate and preamble length of each point
+    link_peer_t peers[RNG_LINK_PEERS];
+} rng_link_local_t;
+
+static rng_link_local_t lnk;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn link_apply()
+ *
+ * @brief Switch to a point: profile, LNA/PA, smart TX power and the PHY of the engine, nothing if it is in use.
+ */
+static void link_apply(uint8 point)
+{
+    const rng_link_point_t *pt = &lnk.points[point];
+
+    if (point == lnk.cur)
+    {
+        return;
+    }
+    dwt_applyprofile(&lnk.profiles[point]);
+    if (pt->lnaPa != lnk.lnaPa)
+    {
+        /* The PA needs the fine grain TX sequencing off */
+        dwt_setfinegraintxseq((pt->lnaPa & DWT_PA_ENABLE) ? 0 : 1);
+        dwt_setlnapamode(pt->lnaPa);
+        lnk.lnaPa = pt->lnaPa;
+    }
+    if (pt->smartTx != lnk.smartTx)
+    {
+        dwt_setsmarttxpower(pt->smartTx);
+        lnk.smartTx = pt->smartTx;
+    }
+    rng_setphy(&pt->phy);
+    lnk.cur = point;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn link_peer()
+ *
+ * @brief Slot of a peer: its own, else a free one, else the least recently used one, set to the start point.
+ */
+static link_peer_t *link_peer(uint16 addr)
+{
+    link_peer_t *slot = NULL;
+    int i;
+
+    for (i = 0; i < RNG_LINK_PEERS; i++)
+    {
+        link_peer_t *p = &lnk.peers[i];
+
+        if (p->used && (p->addr == addr))
+        {
+            return p;
+        }
+        if ((slot == NULL) || (slot->used && (!p->used || ((lnk.uses - p->lastUse) > (lnk.uses - slot->lastUse)))))
+        {
+            slot = p;
+        }
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->addr = addr;
+    slot->used = 1;
+    slot->st.point = lnk.cfg.startPoint;
+    slot->st.rxPowerQ8 = DECA_RXQUAL_NONE;
+
+    return slot;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn link_step()
+ *
+ * @brief Move a peer to another point, its window and RX power start again.
+ */
+static void link_step(link_peer_t *p, uint8 point)
+{
+    if (point > p->st.point)
+    {
+        p->st.ups++;
+    }
+    else
+    {
+        p->st.downs++;
+    }
+    p->st.point = point;
+    p->st.rxPowerQ8 = DECA_RXQUAL_NONE;
+    p->fails = 0;
+    p->cnt = 0;
+    p->ok = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn link_finfo()
+ *
+ * @brief RX_FINFO data rate and preamble length fields of a frame sent with a configuration.
+ */
+static uint32 link_finfo(const dwt_config_t *phy)
+{
+    /* DWT_PLEN_xxx holds TXPSR in bits 2-3 and PE in bits 4-5, RX_FINFO reports them as RXPSR and RXNSPL */
+    return ((uint32)phy->dataRate << RX_FINFO_RXBR_SHIFT) | (((uint32)(phy->txPreambLength >> 2) & 0x3) << 18) |
+           (((uint32)(phy->txPreambLength >> 4) & 0x3) << 11);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_init()
+ *
+ * @brief see rng_link.h
+ */
+int rng_link_init(const rng_link_config_t *config, const rng_link_point_t *points, uint8 count)
+{
+    const dwt_config_t *p0 = &points[0].phy;
+    int i;
+
+    if ((count == 0) || (count > RNG_LINK_MAX_POINTS))
+    {
+        return DWT_ERROR;
+    }
+#ifdef DWT_FIXED_BR
+    if (p0->dataRate != DWT_FIXED_BR)
+    {
+        return DWT_ERROR;
+    }
+#endif
+    for (i = 1; i < count; i++)
+    {
+        const dwt_config_t *p = &points[i].phy;
+
+        if ((p->chan != p0->chan) || (p->prf != p0->prf) || (p->txCode != p0->txCode) || (p->rxCode != p0->rxCode) ||
+            (p->nsSFD != p0->nsSFD) || ((p->dataRate == DWT_BR_110K) != (p0->dataRate == DWT_BR_110K)) ||
+            (p->nsSFD && (p->dataRate != p0->dataRate)))
+        {
+            return DWT_ERROR;
+        }
+    }
+
+    memset(&lnk, 0, sizeof(lnk));
+    lnk.cfg = *config;
+    if (lnk.cfg.listenPoint >= count)
+    {
+        lnk.cfg.listenPoint = count - 1;
+    }
+    if (lnk.cfg.startPoint >= count)
+    {
+        lnk.cfg.startPoint = count - 1;
+    }
+    memcpy(lnk.points, points, count * sizeof(rng_link_point_t));
+    for (i = 0; i < count; i++)
+    {
+        dwt_compileprofile(&lnk.points[i].phy, &lnk.points[i].txrf, &lnk.profiles[i]);
+        lnk.finfo[i] = link_finfo(&lnk.points[i].phy);
+    }
+    lnk.count = count;
+    lnk.cur = LINK_POINT_NONE;
+    /* Unknown modes, written with the first point */
+    lnk.lnaPa = 0xFF;
+    lnk.smartTx = 0xFF;
+
+    link_apply(lnk.cfg.listenPoint);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_getpeer()
+ *
+ * @brief see rng_link.h
+ */
+int rng_link_getpeer(uint16 peer, rng_link_peer_t *state)
+{
+    int i;
+
+    for (i = 0; i < RNG_LINK_PEERS; i++)
+    {
+        if (lnk.peers[i].used && (lnk.peers[i].addr == peer))
+        {
+            *state = lnk.peers[i].st;
+            return DWT_SUCCESS;
+        }
+    }
+    return DWT_ERROR;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_poll()
+ *
+ * @brief see rng_link.h
+ */
+void rng_link_poll(uint16 peer)
+{
+    link_peer_t *p;
+
+    if (lnk.count == 0)
+    {
+        return;
+    }
+    p = link_peer(peer);
+    p->lastUse = ++lnk.uses;
+    link_apply(p->st.point);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_follow()
+ *
+ * @brief see rng_link.h
+ */
+void rng_link_follow(void)
+{
+    uint32 finfo;
+    int i;
+
+    if (lnk.count == 0)
+    {
+        return;
+    }
+
+    /* The exact preamble length first, else the same symbol repetition group */
+    finfo = dwt_read32bitreg(RX_FINFO_ID);
+    for (i = 0; i < lnk.count; i++)
+    {
+        if ((finfo & (RX_FINFO_RXBR_MASK | RX_FINFO_RXPEL_MASK)) == lnk.finfo[i])
+        {
+            link_apply((uint8)i);
+            return;
+        }
+    }
+    for (i = 0; i < lnk.count; i++)
+    {
+        if ((finfo & (RX_FINFO_RXBR_MASK | RX_FINFO_RXPSR_MASK)) == (lnk.finfo[i] & ~RX_FINFO_RXNSPL_MASK))
+        {
+            link_apply((uint8)i);
+            return;
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_listen()
+ *
+ * @brief see rng_link.h
+ */
+void rng_link_listen(void)
+{
+    if (lnk.count != 0)
+    {
+        link_apply(lnk.cfg.listenPoint);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_result()
+ *
+ * @brief see rng_link.h
+ */
+void rng_link_result(const rng_result_t *result)
+{
+    link_peer_t *p;
+    uint8 point;
+
+    /* A late TX or a busy channel says nothing about the link */
+    if ((lnk.count == 0) || (result->status == RNG_ERR_TX_LATE) || (result->status == RNG_ERR_BUSY))
+    {
+        return;
+    }
+    p = link_peer(result->peer);
+    point = p->st.point;
+
+    p->cnt++;
+    if (result->status != RNG_OK)
+    {
+        p->fails++;
+        if ((p->fails >= lnk.cfg.upFails) && (point + 1 < lnk.count))
+        {
+            link_step(p, point + 1);
+        }
+        return;
+    }
+
+    p->fails = 0;
+    p->ok++;
+    if (result->rxPowerQ8 != DECA_RXQUAL_NONE)
+    {
+        p->st.rxPowerQ8 = (p->st.rxPowerQ8 == DECA_RXQUAL_NONE) ? result->rxPowerQ8 :
+                          (int16)(p->st.rxPowerQ8 + ((result->rxPowerQ8 - p->st.rxPowerQ8) >> LINK_AVG_SHIFT));
+        if ((p->st.rxPowerQ8 < lnk.points[point].minRxPowerQ8) && (point + 1 < lnk.count))
+        {
+            link_step(p, point + 1);
+            return;
+        }
+    }
+
+    if (p->cnt >= lnk.cfg.window)
+    {
+        if ((point > 0) && ((uint32)p->ok * 100 >= (uint32)lnk.cfg.downOkPct * p->cnt) &&
+            ((p->st.rxPowerQ8 == DECA_RXQUAL_NONE) ||
+             (p->st.rxPowerQ8 >= lnk.points[point - 1].minRxPowerQ8 + lnk.cfg.hystQ8)))
+        {
+            link_step(p, point - 1);
+            return;
+        }
+        p->cnt = 0;
+        p->ok = 0;
+    }
+}
@@ -0,0 +1,150 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_link.h
+ * @brief   Per-peer link adaptation of the ranging engine
+ *          (CONFIG_DW1000_LINK_ADAPT)
+ *
+ *          The application gives a table of operating points, from the
+ *          fastest and cheapest to the most robust: radio configuration
+ *          (preamble length, data rate), TX power, smart TX power and
+ *          external LNA/PA. The initiator keeps a point per peer and the
+ *          engine applies it before each poll (dwt_applyprofile(), only the
+ *          registers that change):
+ *          - upFails failed exchanges in a row, or an RX power below the
+ *            minRxPowerQ8 of the point, move the peer to the next, more
+ *            robust point;
+ *          - a window of exchanges at downOkPct success or more, with an
+ *            RX power hystQ8 above the minRxPowerQ8 of the faster point,
+ *            moves it back to that one.
+ *          The RX power needs rxQual in rng_config_t, without it the
+ *          success rate decides alone.
+ *
+ *          The responder follows: it listens for polls at listenPoint and
+ *          answers at the point whose data rate and preamble length the
+ *          poll came with (RX_FINFO), so the initiator decides for both
+ *          sides. Its LNA/PA and TX power are those of the point.
+ *
+ *          A receiver configured for one point hears the others, so the
+ *          points must share the channel, PRF, preamble codes and SFD,
+ *          110 kbps is all or none of them, and with the non-standard SFD
+ *          the data rate is shared too (its length depends on it). The
+ *          listen point gives the PAC and SFD timeout of the responder
+ *          waiting for polls: take the longest preamble. The engine delays
+ *          and timeouts must fit the slowest point.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_LINK_H_
+#define _RNG_LINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "rng_twr.h"
+
+// Operating points
+#define RNG_LINK_MAX_POINTS         4
+
+// Peers adapted at the same time, the least recently ranged one is replaced by a new peer
+#ifdef CONFIG_DW1000_LINK_PEERS
+#define RNG_LINK_PEERS              CONFIG_DW1000_LINK_PEERS
+#else
+#define RNG_LINK_PEERS              8
+#endif
+
+/* One operating point */
+typedef struct
+{
+    dwt_config_t phy;                   // radio configuration, see above for what may differ between points
+    dwt_txconfig_t txrf;                // TX power and PG delay, for the smart TX power setting of the point
+    uint8 lnaPa;                        // DWT_LNA_ENABLE | DWT_PA_ENABLE, see dwt_setlnapamode()
+    uint8 smartTx;                      // 1 for smart TX power, see dwt_setsmarttxpower()
+    int16 minRxPowerQ8;                 // RX power moving a peer to the next point, dBm Q8
+} rng_link_point_t;
+
+typedef struct
+{
+    uint8 window;                       // exchanges between two steps towards the faster points
+    uint8 upFails;                      // failed exchanges in a row moving a peer to the next point
+    uint8 downOkPct;                    // success rate over the window moving it back
+    int16 hystQ8;                       // RX power margin above minRxPowerQ8 of the faster point, dB Q8
+    uint8 listenPoint;                  // point of a responder waiting for polls, and of broadcast exchanges
+    uint8 startPoint;                   // point of a new peer
+} rng_link_config_t;
+
+// Points in the order of the table, the last one is the listen and start point unless set otherwise
+#define RNG_LINK_CONFIG_DEFAULT {       \
+    .window = 16,                       \
+    .upFails = 2,                       \
+    .downOkPct = 95,                    \
+    .hystQ8 = 6 * 256,                  \
+    .listenPoint = 0xFF,                \
+    .startPoint = 0xFF,                 \
+}
+
+/* State of a peer */
+typedef struct
+{
+    uint8 point;                        // point in use
+    int16 rxPowerQ8;                    // average RX power at that point, DECA_RXQUAL_NONE until known
+    uint16 ups;                         // moves to a more robust point
+    uint16 downs;                       // moves to a faster point
+} rng_link_peer_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_init()
+ *
+ * @brief Compile the operating points into profiles, forget the peers and apply the listen point. The transceiver
+ *        must be off, e.g. call it between rng_init() and rng_respond(). The points are copied.
+ *
+ * input parameters
+ * @param config - thresholds, copied
+ * @param points - operating points, fastest first
+ * @param count  - 1 to RNG_LINK_MAX_POINTS
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the count is out of range or the points cannot hear each other
+ */
+int rng_link_init(const rng_link_config_t *config, const rng_link_point_t *points, uint8 count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_getpeer()
+ *
+ * @brief Read the state of a peer.
+ *
+ * input parameters
+ * @param peer - short address
+ *
+ * output parameters
+ * @param state - point, RX power and steps
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if the peer is not known
+ */
+int rng_link_getpeer(uint16 peer, rng_link_peer_t *state);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_link_poll() / rng_link_follow() / rng_link_listen() / rng_link_result()
+ *
+ * @brief Engine hooks, from rng_twr.c: apply the point of a peer before a poll (initiator), the point of the poll
+ *        just received (responder), the listen point, and update a peer with the outcome of an exchange it started.
+ *        They do nothing before rng_link_init().
+ */
+void rng_link_poll(uint16 peer);
+void rng_link_follow(void);
+void rng_link_listen(void);
+void rng_link_result(const rng_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_LINK_H_ */
@@ -0,0 +1,261 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_pos.c
+ * @brief   On-tag multilateration from the distances of a TDMA cycle
+ *
+ *          Distances d_i to anchors a_i, position p. Each iteration solves
+ *          the normal equations (J^T J) dp = J^T r, the rows of J being the
+ *          unit vectors u_i = (p - a_i) / |p - a_i| and r_i = d_i - |p - a_i|.
+ *          J^T J is at most 3x3 and solved by Cramer's rule.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "rng_pos.h"
+#include "deca_device_api.h"
+
+#include <zephyr.h>
+
+// J^T J determinant below which the anchors do not determine the position, it is the number of anchors for
+// orthogonal directions (and the square or the cube of it)
+#define POS_DET_MIN                 1e-3f
+
+typedef struct
+{
+    rng_pos_config_t cfg;
+    uint8 valid;                        // p is the previous fix
+    float p[3];                         // mm
+    rng_pos_stats_t stats;
+} rng_pos_local_t;
+
+static rng_pos_local_t pos;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pos_normal()
+ *
+ * @brief Solve h x = g, h symmetric, of size dims. Returns DWT_ERROR if h is singular.
+ */
+static int pos_normal(float h[3][3], const float g[3], float x[3], uint8 dims)
+{
+    float det, c0, c1, c2;
+
+    if (dims == 2)
+    {
+        det = h[0][0] * h[1][1] - h[0][1] * h[0][1];
+        if (det < POS_DET_MIN)
+        {
+            return DWT_ERROR;
+        }
+        x[0] = (g[0] * h[1][1] - g[1] * h[0][1]) / det;
+        x[1] = (h[0][0] * g[1] - h[0][1] * g[0]) / det;
+        x[2] = 0.0f;
+        return DWT_SUCCESS;
+    }
+
+    /* Cofactors of the first row, symmetric h */
+    c0 = h[1][1] * h[2][2] - h[1][2] * h[1][2];
+    c1 = h[1][2] * h[0][2] - h[0][1] * h[2][2];
+    c2 = h[0][1] * h[1][2] - h[1][1] * h[0][2];
+    det = h[0][0] * c0 + h[0][1] * c1 + h[0][2] * c2;
+    if (det < POS_DET_MIN)
+    {
+        return DWT_ERROR;
+    }
+
+    x[0] = (g[0] * c0 + g[1] * c1 + g[2] * c2) / det;
+    x[1] = (g[0] * c1 + g[1] * (h[0][0] * h[2][2] - h[0][2] * h[0][2]) +
+            g[2] * (h[0][2] * h[0][1] - h[0][0] * h[1][2])) / det;
+    x[2] = (g[0] * c2 + g[1] * (h[0][1] * h[0][2] - h[0][0] * h[1][2]) +
+            g[2] * (h[0][0] * h[1][1] - h[0][1] * h[0][1])) / det;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_init()
+ *
+ * @brief see rng_pos.h
+ */
+int rng_pos_init(const rng_pos_config_t *config)
+{
+    if ((config == NULL) || ((config->dims != 2) && (config->dims != 3)) ||
+        (config->anchorCnt > RNG_POS_MAX_ANCHORS) || (config->maxIter == 0) || (config->maxResidualMm == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&pos, 0, sizeof(pos));
+    pos.cfg = *config;
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_solve()
+ *
+ * @brief see rng_pos.h
+ */
+int rng_pos_solve(const rng_result_t *results, uint8 count, rng_pos_t *fix)
+{
+    float a[RNG_POS_MAX_ANCHORS][3];
+    float d[RNG_POS_MAX_ANCHORS];
+    float p[3], h[3][3], g[3], dp[3];
+    float sse, rms;
+    uint8 dims = pos.cfg.dims;
+    int n = 0, i, j, k, it;
+
+    pos.stats.solves++;
+
+    /* Distances and coordinates of the anchors ranged */
+    for (i = 0; i < count; i++)
+    {
+        if (results[i].status != RNG_OK)
+        {
+            continue;
+        }
+        for (j = 0; j < pos.cfg.anchorCnt; j++)
+        {
+            const rng_pos_anchor_t *anc = &pos.cfg.anchors[j];
+
+            if (anc->addr == results[i].peer)
+            {
+                a[n][0] = (float)anc->xMm;
+                a[n][1] = (float)anc->yMm;
+                a[n][2] = (float)anc->zMm;
+                d[n] = (float)results[i].distMm;
+                n++;
+                break;
+            }
+        }
+    }
+
+    /* One distance more than unknowns, or the fix has a mirror image */
+    if (n <= dims)
+    {
+        pos.stats.noGeometry++;
+        return DWT_ERROR;
+    }
+
+    if (pos.valid)
+    {
+        memcpy(p, pos.p, sizeof(p));
+    }
+    else
+    {
+        p[0] = p[1] = 0.0f;
+        for (i = 0; i < n; i++)
+        {
+            p[0] += a[i][0];
+            p[1] += a[i][1];
+        }
+        p[0] /= n;
+        p[1] /= n;
+        p[2] = (float)pos.cfg.zMm;
+    }
+
+    for (it = 1; it <= pos.cfg.maxIter; it++)
+    {
+        memset(h, 0, sizeof(h));
+        memset(g, 0, sizeof(g));
+
+        for (i = 0; i < n; i++)
+        {
+            float u[3], r;
+
+            for (j = 0; j < 3; j++)
+            {
+                u[j] = p[j] - a[i][j];
+            }
+            r = sqrtf(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+            if (r < 1.0f)
+            {
+                /* On the anchor: no direction, any will do */
+                r = 1.0f;
+            }
+            for (j = 0; j < 3; j++)
+            {
+                u[j] /= r;
+            }
+            r = d[i] - r;
+
+            for (j = 0; j < dims; j++)
+            {
+                g[j] += u[j] * r;
+                for (k = j; k < dims; k++)
+                {
+                    h[j][k] += u[j] * u[k];
+                }
+            }
+        }
+        for (j = 0; j < dims; j++)
+        {
+            for (k = 0; k < j; k++)
+            {
+                h[j][k] = h[k][j];
+            }
+        }
+
+        if (pos_normal(h, g, dp, dims) != DWT_SUCCESS)
+        {
+            pos.valid = 0;
+            pos.stats.noGeometry++;
+            return DWT_ERROR;
+        }
+
+        p[0] += dp[0];
+        p[1] += dp[1];
+        p[2] += dp[2];
+        if ((dp[0] * dp[0] + dp[1] * dp[1] + dp[2] * dp[2]) < (float)(RNG_POS_CONVERGED_MM * RNG_POS_CONVERGED_MM))
+        {
+            break;
+        }
+    }
+
+    sse = 0.0f;
+    for (i = 0; i < n; i++)
+    {
+        float dx = p[0] - a[i][0], dy = p[1] - a[i][1], dz = p[2] - a[i][2];
+        float r = d[i] - sqrtf(dx * dx + dy * dy + dz * dz);
+
+        sse += r * r;
+    }
+    rms = sqrtf(sse / n);
+
+    if (!(rms <= (float)pos.cfg.maxResidualMm))
+    {
+        pos.valid = 0;
+        pos.stats.rejected++;
+        return DWT_ERROR;
+    }
+
+    memcpy(pos.p, p, sizeof(p));
+    pos.valid = 1;
+    pos.stats.fixes++;
+
+    fix->xMm = (int32)lroundf(p[0]);
+    fix->yMm = (int32)lroundf(p[1]);
+    fix->zMm = (int32)lroundf(p[2]);
+    fix->residualMm = (uint16)rms;
+    fix->qf = (uint8)(100 - (uint32)fix->residualMm * 100 / pos.cfg.maxResidualMm);
+    fix->anchors = (uint8)n;
+    fix->iter = (uint8)MIN(it, pos.cfg.maxIter);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_getstats()
+ *
+ * @brief see rng_pos.h
+ */
+void rng_pos_getstats(rng_pos_stats_t *stats)
+{
+    *stats = pos.stats;
+}
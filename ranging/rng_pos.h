@@ -0,0 +1,130 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_pos.h
+ * @brief   On-tag multilateration from the distances of a TDMA cycle
+ *
+ *          Gauss-Newton least squares on the distances to anchors of known
+ *          coordinates, in single precision, which the Cortex-M4F FPU runs
+ *          in hardware. Each solve starts from the previous fix, so that once
+ *          tracking one or two iterations are enough; with no fix yet, from
+ *          the centroid of the anchors at height zMm.
+ *
+ *          In 2D the height is fixed at zMm (the tag height, known for a
+ *          person or a vehicle), 3 anchors are needed. In 3D the height is
+ *          solved too with at least 4 anchors, not all at the same height or
+ *          the height is poorly determined: anchors on a ceiling give the
+ *          height at best to several times the horizontal error.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_POS_H_
+#define _RNG_POS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rng_twr.h"
+#include "rng_tdma.h"
+
+#define RNG_POS_MAX_ANCHORS         RNG_TDMA_MAX_ANCHORS
+
+// Gauss-Newton stops once the position moves less than that in an iteration, mm
+#define RNG_POS_CONVERGED_MM        1
+
+/* Anchor of known coordinates */
+typedef struct
+{
+    uint16 addr;                        // short address, as in the ranging results
+    int32 xMm;
+    int32 yMm;
+    int32 zMm;
+} rng_pos_anchor_t;
+
+typedef struct
+{
+    rng_pos_anchor_t anchors[RNG_POS_MAX_ANCHORS];
+    uint8 anchorCnt;
+    uint8 dims;                         // 2: height fixed at zMm, 3: height solved
+    int32 zMm;                          // 2D: tag height, 3D: height of the first guess
+    uint8 maxIter;                      // Gauss-Newton iterations per solve
+    uint16 maxResidualMm;               // fixes with a larger RMS residual are rejected
+} rng_pos_config_t;
+
+/* Position fix */
+typedef struct
+{
+    int32 xMm;
+    int32 yMm;
+    int32 zMm;
+    uint16 residualMm;                  // RMS of the distance residuals
+    uint8 qf;                           // quality factor, 100 for no residual down to 0 at maxResidualMm
+    uint8 anchors;                      // distances used
+    uint8 iter;                         // Gauss-Newton iterations done
+} rng_pos_t;
+
+typedef struct
+{
+    uint32 solves;                      // rng_pos_solve() calls
+    uint32 fixes;
+    uint32 noGeometry;                  // too few distances, or anchors aligned
+    uint32 rejected;                    // residual above maxResidualMm
+} rng_pos_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_init()
+ *
+ * @brief Set the anchor table and solver parameters, and forget the previous fix.
+ *
+ * input parameters
+ * @param config - anchors and parameters, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL, dims is not 2 or 3, there are more anchors than
+ *         RNG_POS_MAX_ANCHORS, or maxIter or maxResidualMm is 0
+ */
+int rng_pos_init(const rng_pos_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_solve()
+ *
+ * @brief Solve the position from the results of a cycle, e.g. in the rng_tdma_cb_t callback. The results with
+ *        RNG_OK of anchors in the table are used, the others ignored. A rejected fix also drops the previous one:
+ *        the next solve starts again from the centroid.
+ *
+ * input parameters
+ * @param results - ranging results
+ * @param count   - number of results
+ *
+ * output parameters
+ * @param pos     - the fix, written on success only
+ *
+ * returns DWT_SUCCESS for a fix, or DWT_ERROR if the distances do not determine the position or it was rejected
+ */
+int rng_pos_solve(const rng_result_t *results, uint8 count, rng_pos_t *pos);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_pos_getstats()
+ *
+ * @brief Read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since rng_pos_init()
+ *
+ * no return value
+ */
+void rng_pos_getstats(rng_pos_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_POS_H_ */
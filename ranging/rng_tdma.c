@@ -0,0 +1,195 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tdma.c
+ * @brief   TDMA scheduler ranging a tag against several anchors per cycle
+ *
+ *          cycle n:  | slot 0: anchor 0 | slot 1: anchor 1 | ... |    idle    |
+ *                    ^ base             ^ base + slot            ^ base + period = base of cycle n+1
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_tdma.h"
+#include "deca_device_api.h"
+#ifdef CONFIG_DW1000_TXCOMP
+#include "deca_txcomp.h"
+#endif
+
+typedef struct
+{
+    rng_tdma_config_t cfg;
+    rng_tdma_cb_t cb;
+    uint32 slotTime;                    // in delayed TX time units
+    uint32 periodTime;
+    uint32 base;                        // start of the current cycle
+    volatile uint32 shift;              // delay of the next cycle, in delayed TX time units
+    uint8 slot;                         // slot in progress
+    uint8 late;                         // slots of the cycle missed
+    volatile uint8 running;
+    rng_result_t results[RNG_TDMA_MAX_ANCHORS];
+} rng_tdma_local_t;
+
+static rng_tdma_local_t tdma;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_next()
+ *
+ * @brief Arm the poll of the current slot, closing the cycle first when all of its slots are done. A slot whose
+ *        start has already passed is counted as failed and the next one is tried. When a whole cycle was missed
+ *        (e.g. the IRQ thread was held up) the schedule restarts from the current time.
+ */
+static void rng_tdma_next(void)
+{
+    while (tdma.running)
+    {
+        if (tdma.slot == tdma.cfg.anchorCnt)
+        {
+            if (tdma.cb != NULL)
+            {
+                tdma.cb(tdma.results, tdma.cfg.anchorCnt);
+            }
+
+            if (tdma.late == tdma.cfg.anchorCnt)
+            {
+                tdma.base = dwt_readsystimestamphi32() + (RNG_TDMA_START_MARGIN_UUS * RNG_TDMA_UUS_TO_DTU32);
+            }
+            else
+            {
+                tdma.base += tdma.periodTime;
+            }
+            tdma.base += tdma.shift;
+            tdma.shift = 0;
+            tdma.slot = 0;
+            tdma.late = 0;
+
+#ifdef CONFIG_DW1000_TXCOMP
+            /* TX compensation work between two cycles, when it fits before the first slot */
+            if ((int32)(tdma.base - dwt_readsystimestamphi32()) >
+                (int32)((DECA_TXCOMP_STEP_US + RNG_TDMA_START_MARGIN_UUS) * RNG_TDMA_UUS_TO_DTU32))
+            {
+                deca_txcomp_step();
+            }
+#endif
+        }
+
+        if (rng_initiate_at(tdma.cfg.anchors[tdma.slot], tdma.base + tdma.slot * tdma.slotTime) == DWT_SUCCESS)
+        {
+            return;
+        }
+
+        memset(&tdma.results[tdma.slot], 0, sizeof(rng_result_t));
+        tdma.results[tdma.slot].peer = tdma.cfg.anchors[tdma.slot];
+        tdma.results[tdma.slot].status = RNG_ERR_TX_LATE;
+        tdma.results[tdma.slot].fpPowerQ8 = DECA_RXQUAL_NONE;
+        tdma.results[tdma.slot].rxPowerQ8 = DECA_RXQUAL_NONE;
+        tdma.late++;
+        tdma.slot++;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_result_cb()
+ *
+ * @brief Result of the exchange of the current slot, moves on to the next one.
+ */
+static void rng_tdma_result_cb(const rng_result_t *result)
+{
+    if (!tdma.running)
+    {
+        return;
+    }
+
+    tdma.results[tdma.slot] = *result;
+    tdma.slot++;
+    rng_tdma_next();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_slotuus()
+ *
+ * @brief see rng_tdma.h
+ */
+uint32 rng_tdma_slotuus(const rng_config_t *rngCfg, uint16 guardUus)
+{
+    uint32 slot;
+
+    slot = (uint32)rngCfg->pollRxToRespTxDlyUus + rngCfg->respRxToFinalTxDlyUus + guardUus;
+    if (rngCfg->report)
+    {
+        slot += rngCfg->reportRxTimeoutUus;
+    }
+
+    return slot;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_start()
+ *
+ * @brief see rng_tdma.h
+ */
+int rng_tdma_start(const rng_config_t *rngCfg, const rng_tdma_config_t *cfg, rng_tdma_cb_t cb)
+{
+    uint32 slot_uus;
+
+    if ((rngCfg == NULL) || (cfg == NULL) || (cfg->anchorCnt == 0) || (cfg->anchorCnt > RNG_TDMA_MAX_ANCHORS) ||
+        (cfg->rateHz == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    slot_uus = cfg->slotUus ? cfg->slotUus : rng_tdma_slotuus(rngCfg, cfg->guardUus);
+
+    rng_tdma_stop();
+
+    tdma.cfg = *cfg;
+    tdma.cb = cb;
+    tdma.slotTime = slot_uus * RNG_TDMA_UUS_TO_DTU32;
+    tdma.periodTime = RNG_TDMA_SEC_TO_DTU32 / cfg->rateHz;
+
+    /* All the slots must be over before the next cycle starts */
+    if ((uint64_t)tdma.slotTime * cfg->anchorCnt > tdma.periodTime)
+    {
+        return DWT_ERROR;
+    }
+
+    if (rng_init(rngCfg, rng_tdma_result_cb) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+
+    tdma.slot = 0;
+    tdma.late = 0;
+    tdma.shift = 0;
+    tdma.base = dwt_readsystimestamphi32() + (RNG_TDMA_START_MARGIN_UUS * RNG_TDMA_UUS_TO_DTU32);
+    tdma.running = 1;
+    rng_tdma_next();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_shift()
+ *
+ * @brief see rng_tdma.h
+ */
+void rng_tdma_shift(uint32 uus)
+{
+    tdma.shift += uus * RNG_TDMA_UUS_TO_DTU32;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_stop()
+ *
+ * @brief see rng_tdma.h
+ */
+void rng_tdma_stop(void)
+{
+    tdma.running = 0;
+    rng_stop();
+}
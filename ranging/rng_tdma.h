@@ -0,0 +1,137 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tdma.h
+ * @brief   TDMA scheduler ranging a tag against several anchors per cycle
+ *
+ *          Each anchor owns a slot of the cycle. The poll of every slot is a
+ *          delayed TX at the slot start, so the schedule is laid on the DW1000
+ *          clock and does not drift with the interrupt latency. The next slot
+ *          is armed from the result of the previous one, no timer is involved.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_TDMA_H_
+#define _RNG_TDMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rng_twr.h"
+
+#define RNG_TDMA_MAX_ANCHORS        8
+
+// DW1000 delayed TX time units (high 32 bits of the 40-bit system time, 512/499.2 MHz / 2 = ~4 ns)
+#define RNG_TDMA_UUS_TO_DTU32       (RNG_UUS_TO_DWT_TIME >> 8)
+#define RNG_TDMA_SEC_TO_DTU32       249600000UL
+
+// First slot of a (re)started schedule: leaves time to write the poll
+#define RNG_TDMA_START_MARGIN_UUS   1000
+
+/* Timings for the 6.8 Mbps, 128 symbols preamble configuration of the examples, giving ~3.3 ms slots so that 8
+ * anchors fit a 30 Hz cycle and 4 a 50 Hz one. They rely on the fast SPI rate and a short IRQ latency. */
+#define RNG_CONFIG_FAST(own_addr) {     \
+    .panId = 0xDECA,                    \
+    .filter = 1,                        \
+    .addr = (own_addr),                 \
+    .txAntDly = 16436,                  \
+    .pollTxToRespRxDlyUus = 1200,       \
+    .respRxToFinalTxDlyUus = 1500,      \
+    .respRxTimeoutUus = 1000,           \
+    .pollRxToRespTxDlyUus = 1500,       \
+    .respTxToFinalRxDlyUus = 1200,      \
+    .finalRxTimeoutUus = 1000,          \
+    .report = 1,                        \
+    .reportRxTimeoutUus = 1500,         \
+    .bcastSlotUus = 600,                \
+    .ssPollTxToRespRxDlyUus = 140,      \
+    .ssRespRxTimeoutUus = 510,          \
+    .ssPollRxToRespTxDlyUus = 630,      \
+    .adapt = 0,                         \
+    .adaptMarginUus = 100,              \
+    .adaptAirUus = 300,                 \
+}
+
+typedef struct
+{
+    uint16 anchors[RNG_TDMA_MAX_ANCHORS];   // short address of the anchor of each slot
+    uint8 anchorCnt;
+    uint8 rateHz;                           // cycles per second
+    uint16 guardUus;                        // added to each slot, covers the airtime of the last frame and clock drift
+    uint16 slotUus;                         // 0 to derive the slot length from the ranging timings
+} rng_tdma_config_t;
+
+/* Cycle callback: one result per anchor, in slot order, from the DW1000 IRQ thread. The distance is only known to
+ * the tag when the ranging configuration uses the report message. */
+typedef void (*rng_tdma_cb_t)(const rng_result_t *results, uint8 count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_slotuus()
+ *
+ * @brief Return the slot length the scheduler derives from the ranging timings: poll to response, response to final
+ *        and, with the report, the report timeout, plus the guard time.
+ *
+ * input parameters
+ * @param rngCfg   - ranging configuration
+ * @param guardUus - guard time
+ *
+ * output parameters
+ *
+ * returns the slot length in UWB microseconds
+ */
+uint32 rng_tdma_slotuus(const rng_config_t *rngCfg, uint16 guardUus);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_start()
+ *
+ * @brief Start ranging against the anchors cycle after cycle. This takes over the ranging engine (rng_init).
+ *
+ * input parameters
+ * @param rngCfg - ranging configuration, the initiator timings are used
+ * @param cfg    - anchors and cycle, copied
+ * @param cb     - called at the end of every cycle
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the slots do not fit in the cycle
+ */
+int rng_tdma_start(const rng_config_t *rngCfg, const rng_tdma_config_t *cfg, rng_tdma_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_stop()
+ *
+ * @brief Stop the schedule, the exchange in progress is aborted.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_tdma_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdma_shift()
+ *
+ * @brief Delay the schedule, from the next cycle on, e.g. to move the slots away from other radio activity. The
+ *        shifts requested during a cycle add up.
+ *
+ * input parameters
+ * @param uus - delay in UWB microseconds
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_tdma_shift(uint32 uus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_TDMA_H_ */
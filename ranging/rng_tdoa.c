@@ -0,0 +1,596 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tdoa.c
+ * @brief   TDoA blink tag and anchor capture
+ *
+ *          tag:    | wake-up | blink | DEEPSLEEP: periodMs +/- jitterMs | wake-up | blink | ...
+ *          anchor: | RX | blink: RX on, stamp, batch | RX | ... | batch full or batchMs: callback
+ *          sync:   reference | RX | sync (delayed TX, TX timestamp) | RX | ... syncMs ... | sync | ...
+ *                  others    | RX | sync: offset, skew | RX | blink: stamp, to the reference timebase | ...
+ *          wired:  reference | arm reset, SYNC pulse: all system times restart | ... syncMs ... | check, arm, pulse | ...
+ *                  others    | arm reset | ... syncMs ... | check: reset seen | RX | blink: stamp, plus line delay | ...
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_tdoa.h"
+#include "deca_regs.h"
+#include "deca_ts.h"
+#include "rng_tof.h"
+#include "deca_pm.h"
+#include "port.h"
+
+#include <zephyr.h>
+
+#define RNG_TDOA_INT_MASK       (DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO | DWT_INT_RPHE | DWT_INT_RFCE | \
+                                 DWT_INT_RFSL | DWT_INT_SFDT)
+
+/* Device time units per ms, 63.8976 GHz */
+#define RNG_TDOA_MS_DTU         63897600ULL
+
+typedef struct
+{
+    rng_tdoa_tag_config_t cfg;
+    uint8 seq;
+    uint8 asleep;                       // a blink put the DW1000 to DEEPSLEEP
+    uint32 rand;                        // interval generator state, never 0
+    uint8 msg[RNG_TDOA_BLINK_LEN];
+    rng_tdoa_tag_stats_t stats;
+} rng_tdoa_tag_t;
+
+typedef struct
+{
+    rng_tdoa_batch_cb_t cb;
+    uint16 batchMs;
+    uint8 count;
+    struct k_delayed_work work;         // batchMs after the first blink of the batch
+    rng_tdoa_rx_t batch[RNG_TDOA_BATCH_MAX];
+    // clock synchronisation
+    rng_tdoa_sync_config_t sync;
+    uint8 syncOn;
+    uint8 isRef;
+    uint8 syncSeq;
+    float ciToPpb;                      // carrier integrator to clock offset, ppb
+    uint64_t tofDtu;                    // time of flight from the reference
+    uint64_t lastLocal;                 // own RX timestamp of the last sync
+    uint64_t lastRef;                   // reference time at that RX
+    uint32 lastSyncMs;                  // uptime of the last sync
+    struct k_delayed_work syncWork;     // reference: next sync frame
+    // wired synchronisation, lastLocal is the system time at the last check then
+    rng_tdoa_wired_config_t wired;
+    uint8 isWired;
+    uint32 lastCheckMs;                 // uptime of the last check
+    struct k_delayed_work wiredWork;    // next check, and SYNC pulse of the reference
+    rng_tdoa_anchor_stats_t stats;
+} rng_tdoa_anchor_t;
+
+static rng_tdoa_tag_t tag;
+static rng_tdoa_anchor_t anc;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rand()
+ *
+ * @brief Interval generator, xorshift32.
+ */
+static uint32 tdoa_rand(void)
+{
+    uint32 x = tag.rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tag.rand = x;
+
+    return x;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_tag_init()
+ *
+ * @brief see rng_tdoa.h
+ */
+int rng_tdoa_tag_init(const rng_tdoa_tag_config_t *config)
+{
+    if ((config == NULL) || (config->jitterMs >= config->periodMs))
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&tag, 0, sizeof(tag));
+    tag.cfg = *config;
+    tag.rand = (uint32)config->id ^ (uint32)(config->id >> 32) ^ dwt_getpartid();
+    if (tag.rand == 0)
+    {
+        tag.rand = 1;
+    }
+
+    tag.msg[0] = RNG_TDOA_FC_BLINK;
+    memcpy(&tag.msg[RNG_TDOA_ID_IDX], &tag.cfg.id, sizeof(tag.cfg.id));
+
+    /* An active interrupt would keep the DW1000 awake after the TX, see example 1c */
+    dwt_setinterrupt(RNG_TDOA_INT_MASK, 0);
+    dwt_configuresleep(DWT_PRESRV_SLEEP | DWT_CONFIG, DWT_WAKE_CS | DWT_SLP_EN);
+    dwt_entersleepaftertx(1);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_blink()
+ *
+ * @brief see rng_tdoa.h
+ */
+uint32 rng_tdoa_blink(void)
+{
+    uint32 span = 2 * (uint32)tag.cfg.jitterMs + 1;
+
+    if (tag.asleep && (deca_pm_wakeup() != DWT_SUCCESS))
+    {
+        tag.stats.wakeFails++;
+    }
+    else
+    {
+        tag.msg[RNG_TDOA_SN_IDX] = tag.seq++;
+        dwt_writetxdata(RNG_TDOA_BLINK_LEN, tag.msg, 0); /* Zero offset in TX buffer. */
+        dwt_writetxfctrl(RNG_TDOA_BLINK_LEN, 0, 1); /* Zero offset in TX buffer, ranging. */
+        dwt_starttx(DWT_START_TX_IMMEDIATE);
+        tag.asleep = 1;
+        tag.stats.blinks++;
+    }
+
+    return tag.cfg.periodMs - tag.cfg.jitterMs + (tdoa_rand() % span);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_tag_getstats()
+ *
+ * @brief see rng_tdoa.h
+ */
+void rng_tdoa_tag_getstats(rng_tdoa_tag_stats_t *stats)
+{
+    *stats = tag.stats;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_flush()
+ *
+ * @brief Anchor: hand the current batch over and start a new one.
+ */
+static void tdoa_flush(void)
+{
+    uint8 count = anc.count;
+
+    if (count == 0)
+    {
+        return;
+    }
+    anc.count = 0;
+    anc.stats.batches++;
+    anc.cb(anc.batch, count);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_work_handler()
+ *
+ * @brief Anchor: batchMs since the first blink of the batch, on the DW1000 IRQ work queue.
+ */
+static void tdoa_work_handler(struct k_work *item)
+{
+    tdoa_flush();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_synced()
+ *
+ * @brief Anchor: the clock model is valid, a sync came within the last RNG_TDOA_SYNC_LOST periods.
+ */
+static int tdoa_synced(void)
+{
+    uint16 period = anc.isWired ? anc.wired.syncMs : anc.sync.syncMs;
+
+    return anc.stats.synced && ((k_uptime_get_32() - anc.lastSyncMs) < RNG_TDOA_SYNC_LOST * (uint32)period);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_inref()
+ *
+ * @brief Anchor: the blinks are in the reference timebase, as the radio reference itself or by a valid model.
+ */
+static int tdoa_inref(void)
+{
+    return anc.syncOn && ((anc.isRef && !anc.isWired) || tdoa_synced());
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_toref()
+ *
+ * @brief Anchor: own timestamp to the reference timebase with the clock model. Timestamps before the last sync give a
+ *        negative interval.
+ */
+static uint64_t tdoa_toref(uint64_t ts)
+{
+    int64_t dl = (int64_t)deca_ts_sub(ts, anc.lastLocal);
+
+    if (dl >= ((int64_t)1 << 39))
+    {
+        dl -= (int64_t)1 << 40;
+    }
+
+    return deca_ts_add(anc.lastRef, (uint64_t)(dl + (dl * anc.stats.skewPpb) / 1000000000));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_syncrx()
+ *
+ * @brief Anchor: sync frame from the reference received at ts, its carrier integrator read. Update the model, see
+ *        rng_tdoa.h.
+ */
+static void tdoa_syncrx(const uint8 *frame, uint64_t ts, int32 ci)
+{
+    uint64_t ref = deca_ts_add(deca_ts_unpack(&frame[RNG_TDOA_SYNC_TS_IDX], DECA_TS_LEN), anc.tofDtu);
+    int32 cfo_ppb = (int32)(ci * anc.ciToPpb);
+    int64_t dl, dr, meas;
+
+    if (tdoa_synced())
+    {
+        dl = (int64_t)deca_ts_sub(ts, anc.lastLocal);
+        dr = (int64_t)deca_ts_sub(ref, anc.lastRef);
+        /* Prediction error, 40-bit difference to signed */
+        anc.stats.residualDtu = (int32)(((int64_t)(deca_ts_sub(ref, tdoa_toref(ts)) << 24)) >> 24);
+
+        meas = (dl != 0) ? (((dr - dl) * 1000000000) / dl) : cfo_ppb;
+        if ((meas - cfo_ppb > RNG_TDOA_SKEW_TOL_PPB) || (cfo_ppb - meas > RNG_TDOA_SKEW_TOL_PPB))
+        {
+            anc.stats.skewPpb = cfo_ppb;
+            anc.stats.skewResets++;
+        }
+        else
+        {
+            anc.stats.skewPpb += (int32)((meas - anc.stats.skewPpb) / 4);
+        }
+    }
+    else
+    {
+        anc.stats.skewPpb = cfo_ppb;
+        anc.stats.residualDtu = 0;
+        anc.stats.synced = 1;
+    }
+
+    anc.lastLocal = ts;
+    anc.lastRef = ref;
+    anc.lastSyncMs = k_uptime_get_32();
+    anc.stats.syncs++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_sync_work_handler()
+ *
+ * @brief Reference anchor: send the next sync frame, on the DW1000 IRQ work queue. Its TX timestamp is known before
+ *        it goes out, see deca_ts_dlytxts().
+ */
+static void tdoa_sync_work_handler(struct k_work *item)
+{
+    uint8 msg[RNG_TDOA_SYNC_LEN];
+    uint32 tx_time;
+
+    dwt_forcetrxoff();
+    tx_time = deca_ts_dlytime(deca_ts_readsys(), RNG_TDOA_SYNC_DLY_UUS);
+
+    msg[0] = RNG_TDOA_FC_BLINK;
+    msg[RNG_TDOA_SN_IDX] = anc.syncSeq++;
+    memcpy(&msg[RNG_TDOA_ID_IDX], &anc.sync.ownId, sizeof(anc.sync.ownId));
+    deca_ts_pack(&msg[RNG_TDOA_SYNC_TS_IDX], deca_ts_dlytxts(tx_time, anc.sync.txAntDly), DECA_TS_LEN);
+
+    dwt_writetxdata(RNG_TDOA_SYNC_LEN, msg, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(RNG_TDOA_SYNC_LEN, 0, 1); /* Zero offset in TX buffer, ranging. */
+    dwt_setdelayedtrxtime(tx_time);
+    if (dwt_starttx(DWT_START_TX_DELAYED) == DWT_SUCCESS)
+    {
+        anc.stats.syncs++;
+    }
+    else
+    {
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    }
+
+    port_submit_deca_work(&anc.syncWork, anc.sync.syncMs);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_wired_work_handler()
+ *
+ * @brief Wired anchor: every syncMs, on the DW1000 IRQ work queue. A SYNC reset since the last check shows as a step
+ *        of the system time against the uptime. The reset is armed again, in case the SYNC edge disarmed it, and the
+ *        reference pulses the line.
+ */
+static void tdoa_wired_work_handler(struct k_work *item)
+{
+    uint64_t sys = deca_ts_readsys();
+    uint32 now = k_uptime_get_32();
+    int64_t tol = (int64_t)(RNG_TDOA_WIRED_TOL_MS + anc.wired.syncMs / 1000) * RNG_TDOA_MS_DTU;
+    uint64_t expect = deca_ts_add(anc.lastLocal, (uint64_t)(now - anc.lastCheckMs) * RNG_TDOA_MS_DTU);
+    /* 40-bit difference to signed */
+    int64_t step = ((int64_t)(deca_ts_sub(expect, sys) << 24)) >> 24;
+
+    if ((step > tol) || (step < -tol))
+    {
+        anc.stats.synced = 1;
+        anc.lastSyncMs = now;
+        anc.stats.syncs++;
+    }
+    anc.lastLocal = sys;
+    anc.lastCheckMs = now;
+
+    dwt_configextsync(DWT_EXTSYNC_TBRESET, anc.wired.wait);
+    if (anc.isRef)
+    {
+        port_pulse_dw1000_sync();
+    }
+
+    port_submit_deca_work(&anc.wiredWork, anc.wired.syncMs);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_txdone_cb()
+ *
+ * @brief Reference anchor: sync frame sent, listen again.
+ */
+static void tdoa_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rxok_cb()
+ *
+ * @brief Anchor: frame received, dwt_fastisr() has read its timestamp and first bytes. The receiver is turned back on
+ *        first so that the next blink is not missed, after reading the carrier integrator of a sync frame.
+ */
+static void tdoa_rxok_cb(const dwt_cb_data_t *cb_data)
+{
+    uint8 msg[RNG_TDOA_SYNC_LEN];
+    const uint8 *frame = cb_data->prefix;
+    rng_tdoa_rx_t *rx;
+    uint64_t ts = 0, id;
+    uint16 len = cb_data->datalength;
+    int32 ci = 0;
+
+    if (!(cb_data->rx_flags & DWT_CB_DATA_RX_FLAG_FAST))
+    {
+        /* Installed over another handler: read what dwt_fastisr() would have */
+        ts = deca_ts_readrx();
+        if ((len == RNG_TDOA_BLINK_LEN) || (len == RNG_TDOA_SYNC_LEN))
+        {
+            dwt_readrxdata(msg, len, 0);
+        }
+        frame = msg;
+    }
+    else
+    {
+        memcpy(&ts, cb_data->rx_stamp, DECA_TS_LEN);
+    }
+
+    /* Valid until the receiver is enabled again */
+    if ((len == RNG_TDOA_SYNC_LEN) && anc.syncOn && !anc.isRef && !anc.isWired)
+    {
+        ci = dwt_readcarrierintegrator();
+    }
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+    if (((len != RNG_TDOA_BLINK_LEN) && (len != RNG_TDOA_SYNC_LEN)) || (frame[0] != RNG_TDOA_FC_BLINK))
+    {
+        anc.stats.others++;
+        return;
+    }
+    memcpy(&id, &frame[RNG_TDOA_ID_IDX], sizeof(id));
+
+    if (len == RNG_TDOA_SYNC_LEN)
+    {
+        if (anc.syncOn && !anc.isRef && !anc.isWired && (id == anc.sync.refId))
+        {
+            tdoa_syncrx(frame, ts, ci);
+        }
+        else
+        {
+            anc.stats.others++;
+        }
+        return;
+    }
+
+    rx = &anc.batch[anc.count];
+    rx->tagId = id;
+    rx->seq = frame[RNG_TDOA_SN_IDX];
+    rx->synced = tdoa_inref();
+    rx->rxTs = ts;
+    if (rx->synced && anc.isWired)
+    {
+        rx->rxTs = deca_ts_add(ts, (uint64_t)(int64_t)anc.wired.lineDlyDtu);
+    }
+    else if (rx->synced && !anc.isRef)
+    {
+        rx->rxTs = tdoa_toref(ts);
+    }
+    anc.stats.blinks++;
+
+    if (++anc.count == RNG_TDOA_BATCH_MAX)
+    {
+        k_delayed_work_cancel(&anc.work);
+        tdoa_flush();
+    }
+    else if (anc.count == 1)
+    {
+        port_submit_deca_work(&anc.work, anc.batchMs);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdoa_rxerr_cb()
+ *
+ * @brief Anchor: RX error or timeout, dwt_isr has already reset the receiver.
+ */
+static void tdoa_rxerr_cb(const dwt_cb_data_t *cb_data)
+{
+    anc.stats.errors++;
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_start()
+ *
+ * @brief see rng_tdoa.h
+ */
+int rng_tdoa_anchor_start(uint16 batchMs, rng_tdoa_batch_cb_t cb)
+{
+    if (cb == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    memset(&anc, 0, sizeof(anc));
+    anc.cb = cb;
+    anc.batchMs = batchMs;
+    k_delayed_work_init(&anc.work, tdoa_work_handler);
+
+    k_delayed_work_init(&anc.syncWork, tdoa_sync_work_handler);
+    k_delayed_work_init(&anc.wiredWork, tdoa_wired_work_handler);
+
+    dwt_setfastisrprefix(RNG_TDOA_SYNC_LEN);
+    dwt_setcallbacks(tdoa_txdone_cb, tdoa_rxok_cb, tdoa_rxerr_cb, tdoa_rxerr_cb);
+    dwt_setinterrupt(RNG_TDOA_INT_MASK, 1);
+    port_set_deca_isr(dwt_fastisr);
+
+    dwt_setrxtimeout(0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_sync()
+ *
+ * @brief see rng_tdoa.h
+ */
+int rng_tdoa_anchor_sync(const rng_tdoa_sync_config_t *config)
+{
+    decaIrqStatus_t stat;
+    float factor;
+
+    if ((config == NULL) || (config->phy == NULL) || (config->syncMs == 0))
+    {
+        return DWT_ERROR;
+    }
+    factor = rng_tof_clkfactor(config->phy);
+    if (factor == 0.0f)
+    {
+        return DWT_ERROR;
+    }
+
+    stat = decamutexon();
+    if (anc.isWired)
+    {
+        k_delayed_work_cancel(&anc.wiredWork);
+        dwt_configextsync(DWT_EXTSYNC_OFF, 0);
+        anc.isWired = 0;
+    }
+    anc.sync = *config;
+    anc.sync.phy = NULL;
+    anc.isRef = (config->ownId == config->refId);
+    anc.ciToPpb = factor * 1.0e9f;
+    anc.tofDtu = ((uint64_t)config->refDistMm << 16) / RNG_DTU_TO_MM_Q16;
+    anc.stats.synced = 0;
+    anc.syncOn = 1;
+    decamutexoff(stat);
+
+    if (anc.isRef)
+    {
+        port_submit_deca_work(&anc.syncWork, anc.sync.syncMs);
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_wiredsync()
+ *
+ * @brief see rng_tdoa.h
+ */
+int rng_tdoa_anchor_wiredsync(const rng_tdoa_wired_config_t *config)
+{
+    decaIrqStatus_t stat;
+    int ret = DWT_SUCCESS;
+
+    if ((config == NULL) || (config->syncMs == 0))
+    {
+        return DWT_ERROR;
+    }
+
+    stat = decamutexon();
+    k_delayed_work_cancel(&anc.syncWork);
+    anc.wired = *config;
+    anc.isWired = 1;
+    anc.isRef = config->isRef;
+    anc.stats.synced = 0;
+    anc.stats.skewPpb = 0;
+    anc.stats.residualDtu = 0;
+
+    /* The first check takes the time before the first pulse */
+    dwt_configextsync(DWT_EXTSYNC_TBRESET, config->wait);
+    anc.lastLocal = deca_ts_readsys();
+    anc.lastCheckMs = k_uptime_get_32();
+    if (anc.isRef && (port_pulse_dw1000_sync() != 0))
+    {
+        dwt_configextsync(DWT_EXTSYNC_OFF, 0);
+        anc.isWired = 0;
+        ret = DWT_ERROR;
+    }
+    anc.syncOn = (ret == DWT_SUCCESS);
+    decamutexoff(stat);
+
+    if (ret == DWT_SUCCESS)
+    {
+        port_submit_deca_work(&anc.wiredWork, config->syncMs);
+    }
+
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_stop()
+ *
+ * @brief see rng_tdoa.h
+ */
+void rng_tdoa_anchor_stop(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    anc.syncOn = 0;
+    k_delayed_work_cancel(&anc.syncWork);
+    k_delayed_work_cancel(&anc.wiredWork);
+    if (anc.isWired)
+    {
+        dwt_configextsync(DWT_EXTSYNC_OFF, 0);
+        anc.isWired = 0;
+    }
+    dwt_forcetrxoff();
+    k_delayed_work_cancel(&anc.work);
+    tdoa_flush();
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_getstats()
+ *
+ * @brief see rng_tdoa.h
+ */
+void rng_tdoa_anchor_getstats(rng_tdoa_anchor_stats_t *stats)
+{
+    *stats = anc.stats;
+    stats->synced = tdoa_inref();
+}
@@ -0,0 +1,288 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tdoa.h
+ * @brief   TDoA blink tag and anchor capture
+ *
+ *          Tag: sends the 12-byte 802.15.4e blink of example 1c (frame
+ *          type, sequence number, 64-bit ID) and nothing else, the DW1000
+ *          goes to DEEPSLEEP at the end of each one (dwt_entersleepaftertx()).
+ *          Blinks are ALOHA: nothing is listened to, the interval is drawn
+ *          in periodMs +/- jitterMs each time, so two tags that collided
+ *          once drift apart. At 6.8 Mbps with a 128 symbol preamble a
+ *          blink is about 170 us on air: a cell takes hundreds of tags at
+ *          a few Hz before collisions matter.
+ *
+ *          Anchor: listens continuously, each blink received is stamped
+ *          with its RX timestamp, read by dwt_fastisr() along with the
+ *          frame in one SPI transaction, and added to a batch. The batch
+ *          goes to the application once full or batchMs after its first
+ *          blink, from the DW1000 IRQ thread, to be forwarded to the
+ *          positioning engine.
+ *
+ *          Anchor clock synchronisation (rng_tdoa_anchor_sync()): the
+ *          reference anchor sends a sync frame every syncMs, a delayed TX
+ *          whose TX timestamp it carries. Every other anchor keeps a linear
+ *          model of the reference clock against its own, offset and skew:
+ *          - offset: reference TX timestamp plus the time of flight over
+ *            the known anchor distance, at the sync RX timestamp;
+ *          - skew: reference against own clock over the interval between
+ *            two syncs, smoothed. The first sync, and one whose interval
+ *            disagrees with its carrier integrator by more than
+ *            RNG_TDOA_SKEW_TOL_PPB (sync missed or corrupted), take the
+ *            skew of the carrier integrator instead.
+ *          Blinks are then reported in the reference timebase, the backend
+ *          needs neither the sync frames nor the carrier offsets.
+ *
+ *          Wired synchronisation (rng_tdoa_anchor_wiredsync()), for fixed
+ *          installations whose anchors share the 38.4 MHz reference clock
+ *          and a SYNC line: every anchor keeps dwt_configextsync() in
+ *          timebase reset mode and the reference drives the line every
+ *          syncMs (port_pulse_dw1000_sync()), so all the system times
+ *          restart from 0 on the same clock edge. There is no skew to
+ *          follow and no sync frame on air: the channel time and the
+ *          receiver time they took go to the blinks, and the alignment is
+ *          that of the wiring rather than of a radio link. Each anchor only
+ *          adds its surveyed line delay. A reset is seen as a step of the
+ *          system time against the uptime, at the next check.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_TDOA_H_
+#define _RNG_TDOA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Blink frame, see example 1c: the length includes the 2-byte FCS added by the DW1000
+#define RNG_TDOA_FC_BLINK           0xC5
+#define RNG_TDOA_SN_IDX             1
+#define RNG_TDOA_ID_IDX             2
+#define RNG_TDOA_BLINK_LEN          12
+
+// Sync frame: a blink carrying the ID of the reference anchor and its TX timestamp
+#define RNG_TDOA_SYNC_TS_IDX        10
+#define RNG_TDOA_SYNC_LEN           17
+
+// Time from the sync send to its delayed TX, leaves time to write it
+#define RNG_TDOA_SYNC_DLY_UUS       500
+
+// Largest difference between the interval and carrier integrator skews, ppb
+#define RNG_TDOA_SKEW_TOL_PPB       2000
+
+// Model dropped after that many sync periods without a sync
+#define RNG_TDOA_SYNC_LOST          4
+
+// Wired: step of the system time against the uptime taken for a SYNC reset, ms, plus 1 ms per second of syncMs
+#define RNG_TDOA_WIRED_TOL_MS       2
+
+// Blinks per batch handed to the application
+#ifdef CONFIG_DW1000_TDOA_BATCH
+#define RNG_TDOA_BATCH_MAX          CONFIG_DW1000_TDOA_BATCH
+#else
+#define RNG_TDOA_BATCH_MAX          16
+#endif
+
+typedef struct
+{
+    uint64_t id;                        // tag ID sent in the blink, unique per device (see NOTE 1 of example 1c)
+    uint16 periodMs;                    // average time between two blinks
+    uint16 jitterMs;                    // blink interval spread around periodMs, less than periodMs
+} rng_tdoa_tag_config_t;
+
+#define RNG_TDOA_TAG_CONFIG_DEFAULT(tag_id) { \
+    .id = (tag_id),                     \
+    .periodMs = 100,                    \
+    .jitterMs = 10,                     \
+}
+
+typedef struct
+{
+    uint32 blinks;
+    uint32 wakeFails;                   // DW1000 not out of DEEPSLEEP, blink not sent
+} rng_tdoa_tag_stats_t;
+
+typedef struct
+{
+    uint64_t ownId;                     // ID this anchor sends sync frames with, if it is the reference
+    uint64_t refId;                     // ID of the reference anchor
+    uint16 syncMs;                      // sync period of the reference
+    uint32 refDistMm;                   // distance to the reference anchor, surveyed, 0 for the reference
+    uint16 txAntDly;                    // reference: TX antenna delay, added to the TX timestamp
+    const dwt_config_t *phy;            // PHY in use, for the carrier integrator scale
+} rng_tdoa_sync_config_t;
+
+typedef struct
+{
+    uint8 isRef;                        // this anchor drives the SYNC line
+    uint8 wait;                         // 38.4 MHz cycles from the SYNC edge to the reset, see dwt_configextsync()
+    uint16 syncMs;                      // SYNC period of the reference
+    int32 lineDlyDtu;                   // added to the timestamps: this anchor resets that much after the reference
+} rng_tdoa_wired_config_t;
+
+#define RNG_TDOA_WIRED_CONFIG_DEFAULT(is_ref) { \
+    .isRef = (is_ref),                  \
+    .wait = 0,                          \
+    .syncMs = 1000,                     \
+    .lineDlyDtu = 0,                    \
+}
+
+/* One blink received by the anchor */
+typedef struct
+{
+    uint64_t tagId;
+    uint64_t rxTs;                      // RX timestamp, 40 bits: reference clock if synced, own clock otherwise
+    uint8 seq;                          // sequence number of the blink
+    uint8 synced;                       // rxTs is in the reference timebase
+} rng_tdoa_rx_t;
+
+typedef struct
+{
+    uint32 blinks;
+    uint32 others;                      // frames other than a blink or a sync from the reference
+    uint32 errors;                      // RX errors
+    uint32 batches;
+    uint32 syncs;                       // reference: sync frames sent / others: received / wired: resets seen
+    uint32 skewResets;                  // skew taken from the carrier integrator after the first sync
+    uint8 synced;                       // model valid
+    int32 skewPpb;                      // reference clock rate against own clock, minus one, ppb
+    int32 residualDtu;                  // error of the model at the last sync, device time units
+} rng_tdoa_anchor_stats_t;
+
+/* Anchor: batch of blinks in RX order, from the DW1000 IRQ thread. rx is only valid during the call. */
+typedef void (*rng_tdoa_batch_cb_t)(const rng_tdoa_rx_t *rx, uint8 count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_tag_init()
+ *
+ * @brief Tag: set the blink configuration, DEEPSLEEP after each TX and chip select wake-up. The DW1000 must have
+ *        been initialised and configured, its interrupts are masked so that it can sleep after the TX.
+ *
+ * input parameters
+ * @param config - tag ID and blink timing, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or jitterMs not below periodMs
+ */
+int rng_tdoa_tag_init(const rng_tdoa_tag_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_blink()
+ *
+ * @brief Tag: wake the DW1000 up if a previous blink put it to sleep and send the next blink, then return at once:
+ *        the DW1000 goes to DEEPSLEEP on its own at the end of the frame. Typically k_sleep(rng_tdoa_blink()) in a
+ *        loop.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the time until the next blink in ms, drawn in periodMs +/- jitterMs
+ */
+uint32 rng_tdoa_blink(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_tag_getstats()
+ *
+ * @brief Tag: read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since rng_tdoa_tag_init()
+ *
+ * no return value
+ */
+void rng_tdoa_tag_getstats(rng_tdoa_tag_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_start()
+ *
+ * @brief Anchor: install dwt_fastisr() and its callbacks and listen for blinks. The DW1000 must have been initialised
+ *        with the LDE microcode and configured.
+ *
+ * input parameters
+ * @param batchMs - longest time a blink waits in a batch
+ * @param cb      - called with each batch
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if cb is NULL
+ */
+int rng_tdoa_anchor_start(uint16 batchMs, rng_tdoa_batch_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_sync()
+ *
+ * @brief Anchor: take part in the clock synchronisation, after rng_tdoa_anchor_start(). The reference (ownId equal
+ *        to refId) starts sending sync frames, the others follow them.
+ *
+ * input parameters
+ * @param config - IDs, period and distance to the reference, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config or its PHY is NULL, syncMs is 0 or the channel unknown
+ */
+int rng_tdoa_anchor_sync(const rng_tdoa_sync_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_wiredsync()
+ *
+ * @brief Anchor: take part in the wired synchronisation instead, after rng_tdoa_anchor_start(). All anchors arm the
+ *        timebase reset, the reference starts pulsing the SYNC line. Blinks are reported as synced from the first reset
+ *        seen until RNG_TDOA_SYNC_LOST periods without one.
+ *
+ * input parameters
+ * @param config - role, period and line delay, copied
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL, syncMs is 0 or the reference has no SYNC line
+ */
+int rng_tdoa_anchor_wiredsync(const rng_tdoa_wired_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_stop()
+ *
+ * @brief Anchor: stop the synchronisation, also the timebase reset, turn the receiver off and hand the blinks of the
+ *        current batch over.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_tdoa_anchor_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tdoa_anchor_getstats()
+ *
+ * @brief Anchor: read the counters.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param stats - counters since rng_tdoa_anchor_start()
+ *
+ * no return value
+ */
+void rng_tdoa_anchor_getstats(rng_tdoa_anchor_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_TDOA_H_ */
@@ -0,0 +1,133 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tof.c
+ * @brief   Time of flight and distance computation without double precision
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "rng_tof.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ds()
+ *
+ * @brief see rng_tof.h
+ */
+int32 rng_tof_ds(uint32 ra, uint32 rb, uint32 da, uint32 db)
+{
+    uint64_t p1 = (uint64_t)ra * rb;
+    uint64_t p2 = (uint64_t)da * db;
+    uint64_t num, den;
+    int neg = 0;
+    uint64_t q;
+
+    /* The 32x32 bit products fit in 64 bits, their difference may be negative at very short range */
+    if (p1 >= p2)
+    {
+        num = p1 - p2;
+    }
+    else
+    {
+        num = p2 - p1;
+        neg = 1;
+    }
+    den = (uint64_t)ra + rb + da + db;
+    if (den == 0)
+    {
+        return 0;
+    }
+
+    /* Keep the fraction when the numerator leaves room for it, always the case for exchanges below ~16 ms */
+    if (num < ((uint64_t)1 << (64 - RNG_TOF_Q)))
+    {
+        q = ((num << RNG_TOF_Q) + den / 2) / den;
+    }
+    else
+    {
+        q = ((num + den / 2) / den) << RNG_TOF_Q;
+    }
+
+    return neg ? -(int32)q : (int32)q;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ds_f()
+ *
+ * @brief see rng_tof.h
+ *
+ *        With x = Ra - Db and y = Rb - Da: Ra * Rb - Da * Db = Db * y + Da * x + x * y
+ */
+float rng_tof_ds_f(uint32 ra, uint32 rb, uint32 da, uint32 db)
+{
+    float x = (float)(int32)(ra - db);
+    float y = (float)(int32)(rb - da);
+    float den = (float)ra + (float)rb + (float)da + (float)db;
+
+    if (den == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    return ((float)db * y + (float)da * x + x * y) / den;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ss_f()
+ *
+ * @brief see rng_tof.h
+ */
+float rng_tof_ss_f(uint32 rtdInit, uint32 rtdResp, float clkOffset)
+{
+    return ((float)(int32)(rtdInit - rtdResp) + (float)rtdResp * clkOffset) / 2.0f;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_to_mm()
+ *
+ * @brief see rng_tof.h
+ */
+int32 rng_tof_to_mm(int32 tof)
+{
+    int64_t mm = (int64_t)tof * RNG_DTU_TO_MM_Q16;
+
+    return (int32)((mm + ((int64_t)1 << (15 + RNG_TOF_Q))) >> (16 + RNG_TOF_Q));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_clkfactor()
+ *
+ * @brief see rng_tof.h
+ */
+float rng_tof_clkfactor(const dwt_config_t *phy)
+{
+    float hz_to_ppm, freq_offset;
+
+    /* Channels 4 and 7 share the centre frequency of channels 2 and 5, the constants are folded at compile time */
+    switch (phy->chan)
+    {
+    case 1:
+        hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_1;
+        break;
+    case 2:
+    case 4:
+        hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_2;
+        break;
+    case 3:
+        hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_3;
+        break;
+    case 5:
+    case 7:
+        hz_to_ppm = (float)HERTZ_TO_PPM_MULTIPLIER_CHAN_5;
+        break;
+    default:
+        return 0.0f;
+    }
+
+    freq_offset = (phy->dataRate == DWT_BR_110K) ? (float)FREQ_OFFSET_MULTIPLIER_110KB : (float)FREQ_OFFSET_MULTIPLIER;
+
+    return freq_offset * hz_to_ppm / 1.0e6f;
+}
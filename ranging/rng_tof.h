@@ -0,0 +1,119 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_tof.h
+ * @brief   Time of flight and distance computation without double precision
+ *
+ *          The nRF52832 FPU is single precision, double arithmetic is done in
+ *          software. The integer version is exact, the float version is
+ *          arranged so that single precision loses nothing that matters.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_TOF_H_
+#define _RNG_TOF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_types.h"
+#include "deca_device_api.h"
+
+// Fractional bits of the fixed point TOF values, in device time units
+#define RNG_TOF_Q                   8
+
+// Millimetres per device time unit (DWT_TIME_UNITS * RNG_SPEED_OF_LIGHT * 1000 = 4.6904), Q16
+#define RNG_DTU_TO_MM_Q16           307387
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ds()
+ *
+ * @brief Asymmetric DS-TWR time of flight (Ra * Rb - Da * Db) / (Ra + Rb + Da + Db) in 64-bit integer arithmetic,
+ *        exact up to the rounding of the result. The intervals are differences of 32-bit timestamps.
+ *
+ * input parameters
+ * @param ra - initiator poll TX to response RX
+ * @param rb - responder response TX to final RX
+ * @param da - initiator response RX to final TX
+ * @param db - responder poll RX to response TX
+ *
+ * output parameters
+ *
+ * returns the time of flight in 1/2^RNG_TOF_Q device time units
+ */
+int32 rng_tof_ds(uint32 ra, uint32 rb, uint32 da, uint32 db);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ds_f()
+ *
+ * @brief As rng_tof_ds() in single precision. The products are expanded around Ra - Db and Rb - Da, which are
+ *        small and computed exactly in integer, instead of being formed directly (they are around 1e17 and would
+ *        lose the TOF in the rounding of a float).
+ *
+ * input parameters
+ * @param ra, rb, da, db - see rng_tof_ds()
+ *
+ * output parameters
+ *
+ * returns the time of flight in device time units
+ */
+float rng_tof_ds_f(uint32 ra, uint32 rb, uint32 da, uint32 db);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_ss_f()
+ *
+ * @brief SS-TWR time of flight, the responder reply time corrected by the clock offset ratio:
+ *        (Rinit - Rresp * (1 - offset)) / 2. The integer part of the difference is exact, only the correction term
+ *        goes through the float.
+ *
+ * input parameters
+ * @param rtdInit - initiator poll TX to response RX
+ * @param rtdResp - responder poll RX to response TX
+ * @param clkOffset - clock offset ratio of the responder, from the carrier integrator
+ *
+ * output parameters
+ *
+ * returns the time of flight in device time units
+ */
+float rng_tof_ss_f(uint32 rtdInit, uint32 rtdResp, float clkOffset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_to_mm()
+ *
+ * @brief Convert a fixed point time of flight to a distance.
+ *
+ * input parameters
+ * @param tof - time of flight in 1/2^RNG_TOF_Q device time units
+ *
+ * output parameters
+ *
+ * returns the distance in millimetres, rounded
+ */
+int32 rng_tof_to_mm(int32 tof);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof_clkfactor()
+ *
+ * @brief Clock offset ratio per carrier integrator unit (dwt_readcarrierintegrator()) for a radio configuration, from
+ *        its channel centre frequency and data rate. Single precision only, cheap enough for the RX handlers.
+ *
+ * input parameters
+ * @param phy - DW1000 configuration
+ *
+ * output parameters
+ *
+ * returns the ratio, positive when the remote clock is fast, or 0 for an unknown channel
+ */
+float rng_tof_clkfactor(const dwt_config_t *phy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_TOF_H_ */
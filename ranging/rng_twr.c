@@ -0,0 +1,1426 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_twr.c
+ * @brief   Event driven two-way ranging engine (DS-TWR initiator and responder)
+ *
+ *          Initiator:  poll --> (resp) --> final (delayed TX, carries the timestamps)
+ *          Responder:  (poll) --> resp (delayed TX) --> (final) --> TOF
+ *
+ *          Broadcast:  poll (peers 0..N-1) --> (resp 0) ... (resp N-1) --> final (all the response RX timestamps)
+ *                      responder i sends its response bcastSlotUus * i later than responder 0
+ *
+ *          SS-TWR:     poll --> (resp, carries the responder timestamps) --> TOF corrected by the clock offset
+ *
+ *          Every step is taken from the callback of the DW1000 event that
+ *          ends the previous one, the CPU is free in between.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ * Copyright 2015 (c) DecaWave Ltd, Dublin, Ireland.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "rng_twr.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "port.h"
+#include "deca_ts.h"
+#include "deca_frame.h"
+#include "deca_trace.h"
+#ifdef CONFIG_DW1000_CSMA
+#include "mac_csma.h"
+#endif
+#ifdef CONFIG_DW1000_LINK_ADAPT
+#include "rng_link.h"
+#endif
+
+// Events the engine runs on
+#define RNG_INT_MASK    (DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO | DWT_INT_RPHE | DWT_INT_RFCE | \
+                         DWT_INT_RFSL | DWT_INT_SFDT)
+
+// Frames the DW1000 lets through when filtering, destination and PAN ID are checked by it
+#define RNG_FF_MASK     DWT_FF_DATA_EN
+
+/* One tuned delay */
+typedef struct
+{
+    uint16 cur;                         // delay in use
+    uint16 floor;                       // adaptation range
+    uint16 ceil;
+    int32 minMargin;                    // smallest slack in the window, uus
+    uint8 cnt;                          // delayed TX in the window
+    uint16 late;                        // late TX since rng_init
+} rng_adapt_t;
+
+/* Airtime of the configured PHY, see rng_setphy() */
+typedef struct
+{
+    uint8 valid;
+    uint32 symNs;                       // preamble symbol
+    uint32 plenSyms;                    // preamble length
+    uint32 pacSyms;                     // preamble acquisition chunk
+    uint32 toRmNs;                      // preamble and SFD, up to the RMARKER
+    uint32 phrNs;                       // PHY header
+    uint32 bitPs;                       // data bit
+} rng_phy_t;
+
+/* One RX window with autoTimeouts */
+typedef struct
+{
+    uint16 toUus;                       // RX_FWTO
+    uint16 preToc;                      // DRX_PRETOC, PAC units
+} rng_window_t;
+
+typedef struct
+{
+    rng_config_t cfg;
+    rng_result_cb_t cb;
+    volatile rng_state_t state;
+    uint16 peer;                        // other side of the exchange in progress
+    uint8 seq;                          // sequence number of the next frame sent
+    uint8 pollSeq;                      // sequence number of the poll of the exchange in progress
+    uint64_t pollTs;                    // initiator: poll TX, responder: poll RX
+    // broadcast mode
+    uint8 bcastCnt;                     // responders of the exchange in progress
+    uint8 bcastSlot;                    // responder: own slot, RNG_BCAST_NONE in unicast mode
+    uint16 bcastPeers[RNG_BCAST_MAX_PEERS];
+    uint32 bcastRespRxTs[RNG_BCAST_MAX_PEERS];
+    uint8 bcastRxMask;                  // initiator: responses received
+    uint32 bcastRxUus;                  // initiator: end of the response window, from the poll TX
+    // SS-TWR
+    uint16 ssPeers[RNG_MAX_LINKS];      // links set to SS-TWR
+    uint8 ssCnt;
+    float clkOffsetFactor;              // carrier integrator to clock offset ratio, for the configured channel
+    uint8 prf;                          // configured PRF, for the RX quality
+    uint8 rxqValid;                     // rxq read from the last frame of the exchange in progress
+    deca_rxqual_t rxq;
+    uint8 *txBuf;                       // data of the frame pool buffers below
+    uint8 *rxBuf;
+    deca_frame_t *txFrame;
+    deca_frame_t *rxFrame;
+    // adaptive delays, see rng_getdelays()
+    rng_adapt_t finalAdapt;             // initiator: response RX to final TX
+    rng_adapt_t respAdapt;              // responder: poll RX to response TX
+    // windows derived from the PHY, see rng_autowindows()
+    rng_phy_t phy;
+    rng_window_t respWin;               // initiator: DS-TWR response
+    rng_window_t ssRespWin;             // initiator: SS-TWR response
+    rng_window_t finalWin;              // responder: unicast final
+    int32 preToc;                       // DRX_PRETOC written, -1 when unknown
+    uint8 initiated;                    // the exchange in progress is a unicast poll of ours
+} rng_local_t;
+
+static rng_local_t rng;
+
+#define RNG_BCAST_NONE          0xFF
+
+// Below this the initiator does not re-enable RX for the remaining responses and sends the final
+#define RNG_BCAST_MIN_RX_UUS    50
+
+// Delayed TX between two adjustments of a tuned delay
+#define RNG_ADAPT_WINDOW        16
+
+// pollTs not read yet
+#define RNG_TS_NONE             ((uint64_t)-1)
+
+// Nanoseconds per uus, rounded down so that the conversions to uus round up
+#define RNG_UUS_NS              1025
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setts() / rng_getts()
+ *
+ * @brief Write / read the 32 low bits of a timestamp in a frame field.
+ */
+static inline void rng_setts(uint8 *field, uint64_t ts)
+{
+    deca_ts_pack(field, ts, RNG_FINAL_TS_LEN);
+}
+
+static inline uint32 rng_getts(const uint8 *field)
+{
+    return (uint32)deca_ts_unpack(field, RNG_FINAL_TS_LEN);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_buildmsg()
+ *
+ * @brief Write the common part of a frame to the TX buffer and return its length.
+ */
+static uint16 rng_buildmsg(uint8 fc, uint16 len)
+{
+    uint8 *msg = rng.txBuf;
+
+    memset(msg, 0, len);
+    msg[0] = 0x41;      // frame control: data frame, 16-bit addressing, PAN ID compression
+    msg[1] = 0x88;
+    msg[RNG_MSG_SN_IDX] = rng.seq;
+    msg[RNG_MSG_PAN_IDX] = (uint8)rng.cfg.panId;
+    msg[RNG_MSG_PAN_IDX + 1] = (uint8)(rng.cfg.panId >> 8);
+    msg[RNG_MSG_DST_IDX] = (uint8)rng.peer;
+    msg[RNG_MSG_DST_IDX + 1] = (uint8)(rng.peer >> 8);
+    msg[RNG_MSG_SRC_IDX] = (uint8)rng.cfg.addr;
+    msg[RNG_MSG_SRC_IDX + 1] = (uint8)(rng.cfg.addr >> 8);
+    msg[RNG_MSG_FC_IDX] = fc;
+
+    return len;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_sendmsg()
+ *
+ * @brief Send the frame in the TX buffer with the given dwt_starttx() mode, the sequence number moves on.
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if a delayed TX was late
+ */
+static int rng_sendmsg(uint16 len, uint8 mode)
+{
+    int ret;
+
+    dwt_writetxdata(len, rng.txBuf, 0); /* Zero offset in TX buffer. */
+    dwt_writetxfctrl(len, 0, 1); /* Zero offset in TX buffer, ranging. */
+    rng.seq++;
+
+    ret = dwt_starttx(mode);
+    DECA_TRACE_END(DECA_TRACE_RX_TX);
+
+    return ret;
+}
+
+#ifdef CONFIG_DW1000_CSMA
+static void rng_busy_cb(void);
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_sendpoll()
+ *
+ * @brief rng_sendmsg() for a poll: one sent at once waits for a clear channel when CSMA is built in (mac_csma.h).
+ */
+static int rng_sendpoll(uint16 len, uint8 mode)
+{
+#ifdef CONFIG_DW1000_CSMA
+    if (!(mode & DWT_START_TX_DELAYED))
+    {
+        dwt_writetxdata(len, rng.txBuf, 0); /* Zero offset in TX buffer. */
+        dwt_writetxfctrl(len, 0, 1); /* Zero offset in TX buffer, ranging. */
+        rng.seq++;
+
+        return mac_csma_starttx(mode, rng_busy_cb);
+    }
+#endif
+    return rng_sendmsg(len, mode);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_adaptreset()
+ *
+ * @brief Set a tuned delay back to the configured one and its range.
+ */
+static void rng_adaptreset(rng_adapt_t *ad, uint16 dly, uint16 rxDly)
+{
+    uint32 floor = (uint32)rxDly + rng.cfg.adaptAirUus;
+
+    ad->ceil = dly;
+    ad->floor = (floor < dly) ? (uint16)floor : dly;
+    ad->cur = dly;
+    ad->minMargin = INT32_MAX;
+    ad->cnt = 0;
+    ad->late = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setrxwindow()
+ *
+ * @brief Set the timeouts of the next RX: the derived window with autoTimeouts once the PHY is known, the configured
+ *        timeout and no preamble detection timeout otherwise (win NULL). DRX_PRETOC is only written on a change.
+ */
+static void rng_setrxwindow(const rng_window_t *win, uint16 toUus)
+{
+    uint16 pretoc = 0;
+
+    if ((win != NULL) && rng.cfg.autoTimeouts && rng.phy.valid)
+    {
+        toUus = win->toUus;
+        pretoc = win->preToc;
+    }
+    if (rng.preToc != pretoc)
+    {
+        dwt_setpreambledetecttimeout(pretoc);
+        rng.preToc = pretoc;
+    }
+    dwt_setrxtimeout(toUus);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_framens()
+ *
+ * @brief Airtime of a frame from its RMARKER to its end: PHR and data with the Reed-Solomon parity.
+ */
+static uint32 rng_framens(uint16 len)
+{
+    uint32 bits = (uint32)len * 8;
+
+    bits += 48 * ((bits + 329) / 330);
+    return rng.phy.phrNs + (uint32)(((uint64_t)bits * rng.phy.bitPs) / 1000);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setwindow()
+ *
+ * @brief Derive an RX window opened rxDlyUus after the end of a frame of txLen bytes sent at RMARKER 0, for a frame
+ *        of rxLen bytes whose RMARKER comes dlyUus after it at the latest.
+ */
+static void rng_setwindow(rng_window_t *win, uint16 txLen, uint16 rxDlyUus, uint16 dlyUus, uint16 rxLen)
+{
+    int64_t wait_ns;
+    uint32 to_uus, pacs;
+
+    /* From RX on to the latest preamble start, 0 when the receiver opens in the preamble */
+    wait_ns = (int64_t)dlyUus * RNG_UUS_NS - rng.phy.toRmNs - rng_framens(txLen) - (int64_t)rxDlyUus * RNG_UUS_NS;
+    if (wait_ns < 0)
+    {
+        wait_ns = 0;
+    }
+    wait_ns += (int64_t)rng.cfg.autoGuardUus * RNG_UUS_NS;
+
+    to_uus = (uint32)((wait_ns + rng.phy.toRmNs + rng_framens(rxLen) + RNG_UUS_NS - 1) / RNG_UUS_NS);
+    win->toUus = (uint16)MIN(MAX(to_uus, 1), 0xFFFF);
+
+    /* The preamble is detected within half its length, the DW1000 adds one PAC to the count */
+    pacs = (uint32)((wait_ns + (int64_t)rng.phy.plenSyms / 2 * rng.phy.symNs) /
+                    ((int64_t)rng.phy.pacSyms * rng.phy.symNs)) + 1;
+    win->preToc = (uint16)MIN(pacs, 0xFFFF);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_autowindows()
+ *
+ * @brief Derive the response and final windows from the configuration and the PHY, see rng_setphy().
+ */
+static void rng_autowindows(void)
+{
+    if (!rng.phy.valid)
+    {
+        return;
+    }
+    rng_setwindow(&rng.respWin, RNG_POLL_MSG_LEN, rng.cfg.pollTxToRespRxDlyUus,
+                  rng.cfg.adapt ? rng.respAdapt.ceil : rng.cfg.pollRxToRespTxDlyUus, RNG_RESP_MSG_LEN);
+    rng_setwindow(&rng.ssRespWin, RNG_SSPOLL_MSG_LEN, rng.cfg.ssPollTxToRespRxDlyUus, rng.cfg.ssPollRxToRespTxDlyUus,
+                  RNG_SSRESP_MSG_LEN);
+    rng_setwindow(&rng.finalWin, RNG_RESP_MSG_LEN, rng.cfg.respTxToFinalRxDlyUus,
+                  rng.cfg.adapt ? rng.finalAdapt.ceil : rng.cfg.respRxToFinalTxDlyUus, RNG_FINAL_MSG_LEN);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_senddly()
+ *
+ * @brief rng_sendmsg() for a delayed TX at txTime using a tuned delay. The system time read just before the TX is
+ *        armed gives the slack processing left, the delay follows it once a window is complete.
+ *
+ * returns DWT_SUCCESS, or DWT_ERROR if the TX was late
+ */
+static int rng_senddly(rng_adapt_t *ad, uint16 len, uint8 mode, uint32 txTime)
+{
+    int32 margin;
+    int ret;
+
+    if (!rng.cfg.adapt)
+    {
+        return rng_sendmsg(len, mode);
+    }
+
+    dwt_writetxdata(len, rng.txBuf, 0);
+    dwt_writetxfctrl(len, 0, 1);
+    rng.seq++;
+
+    /* System time and delayed TX time are both in 1/256 uus, see deca_ts_dlytime() */
+    margin = (int32)(txTime - dwt_readsystimestamphi32()) / 256;
+    ret = dwt_starttx(mode);
+    DECA_TRACE_END(DECA_TRACE_RX_TX);
+
+    if (ret != DWT_SUCCESS)
+    {
+        ad->late++;
+        ad->cur = (uint16)MIN((uint32)ad->cur + 2 * rng.cfg.adaptMarginUus, ad->ceil);
+        ad->minMargin = INT32_MAX;
+        ad->cnt = 0;
+        return ret;
+    }
+
+    if (margin < ad->minMargin)
+    {
+        ad->minMargin = margin;
+    }
+    if (++ad->cnt >= RNG_ADAPT_WINDOW)
+    {
+        /* Half the spare slack off, or all of the missing one back */
+        int32 slack = ad->minMargin - rng.cfg.adaptMarginUus;
+        int32 dly = ad->cur - ((slack > 0) ? (slack / 2) : slack);
+
+        ad->cur = (uint16)MAX(MIN(dly, (int32)ad->ceil), (int32)ad->floor);
+        ad->minMargin = INT32_MAX;
+        ad->cnt = 0;
+    }
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_readmsg()
+ *
+ * @brief Read a received frame and check it is the given function code, addressed to us within our PAN.
+ *
+ * returns the source address, or -1 if the frame is not the expected one
+ */
+static int32 rng_checkmsg(uint8 fc);
+
+static int32 rng_readmsg(const dwt_cb_data_t *cb_data, uint8 fc, uint16 len)
+{
+    if (cb_data->datalength != len)
+    {
+        return -1;
+    }
+    dwt_readrxdata(rng.rxBuf, len, 0);
+
+    return rng_checkmsg(fc);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_checkmsg()
+ *
+ * @brief Check the frame in the RX buffer is the given function code, addressed to us within our PAN.
+ *
+ * returns the source address, or -1 if the frame is not the expected one
+ */
+static int32 rng_checkmsg(uint8 fc)
+{
+    const uint8 *msg = rng.rxBuf;
+    uint16 dst = ((fc == RNG_FC_BPOLL) || (fc == RNG_FC_BFINAL)) ? RNG_ADDR_BCAST : rng.cfg.addr;
+
+    if ((msg[RNG_MSG_FC_IDX] != fc) ||
+        (msg[RNG_MSG_PAN_IDX] != (uint8)rng.cfg.panId) || (msg[RNG_MSG_PAN_IDX + 1] != (uint8)(rng.cfg.panId >> 8)) ||
+        (msg[RNG_MSG_DST_IDX] != (uint8)dst) || (msg[RNG_MSG_DST_IDX + 1] != (uint8)(dst >> 8)))
+    {
+        return -1;
+    }
+
+    return msg[RNG_MSG_SRC_IDX] | (msg[RNG_MSG_SRC_IDX + 1] << 8);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_report()
+ *
+ * @brief Hand the outcome of an exchange to the application.
+ */
+static void rng_report(rng_status_t status, int32 tof)
+{
+    rng_result_t res;
+
+    if (rng.cb == NULL)
+    {
+        rng.rxqValid = 0;
+        return;
+    }
+
+    res.peer = rng.peer;
+    res.seq = rng.pollSeq;
+    res.status = status;
+    res.tof = tof;
+    res.distMm = (status == RNG_OK) ? rng_tof_to_mm(tof) : 0;
+    res.distance = res.distMm * 0.001f;
+    if ((status == RNG_OK) && rng.rxqValid)
+    {
+        res.fpPowerQ8 = rng.rxq.fpPowerQ8;
+        res.rxPowerQ8 = rng.rxq.rxPowerQ8;
+        res.los = rng.rxq.los;
+    }
+    else
+    {
+        res.fpPowerQ8 = DECA_RXQUAL_NONE;
+        res.rxPowerQ8 = DECA_RXQUAL_NONE;
+        res.los = 0;
+    }
+    rng.rxqValid = 0;
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    if (rng.initiated)
+    {
+        rng_link_result(&res);
+    }
+#endif
+    rng.cb(&res);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_listen()
+ *
+ * @brief Responder: wait for the next poll.
+ */
+static void rng_listen(void)
+{
+    rng.state = RNG_RESP_WAIT_POLL;
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    rng_link_listen();
+#endif
+    rng_setrxwindow(NULL, 0);
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_end()
+ *
+ * @brief End of an exchange: the responder listens again, the initiator goes idle.
+ */
+static void rng_end(rng_state_t state)
+{
+    if ((state == RNG_RESP_WAIT_POLL) || (state == RNG_RESP_WAIT_FINAL) || (state == RNG_RESP_WAIT_REPORT_TX) ||
+        (state == RNG_RESP_WAIT_SSRESP_TX))
+    {
+        rng_listen();
+    }
+    else
+    {
+        rng.state = RNG_IDLE;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_tof()
+ *
+ * @brief Asymmetric DS-TWR time of flight. The initiator's values, from the final, are the 32 low bits of its
+ *        timestamps, the 32-bit subtractions stay correct across a clock wrap as long as the exchange is shorter than
+ *        ~67 ms. No double arithmetic, see rng_tof.h.
+ *
+ * returns the time of flight in 1/2^RNG_TOF_Q device time units
+ */
+static int32 rng_tof(uint32 poll_tx_ts, uint32 resp_rx_ts, uint32 final_tx_ts, uint64_t resp_tx_ts,
+                     uint64_t final_rx_ts)
+{
+    uint32 ra, rb, da, db;
+
+    ra = resp_rx_ts - poll_tx_ts;
+    rb = (uint32)final_rx_ts - (uint32)resp_tx_ts;
+    da = final_tx_ts - resp_rx_ts;
+    db = (uint32)resp_tx_ts - (uint32)rng.pollTs;
+
+#ifdef CONFIG_DW1000_RANGING_TOF_FLOAT
+    return (int32)(rng_tof_ds_f(ra, rb, da, db) * (1 << RNG_TOF_Q));
+#else
+    return rng_tof_ds(ra, rb, da, db);
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_breport()
+ *
+ * @brief Broadcast initiator: report the outcome for every responder, in list order. A responder whose response was
+ *        not received gets RNG_ERR_RX_TIMEOUT, the others the given status.
+ */
+static void rng_breport(rng_status_t status)
+{
+    uint16 peers[RNG_BCAST_MAX_PEERS];
+    uint8 cnt = rng.bcastCnt;
+    uint8 mask = rng.bcastRxMask;
+    int i;
+
+    /* The callback may start the next exchange */
+    memcpy(peers, rng.bcastPeers, sizeof(peers));
+    for (i = 0; i < cnt; i++)
+    {
+        rng.peer = peers[i];
+        rng_report((mask & (1 << i)) ? status : RNG_ERR_RX_TIMEOUT, 0);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_bpollts()
+ *
+ * @brief Broadcast initiator: poll TX timestamp, read once per exchange.
+ */
+static uint64_t rng_bpollts(void)
+{
+    if (rng.pollTs == RNG_TS_NONE)
+    {
+        rng.pollTs = deca_ts_readtx();
+    }
+    return rng.pollTs;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_bfinal()
+ *
+ * @brief Broadcast initiator: the response window is over, send the final. Its TX time is fixed by the poll time so
+ *        that every responder knows when to listen, the responses missed have a zero timestamp.
+ */
+static void rng_bfinal(void)
+{
+    uint32 final_tx_time;
+    uint32 final_dly_uus;
+    uint16 len;
+    int i;
+
+    if (rng.bcastRxMask == 0)
+    {
+        rng.state = RNG_IDLE;
+        rng_breport(RNG_ERR_RX_TIMEOUT);
+        return;
+    }
+
+    final_dly_uus = rng.cfg.pollRxToRespTxDlyUus + (uint32)(rng.bcastCnt - 1) * rng.cfg.bcastSlotUus +
+                    rng.cfg.respRxToFinalTxDlyUus;
+    final_tx_time = deca_ts_dlytime(rng_bpollts(), final_dly_uus);
+    dwt_setdelayedtrxtime(final_tx_time);
+
+    rng.peer = RNG_ADDR_BCAST;
+    len = rng_buildmsg(RNG_FC_BFINAL, RNG_BFINAL_MSG_LEN(rng.bcastCnt));
+    rng_setts(&rng.txBuf[RNG_BFINAL_POLL_TX_TS_IDX], rng.pollTs);
+    rng_setts(&rng.txBuf[RNG_BFINAL_FINAL_TX_TS_IDX], deca_ts_dlytxts(final_tx_time, rng.cfg.txAntDly));
+    for (i = 0; i < rng.bcastCnt; i++)
+    {
+        rng_setts(&rng.txBuf[RNG_BFINAL_RESP_RX_TS_IDX + i * RNG_FINAL_TS_LEN], rng.bcastRespRxTs[i]);
+    }
+
+    rng.state = RNG_INIT_WAIT_BFINAL_TX;
+    if (rng_sendmsg(len, DWT_START_TX_DELAYED) != DWT_SUCCESS)
+    {
+        rng.state = RNG_IDLE;
+        rng_breport(RNG_ERR_TX_LATE);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_bnext()
+ *
+ * @brief Broadcast initiator: listen again for the responses still expected, or send the final when all are in or
+ *        the window is over.
+ */
+static void rng_bnext(void)
+{
+    uint32 rx_end;
+    int32 left_uus;
+
+    if (rng.bcastRxMask != (uint8)((1 << rng.bcastCnt) - 1))
+    {
+        rx_end = (uint32)(rng_bpollts() >> 8) + rng.bcastRxUus * (RNG_UUS_TO_DWT_TIME >> 8);
+        left_uus = (int32)(rx_end - dwt_readsystimestamphi32()) / (RNG_UUS_TO_DWT_TIME >> 8);
+        if (left_uus > RNG_BCAST_MIN_RX_UUS)
+        {
+            rng_setrxwindow(NULL, (uint16)left_uus);
+            dwt_rxenable(DWT_START_RX_IMMEDIATE);
+            return;
+        }
+    }
+
+    rng_bfinal();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_rxok_cb()
+ *
+ * @brief RX good frame: the response (initiator) or the poll and the final (responder).
+ */
+static void rng_rxok_cb(const dwt_cb_data_t *cb_data)
+{
+    int32 src;
+
+    DECA_TRACE_BEGIN(DECA_TRACE_RX_TX);
+
+    switch (rng.state)
+    {
+    case RNG_INIT_WAIT_RESP:
+    {
+        uint64_t resp_rx_ts;
+        uint32 final_tx_time;
+        uint16 len;
+
+        src = rng_readmsg(cb_data, RNG_FC_RESP, RNG_RESP_MSG_LEN);
+        if (src != rng.peer)
+        {
+            rng.state = RNG_IDLE;
+            rng_report(RNG_ERR_FRAME, 0);
+            break;
+        }
+
+        rng.pollTs = deca_ts_readtx();
+        resp_rx_ts = deca_ts_readrx();
+
+        /* Delayed TX time has a 512 dtu resolution, see NOTE 10 of example 5a */
+        final_tx_time = deca_ts_dlytime(resp_rx_ts, rng.finalAdapt.cur);
+        dwt_setdelayedtrxtime(final_tx_time);
+
+        len = rng_buildmsg(RNG_FC_FINAL, RNG_FINAL_MSG_LEN);
+        rng_setts(&rng.txBuf[RNG_FINAL_POLL_TX_TS_IDX], rng.pollTs);
+        rng_setts(&rng.txBuf[RNG_FINAL_RESP_RX_TS_IDX], resp_rx_ts);
+        rng_setts(&rng.txBuf[RNG_FINAL_FINAL_TX_TS_IDX], deca_ts_dlytxts(final_tx_time, rng.cfg.txAntDly));
+
+        if (rng.cfg.report)
+        {
+            dwt_setrxaftertxdelay(0);
+            rng_setrxwindow(NULL, rng.cfg.reportRxTimeoutUus);
+            rng.state = RNG_INIT_WAIT_REPORT;
+        }
+        else
+        {
+            rng.state = RNG_INIT_WAIT_FINAL_TX;
+        }
+        if (rng_senddly(&rng.finalAdapt, len, DWT_START_TX_DELAYED | (rng.cfg.report ? DWT_RESPONSE_EXPECTED : 0),
+                        final_tx_time) != DWT_SUCCESS)
+        {
+            rng.state = RNG_IDLE;
+            rng_report(RNG_ERR_TX_LATE, 0);
+        }
+        break;
+    }
+
+    case RNG_INIT_WAIT_BRESP:
+    {
+        int i;
+
+        src = rng_readmsg(cb_data, RNG_FC_RESP, RNG_RESP_MSG_LEN);
+        for (i = 0; i < rng.bcastCnt; i++)
+        {
+            if ((src == rng.bcastPeers[i]) && !(rng.bcastRxMask & (1 << i)))
+            {
+                rng.bcastRespRxTs[i] = (uint32)deca_ts_readrx();
+                rng.bcastRxMask |= (1 << i);
+                break;
+            }
+        }
+        rng_bnext();
+        break;
+    }
+
+    case RNG_INIT_WAIT_SSRESP:
+    {
+        const uint8 *msg = rng.rxBuf;
+        uint32 poll_tx_ts, resp_rx_ts;
+        uint32 rtd_init, rtd_resp;
+        float clk_offset;
+        int32 tof = 0;
+
+        src = rng_readmsg(cb_data, RNG_FC_SSRESP, RNG_SSRESP_MSG_LEN);
+        if (src == rng.peer)
+        {
+            poll_tx_ts = dwt_readtxtimestamplo32();
+            if (rng.cfg.rxQual)
+            {
+                /* The RX timestamp comes with the quality registers */
+                deca_rxqual_read(&rng.rxq, rng.prf);
+                rng.rxqValid = 1;
+                resp_rx_ts = (uint32)rng.rxq.rxTs;
+            }
+            else
+            {
+                resp_rx_ts = dwt_readrxtimestamplo32();
+            }
+
+            /* Offset of the responder clock, from the response carrier: valid until RX is enabled again */
+            clk_offset = dwt_readcarrierintegrator() * rng.clkOffsetFactor;
+
+            rtd_init = resp_rx_ts - poll_tx_ts;
+            rtd_resp = rng_getts(&msg[RNG_SSRESP_RESP_TX_TS_IDX]) - rng_getts(&msg[RNG_SSRESP_POLL_RX_TS_IDX]);
+            tof = (int32)(rng_tof_ss_f(rtd_init, rtd_resp, clk_offset) * (1 << RNG_TOF_Q));
+        }
+
+        rng.state = RNG_IDLE;
+        rng_report((src == rng.peer) ? RNG_OK : RNG_ERR_FRAME, tof);
+        break;
+    }
+
+    case RNG_RESP_WAIT_POLL:
+    {
+        uint32 resp_tx_time;
+        uint32 resp_dly_uus, final_dly_uus;
+        uint16 len;
+        uint8 ss = 0;
+
+        rng.bcastSlot = RNG_BCAST_NONE;
+        if (cb_data->datalength == RNG_POLL_MSG_LEN)
+        {
+            /* DS-TWR or SS-TWR poll, same length */
+            dwt_readrxdata(rng.rxBuf, RNG_POLL_MSG_LEN, 0);
+            src = rng_checkmsg(RNG_FC_POLL);
+            if (src < 0)
+            {
+                src = rng_checkmsg(RNG_FC_SSPOLL);
+                ss = 1;
+            }
+        }
+        else
+        {
+            /* Broadcast poll, our slot is our rank in the list */
+            uint8 cnt = (cb_data->datalength - RNG_BPOLL_MSG_LEN(0)) / 2;
+            int i;
+
+            src = -1;
+            if ((cnt > 0) && (cnt <= RNG_BCAST_MAX_PEERS) &&
+                (rng_readmsg(cb_data, RNG_FC_BPOLL, RNG_BPOLL_MSG_LEN(cnt)) >= 0) &&
+                (rng.rxBuf[RNG_BPOLL_CNT_IDX] == cnt))
+            {
+                for (i = 0; i < cnt; i++)
+                {
+                    if ((rng.rxBuf[RNG_BPOLL_ADDR_IDX + 2 * i] | (rng.rxBuf[RNG_BPOLL_ADDR_IDX + 2 * i + 1] << 8)) ==
+                        rng.cfg.addr)
+                    {
+                        rng.bcastCnt = cnt;
+                        rng.bcastSlot = (uint8)i;
+                        src = rng.rxBuf[RNG_MSG_SRC_IDX] | (rng.rxBuf[RNG_MSG_SRC_IDX + 1] << 8);
+                        break;
+                    }
+                }
+            }
+        }
+        if (src < 0)
+        {
+            rng_listen();
+            break;
+        }
+
+        rng.peer = (uint16)src;
+        rng.pollSeq = rng.rxBuf[RNG_MSG_SN_IDX];
+        rng.pollTs = deca_ts_readrx();
+        rng.initiated = 0;
+#ifdef CONFIG_DW1000_LINK_ADAPT
+        /* Answer at the point the initiator chose, broadcast exchanges stay at the listen point */
+        if (rng.bcastSlot == RNG_BCAST_NONE)
+        {
+            rng_link_follow();
+        }
+#endif
+
+        if (ss)
+        {
+            /* The response carries our poll RX and response TX timestamps, the latter predicted as for the final */
+            resp_tx_time = deca_ts_dlytime(rng.pollTs, rng.cfg.ssPollRxToRespTxDlyUus);
+            dwt_setdelayedtrxtime(resp_tx_time);
+
+            len = rng_buildmsg(RNG_FC_SSRESP, RNG_SSRESP_MSG_LEN);
+            rng_setts(&rng.txBuf[RNG_SSRESP_POLL_RX_TS_IDX], rng.pollTs);
+            rng_setts(&rng.txBuf[RNG_SSRESP_RESP_TX_TS_IDX], deca_ts_dlytxts(resp_tx_time, rng.cfg.txAntDly));
+
+            rng.state = RNG_RESP_WAIT_SSRESP_TX;
+            if (rng_sendmsg(len, DWT_START_TX_DELAYED) != DWT_SUCCESS)
+            {
+                rng_listen();
+                rng_report(RNG_ERR_TX_LATE, 0);
+            }
+            break;
+        }
+
+        /* In broadcast mode the final comes after the slots of the responders listed after us */
+        resp_dly_uus = rng.respAdapt.cur;
+        final_dly_uus = rng.cfg.respTxToFinalRxDlyUus;
+        if (rng.bcastSlot != RNG_BCAST_NONE)
+        {
+            /* The slots are laid out from the configured delay, known to the initiator */
+            resp_dly_uus = rng.cfg.pollRxToRespTxDlyUus + (uint32)rng.bcastSlot * rng.cfg.bcastSlotUus;
+            final_dly_uus += (uint32)(rng.bcastCnt - 1 - rng.bcastSlot) * rng.cfg.bcastSlotUus;
+        }
+
+        resp_tx_time = deca_ts_dlytime(rng.pollTs, resp_dly_uus);
+        dwt_setdelayedtrxtime(resp_tx_time);
+
+        dwt_setrxaftertxdelay(final_dly_uus);
+        rng_setrxwindow((rng.bcastSlot == RNG_BCAST_NONE) ? &rng.finalWin : NULL, rng.cfg.finalRxTimeoutUus);
+
+        len = rng_buildmsg(RNG_FC_RESP, RNG_RESP_MSG_LEN);
+        rng.txBuf[RNG_MSG_COMMON_LEN] = 0x02;   // activity code: go on with the ranging exchange
+
+        rng.state = RNG_RESP_WAIT_FINAL;
+        if (((rng.bcastSlot == RNG_BCAST_NONE) ?
+             rng_senddly(&rng.respAdapt, len, DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED, resp_tx_time) :
+             rng_sendmsg(len, DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED)) != DWT_SUCCESS)
+        {
+            rng_listen();
+            rng_report(RNG_ERR_TX_LATE, 0);
+        }
+        break;
+    }
+
+    case RNG_RESP_WAIT_FINAL:
+    {
+        const uint8 *msg = rng.rxBuf;
+        uint64_t resp_tx_ts, final_rx_ts;
+        uint32 resp_rx_ts;
+        int32 tof;
+        uint16 len;
+
+        if (rng.bcastSlot == RNG_BCAST_NONE)
+        {
+            src = rng_readmsg(cb_data, RNG_FC_FINAL, RNG_FINAL_MSG_LEN);
+        }
+        else
+        {
+            src = rng_readmsg(cb_data, RNG_FC_BFINAL, RNG_BFINAL_MSG_LEN(rng.bcastCnt));
+        }
+        if (src != rng.peer)
+        {
+            rng_listen();
+            rng_report(RNG_ERR_FRAME, 0);
+            break;
+        }
+
+        resp_tx_ts = deca_ts_readtx();
+        if (rng.cfg.rxQual)
+        {
+            /* The RX timestamp comes with the quality registers */
+            deca_rxqual_read(&rng.rxq, rng.prf);
+            rng.rxqValid = 1;
+            final_rx_ts = rng.rxq.rxTs;
+        }
+        else
+        {
+            final_rx_ts = deca_ts_readrx();
+        }
+
+        if (rng.bcastSlot == RNG_BCAST_NONE)
+        {
+            tof = rng_tof(rng_getts(&msg[RNG_FINAL_POLL_TX_TS_IDX]), rng_getts(&msg[RNG_FINAL_RESP_RX_TS_IDX]),
+                          rng_getts(&msg[RNG_FINAL_FINAL_TX_TS_IDX]), resp_tx_ts, final_rx_ts);
+        }
+        else
+        {
+            /* A zero timestamp: the initiator missed our response */
+            resp_rx_ts = rng_getts(&msg[RNG_BFINAL_RESP_RX_TS_IDX + rng.bcastSlot * RNG_FINAL_TS_LEN]);
+            if (resp_rx_ts == 0)
+            {
+                rng_listen();
+                rng_report(RNG_ERR_RX_TIMEOUT, 0);
+                break;
+            }
+            tof = rng_tof(rng_getts(&msg[RNG_BFINAL_POLL_TX_TS_IDX]), resp_rx_ts,
+                          rng_getts(&msg[RNG_BFINAL_FINAL_TX_TS_IDX]), resp_tx_ts, final_rx_ts);
+        }
+
+        if (rng.cfg.report && (rng.bcastSlot == RNG_BCAST_NONE))
+        {
+            len = rng_buildmsg(RNG_FC_REPORT, RNG_REPORT_MSG_LEN);
+            rng_setts(&rng.txBuf[RNG_REPORT_TOF_IDX], (uint64_t)(uint32)tof);
+            rng.state = RNG_RESP_WAIT_REPORT_TX;
+            if (rng_sendmsg(len, DWT_START_TX_IMMEDIATE) != DWT_SUCCESS)
+            {
+                rng_listen();
+            }
+        }
+        else
+        {
+            rng_listen();
+        }
+        rng_report(RNG_OK, tof);
+        break;
+    }
+
+    case RNG_INIT_WAIT_REPORT:
+    {
+        int32 tof;
+
+        src = rng_readmsg(cb_data, RNG_FC_REPORT, RNG_REPORT_MSG_LEN);
+        rng.state = RNG_IDLE;
+        if (src != rng.peer)
+        {
+            rng_report(RNG_ERR_FRAME, 0);
+            break;
+        }
+
+        tof = (int32)rng_getts(&rng.rxBuf[RNG_REPORT_TOF_IDX]);
+        if (rng.cfg.rxQual)
+        {
+            deca_rxqual_read(&rng.rxq, rng.prf);
+            rng.rxqValid = 1;
+        }
+        rng_report(RNG_OK, tof);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    /* No TX armed from this frame */
+    DECA_TRACE_CANCEL(DECA_TRACE_RX_TX);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_txdone_cb()
+ *
+ * @brief TX confirmation, ends the exchange on the last frame sent: the final of the initiator or the report of the
+ *        responder (already reported when the TOF was computed).
+ */
+static void rng_txdone_cb(const dwt_cb_data_t *cb_data)
+{
+    if (rng.state == RNG_INIT_WAIT_FINAL_TX)
+    {
+        rng.state = RNG_IDLE;
+        rng_report(RNG_OK, 0);
+    }
+    else if (rng.state == RNG_INIT_WAIT_BFINAL_TX)
+    {
+        rng.state = RNG_IDLE;
+        rng_breport(RNG_OK);
+    }
+    else if ((rng.state == RNG_RESP_WAIT_REPORT_TX) || (rng.state == RNG_RESP_WAIT_SSRESP_TX))
+    {
+        rng_listen();
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_rxto_cb() / rng_rxerr_cb()
+ *
+ * @brief RX timeout / error, dwt_isr has already reset the receiver.
+ */
+static void rng_rxto_cb(const dwt_cb_data_t *cb_data)
+{
+    rng_state_t state = rng.state;
+
+    if (state == RNG_INIT_WAIT_BRESP)
+    {
+        rng_bfinal();
+        return;
+    }
+    if (state != RNG_IDLE)
+    {
+        rng_end(state);
+    }
+    if ((state == RNG_INIT_WAIT_RESP) || (state == RNG_INIT_WAIT_REPORT) || (state == RNG_INIT_WAIT_SSRESP) ||
+        (state == RNG_RESP_WAIT_FINAL))
+    {
+        rng_report(RNG_ERR_RX_TIMEOUT, 0);
+    }
+}
+
+static void rng_rxerr_cb(const dwt_cb_data_t *cb_data)
+{
+    rng_state_t state = rng.state;
+
+    /* A frame the DW1000 filtered out has not been read, only turn the receiver back on */
+    if (((cb_data->status & SYS_STATUS_ALL_RX_ERR) == SYS_STATUS_AFFREJ) &&
+        ((state == RNG_INIT_WAIT_RESP) || (state == RNG_INIT_WAIT_REPORT) || (state == RNG_INIT_WAIT_SSRESP) ||
+         (state == RNG_RESP_WAIT_FINAL)))
+    {
+        /* The expected preamble may come after the one of the rejected frame */
+        if (rng.preToc != 0)
+        {
+            dwt_setpreambledetecttimeout(0);
+            rng.preToc = 0;
+        }
+        dwt_rxenable(DWT_START_RX_IMMEDIATE);
+        return;
+    }
+    if (state == RNG_INIT_WAIT_BRESP)
+    {
+        rng_bnext();
+        return;
+    }
+    if (state != RNG_IDLE)
+    {
+        rng_end(state);
+    }
+    if ((state == RNG_INIT_WAIT_RESP) || (state == RNG_INIT_WAIT_REPORT) || (state == RNG_INIT_WAIT_SSRESP) ||
+        (state == RNG_RESP_WAIT_FINAL))
+    {
+        rng_report(RNG_ERR_RX, 0);
+    }
+}
+
+#ifdef CONFIG_DW1000_CSMA
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_busy_cb()
+ *
+ * @brief Initiator: the channel stayed busy, the poll was dropped.
+ */
+static void rng_busy_cb(void)
+{
+    rng_state_t state = rng.state;
+
+    rng.state = RNG_IDLE;
+    if (state == RNG_INIT_WAIT_BRESP)
+    {
+        rng.bcastRxMask = (uint8)((1 << rng.bcastCnt) - 1);
+        rng_breport(RNG_ERR_BUSY);
+    }
+    else if (state != RNG_IDLE)
+    {
+        rng_report(RNG_ERR_BUSY, 0);
+    }
+}
+#endif
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_init()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_init(const rng_config_t *config, rng_result_cb_t cb)
+{
+    if (config == NULL)
+    {
+        return DWT_ERROR;
+    }
+
+    rng_stop();
+
+    /* Taken from the frame pool once, kept across rng_init/rng_stop */
+    if (rng.txFrame == NULL)
+    {
+        rng.txFrame = deca_frame_alloc(RNG_MSG_MAX_LEN, K_NO_WAIT);
+        rng.rxFrame = deca_frame_alloc(RNG_MSG_MAX_LEN, K_NO_WAIT);
+        if ((rng.txFrame == NULL) || (rng.rxFrame == NULL))
+        {
+            if (rng.txFrame != NULL)
+            {
+                deca_frame_unref(rng.txFrame);
+            }
+            if (rng.rxFrame != NULL)
+            {
+                deca_frame_unref(rng.rxFrame);
+            }
+            rng.txFrame = NULL;
+            rng.rxFrame = NULL;
+            return DWT_ERROR;
+        }
+        rng.txBuf = rng.txFrame->data;
+        rng.rxBuf = rng.rxFrame->data;
+    }
+
+    rng.cfg = *config;
+    rng.cb = cb;
+    rng_adaptreset(&rng.finalAdapt, rng.cfg.respRxToFinalTxDlyUus, rng.cfg.respTxToFinalRxDlyUus);
+    rng_adaptreset(&rng.respAdapt, rng.cfg.pollRxToRespTxDlyUus, rng.cfg.pollTxToRespRxDlyUus);
+    rng_autowindows();
+    /* Without autoTimeouts DRX_PRETOC is left to the application */
+    rng.preToc = rng.cfg.autoTimeouts ? -1 : 0;
+
+    /* The receiver stops on a rejected frame, DWT_INT_ARFE lets the engine turn it back on without reading the frame */
+    if (rng.cfg.filter)
+    {
+        dwt_setpanid(rng.cfg.panId);
+        dwt_setaddress16(rng.cfg.addr);
+        dwt_enableframefilter(RNG_FF_MASK);
+    }
+    else
+    {
+        dwt_enableframefilter(DWT_FF_NOTYPE_EN);
+    }
+
+    dwt_setcallbacks(rng_txdone_cb, rng_rxok_cb, rng_rxto_cb, rng_rxerr_cb);
+    dwt_setinterrupt(RNG_INT_MASK | (rng.cfg.filter ? DWT_INT_ARFE : 0), 1);
+#ifdef CONFIG_DW1000_CSMA
+    port_set_deca_isr(mac_csma_isr);
+#else
+    port_set_deca_isr(dwt_isr);
+#endif
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_linkmode()
+ *
+ * @brief Return the mode of the link with a peer.
+ */
+static rng_mode_t rng_linkmode(uint16 peer)
+{
+    int i;
+
+    for (i = 0; i < rng.ssCnt; i++)
+    {
+        if (rng.ssPeers[i] == peer)
+        {
+            return RNG_MODE_SS;
+        }
+    }
+    return RNG_MODE_DS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_getdelays()
+ *
+ * @brief see rng_twr.h
+ */
+void rng_getdelays(rng_delays_t *delays)
+{
+    delays->respRxToFinalTxDlyUus = rng.finalAdapt.cur;
+    delays->pollRxToRespTxDlyUus = rng.respAdapt.cur;
+    delays->finalLate = rng.finalAdapt.late;
+    delays->respLate = rng.respAdapt.late;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setdelays()
+ *
+ * @brief see rng_twr.h
+ */
+void rng_setdelays(const rng_delays_t *delays)
+{
+    rng.finalAdapt.cur = MAX(MIN(delays->respRxToFinalTxDlyUus, rng.finalAdapt.ceil), rng.finalAdapt.floor);
+    rng.respAdapt.cur = MAX(MIN(delays->pollRxToRespTxDlyUus, rng.respAdapt.ceil), rng.respAdapt.floor);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setphy()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_setphy(const dwt_config_t *phy)
+{
+    /* Single precision only: rng_link_follow() calls this between poll RX and response TX */
+    float factor = rng_tof_clkfactor(phy);
+
+    if ((factor == 0.0f) || (dwt_getpreamblesyms(phy->txPreambLength) == 0))
+    {
+        return DWT_ERROR;
+    }
+    rng.clkOffsetFactor = factor;
+    rng.prf = phy->prf;
+
+    /* Airtime, as in the PHY timing of the DW1000 User Manual */
+    rng.phy.symNs = dwt_getsymbolns(phy->prf);
+    rng.phy.plenSyms = dwt_getpreamblesyms(phy->txPreambLength);
+    rng.phy.pacSyms = 8 << (phy->rxPAC & 0x3);
+    rng.phy.toRmNs = (rng.phy.plenSyms + ((phy->dataRate == DWT_BR_110K) ? 64 : ((phy->dataRate == DWT_BR_850K) &&
+                                          phy->nsSFD) ? 16 : 8)) * rng.phy.symNs;
+    rng.phy.phrNs = 21 * ((phy->dataRate == DWT_BR_110K) ? 8205 : 1026);
+    rng.phy.bitPs = (phy->dataRate == DWT_BR_110K) ? 8205000 : (phy->dataRate == DWT_BR_850K) ? 1025641 : 128205;
+    rng.phy.valid = 1;
+    rng_autowindows();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_peerppm()
+ *
+ * @brief see rng_twr.h
+ */
+float rng_peerppm(void)
+{
+    return dwt_readcarrierintegrator() * rng.clkOffsetFactor * 1.0e6f;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setlinkmode()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_setlinkmode(uint16 peer, rng_mode_t mode)
+{
+    int i;
+
+    for (i = 0; i < rng.ssCnt; i++)
+    {
+        if (rng.ssPeers[i] == peer)
+        {
+            break;
+        }
+    }
+
+    if (mode == RNG_MODE_SS)
+    {
+        if (i == rng.ssCnt)
+        {
+            if (rng.ssCnt == RNG_MAX_LINKS)
+            {
+                return DWT_ERROR;
+            }
+            rng.ssPeers[rng.ssCnt++] = peer;
+        }
+    }
+    else if (i < rng.ssCnt)
+    {
+        rng.ssPeers[i] = rng.ssPeers[--rng.ssCnt];
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_startpoll()
+ *
+ * @brief Claim the engine and send the poll, with a delayed TX at txTime if mode says so.
+ */
+static int rng_startpoll(uint16 peer, uint8 mode, uint32 txTime)
+{
+    decaIrqStatus_t stat;
+    uint16 len;
+    uint8 ss;
+
+    stat = decamutexon();
+    if (rng.state != RNG_IDLE)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+    ss = (rng_linkmode(peer) == RNG_MODE_SS);
+    rng.state = ss ? RNG_INIT_WAIT_SSRESP : RNG_INIT_WAIT_RESP;
+    decamutexoff(stat);
+
+    rng.peer = peer;
+    rng.pollSeq = rng.seq;
+    rng.initiated = 1;
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    rng_link_poll(peer);
+#endif
+
+    if (mode & DWT_START_TX_DELAYED)
+    {
+        dwt_setdelayedtrxtime(txTime);
+    }
+    if (ss)
+    {
+        dwt_setrxaftertxdelay(rng.cfg.ssPollTxToRespRxDlyUus);
+        rng_setrxwindow(&rng.ssRespWin, rng.cfg.ssRespRxTimeoutUus);
+        len = rng_buildmsg(RNG_FC_SSPOLL, RNG_SSPOLL_MSG_LEN);
+    }
+    else
+    {
+        dwt_setrxaftertxdelay(rng.cfg.pollTxToRespRxDlyUus);
+        rng_setrxwindow(&rng.respWin, rng.cfg.respRxTimeoutUus);
+        len = rng_buildmsg(RNG_FC_POLL, RNG_POLL_MSG_LEN);
+    }
+    if (rng_sendpoll(len, mode) != DWT_SUCCESS)
+    {
+        rng.state = RNG_IDLE;
+        return DWT_ERROR;
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_initiate(uint16 peer)
+{
+    return rng_startpoll(peer, DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED, 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate_at()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_initiate_at(uint16 peer, uint32 txTime)
+{
+    return rng_startpoll(peer, DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED, txTime);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate_bcast()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_initiate_bcast(const uint16 *peers, uint8 count)
+{
+    decaIrqStatus_t stat;
+    uint32 window_uus;
+    uint16 len;
+    int i;
+
+    if ((peers == NULL) || (count == 0) || (count > RNG_BCAST_MAX_PEERS))
+    {
+        return DWT_ERROR;
+    }
+
+    stat = decamutexon();
+    if (rng.state != RNG_IDLE)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+    rng.state = RNG_INIT_WAIT_BRESP;
+    decamutexoff(stat);
+
+    rng.peer = RNG_ADDR_BCAST;
+    rng.pollSeq = rng.seq;
+    rng.initiated = 0;
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    rng_link_listen();
+#endif
+    rng.bcastCnt = count;
+    rng.bcastRxMask = 0;
+    rng.pollTs = RNG_TS_NONE;
+    memcpy(rng.bcastPeers, peers, count * sizeof(uint16));
+    memset(rng.bcastRespRxTs, 0, sizeof(rng.bcastRespRxTs));
+
+    /* One RX window for all the slots, re-enabled after each response */
+    window_uus = rng.cfg.respRxTimeoutUus + (uint32)(count - 1) * rng.cfg.bcastSlotUus;
+    rng.bcastRxUus = rng.cfg.pollTxToRespRxDlyUus + window_uus;
+    dwt_setrxaftertxdelay(rng.cfg.pollTxToRespRxDlyUus);
+    rng_setrxwindow(NULL, (uint16)window_uus);
+
+    len = rng_buildmsg(RNG_FC_BPOLL, RNG_BPOLL_MSG_LEN(count));
+    rng.txBuf[RNG_BPOLL_CNT_IDX] = count;
+    for (i = 0; i < count; i++)
+    {
+        rng.txBuf[RNG_BPOLL_ADDR_IDX + 2 * i] = (uint8)peers[i];
+        rng.txBuf[RNG_BPOLL_ADDR_IDX + 2 * i + 1] = (uint8)(peers[i] >> 8);
+    }
+
+    if (rng_sendpoll(len, DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+    {
+        rng.state = RNG_IDLE;
+        return DWT_ERROR;
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_respond()
+ *
+ * @brief see rng_twr.h
+ */
+int rng_respond(void)
+{
+    decaIrqStatus_t stat;
+
+    stat = decamutexon();
+    if (rng.state != RNG_IDLE)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+    rng.state = RNG_RESP_WAIT_POLL;
+    decamutexoff(stat);
+
+    rng_listen();
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_stop()
+ *
+ * @brief see rng_twr.h
+ */
+void rng_stop(void)
+{
+    decaIrqStatus_t stat;
+
+#ifdef CONFIG_DW1000_CSMA
+    mac_csma_cancel();
+#endif
+    stat = decamutexon();
+    rng.state = RNG_IDLE;
+    dwt_forcetrxoff();
+    if (rng.preToc > 0)
+    {
+        dwt_setpreambledetecttimeout(0);
+        rng.preToc = 0;
+    }
+    decamutexoff(stat);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_getstate()
+ *
+ * @brief see rng_twr.h
+ */
+rng_state_t rng_getstate(void)
+{
+    return rng.state;
+}
@@ -0,0 +1,418 @@
+/*! ----------------------------------------------------------------------------
+ * @file    rng_twr.h
+ * @brief   Event driven two-way ranging engine (DS-TWR initiator and responder)
+ *
+ *          The exchange is run from the DW1000 event callbacks (dwt_isr on the
+ *          port IRQ work queue), nothing blocks or polls the status register.
+ *          The frames are those of examples 5a/5b, so both sides interoperate
+ *          with them.
+ *
+ *          In broadcast mode the initiator ranges with up to
+ *          RNG_BCAST_MAX_PEERS responders with N + 2 messages instead of 3N:
+ *          one poll listing the responders, their responses in staggered
+ *          slots, and one final carrying all the response RX timestamps.
+ *
+ *          Links set to SS-TWR (rng_setlinkmode) use the poll/response of
+ *          examples 6a/6b instead: two messages, the initiator corrects the
+ *          responder reply time with the clock offset it measures on the
+ *          response carrier.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _RNG_TWR_H_
+#define _RNG_TWR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "deca_types.h"
+#include "deca_device_api.h"
+#include "rng_tof.h"
+#include "deca_rxqual.h"
+
+/* UWB microsecond (uus) to device time unit (dtu, around 15.65 ps) conversion factor.
+ * 1 uus = 512 / 499.2 us and 1 us = 499.2 * 128 dtu. */
+#define RNG_UUS_TO_DWT_TIME         65536
+
+/* Speed of light in air, in metres per second. */
+#define RNG_SPEED_OF_LIGHT          299702547
+
+// Frame layout: IEEE 802.15.4 data frame, 16-bit addressing (see NOTE 2 of example 5a)
+#define RNG_MSG_COMMON_LEN          10
+#define RNG_MSG_SN_IDX              2
+#define RNG_MSG_PAN_IDX             3
+#define RNG_MSG_DST_IDX             5
+#define RNG_MSG_SRC_IDX             7
+#define RNG_MSG_FC_IDX              9
+#define RNG_FINAL_POLL_TX_TS_IDX    10
+#define RNG_FINAL_RESP_RX_TS_IDX    14
+#define RNG_FINAL_FINAL_TX_TS_IDX   18
+#define RNG_FINAL_TS_LEN            4
+#define RNG_REPORT_TOF_IDX          10      // TOF in 1/2^RNG_TOF_Q device time units
+#define RNG_BPOLL_CNT_IDX           10
+#define RNG_BPOLL_ADDR_IDX          11
+#define RNG_BFINAL_POLL_TX_TS_IDX   10
+#define RNG_BFINAL_FINAL_TX_TS_IDX  14
+#define RNG_BFINAL_RESP_RX_TS_IDX   18
+#define RNG_SSRESP_POLL_RX_TS_IDX   10
+#define RNG_SSRESP_RESP_TX_TS_IDX   14
+
+// Function codes
+#define RNG_FC_POLL                 0x21
+#define RNG_FC_RESP                 0x10
+#define RNG_FC_FINAL                0x23
+#define RNG_FC_REPORT               0x2A
+#define RNG_FC_BPOLL                0x24
+#define RNG_FC_BFINAL               0x25
+#define RNG_FC_SSPOLL               0xE0
+#define RNG_FC_SSRESP               0xE1
+
+// Frame lengths, including the 2 byte FCS added by the DW1000
+#define RNG_POLL_MSG_LEN            12
+#define RNG_RESP_MSG_LEN            15
+#define RNG_FINAL_MSG_LEN           24
+#define RNG_REPORT_MSG_LEN          16
+#define RNG_BPOLL_MSG_LEN(n)        (13 + 2 * (n))
+#define RNG_BFINAL_MSG_LEN(n)       (20 + 4 * (n))
+#define RNG_SSPOLL_MSG_LEN          12
+#define RNG_SSRESP_MSG_LEN          20
+
+// Broadcast mode: responders of one poll, the DW1000 takes standard frames of up to 127 bytes
+#define RNG_BCAST_MAX_PEERS         8
+#define RNG_MSG_MAX_LEN             RNG_BFINAL_MSG_LEN(RNG_BCAST_MAX_PEERS)
+
+#define RNG_ADDR_BCAST              0xFFFF
+
+// Peers whose link mode can be set, the others use DS-TWR
+#define RNG_MAX_LINKS               8
+
+// Short address built from two characters, as used by the examples ('W','A' / 'V','E')
+#define RNG_ADDR(c0, c1)            ((uint16)(c0) | ((uint16)(c1) << 8))
+
+/* Ranging configuration. The timings are those of examples 5a/5b, see their NOTE 4 to 6 */
+typedef struct
+{
+    uint16 panId;                       // PAN ID of all frames
+    uint16 addr;                        // own short address
+    uint8 filter;                       // reject frames of other PANs / for other addresses in the DW1000
+    uint16 txAntDly;                    // TX antenna delay, the initiator adds it to the final TX time it predicts
+    // initiator
+    uint16 pollTxToRespRxDlyUus;        // end of poll TX to RX enable
+    uint16 respRxToFinalTxDlyUus;       // response RX timestamp to final TX timestamp
+    uint16 respRxTimeoutUus;            // response RX timeout
+    // responder
+    uint16 pollRxToRespTxDlyUus;        // poll RX timestamp to response TX timestamp
+    uint16 respTxToFinalRxDlyUus;       // end of response TX to RX enable
+    uint16 finalRxTimeoutUus;           // final RX timeout
+    // optional 4th message, the responder sends the TOF back so the initiator gets the distance too
+    uint8 report;                       // both sides must agree
+    uint16 reportRxTimeoutUus;          // initiator: from the end of the final TX, covers the responder computation
+    // broadcast mode, both sides must agree
+    uint16 bcastSlotUus;                // spacing of the responses, covers one response and the RX re-enable
+    // SS-TWR links, timings of examples 6a/6b
+    uint16 ssPollTxToRespRxDlyUus;      // initiator: end of poll TX to RX enable
+    uint16 ssRespRxTimeoutUus;          // initiator: response RX timeout
+    uint16 ssPollRxToRespTxDlyUus;      // responder: poll RX timestamp to response TX timestamp, keep it short
+    // adaptive DS-TWR delays, see rng_getdelays()
+    uint8 adapt;                        // shrink respRxToFinalTxDlyUus / pollRxToRespTxDlyUus to the measured need
+    uint16 adaptMarginUus;              // slack kept between the delayed TX being armed and its TX time
+    uint16 adaptAirUus;                 // frame airtime and preamble: the delays stay this far above the RX delay of
+                                        // the other side (respTxToFinalRxDlyUus / pollTxToRespRxDlyUus)
+    uint8 rxQual;                       // fill the RX quality of the results, see deca_rxqual.h: 2 more SPI reads
+    // RX windows derived from the PHY, see rng_setphy()
+    uint8 autoTimeouts;                 // response and final windows: frame wait and preamble detection timeouts
+                                        // from the airtime instead of respRxTimeoutUus / ssRespRxTimeoutUus /
+                                        // finalRxTimeoutUus
+    uint16 autoGuardUus;                // slack added to the latest expected preamble and frame ends
+} rng_config_t;
+
+#define RNG_CONFIG_DEFAULT(own_addr) {  \
+    .panId = 0xDECA,                    \
+    .filter = 1,                        \
+    .addr = (own_addr),                 \
+    .txAntDly = 16436,                  \
+    .pollTxToRespRxDlyUus = 300,        \
+    .respRxToFinalTxDlyUus = 4000,      \
+    .respRxTimeoutUus = 6000,           \
+    .pollRxToRespTxDlyUus = 6000,       \
+    .respTxToFinalRxDlyUus = 500,       \
+    .finalRxTimeoutUus = 10000,         \
+    .report = 0,                        \
+    .reportRxTimeoutUus = 3000,         \
+    .bcastSlotUus = 1000,               \
+    .ssPollTxToRespRxDlyUus = 140,      \
+    .ssRespRxTimeoutUus = 510,          \
+    .ssPollRxToRespTxDlyUus = 630,      \
+    .adapt = 0,                         \
+    .adaptMarginUus = 100,              \
+    .adaptAirUus = 300,                 \
+    .autoTimeouts = 0,                  \
+    .autoGuardUus = 20,                 \
+}
+
+/* Tuned DS-TWR delays, e.g. to be stored and given back to the next run */
+typedef struct
+{
+    uint16 respRxToFinalTxDlyUus;       // initiator
+    uint16 pollRxToRespTxDlyUus;        // responder
+    uint16 finalLate;                   // late TX seen since rng_init, read only
+    uint16 respLate;
+} rng_delays_t;
+
+typedef enum
+{
+    RNG_IDLE,
+    RNG_INIT_WAIT_RESP,                 // poll sent, waiting for the response
+    RNG_INIT_WAIT_FINAL_TX,             // final scheduled, waiting for its TX confirmation
+    RNG_INIT_WAIT_REPORT,               // final scheduled, waiting for the report
+    RNG_INIT_WAIT_BRESP,                // broadcast poll sent, collecting the responses
+    RNG_INIT_WAIT_BFINAL_TX,            // broadcast final scheduled, waiting for its TX confirmation
+    RNG_INIT_WAIT_SSRESP,               // SS-TWR poll sent, waiting for the response
+    RNG_RESP_WAIT_POLL,                 // responder listening
+    RNG_RESP_WAIT_FINAL,                // response scheduled, waiting for the final
+    RNG_RESP_WAIT_REPORT_TX,            // report sent, waiting for its TX confirmation
+    RNG_RESP_WAIT_SSRESP_TX             // SS-TWR response scheduled, waiting for its TX confirmation
+} rng_state_t;
+
+typedef enum
+{
+    RNG_MODE_DS,                        // double-sided, 3 messages (4 with the report)
+    RNG_MODE_SS                         // single-sided with clock offset correction, 2 messages
+} rng_mode_t;
+
+typedef enum
+{
+    RNG_OK,
+    RNG_ERR_RX_TIMEOUT,                 // expected frame did not come
+    RNG_ERR_RX,                         // RX error (PHR, CRC, sync loss, SFD timeout)
+    RNG_ERR_FRAME,                      // unexpected frame
+    RNG_ERR_TX_LATE,                    // delayed TX time already passed
+    RNG_ERR_BUSY                        // channel still busy after the CSMA backoffs, the poll was not sent
+} rng_status_t;
+
+/* Outcome of one exchange */
+typedef struct
+{
+    uint16 peer;                        // short address of the other side
+    uint8 seq;                          // sequence number of the poll
+    rng_status_t status;
+    // set on RNG_OK by the DS-TWR responder, and by the initiator for SS-TWR or when the report is used
+    int32 tof;                          // time of flight, in 1/2^RNG_TOF_Q device time units
+    int32 distMm;                       // distance in millimetres
+    float distance;                     // in metres
+    // set with rxQual on RNG_OK, from the last frame of the exchange received: the final (responder), the report or
+    // the SS-TWR response (initiator); DECA_RXQUAL_NONE and 0 otherwise
+    int16 fpPowerQ8;                    // first path power, dBm Q8
+    int16 rxPowerQ8;                    // RX power, dBm Q8
+    uint8 los;                          // line of sight indicator, 0 to 100
+} rng_result_t;
+
+/* Result callback, called from the DW1000 IRQ thread */
+typedef void (*rng_result_cb_t)(const rng_result_t *result);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_init()
+ *
+ * @brief Set the ranging configuration and take over the DW1000 event callbacks and interrupts. The DW1000 must
+ *        have been initialised (with DWT_LOADUCODE) and configured, antenna delays included. The first call takes the
+ *        TX and RX buffers of the engine from the frame pool (deca_frame.h).
+ *
+ * input parameters
+ * @param config - timings and addresses, copied
+ * @param cb     - called at the end of each exchange, may be NULL
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if config is NULL or the frame pool is exhausted
+ */
+int rng_init(const rng_config_t *config, rng_result_cb_t cb);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_getdelays()
+ *
+ * @brief Read the DS-TWR delays in use. With config.adapt set, the engine reads the system time just before each
+ *        unicast delayed TX of a final (initiator) or a response (responder) to measure how much of the delay the
+ *        processing left over. Every RNG_ADAPT_WINDOW exchanges the delay is cut by half the smallest slack above
+ *        adaptMarginUus, a late TX puts it back up by twice the margin. The delays stay between the configured ones
+ *        and the RX delay of the other side plus adaptAirUus, both sides must use the same configuration.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param delays - delays in use and late TX counts
+ *
+ * no return value
+ */
+void rng_getdelays(rng_delays_t *delays);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setdelays()
+ *
+ * @brief Start from previously tuned delays instead of the configured ones, call after rng_init().
+ *
+ * input parameters
+ * @param delays - delays, clamped to the adaptation range, the late counts are ignored
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_setdelays(const rng_delays_t *delays);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setphy()
+ *
+ * @brief Take the channel and data rate of the DW1000 configuration, they give the factor converting the carrier
+ *        integrator into the clock offset that SS-TWR corrects, and the PRF for the RX quality (64 MHz until then).
+ *        Call it with the configuration given to dwt_configure(), before ranging on SS-TWR links.
+ *
+ *        With autoTimeouts the preamble length, PAC, SFD and data rate also give the airtime of the frames: the
+ *        receiver waiting for a response (DS and SS-TWR) or a unicast final gives up when no preamble is detected
+ *        autoGuardUus after the latest one expected (DRX_PRETOC), and after the end of the latest frame expected
+ *        (RX_FWTO). The latest times follow the configured delays, the reply delays at their ceiling when adapt is
+ *        set. The report and broadcast windows and the responder waiting for a poll keep their configured timeouts,
+ *        without preamble detection timeout. Until this is called the configured timeouts apply.
+ *
+ * input parameters
+ * @param phy - DW1000 configuration
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the channel is not supported
+ */
+int rng_setphy(const dwt_config_t *phy);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_peerppm()
+ *
+ * @brief Clock offset of the sender of the last frame received, from the carrier integrator and the factor of
+ *        rng_setphy(): positive when the local clock runs slower. Reads the DW1000, e.g. from the result callback.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the clock offset in ppm
+ */
+float rng_peerppm(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_setlinkmode()
+ *
+ * @brief Select DS-TWR or SS-TWR for the exchanges this initiator starts with a peer (rng_initiate(),
+ *        rng_initiate_at()). SS-TWR saves the final, at the cost of accuracy with long reply times. Broadcast
+ *        exchanges are always DS-TWR. The responder follows the poll it receives, it needs no setting.
+ *
+ * input parameters
+ * @param peer - short address of the responder
+ * @param mode - link mode
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if RNG_MAX_LINKS peers already have a mode set
+ */
+int rng_setlinkmode(uint16 peer, rng_mode_t mode);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate()
+ *
+ * @brief Start an exchange with a responder and return at once, the result callback reports how it ended. The
+ *        exchange is DS-TWR unless the link is set to SS-TWR. With CONFIG_DW1000_CSMA the poll waits for a clear
+ *        channel (mac_csma.h, mac_csma_init() called before), RNG_ERR_BUSY if it stays busy.
+ *
+ * input parameters
+ * @param peer - short address of the responder
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the poll was sent or is waiting for the channel, or DWT_ERROR if the engine is busy
+ */
+int rng_initiate(uint16 peer);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate_at()
+ *
+ * @brief As rng_initiate(), the poll is sent with a delayed TX at the given DW1000 time.
+ *
+ * input parameters
+ * @param peer   - short address of the responder
+ * @param txTime - poll TX time, high 32 bits of the 40-bit system time (as dwt_setdelayedtrxtime())
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the poll is scheduled, or DWT_ERROR if the engine is busy or the time has already passed
+ */
+int rng_initiate_at(uint16 peer, uint32 txTime);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_initiate_bcast()
+ *
+ * @brief Start a broadcast DS-TWR exchange with several responders and return at once. Responder i of the list answers
+ *        bcastSlotUus * i after the first one, the final follows the last slot whatever the responses received.
+ *        The result callback is then called once per responder, in list order. As in unicast mode without the
+ *        report, the distances are computed by the responders; the report is not used in broadcast mode, it would
+ *        bring back N more messages.
+ *
+ * input parameters
+ * @param peers - short addresses of the responders
+ * @param count - number of responders, 1 to RNG_BCAST_MAX_PEERS
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the poll was sent, or DWT_ERROR if the engine is busy or count is out of range
+ */
+int rng_initiate_bcast(const uint16 *peers, uint8 count);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_respond()
+ *
+ * @brief Start answering polls addressed to us, or broadcast polls listing us. Reception is re-enabled after every exchange, the result callback
+ *        reports each of them with the measured distance, until rng_stop().
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if the engine is busy
+ */
+int rng_respond(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_stop()
+ *
+ * @brief Abort any exchange in progress, turn the transceiver off and go back to idle.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void rng_stop(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_getstate()
+ *
+ * @brief Return the state of the engine.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the current rng_state_t
+ */
+rng_state_t rng_getstate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RNG_TWR_H_ */
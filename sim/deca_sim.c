@@ -0,0 +1,1370 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_sim.c
+ * @brief   Register level DW1000 model, for host builds of the driver and the
+ *          ranging engine
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "deca_sim.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+
+#define SIM_NONE                UINT64_MAX
+#define SIM_TS_MASK             0xFFFFFFFFFFULL
+#define SIM_TS_HALF             0x8000000000ULL
+// UWB microsecond (512 / 499.2 MHz), unit of the RX timeouts and the RX after TX delay
+#define SIM_UUS                 65536ULL
+// One mm of propagation: 3.3356 ps
+#define SIM_TICKS_PER_MM        0.2131397
+// Immediate TX: PLL and TX blocks power up before the preamble
+#define SIM_TX_POWERUP          DECA_SIM_NS_TO_TICKS(5000)
+// Preamble symbols a receiver needs to acquire the frame
+#define SIM_RX_SYNC_SYMS        16
+// Free space link budget on channel 5 at -41.3 dBm/MHz: RX power at 1 m, dBm
+#define SIM_RX_POWER_1M         (-63.0)
+
+// 38.4 MHz reference clock cycle, the SYNC input is sampled on it
+#define SIM_EXTCLK_TICKS        1664
+
+#define SIM_REG_FILES           64
+#define SIM_REG_LEN             64      // register files not listed in sim_reg_len[]
+#define SIM_FRAME_MAX           1024
+
+#ifndef MIN
+#define MIN(a, b)               (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)               (((a) > (b)) ? (a) : (b))
+#endif
+
+/* Register files larger than SIM_REG_LEN, or not stored (ACC_MEM reads 0) */
+static const uint16 sim_reg_len[SIM_REG_FILES] = {
+    [TX_BUFFER_ID] = SIM_FRAME_MAX,
+    [RX_BUFFER_ID] = SIM_FRAME_MAX,
+    [LDE_IF_ID] = LDE_REPC_OFFSET + 2,
+    [ACC_MEM_ID] = 1,
+};
+
+/* Heap entry: arrivals (a: receiver | frame << 16, b: propagation delay) or IRQs (a: node, b: IRQ edge count) */
+typedef struct
+{
+    uint64_t t;
+    uint32 a;
+    uint32 b;
+} sim_ev_t;
+
+typedef struct
+{
+    sim_ev_t *ev;
+    uint32 len;
+    uint32 cap;
+} sim_heap_t;
+
+/* Frame on the air */
+typedef struct
+{
+    uint16 refs;                        // arrivals pending and receivers locked on it, 0 when free
+    uint16 src;
+    uint64_t rmarker;                   // true time the RMARKER leaves the antenna of the sender
+    uint64_t end;                       // true time the last bit does
+    uint64_t syncDly;                   // preamble start to the last moment a receiver may acquire it
+    uint32 fctrl;                       // TX_FCTRL and CHAN_CTRL of the sender
+    uint32 chan;
+    uint16 len;                         // with the FCS
+    uint8 data[SIM_FRAME_MAX];
+} sim_air_t;
+
+typedef enum
+{
+    SIM_TX_IDLE,
+    SIM_TX_WAIT,                        // armed, preamble not started
+    SIM_TX_ON
+} sim_tx_state_t;
+
+typedef enum
+{
+    SIM_RX_OFF,
+    SIM_RX_ON,                          // listening from rxOn
+    SIM_RX_FRAME                        // locked on rxFrame
+} sim_rx_state_t;
+
+typedef struct
+{
+    deca_sim_node_config_t cfg;
+    uint8 *reg[SIM_REG_FILES];
+    sim_tx_state_t txState;
+    uint64_t txStart;                   // true times: preamble start, RMARKER and end of the frame sent
+    uint64_t txRmarker;
+    uint64_t txEnd;
+    uint64_t txRawTs;                   // RMARKER on the clock of the node
+    uint8 w4r;                          // RX after the TX
+    sim_rx_state_t rxState;
+    uint64_t rxOn;
+    uint64_t rxTo;                      // RX_FWTO expiry, SIM_NONE without
+    uint64_t rxPto;                     // DRX_PRETOC expiry while no preamble is detected, SIM_NONE without
+    uint64_t rxOnAcc;                   // receiver on time before the current RX
+    uint8 rxFrame;
+    uint32 rxProp;                      // propagation delay of rxFrame
+    uint8 rxCorrupt;                    // an overlapping frame arrived
+    uint8 irqEn;
+    uint8 irqLine;
+    uint32 irqEdges;
+    uint32 evVer;                       // timer changes, stale heap entries are skipped
+    uint64_t evT;
+    uint64_t syncLocal;                 // clock of the node at the last SYNC edge
+    deca_sim_stats_t stats;
+} sim_node_t;
+
+typedef struct
+{
+    deca_sim_config_t cfg;
+    uint16 count;
+    sim_node_t *nodes;
+    sim_node_t *cur;
+    uint64_t now;
+    uint32 rnd;
+    sim_heap_t arrivals;
+    sim_heap_t timers;                  // a: node, b: evVer
+    sim_heap_t irqs;
+    deca_sim_wait_cb_t wait;            // transaction time, deca_sim_advance() if NULL
+    sim_air_t air[DECA_SIM_AIR_FRAMES];
+} deca_sim_local_t;
+
+static deca_sim_local_t sim;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_push() / sim_pop()
+ *
+ * @brief Binary min-heap on the event time.
+ */
+static void sim_push(sim_heap_t *h, uint64_t t, uint32 a, uint32 b)
+{
+    uint32 i;
+
+    if (h->len == h->cap)
+    {
+        uint32 cap = h->cap ? (h->cap * 2) : 256;
+        sim_ev_t *ev = realloc(h->ev, cap * sizeof(sim_ev_t));
+
+        if (ev == NULL)
+        {
+            return;
+        }
+        h->ev = ev;
+        h->cap = cap;
+    }
+
+    for (i = h->len++; i > 0; i = (i - 1) / 2)
+    {
+        if (h->ev[(i - 1) / 2].t <= t)
+        {
+            break;
+        }
+        h->ev[i] = h->ev[(i - 1) / 2];
+    }
+    h->ev[i].t = t;
+    h->ev[i].a = a;
+    h->ev[i].b = b;
+}
+
+static sim_ev_t sim_pop(sim_heap_t *h)
+{
+    sim_ev_t top = h->ev[0];
+    sim_ev_t last = h->ev[--h->len];
+    uint32 i = 0, c;
+
+    while ((c = 2 * i + 1) < h->len)
+    {
+        if ((c + 1 < h->len) && (h->ev[c + 1].t < h->ev[c].t))
+        {
+            c++;
+        }
+        if (last.t <= h->ev[c].t)
+        {
+            break;
+        }
+        h->ev[i] = h->ev[c];
+        i = c;
+    }
+    if (h->len)
+    {
+        h->ev[i] = last;
+    }
+
+    return top;
+}
+
+static inline uint64_t sim_top(const sim_heap_t *h)
+{
+    return h->len ? h->ev[0].t : SIM_NONE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_random()
+ *
+ * @brief xorshift32, for the random losses.
+ */
+static uint32 sim_random(void)
+{
+    sim.rnd ^= sim.rnd << 13;
+    sim.rnd ^= sim.rnd >> 17;
+    sim.rnd ^= sim.rnd << 5;
+    return sim.rnd;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_local() / sim_true()
+ *
+ * @brief Clock of a node at a true time, and the true time a span of its clock takes.
+ */
+static uint64_t sim_local(const sim_node_t *n, uint64_t t)
+{
+    int64_t ppb = n->cfg.clkPpb;
+    int64_t drift = (int64_t)(t / 1000000000ULL) * ppb + (int64_t)(t % 1000000000ULL) * ppb / 1000000000LL;
+
+    return (n->cfg.clkOffset + t + (uint64_t)drift) & SIM_TS_MASK;
+}
+
+static uint64_t sim_true(const sim_node_t *n, uint64_t span)
+{
+    return span - (uint64_t)((int64_t)span * n->cfg.clkPpb / (1000000000LL + n->cfg.clkPpb));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_get() / sim_set()
+ *
+ * @brief Little endian register fields, up to 8 bytes.
+ */
+static uint64_t sim_get(const sim_node_t *n, int id, int off, int len)
+{
+    uint64_t v = 0;
+
+    while (len--)
+    {
+        v = (v << 8) | n->reg[id][off + len];
+    }
+    return v;
+}
+
+static void sim_set(sim_node_t *n, int id, int off, int len, uint64_t v)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        n->reg[id][off + i] = (uint8)v;
+        v >>= 8;
+    }
+}
+
+static inline uint16 sim_reglen(int id)
+{
+    return sim_reg_len[id] ? sim_reg_len[id] : SIM_REG_LEN;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_evc()
+ *
+ * @brief Count an event, 12 bit counters, once enabled in EVC_CTRL.
+ */
+static void sim_evc(sim_node_t *n, int off)
+{
+    if (n->reg[DIG_DIAG_ID][EVC_CTRL_OFFSET] & EVC_EN)
+    {
+        sim_set(n, DIG_DIAG_ID, off, 2, (sim_get(n, DIG_DIAG_ID, off, 2) + 1) & 0x0FFF);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_irqupdate()
+ *
+ * @brief Follow the IRQ line after SYS_STATUS or SYS_MASK changed. A rising edge on a node with its IRQ enabled
+ *        queues its handler after the IRQ latency.
+ */
+static void sim_irqupdate(sim_node_t *n)
+{
+    uint32 status = (uint32)sim_get(n, SYS_STATUS_ID, 0, 4);
+    uint8 line = ((status & (uint32)sim_get(n, SYS_MASK_ID, 0, 4) & ~SYS_STATUS_IRQS) != 0);
+
+    n->reg[SYS_STATUS_ID][0] = (n->reg[SYS_STATUS_ID][0] & ~SYS_STATUS_IRQS) | line;
+
+    if (line && !n->irqLine)
+    {
+        n->irqEdges++;
+        if (n->irqEn)
+        {
+            sim_push(&sim.irqs, sim.now + DECA_SIM_NS_TO_TICKS(sim.cfg.irqLatencyNs), (uint32)(n - sim.nodes),
+                     n->irqEdges);
+        }
+    }
+    n->irqLine = line;
+}
+
+static void sim_status(sim_node_t *n, uint64_t bits)
+{
+    sim_set(n, SYS_STATUS_ID, 0, SYS_STATUS_LEN, sim_get(n, SYS_STATUS_ID, 0, SYS_STATUS_LEN) | bits);
+    sim_irqupdate(n);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_reschedule()
+ *
+ * @brief Queue the next timer of a node after its state changed.
+ */
+static void sim_reschedule(sim_node_t *n)
+{
+    uint64_t t = SIM_NONE;
+
+    if (n->txState == SIM_TX_WAIT)
+    {
+        t = n->txStart;
+    }
+    else if (n->txState == SIM_TX_ON)
+    {
+        t = n->txEnd;
+    }
+    if (n->rxState != SIM_RX_OFF)
+    {
+        t = MIN(t, n->rxTo);
+    }
+    if (n->rxState == SIM_RX_ON)
+    {
+        t = MIN(t, n->rxPto);
+    }
+    if (n->rxState == SIM_RX_FRAME)
+    {
+        t = MIN(t, sim.air[n->rxFrame].end + n->rxProp);
+    }
+
+    if (t != n->evT)
+    {
+        n->evT = t;
+        n->evVer++;
+        if (t != SIM_NONE)
+        {
+            sim_push(&sim.timers, t, (uint32)(n - sim.nodes), n->evVer);
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_airtime()
+ *
+ * @brief Durations of a frame from TX_FCTRL and CHAN_CTRL: preamble start to RMARKER (preamble and SFD), RMARKER to
+ *        end (PHR, data and Reed-Solomon parity), and preamble start to the last moment a receiver may acquire it.
+ */
+static void sim_airtime(uint32 fctrl, uint32 chan, uint16 len, uint64_t *toRm, uint64_t *fromRm, uint64_t *sync)
+{
+    uint64_t sym = (((fctrl & TX_FCTRL_TXPRF_MASK) >> TX_FCTRL_TXPRF_SHFT) == DWT_PRF_16M) ? (496 * 128) : (508 * 128);
+    uint8 br = (uint8)((fctrl & TX_FCTRL_TXBR_MASK) >> TX_FCTRL_TXBR_SHFT);
+    uint64_t phrBit = (br == DWT_BR_110K) ? (8 * SIM_UUS) : SIM_UUS;
+    uint64_t dataBit = (br == DWT_BR_110K) ? (8 * SIM_UUS) : ((br == DWT_BR_850K) ? SIM_UUS : (SIM_UUS / 8));
+    uint32 bits = len * 8;
+    uint16 plen, sfd;
+
+    switch ((fctrl & TX_FCTRL_TXPSR_PE_MASK) >> TX_FCTRL_TXPSR_SHFT << 2)
+    {
+    case DWT_PLEN_64:   plen = 64;   break;
+    case DWT_PLEN_128:  plen = 128;  break;
+    case DWT_PLEN_256:  plen = 256;  break;
+    case DWT_PLEN_512:  plen = 512;  break;
+    case DWT_PLEN_1024: plen = 1024; break;
+    case DWT_PLEN_1536: plen = 1536; break;
+    case DWT_PLEN_2048: plen = 2048; break;
+    default:            plen = 4096; break;
+    }
+
+    if (br == DWT_BR_110K)
+    {
+        sfd = 64;
+    }
+    else
+    {
+        sfd = ((br == DWT_BR_850K) && (chan & CHAN_CTRL_DWSFD)) ? 16 : 8;
+    }
+
+    *toRm = (uint64_t)(plen + sfd) * sym;
+    *fromRm = 21 * phrBit + (uint64_t)(bits + 48 * ((bits + 329) / 330)) * dataBit;
+    *sync = (uint64_t)(plen - SIM_RX_SYNC_SYMS) * sym;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_dist()
+ *
+ * @brief Distance between two nodes, in mm.
+ */
+static double sim_dist(const sim_node_t *a, const sim_node_t *b)
+{
+    double dx = (double)a->cfg.xMm - b->cfg.xMm;
+    double dy = (double)a->cfg.yMm - b->cfg.yMm;
+    double dz = (double)a->cfg.zMm - b->cfg.zMm;
+
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rxoff()
+ *
+ * @brief Receiver off, releasing the frame it was locked on.
+ */
+static void sim_rxoff(sim_node_t *n)
+{
+    if (n->rxState == SIM_RX_FRAME)
+    {
+        sim.air[n->rxFrame].refs--;
+    }
+    if ((n->rxState != SIM_RX_OFF) && (sim.now > n->rxOn))
+    {
+        n->rxOnAcc += sim.now - n->rxOn;
+    }
+    n->rxState = SIM_RX_OFF;
+    n->rxTo = SIM_NONE;
+    n->rxPto = SIM_NONE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rxsym()
+ *
+ * @brief Preamble symbol of the receiver, from the RX PRF of CHAN_CTRL.
+ */
+static uint64_t sim_rxsym(const sim_node_t *n)
+{
+    uint32 chan = (uint32)sim_get(n, CHAN_CTRL_ID, 0, 4);
+
+    return (((chan & CHAN_CTRL_RXFPRF_MASK) >> CHAN_CTRL_RXFPRF_SHIFT) == DWT_PRF_16M) ? (496 * 128) : (508 * 128);
+}
+
+static void sim_rxon(sim_node_t *n, uint64_t t)
+{
+    uint16 fwto = (uint16)sim_get(n, RX_FWTO_ID, RX_FWTO_OFFSET, 2);
+    uint16 pretoc = (uint16)sim_get(n, DRX_CONF_ID, DRX_PRETOC_OFFSET, DRX_PRETOC_LEN);
+    /* The PAC size is in the top bits of DRX_TUNE2: 0x31, 0x33, 0x35, 0x37 for 8 to 64 symbols */
+    uint32 pac = 8 << ((sim_get(n, DRX_CONF_ID, DRX_TUNE2_OFFSET, 4) >> 25) & 0x3);
+
+    sim_rxoff(n);
+    n->rxState = SIM_RX_ON;
+    n->rxOn = t;
+    n->rxTo = ((sim_get(n, SYS_CFG_ID, 0, 4) & SYS_CFG_RXWTOE) && fwto) ? (t + fwto * SIM_UUS) : SIM_NONE;
+    /* The counter adds one PAC to the value set */
+    n->rxPto = pretoc ? (t + (uint64_t)(pretoc + 1) * pac * sim_rxsym(n)) : SIM_NONE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_reset()
+ *
+ * @brief Registers and transceiver to their state after power up or a soft reset.
+ */
+static void sim_reset(sim_node_t *n)
+{
+    int i;
+
+    for (i = 0; i < SIM_REG_FILES; i++)
+    {
+        memset(n->reg[i], 0, sim_reglen(i));
+    }
+    sim_set(n, DEV_ID_ID, 0, 4, DWT_DEVICE_ID);
+    sim_set(n, SYS_CFG_ID, 0, 4, SYS_CFG_DIS_DRXB | SYS_CFG_HIRQ_POL);
+    sim_set(n, TX_FCTRL_ID, 0, 4, 0x0015400C);
+    sim_set(n, CHAN_CTRL_ID, 0, 4, 0x00000055);
+    sim_set(n, PANADR_ID, 0, 4, 0xFFFFFFFF);
+
+    n->txState = SIM_TX_IDLE;
+    sim_rxoff(n);
+    n->w4r = 0;
+    sim_irqupdate(n);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_txarm()
+ *
+ * @brief SYS_CTRL TXSTRT: schedule the frame of TX_BUFFER, now or at DX_TIME. A delayed TX less than the preamble
+ *        ahead (TXPUTE) or in the past (HPDWARN) is refused.
+ */
+static void sim_txarm(sim_node_t *n, int delayed, int w4r)
+{
+    uint32 fctrl = (uint32)sim_get(n, TX_FCTRL_ID, 0, 4);
+    uint64_t toRm, fromRm, sync;
+
+    sim_airtime(fctrl, (uint32)sim_get(n, CHAN_CTRL_ID, 0, 4), fctrl & TX_FCTRL_FLE_MASK, &toRm, &fromRm, &sync);
+
+    if (delayed)
+    {
+        uint64_t dx = sim_get(n, DX_TIME_ID, 0, 5) & SIM_TS_MASK & ~0x1FFULL;
+        uint64_t span = (dx - sim_local(n, sim.now)) & SIM_TS_MASK;
+
+        if (span >= SIM_TS_HALF)
+        {
+            sim_status(n, SYS_STATUS_HPDWARN);
+            sim_evc(n, EVC_HPW_OFFSET);
+            n->stats.txLate++;
+            return;
+        }
+        if (sim_true(n, span) < toRm + SIM_TX_POWERUP)
+        {
+            sim_status(n, SYS_STATUS_TXPUTE);
+            sim_evc(n, EVC_TPW_OFFSET);
+            n->stats.txLate++;
+            return;
+        }
+        n->txRmarker = sim.now + sim_true(n, span);
+        n->txRawTs = dx;
+    }
+    else
+    {
+        n->txRmarker = sim.now + SIM_TX_POWERUP + toRm;
+        n->txRawTs = sim_local(n, n->txRmarker);
+    }
+
+    sim_rxoff(n);
+    n->txState = SIM_TX_WAIT;
+    n->txStart = n->txRmarker - toRm;
+    n->txEnd = n->txRmarker + fromRm;
+    n->w4r = (uint8)w4r;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rxarm()
+ *
+ * @brief SYS_CTRL RXENAB: receiver on now or at DX_TIME, a delayed RX in the past is refused (HPDWARN).
+ */
+static void sim_rxarm(sim_node_t *n, int delayed)
+{
+    if (delayed)
+    {
+        uint64_t dx = sim_get(n, DX_TIME_ID, 0, 5) & SIM_TS_MASK & ~0x1FFULL;
+        uint64_t span = (dx - sim_local(n, sim.now)) & SIM_TS_MASK;
+
+        if (span >= SIM_TS_HALF)
+        {
+            sim_status(n, SYS_STATUS_HPDWARN);
+            sim_evc(n, EVC_HPW_OFFSET);
+            n->stats.txLate++;
+            return;
+        }
+        sim_rxon(n, sim.now + sim_true(n, span));
+    }
+    else
+    {
+        sim_rxon(n, sim.now);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_txstart()
+ *
+ * @brief Preamble start: put the frame on the air and queue its arrival at the other nodes in range.
+ */
+static void sim_txstart(sim_node_t *n)
+{
+    uint32 fctrl = (uint32)sim_get(n, TX_FCTRL_ID, 0, 4);
+    uint16 len = fctrl & TX_FCTRL_FLE_MASK;
+    uint16 off = (uint16)((fctrl & TX_FCTRL_TXBOFFS_MASK) >> TX_FCTRL_TXBOFFS_SHFT);
+    uint64_t toRm, fromRm;
+    sim_air_t *f = NULL;
+    int i;
+
+    n->txState = SIM_TX_ON;
+    n->stats.txFrames++;
+    sim_evc(n, EVC_TXFS_OFFSET);
+
+    for (i = 0; i < DECA_SIM_AIR_FRAMES; i++)
+    {
+        if (sim.air[i].refs == 0)
+        {
+            f = &sim.air[i];
+            break;
+        }
+    }
+    if ((f == NULL) || (len < 2))
+    {
+        return;
+    }
+
+    f->src = (uint16)(n - sim.nodes);
+    f->fctrl = fctrl;
+    f->chan = (uint32)sim_get(n, CHAN_CTRL_ID, 0, 4);
+    f->len = len;
+    f->rmarker = n->txRmarker + n->cfg.txAntDly;
+    f->end = n->txEnd + n->cfg.txAntDly;
+    sim_airtime(fctrl, f->chan, len, &toRm, &fromRm, &f->syncDly);
+    memset(f->data, 0, len);
+    memcpy(f->data, &n->reg[TX_BUFFER_ID][off], MIN(len - 2, SIM_FRAME_MAX - off));
+
+    for (i = 0; i < sim.count; i++)
+    {
+        sim_node_t *r = &sim.nodes[i];
+        double mm;
+
+        if (r == n)
+        {
+            continue;
+        }
+        mm = sim_dist(n, r);
+        if (sim.cfg.maxRangeMm && (mm > sim.cfg.maxRangeMm))
+        {
+            continue;
+        }
+        f->refs++;
+        sim_push(&sim.arrivals, n->txStart + n->cfg.txAntDly + (uint64_t)(mm * SIM_TICKS_PER_MM) + f->syncDly,
+                 (uint32)i | ((uint32)(f - sim.air) << 16), (uint32)(mm * SIM_TICKS_PER_MM));
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_txend()
+ *
+ * @brief Last bit sent: TX events, TX_TIME, and the receiver on after the wait for response delay.
+ */
+static void sim_txend(sim_node_t *n)
+{
+    uint64_t stamp = (n->txRawTs + sim_get(n, TX_ANTD_ID, 0, 2)) & SIM_TS_MASK;
+
+    n->txState = SIM_TX_IDLE;
+    sim_set(n, TX_TIME_ID, TX_TIME_TX_STAMP_OFFSET, TX_TIME_TX_STAMP_LEN, stamp);
+    sim_set(n, TX_TIME_ID, TX_TIME_TX_RAWST_OFFSET, TX_TIME_TX_STAMP_LEN, n->txRawTs);
+    sim_status(n, SYS_STATUS_TXFRB | SYS_STATUS_TXPRS | SYS_STATUS_TXPHS | SYS_STATUS_TXFRS);
+
+    if (n->w4r)
+    {
+        n->w4r = 0;
+        sim_rxon(n, sim.now + (sim_get(n, ACK_RESP_T_ID, 0, 4) & ACK_RESP_T_W4R_TIM_MASK) * SIM_UUS);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_hears() / sim_arrival()
+ *
+ * @brief A receiver is on the channel, preamble code and data rate mode of a frame. Last moment a receiver may
+ *        acquire a frame: lock on it if listening and hearing it, or corrupt the one being received.
+ */
+static int sim_hears(const sim_node_t *n, const sim_air_t *f)
+{
+    uint32 chan = (uint32)sim_get(n, CHAN_CTRL_ID, 0, 4);
+    uint8 rx110k = (sim_get(n, SYS_CFG_ID, 0, 4) & SYS_CFG_RXM110K) != 0;
+    uint8 tx110k = ((f->fctrl & TX_FCTRL_TXBR_MASK) >> TX_FCTRL_TXBR_SHFT) == DWT_BR_110K;
+
+    return ((f->chan & CHAN_CTRL_TX_CHAN_MASK) == ((chan & CHAN_CTRL_RX_CHAN_MASK) >> CHAN_CTRL_RX_CHAN_SHIFT)) &&
+           (((f->chan & CHAN_CTRL_TX_PCOD_MASK) >> CHAN_CTRL_TX_PCOD_SHIFT) ==
+            ((chan & CHAN_CTRL_RX_PCOD_MASK) >> CHAN_CTRL_RX_PCOD_SHIFT)) && (rx110k == tx110k);
+}
+
+static void sim_arrival(sim_node_t *n, uint8 fi, uint32 prop)
+{
+    sim_air_t *f = &sim.air[fi];
+
+    f->refs--;
+
+    if (!sim_hears(n, f))
+    {
+        return;
+    }
+
+    if (n->rxState == SIM_RX_FRAME)
+    {
+        n->rxCorrupt = 1;
+        n->stats.rxCollided++;
+        return;
+    }
+    if ((n->rxState != SIM_RX_ON) || (n->rxOn > sim.now))
+    {
+        return;
+    }
+    if (sim.cfg.lossPct && ((sim_random() % 100) < sim.cfg.lossPct))
+    {
+        n->stats.rxLost++;
+        return;
+    }
+
+    n->rxState = SIM_RX_FRAME;
+    n->rxPto = SIM_NONE;
+    n->rxFrame = fi;
+    n->rxProp = prop;
+    n->rxCorrupt = 0;
+    f->refs++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_filter()
+ *
+ * @brief Frame filter of SYS_CFG: returns 1 to accept the frame.
+ */
+static int sim_filter(sim_node_t *n, const sim_air_t *f)
+{
+    uint32 cfg = (uint32)sim_get(n, SYS_CFG_ID, 0, 4);
+    uint8 type = f->data[0] & 0x07;
+    uint16 pan, dst;
+
+    if (!(cfg & SYS_CFG_FFE))
+    {
+        return 1;
+    }
+    if (!(cfg & (SYS_CFG_FFAB << MIN(type, 4))))
+    {
+        return 0;
+    }
+    if ((type != 1) && (type != 3))
+    {
+        return 1;
+    }
+
+    switch ((f->data[1] >> 2) & 0x03)
+    {
+    case 2:
+        pan = f->data[3] | (f->data[4] << 8);
+        dst = f->data[5] | (f->data[6] << 8);
+        return ((pan == 0xFFFF) || (pan == sim_get(n, PANADR_ID, PANADR_PAN_ID_OFFSET, 2))) &&
+               ((dst == 0xFFFF) || (dst == sim_get(n, PANADR_ID, PANADR_SHORT_ADDR_OFFSET, 2)));
+    case 3:
+        return 1;
+    default:
+        return (cfg & SYS_CFG_FFBC) != 0;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rxquality()
+ *
+ * @brief RX_FINFO, RX_TIME diagnostics, RX_FQUAL and the carrier integrator of a frame received: free space RX power,
+ *        line of sight, clock offset between the two nodes.
+ */
+static void sim_rxquality(sim_node_t *n, const sim_air_t *f)
+{
+    const sim_node_t *src = &sim.nodes[f->src];
+    uint8 prf = (uint8)((f->fctrl & TX_FCTRL_TXPRF_MASK) >> TX_FCTRL_TXPRF_SHFT);
+    uint8 br = (uint8)((f->fctrl & TX_FCTRL_TXBR_MASK) >> TX_FCTRL_TXBR_SHFT);
+    double a = (prf == DWT_PRF_16M) ? 113.77 : 121.74;
+    double mm = MAX(sim_dist(n, src), 100.0);
+    double pwr = SIM_RX_POWER_1M - 20.0 * log10(mm / 1000.0);
+    double hz_to_ppm, factor, offset;
+    uint64_t toRm, fromRm, sync;
+    uint32 pacc, finfo;
+    double c, amp;
+
+    sim_airtime(f->fctrl, f->chan, f->len, &toRm, &fromRm, &sync);
+    pacc = (uint32)MIN(sync / (((prf == DWT_PRF_16M) ? 496 : 508) * 128) + SIM_RX_SYNC_SYMS - 8, 0xFFF);
+
+    finfo = f->len | ((uint32)br << RX_FINFO_RXBR_SHIFT) | (f->fctrl & (1UL << TX_FCTRL_TR_SHFT)) |
+            ((uint32)prf << RX_FINFO_RXPRF_SHIFT) | (f->fctrl & TX_FCTRL_TXPSR_MASK) | (pacc << RX_FINFO_RXPACC_SHIFT);
+    sim_set(n, RX_FINFO_ID, 0, 4, finfo);
+
+    c = pow(10.0, (pwr + a) / 10.0) * pacc * pacc;
+    amp = MIN(sqrt(c / 3.0), 65535.0);
+    sim_set(n, RX_TIME_ID, RX_TIME_FP_INDEX_OFFSET, 2, 750 << 6);
+    sim_set(n, RX_TIME_ID, RX_TIME_FP_AMPL1_OFFSET, 2, (uint16)amp);
+    sim_set(n, RX_FQUAL_ID, 0, 2, 40);
+    sim_set(n, RX_FQUAL_ID, 2, 2, (uint16)amp);
+    sim_set(n, RX_FQUAL_ID, 4, 2, (uint16)amp);
+    sim_set(n, RX_FQUAL_ID, 6, 2, (uint16)MIN(c / 131072.0, 65535.0));
+
+    /* Remote clock against the local one, as dwt_readcarrierintegrator() and the constants of deca_device_api.h
+     * turn it into a clock offset ratio */
+    switch (f->chan & CHAN_CTRL_TX_CHAN_MASK)
+    {
+    case 1:  hz_to_ppm = HERTZ_TO_PPM_MULTIPLIER_CHAN_1; break;
+    case 2:
+    case 4:  hz_to_ppm = HERTZ_TO_PPM_MULTIPLIER_CHAN_2; break;
+    case 3:  hz_to_ppm = HERTZ_TO_PPM_MULTIPLIER_CHAN_3; break;
+    default: hz_to_ppm = HERTZ_TO_PPM_MULTIPLIER_CHAN_5; break;
+    }
+    factor = ((br == DWT_BR_110K) ? FREQ_OFFSET_MULTIPLIER_110KB : FREQ_OFFSET_MULTIPLIER) * hz_to_ppm / 1.0e6;
+    offset = (double)(src->cfg.clkPpb - n->cfg.clkPpb) * 1.0e-9;
+    sim_set(n, DRX_CONF_ID, DRX_CARRIER_INT_OFFSET, DRX_CARRIER_INT_LEN,
+            (uint32)(int32)lround(offset / factor) & DRX_CARRIER_INT_MASK);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rxend()
+ *
+ * @brief Last bit of the frame locked on: RX events, RX_BUFFER and RX_TIME, or the CRC error of a corrupted frame.
+ */
+static void sim_rxend(sim_node_t *n)
+{
+    sim_air_t *f = &sim.air[n->rxFrame];
+    uint64_t raw;
+
+    if (n->rxCorrupt)
+    {
+        sim_rxoff(n);
+        sim_evc(n, EVC_FCE_OFFSET);
+        sim_status(n, SYS_STATUS_RXPRD | SYS_STATUS_RXSFDD | SYS_STATUS_RXPHD | SYS_STATUS_RXFCE);
+        return;
+    }
+
+    if (!sim_filter(n, f))
+    {
+        /* Rejected: the receiver stops, as without auto re-enable */
+        sim_rxoff(n);
+        n->stats.rxFiltered++;
+        sim_evc(n, EVC_FFR_OFFSET);
+        sim_status(n, SYS_STATUS_AFFREJ);
+        return;
+    }
+
+    memcpy(n->reg[RX_BUFFER_ID], f->data, f->len);
+    raw = sim_local(n, f->rmarker + n->rxProp + n->cfg.rxAntDly);
+    sim_set(n, RX_TIME_ID, RX_TIME_RX_STAMP_OFFSET, RX_TIME_RX_STAMP_LEN,
+            (raw - sim_get(n, LDE_IF_ID, LDE_RXANTD_OFFSET, 2)) & SIM_TS_MASK);
+    sim_set(n, RX_TIME_ID, RX_TIME_FP_RAWST_OFFSET, RX_TIME_RX_STAMP_LEN, raw);
+    if (sim_get(n, EXT_SYNC_ID, EC_CTRL_OFFSET, 2) & EC_CTRL_OSRSM)
+    {
+        /* Whole reference clock cycles since the SYNC edge, then ns to the next cycle */
+        uint64_t span = (raw - n->syncLocal) & SIM_TS_MASK;
+        uint64_t ns = DECA_SIM_TICKS_TO_NS(SIM_EXTCLK_TICKS - (span % SIM_EXTCLK_TICKS));
+
+        sim_set(n, EXT_SYNC_ID, EC_RXTC_OFFSET, EC_RXTC_LEN, span / SIM_EXTCLK_TICKS);
+        sim_set(n, EXT_SYNC_ID, EC_GOLP, EC_GOLP_LEN, MIN(ns, EC_GOLP_MASK));
+    }
+    sim_rxquality(n, f);
+
+    sim_rxoff(n);
+    n->stats.rxGood++;
+    sim_evc(n, EVC_FCG_OFFSET);
+    sim_status(n, SYS_STATUS_RXPRD | SYS_STATUS_RXSFDD | SYS_STATUS_LDEDONE | SYS_STATUS_RXPHD | SYS_STATUS_RXDFR |
+               SYS_STATUS_RXFCG);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_preamble()
+ *
+ * @brief DRX_PRETOC expiry of a listening receiver: a frame in range it hears whose preamble arrived at least
+ *        SIM_RX_SYNC_SYMS symbols ago, and that it may still acquire, is detected and stops the timeout.
+ */
+static int sim_preamble(const sim_node_t *n)
+{
+    uint64_t toRm, fromRm, sync, start;
+    const sim_air_t *f;
+    double mm;
+    int i;
+
+    for (i = 0; i < DECA_SIM_AIR_FRAMES; i++)
+    {
+        f = &sim.air[i];
+        if ((f->refs == 0) || (&sim.nodes[f->src] == n) || !sim_hears(n, f))
+        {
+            continue;
+        }
+        mm = sim_dist(&sim.nodes[f->src], n);
+        if (sim.cfg.maxRangeMm && (mm > sim.cfg.maxRangeMm))
+        {
+            continue;
+        }
+        sim_airtime(f->fctrl, f->chan, f->len, &toRm, &fromRm, &sync);
+        start = f->rmarker - toRm + (uint64_t)(mm * SIM_TICKS_PER_MM);
+        if ((start + SIM_RX_SYNC_SYMS * sim_rxsym(n) <= sim.now) && (start + f->syncDly >= sim.now))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_timers()
+ *
+ * @brief Run the timers of a node due by now.
+ */
+static void sim_timers(sim_node_t *n)
+{
+    if ((n->txState == SIM_TX_WAIT) && (n->txStart <= sim.now))
+    {
+        sim_txstart(n);
+    }
+    if ((n->txState == SIM_TX_ON) && (n->txEnd <= sim.now))
+    {
+        sim_txend(n);
+    }
+    if ((n->rxState == SIM_RX_FRAME) && (sim.air[n->rxFrame].end + n->rxProp <= sim.now))
+    {
+        sim_rxend(n);
+    }
+    if ((n->rxState != SIM_RX_OFF) && (n->rxTo <= sim.now))
+    {
+        sim_rxoff(n);
+        n->stats.rxTimeouts++;
+        sim_evc(n, EVC_FWTO_OFFSET);
+        sim_status(n, SYS_STATUS_RXRFTO);
+    }
+    if ((n->rxState == SIM_RX_ON) && (n->rxPto <= sim.now))
+    {
+        if (sim_preamble(n))
+        {
+            n->rxPto = SIM_NONE;
+        }
+        else
+        {
+            sim_rxoff(n);
+            n->stats.rxPreTimeouts++;
+            sim_evc(n, EVC_PTO_OFFSET);
+            sim_status(n, SYS_STATUS_RXPTO);
+        }
+    }
+    sim_reschedule(n);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_step()
+ *
+ * @brief Run the next arrival or timer if due by the limit. With irqs set, a due IRQ handler ends the step first.
+ *
+ * returns the node of a due IRQ handler, -1 after an event, -2 if nothing is due by the limit
+ */
+static int sim_step(uint64_t until, int irqs)
+{
+    uint64_t ta = sim_top(&sim.arrivals);
+    uint64_t tt = sim_top(&sim.timers);
+    uint64_t ti = irqs ? sim_top(&sim.irqs) : SIM_NONE;
+    uint64_t t = MIN(MIN(ta, tt), ti);
+    sim_ev_t ev;
+
+    if (t > until)
+    {
+        return -2;
+    }
+    sim.now = MAX(sim.now, t);
+
+    if (ti == t)
+    {
+        sim_node_t *n;
+
+        ev = sim_pop(&sim.irqs);
+        n = &sim.nodes[ev.a];
+        return (n->irqEn && n->irqLine && (n->irqEdges == ev.b)) ? (int)ev.a : -1;
+    }
+    if (ta == t)
+    {
+        ev = sim_pop(&sim.arrivals);
+        sim_arrival(&sim.nodes[ev.a & 0xFFFF], (uint8)(ev.a >> 16), ev.b);
+        sim_reschedule(&sim.nodes[ev.a & 0xFFFF]);
+        return -1;
+    }
+
+    ev = sim_pop(&sim.timers);
+    if (sim.nodes[ev.a].evVer == ev.b)
+    {
+        sim.nodes[ev.a].evT = SIM_NONE;
+        sim_timers(&sim.nodes[ev.a]);
+    }
+    return -1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_regwrite()
+ *
+ * @brief Write access: the command and write 1 to clear registers act, the others store.
+ */
+static void sim_regwrite(sim_node_t *n, int id, uint16 idx, const uint8 *buf, uint32 len)
+{
+    uint16 size = sim_reglen(id);
+    uint32 i;
+
+    switch (id)
+    {
+    case SYS_CTRL_ID:
+        if (idx == SYS_CTRL_OFFSET)
+        {
+            uint32 cmd = 0;
+
+            for (i = 0; i < len && i < 4; i++)
+            {
+                cmd |= (uint32)buf[i] << (8 * i);
+            }
+            if (cmd & SYS_CTRL_TRXOFF)
+            {
+                n->txState = SIM_TX_IDLE;
+                n->w4r = 0;
+                sim_rxoff(n);
+            }
+            /* TXSTRT with TRXOFF is the SFD initialisation of dwt_configure(), the TX is aborted at once */
+            if ((cmd & SYS_CTRL_TXSTRT) && !(cmd & SYS_CTRL_TRXOFF))
+            {
+                sim_txarm(n, (cmd & SYS_CTRL_TXDLYS) != 0, (cmd & SYS_CTRL_WAIT4RESP) != 0);
+            }
+            if (cmd & SYS_CTRL_RXENAB)
+            {
+                sim_rxarm(n, (cmd & SYS_CTRL_RXDLYE) != 0);
+            }
+            sim_reschedule(n);
+        }
+        return;
+
+    case SYS_STATUS_ID:
+        for (i = 0; (i < len) && (idx + i < SYS_STATUS_LEN); i++)
+        {
+            n->reg[id][idx + i] &= ~buf[i];
+        }
+        sim_irqupdate(n);
+        return;
+
+    case DEV_ID_ID:
+    case SYS_TIME_ID:
+    case RX_FINFO_ID:
+    case RX_BUFFER_ID:
+    case RX_FQUAL_ID:
+    case RX_TIME_ID:
+    case TX_TIME_ID:
+    case ACC_MEM_ID:
+        return;
+
+    case PMSC_ID:
+        if ((idx == PMSC_CTRL0_SOFTRESET_OFFSET) && (len == 1))
+        {
+            if (buf[0] == PMSC_CTRL0_RESET_ALL)
+            {
+                sim_reset(n);
+                sim_reschedule(n);
+            }
+            else if (buf[0] == PMSC_CTRL0_RESET_RX)
+            {
+                sim_rxoff(n);
+                sim_reschedule(n);
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (idx < size)
+    {
+        memcpy(&n->reg[id][idx], buf, MIN(len, (uint32)(size - idx)));
+    }
+    if (id == SYS_MASK_ID)
+    {
+        sim_irqupdate(n);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_regread()
+ *
+ * @brief Read access, SYS_TIME sampled now.
+ */
+static void sim_regread(sim_node_t *n, int id, uint16 idx, uint8 *buf, uint32 len)
+{
+    uint16 size = sim_reglen(id);
+    uint32 cnt = (idx < size) ? MIN(len, (uint32)(size - idx)) : 0;
+
+    if (id == SYS_TIME_ID)
+    {
+        sim_set(n, SYS_TIME_ID, 0, 5, sim_local(n, sim.now) & ~0x1FFULL);
+    }
+    if (id == ACC_MEM_ID)
+    {
+        cnt = 0;
+    }
+
+    memcpy(buf, &n->reg[id][idx], cnt);
+    memset(buf + cnt, 0, len - cnt);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_access()
+ *
+ * @brief Decode the transaction header, access the selected node, then let the bus time pass.
+ */
+static int sim_access(int write, uint16 headerLength, const uint8 *header, uint32 len, uint8 *buf)
+{
+    sim_node_t *n = sim.cur;
+    uint16 idx = 0;
+    uint64_t cost;
+    int id;
+
+    if ((n == NULL) || (headerLength == 0))
+    {
+        return -1;
+    }
+
+    id = header[0] & 0x3F;
+    if ((header[0] & 0x40) && (headerLength > 1))
+    {
+        idx = header[1] & 0x7F;
+        if ((header[1] & 0x80) && (headerLength > 2))
+        {
+            idx |= (uint16)header[2] << 7;
+        }
+    }
+
+    if (write)
+    {
+        sim_regwrite(n, id, idx, buf, len);
+    }
+    else
+    {
+        sim_regread(n, id, idx, buf, len);
+    }
+    n->stats.spiTrans++;
+
+    cost = DECA_SIM_NS_TO_TICKS(sim.cfg.spiOverheadNs) + (uint64_t)(headerLength + len) * 8 * 63897600000ULL /
+           sim.cfg.spiHz;
+    if (sim.wait != NULL)
+    {
+        sim.wait(cost);
+    }
+    else
+    {
+        deca_sim_advance(cost);
+    }
+    return 0;
+}
+
+static int sim_spi_write(uint16 headerLength, const uint8 *headerBuffer, uint32 bodyLength, const uint8 *bodyBuffer)
+{
+    return sim_access(1, headerLength, headerBuffer, bodyLength, (uint8 *)bodyBuffer);
+}
+
+static int sim_spi_read(uint16 headerLength, const uint8 *headerBuffer, uint32 readLength, uint8 *readBuffer)
+{
+    return sim_access(0, headerLength, headerBuffer, readLength, readBuffer);
+}
+
+const deca_spi_backend_t deca_sim_spi = {
+    .write = sim_spi_write,
+    .read = sim_spi_read,
+};
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_init()
+ *
+ * @brief see deca_sim.h
+ */
+int deca_sim_init(const deca_sim_config_t *config, uint16 nodes)
+{
+    const deca_sim_node_config_t node_cfg = DECA_SIM_NODE_CONFIG_DEFAULT;
+    int i, j;
+
+    deca_sim_exit();
+
+    sim.cfg = *config;
+    sim.rnd = config->seed ? config->seed : 1;
+    sim.nodes = calloc(nodes, sizeof(sim_node_t));
+    if (sim.nodes == NULL)
+    {
+        return DWT_ERROR;
+    }
+    sim.count = nodes;
+
+    for (i = 0; i < nodes; i++)
+    {
+        sim_node_t *n = &sim.nodes[i];
+
+        for (j = 0; j < SIM_REG_FILES; j++)
+        {
+            n->reg[j] = malloc(sim_reglen(j));
+            if (n->reg[j] == NULL)
+            {
+                deca_sim_exit();
+                return DWT_ERROR;
+            }
+        }
+        n->cfg = node_cfg;
+        n->evT = SIM_NONE;
+        n->rxTo = SIM_NONE;
+        n->rxPto = SIM_NONE;
+        sim_reset(n);
+    }
+    sim.cur = &sim.nodes[0];
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_exit()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_exit(void)
+{
+    int i, j;
+
+    for (i = 0; i < sim.count; i++)
+    {
+        for (j = 0; j < SIM_REG_FILES; j++)
+        {
+            free(sim.nodes[i].reg[j]);
+        }
+    }
+    free(sim.nodes);
+    free(sim.arrivals.ev);
+    free(sim.timers.ev);
+    free(sim.irqs.ev);
+    memset(&sim, 0, sizeof(sim));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_setnode()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_setnode(uint16 node, const deca_sim_node_config_t *config)
+{
+    if (node < sim.count)
+    {
+        sim.nodes[node].cfg = *config;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_select()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_select(uint16 node)
+{
+    if (node < sim.count)
+    {
+        sim.cur = &sim.nodes[node];
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_spi_hz()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_spi_hz(uint32 hz)
+{
+    if (hz)
+    {
+        sim.cfg.spiHz = hz;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_now()
+ *
+ * @brief see deca_sim.h
+ */
+uint64_t deca_sim_now(void)
+{
+    return sim.now;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_advance()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_advance(uint64_t ticks)
+{
+    uint64_t until = sim.now + ticks;
+
+    while (sim_step(until, 0) != -2)
+    { };
+    sim.now = until;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_irqenable()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_irqenable(uint16 node, int enable)
+{
+    sim_node_t *n;
+
+    if (node >= sim.count)
+    {
+        return;
+    }
+    n = &sim.nodes[node];
+
+    if (enable && !n->irqEn && n->irqLine)
+    {
+        n->irqEdges++;
+        sim_push(&sim.irqs, sim.now, node, n->irqEdges);
+    }
+    n->irqEn = (enable != 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_irqline()
+ *
+ * @brief see deca_sim.h
+ */
+int deca_sim_irqline(uint16 node)
+{
+    return (node < sim.count) ? sim.nodes[node].irqLine : 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_run()
+ *
+ * @brief see deca_sim.h
+ */
+int deca_sim_run(uint64_t until)
+{
+    int ret;
+
+    while ((ret = sim_step(until, 1)) == -1)
+    { };
+
+    if (ret == -2)
+    {
+        sim.now = MAX(sim.now, until);
+        return -1;
+    }
+    return ret;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_set_wait()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_set_wait(deca_sim_wait_cb_t wait)
+{
+    sim.wait = wait;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_syncpulse()
+ *
+ * @brief see deca_sim.h. The reset moves the clock origin at once: the wait is a few us, nothing the host does
+ *        within it sees the clock before the reset.
+ */
+void deca_sim_syncpulse(void)
+{
+    uint32 ctrl;
+    uint64_t at;
+    sim_node_t *n;
+    uint16 i;
+
+    for (i = 0; i < sim.count; i++)
+    {
+        n = &sim.nodes[i];
+        ctrl = (uint32)sim_get(n, EXT_SYNC_ID, EC_CTRL_OFFSET, 2);
+        n->syncLocal = sim_local(n, sim.now);
+        if (ctrl & EC_CTRL_OSTRM)
+        {
+            at = sim.now + sim_true(n, ((ctrl & EC_CTRL_WAIT_MASK) >> 3) * SIM_EXTCLK_TICKS);
+            n->cfg.clkOffset = (n->cfg.clkOffset - sim_local(n, at)) & SIM_TS_MASK;
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_getstats()
+ *
+ * @brief see deca_sim.h
+ */
+void deca_sim_getstats(uint16 node, deca_sim_stats_t *stats)
+{
+    const sim_node_t *n = &sim.nodes[node];
+    uint64_t on;
+
+    if (node < sim.count)
+    {
+        on = n->rxOnAcc + (((n->rxState != SIM_RX_OFF) && (sim.now > n->rxOn)) ? (sim.now - n->rxOn) : 0);
+        *stats = n->stats;
+        stats->rxOnUs = (uint32)(DECA_SIM_TICKS_TO_NS(on) / 1000);
+    }
+}
@@ -0,0 +1,320 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_sim.h
+ * @brief   Register level DW1000 model, for host builds of the driver and the
+ *          ranging engine
+ *
+ *          The model answers the SPI transactions of the decadriver as a set
+ *          of DW1000s sharing one channel would: it is a deca_spi_backend_t
+ *          (platform/deca_spi.h) on the node selected by deca_sim_select().
+ *          The register files are plain memory, except:
+ *          - SYS_CTRL starts and stops the transceiver: immediate and delayed
+ *            TX, wait for response, immediate and delayed RX, TRXOFF;
+ *          - SYS_STATUS is write 1 to clear, its IRQS bit follows SYS_MASK;
+ *          - SYS_TIME, TX_TIME and RX_TIME count in DW1000 time units on
+ *            the clock of each node (offset and drift), 40 bits;
+ *          - TX_BUFFER/TX_FCTRL give the frame and its airtime (preamble,
+ *            SFD, PHR, data with the Reed-Solomon parity bits), RX_BUFFER,
+ *            RX_FINFO, RX_FQUAL and the carrier integrator describe the frame
+ *            received, with the propagation delay and antenna delays between
+ *            the two nodes;
+ *          - RX_FWTO and DRX_PRETOC timeouts, frame filtering (data frames, PAN ID and short
+ *            address), late delayed TX/RX (HPDWARN, TXPUTE), RX reset;
+ *          - EXT_SYNC: a SYNC edge (deca_sim_syncpulse()) resets the system
+ *            time in timebase reset mode, and is the origin of the RMARKER
+ *            capture of EC_RXTC/EC_GOLP in receive synchronisation mode.
+ *          A frame is received by the nodes in range listening on the same
+ *          channel and preamble code before the end of its preamble, two
+ *          frames overlapping at a receiver corrupt the first (no capture).
+ *
+ *          Time only moves forward with the transactions (each costs its bus
+ *          time at the configured SPI rate plus an overhead, a model of the
+ *          host), deca_sim_advance() and deca_sim_run(). The host port of
+ *          sim/host runs the DW1000 IRQ handlers from deca_sim_run(), each
+ *          node on its own coroutine so that the handlers of different
+ *          nodes overlap in simulated time as on separate MCUs.
+ *
+ *          Not modelled: transmit synchronisation on SYNC, double buffering, auto re-enable, sleep, OTP (reads
+ *          0), the accumulator, SNIFF, the SFD timeout, power capture. The receivers see a free space link
+ *          budget, their RX quality registers follow it.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _DECA_SIM_H_
+#define _DECA_SIM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "deca_types.h"
+#include "deca_spi.h"
+
+// DW1000 time unit: 1 / (128 * 499.2 MHz), 15.65 ps
+#define DECA_SIM_NS_TO_TICKS(ns)    ((uint64_t)(ns) * 638976ULL / 10000ULL)
+#define DECA_SIM_TICKS_TO_NS(t)     ((uint64_t)(t) * 10000ULL / 638976ULL)
+
+// Frames on the air at one time, all nodes together
+#define DECA_SIM_AIR_FRAMES         (64)
+
+typedef struct
+{
+    uint32 spiHz;                       // SPI rate the transactions are timed at
+    uint16 spiOverheadNs;               // per transaction: CS, header set up, driver
+    uint16 irqLatencyNs;                // IRQ line raised to handler running
+    uint8 lossPct;                      // frames each receiver loses at random
+    uint32 maxRangeMm;                  // nodes further apart do not hear each other, 0 for no limit
+    uint32 seed;                        // of the random losses
+} deca_sim_config_t;
+
+#define DECA_SIM_CONFIG_DEFAULT {       \
+    .spiHz = 8000000,                   \
+    .spiOverheadNs = 2000,              \
+    .irqLatencyNs = 10000,              \
+    .lossPct = 0,                       \
+    .maxRangeMm = 0,                    \
+    .seed = 1,                          \
+}
+
+typedef struct
+{
+    int32 xMm;                          // position
+    int32 yMm;
+    int32 zMm;
+    int32 clkPpb;                       // clock drift, parts per billion, |clkPpb| < 100000
+    uint64_t clkOffset;                 // clock value at time 0, DW1000 time units
+    uint16 txAntDly;                    // actual antenna delays, DW1000 time units: the timestamps are exact when
+    uint16 rxAntDly;                    //  TX_ANTD and LDE_RXANTD are programmed with these
+} deca_sim_node_config_t;
+
+#define DECA_SIM_NODE_CONFIG_DEFAULT {  \
+    .xMm = 0,                           \
+    .yMm = 0,                           \
+    .zMm = 0,                           \
+    .clkPpb = 0,                        \
+    .clkOffset = 0,                     \
+    .txAntDly = 16436,                  \
+    .rxAntDly = 16436,                  \
+}
+
+typedef struct
+{
+    uint32 txFrames;                    // frames sent
+    uint32 txLate;                      // delayed TX/RX refused, HPDWARN or TXPUTE
+    uint32 rxGood;                      // frames received and accepted
+    uint32 rxCollided;                  // frames lost at this receiver to an overlapping one
+    uint32 rxLost;                      // frames lost at random
+    uint32 rxFiltered;                  // frames rejected by the frame filter
+    uint32 rxTimeouts;                  // RX_FWTO expiries
+    uint32 rxPreTimeouts;               // DRX_PRETOC expiries
+    uint32 rxOnUs;                      // time the receiver was on
+    uint32 spiTrans;                    // transactions
+} deca_sim_stats_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_init()
+ *
+ * @brief Create the nodes, reset to the DW1000 state after power up with the default node configuration, and start
+ *        the time at 0. Node 0 is selected.
+ *
+ * input parameters
+ * @param config - bus, host and channel model, copied
+ * @param nodes  - number of nodes
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR if out of memory
+ */
+int deca_sim_init(const deca_sim_config_t *config, uint16 nodes);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_exit()
+ *
+ * @brief Free the nodes.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_exit(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_setnode()
+ *
+ * @brief Place a node and set its clock and antenna delays.
+ *
+ * input parameters
+ * @param node   - node index
+ * @param config - position, clock and antenna delays, copied
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_setnode(uint16 node, const deca_sim_node_config_t *config);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_select()
+ *
+ * @brief Select the node the following SPI transactions go to.
+ *
+ * input parameters
+ * @param node - node index
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_select(uint16 node);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_spi_hz()
+ *
+ * @brief Change the SPI rate the transactions are timed at, e.g. from port_set_dw1000_fastrate().
+ *
+ * input parameters
+ * @param hz - SPI clock
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_spi_hz(uint32 hz);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_now()
+ *
+ * @brief Simulated time.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the time since deca_sim_init(), in DW1000 time units
+ */
+uint64_t deca_sim_now(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_advance()
+ *
+ * @brief Let time pass, e.g. for deca_sleep(): the radios carry on, no IRQ handler runs.
+ *
+ * input parameters
+ * @param ticks - DW1000 time units
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_advance(uint64_t ticks);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_irqenable()
+ *
+ * @brief Let deca_sim_run() report the IRQ line of a node, as port_EnableEXT_IRQ()/port_DisableEXT_IRQ().
+ *
+ * input parameters
+ * @param node   - node index
+ * @param enable - 1 to report its IRQ, 0 for a polled node
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_irqenable(uint16 node, int enable);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_irqline()
+ *
+ * @brief Level of the IRQ line of a node, SYS_STATUS against SYS_MASK.
+ *
+ * input parameters
+ * @param node - node index
+ *
+ * output parameters
+ *
+ * returns 1 if raised, 0 if not
+ */
+int deca_sim_irqline(uint16 node);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_run()
+ *
+ * @brief Let time pass until the IRQ of a node with its IRQ enabled has been raised for the IRQ latency, or until the
+ *        limit. The earliest raised goes first. Each rising edge is reported once: the caller runs the handler, then
+ *        runs it again while deca_sim_irqline() stays up, as process_deca_irq() does.
+ *
+ * input parameters
+ * @param until - time limit, DW1000 time units
+ *
+ * output parameters
+ *
+ * returns the node whose handler is due (time stops there), or -1 once the limit is reached
+ */
+int deca_sim_run(uint64_t until);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_getstats()
+ *
+ * @brief Read the counters of a node.
+ *
+ * input parameters
+ * @param node  - node index
+ *
+ * output parameters
+ * @param stats - counters since deca_sim_init()
+ *
+ * no return value
+ */
+void deca_sim_getstats(uint16 node, deca_sim_stats_t *stats);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_syncpulse()
+ *
+ * @brief SYNC edge now on all the nodes, as from one wired SYNC line of equal lengths. Each one acts on it as its
+ *        EC_CTRL tells: reset of the system time after the EC_CTRL wait, or origin of the RX capture.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_syncpulse(void);
+
+/* Time a transaction takes on the bus and the host, see deca_sim_set_wait() */
+typedef void (*deca_sim_wait_cb_t)(uint64_t ticks);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_sim_set_wait()
+ *
+ * @brief Hand the time of each transaction to a callback instead of deca_sim_advance(): a host port running each node
+ *        as its own thread of simulated time lets the other nodes run meanwhile, rather than making them wait for
+ *        the handler of one node to end.
+ *
+ * input parameters
+ * @param wait - called after each transaction with its time, NULL for deca_sim_advance()
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void deca_sim_set_wait(deca_sim_wait_cb_t wait);
+
+/* The model, as an SPI backend of the selected node */
+extern const deca_spi_backend_t deca_sim_spi;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DECA_SIM_H_ */
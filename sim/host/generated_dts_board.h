@@ -0,0 +1 @@
+/* Host builds: no device tree, see sim/host/zephyr.h */
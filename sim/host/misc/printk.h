@@ -0,0 +1,2 @@
+/* Host builds: printk() is in sim/host/zephyr.h */
+#include <zephyr.h>
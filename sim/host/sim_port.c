@@ -0,0 +1,527 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_port.c
+ * @brief   Host port of the DW1000 driver on the register level model, see
+ *          sim_port.h
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "deca_device_api.h"
+#include "deca_spi.h"
+#include "deca_frame.h"
+#include "port.h"
+#include "deca_sim.h"
+#include "sim_port.h"
+
+/* SPI rates of platform/deca_spi.c */
+#define SIM_SPI_SLOW_HZ     2000000
+#define SIM_SPI_FAST_HZ     8000000
+
+// Coroutine stack of each node: dwt_isr(), the callbacks and printf()
+#define SIM_STACK_SIZE      (64 * 1024)
+
+#define SIM_NONE            UINT64_MAX
+#define SIM_MAIN            ((unsigned int)-1)
+
+/* Each node runs its IRQ handler and its calls on a coroutine of its own, see sim_port_wait() */
+typedef struct
+{
+    port_deca_isr_t isr;
+    uint8 irqEn;
+    uint8 busy;                         // coroutine started, suspended in sim_port_wait() when not running
+    uint8 *stack;
+    ucontext_t ctx;
+    uint32 ver;                         // one valid entry per node in sim_sched: wake if busy, call if not
+    sim_port_call_t call;
+    uint64_t callAt;
+} sim_port_dev_t;
+
+typedef struct
+{
+    uint64_t t;
+    uint32 node;
+    uint32 ver;
+} sim_port_ev_t;
+
+static sim_port_dev_t sim_dev[DWT_NUM_DW_DEV];
+static unsigned int sim_cur;
+static unsigned int sim_running = SIM_MAIN;
+static ucontext_t sim_main_ctx;
+static sim_port_ev_t *sim_sched;
+static uint32 sim_sched_len;
+static uint32 sim_sched_cap;
+static sim_port_switch_cb_t sim_switch;
+static const deca_spi_backend_t *spi_backend = &deca_sim_spi;
+static uint32 frame_used;
+static uint32 frame_failed;
+
+/****************************************************************************//**
+ *
+ *                              decadriver platform
+ *
+ *******************************************************************************/
+
+int openspi(void)
+{
+    return 0;
+}
+
+int closespi(void)
+{
+    return 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn deca_spi_set_backend()
+ *
+ * @brief see deca_spi.h; NULL goes back to the model.
+ */
+void deca_spi_set_backend(const deca_spi_backend_t *backend)
+{
+    spi_backend = backend ? backend : &deca_sim_spi;
+}
+
+int writetospi(uint16 headerLength, const uint8 *headerBuffer, uint32 bodylength, const uint8 *bodyBuffer)
+{
+    return spi_backend->write(headerLength, headerBuffer, bodylength, bodyBuffer) ? DWT_ERROR : DWT_SUCCESS;
+}
+
+int readfromspi(uint16 headerLength, const uint8 *headerBuffer, uint32 readlength, uint8 *readBuffer)
+{
+    return spi_backend->read(headerLength, headerBuffer, readlength, readBuffer) ? DWT_ERROR : DWT_SUCCESS;
+}
+
+/* The transfer is done on return, the callback runs before it */
+int writetospi_async(uint16 headerLength, const uint8 *headerBuffer, uint32 bodylength, const uint8 *bodyBuffer,
+                     dwt_spi_cb_t cb, void *arg)
+{
+    int ret = writetospi(headerLength, headerBuffer, bodylength, bodyBuffer);
+
+    if (cb != NULL)
+    {
+        cb(ret, arg);
+    }
+    return ret;
+}
+
+int readfromspi_async(uint16 headerLength, const uint8 *headerBuffer, uint32 readlength, uint8 *readBuffer,
+                      dwt_spi_cb_t cb, void *arg)
+{
+    int ret = readfromspi(headerLength, headerBuffer, readlength, readBuffer);
+
+    if (cb != NULL)
+    {
+        cb(ret, arg);
+    }
+    return ret;
+}
+
+/* Single threaded: the IRQ handlers only run from sim_port_run() */
+decaIrqStatus_t decamutexon(void)
+{
+    return 0;
+}
+
+void decamutexoff(decaIrqStatus_t s)
+{
+    (void)s;
+}
+
+void deca_sleep(unsigned int time_ms)
+{
+    sim_port_wait(DECA_SIM_NS_TO_TICKS((uint64_t)time_ms * 1000000));
+}
+
+void deca_setdevice(unsigned int index)
+{
+    if ((index >= DWT_NUM_DW_DEV) || (index == sim_cur))
+    {
+        return;
+    }
+    if (sim_switch != NULL)
+    {
+        sim_switch(sim_cur, index);
+    }
+    sim_cur = index;
+    deca_sim_select((uint16)index);
+}
+
+unsigned int deca_getdevice(void)
+{
+    return sim_cur;
+}
+
+/****************************************************************************//**
+ *
+ *                              port.h
+ *
+ *******************************************************************************/
+
+void Sleep(uint32_t Delay)
+{
+    deca_sleep(Delay);
+}
+
+int usleep(unsigned long usec)
+{
+    sim_port_wait(DECA_SIM_NS_TO_TICKS((uint64_t)usec * 1000));
+    return 0;
+}
+
+unsigned long portGetTickCnt(void)
+{
+    return (unsigned long)(DECA_SIM_TICKS_TO_NS(deca_sim_now()) / 1000000);
+}
+
+void port_set_dw1000_slowrate(void)
+{
+    deca_sim_spi_hz(SIM_SPI_SLOW_HZ);
+}
+
+void port_set_dw1000_fastrate(void)
+{
+    deca_sim_spi_hz(SIM_SPI_FAST_HZ);
+}
+
+void port_set_dw1000_maxrate(void)
+{
+    deca_sim_spi_hz(SIM_SPI_FAST_HZ);
+}
+
+/* One SYNC line to every node */
+int port_pulse_dw1000_sync(void)
+{
+    deca_sim_syncpulse();
+    return 0;
+}
+
+void port_set_deca_isr(port_deca_isr_t deca_isr)
+{
+    sim_dev[sim_cur].isr = deca_isr;
+    port_EnableEXT_IRQ();
+}
+
+void port_EnableEXT_IRQ(void)
+{
+    sim_dev[sim_cur].irqEn = 1;
+    deca_sim_irqenable((uint16)sim_cur, sim_dev[sim_cur].isr != NULL);
+}
+
+void port_DisableEXT_IRQ(void)
+{
+    sim_dev[sim_cur].irqEn = 0;
+    deca_sim_irqenable((uint16)sim_cur, 0);
+}
+
+uint32_t port_GetEXT_IRQStatus(void)
+{
+    return sim_dev[sim_cur].irqEn;
+}
+
+uint32_t port_CheckEXT_IRQ(void)
+{
+    return (uint32_t)deca_sim_irqline((uint16)sim_cur);
+}
+
+void process_deca_irq(void)
+{
+    if (sim_dev[sim_cur].isr == NULL)
+    {
+        return;
+    }
+
+    do {
+        sim_dev[sim_cur].isr();
+    } while (port_CheckEXT_IRQ() != 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_push() / sim_port_pop()
+ *
+ * @brief Binary min-heap of the coroutine wake ups and calls, stale entries are skipped on the node version.
+ */
+static void sim_port_push(uint64_t t, unsigned int node)
+{
+    uint32 i;
+
+    if (sim_sched_len == sim_sched_cap)
+    {
+        uint32 cap = sim_sched_cap ? (sim_sched_cap * 2) : 256;
+        sim_port_ev_t *ev = realloc(sim_sched, cap * sizeof(sim_port_ev_t));
+
+        if (ev == NULL)
+        {
+            return;
+        }
+        sim_sched = ev;
+        sim_sched_cap = cap;
+    }
+
+    sim_dev[node].ver++;
+    for (i = sim_sched_len++; i > 0; i = (i - 1) / 2)
+    {
+        if (sim_sched[(i - 1) / 2].t <= t)
+        {
+            break;
+        }
+        sim_sched[i] = sim_sched[(i - 1) / 2];
+    }
+    sim_sched[i].t = t;
+    sim_sched[i].node = node;
+    sim_sched[i].ver = sim_dev[node].ver;
+}
+
+static void sim_port_pop(void)
+{
+    sim_port_ev_t last = sim_sched[--sim_sched_len];
+    uint32 i = 0, c;
+
+    while ((c = 2 * i + 1) < sim_sched_len)
+    {
+        if ((c + 1 < sim_sched_len) && (sim_sched[c + 1].t < sim_sched[c].t))
+        {
+            c++;
+        }
+        if (last.t <= sim_sched[c].t)
+        {
+            break;
+        }
+        sim_sched[i] = sim_sched[c];
+        i = c;
+    }
+    if (sim_sched_len)
+    {
+        sim_sched[i] = last;
+    }
+}
+
+/* Earliest valid entry, SIM_NONE without */
+static uint64_t sim_port_top(void)
+{
+    while (sim_sched_len && (sim_sched[0].ver != sim_dev[sim_sched[0].node].ver))
+    {
+        sim_port_pop();
+    }
+    return sim_sched_len ? sim_sched[0].t : SIM_NONE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_wait()
+ *
+ * @brief Time taken by the node running: its coroutine sleeps until then while the other nodes run. Outside
+ *        sim_port_run(), e.g. while main() sets the nodes up, time simply passes.
+ */
+void sim_port_wait(uint64_t ticks)
+{
+    sim_port_dev_t *dev;
+
+    if (sim_running == SIM_MAIN)
+    {
+        deca_sim_advance(ticks);
+        return;
+    }
+
+    dev = &sim_dev[sim_running];
+    sim_port_push(deca_sim_now() + ticks, sim_running);
+    swapcontext(&dev->ctx, &sim_main_ctx);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_entry()
+ *
+ * @brief Coroutine of a node: the calls due and the IRQ handler while its line is up, then back to the scheduler.
+ */
+static void sim_port_entry(void)
+{
+    sim_port_dev_t *dev = &sim_dev[sim_running];
+
+    while (1)
+    {
+        if ((dev->call != NULL) && (dev->callAt <= deca_sim_now()))
+        {
+            sim_port_call_t call = dev->call;
+
+            dev->call = NULL;
+            call();
+        }
+        else if (dev->irqEn && port_CheckEXT_IRQ())
+        {
+            process_deca_irq();
+        }
+        else
+        {
+            break;
+        }
+    }
+    dev->busy = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_resume()
+ *
+ * @brief Run the coroutine of a node, from its start or from its last sim_port_wait(), until it waits or ends.
+ */
+static void sim_port_resume(unsigned int node)
+{
+    sim_port_dev_t *dev = &sim_dev[node];
+
+    deca_setdevice(node);
+
+    if (!dev->busy)
+    {
+        if ((dev->stack == NULL) && ((dev->stack = malloc(SIM_STACK_SIZE)) == NULL))
+        {
+            return;
+        }
+        getcontext(&dev->ctx);
+        dev->ctx.uc_stack.ss_sp = dev->stack;
+        dev->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+        dev->ctx.uc_link = &sim_main_ctx;
+        makecontext(&dev->ctx, sim_port_entry, 0);
+        dev->busy = 1;
+    }
+
+    sim_running = node;
+    swapcontext(&sim_main_ctx, &dev->ctx);
+    sim_running = SIM_MAIN;
+
+    /* Ended with a call still to come */
+    if (!dev->busy && (dev->call != NULL))
+    {
+        sim_port_push(dev->callAt, node);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_set_switch()
+ *
+ * @brief see sim_port.h
+ */
+void sim_port_set_switch(sim_port_switch_cb_t cb)
+{
+    sim_switch = cb;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_call_at()
+ *
+ * @brief see sim_port.h
+ */
+void sim_port_call_at(uint64_t t, sim_port_call_t call)
+{
+    sim_port_dev_t *dev = &sim_dev[sim_cur];
+
+    dev->call = call;
+    dev->callAt = t;
+    if (!dev->busy && (call != NULL))
+    {
+        sim_port_push(t, sim_cur);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_run()
+ *
+ * @brief see sim_port.h
+ */
+uint32_t sim_port_run(uint64_t until)
+{
+    unsigned int prev = sim_cur;
+    uint32_t cnt = 0;
+
+    deca_sim_set_wait(sim_port_wait);
+
+    while (1)
+    {
+        uint64_t tw = sim_port_top();
+        int node = deca_sim_run(MIN(tw, until));
+
+        if (node >= 0)
+        {
+            /* A busy node sees its line again at the end of its handler */
+            if (!sim_dev[node].busy)
+            {
+                sim_port_resume((unsigned int)node);
+                cnt++;
+            }
+            continue;
+        }
+        if ((tw == SIM_NONE) || (tw > until))
+        {
+            break;
+        }
+
+        node = (int)sim_sched[0].node;
+        sim_port_pop();
+        sim_port_resume((unsigned int)node);
+        cnt++;
+    }
+
+    deca_sim_set_wait(NULL);
+    deca_setdevice(prev);
+
+    return cnt;
+}
+
+/****************************************************************************//**
+ *
+ *                              deca_frame.h
+ *
+ *******************************************************************************/
+
+deca_frame_t *deca_frame_alloc(uint16 len, int32 timeout)
+{
+    deca_frame_t *frame;
+    uint16 size = (len <= DECA_FRAME_STD_LEN) ? DECA_FRAME_STD_LEN : DECA_FRAME_EXT_LEN;
+
+    (void)timeout;
+    if (len > DECA_FRAME_EXT_LEN)
+    {
+        frame_failed++;
+        return NULL;
+    }
+
+    frame = calloc(1, sizeof(deca_frame_t) + size);
+    if (frame == NULL)
+    {
+        frame_failed++;
+        return NULL;
+    }
+    atomic_set(&frame->ref, 1);
+    frame->size = size;
+    frame_used++;
+
+    return frame;
+}
+
+deca_frame_t *deca_frame_ref(deca_frame_t *frame)
+{
+    atomic_inc(&frame->ref);
+    return frame;
+}
+
+void deca_frame_unref(deca_frame_t *frame)
+{
+    if (atomic_dec(&frame->ref) == 1)
+    {
+        free(frame);
+        frame_used--;
+    }
+}
+
+/* Host frames come from the heap, the free counts are those of the target pool */
+void deca_frame_getstats(deca_frame_stats_t *stats)
+{
+    stats->stdFree = (frame_used < DECA_FRAME_STD_COUNT) ? (uint8)(DECA_FRAME_STD_COUNT - frame_used) : 0;
+    stats->extFree = DECA_FRAME_EXT_COUNT;
+    stats->allocFailed = frame_failed;
+}
@@ -0,0 +1,108 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_port.h
+ * @brief   Host port of the DW1000 driver on the register level model of
+ *          sim/deca_sim.h
+ *
+ *          Implements port.h, deca_spi.h, deca_frame.h and the decadriver
+ *          platform functions (SPI, mutex, sleep, device selection) for a
+ *          single threaded host program driving DWT_NUM_DW_DEV nodes:
+ *          - deca_setdevice() selects the node of the following calls, in
+ *            the driver and in the model;
+ *          - deca_sleep(), Sleep() and usleep() let simulated time pass;
+ *          - port_set_deca_isr() and port_EnableEXT_IRQ() apply to the
+ *            node selected, sim_port_run() runs their handlers as the IRQ
+ *            work queue of platform/port.c would;
+ *          - each node runs its handler and the calls of sim_port_call_at()
+ *            on a coroutine of its own, which sleeps for the time of each
+ *            SPI transaction, deca_sleep() and usleep(): the nodes overlap
+ *            in simulated time as on separate MCUs.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _SIM_PORT_H_
+#define _SIM_PORT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Called by deca_setdevice() when the node changes, to swap the state of code written for one DW1000 */
+typedef void (*sim_port_switch_cb_t)(unsigned int from, unsigned int to);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_set_switch()
+ *
+ * @brief Install the node switch callback.
+ *
+ * input parameters
+ * @param cb - callback, NULL for none
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void sim_port_set_switch(sim_port_switch_cb_t cb);
+
+/* Work run on the coroutine of a node, see sim_port_call_at() */
+typedef void (*sim_port_call_t)(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_call_at()
+ *
+ * @brief Run a function on the node selected at a simulated time, from sim_port_run(), after its IRQ handler if that
+ *        one is running then. One call per node: a new one replaces the one pending. A call may set the next one.
+ *
+ * input parameters
+ * @param t    - time, DW1000 time units, see deca_sim_now()
+ * @param call - function, NULL to cancel
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void sim_port_call_at(uint64_t t, sim_port_call_t call);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_wait()
+ *
+ * @brief Time taken by the code running on a node, its coroutine sleeps meanwhile. Outside sim_port_run() the time
+ *        simply passes. The model calls it after each transaction, deca_sleep() and usleep() go through it.
+ *
+ * input parameters
+ * @param ticks - DW1000 time units
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void sim_port_wait(uint64_t ticks);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_port_run()
+ *
+ * @brief Let simulated time pass until the limit, running the IRQ handlers and calls of the nodes as they come, each
+ *        with its node selected. Coroutines still sleeping at the limit carry on in the next sim_port_run(). The node
+ *        selected before is selected again on return.
+ *
+ * input parameters
+ * @param until - time limit, DW1000 time units, see deca_sim_now()
+ *
+ * output parameters
+ *
+ * returns the number of coroutine runs
+ */
+uint32_t sim_port_run(uint64_t until);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_PORT_H_ */
@@ -0,0 +1,65 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_rng.c
+ * @brief   Ranging engine for host builds, one state per node
+ *
+ *          The engine keeps its state in one static structure, as there is
+ *          one DW1000 on the target. The host build compiles it into this
+ *          file so that the simulator can save and load that structure
+ *          when it switches nodes, see sim_port_set_switch(). The link
+ *          adaptation state goes with it when CONFIG_DW1000_LINK_ADAPT is
+ *          defined.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include "rng_twr.c"
+#ifdef CONFIG_DW1000_LINK_ADAPT
+#include "rng_link.c"
+#endif
+
+#include "sim_rng.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_ctxsize()
+ *
+ * @brief see sim_rng.h
+ */
+size_t sim_rng_ctxsize(void)
+{
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    return sizeof(rng) + sizeof(lnk);
+#else
+    return sizeof(rng);
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_save()
+ *
+ * @brief see sim_rng.h
+ */
+void sim_rng_save(void *ctx)
+{
+    memcpy(ctx, &rng, sizeof(rng));
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    memcpy((uint8 *)ctx + sizeof(rng), &lnk, sizeof(lnk));
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_load()
+ *
+ * @brief see sim_rng.h
+ */
+void sim_rng_load(const void *ctx)
+{
+    memcpy(&rng, ctx, sizeof(rng));
+#ifdef CONFIG_DW1000_LINK_ADAPT
+    memcpy(&lnk, (const uint8 *)ctx + sizeof(rng), sizeof(lnk));
+#endif
+}
@@ -0,0 +1,68 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_rng.h
+ * @brief   State of the ranging engine, saved and loaded per node in host
+ *          builds, see sim_rng.c
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _SIM_RNG_H_
+#define _SIM_RNG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_ctxsize()
+ *
+ * @brief Size of the engine state. A zeroed state is that of an engine never initialised.
+ *
+ * input parameters
+ *
+ * output parameters
+ *
+ * returns the size in bytes
+ */
+size_t sim_rng_ctxsize(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_save()
+ *
+ * @brief Copy the engine state out, before switching to another node.
+ *
+ * input parameters
+ *
+ * output parameters
+ * @param ctx - sim_rng_ctxsize() bytes
+ *
+ * no return value
+ */
+void sim_rng_save(void *ctx);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_rng_load()
+ *
+ * @brief Copy the engine state of a node in, after switching to it.
+ *
+ * input parameters
+ * @param ctx - sim_rng_ctxsize() bytes saved by sim_rng_save(), or zeroed
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void sim_rng_load(const void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_RNG_H_ */
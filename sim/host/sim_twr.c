@@ -0,0 +1,412 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_twr.c
+ * @brief   Host benchmark of the ranging engine on the register level model
+ *
+ *          Places pairs of nodes on a grid, an initiator and its responder
+ *          per pair, and runs the engine of ranging/rng_twr.c on each of
+ *          them through the real decadriver, see sim/README.rst. Every
+ *          initiator starts an exchange with its responder at a fixed
+ *          interval from a random phase. The pairs share one channel:
+ *          frames overlapping at a receiver corrupt each other, a dense
+ *          grid shows the collision rate of the schedule.
+ *
+ *          Arguments, key=value, the defaults in sim_args_t below:
+ *          pairs, ms (simulated time), mode (ds or ss), dist (mm, within a
+ *          pair), spacing (mm, between pairs), ppm (clock drift spread,
+ *          +/-), loss (% of frames lost at each receiver), interval (ms),
+ *          seed, range (mm, 0 for no limit), spi (Hz), autoto (1 for the
+ *          RX timeouts derived from the PHY, autoTimeouts of rng_twr.h).
+ *
+ *          Prints a CSV header and one line starting with SIM: exchanges
+ *          started and completed, exchange rate, distance error mean and
+ *          standard deviation against the true distance, failures by
+ *          cause, model counters, the receiver on time of the initiators
+ *          and the host time taken.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "port.h"
+#include "rng_twr.h"
+#include "deca_sim.h"
+#include "sim_port.h"
+#include "sim_rng.h"
+
+/* Default antenna delay values for 64 MHz PRF, those of the nodes of the model. */
+#define TX_ANT_DLY 16436
+#define RX_ANT_DLY 16436
+
+#define SIM_INIT_ADDR(k)    ((uint16)(0x1000 + (k)))
+#define SIM_RESP_ADDR(k)    ((uint16)(0x2000 + (k)))
+
+// An initiator still busy after this many intervals is stopped
+#define SIM_STUCK_INTERVALS 8
+
+#define SIM_MS_TO_TICKS(ms) DECA_SIM_NS_TO_TICKS((uint64_t)(ms) * 1000000)
+
+typedef struct
+{
+    unsigned int pairs;
+    unsigned int ms;
+    rng_mode_t mode;
+    unsigned int distMm;
+    unsigned int spacingMm;
+    unsigned int ppm;
+    unsigned int loss;
+    unsigned int intervalMs;
+    unsigned int seed;
+    unsigned int rangeMm;
+    unsigned int spiHz;
+    unsigned int autoTo;
+} sim_args_t;
+
+/* PHY and ranging delays of the 6M8/128 profile of example 16a. */
+static dwt_config_t sim_phy = {
+    5,               /* Channel number. */
+    DWT_PRF_64M,     /* Pulse repetition frequency. */
+    DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+    DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+    9,               /* TX preamble code. Used in TX only. */
+    9,               /* RX preamble code. Used in RX only. */
+    1,               /* 0 to use standard SFD, 1 to use non-standard SFD. */
+    DWT_BR_6M8,      /* Data rate. */
+    DWT_PHRMODE_STD, /* PHY header mode. */
+    (129)            /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+};
+#define SIM_DLY_UUS         1500
+#define SIM_SS_DLY_UUS      700
+#define SIM_AIR_UUS         200
+
+typedef struct
+{
+    unsigned int started;
+    unsigned int ok;
+    unsigned int busy;                        // interval skipped, the previous exchange still running
+    unsigned int stuck;
+    unsigned int fails[RNG_ERR_BUSY + 1];
+    double errSum;                      // mm
+    double errSq;
+} sim_totals_t;
+
+static sim_args_t args = {
+    .pairs = 1,
+    .ms = 10000,
+    .mode = RNG_MODE_DS,
+    .distMm = 5000,
+    .spacingMm = 20000,
+    .ppm = 10,
+    .loss = 0,
+    .intervalMs = 100,
+    .seed = 1,
+    .rangeMm = 0,
+    .spiHz = 8000000,
+    .autoTo = 0,
+};
+
+static sim_totals_t totals;
+static uint8 *rng_ctx;
+static size_t rng_ctx_size;
+static uint64_t *next;                  // per pair: next interval, start of the exchange running
+static uint64_t *since;
+static uint32 rnd;
+
+static uint32 sim_random(void)
+{
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    return rnd;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_switch()
+ *
+ * @brief Node switch: swap the ranging engine state.
+ */
+static void sim_switch(unsigned int from, unsigned int to)
+{
+    sim_rng_save(&rng_ctx[from * rng_ctx_size]);
+    sim_rng_load(&rng_ctx[to * rng_ctx_size]);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rng_result_cb()
+ *
+ * @brief Results of the initiators, against the true distance.
+ */
+static void rng_result_cb(const rng_result_t *result)
+{
+    double err;
+
+    if (deca_getdevice() & 1)
+    {
+        return;
+    }
+    if (result->status != RNG_OK)
+    {
+        totals.fails[result->status]++;
+        return;
+    }
+
+    err = (double)result->distMm - args.distMm;
+    totals.ok++;
+    totals.errSum += err;
+    totals.errSq += err * err;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_start()
+ *
+ * @brief Interval of an initiator, on its node: start an exchange unless the previous one is still running, and set
+ *        the next interval.
+ */
+static void sim_start(void)
+{
+    unsigned int k = deca_getdevice() / 2;
+
+    next[k] += SIM_MS_TO_TICKS(args.intervalMs);
+    sim_port_call_at(next[k], sim_start);
+
+    if (rng_getstate() != RNG_IDLE)
+    {
+        /* The engine ends every exchange on its own timeouts, this catches a lost IRQ or a model bug */
+        if (deca_sim_now() - since[k] < SIM_STUCK_INTERVALS * SIM_MS_TO_TICKS(args.intervalMs))
+        {
+            totals.busy++;
+            return;
+        }
+        totals.stuck++;
+        rng_stop();
+    }
+    since[k] = deca_sim_now();
+    if (rng_initiate(SIM_RESP_ADDR(k)) == DWT_SUCCESS)
+    {
+        totals.started++;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_timings()
+ *
+ * @brief Ranging delays of the profile, as bench_timings() of example 16a.
+ */
+static void sim_timings(rng_config_t *cfg)
+{
+    cfg->pollRxToRespTxDlyUus = SIM_DLY_UUS;
+    cfg->respRxToFinalTxDlyUus = SIM_DLY_UUS;
+    cfg->pollTxToRespRxDlyUus = SIM_DLY_UUS - SIM_AIR_UUS - 300;
+    cfg->respTxToFinalRxDlyUus = SIM_DLY_UUS - SIM_AIR_UUS - 300;
+    cfg->respRxTimeoutUus = 2 * SIM_AIR_UUS + 500;
+    cfg->finalRxTimeoutUus = 2 * SIM_AIR_UUS + 500;
+    cfg->reportRxTimeoutUus = 2 * SIM_AIR_UUS + 1500;
+    cfg->ssPollRxToRespTxDlyUus = SIM_SS_DLY_UUS;
+    cfg->ssPollTxToRespRxDlyUus = SIM_SS_DLY_UUS - SIM_AIR_UUS - 300;
+    cfg->ssRespRxTimeoutUus = 2 * SIM_AIR_UUS + 500;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_node_setup()
+ *
+ * @brief Place a node, then initialise its DW1000 and ranging engine through the driver.
+ *
+ * returns DWT_SUCCESS for success, or DWT_ERROR for error
+ */
+static int sim_node_setup(uint16 node, uint16 cols)
+{
+    deca_sim_node_config_t ncfg = DECA_SIM_NODE_CONFIG_DEFAULT;
+    uint16 k = node / 2;
+    rng_config_t rcfg = RNG_CONFIG_DEFAULT((node & 1) ? SIM_RESP_ADDR(k) : SIM_INIT_ADDR(k));
+
+    ncfg.xMm = (int32)((k % cols) * args.spacingMm + ((node & 1) ? args.distMm : 0));
+    ncfg.yMm = (int32)((k / cols) * args.spacingMm);
+    if (args.ppm)
+    {
+        ncfg.clkPpb = (int32)(sim_random() % (2000 * args.ppm + 1)) - (int32)(1000 * args.ppm);
+    }
+    ncfg.clkOffset = ((uint64_t)sim_random() << 8) & 0xFFFFFFFFFFULL;
+    deca_sim_setnode(node, &ncfg);
+
+    deca_setdevice(node);
+    port_set_dw1000_slowrate();
+    if (dwt_initialise(DWT_LOADUCODE) == DWT_ERROR)
+    {
+        return DWT_ERROR;
+    }
+    port_set_dw1000_fastrate();
+    deca_sim_spi_hz(args.spiHz);
+    dwt_configure(&sim_phy);
+    dwt_setrxantennadelay(RX_ANT_DLY);
+    dwt_settxantennadelay(TX_ANT_DLY);
+
+    rcfg.txAntDly = TX_ANT_DLY;
+    rcfg.report = 1;
+    rcfg.autoTimeouts = (uint8)args.autoTo;
+    sim_timings(&rcfg);
+    if (rng_init(&rcfg, rng_result_cb) != DWT_SUCCESS)
+    {
+        return DWT_ERROR;
+    }
+    rng_setphy(&sim_phy);
+
+    if (node & 1)
+    {
+        rng_respond();
+    }
+    else if (args.mode == RNG_MODE_SS)
+    {
+        rng_setlinkmode(SIM_RESP_ADDR(k), RNG_MODE_SS);
+    }
+
+    return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn sim_parse()
+ *
+ * @brief key=value arguments into args.
+ *
+ * returns 0 for success, -1 on an unknown key
+ */
+static int sim_parse(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        char *val = strchr(argv[i], '=');
+        unsigned long v;
+
+        if (val == NULL)
+        {
+            return -1;
+        }
+        *val++ = '\0';
+        v = strtoul(val, NULL, 0);
+
+        if (!strcmp(argv[i], "pairs"))          args.pairs = (unsigned int)v;
+        else if (!strcmp(argv[i], "ms"))        args.ms = (unsigned int)v;
+        else if (!strcmp(argv[i], "mode"))      args.mode = strcmp(val, "ss") ? RNG_MODE_DS : RNG_MODE_SS;
+        else if (!strcmp(argv[i], "dist"))      args.distMm = (unsigned int)v;
+        else if (!strcmp(argv[i], "spacing"))   args.spacingMm = (unsigned int)v;
+        else if (!strcmp(argv[i], "ppm"))       args.ppm = (unsigned int)v;
+        else if (!strcmp(argv[i], "loss"))      args.loss = (unsigned int)v;
+        else if (!strcmp(argv[i], "interval"))  args.intervalMs = (unsigned int)v;
+        else if (!strcmp(argv[i], "seed"))      args.seed = (unsigned int)v;
+        else if (!strcmp(argv[i], "range"))     args.rangeMm = (unsigned int)v;
+        else if (!strcmp(argv[i], "spi"))       args.spiHz = (unsigned int)v;
+        else if (!strcmp(argv[i], "autoto"))    args.autoTo = (unsigned int)v;
+        else                                    return -1;
+    }
+
+    return ((args.pairs == 0) || (2 * args.pairs > DWT_NUM_DW_DEV) || (args.intervalMs == 0)) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    deca_sim_config_t scfg = DECA_SIM_CONFIG_DEFAULT;
+    uint16 nodes, cols, k;
+    deca_sim_stats_t st, sum;
+    uint64_t init_rx_us = 0;
+    struct timespec t0, t1;
+    unsigned int handlers;
+    double mean, std;
+
+    if (sim_parse(argc, argv) != 0)
+    {
+        fprintf(stderr, "usage: %s [key=value]... keys: pairs ms mode dist spacing ppm loss interval seed range spi "
+                "autoto, "
+                "at most %d pairs\n", argv[0], DWT_NUM_DW_DEV / 2);
+        return 1;
+    }
+
+    nodes = 2 * args.pairs;
+    cols = (uint16)ceil(sqrt(args.pairs));
+    rnd = args.seed ? args.seed : 1;
+    scfg.lossPct = args.loss;
+    scfg.maxRangeMm = args.rangeMm;
+    scfg.seed = args.seed;
+    scfg.spiHz = args.spiHz;
+
+    rng_ctx_size = sim_rng_ctxsize();
+    rng_ctx = calloc(nodes, rng_ctx_size);
+    next = calloc(args.pairs, sizeof(uint64_t));
+    since = calloc(args.pairs, sizeof(uint64_t));
+    if ((rng_ctx == NULL) || (next == NULL) || (since == NULL) || (deca_sim_init(&scfg, nodes) != DWT_SUCCESS))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    sim_port_set_switch(sim_switch);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (k = 0; k < nodes; k++)
+    {
+        if (sim_node_setup(k, cols) != DWT_SUCCESS)
+        {
+            fprintf(stderr, "node %u: init failed\n", k);
+            return 1;
+        }
+    }
+    for (k = 0; k < args.pairs; k++)
+    {
+        deca_setdevice(2 * k);
+        next[k] = deca_sim_now() + sim_random() % SIM_MS_TO_TICKS(args.intervalMs);
+        sim_port_call_at(next[k], sim_start);
+    }
+    handlers = sim_port_run(deca_sim_now() + SIM_MS_TO_TICKS(args.ms));
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    memset(&sum, 0, sizeof(sum));
+    for (k = 0; k < nodes; k++)
+    {
+        deca_sim_getstats(k, &st);
+        sum.txFrames += st.txFrames;
+        sum.txLate += st.txLate;
+        sum.rxGood += st.rxGood;
+        sum.rxCollided += st.rxCollided;
+        sum.rxLost += st.rxLost;
+        sum.rxFiltered += st.rxFiltered;
+        sum.spiTrans += st.spiTrans;
+        sum.rxPreTimeouts += st.rxPreTimeouts;
+        if (!(k & 1))
+        {
+            init_rx_us += st.rxOnUs;
+        }
+    }
+
+    mean = totals.ok ? (totals.errSum / totals.ok) : 0.0;
+    std = totals.ok ? sqrt(fmax(totals.errSq / totals.ok - mean * mean, 0.0)) : 0.0;
+
+    printf("SIM,mode,pairs,ms,interval_ms,started,ok,ok_pct,exch_per_s,err_mean_mm,err_std_mm,rx_timeout,rx_err,"
+           "frame_err,tx_late,busy,stuck,tx_frames,collided,lost,filtered,pre_timeout,init_rx_on_ms,runs,spi_trans,"
+           "wall_ms\n");
+    printf("SIM,%s,%u,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.1f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f,%u,%u,%.0f\n",
+           (args.mode == RNG_MODE_SS) ? "ss" : "ds", args.pairs, args.ms, args.intervalMs, totals.started, totals.ok,
+           totals.started ? (100.0 * totals.ok / totals.started) : 0.0, 1000.0 * totals.ok / args.ms, mean, std,
+           totals.fails[RNG_ERR_RX_TIMEOUT], totals.fails[RNG_ERR_RX], totals.fails[RNG_ERR_FRAME],
+           totals.fails[RNG_ERR_TX_LATE], totals.busy, totals.stuck, sum.txFrames, sum.rxCollided, sum.rxLost,
+           sum.rxFiltered, sum.rxPreTimeouts, init_rx_us / 1000.0, handlers, sum.spiTrans,
+           (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1000000.0);
+
+    deca_sim_exit();
+    free(rng_ctx);
+    free(next);
+    free(since);
+
+    return 0;
+}
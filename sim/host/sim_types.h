@@ -0,0 +1,27 @@
+/*! ----------------------------------------------------------------------------
+ * @file    sim_types.h
+ * @brief   32-bit decadriver types for 64-bit hosts, forced on every file of
+ *          a host build (gcc -include sim_types.h)
+ *
+ *          deca_types.h defines uint32 and int32 as long, 64 bits on LP64
+ *          hosts: the driver and the ranging engine rely on 32-bit wrap
+ *          around for their timestamp differences.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _SIM_TYPES_H_
+#define _SIM_TYPES_H_
+
+#define _DECA_UINT32_
+#define _DECA_INT32_
+
+typedef unsigned int uint32;
+typedef signed int int32;
+
+#endif /* _SIM_TYPES_H_ */
@@ -0,0 +1,38 @@
+/*! ----------------------------------------------------------------------------
+ * @file    zephyr.h
+ * @brief   The few Zephyr kernel definitions the driver port headers and the
+ *          ranging engine use, for host builds: single threaded, the atomics
+ *          are plain integers.
+ *
+ * @attention
+ *
+ * Copyright 2019 (c) Frederic Mes, RTLOC.
+ *
+ * All rights reserved.
+ *
+ */
+
+#ifndef _SIM_ZEPHYR_H_
+#define _SIM_ZEPHYR_H_
+
+#include <stdio.h>
+
+typedef int atomic_t;
+
+static inline int atomic_inc(atomic_t *target) { return (*target)++; }
+static inline int atomic_dec(atomic_t *target) { return (*target)--; }
+static inline int atomic_set(atomic_t *target, int value) { int old = *target; *target = value; return old; }
+static inline int atomic_get(const atomic_t *target) { return *target; }
+
+#define K_NO_WAIT       0
+#define K_FOREVER       (-1)
+
+#ifndef MIN
+#define MIN(a, b)       (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)       (((a) > (b)) ? (a) : (b))
+#endif
+
+#define printk          printf
+
+
+#endif /* _SIM_ZEPHYR_H_ */
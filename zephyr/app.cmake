@@ -0,0 +1,12 @@
+# Included by the examples before the Zephyr boilerplate: registers this
+# repository as a Zephyr module (DW1000 library, Kconfig and devicetree
+# binding) and adds the DW1000 node to the board devicetree.
+
+get_filename_component(DWM1001_ROOT ${CMAKE_CURRENT_LIST_DIR}/.. ABSOLUTE)
+
+list(APPEND ZEPHYR_EXTRA_MODULES ${DWM1001_ROOT})
+list(APPEND DTS_ROOT ${DWM1001_ROOT})
+
+if(NOT DEFINED DTC_OVERLAY_FILE AND EXISTS ${DWM1001_ROOT}/dts/${BOARD}.overlay)
+  set(DTC_OVERLAY_FILE ${DWM1001_ROOT}/dts/${BOARD}.overlay)
+endif()